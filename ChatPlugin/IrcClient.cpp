@@ -0,0 +1,481 @@
+#include "IrcClient.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <system_error>
+
+bool IrcMessage::Parse(const std::string& line, IrcMessage& message)
+{
+	message.Prefix.clear();
+	message.Command.clear();
+	message.Params.clear();
+
+	size_t pos = 0;
+	auto skipSpaces = [&]()
+	{
+		while (pos < line.length() && line[pos] == ' ')
+			pos++;
+	};
+
+	if (!line.empty() && line[0] == ':')
+	{
+		auto end = line.find(' ');
+		if (end == std::string::npos)
+			return false;
+		message.Prefix = line.substr(1, end - 1);
+		pos = end;
+	}
+
+	skipSpaces();
+	auto end = line.find(' ', pos);
+	if (end == std::string::npos)
+		end = line.length();
+	message.Command = line.substr(pos, end - pos);
+	if (message.Command.empty())
+		return false;
+	std::transform(message.Command.begin(), message.Command.end(), message.Command.begin(), [](char c) { return static_cast<char>(toupper(static_cast<unsigned char>(c))); });
+	pos = end;
+
+	for (;;)
+	{
+		skipSpaces();
+		if (pos >= line.length())
+			break;
+
+		if (line[pos] == ':')
+		{
+			// the trailing param takes up the rest of the line, spaces and all
+			message.Params.push_back(line.substr(pos + 1));
+			break;
+		}
+
+		end = line.find(' ', pos);
+		if (end == std::string::npos)
+			end = line.length();
+		message.Params.push_back(line.substr(pos, end - pos));
+		pos = end;
+	}
+	return true;
+}
+
+std::string IrcMessage::GetNick() const
+{
+	return Prefix.substr(0, Prefix.find('!'));
+}
+
+std::string IrcMessage::GetParam(size_t index) const
+{
+	if (index >= Params.size())
+		return "";
+	return Params[index];
+}
+
+void IrcLineFramer::Append(const char* data, size_t size)
+{
+	pending.append(data, size);
+}
+
+bool IrcLineFramer::NextLine(std::string& line)
+{
+	for (;;)
+	{
+		auto end = pending.find('\n', readPos);
+		if (end == std::string::npos)
+		{
+			// only the start of a line is left, move it to the front so the buffer doesn't keep growing
+			pending.erase(0, readPos);
+			readPos = 0;
+			if (pending.length() > MaxLineLength)
+			{
+				pending.clear();
+				discarding = true;
+			}
+			return false;
+		}
+
+		auto start = readPos;
+		readPos = end + 1;
+		if (discarding)
+		{
+			// this is the end of a line that was too long
+			discarding = false;
+			continue;
+		}
+
+		auto length = end - start;
+		if (length > 0 && pending[end - 1] == '\r')
+			length--;
+		if (length == 0 || length > MaxLineLength)
+			continue;
+
+		line.assign(pending, start, length);
+		return true;
+	}
+}
+
+void IrcLineFramer::Reset()
+{
+	pending.clear();
+	readPos = 0;
+	discarding = false;
+}
+
+IrcFloodControl::IrcFloodControl(uint32_t burst, uint32_t refillTime)
+	: burst(burst), refillTime(refillTime), tokens(0), lastRefill(0)
+{
+}
+
+bool IrcFloodControl::TryTake(uint64_t now)
+{
+	refill(now);
+	if (tokens < refillTime)
+		return false;
+
+	tokens -= refillTime;
+	return true;
+}
+
+uint32_t IrcFloodControl::GetWaitTime(uint64_t now)
+{
+	refill(now);
+	if (tokens >= refillTime)
+		return 0;
+	return static_cast<uint32_t>(refillTime - tokens);
+}
+
+void IrcFloodControl::Reset(uint64_t now)
+{
+	tokens = static_cast<uint64_t>(burst) * refillTime;
+	lastRefill = now;
+}
+
+void IrcFloodControl::refill(uint64_t now)
+{
+	if (now <= lastRefill)
+		return;
+
+	tokens += now - lastRefill;
+	auto maxTokens = static_cast<uint64_t>(burst) * refillTime;
+	if (tokens > maxTokens)
+		tokens = maxTokens;
+	lastRefill = now;
+}
+
+IrcClient::IrcClient(IrcEnvironment& environment)
+	: enqueuePos(0), dequeuePos(0), environment(environment), running(false), stopping(false), registered(false), flood(FloodBurst, FloodRefillTime)
+{
+	for (size_t i = 0; i < SendQueueSize; i++)
+		queue[i].Sequence.store(i, std::memory_order_relaxed);
+}
+
+IrcClient::~IrcClient()
+{
+	if (!thread.joinable())
+		return;
+
+	// this can get called while the loader lock is held (modules are globals), and the thread can't exit until it's released,
+	// so only give it a moment to send its QUIT and never join it
+	stopping = true;
+	environment.Wake();
+	auto start = std::chrono::steady_clock::now();
+	while (running && std::chrono::steady_clock::now() - start < std::chrono::seconds(1))
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	thread.detach();
+}
+
+bool IrcClient::Start(const std::string& host, const std::string& port, const std::string& nick, const std::string& realName, const Callbacks& callbacks)
+{
+	if (running)
+		return false;
+
+	if (thread.joinable())
+		thread.join(); // it's already finished running
+
+	this->host = host;
+	this->port = port;
+	this->realName = realName;
+	this->callbacks = callbacks;
+	SetNick(nick);
+
+	stopping = false;
+	running = true;
+	try
+	{
+		thread = std::thread([this]() { run(); });
+	}
+	catch (const std::system_error&)
+	{
+		running = false;
+		return false;
+	}
+	return true;
+}
+
+void IrcClient::Stop()
+{
+	if (!thread.joinable())
+		return;
+
+	stopping = true;
+	environment.Wake();
+	thread.join();
+}
+
+void IrcClient::SetNick(const std::string& nick)
+{
+	std::lock_guard<std::mutex> lock(nickLock);
+	this->nick = nick;
+}
+
+bool IrcClient::Send(const std::string& line)
+{
+	// anything queued before registering would just get an error back
+	if (!registered)
+		return false;
+
+	auto length = line.find_first_of("\r\n");
+	if (length == std::string::npos)
+		length = line.length();
+	if (length > MaxSendLength)
+		length = MaxSendLength;
+
+	QueueEntry* entry;
+	auto pos = enqueuePos.load(std::memory_order_relaxed);
+	for (;;)
+	{
+		entry = &queue[pos & (SendQueueSize - 1)];
+		auto seq = entry->Sequence.load(std::memory_order_acquire);
+		auto diff = (intptr_t)seq - (intptr_t)pos;
+		if (diff == 0)
+		{
+			// slot is free, try to claim it
+			if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+				break;
+		}
+		else if (diff < 0)
+			return false; // connection thread hasn't sent this slot yet, queue is full
+		else
+			pos = enqueuePos.load(std::memory_order_relaxed); // another thread claimed it first
+	}
+
+	memcpy(entry->Line, line.c_str(), length);
+	entry->Line[length] = 0;
+
+	entry->Sequence.store(pos + 1, std::memory_order_release); // hand it to the connection thread
+	environment.Wake();
+	return true;
+}
+
+/// <summary>
+/// Keeps connecting until Stop is called, the delay between attempts doubles each time one fails.
+/// </summary>
+void IrcClient::run()
+{
+	uint32_t delay = MinReconnectDelay;
+	while (!stopping)
+	{
+		std::string error;
+		if (environment.Connect(host, port, error))
+			runConnection(error);
+
+		// it got all the way in, so whatever broke the connection wasn't us failing to connect, start the backoff again
+		if (registered)
+			delay = MinReconnectDelay;
+
+		registered = false;
+		environment.Disconnect();
+
+		if (stopping)
+			break;
+
+		if (callbacks.OnDisconnected)
+			callbacks.OnDisconnected(error, delay, callbacks.Param);
+
+		if (waitForStop(delay))
+			break;
+
+		delay *= 2;
+		if (delay > MaxReconnectDelay)
+			delay = MaxReconnectDelay;
+	}
+
+	running = false;
+}
+
+/// <summary>
+/// Registers and then handles the connection until it drops or Stop is called.
+/// </summary>
+void IrcClient::runConnection(std::string& error)
+{
+	framer.Reset();
+	outgoing.clear();
+	clearQueue(); // anything left from the last connection was meant for channels we aren't in anymore
+
+	auto now = environment.GetTime();
+	flood.Reset(now);
+
+	std::string currentNick;
+	{
+		std::lock_guard<std::mutex> lock(nickLock);
+		currentNick = nick;
+	}
+	sendNow("NICK " + currentNick);
+	sendNow("USER " + currentNick + " 0 * :" + realName);
+
+	auto lastReceived = now;
+	bool pinged = false;
+	char buffer[4096];
+	std::string line;
+	for (;;)
+	{
+		if (stopping)
+		{
+			sendNow("QUIT");
+			flushOutgoing(error);
+			error = "disconnected";
+			return;
+		}
+
+		// the socket's event only gets set again once recv has been called, so always read until there's nothing left
+		for (;;)
+		{
+			auto received = environment.Receive(buffer, sizeof(buffer), error);
+			if (received < 0)
+				return;
+			if (received == 0)
+				break;
+
+			framer.Append(buffer, received);
+			lastReceived = environment.GetTime();
+			pinged = false;
+		}
+
+		while (framer.NextLine(line))
+			handleLine(line);
+
+		now = environment.GetTime();
+		while (registered && flood.GetWaitTime(now) == 0 && dequeue(line))
+		{
+			flood.TryTake(now);
+			outgoing += line + "\r\n";
+		}
+
+		auto idle = now - lastReceived;
+		if (idle >= IdleTimeout)
+		{
+			error = "connection timed out";
+			return;
+		}
+		if (idle >= IdleTimeout / 2 && !pinged)
+		{
+			// see if the server's still there before giving up on it
+			sendNow("PING :" + host);
+			pinged = true;
+		}
+
+		if (!flushOutgoing(error))
+			return;
+
+		uint32_t timeout = static_cast<uint32_t>((pinged ? IdleTimeout : IdleTimeout / 2) - idle);
+		if (registered && hasQueued())
+		{
+			auto floodWait = flood.GetWaitTime(now);
+			if (floodWait < timeout)
+				timeout = floodWait;
+		}
+
+		environment.Wait(timeout);
+	}
+}
+
+void IrcClient::handleLine(const std::string& line)
+{
+	IrcMessage message;
+	if (!IrcMessage::Parse(line, message))
+		return;
+
+	if (message.Command == "PING")
+	{
+		// skips the queue and flood control, the server disconnects us if this takes too long
+		sendNow("PONG :" + message.GetParam(0));
+		return;
+	}
+
+	if (message.Command == "001")
+	{
+		registered = true;
+		if (callbacks.OnRegistered)
+			callbacks.OnRegistered(callbacks.Param);
+	}
+
+	if (callbacks.OnMessage)
+		callbacks.OnMessage(message, callbacks.Param);
+}
+
+/// <summary>
+/// Adds a line straight to the outgoing data, skipping the queue and flood control.
+/// </summary>
+void IrcClient::sendNow(const std::string& line)
+{
+	outgoing += line + "\r\n";
+}
+
+/// <summary>
+/// Sends as much outgoing data as the connection will take, the rest gets sent once Wait says it can take more.
+/// </summary>
+bool IrcClient::flushOutgoing(std::string& error)
+{
+	size_t sent = 0;
+	while (sent < outgoing.length())
+	{
+		auto result = environment.Send(outgoing.c_str() + sent, outgoing.length() - sent, error);
+		if (result < 0)
+			return false;
+		if (result == 0)
+			break;
+		sent += result;
+	}
+	outgoing.erase(0, sent);
+	return true;
+}
+
+bool IrcClient::hasQueued()
+{
+	return queue[dequeuePos & (SendQueueSize - 1)].Sequence.load(std::memory_order_acquire) == dequeuePos + 1;
+}
+
+bool IrcClient::dequeue(std::string& line)
+{
+	auto& entry = queue[dequeuePos & (SendQueueSize - 1)];
+	if (entry.Sequence.load(std::memory_order_acquire) != dequeuePos + 1)
+		return false; // nothing left (or a sender is still filling this slot in)
+
+	line = entry.Line;
+	entry.Sequence.store(dequeuePos + SendQueueSize, std::memory_order_release); // slot is free again
+	dequeuePos++;
+	return true;
+}
+
+void IrcClient::clearQueue()
+{
+	std::string line;
+	while (dequeue(line))
+	{
+	}
+}
+
+/// <summary>
+/// Waits for the given time, returns early (with true) if Stop gets called.
+/// </summary>
+bool IrcClient::waitForStop(uint32_t timeout)
+{
+	auto start = environment.GetTime();
+	while (!stopping)
+	{
+		auto elapsed = environment.GetTime() - start;
+		if (elapsed >= timeout)
+			return false;
+		environment.Wait(static_cast<uint32_t>(timeout - elapsed));
+	}
+	return true;
+}
@@ -0,0 +1,206 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// a single IRC line split up as in RFC 1459 section 2.3.1: [:prefix] command param1 param2 ... [:trailing param]
+struct IrcMessage
+{
+	std::string Prefix; // without the leading ':'
+	std::string Command;
+	std::vector<std::string> Params; // the trailing param is the last one if there was one
+
+	// Parses a line (without the CRLF), returns false if there's no command.
+	static bool Parse(const std::string& line, IrcMessage& message);
+
+	// The nick out of a nick!user@host prefix.
+	std::string GetNick() const;
+
+	// Returns an empty string if the param doesn't exist.
+	std::string GetParam(size_t index) const;
+};
+
+// splits received data into lines, if a line gets split across two recv calls the first part is kept until the rest comes in
+class IrcLineFramer
+{
+public:
+	// lines are only meant to be 512 bytes, but some servers send longer ones, anything past this gets thrown away
+	static const size_t MaxLineLength = 8192;
+
+	void Append(const char* data, size_t size);
+
+	// Gets the next complete line without its line ending, returns false if there isn't one yet.
+	bool NextLine(std::string& line);
+
+	void Reset();
+
+private:
+	std::string pending;
+	size_t readPos = 0;
+	bool discarding = false; // dropping the rest of a line that went over MaxLineLength
+};
+
+// token bucket used to stop the server kicking us off for flooding
+// lets a few lines through at once, after that it's one line every RefillTime ms
+class IrcFloodControl
+{
+public:
+	IrcFloodControl(uint32_t burst, uint32_t refillTime);
+
+	// Takes a token if there is one.
+	bool TryTake(uint64_t now);
+
+	// How long until TryTake will succeed, 0 if it will now.
+	uint32_t GetWaitTime(uint64_t now);
+
+	// Fills the bucket back up, used when a new connection is made.
+	void Reset(uint64_t now);
+
+private:
+	uint32_t burst;
+	uint32_t refillTime;
+	uint64_t tokens; // in 1/refillTime's of a token, so refilling doesn't need any division
+	uint64_t lastRefill;
+
+	void refill(uint64_t now);
+};
+
+// the network side of IrcClient, everything here is only called from the connection thread except Wake
+class IrcEnvironment
+{
+public:
+	virtual ~IrcEnvironment() {}
+
+	// Milliseconds since some fixed point, only used to measure how long things take.
+	virtual uint64_t GetTime() = 0;
+
+	// Connects to the server, gives up early if Wake is called.
+	virtual bool Connect(const std::string& host, const std::string& port, std::string& error) = 0;
+	virtual void Disconnect() = 0;
+
+	// Neither of these block, they return how many bytes were received/sent (0 if the socket isn't ready),
+	// or -1 with error set if the connection is gone.
+	virtual int Receive(char* buffer, size_t size, std::string& error) = 0;
+	virtual int Send(const char* data, size_t size, std::string& error) = 0;
+
+	// Waits until there's data to receive, the connection can take more data, Wake is called, or the timeout is up.
+	virtual void Wait(uint32_t timeout) = 0;
+
+	// Can be called from any thread.
+	virtual void Wake() = 0;
+};
+
+// Winsock, with the socket in non-blocking mode and an event for each of the socket and Wake
+class WinIrcEnvironment : public IrcEnvironment
+{
+public:
+	WinIrcEnvironment();
+	~WinIrcEnvironment();
+
+	uint64_t GetTime();
+	bool Connect(const std::string& host, const std::string& port, std::string& error);
+	void Disconnect();
+	int Receive(char* buffer, size_t size, std::string& error);
+	int Send(const char* data, size_t size, std::string& error);
+	void Wait(uint32_t timeout);
+	void Wake();
+
+private:
+	// a SOCKET and two event HANDLEs, kept as plain types so this header doesn't need winsock2.h
+	uintptr_t sock;
+	void* socketEvent;
+	void* wakeEvent;
+	bool started; // WSAStartup was called for this connection
+};
+
+// IRC connection that runs on its own thread
+// the thread owns the socket: it registers, answers PINGs, sends whatever's been queued (as fast as the flood control allows),
+// and if the connection drops it reconnects, waiting twice as long after each failed attempt
+// Send can be called from any thread, lines get put in a lock-free queue that only the connection thread takes from
+class IrcClient
+{
+public:
+	static const size_t MaxSendLength = 510; // 512 minus the CRLF
+	static const size_t SendQueueSize = 256; // must be a power of 2
+	static const uint32_t FloodBurst = 5;
+	static const uint32_t FloodRefillTime = 2000;
+	static const uint32_t MinReconnectDelay = 2000;
+	static const uint32_t MaxReconnectDelay = 120000;
+	static const uint32_t ConnectTimeout = 30000;
+	static const uint32_t IdleTimeout = 300000; // servers ping every few minutes, if nothing's come in for this long the connection is dead
+
+	// all of these are called on the connection thread
+	typedef void(*RegisteredCallback)(void* param);
+	typedef void(*MessageCallback)(const IrcMessage& message, void* param);
+	typedef void(*DisconnectedCallback)(const std::string& reason, uint32_t reconnectDelay, void* param);
+
+	struct Callbacks
+	{
+		RegisteredCallback OnRegistered = nullptr; // welcome (001) received, channels can be joined now
+		MessageCallback OnMessage = nullptr;
+		DisconnectedCallback OnDisconnected = nullptr;
+		void* Param = nullptr;
+	};
+
+	explicit IrcClient(IrcEnvironment& environment);
+	~IrcClient();
+
+	// Starts connecting, the connection is kept up until Stop is called.
+	bool Start(const std::string& host, const std::string& port, const std::string& nick, const std::string& realName, const Callbacks& callbacks);
+
+	// Disconnects and waits for the connection thread to finish.
+	void Stop();
+
+	bool IsRunning() const { return running; }
+	bool IsRegistered() const { return registered; }
+
+	// Sets the nick used when registering, doesn't send anything.
+	void SetNick(const std::string& nick);
+
+	// Queues a line to be sent, anything after a CR/LF is cut off so nothing can sneak in extra commands.
+	// Returns false if it couldn't be queued (not registered or the queue is full).
+	bool Send(const std::string& line);
+
+private:
+	struct QueueEntry
+	{
+		std::atomic<size_t> Sequence;
+		char Line[MaxSendLength + 1];
+	};
+
+	QueueEntry queue[SendQueueSize];
+	std::atomic<size_t> enqueuePos;
+	size_t dequeuePos;
+
+	IrcEnvironment& environment;
+	std::atomic<bool> running;
+	std::atomic<bool> stopping;
+	std::atomic<bool> registered;
+	std::thread thread;
+
+	std::string host;
+	std::string port;
+	std::string realName;
+	Callbacks callbacks;
+
+	std::mutex nickLock;
+	std::string nick;
+
+	// only touched by the connection thread
+	IrcLineFramer framer;
+	IrcFloodControl flood;
+	std::string outgoing; // data that send() hasn't taken yet
+
+	void run();
+	void runConnection(std::string& error);
+	void handleLine(const std::string& line);
+	void sendNow(const std::string& line);
+	bool flushOutgoing(std::string& error);
+	bool hasQueued();
+	bool dequeue(std::string& line);
+	void clearQueue();
+	bool waitForStop(uint32_t timeout);
+};
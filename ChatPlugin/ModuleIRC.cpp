@@ -1,24 +1,13 @@
-#include <winsock2.h>
-#include <ws2tcpip.h>
 #include "ModuleIRC.hpp"
-#include <algorithm>
 
 Modules::ModuleIRC IRCModule;
 IUtils* PublicUtils;
 
 namespace
 {
-	void IRCConnect_impl()
-	{
-		IRCModule.Connect();
-	}
-
 	void CallbackIRCConnect(void* param)
 	{
-		if (IRCModule.Connected)
-			return;
-
-		CreateThread(0, 0, (LPTHREAD_START_ROUTINE)&IRCConnect_impl, 0, 0, 0);
+		IRCModule.Connect();
 	}
 
 	void CallbackServerStart(void* param)
@@ -31,9 +20,10 @@ namespace
 
 	void CallbackServerStop(void* param)
 	{
-		if (!IRCModule.GameChatChannel.empty())
+		auto gameChannel = IRCModule.GetGameChatChannel();
+		if (!gameChannel.empty())
 		{
-			IRCModule.ChannelLeave(IRCModule.GameChatChannel);
+			IRCModule.ChannelLeave(gameChannel);
 			// TODO5: kick everyone from the channel
 		}
 	}
@@ -54,8 +44,9 @@ namespace
 
 	void CallbackGameLeave(void* param)
 	{
-		if (!IRCModule.GameChatChannel.empty())
-			IRCModule.ChannelLeave(IRCModule.GameChatChannel);
+		auto gameChannel = IRCModule.GetGameChatChannel();
+		if (!gameChannel.empty())
+			IRCModule.ChannelLeave(gameChannel);
 	}
 
 	void CallbackPlayerChangeName(void* param)
@@ -71,36 +62,27 @@ namespace
 
 	void ChatMsgSend(const std::string& input, ConsoleBuffer* buffer)
 	{
-		std::string destChannel = !buffer->Name.compare("Global Chat") ? IRCModule.GlobalChatChannel : IRCModule.GameChatChannel;
-		if (destChannel.empty() || IRCModule.IRCNick.empty())
+		std::string destChannel = !buffer->Name.compare("Global Chat") ? IRCModule.GetGlobalChatChannel() : IRCModule.GetGameChatChannel();
+		std::string preparedLine = IRCModule.GetNick();
+		if (destChannel.empty() || preparedLine.empty())
 			return;
 
-		IRCModule.ChannelSendMsg(destChannel, input);
+		if (!IRCModule.ChannelSendMsg(destChannel, input))
+		{
+			buffer->PushLine("Error: not connected to IRC.");
+			return;
+		}
 
-		std::string preparedLine = IRCModule.IRCNick;
 		preparedLine = preparedLine.substr(preparedLine.find_first_of("|") + 1, std::string::npos);
 		preparedLine += ": ";
 		preparedLine += input;
 		buffer->PushLine(preparedLine);
 	}
-
-	std::vector<std::string>& split(const std::string& s, char delim, std::vector<std::string>& elems, bool keepDelimiter)
-	{
-		std::stringstream ss(s);
-		std::string item;
-		while (std::getline(ss, item, delim))
-			if (keepDelimiter)
-				elems.push_back(item + delim);
-			else
-				elems.push_back(item);
-
-		return elems;
-	}
 }
 
 namespace Modules
 {
-	ModuleIRC::ModuleIRC() : ModuleBase("IRC")
+	ModuleIRC::ModuleIRC() : ModuleBase("IRC"), client(ircEnvironment)
 	{
 		PublicUtils = utils;
 
@@ -132,133 +114,29 @@ namespace Modules
 
 	void ModuleIRC::Connect()
 	{
-		Connected = true;
+		// the client keeps reconnecting by itself once it's started
+		if (client.IsRunning())
+			return;
 
-		for (int i = 0; !initIRCChat(); i++)
+		std::string name;
+		commands->GetVariableString("Player.Name", name);
+		auto nick = GenerateIRCNick(name, Pointer(0x19AB730).Read<uint64_t>());
 		{
-			if (i >= 2)
-			{
-				globalBuffer->PushLine("Error: failed to connect to IRC.");
-				closesocket(winSocket);
-				Connected = false;
-				return;
-			}
-			else
-			{
-				globalBuffer->PushLine("Error: failed to connect to IRC. Retrying in 5 seconds.");
-				Sleep(5000);
-			}
+			std::lock_guard<std::mutex> lock(stateLock);
+			ircNick = nick;
 		}
 
-		for (int i = 0;; i++)
-		{
-			ircChatLoop();
-
-			if (i >= 2)
-			{
-				globalBuffer->PushLine("Error: failed to loop in IRC.");
-				break;
-			}
-			else
-			{
-				globalBuffer->PushLine("Error: failed to loop in IRC. Retrying in 5 seconds.");
-				Sleep(5000);
-			}
-		}
-		closesocket(winSocket);
-		Connected = false;
+		IrcClient::Callbacks callbacks;
+		callbacks.OnRegistered = onRegistered;
+		callbacks.OnMessage = onMessage;
+		callbacks.OnDisconnected = onDisconnected;
+		callbacks.Param = this;
+		client.Start(VarIRCServer->ValueString, VarIRCServerPort->ValueString, nick, "#ElDorito player", callbacks);
 	}
 
-	bool ModuleIRC::initIRCChat()
+	bool ModuleIRC::ChannelSendMsg(const std::string& channel, const std::string& line)
 	{
-		int retVal;
-
-		struct addrinfo hints, *ai;
-		memset(&hints, 0, sizeof(struct addrinfo));
-		hints.ai_family = AF_INET;
-		hints.ai_socktype = SOCK_STREAM;
-		hints.ai_protocol = IPPROTO_TCP;
-
-		if (retVal = getaddrinfo(VarIRCServer->ValueString.c_str(), VarIRCServerPort->ValueString.c_str(), &hints, &ai))
-		{
-			globalBuffer->PushLine("IRC GAI error: " + std::string(gai_strerrorA(retVal)) + " (" + std::to_string(retVal) + "/" + std::to_string(WSAGetLastError()) + ")");
-			return false;
-		}
-		winSocket = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
-		if (retVal = connect(winSocket, ai->ai_addr, ai->ai_addrlen))
-		{
-			globalBuffer->PushLine("IRC connect error: " + std::string(gai_strerrorA(retVal)) + " (" + std::to_string(retVal) + "/" + std::to_string(WSAGetLastError()) + ")");
-			return false;
-		}
-		freeaddrinfo(ai);
-
-		sprintf_s(buffer, "USER %s 0 * :#ElDorito player\r\n", IRCNick.c_str());
-		send(winSocket, buffer, strlen(buffer), 0);
-		commands->GetVariableString("Player.Name", IRCNick);
-		ChangeNick(IRCNick);
-		return true;
-	}
-
-	void ModuleIRC::ircChatLoop()
-	{
-		int inDataLength;
-
-		while ((inDataLength = recv(winSocket, buffer, 512, 0)) > 0) { // received a packet from IRC server
-			buffer[inDataLength] = '\0'; // recv function doesn't put a null-terminator character
-
-			std::vector<std::string> bufferSplitByNewLines;
-			split(buffer, '\n', bufferSplitByNewLines, true);
-
-			for (size_t i = 0; i < bufferSplitByNewLines.size(); i++)
-			{
-				// OutputDebugString(bufferSplitByNewLines.at(i).c_str()); // use this line to debug IRC backend
-
-				if (receivedPING(bufferSplitByNewLines.at(i)))
-				{
-					std::string sendBuffer = bufferSplitByNewLines.at(i);
-					sendBuffer[1] = 'O'; // modify PING to PONG
-					send(winSocket, sendBuffer.c_str(), strlen(sendBuffer.c_str()), 0);
-				}
-
-				std::vector<std::string> bufferSplitBySpace;
-				split(bufferSplitByNewLines.at(i), ' ', bufferSplitBySpace, false);
-
-				if (receivedWelcomeMessage(bufferSplitBySpace))
-				{
-					ChannelJoin(VarIRCGlobalChannel->ValueString, true);
-					globalBuffer->PushLine("Connected to global chat!");
-				}
-				else if (receivedChannelTopic(bufferSplitBySpace))
-				{
-					if (messageIsInChannel(bufferSplitBySpace, GlobalChatChannel, 3))
-					{
-						printMessageIntoBuffer(bufferSplitBySpace, globalBuffer, 4, true);
-					}
-				}
-				else if (receivedMessageFromIRCServer(bufferSplitBySpace))
-				{
-					if (messageIsInChannel(bufferSplitBySpace, GlobalChatChannel))
-						printMessageIntoBuffer(bufferSplitBySpace, globalBuffer);
-					else if (messageIsInChannel(bufferSplitBySpace, GameChatChannel))
-						printMessageIntoBuffer(bufferSplitBySpace, ingameBuffer);
-				}
-				else if (bufferSplitByNewLines.at(i).find("Erroneous Nickname") != std::string::npos)
-				{
-					globalBuffer->PushLine("Error: invalid username.");
-				}
-			}
-		}
-
-		int nError = WSAGetLastError();
-		std::string errorString("Winsock error code: ");
-		errorString.append(std::to_string(nError));
-		globalBuffer->PushLine(errorString);
-	}
-
-	void ModuleIRC::ChannelSendMsg(const std::string& channel, const std::string& line)
-	{
-		sprintf_s(buffer, "PRIVMSG %s :%s\r\n", channel.c_str(), line.c_str());
-		send(winSocket, buffer, strlen(buffer), 0);
+		return client.Send("PRIVMSG " + channel + " :" + line);
 	}
 
 	void ModuleIRC::ChannelJoin(const std::string& channel, bool globalChat)
@@ -266,101 +144,141 @@ namespace Modules
 		auto newChannel = utils->ToLower(channel);
 
 		if (globalChat)
-			GlobalChatChannel = newChannel;
+		{
+			std::lock_guard<std::mutex> lock(stateLock);
+			globalChatChannel = newChannel;
+		}
 		else
 		{
-			if (!GameChatChannel.empty())
-				ChannelLeave(GameChatChannel);
-			GameChatChannel = newChannel;
+			auto oldChannel = GetGameChatChannel();
+			if (!oldChannel.empty())
+				ChannelLeave(oldChannel);
+			{
+				std::lock_guard<std::mutex> lock(stateLock);
+				gameChatChannel = newChannel;
+			}
 			engine->SetActiveConsoleBuffer(ingameBuffer);
 			ingameBuffer->Visible = true;
 		}
 
-		sprintf_s(buffer, "MODE %s %s\r\nJOIN %s\r\n", IRCNick.c_str(), userMode.c_str(), newChannel.c_str());
-		send(winSocket, buffer, strlen(buffer), 0);
+		// if we aren't connected yet the channel gets joined once we are
+		joinChannel(newChannel);
 	}
 
 	void ModuleIRC::ChannelLeave(const std::string& channel)
 	{
 		auto newChannel = utils->ToLower(channel);
 
-		sprintf_s(buffer, "MODE %s %s\r\nPART %s\r\n", IRCNick.c_str(), userMode.c_str(), newChannel.c_str());
-		send(winSocket, buffer, strlen(buffer), 0);
-		GameChatChannel = "";
+		client.Send("MODE " + GetNick() + " " + userMode);
+		client.Send("PART " + newChannel);
+		{
+			std::lock_guard<std::mutex> lock(stateLock);
+			gameChatChannel = "";
+		}
 		engine->SetActiveConsoleBuffer(globalBuffer);
 		ingameBuffer->Visible = false;
 	}
 
 	void ModuleIRC::UserKick(const std::string& nick)
 	{
-		if (GameChatChannel.length() <= 0)
+		auto gameChannel = GetGameChatChannel();
+		if (gameChannel.length() <= 0)
 			return;
 
-		sprintf_s(buffer, "KICK %s %s\r\n", GameChatChannel.c_str(), nick.c_str());
-		send(winSocket, buffer, strlen(buffer), 0);
+		client.Send("KICK " + gameChannel + " " + nick);
 	}
 
 	void ModuleIRC::ChangeNick(const std::string& nick)
 	{
-		IRCNick = GenerateIRCNick(nick, Pointer(0x19AB730).Read<uint64_t>());
-		sprintf_s(buffer, "NICK %s\r\n", IRCNick.c_str());
-		send(winSocket, buffer, strlen(buffer), 0);
+		auto newNick = GenerateIRCNick(nick, Pointer(0x19AB730).Read<uint64_t>());
+		{
+			std::lock_guard<std::mutex> lock(stateLock);
+			ircNick = newNick;
+		}
+
+		// the client registers with this nick if it has to reconnect
+		client.SetNick(newNick);
+		client.Send("NICK " + newNick);
 	}
 
-	bool ModuleIRC::receivedWelcomeMessage(std::vector<std::string> &bufferSplitBySpace)
+	std::string ModuleIRC::GetGlobalChatChannel()
 	{
-		if (bufferSplitBySpace.size() <= 1)
-			return false;
-		return strncmp(bufferSplitBySpace.at(1).c_str(), "001", 3) == 0;
+		std::lock_guard<std::mutex> lock(stateLock);
+		return globalChatChannel;
 	}
 
-	bool ModuleIRC::receivedChannelTopic(std::vector<std::string> &bufferSplitBySpace)
+	std::string ModuleIRC::GetGameChatChannel()
 	{
-		if (bufferSplitBySpace.size() <= 1)
-			return false;
-		return strncmp(bufferSplitBySpace.at(1).c_str(), "332", 3) == 0;
+		std::lock_guard<std::mutex> lock(stateLock);
+		return gameChatChannel;
 	}
 
-	bool ModuleIRC::receivedMessageFromIRCServer(std::vector<std::string> &bufferSplitBySpace)
+	std::string ModuleIRC::GetNick()
 	{
-		if (bufferSplitBySpace.size() <= 1)
-			return false;
-		return strncmp(bufferSplitBySpace.at(1).c_str(), "PRIVMSG", 7) == 0;
+		std::lock_guard<std::mutex> lock(stateLock);
+		return ircNick;
 	}
 
-	bool ModuleIRC::receivedPING(const std::string& line)
+	void ModuleIRC::joinChannel(const std::string& channel)
 	{
-		return strncmp(line.c_str(), "PING ", 5) == 0;
+		client.Send("MODE " + GetNick() + " " + userMode);
+		client.Send("JOIN " + channel);
 	}
 
-	bool ModuleIRC::messageIsInChannel(std::vector<std::string> &bufferSplitBySpace, const std::string& channel, size_t channelPos)
+	bool ModuleIRC::isChannel(const std::string& name, const std::string& channel)
 	{
-		if (bufferSplitBySpace.size() <= channelPos)
-			return false;
-		std::transform(bufferSplitBySpace.at(channelPos).begin(), bufferSplitBySpace.at(channelPos).end(), bufferSplitBySpace.at(channelPos).begin(), ::tolower);
-		return strncmp(bufferSplitBySpace.at(channelPos).c_str(), channel.c_str(), channel.length()) == 0;
+		return !channel.empty() && utils->ToLower(name) == channel;
 	}
 
-	void ModuleIRC::printMessageIntoBuffer(std::vector<std::string> &bufferSplitBySpace, ConsoleBuffer* buffer, size_t msgPos, bool topic)
+	void ModuleIRC::printMessageIntoBuffer(const IrcMessage& message, ConsoleBuffer* buffer)
 	{
-		if (bufferSplitBySpace.size() <= msgPos)
-			return;
-		std::string buf(this->buffer);
-		std::string message = buf.substr(buf.find(bufferSplitBySpace.at(msgPos)), buf.length());
-		message.erase(0, 1); // remove first character ":"
-		message.resize(message.size() - 2); // remove last 2 characters "\n"
-		if (message.find("\r\n") != std::string::npos)
-			message = message.substr(0, message.find("\r\n"));
-
-		std::string preparedLineForUI = bufferSplitBySpace.at(0).substr(bufferSplitBySpace.at(0).find_first_of("|") + 1, std::string::npos);
-		preparedLineForUI = preparedLineForUI.substr(0, preparedLineForUI.find_first_of("!"));
-		preparedLineForUI += ": " + message;
-		if (topic)
-			preparedLineForUI = "Channel topic: " + message;
-
+		auto nick = message.GetNick();
+		std::string preparedLineForUI = nick.substr(nick.find_first_of("|") + 1, std::string::npos);
+		preparedLineForUI += ": " + message.GetParam(1);
 		buffer->PushLine(preparedLineForUI);
 	}
 
+	void ModuleIRC::onRegistered(void* param)
+	{
+		auto module = reinterpret_cast<ModuleIRC*>(param);
+		module->ChannelJoin(module->VarIRCGlobalChannel->ValueString, true);
+
+		// rejoin the game channel if the connection dropped while we were in one
+		auto gameChannel = module->GetGameChatChannel();
+		if (!gameChannel.empty())
+			module->joinChannel(gameChannel);
+
+		module->globalBuffer->PushLine("Connected to global chat!");
+	}
+
+	void ModuleIRC::onMessage(const IrcMessage& message, void* param)
+	{
+		auto module = reinterpret_cast<ModuleIRC*>(param);
+		if (message.Command == "332") // RPL_TOPIC: <nick> <channel> :<topic>
+		{
+			if (module->isChannel(message.GetParam(1), module->GetGlobalChatChannel()))
+				module->globalBuffer->PushLine("Channel topic: " + message.GetParam(2));
+		}
+		else if (message.Command == "PRIVMSG") // <target> :<text>
+		{
+			auto target = message.GetParam(0);
+			if (module->isChannel(target, module->GetGlobalChatChannel()))
+				module->printMessageIntoBuffer(message, module->globalBuffer);
+			else if (module->isChannel(target, module->GetGameChatChannel()))
+				module->printMessageIntoBuffer(message, module->ingameBuffer);
+		}
+		else if (message.Command == "432") // ERR_ERRONEUSNICKNAME
+		{
+			module->globalBuffer->PushLine("Error: invalid username.");
+		}
+	}
+
+	void ModuleIRC::onDisconnected(const std::string& reason, uint32_t reconnectDelay, void* param)
+	{
+		auto module = reinterpret_cast<ModuleIRC*>(param);
+		module->globalBuffer->PushLine("Error: lost connection to IRC (" + reason + "). Retrying in " + std::to_string((reconnectDelay + 999) / 1000) + " seconds.");
+	}
+
 	std::string ModuleIRC::GenerateIRCNick(const std::string& name, uint64_t uid)
 	{
 		std::string ircNick;
@@ -1,5 +1,7 @@
 #pragma once
+#include "IrcClient.hpp"
 #include <ElDorito/ElDorito.hpp>
+#include <mutex>
 
 namespace Modules
 {
@@ -9,24 +11,31 @@ namespace Modules
 		Command* VarIRCServer;
 		Command* VarIRCServerPort;
 		Command* VarIRCGlobalChannel;
-		std::string GlobalChatChannel = "";
-		std::string GameChatChannel = "";
-		bool Connected = false;
-		std::string IRCNick;
 
 		ModuleIRC();
 
 		void Connect();
 		void ChannelJoin(const std::string& channel, bool globalChat);
 		void ChannelLeave(const std::string& channel);
-		void ChannelSendMsg(const std::string& channel, const std::string& line);
+		bool ChannelSendMsg(const std::string& channel, const std::string& line);
 		void UserKick(const std::string& nick);
 		void ChangeNick(const std::string& nick);
 
 		std::string GenerateIRCNick(const std::string& name, uint64_t uid);
+
+		// the channels and nick get changed from the IRC thread as well, so these hand out copies
+		std::string GetGlobalChatChannel();
+		std::string GetGameChatChannel();
+		std::string GetNick();
+
 	private:
-		char buffer[513];
-		SOCKET winSocket;
+		WinIrcEnvironment ircEnvironment; // has to be before client
+		IrcClient client;
+		std::mutex stateLock;
+		std::string globalChatChannel;
+		std::string gameChatChannel;
+		std::string ircNick;
+
 		ConsoleBuffer* globalBuffer;
 		ConsoleBuffer* ingameBuffer;
 #ifdef _DEBUG
@@ -35,13 +44,12 @@ namespace Modules
 		std::string userMode = "+BIc";
 #endif
 
-		bool initIRCChat();
-		void ircChatLoop();
-		void printMessageIntoBuffer(std::vector<std::string>& bufferSplitBySpace, ConsoleBuffer* buffer, size_t msgPos = 3, bool topic = false);
-		bool messageIsInChannel(std::vector<std::string>& bufferSplitBySpace, const std::string& channel, size_t channelPos = 2);
-		bool receivedPING(const std::string& line);
-		bool receivedMessageFromIRCServer(std::vector<std::string>& bufferSplitBySpace);
-		bool receivedWelcomeMessage(std::vector<std::string>& bufferSplitBySpace);
-		bool receivedChannelTopic(std::vector<std::string>& bufferSplitBySpace);
+		void joinChannel(const std::string& channel);
+		bool isChannel(const std::string& name, const std::string& channel);
+		void printMessageIntoBuffer(const IrcMessage& message, ConsoleBuffer* buffer);
+
+		static void onRegistered(void* param);
+		static void onMessage(const IrcMessage& message, void* param);
+		static void onDisconnected(const std::string& reason, uint32_t reconnectDelay, void* param);
 	};
 }
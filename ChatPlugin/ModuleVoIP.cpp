@@ -10,120 +10,64 @@ Modules::ModuleVoIP VoipModule;
 
 namespace
 {
-	bool VariablePushToTalkUpdate(const std::vector<std::string>& Arguments, std::string& returnInfo)
+	// Hands the current values of the VoIP variables to the client, which only applies them if something actually changed.
+	void UpdateSettings()
 	{
-		unsigned int error;
-		uint64 scHandlerID = VoIPGetscHandlerID();
-		if (scHandlerID != NULL)
-			if (VoipModule.VarVoIPPushToTalk->ValueInt == 0)
-			{
-				if ((error = ts3client_setPreProcessorConfigValue(scHandlerID, "vad", "true")) != ERROR_ok)
-				{
-					returnInfo = "Error setting voice activation detection. Error: " + std::to_string(error);
-					return false;
-				}
-
-				if ((error = ts3client_setPreProcessorConfigValue(scHandlerID, "voiceactivation_level", VoipModule.VarVoIPVADLevel->ValueString.c_str())) != ERROR_ok)
-				{
-					returnInfo = "Error setting voice activation level. Error: " + std::to_string(error);
-					return false;
-				}
-
-				if ((error = ts3client_setClientSelfVariableAsInt(scHandlerID, CLIENT_INPUT_DEACTIVATED, INPUT_ACTIVE)) != ERROR_ok)
-				{
-					char* errorMsg;
-					if (ts3client_getErrorMessage(error, &errorMsg) != ERROR_ok)
-						ts3client_freeMemory(errorMsg);
-					else
-						returnInfo = errorMsg;
-					return false;
-				}
-
-				if (ts3client_flushClientSelfUpdates(scHandlerID, NULL) != ERROR_ok)
-				{
-					char* errorMsg;
-					if (ts3client_getErrorMessage(error, &errorMsg) != ERROR_ok)
-						ts3client_freeMemory(errorMsg);
-					else
-						returnInfo = errorMsg;
-					return false;
-				}
-			}
-			else
-			{
-				if ((error = ts3client_setPreProcessorConfigValue(scHandlerID, "vad", "false")) != ERROR_ok)
-				{
-					returnInfo = "Error setting voice activation detection. Error: " + std::to_string(error);
-					return false;
-				}
-
-				if ((error = ts3client_setPreProcessorConfigValue(scHandlerID, "voiceactivation_level", "-50")) != ERROR_ok)
-				{
-					returnInfo = "Error setting voice activation level. Error: " + std::to_string(error);
-					return false;
-				}
-			}
+		VoIPSettings settings;
+		settings.PushToTalk = VoipModule.VarVoIPPushToTalk->ValueInt != 0;
+		settings.Talking = VoipModule.VarVoIPTalk->ValueInt != 0;
+		settings.Muted = VoipModule.VarVoIPMuted->ValueInt != 0;
+		settings.VolumeModifier = static_cast<int>(VoipModule.VarVoIPVolumeModifier->ValueInt);
+		settings.VoiceActivationLevel = VoipModule.VarVoIPVADLevel->ValueFloat;
+		settings.AGC = VoipModule.VarVoIPAGC->ValueInt != 0;
+		settings.EchoCancellation = VoipModule.VarVoIPEchoCancellation->ValueInt != 0;
+		VoIPUpdateSettings(settings);
+	}
 
+	bool VariablePushToTalkUpdate(const std::vector<std::string>& Arguments, std::string& returnInfo)
+	{
+		UpdateSettings();
 		returnInfo = VoipModule.VarVoIPPushToTalk->ValueInt ? "Enabled VoIP PushToTalk, disabled voice activation detection" : "Disabled VoIP PushToTalk, enabled voice activation detection.";
 		return true;
 	}
 
-	bool VariableVolumeModifierUpdate(const std::vector<std::string>& Arguments, std::string& returnInfo)
+	bool VariableTalkUpdate(const std::vector<std::string>& Arguments, std::string& returnInfo)
+	{
+		UpdateSettings();
+		return true;
+	}
+
+	bool VariableMutedUpdate(const std::vector<std::string>& Arguments, std::string& returnInfo)
 	{
-		unsigned int error;
-		uint64 scHandlerID = VoIPGetscHandlerID();
-		if (scHandlerID != NULL)
-			if ((error = ts3client_setPlaybackConfigValue(scHandlerID, "volume_modifier", VoipModule.VarVoIPVolumeModifier->ValueString.c_str())) != ERROR_ok)
-			{
-				returnInfo = "Unable to set volume modifier, are you connected to a server? Error: " + std::to_string(error);
-				return false;
-			}
+		UpdateSettings();
+		returnInfo = VoipModule.VarVoIPMuted->ValueInt ? "Muted VoIP microphone" : "Unmuted VoIP microphone";
+		return true;
+	}
 
+	bool VariableVolumeModifierUpdate(const std::vector<std::string>& Arguments, std::string& returnInfo)
+	{
+		UpdateSettings();
 		returnInfo = "Set VoIP Volume Modifier to " + VoipModule.VarVoIPVolumeModifier->ValueString;
 		return true;
 	}
 
 	bool VariableAGCUpdate(const std::vector<std::string>& Arguments, std::string& returnInfo)
 	{
-		unsigned int error;
-		uint64 scHandlerID = VoIPGetscHandlerID();
-		if (scHandlerID != NULL)
-			if ((error = ts3client_setPreProcessorConfigValue(scHandlerID, "agc", VoipModule.VarVoIPAGC->ValueInt ? "true" : "false")) != ERROR_ok)
-			{
-				returnInfo = "Unable to set Automatic Gain Control, are you connected to a server? Error: " + std::to_string(error);
-				return false;
-			}
-
+		UpdateSettings();
 		returnInfo = VoipModule.VarVoIPAGC->ValueInt ? "Enabled VoIP automatic gain control" : "Disabled VoIP automatic gain control";
 		return true;
 	}
 
 	bool VariableEchoCancellationUpdate(const std::vector<std::string>& Arguments, std::string& returnInfo)
 	{
-		unsigned int error;
-		uint64 scHandlerID = VoIPGetscHandlerID();
-		if (scHandlerID != NULL)
-			if ((error = ts3client_setPreProcessorConfigValue(scHandlerID, "echo_canceling", VoipModule.VarVoIPEchoCancellation->ValueInt ? "true" : "false")) != ERROR_ok)
-			{
-				returnInfo = "Unable to set echo cancellation. Error: " + std::to_string(error);
-				return false;
-			}
-
+		UpdateSettings();
 		returnInfo = VoipModule.VarVoIPEchoCancellation->ValueInt ? "Enabled VoIP echo cancellation" : "Disabled VoIP echo cancellation";
 		return true;
 	}
 
 	bool VariableVADLevelUpdate(const std::vector<std::string>& Arguments, std::string& returnInfo)
 	{
-		unsigned int error;
-		uint64 scHandlerID = VoIPGetscHandlerID();
-		if (scHandlerID != NULL)
-			if ((error = ts3client_setPreProcessorConfigValue(scHandlerID, "voiceactivation_level", VoipModule.VarVoIPVADLevel->ValueString.c_str())) != ERROR_ok)
-			{
-				returnInfo = "Error setting voice activation level. Error: " + std::to_string(error);
-				return false;
-			}
-
+		UpdateSettings();
 		returnInfo = "Set voice activation level to " + VoipModule.VarVoIPVADLevel->ValueString;
 		return true;
 	}
@@ -142,9 +86,8 @@ namespace
 	bool isServer = false;
 	DWORD __stdcall StartClient(LPVOID)
 	{
-		if (isServer)
-			while (!IsTeamspeakServerRunning())
-				Sleep(1000); // wait for server to finish starting
+		if (isServer && !WaitForTeamspeakServer())
+			return 1; // the server failed to start (or was stopped first), so there's nothing to connect to
 
 		return StartTeamspeakClient(&VoipModule);
 	}
@@ -163,6 +106,13 @@ namespace
 		isServer = false;
 	}
 
+	bool CommandRecord(const std::vector<std::string>& Arguments, std::string& returnInfo)
+	{
+		uint64_t maxBytes = static_cast<uint64_t>(VoipModule.VarVoIPRecordMaxSize->ValueInt) * 1024 * 1024;
+		uint32_t maxSeconds = static_cast<uint32_t>(VoipModule.VarVoIPRecordMaxLength->ValueInt) * 60;
+		return VoIPToggleRecording(maxBytes, maxSeconds, returnInfo);
+	}
+
 	// TODO5: kick players from TS
 	/*void CallbackServerPlayerKick(void* param)
 	{
@@ -181,6 +131,8 @@ namespace
 		isServer = true;
 
 		// Start the Teamspeak VoIP Server since this is the host
+		// it's marked as starting before either thread is created so the client knows to wait for it
+		MarkTeamspeakServerStarting();
 		CreateThread(0, 0, StartServer, 0, 0, 0);
 
 		// Join the Teamspeak VoIP Server so the host can talk
@@ -235,8 +187,22 @@ namespace Modules
 		VarVoIPServerPort->ValueIntMin = 0;
 		VarVoIPServerPort->ValueIntMax = 0xFFFF;
 
-		VarVoIPTalk = AddVariableInt("Talk", "voip_Talk", "Enables or disables talking (for push to talk)", eCommandFlagsNone, 0);
+		VarVoIPTalk = AddVariableInt("Talk", "voip_Talk", "Enables or disables talking (for push to talk)", eCommandFlagsNone, 0, VariableTalkUpdate);
 		VarVoIPTalk->ValueIntMin = 0;
 		VarVoIPTalk->ValueIntMax = 1;
+
+		VarVoIPMuted = AddVariableInt("Muted", "voip_muted", "Mutes or unmutes your microphone", eCommandFlagsNone, 0, VariableMutedUpdate);
+		VarVoIPMuted->ValueIntMin = 0;
+		VarVoIPMuted->ValueIntMax = 1;
+
+		VarVoIPRecordMaxSize = AddVariableInt("RecordMaxSize", "voip_record_maxsize", "The size (in MB) a VoIP recording can reach before it carries on in a new file, 0 for no limit", eCommandFlagsArchived, 100);
+		VarVoIPRecordMaxSize->ValueIntMin = 0;
+		VarVoIPRecordMaxSize->ValueIntMax = 4095;
+
+		VarVoIPRecordMaxLength = AddVariableInt("RecordMaxLength", "voip_record_maxlength", "The length (in minutes) a VoIP recording can reach before it carries on in a new file, 0 for no limit", eCommandFlagsArchived, 30);
+		VarVoIPRecordMaxLength->ValueIntMin = 0;
+		VarVoIPRecordMaxLength->ValueIntMax = 1440;
+
+		AddCommand("Record", "voip_record", "Starts or stops recording VoIP to recordedvoices-*.wav", eCommandFlagsNone, CommandRecord);
 	}
 }
\ No newline at end of file
@@ -14,6 +14,9 @@ namespace Modules
 		Command* VarVoIPServerEnabled;
 		Command* VarVoIPServerPort;
 		Command* VarVoIPTalk;
+		Command* VarVoIPMuted;
+		Command* VarVoIPRecordMaxSize;
+		Command* VarVoIPRecordMaxLength;
 
 		ModuleVoIP();
 	};
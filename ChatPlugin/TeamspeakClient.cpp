@@ -33,6 +33,7 @@
 IEngine* engine = nullptr;
 
 #include "TeamspeakClient.hpp"
+#include "VoiceRecorder.hpp"
 #include <cstdint>
 #define DEFAULT_VIRTUAL_SERVER 1
 #define NAME_BUFSIZE 1024
@@ -49,15 +50,57 @@ IEngine* engine = nullptr;
 #endif
 
 
-bool VoIPClientRunning = false;
+/* Records the mixed playback to wav files, the audio callback only hands it samples, the file writing happens on its own thread */
+WinVoiceRecorderEnvironment voiceRecorderEnvironment; // has to be before voiceRecorder
+VoiceRecorder voiceRecorder(voiceRecorderEnvironment);
 
+uint64 scHandlerID;
 
-/* This is a global variable to indicate if sound needs to be recorded.
-Normally one would have thread synchronization with locks etc. for
-thread safety. In the intterest of simplicity, this sample uses the
-most simple way to safely record, using this variable
-*/
-int recordSound = 0;
+/* Applies VoIP settings to the client lib for VoIPState */
+class TeamspeakBackend : public VoIPBackend
+{
+public:
+	unsigned int SetInputActive(bool active) override
+	{
+		return ts3client_setClientSelfVariableAsInt(scHandlerID, CLIENT_INPUT_DEACTIVATED, active ? INPUT_ACTIVE : INPUT_DEACTIVATED);
+	}
+
+	unsigned int SetInputMuted(bool muted) override
+	{
+		return ts3client_setClientSelfVariableAsInt(scHandlerID, CLIENT_INPUT_MUTED, muted ? MUTEINPUT_MUTED : MUTEINPUT_NONE);
+	}
+
+	unsigned int FlushSelfUpdates() override
+	{
+		return ts3client_flushClientSelfUpdates(scHandlerID, NULL);
+	}
+
+	unsigned int SetVolumeModifier(int volume) override
+	{
+		return ts3client_setPlaybackConfigValue(scHandlerID, "volume_modifier", std::to_string(volume).c_str());
+	}
+
+	unsigned int SetVoiceActivation(bool enabled, float level) override
+	{
+		unsigned int error;
+		if ((error = ts3client_setPreProcessorConfigValue(scHandlerID, "vad", enabled ? "true" : "false")) != ERROR_ok)
+			return error;
+		return ts3client_setPreProcessorConfigValue(scHandlerID, "voiceactivation_level", std::to_string(level).c_str());
+	}
+
+	unsigned int SetAGC(bool enabled) override
+	{
+		return ts3client_setPreProcessorConfigValue(scHandlerID, "agc", enabled ? "true" : "false");
+	}
+
+	unsigned int SetEchoCancellation(bool enabled) override
+	{
+		return ts3client_setPreProcessorConfigValue(scHandlerID, "echo_canceling", enabled ? "true" : "false");
+	}
+} teamspeakBackend;
+
+/* The settings the client should be using, the client loop sleeps until they change instead of setting everything every 100ms */
+VoIPState voipState(&teamspeakBackend);
 
 /* For voice activation detection demo */
 uint64 vadTestscHandlerID;
@@ -81,28 +124,6 @@ INT VoIPGetTalkStatus()
 * Please note that you have to do the same on the server demo too */
 /* #define CUSTOM_PASSWORDS */
 
-/* a struct used for sound recording */
-struct WaveHeader {
-	/* Riff chunk */
-	char riffId[4];
-	unsigned int len;
-	char riffType[4];
-
-	/* Format chunk */
-	char fmtId[4];  // 'fmt '
-	unsigned int fmtLen;
-	unsigned short formatTag;
-	unsigned short channels;
-	unsigned int samplesPerSec;
-	unsigned int avgBytesPerSec;
-	unsigned short blockAlign;
-	unsigned short bitsPerSample;
-
-	/* Data chunk */
-	char dataId[4];  // 'data'
-	unsigned int dataLen;
-};
-
 /*
 * Callback for connection status change.
 * Connection status switches through the states STATUS_DISCONNECTED, STATUS_CONNECTING, STATUS_CONNECTED and STATUS_CONNECTION_ESTABLISHED.
@@ -384,12 +405,13 @@ void onCustomPacketDecryptEvent(char** dataReceived, unsigned int* dataReceivedS
 * undefined. This is more efficient for mixing.
 * This implementation will record sound to a 2 channel (stereo) wave file. This sample assumes there is only
 * 1 connection to a server
-* Hint: Normally you would want to defer the writing to an other thread because this callback is very time sensitive
+* The samples are mixed down into a small buffer on the stack and handed to voiceRecorder, which does the file writing on its
+* own thread, so nothing here allocates or touches the disk
 */
 void onEditMixedPlaybackVoiceDataEvent(uint64 serverConnectionHandlerID, short* samples, int sampleCount, int channels, const unsigned int* channelSpeakerArray, unsigned int* channelFillMask){
 #define OUTPUTCHANNELS 2
-	static FILE *pfile = NULL;
-	static struct WaveHeader header = { { 'R', 'I', 'F', 'F' }, 0, { 'W', 'A', 'V', 'E' }, { 'f', 'm', 't', ' ' }, 16, 1, 2, 48000, 48000 * (16 / 2) * 2, (16 / 2) * 2, 16, { 'd', 'a', 't', 'a' }, 0 };
+#define MIXCHUNKSAMPLES 1024
+	short outputBuffer[MIXCHUNKSAMPLES * OUTPUTCHANNELS]; /*mixed samples waiting to be handed to the recorder*/
 
 	int currentSampleMix[OUTPUTCHANNELS]; /*a per channel/sample mix buffer*/
 	int channelCount[OUTPUTCHANNELS] = { 0, 0 }; /*how many input channels does the output channel contain */
@@ -397,35 +419,18 @@ void onEditMixedPlaybackVoiceDataEvent(uint64 serverConnectionHandlerID, short*
 	int currentInChannel;
 	int currentOutChannel;
 	int currentSample;
+	int chunkStart;
+	int chunkSamples;
 
 	/*for clipping*/
 	short shortval;
 	int   intval;
 
-	short* outputBuffer;
-
 	int leftChannelMask = SPEAKER_FRONT_LEFT | SPEAKER_FRONT_CENTER | SPEAKER_BACK_LEFT | SPEAKER_FRONT_LEFT_OF_CENTER | SPEAKER_BACK_CENTER | SPEAKER_SIDE_LEFT | SPEAKER_TOP_CENTER | SPEAKER_TOP_FRONT_LEFT | SPEAKER_TOP_FRONT_CENTER | SPEAKER_TOP_BACK_LEFT | SPEAKER_TOP_BACK_CENTER;
 	int rightChannelMask = SPEAKER_FRONT_RIGHT | SPEAKER_FRONT_CENTER | SPEAKER_BACK_RIGHT | SPEAKER_FRONT_RIGHT_OF_CENTER | SPEAKER_BACK_CENTER | SPEAKER_SIDE_RIGHT | SPEAKER_TOP_CENTER | SPEAKER_TOP_FRONT_RIGHT | SPEAKER_TOP_FRONT_CENTER | SPEAKER_TOP_BACK_RIGHT | SPEAKER_TOP_BACK_CENTER;
 
-	/*detect state changes*/
-	if (recordSound && (pfile == NULL)){
-		/*start recording*/
-		header.len = 0;
-		header.dataLen = 0;
-		if ((pfile = fopen("recordedvoices.wav", "wb")) == NULL) return;
-		fwrite(&header, sizeof(struct WaveHeader), 1, pfile);
-	}
-	else if (!recordSound && (pfile != NULL)){
-		/*stop recording*/
-		header.len = sizeof(struct WaveHeader) + header.dataLen - 8;
-		fseek(pfile, 0, SEEK_SET);
-		fwrite(&header, sizeof(struct WaveHeader), 1, pfile);
-		fclose(pfile);
-		pfile = NULL;
-	}
-
 	/*if there is nothing to do, quit*/
-	if (pfile == NULL || sampleCount == 0 || channels == 0) return;
+	if (!voiceRecorder.IsRecording() || sampleCount == 0 || channels == 0) return;
 
 	/* initialize channel mixing */
 	currentInChannel = 0;
@@ -439,44 +444,42 @@ void onEditMixedPlaybackVoiceDataEvent(uint64 serverConnectionHandlerID, short*
 		}
 	}
 
-	/*get the outbut buffer*/
-	outputBuffer = (short*)malloc(sizeof(short)*sampleCount * 2 /*output channels*/);
-
 	/* hint: if channelCount is 0 for all channels, we could write a zero buffer and quit here */
 
-	/*mix the samples*/
-	for (currentSample = 0; currentSample < sampleCount; currentSample++){
-		currentSampleMix[0] = currentSampleMix[1] = 0;
+	for (chunkStart = 0; chunkStart < sampleCount; chunkStart += chunkSamples){
+		chunkSamples = sampleCount - chunkStart;
+		if (chunkSamples > MIXCHUNKSAMPLES) chunkSamples = MIXCHUNKSAMPLES;
 
-		/*loop over all channels in this frame */
-		for (currentInChannel = 0; currentInChannel < channels; currentInChannel++){
-			if ((channelSpeakerArray[currentInChannel] & leftChannelMask) != 0) currentSampleMix[0] += samples[(currentSample*channels) + currentInChannel];
-			if ((channelSpeakerArray[currentInChannel] & rightChannelMask) != 0) currentSampleMix[1] += samples[(currentSample*channels) + currentInChannel];
-		}
+		/*mix the samples*/
+		for (currentSample = 0; currentSample < chunkSamples; currentSample++){
+			currentSampleMix[0] = currentSampleMix[1] = 0;
 
-		/*collected all samples, store mixed sample */
-		for (currentOutChannel = 0; currentOutChannel < OUTPUTCHANNELS; currentOutChannel++){
-			if (channelCount[currentOutChannel] == 0){
-				outputBuffer[(currentSample*OUTPUTCHANNELS) + currentOutChannel] = 0;
+			/*loop over all channels in this frame */
+			for (currentInChannel = 0; currentInChannel < channels; currentInChannel++){
+				if ((channelSpeakerArray[currentInChannel] & leftChannelMask) != 0) currentSampleMix[0] += samples[((chunkStart + currentSample)*channels) + currentInChannel];
+				if ((channelSpeakerArray[currentInChannel] & rightChannelMask) != 0) currentSampleMix[1] += samples[((chunkStart + currentSample)*channels) + currentInChannel];
 			}
-			else {
-				/*clip*/
-				intval = currentSampleMix[currentOutChannel] / channelCount[currentOutChannel];
-				if (intval >= SHRT_MAX) shortval = SHRT_MAX;
-				else if (intval <= SHRT_MIN) shortval = SHRT_MIN;
-				else shortval = (short)intval;
-				/*store*/
-				outputBuffer[(currentSample*OUTPUTCHANNELS) + currentOutChannel] = shortval;
+
+			/*collected all samples, store mixed sample */
+			for (currentOutChannel = 0; currentOutChannel < OUTPUTCHANNELS; currentOutChannel++){
+				if (channelCount[currentOutChannel] == 0){
+					outputBuffer[(currentSample*OUTPUTCHANNELS) + currentOutChannel] = 0;
+				}
+				else {
+					/*clip*/
+					intval = currentSampleMix[currentOutChannel] / channelCount[currentOutChannel];
+					if (intval >= SHRT_MAX) shortval = SHRT_MAX;
+					else if (intval <= SHRT_MIN) shortval = SHRT_MIN;
+					else shortval = (short)intval;
+					/*store*/
+					outputBuffer[(currentSample*OUTPUTCHANNELS) + currentOutChannel] = shortval;
+				}
 			}
 		}
-	}
-
-	/*write data & update header */
-	fwrite(outputBuffer, sampleCount*sizeof(short)*OUTPUTCHANNELS, 1, pfile);
-	header.dataLen += sampleCount*sizeof(short)*OUTPUTCHANNELS;
 
-	/*free buffer*/
-	free(outputBuffer);
+		/*queue it up for the recorder's thread to write*/
+		voiceRecorder.Write(outputBuffer, chunkSamples);
+	}
 }
 
 #ifdef CUSTOM_PASSWORDS
@@ -1038,35 +1041,6 @@ void configureMicrophone() {
 		}
 	}
 
-void toggleRecordSound(uint64 serverConnectionHandlerID){
-	unsigned int error;
-
-	if (!recordSound){
-		recordSound = 1;
-		if ((error = ts3client_startVoiceRecording(serverConnectionHandlerID)) != ERROR_ok){
-			char* errormsg;
-			if (ts3client_getErrorMessage(error, &errormsg) == ERROR_ok) {
-				printf("Error notifying server of startVoiceRecording: %s\n", errormsg);
-				ts3client_freeMemory(errormsg);
-				return;
-			}
-		}
-		printf("Started recording sound to wav\n");
-	}
-	else {
-		recordSound = 0;
-		if ((error = ts3client_stopVoiceRecording(serverConnectionHandlerID)) != ERROR_ok){
-			char* errormsg;
-			if (ts3client_getErrorMessage(error, &errormsg) == ERROR_ok) {
-				printf("Error notifying server of stopVoiceRecording: %s\n", errormsg);
-				ts3client_freeMemory(errormsg);
-				return;
-			}
-		}
-		printf("Stopped recording sound to wav\n");
-	}
-}
-
 int readIdentity(char* identity) {
 	FILE *file;
 
@@ -1139,13 +1113,44 @@ bool VoIPKeyPressed(int key) {
 	return ((GetAsyncKeyState(key) & 0x8000) != 0);
 }
 
-uint64 scHandlerID;
-
 UINT64 VoIPGetscHandlerID()
 {
 	return scHandlerID;
 }
 
+void VoIPUpdateSettings(const VoIPSettings& settings)
+{
+	voipState.Set(settings);
+}
+
+bool VoIPToggleRecording(uint64_t maxFileBytes, uint32_t maxFileSeconds, std::string& returnInfo){
+	unsigned int error;
+
+	if (!voiceRecorder.IsRecording()){
+		if (!voiceRecorder.Start("recordedvoices", maxFileBytes, maxFileSeconds, returnInfo))
+			return false;
+
+		/* let everyone else know they're being recorded */
+		if (scHandlerID && (error = ts3client_startVoiceRecording(scHandlerID)) != ERROR_ok)
+			returnInfo = "Error notifying server of startVoiceRecording: " + std::to_string(error) + "\n";
+
+		returnInfo += "Started recording VoIP to " + voiceRecorder.GetCurrentFile();
+	}
+	else {
+		voiceRecorder.Stop();
+		if (scHandlerID && (error = ts3client_stopVoiceRecording(scHandlerID)) != ERROR_ok)
+			returnInfo = "Error notifying server of stopVoiceRecording: " + std::to_string(error) + "\n";
+
+		auto stats = voiceRecorder.GetStats();
+		returnInfo += "Stopped recording VoIP, wrote " + std::to_string(stats.FramesWritten / VoiceRecorder::SampleRate) + " seconds to " + std::to_string(stats.FilesWritten) + " file(s)";
+		if (stats.Overruns)
+			returnInfo += ", dropped " + std::to_string(stats.FramesDropped) + " samples (" + std::to_string(stats.Overruns) + " overruns)";
+		if (stats.WriteErrors)
+			returnInfo += ", " + std::to_string(stats.WriteErrors) + " write errors";
+	}
+	return true;
+}
+
 DWORD WINAPI StartTeamspeakClient(Modules::ModuleVoIP* voipModule)
 {
 	unsigned int error;
@@ -1153,7 +1158,6 @@ DWORD WINAPI StartTeamspeakClient(Modules::ModuleVoIP* voipModule)
 	char** device;
 	char *version;
 	char identity[IDENTITY_BUFSIZE];
-	short abort = 0;
 
 	if (engine == nullptr)
 	{
@@ -1165,6 +1169,10 @@ DWORD WINAPI StartTeamspeakClient(Modules::ModuleVoIP* voipModule)
 
 	if (engine != nullptr)
 		engine->PrintToConsole("Starting VoIP client...");
+
+	/* Everything needs applying to the new connection */
+	voipState.Reset();
+
 	/* Create struct for callback function pointers */
 	struct ClientUIFunctions funcs;
 
@@ -1354,98 +1362,18 @@ DWORD WINAPI StartTeamspeakClient(Modules::ModuleVoIP* voipModule)
 
 	SLEEP(300);
 
-	//Sets the VoIP volume
-	if ((error = ts3client_setPlaybackConfigValue(scHandlerID, "volume_modifier", voipModule->VarVoIPVolumeModifier->ValueString.c_str())) != ERROR_ok)
-	{
-		if (engine != nullptr)
-			engine->PrintToConsole("Error toggling VoIP agc: " + std::to_string(error));
-	}
-	//Sets Automatic Gain Control
-	if ((error = ts3client_setPreProcessorConfigValue(scHandlerID, "agc", voipModule->VarVoIPAGC->ValueInt ? "true" : "false")) != ERROR_ok)
-	{
-		if (engine != nullptr)
-			engine->PrintToConsole("Error toggling VoIP agc: " + std::to_string(error));
-	}
-	//Sets Echo Cancelling
-	if ((error = ts3client_setPreProcessorConfigValue(scHandlerID, "echo_canceling", voipModule->VarVoIPEchoCancellation->ValueInt ? "true" : "false")) != ERROR_ok)
-	{
-		if (engine != nullptr)
-			engine->PrintToConsole("Error toggling VoIP echo_canceling: " + std::to_string(error));
-	}
-
-	//Sets Voice activation detection
-	if ((error = ts3client_setPreProcessorConfigValue(scHandlerID, "vad", voipModule->VarVoIPPushToTalk->ValueInt ? "true" : "false")) != ERROR_ok)
-	{
-		if (engine != nullptr)
-			engine->PrintToConsole("Error toggling VoIP VAD: " + std::to_string(error));
-	}
+	/* Apply the settings, and then again whenever they change until StopTeamspeakClient is called */
+	/* If anything fails it gets retried after a second */
+	for (;;) {
+		std::string applyError;
+		bool applied = voipState.Apply(applyError);
+		if (!applied && engine != nullptr)
+			engine->PrintToConsole("Error applying VoIP settings: " + applyError);
 
-	if ((error = ts3client_setPreProcessorConfigValue(scHandlerID, "voiceactivation_level", voipModule->VarVoIPPushToTalk->ValueInt ? "-50" : voipModule->VarVoIPVADLevel->ValueString.c_str())) != ERROR_ok)
-	{
-		if (engine != nullptr)
-			engine->PrintToConsole("Error setting VoIP VAD level: " + std::to_string(error));
+		if (!voipState.Wait(applied ? 0 : 1000))
+			break;
 	}
 
-	VoIPClientRunning = true;
-
-	while (!abort) {
-		//BEGIN PUSH TO TALK
-		//TODO: only actually change these if something has changed instead of calling the functions all the time.
-		if (voipModule->VarVoIPPushToTalk->ValueInt == 1)
-		{
-			if ((error = ts3client_setClientSelfVariableAsInt(scHandlerID, CLIENT_INPUT_DEACTIVATED, voipModule->VarVoIPTalk->ValueInt ? INPUT_ACTIVE : INPUT_DEACTIVATED)) != ERROR_ok)
-			{
-				char* errorMsg;
-				if (ts3client_getErrorMessage(error, &errorMsg) != ERROR_ok)
-				{
-					if (engine != nullptr)
-						engine->PrintToConsole("Error toggling push-to-talk: " + std::string(errorMsg));
-					ts3client_freeMemory(errorMsg);
-				}
-			}
-
-			if (ts3client_flushClientSelfUpdates(scHandlerID, NULL) != ERROR_ok)
-			{
-				char* errorMsg;
-				if (ts3client_getErrorMessage(error, &errorMsg) != ERROR_ok)
-				{
-					if (engine != nullptr)
-						engine->PrintToConsole("Error flushing after toggling push-to-talk: " + std::string(errorMsg));
-					ts3client_freeMemory(errorMsg);
-				}
-			}
-		}
-		else
-		{
-			if ((error = ts3client_setClientSelfVariableAsInt(scHandlerID, CLIENT_INPUT_DEACTIVATED, INPUT_ACTIVE)) != ERROR_ok)
-			{
-				char* errorMsg;
-				if (ts3client_getErrorMessage(error, &errorMsg) != ERROR_ok)
-				{
-					if (engine != nullptr)
-						engine->PrintToConsole("Error toggling push-to-talk: " + std::string(errorMsg));
-					ts3client_freeMemory(errorMsg);
-				}
-			}
-
-			if (ts3client_flushClientSelfUpdates(scHandlerID, NULL) != ERROR_ok)
-			{
-				char* errorMsg;
-				if (ts3client_getErrorMessage(error, &errorMsg) != ERROR_ok)
-				{
-					if (engine != nullptr)
-						engine->PrintToConsole("Error flushing after toggling push-to-talk: " + std::string(errorMsg));
-					ts3client_freeMemory(errorMsg);
-				}
-			}
-		}
-		//END PUSH TO TALK
-
-		SLEEP(100);
-		if (!VoIPClientRunning){
-			abort = true;
-		}
-	}
 	/* Simple commandline interface */
 	/*
 	TODO: Implement the teamspeak stuff into an in game d3d gui.
@@ -1550,15 +1478,14 @@ DWORD WINAPI StartTeamspeakClient(Modules::ModuleVoIP* voipModule)
 		return 1;
 	}
 
-	/* This is a small hack, to close an open recording sound file */
-	recordSound = 0;
-	onEditMixedPlaybackVoiceDataEvent(DEFAULT_VIRTUAL_SERVER, NULL, 0, 0, NULL, NULL);
+	/* Finish off any recording that was still going */
+	voiceRecorder.Stop();
 	if (engine != nullptr)
 		engine->PrintToConsole("Stopped VoIP client");
 	return 0;
 }
 
 void StopTeamspeakClient(){
-	VoIPClientRunning = false;
+	voipState.Interrupt();
 	return;
 }
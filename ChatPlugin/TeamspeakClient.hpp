@@ -1,10 +1,17 @@
 #pragma once
 #include <Windows.h>
 #include "ModuleVoIP.hpp"
+#include "VoIPState.hpp"
 
 DWORD WINAPI StartTeamspeakClient(Modules::ModuleVoIP* voipModule);
 void StopTeamspeakClient();
 
 UINT64 VoIPGetscHandlerID();
 UINT64 VoIPGetVadHandlerID();
-INT VoIPGetTalkStatus();
\ No newline at end of file
+INT VoIPGetTalkStatus();
+
+// changes the settings the VoIP client should be using, they get applied on the client's thread if anything's different
+void VoIPUpdateSettings(const VoIPSettings& settings);
+
+// starts recording VoIP to wav files if it isn't already, otherwise stops it and reports how it went
+bool VoIPToggleRecording(uint64_t maxFileBytes, uint32_t maxFileSeconds, std::string& returnInfo);
\ No newline at end of file
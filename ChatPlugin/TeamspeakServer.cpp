@@ -24,6 +24,8 @@
 #include <teamspeak/public_errors.h>
 #include <teamspeak/serverlib_publicdefinitions.h>
 #include <teamspeak/serverlib.h>
+#include <condition_variable>
+#include <mutex>
 
 IEngine* sEngine = nullptr;
 
@@ -34,7 +36,19 @@ IEngine* sEngine = nullptr;
 #else
 #define SLEEP(x) usleep(x*1000)
 #endif
-bool VoIPServerRunning = false;
+
+/* The server's state, serverStateChanged gets signalled whenever it changes or a stop is requested */
+enum class VoIPServerState
+{
+	Stopped,
+	Starting,
+	Running
+};
+VoIPServerState serverState = VoIPServerState::Stopped;
+bool serverStopRequested = false;
+std::mutex serverStateLock;
+std::condition_variable serverStateChanged;
+
 /*
 * Callback when client has connected.
 *
@@ -251,7 +265,7 @@ int writeKeyPairToFile(const char *fileName, const char* keyPair) {
 	return 0;
 }
 
-DWORD WINAPI StartTeamspeakServer(Modules::ModuleVoIP* voipModule)
+DWORD runTeamspeakServer(Modules::ModuleVoIP* voipModule)
 {
 	char *version;
 	uint64 serverID;
@@ -416,9 +430,12 @@ DWORD WINAPI StartTeamspeakServer(Modules::ModuleVoIP* voipModule)
 			sEngine->PrintToConsole("Error flushing VoIP server variables: " + error);
 		return 1;
 	}
-	VoIPServerRunning = true;
-	while (VoIPServerRunning){
-		SLEEP(200);
+	/* Let the client know it can connect now, then wait until StopTeamspeakServer is called */
+	{
+		std::unique_lock<std::mutex> lock(serverStateLock);
+		serverState = VoIPServerState::Running;
+		serverStateChanged.notify_all();
+		serverStateChanged.wait(lock, [] { return serverStopRequested; });
 	}
 
 	/* Stop virtual server */
@@ -441,12 +458,53 @@ DWORD WINAPI StartTeamspeakServer(Modules::ModuleVoIP* voipModule)
 	return 0;
 }
 
+DWORD WINAPI StartTeamspeakServer(Modules::ModuleVoIP* voipModule)
+{
+	{
+		std::lock_guard<std::mutex> lock(serverStateLock);
+		if (serverState == VoIPServerState::Stopped)
+			serverState = VoIPServerState::Starting;
+	}
+
+	auto retVal = runTeamspeakServer(voipModule);
+
+	/* Whether it ran or failed to start, anything waiting on it needs to know it's finished */
+	{
+		std::lock_guard<std::mutex> lock(serverStateLock);
+		serverState = VoIPServerState::Stopped;
+	}
+	serverStateChanged.notify_all();
+	return retVal;
+}
+
+void MarkTeamspeakServerStarting()
+{
+	{
+		std::lock_guard<std::mutex> lock(serverStateLock);
+		serverState = VoIPServerState::Starting;
+		serverStopRequested = false;
+	}
+	serverStateChanged.notify_all();
+}
+
+bool WaitForTeamspeakServer()
+{
+	std::unique_lock<std::mutex> lock(serverStateLock);
+	serverStateChanged.wait(lock, [] { return serverState != VoIPServerState::Starting || serverStopRequested; });
+	return serverState == VoIPServerState::Running && !serverStopRequested;
+}
+
 bool IsTeamspeakServerRunning()
 {
-	return VoIPServerRunning;
+	std::lock_guard<std::mutex> lock(serverStateLock);
+	return serverState == VoIPServerState::Running && !serverStopRequested;
 }
 
 void StopTeamspeakServer(){
-	VoIPServerRunning = false;
+	{
+		std::lock_guard<std::mutex> lock(serverStateLock);
+		serverStopRequested = true;
+	}
+	serverStateChanged.notify_all();
 	return;
 }
\ No newline at end of file
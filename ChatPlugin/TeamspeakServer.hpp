@@ -6,3 +6,9 @@
 DWORD WINAPI StartTeamspeakServer(Modules::ModuleVoIP* voipModule);
 bool IsTeamspeakServerRunning();
 void StopTeamspeakServer();
+
+// call before creating the server's thread, so a client started at the same time knows there's a server to wait for
+void MarkTeamspeakServerStarting();
+
+// blocks until a server that's starting has either finished starting or given up, returns true if it's running
+bool WaitForTeamspeakServer();
@@ -0,0 +1,180 @@
+#include "VoIPState.hpp"
+#include <chrono>
+
+namespace
+{
+	// the voice activation level used with push-to-talk, low enough that holding the key always transmits
+	const float PushToTalkActivationLevel = -50.0f;
+
+	bool CheckResult(unsigned int result, const char* what, std::string& error)
+	{
+		if (result == 0)
+			return true;
+
+		if (!error.empty())
+			error += ", ";
+		error += std::string(what) + " failed (" + std::to_string(result) + ")";
+		return false;
+	}
+}
+
+bool VoIPSettings::operator==(const VoIPSettings& other) const
+{
+	return PushToTalk == other.PushToTalk && Talking == other.Talking && Muted == other.Muted && VolumeModifier == other.VolumeModifier &&
+		VoiceActivationLevel == other.VoiceActivationLevel && AGC == other.AGC && EchoCancellation == other.EchoCancellation;
+}
+
+VoIPState::BackendState::BackendState(const VoIPSettings& settings)
+{
+	InputActive = !settings.PushToTalk || settings.Talking;
+	InputMuted = settings.Muted;
+	VolumeModifier = settings.VolumeModifier;
+	VoiceActivation = !settings.PushToTalk;
+	VoiceActivationLevel = settings.PushToTalk ? PushToTalkActivationLevel : settings.VoiceActivationLevel;
+	AGC = settings.AGC;
+	EchoCancellation = settings.EchoCancellation;
+}
+
+VoIPState::VoIPState(VoIPBackend* backend)
+	: backend(backend), dirty(false), interrupted(false), applied(VoIPSettings()), stale(eField_All), flushCount(0)
+{
+}
+
+void VoIPState::Set(const VoIPSettings& settings)
+{
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		if (settings == wanted)
+			return;
+
+		wanted = settings;
+		dirty = true;
+	}
+	changed.notify_all();
+}
+
+VoIPSettings VoIPState::Get()
+{
+	std::lock_guard<std::mutex> guard(lock);
+	return wanted;
+}
+
+void VoIPState::Reset()
+{
+	std::lock_guard<std::mutex> guard(lock);
+	stale = eField_All;
+	dirty = true;
+	interrupted = false;
+}
+
+bool VoIPState::Apply(std::string& error)
+{
+	VoIPSettings settings;
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		settings = wanted;
+		dirty = false;
+	}
+
+	BackendState target(settings);
+	auto failed = 0;
+	auto needsUpdate = [&](StateField field, bool differs)
+	{
+		return (stale & field) || differs;
+	};
+	auto finish = [&](StateField field, bool succeeded)
+	{
+		if (succeeded)
+			stale &= ~field;
+		else
+			failed |= field;
+	};
+
+	// the input settings are client variables, which only get sent to the server by FlushSelfUpdates
+	auto selfUpdated = 0;
+	if (needsUpdate(eFieldInputActive, target.InputActive != applied.InputActive))
+	{
+		auto succeeded = CheckResult(backend->SetInputActive(target.InputActive), "Setting input active", error);
+		if (succeeded)
+		{
+			applied.InputActive = target.InputActive;
+			selfUpdated |= eFieldInputActive;
+		}
+		finish(eFieldInputActive, succeeded);
+	}
+	if (needsUpdate(eFieldInputMuted, target.InputMuted != applied.InputMuted))
+	{
+		auto succeeded = CheckResult(backend->SetInputMuted(target.InputMuted), "Setting input muted", error);
+		if (succeeded)
+		{
+			applied.InputMuted = target.InputMuted;
+			selfUpdated |= eFieldInputMuted;
+		}
+		finish(eFieldInputMuted, succeeded);
+	}
+	if (selfUpdated)
+	{
+		flushCount++;
+		if (!CheckResult(backend->FlushSelfUpdates(), "Flushing client updates", error))
+		{
+			// the server never heard about them, so they need setting again
+			stale |= selfUpdated;
+			failed |= selfUpdated;
+		}
+	}
+
+	// these are applied locally straight away, no flush needed
+	if (needsUpdate(eFieldVolumeModifier, target.VolumeModifier != applied.VolumeModifier))
+	{
+		auto succeeded = CheckResult(backend->SetVolumeModifier(target.VolumeModifier), "Setting volume modifier", error);
+		if (succeeded)
+			applied.VolumeModifier = target.VolumeModifier;
+		finish(eFieldVolumeModifier, succeeded);
+	}
+	if (needsUpdate(eFieldVoiceActivation, target.VoiceActivation != applied.VoiceActivation || target.VoiceActivationLevel != applied.VoiceActivationLevel))
+	{
+		auto succeeded = CheckResult(backend->SetVoiceActivation(target.VoiceActivation, target.VoiceActivationLevel), "Setting voice activation", error);
+		if (succeeded)
+		{
+			applied.VoiceActivation = target.VoiceActivation;
+			applied.VoiceActivationLevel = target.VoiceActivationLevel;
+		}
+		finish(eFieldVoiceActivation, succeeded);
+	}
+	if (needsUpdate(eFieldAGC, target.AGC != applied.AGC))
+	{
+		auto succeeded = CheckResult(backend->SetAGC(target.AGC), "Setting automatic gain control", error);
+		if (succeeded)
+			applied.AGC = target.AGC;
+		finish(eFieldAGC, succeeded);
+	}
+	if (needsUpdate(eFieldEchoCancellation, target.EchoCancellation != applied.EchoCancellation))
+	{
+		auto succeeded = CheckResult(backend->SetEchoCancellation(target.EchoCancellation), "Setting echo cancellation", error);
+		if (succeeded)
+			applied.EchoCancellation = target.EchoCancellation;
+		finish(eFieldEchoCancellation, succeeded);
+	}
+
+	return failed == 0;
+}
+
+bool VoIPState::Wait(uint32_t timeout)
+{
+	std::unique_lock<std::mutex> guard(lock);
+	auto ready = [&]() { return dirty || interrupted; };
+	if (timeout)
+		changed.wait_for(guard, std::chrono::milliseconds(timeout), ready);
+	else
+		changed.wait(guard, ready);
+	return !interrupted;
+}
+
+void VoIPState::Interrupt()
+{
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		interrupted = true;
+	}
+	changed.notify_all();
+}
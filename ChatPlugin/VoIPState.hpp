@@ -0,0 +1,108 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+// the settings the TeamSpeak client needs to be kept in sync with
+struct VoIPSettings
+{
+	bool PushToTalk = true;
+	bool Talking = false; // push-to-talk key is held
+	bool Muted = false; // microphone muted
+	int VolumeModifier = 6; // dB
+	float VoiceActivationLevel = -45.0f;
+	bool AGC = true;
+	bool EchoCancellation = true;
+
+	bool operator==(const VoIPSettings& other) const;
+	bool operator!=(const VoIPSettings& other) const { return !(*this == other); }
+};
+
+// what the settings get applied to, the TeamSpeak client lib normally, but anything can be swapped in
+// each function returns 0 on success or an error code
+class VoIPBackend
+{
+public:
+	virtual ~VoIPBackend() {}
+
+	virtual unsigned int SetInputActive(bool active) = 0;
+	virtual unsigned int SetInputMuted(bool muted) = 0;
+	virtual unsigned int FlushSelfUpdates() = 0; // sends SetInputActive/SetInputMuted changes to the server
+
+	virtual unsigned int SetVolumeModifier(int volume) = 0;
+	virtual unsigned int SetVoiceActivation(bool enabled, float level) = 0;
+	virtual unsigned int SetAGC(bool enabled) = 0;
+	virtual unsigned int SetEchoCancellation(bool enabled) = 0;
+};
+
+// keeps the backend in sync with the wanted settings without polling
+// Set can be called from any thread, it only wakes up whoever is waiting if the settings actually changed,
+// and Apply only makes the backend calls for whatever is different from what it last applied (self updates only get flushed if one of them changed)
+class VoIPState
+{
+public:
+	explicit VoIPState(VoIPBackend* backend);
+
+	// Changes the wanted settings.
+	void Set(const VoIPSettings& settings);
+	VoIPSettings Get();
+
+	// Forgets what was applied so the next Apply sends everything, used when a new connection is made.
+	// Also clears any earlier Interrupt.
+	void Reset();
+
+	// Applies whatever has changed since the last Apply.
+	// Returns false if any of the backend calls failed, they'll be tried again on the next Apply.
+	bool Apply(std::string& error);
+
+	// Blocks until the settings change, the timeout (in ms, 0 for none) runs out or Interrupt is called.
+	// Returns false if it was interrupted.
+	bool Wait(uint32_t timeout = 0);
+
+	// Makes Wait return false until Reset is called.
+	void Interrupt();
+
+	uint32_t GetFlushCount() const { return flushCount; }
+
+private:
+	// what the settings turn into on the backend's side, eg. talking doesn't change anything unless push-to-talk is on
+	struct BackendState
+	{
+		bool InputActive;
+		bool InputMuted;
+		int VolumeModifier;
+		bool VoiceActivation;
+		float VoiceActivationLevel;
+		bool AGC;
+		bool EchoCancellation;
+
+		explicit BackendState(const VoIPSettings& settings);
+	};
+
+	enum StateField
+	{
+		eFieldInputActive = 1 << 0,
+		eFieldInputMuted = 1 << 1,
+		eFieldVolumeModifier = 1 << 2,
+		eFieldVoiceActivation = 1 << 3,
+		eFieldAGC = 1 << 4,
+		eFieldEchoCancellation = 1 << 5,
+
+		eField_All = (1 << 6) - 1
+	};
+
+	VoIPBackend* backend;
+
+	std::mutex lock;
+	std::condition_variable changed;
+	VoIPSettings wanted;
+	bool dirty;
+	bool interrupted;
+
+	// only touched by the thread that calls Apply
+	BackendState applied;
+	int stale; // StateFields that have to be applied even if they look the same (never applied, or failed last time)
+	std::atomic<uint32_t> flushCount;
+};
@@ -0,0 +1,263 @@
+#include "VoiceRecorder.hpp"
+#include <cstring>
+#include <system_error>
+
+namespace
+{
+	const size_t WaveHeaderSize = 44;
+	const size_t RiffSizeOffset = 4;
+	const size_t DataSizeOffset = 40;
+	const uint16_t BitsPerSample = 16;
+	const size_t FrameSize = VoiceRecorder::Channels * sizeof(int16_t);
+
+	void PutUInt16(uint8_t* data, uint16_t val)
+	{
+		data[0] = static_cast<uint8_t>(val);
+		data[1] = static_cast<uint8_t>(val >> 8);
+	}
+
+	void PutUInt32(uint8_t* data, uint32_t val)
+	{
+		data[0] = static_cast<uint8_t>(val);
+		data[1] = static_cast<uint8_t>(val >> 8);
+		data[2] = static_cast<uint8_t>(val >> 16);
+		data[3] = static_cast<uint8_t>(val >> 24);
+	}
+
+	// Builds a canonical 44-byte PCM WAV header.
+	void BuildWaveHeader(uint8_t* header, uint32_t dataSize)
+	{
+		memcpy(header, "RIFF", 4);
+		PutUInt32(header + RiffSizeOffset, static_cast<uint32_t>(WaveHeaderSize - 8 + dataSize));
+		memcpy(header + 8, "WAVE", 4);
+		memcpy(header + 12, "fmt ", 4);
+		PutUInt32(header + 16, 16); // fmt chunk size
+		PutUInt16(header + 20, 1); // PCM
+		PutUInt16(header + 22, VoiceRecorder::Channels);
+		PutUInt32(header + 24, VoiceRecorder::SampleRate);
+		PutUInt32(header + 28, static_cast<uint32_t>(VoiceRecorder::SampleRate * FrameSize));
+		PutUInt16(header + 32, static_cast<uint16_t>(FrameSize));
+		PutUInt16(header + 34, BitsPerSample);
+		memcpy(header + 36, "data", 4);
+		PutUInt32(header + DataSizeOffset, dataSize);
+	}
+}
+
+VoiceRecorder::VoiceRecorder(VoiceRecorderEnvironment& environment)
+	: environment(environment), writePos(0), readPos(0), recording(false), stopping(false), framesWritten(0), framesDropped(0), overruns(0), filesWritten(0), writeErrors(0),
+	maxFileFrames(0), file(nullptr), fileFrames(0), fileNumber(0)
+{
+	ring = new int16_t[RingFrames * Channels];
+}
+
+VoiceRecorder::~VoiceRecorder()
+{
+	Stop();
+	delete[] ring;
+}
+
+bool VoiceRecorder::Start(const std::string& pathPrefix, uint64_t maxFileBytes, uint32_t maxFileSeconds, std::string& error)
+{
+	if (thread.joinable())
+	{
+		error = "Already recording to " + GetCurrentFile();
+		return false;
+	}
+
+	this->pathPrefix = pathPrefix;
+	maxFileFrames = MaxDataBytes / FrameSize;
+	if (maxFileBytes && maxFileBytes / FrameSize < maxFileFrames)
+		maxFileFrames = maxFileBytes / FrameSize;
+	if (maxFileSeconds && static_cast<uint64_t>(maxFileSeconds) * SampleRate < maxFileFrames)
+		maxFileFrames = static_cast<uint64_t>(maxFileSeconds) * SampleRate;
+	if (maxFileFrames == 0)
+		maxFileFrames = 1;
+
+	framesWritten = 0;
+	framesDropped = 0;
+	overruns = 0;
+	filesWritten = 0;
+	writeErrors = 0;
+	fileNumber = 0;
+
+	// throw away anything left over from last time (a Write that was already running when Stop was called)
+	readPos.store(writePos.load(std::memory_order_acquire), std::memory_order_release);
+
+	if (!openFile())
+	{
+		error = "Failed to open " + GetCurrentFile() + " for writing";
+		return false;
+	}
+
+	stopping = false;
+	try
+	{
+		thread = std::thread([this]() { run(); });
+	}
+	catch (const std::system_error&)
+	{
+		closeFile();
+		error = "Failed to create the recording thread";
+		return false;
+	}
+
+	recording = true;
+	return true;
+}
+
+void VoiceRecorder::Stop()
+{
+	if (!thread.joinable())
+		return;
+
+	recording = false;
+	{
+		std::lock_guard<std::mutex> lock(wakeLock);
+		stopping = true;
+	}
+	wake.notify_one();
+	thread.join();
+}
+
+void VoiceRecorder::Write(const int16_t* samples, size_t frames)
+{
+	if (!recording || frames == 0)
+		return;
+
+	auto write = writePos.load(std::memory_order_relaxed);
+	auto read = readPos.load(std::memory_order_acquire);
+	if (frames > RingFrames - (write - read))
+	{
+		// dropping the whole block instead of part of it keeps what does get recorded in whole callbacks
+		framesDropped += frames;
+		overruns++;
+		return;
+	}
+
+	auto offset = write & (RingFrames - 1);
+	auto firstFrames = RingFrames - offset;
+	if (firstFrames > frames)
+		firstFrames = frames;
+	memcpy(ring + offset * Channels, samples, firstFrames * FrameSize);
+	if (firstFrames < frames)
+		memcpy(ring, samples + firstFrames * Channels, (frames - firstFrames) * FrameSize);
+
+	writePos.store(write + frames, std::memory_order_release); // hand the frames to the writer
+}
+
+VoiceRecorder::Stats VoiceRecorder::GetStats() const
+{
+	Stats stats;
+	stats.FramesWritten = framesWritten;
+	stats.FramesDropped = framesDropped;
+	stats.Overruns = overruns;
+	stats.FilesWritten = filesWritten;
+	stats.WriteErrors = writeErrors;
+	return stats;
+}
+
+std::string VoiceRecorder::GetCurrentFile()
+{
+	std::lock_guard<std::mutex> lock(fileNameLock);
+	return fileName;
+}
+
+/// <summary>
+/// Writes out whatever's in the ring every WriterInterval ms until Stop is called.
+/// </summary>
+void VoiceRecorder::run()
+{
+	while (!stopping)
+	{
+		{
+			std::unique_lock<std::mutex> lock(wakeLock);
+			wake.wait_for(lock, std::chrono::milliseconds(static_cast<uint32_t>(WriterInterval)), [this]() { return stopping.load(); });
+		}
+		drain();
+	}
+
+	// get the last few frames out before finishing the file
+	drain();
+	closeFile();
+}
+
+/// <summary>
+/// Writes every frame in the ring to disk, opening and closing files whenever the current one reaches its limit.
+/// </summary>
+void VoiceRecorder::drain()
+{
+	auto read = readPos.load(std::memory_order_relaxed);
+	auto write = writePos.load(std::memory_order_acquire);
+	while (read != write)
+	{
+		if (!file && !openFile())
+		{
+			// nowhere to put them, so they're lost either way
+			writeErrors++;
+			framesDropped += write - read;
+			readPos.store(write, std::memory_order_release);
+			return;
+		}
+
+		auto offset = read & (RingFrames - 1);
+		uint64_t frames = write - read;
+		if (frames > RingFrames - offset)
+			frames = RingFrames - offset; // up to the end of the ring, the rest gets written on the next pass round the loop
+		if (frames > maxFileFrames - fileFrames)
+			frames = maxFileFrames - fileFrames;
+
+		if (!environment.Write(file, ring + offset * Channels, static_cast<size_t>(frames) * FrameSize))
+			writeErrors++;
+
+		fileFrames += frames;
+		framesWritten += frames;
+		read += static_cast<size_t>(frames);
+		readPos.store(read, std::memory_order_release); // give the space back to the producer
+
+		if (fileFrames >= maxFileFrames)
+			closeFile();
+	}
+}
+
+/// <summary>
+/// Opens the next file and writes a placeholder header to it, the sizes get filled in by closeFile.
+/// </summary>
+bool VoiceRecorder::openFile()
+{
+	auto name = pathPrefix + "-" + environment.GetTimeString() + "-" + std::to_string(++fileNumber) + ".wav";
+	{
+		std::lock_guard<std::mutex> lock(fileNameLock);
+		fileName = name;
+	}
+
+	file = environment.OpenForWriting(name);
+	if (!file)
+		return false;
+
+	uint8_t header[WaveHeaderSize];
+	BuildWaveHeader(header, 0);
+	if (!environment.Write(file, header, sizeof(header)))
+		writeErrors++;
+
+	fileFrames = 0;
+	return true;
+}
+
+/// <summary>
+/// Fills in the header's sizes now that they're known and closes the file.
+/// </summary>
+void VoiceRecorder::closeFile()
+{
+	if (!file)
+		return;
+
+	uint8_t header[WaveHeaderSize];
+	BuildWaveHeader(header, static_cast<uint32_t>(fileFrames * FrameSize));
+	if (!environment.WriteStart(file, header, sizeof(header)))
+		writeErrors++;
+	if (!environment.Close(file))
+		writeErrors++;
+
+	file = nullptr;
+	filesWritten++;
+}
@@ -0,0 +1,110 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// the files VoiceRecorder writes to, only used from the writer thread (and Start)
+class VoiceRecorderEnvironment
+{
+public:
+	virtual ~VoiceRecorderEnvironment() {}
+
+	// The local date and time to put in file names, as YYYYMMDD-HHMMSS.
+	virtual std::string GetTimeString() = 0;
+
+	// Returns null if the file couldn't be created.
+	virtual void* OpenForWriting(const std::string& path) = 0;
+	virtual bool Write(void* file, const void* data, size_t size) = 0;
+
+	// Overwrites the start of the file, used to fill in the header once the sizes are known.
+	virtual bool WriteStart(void* file, const void* data, size_t size) = 0;
+	virtual bool Close(void* file) = 0;
+};
+
+// stdio files and the local time
+class WinVoiceRecorderEnvironment : public VoiceRecorderEnvironment
+{
+public:
+	std::string GetTimeString();
+	void* OpenForWriting(const std::string& path);
+	bool Write(void* file, const void* data, size_t size);
+	bool WriteStart(void* file, const void* data, size_t size);
+	bool Close(void* file);
+};
+
+// records 16-bit stereo PCM to WAV files without doing any file IO on the thread that supplies the audio
+// Write copies frames into a preallocated ring (one producer, one consumer), and a writer thread takes them out and streams them to disk
+// the sizes in the WAV header get filled in when a file is closed, and files are rotated once they reach a maximum size or length
+// if the writer falls behind and the ring fills up, the frames that don't fit are dropped and counted instead of blocking the audio thread
+class VoiceRecorder
+{
+public:
+	static const uint32_t SampleRate = 48000;
+	static const uint16_t Channels = 2;
+	static const size_t RingFrames = 1 << 17; // ~2.7 seconds, must be a power of 2
+	static const uint32_t WriterInterval = 50; // ms between writer passes
+	static const uint64_t MaxDataBytes = 0xFFFFFFFF - 36; // the largest data chunk a WAV header can describe
+
+	struct Stats
+	{
+		uint64_t FramesWritten; // made it to disk
+		uint64_t FramesDropped; // didn't fit in the ring
+		uint32_t Overruns; // Write calls that had to drop frames
+		uint32_t FilesWritten;
+		uint32_t WriteErrors;
+	};
+
+	explicit VoiceRecorder(VoiceRecorderEnvironment& environment);
+	~VoiceRecorder();
+
+	// Starts recording to files named <pathPrefix>-<date>-<time>-<number>.wav, the first file is opened straight away so errors can be reported.
+	// A limit of 0 means the file is never rotated for that reason.
+	bool Start(const std::string& pathPrefix, uint64_t maxFileBytes, uint32_t maxFileSeconds, std::string& error);
+
+	// Stops recording and waits for everything that was written to reach the disk.
+	void Stop();
+
+	bool IsRecording() const { return recording; }
+
+	// Adds interleaved frames, called from the audio thread, never blocks or allocates.
+	void Write(const int16_t* samples, size_t frames);
+
+	Stats GetStats() const;
+	std::string GetCurrentFile();
+
+private:
+	VoiceRecorderEnvironment& environment;
+	int16_t* ring; // RingFrames * Channels samples
+	std::atomic<size_t> writePos; // total frames written/read, only the producer changes writePos and only the writer changes readPos
+	std::atomic<size_t> readPos;
+
+	std::atomic<bool> recording;
+	std::atomic<bool> stopping;
+	std::thread thread;
+	std::mutex wakeLock;
+	std::condition_variable wake; // notified when Stop is called
+
+	std::atomic<uint64_t> framesWritten;
+	std::atomic<uint64_t> framesDropped;
+	std::atomic<uint32_t> overruns;
+	std::atomic<uint32_t> filesWritten;
+	std::atomic<uint32_t> writeErrors;
+
+	// only touched by the writer thread while recording
+	std::string pathPrefix;
+	uint64_t maxFileFrames;
+	void* file;
+	uint64_t fileFrames;
+	uint32_t fileNumber;
+
+	std::mutex fileNameLock;
+	std::string fileName;
+
+	void run();
+	void drain();
+	bool openFile();
+	void closeFile();
+};
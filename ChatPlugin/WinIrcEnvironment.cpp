@@ -0,0 +1,176 @@
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include "IrcClient.hpp"
+
+WinIrcEnvironment::WinIrcEnvironment()
+	: sock(INVALID_SOCKET), started(false)
+{
+	socketEvent = WSACreateEvent();
+	wakeEvent = CreateEvent(NULL, FALSE, FALSE, NULL);
+}
+
+WinIrcEnvironment::~WinIrcEnvironment()
+{
+	Disconnect();
+	WSACloseEvent(socketEvent);
+	CloseHandle(wakeEvent);
+}
+
+uint64_t WinIrcEnvironment::GetTime()
+{
+	return GetTickCount64();
+}
+
+/// <summary>
+/// Resolves the server and connects to the first address that works.
+/// </summary>
+bool WinIrcEnvironment::Connect(const std::string& host, const std::string& port, std::string& error)
+{
+	WSADATA wsaData;
+	if (WSAStartup(MAKEWORD(2, 2), &wsaData))
+	{
+		error = "WSAStartup failed";
+		return false;
+	}
+	started = true;
+
+	// only a Wake from now on should stop the connect, not one left over from the last connection
+	ResetEvent(wakeEvent);
+
+	addrinfo hints;
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+	hints.ai_protocol = IPPROTO_TCP;
+
+	addrinfo* results;
+	auto retVal = getaddrinfo(host.c_str(), port.c_str(), &hints, &results);
+	if (retVal)
+	{
+		error = "couldn't resolve " + host + ": " + gai_strerrorA(retVal) + " (" + std::to_string(retVal) + ")";
+		return false;
+	}
+
+	error = "no addresses for " + host;
+	HANDLE events[] = { socketEvent, wakeEvent };
+	auto woken = false;
+	for (auto ai = results; ai && !woken; ai = ai->ai_next)
+	{
+		sock = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+		if (sock == INVALID_SOCKET)
+		{
+			error = "socket error " + std::to_string(WSAGetLastError());
+			continue;
+		}
+
+		// the socket is non-blocking from here on, so Stop doesn't have to wait for the connect to time out
+		WSAEventSelect(sock, socketEvent, FD_CONNECT | FD_READ | FD_WRITE | FD_CLOSE);
+		if (connect(sock, ai->ai_addr, static_cast<int>(ai->ai_addrlen)) == SOCKET_ERROR && WSAGetLastError() != WSAEWOULDBLOCK)
+			error = "connect error " + std::to_string(WSAGetLastError());
+		else
+		{
+			auto start = GetTickCount64();
+			error = "connect timed out";
+			for (;;)
+			{
+				auto elapsed = GetTickCount64() - start;
+				if (elapsed >= IrcClient::ConnectTimeout)
+					break;
+
+				auto waitResult = WSAWaitForMultipleEvents(2, events, FALSE, static_cast<DWORD>(IrcClient::ConnectTimeout - elapsed), FALSE);
+				if (waitResult == WSA_WAIT_EVENT_0 + 1)
+				{
+					error = "connect cancelled";
+					woken = true;
+					break;
+				}
+				if (waitResult != WSA_WAIT_EVENT_0)
+					continue;
+
+				WSANETWORKEVENTS networkEvents;
+				if (WSAEnumNetworkEvents(sock, socketEvent, &networkEvents) || !(networkEvents.lNetworkEvents & FD_CONNECT))
+					continue;
+
+				if (networkEvents.iErrorCode[FD_CONNECT_BIT] == 0)
+				{
+					freeaddrinfo(results);
+					error.clear();
+					return true;
+				}
+
+				error = "connect error " + std::to_string(networkEvents.iErrorCode[FD_CONNECT_BIT]);
+				break;
+			}
+		}
+
+		closesocket(sock);
+		sock = INVALID_SOCKET;
+	}
+
+	freeaddrinfo(results);
+	return false;
+}
+
+void WinIrcEnvironment::Disconnect()
+{
+	if (sock != INVALID_SOCKET)
+	{
+		closesocket(sock);
+		sock = INVALID_SOCKET;
+	}
+	if (started)
+	{
+		WSACleanup();
+		started = false;
+	}
+}
+
+int WinIrcEnvironment::Receive(char* buffer, size_t size, std::string& error)
+{
+	auto received = recv(sock, buffer, static_cast<int>(size), 0);
+	if (received > 0)
+		return received;
+	if (received == 0)
+	{
+		error = "connection closed by server";
+		return -1;
+	}
+	if (WSAGetLastError() == WSAEWOULDBLOCK)
+		return 0;
+
+	error = "recv error " + std::to_string(WSAGetLastError());
+	return -1;
+}
+
+int WinIrcEnvironment::Send(const char* data, size_t size, std::string& error)
+{
+	auto result = send(sock, data, static_cast<int>(size), 0);
+	if (result != SOCKET_ERROR)
+		return result;
+	if (WSAGetLastError() == WSAEWOULDBLOCK)
+		return 0;
+
+	error = "send error " + std::to_string(WSAGetLastError());
+	return -1;
+}
+
+void WinIrcEnvironment::Wait(uint32_t timeout)
+{
+	if (sock == INVALID_SOCKET)
+	{
+		WaitForSingleObject(wakeEvent, timeout);
+		return;
+	}
+
+	HANDLE events[] = { socketEvent, wakeEvent };
+	if (WSAWaitForMultipleEvents(2, events, FALSE, timeout, FALSE) == WSA_WAIT_EVENT_0)
+	{
+		WSANETWORKEVENTS networkEvents;
+		WSAEnumNetworkEvents(sock, socketEvent, &networkEvents); // resets the event, FD_CLOSE gets picked up by recv on the next pass
+	}
+}
+
+void WinIrcEnvironment::Wake()
+{
+	SetEvent(wakeEvent);
+}
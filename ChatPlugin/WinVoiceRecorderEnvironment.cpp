@@ -0,0 +1,37 @@
+#include "VoiceRecorder.hpp"
+#include <cstdio>
+#include <ctime>
+
+std::string WinVoiceRecorderEnvironment::GetTimeString()
+{
+	auto now = time(NULL);
+	tm localTime;
+	char timeString[32] = { 0 };
+	if (localtime_s(&localTime, &now) == 0)
+		strftime(timeString, sizeof(timeString), "%Y%m%d-%H%M%S", &localTime);
+	return timeString;
+}
+
+void* WinVoiceRecorderEnvironment::OpenForWriting(const std::string& path)
+{
+	FILE* file;
+	if (fopen_s(&file, path.c_str(), "wb") != 0)
+		return nullptr;
+	return file;
+}
+
+bool WinVoiceRecorderEnvironment::Write(void* file, const void* data, size_t size)
+{
+	return fwrite(data, 1, size, static_cast<FILE*>(file)) == size;
+}
+
+bool WinVoiceRecorderEnvironment::WriteStart(void* file, const void* data, size_t size)
+{
+	auto stream = static_cast<FILE*>(file);
+	return fseek(stream, 0, SEEK_SET) == 0 && fwrite(data, 1, size, stream) == size;
+}
+
+bool WinVoiceRecorderEnvironment::Close(void* file)
+{
+	return fclose(static_cast<FILE*>(file)) == 0;
+}
@@ -34,6 +34,11 @@ namespace Blam
 			return EntryCount;
 		}
 
+		int GetMaxEntries()
+		{
+			return MaxEntries;
+		}
+
 		Pointer AddEntry()
 		{
 			typedef int(__cdecl *Globals_ArrayPushPtr)(void* arrayGlobal);
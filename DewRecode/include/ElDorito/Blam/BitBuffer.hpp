@@ -0,0 +1,320 @@
+#pragma once
+
+#include "../Utils/Bits.hpp"
+
+#include <cstdint>
+#include <cstring>
+#include <cstddef>
+
+namespace Blam
+{
+	// Bit writer/reader that works on a plain byte buffer instead of calling into the game, so it can be used (and tested) anywhere
+	// Uses the same bit layout as the engine's bitstreams: values are written most significant bit first, one after another,
+	// so writing a block from one of these to a Blam::BitStream 64 bits at a time puts the exact same bits on the wire as
+	// writing each value to the BitStream directly
+
+	namespace BitBufferInternal
+	{
+		// Loads up to 8 bytes as a big-endian 64-bit value, bytes past the end of the buffer are read as 0
+		inline uint64_t Load64(const uint8_t* data, size_t offset, size_t size)
+		{
+			if (offset + 8 <= size)
+			{
+				return (static_cast<uint64_t>(data[offset]) << 56) | (static_cast<uint64_t>(data[offset + 1]) << 48) |
+					(static_cast<uint64_t>(data[offset + 2]) << 40) | (static_cast<uint64_t>(data[offset + 3]) << 32) |
+					(static_cast<uint64_t>(data[offset + 4]) << 24) | (static_cast<uint64_t>(data[offset + 5]) << 16) |
+					(static_cast<uint64_t>(data[offset + 6]) << 8) | static_cast<uint64_t>(data[offset + 7]);
+			}
+
+			uint64_t result = 0;
+			for (size_t i = 0; i < 8; i++)
+			{
+				result <<= 8;
+				if (offset + i < size)
+					result |= data[offset + i];
+			}
+			return result;
+		}
+
+		// Stores a 64-bit value as up to 8 big-endian bytes, returns false if some of them didn't fit
+		inline bool Store64(uint8_t* data, size_t offset, size_t size, uint64_t val, size_t numBytes = 8)
+		{
+			for (size_t i = 0; i < numBytes; i++)
+			{
+				if (offset + i >= size)
+					return false;
+				data[offset + i] = static_cast<uint8_t>(val >> (56 - i * 8));
+			}
+			return true;
+		}
+
+		inline uint64_t Mask(int bits)
+		{
+			return (bits >= 64) ? 0xFFFFFFFFFFFFFFFF : ((1ULL << bits) - 1);
+		}
+	}
+
+	// Writes bits to a byte buffer
+	class BitWriter
+	{
+	public:
+		BitWriter(void* buffer, size_t size)
+			: buffer(static_cast<uint8_t*>(buffer)), size(size), bytePosition(0), position(0), window(0), windowBits(0), overflowed(false)
+		{
+		}
+
+		// Gets the number of bits that have been written.
+		size_t GetPosition() const { return position; }
+
+		// Returns true if more bits were written than the buffer can hold.
+		bool HasOverflowed() const { return overflowed; }
+
+		// Gets the buffer, call Finish first to make sure it's up to date.
+		const uint8_t* GetData() const { return buffer; }
+
+		void WriteBool(bool b)
+		{
+			WriteBits(b ? 1 : 0, 1);
+		}
+
+		template<class T>
+		void WriteUnsigned(T val, int bits)
+		{
+			WriteBits(static_cast<uint64_t>(val), bits);
+		}
+
+		template<class T>
+		void WriteUnsigned(T val, T minValue, T maxValue)
+		{
+			WriteUnsigned(val - minValue, Utils::Bits::CountBits(maxValue - minValue));
+		}
+
+		// Writes a signed value in two's complement.
+		template<class T>
+		void WriteSigned(T val, int bits)
+		{
+			WriteBits(static_cast<uint64_t>(static_cast<int64_t>(val)), bits);
+		}
+
+		void WriteFloat(float val)
+		{
+			uint32_t raw;
+			memcpy(&raw, &val, sizeof(raw));
+			WriteBits(raw, 32);
+		}
+
+		// Writes a float in the range [minValue, maxValue] as one of 2^bits evenly spaced steps, both ends of the range are exact.
+		void WriteQuantizedFloat(float val, float minValue, float maxValue, int bits)
+		{
+			auto steps = static_cast<uint32_t>(BitBufferInternal::Mask(bits));
+			if (val <= minValue || maxValue <= minValue)
+				WriteBits(0, bits);
+			else if (val >= maxValue)
+				WriteBits(steps, bits);
+			else
+				WriteBits(static_cast<uint32_t>((val - minValue) / (maxValue - minValue) * steps + 0.5f), bits);
+		}
+
+		// Writes a string as its length followed by 8 bits per character, strings longer than maxLength are cut off.
+		void WriteString(const char* str, size_t maxLength)
+		{
+			size_t length = 0;
+			while (length < maxLength && str[length])
+				length++;
+
+			WriteUnsigned<size_t>(length, Utils::Bits::CountBits(maxLength));
+			for (size_t i = 0; i < length; i++)
+				WriteBits(static_cast<uint8_t>(str[i]), 8);
+		}
+
+		// Writes bits from another bit buffer (eg. the data from another BitWriter), most significant bit of the first byte first.
+		void WriteBlock(const void* data, size_t bits)
+		{
+			auto bytes = static_cast<const uint8_t*>(data);
+			auto byteSize = (bits + 7) / 8;
+			size_t offset = 0;
+			for (; bits >= 64; bits -= 64, offset += 8)
+				WriteBits(BitBufferInternal::Load64(bytes, offset, byteSize), 64);
+			if (bits > 0)
+				WriteBits(BitBufferInternal::Load64(bytes, offset, byteSize) >> (64 - bits), static_cast<int>(bits));
+		}
+
+		// Writes bits, up to 64 at a time.
+		void WriteBits(uint64_t val, int bits)
+		{
+			if (bits <= 0)
+				return;
+
+			val &= BitBufferInternal::Mask(bits);
+			position += bits;
+
+			auto freeBits = 64 - windowBits;
+			if (bits < freeBits)
+			{
+				window = (window << bits) | val;
+				windowBits += bits;
+				return;
+			}
+
+			// fill the rest of the window, write it out, and start the next one with whatever's left over
+			auto leftOver = bits - freeBits;
+			window = (freeBits == 64) ? val >> leftOver : (window << freeBits) | (val >> leftOver);
+			flushWindow();
+			window = val & BitBufferInternal::Mask(leftOver);
+			windowBits = leftOver;
+		}
+
+		// Writes out the bits that are still waiting in the window, more bits can still be written afterwards.
+		void Finish()
+		{
+			if (windowBits == 0)
+				return;
+
+			auto numBytes = static_cast<size_t>((windowBits + 7) / 8);
+			if (!BitBufferInternal::Store64(buffer, bytePosition, size, window << (64 - windowBits), numBytes))
+				overflowed = true;
+		}
+
+	private:
+		uint8_t* buffer;
+		size_t size;
+		size_t bytePosition; // where the window gets written to
+		size_t position;
+		uint64_t window;
+		int windowBits;
+		bool overflowed;
+
+		void flushWindow()
+		{
+			if (!BitBufferInternal::Store64(buffer, bytePosition, size, window))
+				overflowed = true;
+			bytePosition += 8;
+			window = 0;
+			windowBits = 0;
+		}
+	};
+
+	// Reads bits from a byte buffer, reading past the end returns 0s and sets the overflow flag
+	class BitReader
+	{
+	public:
+		BitReader(const void* data, size_t bits)
+			: data(static_cast<const uint8_t*>(data)), size((bits + 7) / 8), bits(bits), position(0), overflowed(false)
+		{
+		}
+
+		// Gets the number of bits that have been read.
+		size_t GetPosition() const { return position; }
+
+		// Gets the number of bits that are left.
+		size_t GetRemaining() const { return position < bits ? bits - position : 0; }
+
+		// Returns true if a read went past the end of the data.
+		bool HasOverflowed() const { return overflowed; }
+
+		bool ReadBool()
+		{
+			return ReadBits(1) != 0;
+		}
+
+		template<class T>
+		T ReadUnsigned(int bits)
+		{
+			return static_cast<T>(ReadBits(bits));
+		}
+
+		template<class T>
+		T ReadUnsigned(T minValue, T maxValue)
+		{
+			return static_cast<T>(minValue + ReadUnsigned<T>(Utils::Bits::CountBits(maxValue - minValue)));
+		}
+
+		// Reads a signed value in two's complement, sign-extending it.
+		template<class T>
+		T ReadSigned(int bits)
+		{
+			auto val = ReadBits(bits);
+			if (bits > 0 && bits < 64 && (val >> (bits - 1)) & 1)
+				val |= ~BitBufferInternal::Mask(bits);
+			return static_cast<T>(static_cast<int64_t>(val));
+		}
+
+		float ReadFloat()
+		{
+			auto raw = static_cast<uint32_t>(ReadBits(32));
+			float val;
+			memcpy(&val, &raw, sizeof(val));
+			return val;
+		}
+
+		float ReadQuantizedFloat(float minValue, float maxValue, int bits)
+		{
+			auto steps = static_cast<uint32_t>(BitBufferInternal::Mask(bits));
+			auto val = static_cast<uint32_t>(ReadBits(bits));
+			if (val == 0)
+				return minValue;
+			if (val >= steps)
+				return maxValue;
+			return minValue + (maxValue - minValue) * val / steps;
+		}
+
+		// Reads a string written by WriteString, out needs room for maxLength characters plus a null terminator.
+		void ReadString(char* out, size_t maxLength)
+		{
+			auto length = ReadUnsigned<size_t>(Utils::Bits::CountBits(maxLength));
+			if (length > maxLength)
+			{
+				overflowed = true; // corrupt
+				length = 0;
+			}
+
+			for (size_t i = 0; i < length; i++)
+				out[i] = static_cast<char>(ReadBits(8));
+			out[length] = 0;
+		}
+
+		// Reads bits into another bit buffer, most significant bit of the first byte first.
+		void ReadBlock(void* out, size_t bits)
+		{
+			auto bytes = static_cast<uint8_t*>(out);
+			auto byteSize = (bits + 7) / 8;
+			size_t offset = 0;
+			for (; bits >= 64; bits -= 64, offset += 8)
+				BitBufferInternal::Store64(bytes, offset, byteSize, ReadBits(64));
+			if (bits > 0)
+				BitBufferInternal::Store64(bytes, offset, byteSize, ReadBits(static_cast<int>(bits)) << (64 - bits), (bits + 7) / 8);
+		}
+
+		// Reads bits, up to 64 at a time.
+		uint64_t ReadBits(int count)
+		{
+			if (count <= 0)
+				return 0;
+			if (position + count > bits)
+			{
+				overflowed = true;
+				position = bits;
+				return 0;
+			}
+
+			auto byteOffset = position / 8;
+			auto bitOffset = static_cast<int>(position % 8);
+			position += count;
+
+			// the value can start partway through a byte, so it can be spread over 9 bytes
+			auto word = BitBufferInternal::Load64(data, byteOffset, size) << bitOffset;
+			auto result = word >> (64 - count);
+			auto extraBits = bitOffset + count - 64;
+			if (extraBits > 0)
+				result |= static_cast<uint64_t>(data[byteOffset + 8]) >> (8 - extraBits);
+			return result;
+		}
+
+	private:
+		const uint8_t* data;
+		size_t size;
+		size_t bits;
+		size_t position;
+		bool overflowed;
+	};
+}
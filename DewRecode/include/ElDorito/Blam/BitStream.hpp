@@ -26,7 +26,18 @@ namespace Blam
 		template<class T>
 		T ReadUnsigned(T minValue, T maxValue)
 		{
-			return static_cast<T>(ReadUnsigned<T>(Utils::Bits::CountBits(maxValue - minValue)));
+			return static_cast<T>(minValue + ReadUnsigned<T>(Utils::Bits::CountBits(maxValue - minValue)));
+		}
+
+		// Reads bits into a buffer (eg. to decode with a Blam::BitReader), most significant bit of the first byte first.
+		// Pulls 64 bits per call into the game instead of one call per value.
+		void ReadBlock(void* out, size_t bits)
+		{
+			auto bytes = static_cast<uint8_t*>(out);
+			for (; bits >= 64; bits -= 64, bytes += 8)
+				StoreBigEndian(bytes, ReadBits(64), 8);
+			if (bits > 0)
+				StoreBigEndian(bytes, ReadBits(static_cast<int>(bits)) << (64 - bits), (bits + 7) / 8);
 		}
 
 		void WriteBool(bool b)
@@ -46,6 +57,17 @@ namespace Blam
 			WriteUnsigned(val - minValue, Utils::Bits::CountBits(maxValue - minValue));
 		}
 
+		// Writes bits from a buffer (eg. the data from a Blam::BitWriter), most significant bit of the first byte first.
+		// The bits go on the wire exactly as if each value had been written to this stream separately.
+		void WriteBlock(const void* data, size_t bits)
+		{
+			auto bytes = static_cast<const uint8_t*>(data);
+			for (; bits >= 64; bits -= 64, bytes += 8)
+				WriteBits(LoadBigEndian(bytes, 8), 64);
+			if (bits > 0)
+				WriteBits(LoadBigEndian(bytes, (bits + 7) / 8) >> (64 - bits), static_cast<int>(bits));
+		}
+
 	private:
 		uint8_t* start;      // 0x00
 		uint8_t* end;        // 0x04
@@ -63,6 +85,20 @@ namespace Blam
 		uint32_t unk98;      // 0x98
 		uint32_t unk9C;      // 0x9C
 
+		static uint64_t LoadBigEndian(const uint8_t* bytes, size_t numBytes)
+		{
+			uint64_t result = 0;
+			for (size_t i = 0; i < 8; i++)
+				result = (result << 8) | (i < numBytes ? bytes[i] : 0);
+			return result;
+		}
+
+		static void StoreBigEndian(uint8_t* bytes, uint64_t val, size_t numBytes)
+		{
+			for (size_t i = 0; i < numBytes; i++)
+				bytes[i] = static_cast<uint8_t>(val >> (56 - i * 8));
+		}
+
 		int GetAvailableBits() const { return sizeof(window) * 8 - windowBitsUsed; }
 		bool BitsAvailable(int bits) const { return bits <= GetAvailableBits(); }
 
@@ -92,8 +128,18 @@ namespace Blam
 		{
 			if (BitsAvailable(bits))
 			{
+				if (bits <= 0)
+					return;
+
 				position += bits;
 				windowBitsUsed += bits;
+
+				// shifting a 64-bit value by 64 is undefined, and a full write only happens when the window is empty anyway
+				if (bits >= 64)
+				{
+					window = val;
+					return;
+				}
 				window <<= bits;
 				window |= val & (0xFFFFFFFFFFFFFFFF >> (64 - bits));
 			}
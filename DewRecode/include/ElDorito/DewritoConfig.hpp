@@ -0,0 +1,13 @@
+#pragma once
+#include <map>
+#include <string>
+#include <vector>
+
+// the parsed contents of dewrito.json, see IEngine002::GetDewritoConfig
+struct DewritoConfig
+{
+	std::map<std::string, std::vector<std::string>> MasterEndpoints; // URLs from the masterServers entries, grouped by type ("announce", "list", "stats"...)
+	std::string UpdateServiceUrl;
+	std::string UpdateChannelsUrl;
+	std::vector<std::string> Errors; // problems found while loading the file, anything with an error is left out
+};
@@ -92,6 +92,13 @@ struct Command
 	// modifiers might be added to the name later, so you can do things like "parameter_1:o" to signify the parameter is optional
 };
 
+// a replicated variable along with the replication generation it last changed in, see ICommands002
+struct ReplicatedVariable
+{
+	Command* Variable;
+	unsigned int Generation;
+};
+
 /*
 if you want to make changes to this interface create a new IConsole002 class and make them there, then edit GameConsole class to inherit from the new class + this older one
 for backwards compatibility (with plugins compiled against an older ED SDK) we can't remove any methods, only add new ones to a new interface version
@@ -258,12 +265,32 @@ public:
 also update the ICommands typedef and COMMANDS_INTERFACE_LATEST define
 and edit Engine::CreateInterface to include this interface */
 
-/*class ICommands002 : public ICommands001
+class ICommands002 : public ICommands001
+{
+public:
+	/// <summary>
+	/// Gets the replication generation, which is bumped every time a replicated variable is added or changes value.
+	/// </summary>
+	/// <returns>The current replication generation.</returns>
+	virtual unsigned int GetReplicationGeneration() = 0;
+
+	/// <summary>
+	/// Gets the replicated variables that changed after a generation, so only the differences have to be sent to clients.
+	/// </summary>
+	/// <param name="sinceGeneration">The generation the receiver is up to date with, 0 to get every replicated variable.</param>
+	/// <param name="variables">Filled with the variables that changed, in the order they were added.</param>
+	/// <returns>false if sinceGeneration is newer than the current generation (eg. it came from before a restart), variables is filled with every replicated variable instead.</returns>
+	virtual bool GetReplicatedVariables(unsigned int sinceGeneration, std::vector<ReplicatedVariable>& variables) = 0;
+};
+
+#define COMMANDS_INTERFACE_VERSION002 "Commands002"
+
+/*class ICommands003 : public ICommands002
 {
 
 };
 
-#define COMMANDS_INTERFACE_VERSION002 "Commands002"*/
+#define COMMANDS_INTERFACE_VERSION003 "Commands003"*/
 
-typedef ICommands001 ICommands;
-#define COMMANDS_INTERFACE_LATEST COMMANDS_INTERFACE_VERSION001
+typedef ICommands002 ICommands;
+#define COMMANDS_INTERFACE_LATEST COMMANDS_INTERFACE_VERSION002
@@ -1,6 +1,9 @@
 #pragma once
 #include "Pointer.hpp"
+#include "DewritoConfig.hpp"
 #include <chrono>
+#include <map>
+#include <memory>
 namespace Blam
 {
 	class ArrayGlobal;
@@ -50,6 +53,7 @@ later:
 struct ConsoleBuffer;
 typedef void(__cdecl *TickCallback)(const std::chrono::duration<double>& deltaTime);
 typedef void(__cdecl *EventCallback)(void* param);
+typedef int EventId; // interned eventNamespace.eventName, -1 if invalid
 typedef void(__cdecl *ConsoleInputCallback)(const std::string& input, ConsoleBuffer* buffer);
 typedef void(__cdecl *UserInputBoxCallback)(const std::string& boxTag, const std::string& result);
 typedef std::initializer_list<std::string> StringArrayInitializerType;
@@ -296,12 +300,62 @@ public:
 also update the IEngine typedef and ENGINE_INTERFACE_LATEST define
 and edit Engine::CreateInterface to include this interface */
 
-/*class IEngine002 : public IEngine001
+class IEngine002 : public IEngine001
+{
+public:
+	// bring the string versions into scope, otherwise the EventId overloads would hide them
+	using IEngine001::OnEvent;
+	using IEngine001::RemoveOnEvent;
+	using IEngine001::Event;
+
+	/// <summary>
+	/// Gets the ID for an event, creating the event if it doesn't exist yet. Look the ID up once (eg. when your plugin loads) and use it with the EventId overloads,
+	/// they skip building/looking up the event name each time the event is signalled.
+	/// </summary>
+	/// <param name="eventNamespace">The namespace the event belongs to.</param>
+	/// <param name="eventName">The name of the event.</param>
+	/// <returns>The ID of the event.</returns>
+	virtual EventId RegisterEvent(const std::string& eventNamespace, const std::string& eventName) = 0;
+
+	/// <summary>
+	/// Adds a callback to be called when the specified event occurs.
+	/// </summary>
+	/// <param name="eventId">The ID of the event, from RegisterEvent.</param>
+	/// <param name="callback">The callback.</param>
+	/// <returns>True if the callback was added, false if the event ID is invalid.</returns>
+	virtual bool OnEvent(EventId eventId, EventCallback callback) = 0;
+
+	/// <summary>
+	/// Unregisters an EventCallback.
+	/// </summary>
+	/// <param name="eventId">The ID of the event, from RegisterEvent.</param>
+	/// <param name="callback">The callback.</param>
+	/// <returns>True if the callback was removed.</returns>
+	virtual bool RemoveOnEvent(EventId eventId, EventCallback callback) = 0;
+
+	/// <summary>
+	/// Calls each of the registered callbacks for the specified event.
+	/// </summary>
+	/// <param name="eventId">The ID of the event, from RegisterEvent.</param>
+	/// <param name="param">The parameter to pass to the callbacks.</param>
+	virtual void Event(EventId eventId, void* param = 0) = 0;
+
+	/// <summary>
+	/// Gets the contents of dewrito.json. The file is only parsed again when it changes, so this is cheap enough to call whenever you need it.
+	/// The returned config is never modified, hold on to it for as long as you like.
+	/// </summary>
+	/// <returns>The config, never null (if the file couldn't be loaded the config will be empty and have an error explaining why).</returns>
+	virtual std::shared_ptr<const DewritoConfig> GetDewritoConfig() = 0;
+};
+
+#define ENGINE_INTERFACE_VERSION002 "Engine002"
+
+/*class IEngine003 : public IEngine002
 {
 
 };
 
-#define ENGINE_INTERFACE_VERSION002 "Engine002"*/
+#define ENGINE_INTERFACE_VERSION003 "Engine003"*/
 
-typedef IEngine001 IEngine;
-#define ENGINE_INTERFACE_LATEST ENGINE_INTERFACE_VERSION001
+typedef IEngine002 IEngine;
+#define ENGINE_INTERFACE_LATEST ENGINE_INTERFACE_VERSION002
@@ -258,12 +258,45 @@ public:
 also update the IPatchManager typedef and PATCHMANAGER_INTERFACE_LATEST define
 and edit Engine::CreateInterface to include this interface */
 
-/*class IPatchManager002 : public IPatchManager001
+class IPatchManager002 : public IPatchManager001
+{
+public:
+	/// <summary>
+	/// Enables/disables a patch, and says why if it couldn't be.
+	/// </summary>
+	/// <param name="patch">The patch.</param>
+	/// <param name="enable">Whether to enable it or not.</param>
+	/// <param name="error">Set to what went wrong if the patch couldn't be changed.</param>
+	/// <returns>true if the patch is now enabled/disabled, false if memory didn't hold what was expected or couldn't be written (nothing is changed).</returns>
+	virtual bool TryEnablePatch(Patch* patch, bool enable, std::string& error) = 0;
+
+	/// <summary>
+	/// Enables/disables a hook, and says why if it couldn't be.
+	/// </summary>
+	/// <param name="hook">The hook.</param>
+	/// <param name="enable">Whether to enable it or not.</param>
+	/// <param name="error">Set to what went wrong if the hook couldn't be changed.</param>
+	/// <returns>true if the hook is now enabled/disabled, false if memory didn't hold what was expected or couldn't be written (nothing is changed).</returns>
+	virtual bool TryEnableHook(Hook* hook, bool enable, std::string& error) = 0;
+
+	/// <summary>
+	/// Enables/disables a patch set (and all children patches/hooks), and says why if it couldn't be.
+	/// </summary>
+	/// <param name="patchSet">The patch set.</param>
+	/// <param name="enable">Whether to enable it or not.</param>
+	/// <param name="error">Set to what went wrong if the patch set couldn't be changed.</param>
+	/// <returns>true if the patch set is now enabled/disabled, false if any of it couldn't be (none of it is changed).</returns>
+	virtual bool TryEnablePatchSet(PatchSet* patchSet, bool enable, std::string& error) = 0;
+};
+
+#define PATCHMANAGER_INTERFACE_VERSION002 "PatchManager002"
+
+/*class IPatchManager003 : public IPatchManager002
 {
 
 };
 
-#define PATCHMANAGER_INTERFACE_VERSION002 "PatchManager002"*/
+#define PATCHMANAGER_INTERFACE_VERSION003 "PatchManager003"*/
 
-typedef IPatchManager001 IPatchManager;
-#define PATCHMANAGER_INTERFACE_LATEST PATCHMANAGER_INTERFACE_VERSION001
+typedef IPatchManager002 IPatchManager;
+#define PATCHMANAGER_INTERFACE_LATEST PATCHMANAGER_INTERFACE_VERSION002
@@ -11,6 +11,8 @@ enum class HttpRequestError
 	HttpSetCredentialsFailed,
 	HttpOpenRequestFailed,
 	HttpDownloadFailed,
+	HostBackedOff, // the host failed recently, request wasn't sent
+	TimedOut, // HttpSendPooledRequests stopped waiting for it, it might still have been sent
 };
 
 struct HttpRequest
@@ -21,6 +23,9 @@ struct HttpRequest
 	std::vector<BYTE> ResponseBody;
 };
 
+// called once queued data has been signed, on the signing thread
+typedef void(__cdecl *SignatureCallback)(bool succeeded, const std::string& signature, void* param);
+
 enum class UPnPErrorType
 {
 	None,
@@ -110,12 +115,73 @@ public:
 also update the IUtils typedef and UTILS_INTERFACE_LATEST define
 and edit Engine::CreateInterface to include this interface */
 
-/*class IUtils002 : public IUtils001
+class IUtils002 : public IUtils001
+{
+public:
+	/// <summary>
+	/// Sends a HTTP request over a shared session that keeps connections to each host alive between requests.
+	/// Hosts that keep failing are backed off for a while, requests to them fail with HttpRequestError::HostBackedOff until then.
+	/// </summary>
+	/// <param name="uri">The URI to send the request to.</param>
+	/// <param name="method">The HTTP method (GET/POST/etc).</param>
+	/// <param name="userAgent">The user agent to send.</param>
+	/// <param name="headers">Any extra headers to send, each ending with \r\n.</param>
+	/// <param name="body">The request body, or NULL.</param>
+	/// <param name="bodySize">The size of the request body.</param>
+	/// <returns>The response.</returns>
+	virtual HttpRequest HttpSendPooledRequest(const std::wstring& uri, const std::wstring& method, const std::wstring& userAgent, const std::wstring& headers, void* body, DWORD bodySize) = 0;
+
+	/// <summary>
+	/// Sends the same request to multiple URIs at once (eg. each master server) and waits for them to finish, using the same session as HttpSendPooledRequest.
+	/// Only a few requests are sent at a time, and it stops waiting after 10 seconds.
+	/// </summary>
+	/// <param name="uris">The URIs to send the request to.</param>
+	/// <param name="method">The HTTP method (GET/POST/etc).</param>
+	/// <param name="userAgent">The user agent to send.</param>
+	/// <param name="headers">Any extra headers to send, each ending with \r\n.</param>
+	/// <param name="body">The request body, or NULL.</param>
+	/// <param name="bodySize">The size of the request body.</param>
+	/// <returns>The response from each URI, in the same order as uris. Error is HttpRequestError::TimedOut for any that didn't finish in time.</returns>
+	virtual std::vector<HttpRequest> HttpSendPooledRequests(const std::vector<std::wstring>& uris, const std::wstring& method, const std::wstring& userAgent, const std::wstring& headers, void* body, DWORD bodySize) = 0;
+
+	/// <summary>
+	/// Signs a batch of data with the same private key. Keys are cached after they're first parsed, so signing with the same key again is cheap.
+	/// </summary>
+	/// <param name="privateKey">The private key, formatted with RSAReformatKey.</param>
+	/// <param name="data">The data to sign.</param>
+	/// <param name="signatures">Filled with the Base64 signature for each item in data, in the same order.</param>
+	/// <returns>true if every item was signed.</returns>
+	virtual bool RSACreateSignatures(const std::string& privateKey, const std::vector<std::string>& data, std::vector<std::string>& signatures) = 0;
+
+	/// <summary>
+	/// Checks a batch of signatures made with the same key.
+	/// </summary>
+	/// <param name="pubKey">The public key, formatted with RSAReformatKey.</param>
+	/// <param name="data">The data that was signed.</param>
+	/// <param name="signatures">The Base64 signature for each item in data.</param>
+	/// <param name="results">Filled with whether each signature is valid, in the same order as data.</param>
+	/// <returns>The number of valid signatures.</returns>
+	virtual size_t RSAVerifySignatures(const std::string& pubKey, const std::vector<std::string>& data, const std::vector<std::string>& signatures, std::vector<bool>& results) = 0;
+
+	/// <summary>
+	/// Queues data to be signed on the signing thread, so the caller doesn't have to wait for it.
+	/// </summary>
+	/// <param name="privateKey">The private key, formatted with RSAReformatKey.</param>
+	/// <param name="data">The data to sign.</param>
+	/// <param name="callback">Called on the signing thread once the data has been signed (or signing failed).</param>
+	/// <param name="param">Passed to the callback.</param>
+	/// <returns>false if the signing queue is full, the callback won't be called.</returns>
+	virtual bool RSAQueueSignature(const std::string& privateKey, const std::string& data, SignatureCallback callback, void* param) = 0;
+};
+
+#define UTILS_INTERFACE_VERSION002 "Utils002"
+
+/*class IUtils003 : public IUtils002
 {
 
 };
 
-#define UTILS_INTERFACE_VERSION002 "Utils002"*/
+#define UTILS_INTERFACE_VERSION003 "Utils003"*/
 
-typedef IUtils001 IUtils;
-#define UTILS_INTERFACE_LATEST UTILS_INTERFACE_VERSION001
+typedef IUtils002 IUtils;
+#define UTILS_INTERFACE_LATEST UTILS_INTERFACE_VERSION002
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+namespace Utils
+{
+	// Fixed-capacity FIFO, once it's full pushing an item replaces the oldest one
+	// The slots are reused, so pushing into a full buffer of strings/vectors can reuse their memory instead of allocating
+	template<class T>
+	class RingBuffer
+	{
+	public:
+		explicit RingBuffer(size_t capacity)
+			: items(capacity > 0 ? capacity : 1), start(0), count(0)
+		{
+		}
+
+		size_t Size() const { return count; }
+		size_t Capacity() const { return items.size(); }
+		bool Empty() const { return count == 0; }
+		bool Full() const { return count == items.size(); }
+
+		// Gets an item, index 0 is the oldest one.
+		T& At(size_t index) { return items[(start + index) % items.size()]; }
+		const T& At(size_t index) const { return items[(start + index) % items.size()]; }
+
+		// Gets the newest item.
+		T& Back() { return At(count - 1); }
+		const T& Back() const { return At(count - 1); }
+
+		// Makes room for a new item and returns its slot, the slot still holds whatever was in it before (if the buffer was full that's the oldest item).
+		T& Push()
+		{
+			if (count < items.size())
+				return items[(start + count++) % items.size()];
+
+			auto& slot = items[start];
+			start = (start + 1) % items.size();
+			return slot;
+		}
+
+		void Push(const T& item)
+		{
+			Push() = item;
+		}
+
+		void Clear()
+		{
+			start = 0;
+			count = 0;
+		}
+
+		// Changes the capacity, if the buffer holds more items than the new capacity then only the newest ones are kept.
+		void SetCapacity(size_t capacity)
+		{
+			if (capacity == 0)
+				capacity = 1;
+			if (capacity == items.size())
+				return;
+
+			auto keep = count < capacity ? count : capacity;
+			std::vector<T> newItems(capacity);
+			for (size_t i = 0; i < keep; i++)
+				newItems[i] = std::move(At(count - keep + i));
+
+			items.swap(newItems);
+			start = 0;
+			count = keep;
+		}
+
+	private:
+		std::vector<T> items;
+		size_t start; // index of the oldest item
+		size_t count;
+	};
+}
@@ -0,0 +1,266 @@
+#include "Blf.hpp"
+
+namespace
+{
+	const uint16_t ByteOrderMark = 0xFFFE;
+	const uint16_t HeaderMajorVersion = 1;
+	const uint16_t HeaderMinorVersion = 2;
+	const uint16_t EndMajorVersion = 1;
+	const uint16_t EndMinorVersion = 1;
+
+	// _eof data: the length of everything before the chunk, the auth type, and then the auth data
+	const size_t EndLengthOffset = 0;
+	const size_t EndAuthTypeOffset = 4;
+	const size_t EndAuthDataOffset = 5;
+
+	struct CrcTable
+	{
+		uint32_t Entries[256];
+
+		CrcTable()
+		{
+			for (uint32_t i = 0; i < 256; i++)
+			{
+				auto crc = i;
+				for (auto j = 0; j < 8; j++)
+					crc = (crc & 1) ? (crc >> 1) ^ 0xEDB88320 : crc >> 1;
+				Entries[i] = crc;
+			}
+		}
+	} crcTable;
+
+	uint32_t ReadUInt32(const uint8_t* data, Blam::Blf::ByteOrder order)
+	{
+		if (order == Blam::Blf::ByteOrder::Big)
+			return (static_cast<uint32_t>(data[0]) << 24) | (data[1] << 16) | (data[2] << 8) | data[3];
+		return (static_cast<uint32_t>(data[3]) << 24) | (data[2] << 16) | (data[1] << 8) | data[0];
+	}
+
+	uint16_t ReadUInt16(const uint8_t* data, Blam::Blf::ByteOrder order)
+	{
+		if (order == Blam::Blf::ByteOrder::Big)
+			return static_cast<uint16_t>((data[0] << 8) | data[1]);
+		return static_cast<uint16_t>((data[1] << 8) | data[0]);
+	}
+}
+
+namespace Blam
+{
+	namespace Blf
+	{
+		const char* GetErrorString(Error error)
+		{
+			switch (error)
+			{
+			case Error::None:
+				return "No error";
+			case Error::TooSmall:
+				return "File is too small";
+			case Error::NotBlf:
+				return "Not a BLF file";
+			case Error::BadChunkSize:
+				return "Chunk has an invalid size";
+			case Error::MissingEnd:
+				return "Missing _eof chunk";
+			case Error::BadEnd:
+				return "Invalid _eof chunk";
+			case Error::ChecksumMismatch:
+				return "Checksum mismatch";
+			case Error::MissingChunk:
+				return "Missing chunk";
+			case Error::ChunkTooBig:
+				return "Variant is too big";
+			default:
+				return "Unknown error";
+			}
+		}
+
+		Reader::Reader(const void* data, size_t size)
+			: data(static_cast<const uint8_t*>(data)), size(size), offset(0), order(ByteOrder::Little), error(Error::None), startError(Error::None), done(false)
+		{
+			// the byte order is only stored inside the _blf chunk, so go by which way round the tag reads instead
+			if (size < ChunkHeaderSize)
+				startError = Error::TooSmall;
+			else if (ReadUInt32(this->data, ByteOrder::Little) == HeaderTag)
+				order = ByteOrder::Little;
+			else if (ReadUInt32(this->data, ByteOrder::Big) == HeaderTag)
+				order = ByteOrder::Big;
+			else
+				startError = Error::NotBlf;
+
+			Reset();
+		}
+
+		void Reader::Reset()
+		{
+			offset = 0;
+			error = startError;
+			done = error != Error::None;
+		}
+
+		bool Reader::Next(Chunk& chunk)
+		{
+			if (done)
+				return false;
+
+			if (size - offset < ChunkHeaderSize)
+			{
+				error = Error::MissingEnd;
+				done = true;
+				return false;
+			}
+
+			auto header = data + offset;
+			chunk.Header.Tag = ReadUInt32(header, order);
+			chunk.Header.Size = ReadUInt32(header + 4, order);
+			chunk.Header.MajorVersion = ReadUInt16(header + 8, order);
+			chunk.Header.MinorVersion = ReadUInt16(header + 10, order);
+			if (chunk.Header.Size < ChunkHeaderSize || chunk.Header.Size > size - offset)
+			{
+				error = Error::BadChunkSize;
+				done = true;
+				return false;
+			}
+
+			chunk.Offset = offset;
+			chunk.Data = header + ChunkHeaderSize;
+			chunk.DataSize = chunk.Header.Size - ChunkHeaderSize;
+			offset += chunk.Header.Size;
+			if (chunk.Header.Tag == EndTag)
+				done = true;
+			return true;
+		}
+
+		bool Reader::Find(uint32_t tag, Chunk& chunk)
+		{
+			Reset();
+			while (Next(chunk))
+			{
+				if (chunk.Header.Tag == tag)
+					return true;
+			}
+			if (error == Error::None)
+				error = Error::MissingChunk;
+			return false;
+		}
+
+		bool IsBlf(const void* data, size_t size)
+		{
+			Reader reader(data, size);
+			Chunk chunk;
+			return reader.Next(chunk) && chunk.Header.Tag == HeaderTag;
+		}
+
+		Error Validate(const void* data, size_t size, bool checkEnd)
+		{
+			Reader reader(data, size);
+			Chunk chunk;
+			while (reader.Next(chunk))
+			{
+			}
+			if (reader.GetError() != Error::None || !checkEnd)
+				return reader.GetError();
+
+			// chunk is the _eof chunk now, otherwise the reader would have run out first
+			uint32_t length;
+			uint8_t authType;
+			if (!reader.Read(chunk, EndLengthOffset, length) || !reader.Read(chunk, EndAuthTypeOffset, authType) || length != chunk.Offset)
+				return Error::BadEnd;
+
+			// SHA1 and RSA need the game's keys to check, so only CRCs get verified
+			if (authType == static_cast<uint8_t>(AuthType::Crc))
+			{
+				uint32_t crc;
+				if (!reader.Read(chunk, EndAuthDataOffset, crc))
+					return Error::BadEnd;
+				if (crc != Crc32(data, chunk.Offset))
+					return Error::ChecksumMismatch;
+			}
+			return Error::None;
+		}
+
+		Error ReadIntoBuffer(const void* data, size_t size, uint32_t tag, size_t bufferSize, std::vector<uint8_t>& out)
+		{
+			auto error = Validate(data, size);
+			if (error != Error::None)
+				return error;
+
+			Reader reader(data, size);
+			Chunk chunk;
+			if (!reader.Find(tag, chunk))
+				return reader.GetError();
+			if (chunk.Offset + chunk.Header.Size > bufferSize)
+				return Error::ChunkTooBig;
+
+			out.assign(bufferSize, 0);
+			memcpy(out.data(), data, size < bufferSize ? size : bufferSize);
+			return Error::None;
+		}
+
+		uint32_t Crc32(const void* data, size_t size)
+		{
+			auto bytes = static_cast<const uint8_t*>(data);
+			uint32_t crc = 0xFFFFFFFF;
+			for (size_t i = 0; i < size; i++)
+				crc = crcTable.Entries[(crc ^ bytes[i]) & 0xFF] ^ (crc >> 8);
+			return ~crc;
+		}
+
+		Writer::Writer(const std::string& name, ByteOrder order)
+			: order(order)
+		{
+			uint8_t header[2 + HeaderNameSize + 2] = { 0 };
+			header[0] = static_cast<uint8_t>(order == ByteOrder::Big ? ByteOrderMark >> 8 : ByteOrderMark & 0xFF);
+			header[1] = static_cast<uint8_t>(order == ByteOrder::Big ? ByteOrderMark & 0xFF : ByteOrderMark >> 8);
+			memcpy(header + 2, name.c_str(), name.length() < HeaderNameSize ? name.length() : HeaderNameSize - 1);
+			WriteChunk(HeaderTag, HeaderMajorVersion, HeaderMinorVersion, header, sizeof(header));
+		}
+
+		void Writer::WriteChunk(uint32_t tag, uint16_t majorVersion, uint16_t minorVersion, const void* data, size_t size)
+		{
+			if (finished)
+				return;
+
+			writeChunkHeader(tag, static_cast<uint32_t>(ChunkHeaderSize + size), majorVersion, minorVersion);
+			auto bytes = static_cast<const uint8_t*>(data);
+			buffer.insert(buffer.end(), bytes, bytes + size);
+		}
+
+		const std::vector<uint8_t>& Writer::Finish(AuthType auth)
+		{
+			if (finished)
+				return buffer;
+
+			auto length = static_cast<uint32_t>(buffer.size());
+			auto size = ChunkHeaderSize + EndAuthDataOffset + (auth == AuthType::Crc ? 4 : 0);
+
+			// the CRC covers everything before the _eof chunk, so it has to be worked out before the chunk gets added
+			auto crc = Crc32(buffer.data(), buffer.size());
+			writeChunkHeader(EndTag, static_cast<uint32_t>(size), EndMajorVersion, EndMinorVersion);
+			writeValue(length, 4);
+			writeValue(static_cast<uint8_t>(auth), 1);
+			if (auth == AuthType::Crc)
+				writeValue(crc, 4);
+
+			finished = true;
+			return buffer;
+		}
+
+		void Writer::writeChunkHeader(uint32_t tag, uint32_t size, uint16_t majorVersion, uint16_t minorVersion)
+		{
+			writeValue(tag, 4);
+			writeValue(size, 4);
+			writeValue(majorVersion, 2);
+			writeValue(minorVersion, 2);
+		}
+
+		void Writer::writeValue(uint64_t val, size_t size)
+		{
+			for (size_t i = 0; i < size; i++)
+			{
+				auto shift = (order == ByteOrder::Big) ? (size - 1 - i) * 8 : i * 8;
+				buffer.push_back(static_cast<uint8_t>(val >> shift));
+			}
+		}
+	}
+}
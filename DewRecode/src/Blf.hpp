@@ -0,0 +1,161 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// reads and writes BLF files (map variants, game variants and other saved content)
+// a BLF is a list of chunks, each starting with a tag and size. The first chunk is always _blf and the last is always _eof,
+// which holds the length of everything before it and optionally a checksum of it.
+// files can be in either byte order: the game writes little-endian ones, but files from the 360 are big-endian.
+namespace Blam
+{
+	namespace Blf
+	{
+		// chunk tags, as they read in the file's byte order
+		const uint32_t HeaderTag = '_blf';
+		const uint32_t ContentHeaderTag = 'chdr';
+		const uint32_t MapVariantTag = 'mapv';
+		const uint32_t GameVariantTag = 'mpvr';
+		const uint32_t EndTag = '_eof';
+
+		const size_t ChunkHeaderSize = 0xC;
+		const size_t HeaderNameSize = 0x20;
+
+		// sizes of the buffers the game's variant parsers read from
+		const size_t MapVariantBufferSize = 0xE1F0;
+		const size_t GameVariantBufferSize = 0x3BC;
+
+		enum class ByteOrder
+		{
+			Little,
+			Big
+		};
+
+		// how the data before the _eof chunk is authenticated, only CRC can be checked without the game's keys
+		enum class AuthType : uint8_t
+		{
+			None,
+			Crc,
+			Sha1,
+			Rsa
+		};
+
+		enum class Error
+		{
+			None,
+			TooSmall,         // not big enough to hold a chunk header
+			NotBlf,           // doesn't start with a _blf chunk
+			BadChunkSize,     // a chunk's size is smaller than its header or goes past the end of the data
+			MissingEnd,       // ran out of chunks before reaching _eof
+			BadEnd,           // the _eof chunk is too small or its length doesn't match where it is
+			ChecksumMismatch, // the CRC in the _eof chunk doesn't match
+			MissingChunk,     // a chunk that was needed isn't in the file
+			ChunkTooBig       // a chunk that was needed doesn't fit in the buffer the game parses it from
+		};
+
+		const char* GetErrorString(Error error);
+
+		struct ChunkHeader
+		{
+			uint32_t Tag;
+			uint32_t Size; // includes the header
+			uint16_t MajorVersion;
+			uint16_t MinorVersion;
+		};
+
+		struct Chunk
+		{
+			ChunkHeader Header;
+			size_t Offset; // offset of the chunk header from the start of the file
+			const uint8_t* Data;
+			size_t DataSize;
+		};
+
+		// steps through the chunks in a buffer, every chunk is checked to fit in the buffer before it's returned
+		// the buffer isn't copied, so it has to stay alive as long as the reader and any chunks from it
+		class Reader
+		{
+		public:
+			Reader(const void* data, size_t size);
+
+			// Gets the next chunk, returns false after the _eof chunk or if the data is malformed (see GetError).
+			bool Next(Chunk& chunk);
+
+			// Finds the first chunk with a tag, starting from the beginning of the file.
+			bool Find(uint32_t tag, Chunk& chunk);
+
+			// Goes back to the first chunk.
+			void Reset();
+
+			Error GetError() const { return error; }
+			ByteOrder GetByteOrder() const { return order; }
+
+			// Reads a value from a chunk's data in the file's byte order, returns false if it's out of bounds.
+			template<class T>
+			bool Read(const Chunk& chunk, size_t offset, T& out) const
+			{
+				if (offset > chunk.DataSize || chunk.DataSize - offset < sizeof(T))
+					return false;
+
+				uint8_t bytes[sizeof(T)];
+				memcpy(bytes, chunk.Data + offset, sizeof(T));
+				if (order == ByteOrder::Big)
+				{
+					for (size_t i = 0; i < sizeof(T) / 2; i++)
+					{
+						auto temp = bytes[i];
+						bytes[i] = bytes[sizeof(T) - 1 - i];
+						bytes[sizeof(T) - 1 - i] = temp;
+					}
+				}
+				memcpy(&out, bytes, sizeof(T));
+				return true;
+			}
+
+		private:
+			const uint8_t* data;
+			size_t size;
+			size_t offset;
+			ByteOrder order;
+			Error error;
+			Error startError; // error from checking the _blf chunk, Reset goes back to it
+			bool done;
+		};
+
+		// Checks if data starts with a _blf chunk, in either byte order.
+		bool IsBlf(const void* data, size_t size);
+
+		// Checks a whole file: it has to start with _blf, every chunk has to fit, and it has to end with an _eof chunk.
+		// Anything after the _eof chunk is ignored, the game pads some files out to a fixed size.
+		// The length and checksum in the _eof chunk are only checked if checkEnd is set. Nothing needs them to read the file, and we can't be
+		// sure every tool (or the game itself) fills them in the same way Writer does, so by default they don't get a file rejected.
+		Error Validate(const void* data, size_t size, bool checkEnd = false);
+
+		// Gets a file ready to be handed to one of the game's parsers, which read from a fixed-size buffer: the file has to pass Validate, and the
+		// chunk with the given tag has to fit inside bufferSize bytes. out gets the file padded with zeroes (or cut off) to bufferSize.
+		Error ReadIntoBuffer(const void* data, size_t size, uint32_t tag, size_t bufferSize, std::vector<uint8_t>& out);
+
+		uint32_t Crc32(const void* data, size_t size);
+
+		// builds a BLF file in memory, chunk data is written as-is so it has to already be in the right byte order
+		class Writer
+		{
+		public:
+			explicit Writer(const std::string& name, ByteOrder order = ByteOrder::Little);
+
+			void WriteChunk(uint32_t tag, uint16_t majorVersion, uint16_t minorVersion, const void* data, size_t size);
+
+			// Adds the _eof chunk and returns the finished file, nothing else can be written after this.
+			const std::vector<uint8_t>& Finish(AuthType auth = AuthType::Crc);
+
+		private:
+			std::vector<uint8_t> buffer;
+			ByteOrder order;
+			bool finished = false;
+
+			void writeChunkHeader(uint32_t tag, uint32_t size, uint16_t majorVersion, uint16_t minorVersion);
+			void writeValue(uint64_t val, size_t size);
+		};
+	}
+}
@@ -0,0 +1,82 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+
+// list of callbacks (tick/event/WndProc) that can be changed while it's being dispatched
+// a callback that's removed during a dispatch (eg. one that removes itself) just gets skipped, the list is only compacted once the
+// outermost dispatch finishes, so removing one never shifts the one after it into the slot that's already been called
+// callbacks added during a dispatch are called from the next dispatch onwards
+template<class T>
+class CallbackList
+{
+public:
+	struct Entry
+	{
+		T Callback;
+		uint32_t Zone; // profiler zone the callback is timed in
+		bool Removed;
+	};
+
+	void Add(T callback, uint32_t zone = 0)
+	{
+		Entry entry;
+		entry.Callback = callback;
+		entry.Zone = zone;
+		entry.Removed = false;
+		entries.push_back(entry);
+		liveCount++;
+	}
+
+	// Removes every registration of a callback, returns false if it wasn't registered.
+	bool Remove(T callback)
+	{
+		auto found = false;
+		for (auto& entry : entries)
+		{
+			if (entry.Removed || entry.Callback != callback)
+				continue;
+			entry.Removed = true;
+			liveCount--;
+			found = true;
+		}
+		if (found && dispatchDepth == 0)
+			compact();
+		return found;
+	}
+
+	bool IsEmpty() const { return liveCount == 0; }
+	size_t Count() const { return liveCount; }
+
+	// Calls func(entry) for each callback that was registered when the dispatch started and hasn't been removed since.
+	template<class Func>
+	void Dispatch(Func func)
+	{
+		auto count = entries.size();
+		dispatchDepth++;
+		for (size_t i = 0; i < count; i++)
+		{
+			if (entries[i].Removed)
+				continue;
+			auto entry = entries[i]; // copied, a callback that adds another could reallocate the vector while it runs
+			func(entry);
+		}
+		if (--dispatchDepth == 0 && liveCount != entries.size())
+			compact();
+	}
+
+private:
+	std::vector<Entry> entries;
+	size_t liveCount = 0;
+	int dispatchDepth = 0;
+
+	void compact()
+	{
+		size_t j = 0;
+		for (size_t i = 0; i < entries.size(); i++)
+		{
+			if (!entries[i].Removed)
+				entries[j++] = entries[i];
+		}
+		entries.resize(j);
+	}
+};
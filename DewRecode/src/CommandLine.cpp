@@ -0,0 +1,124 @@
+#include "CommandLine.hpp"
+
+/// <summary>
+/// Splits part of a command line into the command name + its arguments.
+/// </summary>
+/// <param name="line">The command line.</param>
+/// <param name="start">Offset of the first character to split.</param>
+/// <param name="end">Offset of the character after the last one to split.</param>
+/// <param name="name">Returns the command name.</param>
+/// <param name="args">Returns the arguments, strings already in it are reused.</param>
+/// <param name="spare">Strings that args doesn't need any more get moved here, and are taken back out when args needs more.</param>
+/// <returns>false if there was nothing to split.</returns>
+bool TokenizeCommandLine(const std::string& line, size_t start, size_t end, std::string& name, std::vector<std::string>& args, std::vector<std::string>& spare)
+{
+	// same rules CommandLineToArgvA used to have: space/tab/CR/LF seperate arguments, quotes toggle quoted mode (where whitespace is kept)
+	// and are never part of the argument, a quote can start an argument or appear in the middle of one, there's no escape character
+	// token strings are reused, so a caller that keeps name/args around won't allocate after the first few lines
+	size_t argCount = 0;
+	std::string* current = nullptr;
+	bool inQuotes = false;
+	bool inToken = false;
+
+	for (auto i = start; i < end; i++)
+	{
+		auto c = line[i];
+		if (c == '\0')
+			break; // CommandLineToArgvA worked on C strings
+
+		if (inQuotes)
+		{
+			if (c == '\"')
+				inQuotes = false;
+			else
+				current->push_back(c);
+			continue;
+		}
+
+		switch (c)
+		{
+		case ' ':
+		case '\t':
+		case '\n':
+		case '\r':
+			inToken = false;
+			continue;
+		case '\"':
+			inQuotes = true;
+			break;
+		}
+
+		if (!inToken)
+		{
+			// start a new argument
+			if (!current)
+				current = &name;
+			else
+			{
+				if (argCount >= args.size())
+				{
+					if (spare.empty())
+						args.push_back(std::string());
+					else
+					{
+						args.push_back(std::move(spare.back()));
+						spare.pop_back();
+					}
+				}
+				current = &args[argCount++];
+			}
+			current->clear();
+			inToken = true;
+		}
+
+		if (c != '\"')
+			current->push_back(c);
+	}
+
+	// don't resize, that would free the strings of any arguments the last line had that this one doesn't
+	while (args.size() > argCount)
+	{
+		spare.push_back(std::move(args.back()));
+		args.pop_back();
+	}
+	return current != nullptr;
+}
+
+/// <summary>
+/// Splits a command line into the command name + its arguments.
+/// </summary>
+/// <param name="line">The command line.</param>
+/// <param name="name">Returns the command name.</param>
+/// <param name="args">Returns the arguments.</param>
+/// <returns>false if the line is empty.</returns>
+bool TokenizeCommandLine(const std::string& line, std::string& name, std::vector<std::string>& args)
+{
+	std::vector<std::string> spare;
+	return TokenizeCommandLine(line, 0, line.length(), name, args, spare);
+}
+
+/// <summary>
+/// Splits a command string into a compiled command, building the press/release arguments if it's a hold command.
+/// </summary>
+/// <param name="command">The command string, starting with a + if it's a hold command.</param>
+/// <param name="name">Returns the command name.</param>
+/// <param name="compiled">Returns the compiled command, Target and Generation are left alone.</param>
+/// <returns>false if the command string is empty.</returns>
+bool CompileCommandLine(const std::string& command, std::string& name, CompiledCommand& compiled)
+{
+	compiled.IsHold = !command.empty() && command[0] == '+';
+	std::vector<std::string> spare;
+	if (!TokenizeCommandLine(command, compiled.IsHold ? 1 : 0, command.length(), name, compiled.Arguments, spare))
+		return false;
+
+	compiled.PressArguments.clear();
+	compiled.ReleaseArguments.clear();
+	if (compiled.IsHold)
+	{
+		compiled.PressArguments = compiled.Arguments;
+		compiled.PressArguments.push_back("1");
+		compiled.ReleaseArguments = compiled.Arguments;
+		compiled.ReleaseArguments.push_back("0");
+	}
+	return true;
+}
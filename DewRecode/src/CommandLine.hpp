@@ -0,0 +1,26 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <ElDorito/ICommands.hpp>
+
+// a command string that has already been split + looked up, so it can be ran repeatedly without parsing it again (eg. key bindings)
+struct CompiledCommand
+{
+	Command* Target = nullptr;
+	std::vector<std::string> Arguments;
+	bool IsHold = false; // command started with a +, see Input.Bind
+	std::vector<std::string> PressArguments; // hold commands only: Arguments + "1", ran when the key goes down
+	std::vector<std::string> ReleaseArguments; // hold commands only: Arguments + "0", ran when the key comes back up
+	unsigned int Generation = 0; // value of Commands::generation when this was compiled, if they differ the command needs compiling again
+};
+
+// Splits a command line into the command name + its arguments, returns false if the line is empty
+bool TokenizeCommandLine(const std::string& line, std::string& name, std::vector<std::string>& args);
+
+// Splits the [start, end) part of a command line, for running through a list of lines without copying each one
+// args that aren't needed any more get moved into spare (and taken back out of it later) so their strings keep their capacity
+bool TokenizeCommandLine(const std::string& line, size_t start, size_t end, std::string& name, std::vector<std::string>& args, std::vector<std::string>& spare);
+
+// Splits a command string into a CompiledCommand (everything but Target/Generation), returns false if it's empty
+// a + at the start makes it a hold command, which gets its press/release arguments built here so running it doesn't have to copy anything
+bool CompileCommandLine(const std::string& command, std::string& name, CompiledCommand& compiled);
@@ -0,0 +1,28 @@
+#pragma once
+#include <string>
+#include <cctype>
+#include <cstring>
+
+// case-insensitive hash/compare for command names, so lookups don't have to lowercase the name first
+struct CommandNameHash
+{
+	size_t operator()(const std::string& name) const
+	{
+		// FNV-1a over the lowercased name
+		size_t hash = 2166136261U;
+		for (auto c : name)
+		{
+			hash ^= (size_t)tolower((unsigned char)c);
+			hash *= 16777619U;
+		}
+		return hash;
+	}
+};
+
+struct CommandNameEqual
+{
+	bool operator()(const std::string& lhs, const std::string& rhs) const
+	{
+		return lhs.length() == rhs.length() && !_stricmp(lhs.c_str(), rhs.c_str());
+	}
+};
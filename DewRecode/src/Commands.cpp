@@ -1,4 +1,5 @@
 #include "Commands.hpp"
+#include "CommandLine.hpp"
 #include <algorithm>
 #include <sstream>
 #include "ElDorito.hpp"
@@ -22,8 +23,21 @@ Command* Commands::Add(Command command)
 		return nullptr;
 
 	this->List.push_back(command);
+	auto* added = &this->List.back();
 
-	return &this->List.back();
+	if (!added->Name.empty())
+		commandIndex[added->Name] = added;
+	if (!added->ShortName.empty())
+		commandIndex[added->ShortName] = added;
+	if (!added->ModuleName.empty())
+		moduleIndex[added->ModuleName].push_back(added);
+
+	if (added->Flags & eCommandFlagsReplicated)
+		replication.Add(added);
+
+	generation++; // invalidates any compiled commands
+
+	return added;
 }
 
 /// <summary>
@@ -37,6 +51,7 @@ void Commands::FinishAdd()
 			if (command.UpdateEvent)
 				command.UpdateEvent(std::vector<std::string>(), std::string());
 	}
+	finishedAdding = true;
 }
 
 /// <summary>
@@ -46,11 +61,31 @@ void Commands::FinishAdd()
 /// <returns>A pointer to the command, if found.</returns>
 Command* Commands::Find(const std::string& name)
 {
-	for (auto it = List.begin(); it < List.end(); it++)
-		if ((!it->Name.empty() && !_stricmp(it->Name.c_str(), name.c_str())) || (!it->ShortName.empty() && !_stricmp(it->ShortName.c_str(), name.c_str())))
-			return &(*it);
+	if (name.empty())
+		return nullptr;
+
+	auto it = commandIndex.find(name);
+	if (it == commandIndex.end())
+		return nullptr;
+
+	return it->second;
+}
+
+/// <summary>
+/// Finds the commands belonging to a module.
+/// </summary>
+/// <param name="moduleName">The name of the module.</param>
+/// <returns>A pointer to the modules command list, or nullptr if no commands belong to the module.</returns>
+const std::vector<Command*>* Commands::FindModule(const std::string& moduleName)
+{
+	if (moduleName.empty())
+		return nullptr;
+
+	auto it = moduleIndex.find(moduleName);
+	if (it == moduleIndex.end())
+		return nullptr;
 
-	return nullptr;
+	return &it->second;
 }
 
 /// <summary>
@@ -61,11 +96,14 @@ Command* Commands::Find(const std::string& name)
 /// <returns>The output of the executed command.</returns>
 std::string Commands::Execute(const std::vector<std::string>& command, bool isUserInput)
 {
-	std::string commandStr = "";
-	for (auto cmd : command)
-		commandStr += "\"" + cmd + "\" ";
+	if (command.size() <= 0)
+		return "Invalid input";
 
-	return Execute(commandStr, isUserInput);
+	// already split, so pass the arguments straight through instead of quoting + parsing them again
+	std::vector<std::string> argsVect(command.begin() + 1, command.end());
+	std::string output;
+	ExecuteCommand(Find(command[0]), argsVect, isUserInput, output);
+	return output;
 }
 
 /// <summary>
@@ -76,73 +114,131 @@ std::string Commands::Execute(const std::vector<std::string>& command, bool isUs
 /// <returns>The output of the executed command.</returns>
 std::string Commands::Execute(const std::string& command, bool isUserInput)
 {
-	int numArgs = 0;
-	auto args = CommandLineToArgvA((char*)command.c_str(), &numArgs);
-
-	if (numArgs <= 0)
+	std::string name;
+	std::vector<std::string> argsVect;
+	if (!TokenizeCommandLine(command, name, argsVect))
 		return "Invalid input";
 
-	auto cmd = Find(args[0]);
+	std::string output;
+	ExecuteCommand(Find(name), argsVect, isUserInput, output);
+	return output;
+}
+
+/// <summary>
+/// Executes a compiled command.
+/// </summary>
+/// <param name="compiled">The compiled command.</param>
+/// <param name="isUserInput">Whether the command came from the user or internally.</param>
+/// <returns>The output of the executed command.</returns>
+std::string Commands::Execute(const CompiledCommand& compiled, bool isUserInput)
+{
+	std::string output;
+	ExecuteCommand(compiled.Target, compiled.Arguments, isUserInput, output);
+	return output;
+}
+
+/// <summary>
+/// Executes a compiled hold command (eg. a +Player.Jump binding) with the argument for the key being pressed or released.
+/// </summary>
+/// <param name="compiled">The compiled command.</param>
+/// <param name="pressed">true if the key was pressed, false if it was released.</param>
+/// <param name="isUserInput">Whether the command came from the user or internally.</param>
+/// <returns>The output of the executed command.</returns>
+std::string Commands::ExecuteHold(const CompiledCommand& compiled, bool pressed, bool isUserInput)
+{
+	std::string output;
+	ExecuteCommand(compiled.Target, pressed ? compiled.PressArguments : compiled.ReleaseArguments, isUserInput, output);
+	return output;
+}
+
+/// <summary>
+/// Executes a command/variable with arguments that have already been split, every Execute* method ends up here.
+/// </summary>
+/// <param name="cmd">The command to execute (can be null if the lookup failed).</param>
+/// <param name="argsVect">The arguments to pass to the command.</param>
+/// <param name="isUserInput">Whether the command came from the user or internally.</param>
+/// <param name="output">Returns the output of the executed command.</param>
+/// <returns>Whether the command executed successfully.</returns>
+bool Commands::ExecuteCommand(Command* cmd, const std::vector<std::string>& argsVect, bool isUserInput, std::string& output)
+{
 	if (!cmd || (isUserInput && cmd->Flags & eCommandFlagsInternal))
-		return "Command/Variable not found";
+	{
+		output = "Command/Variable not found";
+		return false;
+	}
 
 	if ((cmd->Flags & eCommandFlagsRunOnMainMenu) && !ElDorito::Instance().Engine.HasMainMenuShown())
 	{
-		queuedCommands.push_back(command);
-		return "Command queued until mainmenu shows";
+		// this applies to config files too, that's what the flag is for: archived variables like Server.MaxPlayers can only be applied
+		// once the game's ready, and would fail + get reverted if dewrito_prefs.cfg set them straight away
+		// the arguments are already split, so they're queued as they are (quoting them into a string would break any with quotes in them)
+		std::vector<std::string> queued;
+		queued.reserve(argsVect.size() + 1);
+		queued.push_back(cmd->Name);
+		queued.insert(queued.end(), argsVect.begin(), argsVect.end());
+
+		queuedCommands.push_back(std::move(queued));
+		output = "Command queued until mainmenu shows";
+		return true;
 	}
 
 	auto* session = ElDorito::Instance().Engine.GetActiveNetworkSession();
 
 	if ((cmd->Flags & eCommandFlagsMustBeHosting))
 		if (!session || !session->IsEstablished() || !session->IsHost())
-			return "You must be hosting a game to use this command";
+		{
+			output = "You must be hosting a game to use this command";
+			return false;
+		}
 
 	if ((cmd->Flags & eCommandFlagsReplicated))
 		if (session && session->IsEstablished() && !session->IsHost())
-			return "You must be at the main menu or hosting a game to use this command";
-
-	std::vector<std::string> argsVect;
-	if (numArgs > 1)
-		for (int i = 1; i < numArgs; i++)
-			argsVect.push_back(args[i]);
+		{
+			output = "You must be at the main menu or hosting a game to use this command";
+			return false;
+		}
 
 	if (cmd->Type == CommandType::Command)
-	{
-		std::string retInfo;
-		cmd->UpdateEvent(argsVect, retInfo); // if it's a command call it and return
-		return retInfo;
-	}
+		return cmd->UpdateEvent(argsVect, output); // if it's a command call it and return
 
 	std::string previousValue;
-	auto updateRet = SetVariable(cmd, (numArgs > 1 ? argsVect[0] : ""), previousValue);
+	auto updateRet = SetVariable(cmd, (argsVect.size() > 0 ? argsVect[0] : ""), previousValue);
 
 	switch (updateRet)
 	{
 	case VariableSetReturnValue::Error:
-		return "Command/Variable not found";
+		output = "Command/Variable not found";
+		return false;
 	case VariableSetReturnValue::InvalidArgument:
-		return "Invalid value";
+		output = "Invalid value";
+		return false;
 	case VariableSetReturnValue::OutOfRange:
 		if (cmd->Type == CommandType::VariableInt)
-			return "Value " + argsVect[0] + " out of range [" + std::to_string(cmd->ValueIntMin) + ".." + std::to_string(cmd->ValueIntMax) + "]";
-		if (cmd->Type == CommandType::VariableInt64)
-			return "Value " + argsVect[0] + " out of range [" + std::to_string(cmd->ValueInt64Min) + ".." + std::to_string(cmd->ValueInt64Max) + "]";
-		if (cmd->Type == CommandType::VariableFloat)
-			return "Value " + argsVect[0] + " out of range [" + std::to_string(cmd->ValueFloatMin) + ".." + std::to_string(cmd->ValueFloatMax) + "]";
-
-		return "Value " + argsVect[0] + " out of range [this shouldn't be happening!]";
+			output = "Value " + argsVect[0] + " out of range [" + std::to_string(cmd->ValueIntMin) + ".." + std::to_string(cmd->ValueIntMax) + "]";
+		else if (cmd->Type == CommandType::VariableInt64)
+			output = "Value " + argsVect[0] + " out of range [" + std::to_string(cmd->ValueInt64Min) + ".." + std::to_string(cmd->ValueInt64Max) + "]";
+		else if (cmd->Type == CommandType::VariableFloat)
+			output = "Value " + argsVect[0] + " out of range [" + std::to_string(cmd->ValueFloatMin) + ".." + std::to_string(cmd->ValueFloatMax) + "]";
+		else
+			output = "Value " + argsVect[0] + " out of range [this shouldn't be happening!]";
+		return false;
 	}
 
 	// special case for blanking strings
-	if (cmd->Type == CommandType::VariableString && numArgs > 1 && argsVect[0].empty())
+	if (cmd->Type == CommandType::VariableString && argsVect.size() > 0 && argsVect[0].empty())
 		cmd->ValueString = "";
 
-	if (numArgs <= 1)
-		return previousValue;
+	if (argsVect.size() <= 0)
+	{
+		output = previousValue;
+		return true;
+	}
 
 	if (!cmd->UpdateEvent)
-		return previousValue + " -> " + cmd->ValueString; // no update event, so we'll just return with what we set the value to
+	{
+		output = previousValue + " -> " + cmd->ValueString; // no update event, so we'll just return with what we set the value to
+		return true;
+	}
 
 	std::string retVal;
 	auto ret = cmd->UpdateEvent(argsVect, retVal);
@@ -151,9 +247,31 @@ std::string Commands::Execute(const std::string& command, bool isUserInput)
 		this->SetVariable(cmd, previousValue, std::string());
 
 	if (retVal.empty())
-		return previousValue + " -> " + cmd->ValueString;
+		output = previousValue + " -> " + cmd->ValueString;
+	else
+		output = retVal;
+
+	return ret;
+}
+
+/// <summary>
+/// Splits a command string and resolves the command it refers to, so it can be executed repeatedly without being parsed again.
+/// If the string starts with a + it's treated as a hold command (see Input.Bind)
+/// </summary>
+/// <param name="command">The command string.</param>
+/// <param name="compiled">Returns the compiled command.</param>
+/// <returns>true if the command was found.</returns>
+bool Commands::Compile(const std::string& command, CompiledCommand& compiled)
+{
+	compiled = CompiledCommand();
+	compiled.Generation = generation;
 
-	return retVal;
+	std::string name;
+	if (!CompileCommandLine(command, name, compiled))
+		return false;
+
+	compiled.Target = Find(name);
+	return compiled.Target != nullptr;
 }
 
 /// <summary>
@@ -164,16 +282,27 @@ std::string Commands::Execute(const std::string& command, bool isUserInput)
 /// <returns>Whether the command executed successfully.</returns>
 std::string Commands::ExecuteList(const std::string& commands, bool isUserInput)
 {
-	std::istringstream stream(commands);
 	std::stringstream ss;
-	std::string line;
+	std::string name;
+	std::string output;
+	std::vector<std::string> argsVect; // reused for each line so the token strings keep their capacity
+	std::vector<std::string> spareArgs;
 	int lineIdx = 0;
-	while (std::getline(stream, line))
+	size_t lineStart = 0;
+	while (lineStart < commands.length())
 	{
-		if (!this->ExecuteWithStatus(line, isUserInput))
-		{
+		auto lineEnd = commands.find('\n', lineStart);
+		if (lineEnd == std::string::npos)
+			lineEnd = commands.length();
+
+		bool success = false;
+		if (TokenizeCommandLine(commands, lineStart, lineEnd, name, argsVect, spareArgs))
+			success = ExecuteCommand(Find(name), argsVect, isUserInput, output);
+
+		if (!success)
 			ss << "Error at line " << lineIdx << std::endl;
-		}
+
+		lineStart = lineEnd + 1;
 		lineIdx++;
 	}
 	return ss.str();
@@ -187,47 +316,13 @@ std::string Commands::ExecuteList(const std::string& commands, bool isUserInput)
 /// <returns>Whether the command executed successfully.</returns>
 bool Commands::ExecuteWithStatus(const std::string& command, bool isUserInput)
 {
-	int numArgs = 0;
-	auto args = CommandLineToArgvA((char*)command.c_str(), &numArgs);
-
-	if (numArgs <= 0)
-		return false;
-
-	auto cmd = Find(args[0]);
-	if (!cmd || (isUserInput && cmd->Flags & eCommandFlagsInternal))
-		return false;
-
+	std::string name;
 	std::vector<std::string> argsVect;
-	if (numArgs > 1)
-		for (int i = 1; i < numArgs; i++)
-			argsVect.push_back(args[i]);
-
-	if (cmd->Type == CommandType::Command)
-	{
-		cmd->UpdateEvent(argsVect, std::string()); // if it's a command call it and return
-		return true;
-	}
-
-	std::string previousValue;
-	auto updateRet = SetVariable(cmd, (numArgs > 1 ? argsVect[0] : ""), previousValue);
-
-	if (updateRet != VariableSetReturnValue::Success)
+	if (!TokenizeCommandLine(command, name, argsVect))
 		return false;
 
-	if (numArgs <= 1)
-		return true;
-
-	if (!cmd->UpdateEvent)
-		return true; // no update event, so we'll just return with what we set the value to
-
-	auto ret = cmd->UpdateEvent(argsVect, std::string());
-
-	if (ret) // error, revert the variable
-		return true;
-
-	// error, revert the variable
-	this->SetVariable(cmd, previousValue, std::string());
-	return false;
+	std::string output;
+	return ExecuteCommand(Find(name), argsVect, isUserInput, output);
 }
 
 /// <summary>
@@ -237,7 +332,7 @@ bool Commands::ExecuteWithStatus(const std::string& command, bool isUserInput)
 std::string Commands::ExecuteQueue()
 {
 	std::stringstream ss;
-	for (auto cmd : queuedCommands)
+	for (auto& cmd : queuedCommands)
 	{
 		ss << Execute(cmd, true) << std::endl;
 	}
@@ -334,6 +429,12 @@ VariableSetReturnValue Commands::SetVariable(const std::string& name, const std:
 /// <returns>VariableSetReturnValue</returns>
 VariableSetReturnValue Commands::SetVariable(Command* command, const std::string& value, std::string& previousValue)
 {
+	// only replicated variables need the old value kept around, so the generation is only bumped if it actually changed
+	auto replicated = replication.Contains(command);
+	std::string oldValue;
+	if (replicated)
+		oldValue = command->ValueString;
+
 	try {
 		switch (command->Type)
 		{
@@ -389,12 +490,26 @@ VariableSetReturnValue Commands::SetVariable(Command* command, const std::string
 		return VariableSetReturnValue::InvalidArgument;
 	}
 
+	if (replicated)
+		replication.Update(command, oldValue);
+
 	return VariableSetReturnValue::Success;
 }
 
-bool compare_commands(const Command& lhs, const Command& rhs)
+/// <summary>
+/// Gets the replicated variables that changed after a generation, so only the differences have to be sent to clients.
+/// </summary>
+/// <param name="sinceGeneration">The generation the receiver is up to date with, 0 to get every replicated variable.</param>
+/// <param name="variables">Filled with the variables that changed, in the order they were added.</param>
+/// <returns>false if sinceGeneration is newer than the current generation (eg. it came from before a restart), variables is filled with every replicated variable instead.</returns>
+bool Commands::GetReplicatedVariables(unsigned int sinceGeneration, std::vector<ReplicatedVariable>& variables)
+{
+	return replication.GetChangedSince(sinceGeneration, variables);
+}
+
+bool compare_commands(const Command* lhs, const Command* rhs)
 {
-	return lhs.Name < rhs.Name;
+	return lhs->Name < rhs->Name;
 }
 
 /// <summary>
@@ -404,26 +519,43 @@ bool compare_commands(const Command& lhs, const Command& rhs)
 /// <returns>Help text.</returns>
 std::string Commands::GenerateHelpText(const std::string& moduleFilter)
 {
-	std::deque<Command> tempCommands(List);
+	// sort pointers instead of copying the whole command list
+	std::vector<Command*> moduleCommandsSorted;
+	if (!moduleFilter.empty())
+	{
+		auto* moduleCommands = FindModule(moduleFilter);
+		if (!moduleCommands)
+			return "";
 
-	std::sort(tempCommands.begin(), tempCommands.end(), compare_commands);
+		moduleCommandsSorted = *moduleCommands;
+		std::sort(moduleCommandsSorted.begin(), moduleCommandsSorted.end(), compare_commands);
+	}
+	else if (sortedGeneration != generation || sortedCommands.size() != List.size())
+	{
+		sortedCommands.clear();
+		sortedCommands.reserve(List.size());
+		for (auto& cmd : List)
+			sortedCommands.push_back(&cmd);
+
+		std::sort(sortedCommands.begin(), sortedCommands.end(), compare_commands);
+		sortedGeneration = generation;
+	}
+
+	auto& tempCommands = moduleFilter.empty() ? sortedCommands : moduleCommandsSorted;
 	std::stringstream ss;
 	std::stringstream hasParent; // store commands with a parent module seperately, so they can be added to the main stringstream after the non-parent commands
 	for (auto cmd : tempCommands)
 	{
-		if (cmd.Flags & eCommandFlagsHidden || cmd.Flags & eCommandFlagsInternal)
+		if (cmd->Flags & eCommandFlagsHidden || cmd->Flags & eCommandFlagsInternal)
 			continue;
 
-		if (!moduleFilter.empty() && (cmd.ModuleName.empty() || _stricmp(cmd.ModuleName.c_str(), moduleFilter.c_str())))
-			continue;
-
-		std::string helpText = cmd.Name;
-		if (cmd.Type != CommandType::Command && !(cmd.Flags & eCommandFlagsOmitValueInList))
-			helpText += " " + cmd.ValueString;
+		std::string helpText = cmd->Name;
+		if (cmd->Type != CommandType::Command && !(cmd->Flags & eCommandFlagsOmitValueInList))
+			helpText += " " + cmd->ValueString;
 
-		helpText += " - " + cmd.Description;
+		helpText += " - " + cmd->Description;
 
-		if (!cmd.ModuleName.empty())
+		if (!cmd->ModuleName.empty())
 			hasParent << helpText << std::endl;
 		else
 			ss << helpText << std::endl;
@@ -533,16 +665,20 @@ BindingReturnValue Commands::AddBinding(const std::string& key, const std::strin
 	auto keyCode = it->second;
 	auto binding = &bindings[static_cast<int>(keyCode)];
 
+	auto compiled = &compiledBindings[static_cast<int>(keyCode)];
+
 	// If no command was specified, unset the binding
 	if (command.empty())
 	{
 		binding->command.clear();
+		*compiled = CompiledCommand();
 		return BindingReturnValue::ClearedBinding;
 	}
 
 	// Set the binding
 	binding->key = actualKey;
 	binding->command = command;
+	Compile(command, *compiled);
 	return BindingReturnValue::Success;
 }
 
@@ -575,6 +711,99 @@ KeyBinding* Commands::GetBinding(int keyCode)
 	return &bindings[keyCode];
 }
 
+/// <summary>
+/// Gets the compiled command for a keycode, recompiling it if commands were added since it was last compiled.
+/// </summary>
+/// <param name="keyCode">The key code.</param>
+/// <returns>A pointer to the CompiledCommand for this key code.</returns>
+CompiledCommand* Commands::GetCompiledBinding(int keyCode)
+{
+	if (keyCode < 0 || keyCode >= Blam::NumKeyCodes)
+		return nullptr;
+
+	auto compiled = &compiledBindings[keyCode];
+	auto& binding = bindings[keyCode];
+	if (compiled->Generation != generation && !binding.command.empty())
+		Compile(binding.command, *compiled);
+
+	return compiled;
+}
+
+/// <summary>
+/// Gets the tab completion index for command names (full names, short names and module names), rebuilding it if commands were added since it was last built.
+/// </summary>
+/// <returns>The index, which is empty until FinishAdd has been called.</returns>
+const CompletionIndex& Commands::GetCompletionIndex()
+{
+	if (!finishedAdding || completionGeneration == generation)
+		return completionIndex;
+
+	completionIndex.Clear();
+	for (auto& cmd : List)
+	{
+		if (cmd.Flags & eCommandFlagsHidden || cmd.Flags & eCommandFlagsInternal)
+			continue;
+
+		completionIndex.Add(cmd.Name);
+		completionIndex.Add(cmd.ShortName);
+		if (!cmd.ModuleName.empty())
+			completionIndex.Add(cmd.ModuleName + ".");
+	}
+	completionIndex.Build();
+	completionGeneration = generation;
+	return completionIndex;
+}
+
+/// <summary>
+/// Sets the function that gives the values a command accepts, for tab completing its arguments.
+/// </summary>
+/// <param name="name">The name of the command.</param>
+/// <param name="func">The function, or null to remove it.</param>
+void Commands::SetValueCompletion(const std::string& name, ValueCompletionFunc func)
+{
+	if (!func)
+	{
+		valueCompletions.erase(name);
+		return;
+	}
+	valueCompletions[name].Func = func;
+}
+
+/// <summary>
+/// Gets the tab completion index for a command's values.
+/// </summary>
+/// <param name="name">The name or short name of the command.</param>
+/// <returns>The index, or null if the command doesn't have any values to complete.</returns>
+const CompletionIndex* Commands::GetValueCompletionIndex(const std::string& name)
+{
+	auto cmd = Find(name);
+	if (!cmd)
+		return nullptr;
+
+	auto it = valueCompletions.find(cmd->Name);
+	if (it == valueCompletions.end())
+		return nullptr;
+
+	std::vector<std::string> values;
+	it->second.Func(values);
+
+	auto& index = it->second.Index;
+	index.Clear();
+	for (auto& value : values)
+		index.Add(value);
+	index.Build();
+	return &index;
+}
+
+/// <summary>
+/// Value completion function for commands that take a key name.
+/// </summary>
+void Commands::CompleteKeyNames(std::vector<std::string>& values)
+{
+	for (auto& key : keyCodes)
+		values.push_back(key.first);
+}
+
 namespace
 {
 	// Key codes table
@@ -686,90 +915,4 @@ namespace
 		{ "ctrl", Blam::KeyCode::Ctrl },
 		{ "alt", Blam::KeyCode::Alt },
 	};
-
-	char** CommandLineToArgvA(char* CmdLine, int* _argc)
-	{
-		char** argv;
-		char*  _argv;
-		unsigned long len;
-		unsigned long argc;
-		char   a;
-		unsigned long i, j;
-
-		bool in_QM;
-		bool in_TEXT;
-		bool in_SPACE;
-
-		len = strlen(CmdLine);
-		i = ((len + 2) / 2)*sizeof(void*) + sizeof(void*);
-
-		argv = (char**)malloc(i + (len + 2)*sizeof(char));
-		//argv = (char**)GlobalAlloc(GMEM_FIXED,
-		//	i + (len + 2)*sizeof(char));
-
-		if (!argv)
-			return 0;
-
-		_argv = (char*)(((unsigned char*)argv) + i);
-
-		argc = 0;
-		argv[argc] = _argv;
-		in_QM = false;
-		in_TEXT = false;
-		in_SPACE = true;
-		i = 0;
-		j = 0;
-
-		while (a = CmdLine[i]) {
-			if (in_QM) {
-				if (a == '\"') {
-					in_QM = false;
-				}
-				else {
-					_argv[j] = a;
-					j++;
-				}
-			}
-			else {
-				switch (a) {
-				case '\"':
-					in_QM = true;
-					in_TEXT = true;
-					if (in_SPACE) {
-						argv[argc] = _argv + j;
-						argc++;
-					}
-					in_SPACE = false;
-					break;
-				case ' ':
-				case '\t':
-				case '\n':
-				case '\r':
-					if (in_TEXT) {
-						_argv[j] = '\0';
-						j++;
-					}
-					in_TEXT = false;
-					in_SPACE = true;
-					break;
-				default:
-					in_TEXT = true;
-					if (in_SPACE) {
-						argv[argc] = _argv + j;
-						argc++;
-					}
-					_argv[j] = a;
-					j++;
-					in_SPACE = false;
-					break;
-				}
-			}
-			i++;
-		}
-		_argv[j] = '\0';
-		argv[argc] = NULL;
-
-		(*_argc) = argc;
-		return argv;
-	}
-}
\ No newline at end of file
+}
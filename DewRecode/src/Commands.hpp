@@ -1,11 +1,16 @@
 #pragma once
 #include <ElDorito/ElDorito.hpp>
 #include <ElDorito/Blam/BlamInput.hpp>
+#include <unordered_map>
+#include "CompletionIndex.hpp"
+#include "CommandName.hpp"
+#include "CommandLine.hpp"
+#include "ReplicationTable.hpp"
 
-namespace
-{
-	char** CommandLineToArgvA(char* CmdLine, int* _argc);
-}
+typedef std::unordered_map<std::string, Command*, CommandNameHash, CommandNameEqual> CommandIndex;
+
+// fills a list with the values a command/variable accepts (eg. key names for Input.Bind), used for tab completion
+typedef void(*ValueCompletionFunc)(std::vector<std::string>& values);
 
 // if you make any changes to this class make sure to update the exported interface (create a new interface + inherit from it if the interface already shipped)
 class Commands : public ICommands
@@ -40,10 +45,57 @@ public:
 	KeyBinding* GetBinding(const std::string& key);
 	KeyBinding* GetBinding(int keyCode);
 
+	unsigned int GetReplicationGeneration() { return replication.GetGeneration(); }
+	bool GetReplicatedVariables(unsigned int sinceGeneration, std::vector<ReplicatedVariable>& variables);
+
+	// functions that aren't exposed over ICommands interface
+	const std::vector<Command*>* FindModule(const std::string& moduleName);
+	bool Compile(const std::string& command, CompiledCommand& compiled);
+	std::string Execute(const CompiledCommand& compiled, bool isUserInput = false);
+	std::string ExecuteHold(const CompiledCommand& compiled, bool pressed, bool isUserInput = false);
+	CompiledCommand* GetCompiledBinding(int keyCode);
+
+	const CompletionIndex& GetCompletionIndex();
+	void SetValueCompletion(const std::string& name, ValueCompletionFunc func);
+	const CompletionIndex* GetValueCompletionIndex(const std::string& name);
+	static void CompleteKeyNames(std::vector<std::string>& values);
+
 	std::deque<Command> List;
 private:
-	std::vector<std::string> queuedCommands;
+	bool ExecuteCommand(Command* cmd, const std::vector<std::string>& argsVect, bool isUserInput, std::string& output);
+
+	std::vector<std::vector<std::string>> queuedCommands; // name followed by the arguments
+
+	// bumped whenever the command list changes
+	unsigned int generation = 0;
+
+	// Name/ShortName -> command, pointers stay valid since List is a deque that we only push_back to
+	CommandIndex commandIndex;
+
+	// ModuleName -> commands belonging to that module
+	std::unordered_map<std::string, std::vector<Command*>, CommandNameHash, CommandNameEqual> moduleIndex;
+
+	// commands sorted by name for the help text, only re-sorted when the list changes
+	std::vector<Command*> sortedCommands;
+	unsigned int sortedGeneration = 0;
+
+	// command names, short names and module names for tab completion, built the first time it's needed after FinishAdd
+	bool finishedAdding = false;
+	CompletionIndex completionIndex;
+	unsigned int completionGeneration = 0;
+
+	// command name -> the values it accepts, the index for a command is rebuilt each time it's requested since the values can change (eg. maps)
+	struct ValueCompletion
+	{
+		ValueCompletionFunc Func;
+		CompletionIndex Index;
+	};
+	std::unordered_map<std::string, ValueCompletion, CommandNameHash, CommandNameEqual> valueCompletions;
+
+	// replicated variables with the generation each one last changed in
+	ReplicationTable replication;
 
 	// Bindings for each key
 	KeyBinding bindings[Blam::NumKeyCodes];
+	CompiledCommand compiledBindings[Blam::NumKeyCodes];
 };
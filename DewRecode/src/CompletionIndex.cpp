@@ -0,0 +1,304 @@
+#include "CompletionIndex.hpp"
+#include <algorithm>
+#include <cctype>
+
+namespace
+{
+	const int NoMatch = -1000000;
+
+	char ToLowerChar(char c)
+	{
+		return (char)tolower((unsigned char)c);
+	}
+
+	std::string ToLowerString(const std::string& str)
+	{
+		std::string result(str);
+		for (auto& c : result)
+			c = ToLowerChar(c);
+		return result;
+	}
+
+	// whether a character starts a "word" in a name, eg. the M in Game.Map or the B in ServerBrowser
+	bool IsWordStart(const std::string& str, size_t index)
+	{
+		if (index == 0)
+			return true;
+		char prev = str[index - 1];
+		if (prev == '.' || prev == '_' || prev == '-' || prev == ' ')
+			return true;
+		return isupper((unsigned char)str[index]) && islower((unsigned char)prev);
+	}
+}
+
+void CompletionIndex::Clear()
+{
+	entries.clear();
+	nodes.clear();
+	built = false;
+}
+
+void CompletionIndex::Add(const std::string& str)
+{
+	if (str.empty())
+		return;
+
+	Entry entry;
+	entry.Text = str;
+	entry.Key = ToLowerString(str);
+	entries.push_back(entry);
+	built = false;
+}
+
+/// <summary>
+/// Sorts the strings that have been added and builds the trie, strings that only differ by case are only kept once.
+/// </summary>
+void CompletionIndex::Build()
+{
+	std::stable_sort(entries.begin(), entries.end(), [](const Entry& lhs, const Entry& rhs) { return lhs.Key < rhs.Key; });
+	entries.erase(std::unique(entries.begin(), entries.end(), [](const Entry& lhs, const Entry& rhs) { return lhs.Key == rhs.Key; }), entries.end());
+
+	nodes.clear();
+	buildNode("", 0, 0, entries.size());
+	built = true;
+	buildCount++;
+}
+
+/// <summary>
+/// Builds the node for a range of entries which all start with the same depth characters.
+/// </summary>
+/// <returns>The index of the node.</returns>
+int CompletionIndex::buildNode(const std::string& edge, size_t depth, size_t first, size_t last)
+{
+	int index = (int)nodes.size();
+	nodes.push_back(Node());
+	nodes[index].Edge = edge;
+	nodes[index].First = first;
+	nodes[index].Last = last;
+
+	// entries that end at this node sort before everything else in the range
+	auto i = first;
+	while (i < last && entries[i].Key.length() == depth)
+		i++;
+
+	while (i < last)
+	{
+		// group the entries by their next character, the group shares everything up to where its first and last entries differ
+		auto groupFirst = i;
+		char c = entries[i].Key[depth];
+		while (i < last && entries[i].Key[depth] == c)
+			i++;
+
+		auto& firstKey = entries[groupFirst].Key;
+		auto& lastKey = entries[i - 1].Key;
+		auto length = depth + 1;
+		while (length < firstKey.length() && length < lastKey.length() && firstKey[length] == lastKey[length])
+			length++;
+
+		int child = buildNode(firstKey.substr(depth, length - depth), length, groupFirst, i);
+		nodes[index].Children.push_back(child);
+	}
+	return index;
+}
+
+int CompletionIndex::findChild(const Node& node, char c) const
+{
+	for (auto child : node.Children)
+	{
+		if (nodes[child].Edge[0] == c)
+			return child;
+	}
+	return -1;
+}
+
+/// <summary>
+/// Gets a cursor that matches every string in the index.
+/// </summary>
+CompletionIndex::Cursor CompletionIndex::Begin() const
+{
+	Cursor cursor;
+	cursor.Valid = built && !nodes.empty();
+	cursor.BuildCount = buildCount;
+	return cursor;
+}
+
+/// <summary>
+/// Narrows a cursor down by another character (case-insensitive).
+/// </summary>
+/// <returns>false if no strings match any more.</returns>
+bool CompletionIndex::Advance(Cursor& cursor, char c) const
+{
+	if (!cursor.Valid || cursor.BuildCount != buildCount)
+		return cursor.Valid = false;
+
+	c = ToLowerChar(c);
+	auto& node = nodes[cursor.Node];
+	if (cursor.EdgeOffset < node.Edge.length())
+	{
+		if (node.Edge[cursor.EdgeOffset] != c)
+			return cursor.Valid = false;
+		cursor.EdgeOffset++;
+	}
+	else
+	{
+		int child = findChild(node, c);
+		if (child < 0)
+			return cursor.Valid = false;
+		cursor.Node = child;
+		cursor.EdgeOffset = 1;
+	}
+	cursor.Length++;
+	return true;
+}
+
+bool CompletionIndex::Advance(Cursor& cursor, const std::string& text) const
+{
+	for (auto c : text)
+	{
+		if (!Advance(cursor, c))
+			return false;
+	}
+	return cursor.Valid;
+}
+
+void CompletionIndex::GetRange(const Cursor& cursor, size_t& first, size_t& last) const
+{
+	first = last = 0;
+	if (!cursor.Valid || cursor.BuildCount != buildCount)
+		return;
+
+	first = nodes[cursor.Node].First;
+	last = nodes[cursor.Node].Last;
+}
+
+/// <summary>
+/// Finds the strings that start with a prefix (case-insensitive), they're the indexes [first, last) in alphabetical order.
+/// </summary>
+void CompletionIndex::FindPrefix(const std::string& prefix, size_t& first, size_t& last) const
+{
+	auto cursor = Begin();
+	Advance(cursor, prefix);
+	GetRange(cursor, first, last);
+}
+
+/// <summary>
+/// Gets the longest prefix shared by a range of strings, eg. to complete as much as possible when there's more than one match.
+/// </summary>
+std::string CompletionIndex::GetCommonPrefix(size_t first, size_t last) const
+{
+	if (first >= last)
+		return "";
+
+	// the range is sorted, so the first and last strings differ the earliest
+	auto& firstKey = entries[first].Key;
+	auto& lastKey = entries[last - 1].Key;
+	size_t length = 0;
+	while (length < firstKey.length() && length < lastKey.length() && firstKey[length] == lastKey[length])
+		length++;
+
+	return entries[first].Text.substr(0, length);
+}
+
+/// <summary>
+/// Finds the strings that best match a pattern as a subsequence (eg. "svnm" matches "Server.Name").
+/// </summary>
+/// <param name="pattern">The text to match.</param>
+/// <param name="maxResults">The maximum number of results to return.</param>
+/// <param name="results">Filled with the best matches, best first.</param>
+void CompletionIndex::FuzzyFind(const std::string& pattern, size_t maxResults, std::vector<FuzzyMatch>& results) const
+{
+	results.clear();
+	for (size_t i = 0; i < entries.size(); i++)
+	{
+		auto score = FuzzyScore(pattern, entries[i].Text);
+		if (score == NoMatch)
+			continue;
+
+		FuzzyMatch match;
+		match.Index = i;
+		match.Score = score;
+		results.push_back(match);
+	}
+
+	// best score first, ties go to the shortest string and then alphabetical order
+	auto compare = [this](const FuzzyMatch& lhs, const FuzzyMatch& rhs)
+	{
+		if (lhs.Score != rhs.Score)
+			return lhs.Score > rhs.Score;
+		if (entries[lhs.Index].Text.length() != entries[rhs.Index].Text.length())
+			return entries[lhs.Index].Text.length() < entries[rhs.Index].Text.length();
+		return lhs.Index < rhs.Index;
+	};
+
+	if (results.size() > maxResults)
+	{
+		std::partial_sort(results.begin(), results.begin() + maxResults, results.end(), compare);
+		results.resize(maxResults);
+	}
+	else
+	{
+		std::sort(results.begin(), results.end(), compare);
+	}
+}
+
+/// <summary>
+/// Scores how well a pattern matches a string as a case-insensitive subsequence.
+/// Characters matched one after another or at the start of a word score higher, characters skipped in between score lower.
+/// </summary>
+/// <returns>The score, or a large negative number if the pattern isn't a subsequence of the string.</returns>
+int CompletionIndex::FuzzyScore(const std::string& pattern, const std::string& str)
+{
+	if (pattern.empty())
+		return 0;
+	if (pattern.length() > str.length())
+		return NoMatch;
+
+	// cur[j] = best score with the current pattern character matched at str[j]
+	// gaps cost 1 per skipped character up to 3, so anything 4 or more back can be tracked with a running maximum
+	std::vector<int> prev(str.length(), NoMatch);
+	std::vector<int> cur(str.length(), NoMatch);
+	for (size_t i = 0; i < pattern.length(); i++)
+	{
+		char pc = ToLowerChar(pattern[i]);
+		int farBest = NoMatch;
+		for (size_t j = 0; j < str.length(); j++)
+		{
+			if (i > 0 && j >= 5 && prev[j - 5] > farBest)
+				farBest = prev[j - 5];
+
+			cur[j] = NoMatch;
+			if (ToLowerChar(str[j]) != pc)
+				continue;
+
+			int bonus = IsWordStart(str, j) ? 9 : 1;
+			if (i == 0)
+			{
+				cur[j] = bonus - (int)(j < 3 ? j : 3);
+				continue;
+			}
+
+			int best = NoMatch;
+			if (j >= 1 && prev[j - 1] != NoMatch)
+				best = prev[j - 1] + 5;
+			for (size_t gap = 1; gap <= 3 && gap + 1 <= j; gap++)
+			{
+				if (prev[j - 1 - gap] != NoMatch && prev[j - 1 - gap] - (int)gap > best)
+					best = prev[j - 1 - gap] - (int)gap;
+			}
+			if (farBest != NoMatch && farBest - 3 > best)
+				best = farBest - 3;
+
+			if (best != NoMatch)
+				cur[j] = best + bonus;
+		}
+		prev.swap(cur);
+	}
+
+	int result = NoMatch;
+	for (auto score : prev)
+	{
+		if (score > result)
+			result = score;
+	}
+	return result;
+}
@@ -0,0 +1,80 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <cstdint>
+
+// case-insensitive index of strings for tab completion (command names, key names, map names...)
+// the strings are kept sorted and stored in a radix trie where each node covers a contiguous range of them,
+// so finding everything that starts with a prefix is a walk down the trie and the result is just a range
+// strings that don't start with what was typed can still be found with FuzzyFind, which ranks strings by how well the input matches them as a subsequence
+class CompletionIndex
+{
+public:
+	// position in the trie after matching some text, lets a prefix be narrowed down a character at a time as the user types
+	struct Cursor
+	{
+		int Node = 0;
+		size_t EdgeOffset = 0; // number of characters of the node's edge that have been matched
+		bool Valid = true; // false once the text stops matching anything
+		size_t Length = 0; // number of characters matched so far
+		unsigned int BuildCount = 0; // cursors from before the index was last rebuilt are no longer valid
+	};
+
+	struct FuzzyMatch
+	{
+		size_t Index; // index of the matched string, see Get
+		int Score;
+	};
+
+	void Clear();
+
+	/// <summary>
+	/// Adds a string, the index has to be rebuilt (see Build) before it'll show up in results.
+	/// </summary>
+	void Add(const std::string& str);
+
+	void Build();
+
+	size_t Size() const { return entries.size(); }
+	const std::string& Get(size_t index) const { return entries[index].Text; }
+
+	Cursor Begin() const;
+	bool IsCurrent(const Cursor& cursor) const { return cursor.BuildCount == buildCount; }
+	bool Advance(Cursor& cursor, char c) const;
+	bool Advance(Cursor& cursor, const std::string& text) const;
+
+	/// <summary>
+	/// Gets the range of strings that start with the text matched by a cursor.
+	/// </summary>
+	void GetRange(const Cursor& cursor, size_t& first, size_t& last) const;
+
+	void FindPrefix(const std::string& prefix, size_t& first, size_t& last) const;
+	std::string GetCommonPrefix(size_t first, size_t last) const;
+
+	void FuzzyFind(const std::string& pattern, size_t maxResults, std::vector<FuzzyMatch>& results) const;
+
+	static int FuzzyScore(const std::string& pattern, const std::string& str);
+
+private:
+	struct Entry
+	{
+		std::string Text;
+		std::string Key; // lowercased text
+	};
+
+	struct Node
+	{
+		std::string Edge; // characters leading to this node from its parent
+		std::vector<int> Children; // sorted by the first character of their edge
+		size_t First = 0; // range of entries below this node
+		size_t Last = 0;
+	};
+
+	std::vector<Entry> entries;
+	std::vector<Node> nodes; // node 0 is the root
+	bool built = true;
+	unsigned int buildCount = 0;
+
+	int buildNode(const std::string& edge, size_t depth, size_t first, size_t last);
+	int findChild(const Node& node, char c) const;
+};
@@ -0,0 +1,79 @@
+#pragma once
+#include <ElDorito/Utils/RingBuffer.hpp>
+#include <string>
+#include <vector>
+
+// a line in a console buffer, along with how it was last wrapped so that it doesn't need to be re-wrapped every frame
+struct ConsoleLine
+{
+	std::string Text;
+
+	void Set(const std::string& text)
+	{
+		Text = text;
+		wrapCharWidth = 0;
+		wrapViewportWidth = 0;
+		rows.clear();
+	}
+
+	// Wraps the line to fit a viewport (breaking at a space where possible), returns the number of rows it takes up.
+	// The result is cached until the font width or viewport size changes.
+	size_t Wrap(int charWidth, int viewportWidth)
+	{
+		if (charWidth == wrapCharWidth && viewportWidth == wrapViewportWidth)
+			return rows.empty() ? 1 : rows.size();
+
+		wrapCharWidth = charWidth;
+		wrapViewportWidth = viewportWidth;
+		rows.clear();
+
+		size_t maxChars = (charWidth > 0 && viewportWidth > charWidth) ? viewportWidth / charWidth : 1;
+		if (Text.length() <= maxChars)
+			return 1; // fits, GetRow returns the text itself
+
+		size_t pos = 0;
+		while (pos < Text.length())
+		{
+			auto length = Text.length() - pos;
+			if (length > maxChars)
+			{
+				length = maxChars;
+				auto space = Text.rfind(' ', pos + maxChars);
+				if (space != std::string::npos && space > pos + maxChars / 2)
+					length = space - pos;
+			}
+			rows.push_back(Text.substr(pos, length));
+
+			// don't start the next row with the space(s) we broke at, whether the break was at a space or the row was just full
+			pos += length;
+			while (pos < Text.length() && Text[pos] == ' ')
+				pos++;
+		}
+		return rows.size();
+	}
+
+	// Gets a row from the last call to Wrap.
+	const std::string& GetRow(size_t row) const
+	{
+		return rows.empty() ? Text : rows.at(row);
+	}
+
+private:
+	int wrapCharWidth = 0;
+	int wrapViewportWidth = 0;
+	std::vector<std::string> rows; // empty if the line fits on one row
+};
+
+// the lines and input history the console keeps for a ConsoleBuffer
+// ConsoleBuffer is part of IEngine001 so its layout can't change, PushLine still adds to its Messages vector, the console moves
+// those into here every tick so that only the newest lines are kept (ConsoleBuffer::Messages/InputHistory stay empty)
+struct ConsoleBufferHistory
+{
+	Utils::RingBuffer<ConsoleLine> Lines;
+	Utils::RingBuffer<std::string> InputHistory;
+
+	ConsoleBufferHistory(size_t scrollback, size_t inputHistory)
+		: Lines(scrollback), InputHistory(inputHistory)
+	{
+	}
+};
@@ -0,0 +1,313 @@
+#include "ContentIndexer.hpp"
+#include "Blf.hpp"
+#include <algorithm>
+#include <cstring>
+#include <system_error>
+#include <thread>
+
+namespace
+{
+	const uint32_t CacheMagic = 0x49444345; // "ECDI"
+
+	template<class T>
+	void WriteValue(std::vector<uint8_t>& out, T val)
+	{
+		auto bytes = reinterpret_cast<const uint8_t*>(&val);
+		out.insert(out.end(), bytes, bytes + sizeof(T));
+	}
+
+	template<class T>
+	bool ReadValue(const std::vector<uint8_t>& data, size_t& pos, T& val)
+	{
+		if (data.size() - pos < sizeof(T))
+			return false;
+		memcpy(&val, &data[pos], sizeof(T));
+		pos += sizeof(T);
+		return true;
+	}
+}
+
+ContentIndexer::ContentIndexer(const std::wstring& cacheFile, ContentEnvironment& environment)
+	: cacheFile(cacheFile), environment(environment)
+{
+}
+
+void ContentIndexer::Scan(const std::vector<std::wstring>& roots, std::vector<Item>& items, Stats* stats)
+{
+	auto startTime = environment.GetTime();
+	items.clear();
+
+	if (!cacheLoaded)
+	{
+		loadCache();
+		cacheLoaded = true;
+	}
+
+	ScanJob job;
+	job.Indexer = this;
+	job.Environment = &environment;
+	job.Listing = 0;
+	job.Listed = roots.empty();
+	job.NextFile = 0;
+	job.CacheHits = 0;
+	for (size_t i = 0; i < roots.size(); i++)
+		job.Directories.push_back(std::make_pair(i, roots[i]));
+
+	// the calling thread works through the job too, so it still finishes if none of the extra threads can be started
+	size_t workerCount = std::thread::hardware_concurrency();
+	if (workerCount > MaxWorkers)
+		workerCount = MaxWorkers;
+
+	std::vector<std::thread> threads;
+	for (size_t i = 1; i < workerCount; i++)
+	{
+		try
+		{
+			threads.push_back(std::thread(runWorker, &job));
+		}
+		catch (const std::system_error&)
+		{
+			break;
+		}
+	}
+	runWorker(&job);
+	for (auto& thread : threads)
+		thread.join();
+
+	// the cache is rebuilt from what was found this time, so files that have been deleted drop out of it
+	std::unordered_map<std::wstring, CacheEntry> newCache;
+	for (size_t i = 0; i < job.Files.size(); i++)
+	{
+		if (!job.Readable[i])
+			continue;
+
+		auto& file = job.Files[i];
+		auto& result = job.Results[i];
+		newCache[file.Path] = result;
+		if (!result.IsContent)
+			continue;
+
+		Item item;
+		item.Path = file.Path;
+		memcpy(item.Header, result.Header, HeaderSize);
+		items.push_back(item);
+	}
+
+	size_t cacheHits = job.CacheHits;
+	bool changed = cacheHits != newCache.size() || cache.size() != newCache.size();
+	cache.swap(newCache);
+	if (changed)
+		saveCache();
+
+	if (stats)
+	{
+		stats->Files = job.Files.size();
+		stats->Items = items.size();
+		stats->CacheHits = cacheHits;
+		stats->Milliseconds = environment.GetTime() - startTime;
+	}
+}
+
+void ContentIndexer::runWorker(ScanJob* job)
+{
+	// list directories until there's none left and nobody is still listing one (which could turn up more)
+	{
+		std::unique_lock<std::mutex> lock(job->Lock);
+		while (true)
+		{
+			job->Condition.wait(lock, [job] { return job->Listed || !job->Directories.empty(); });
+			if (job->Listed)
+				break;
+
+			auto dir = job->Directories.front();
+			job->Directories.pop_front();
+			job->Listing++;
+
+			lock.unlock();
+			listDirectory(job, dir.first, dir.second);
+			lock.lock();
+
+			job->Listing--;
+			if (job->Listing == 0 && job->Directories.empty())
+			{
+				// everything's been listed, put the files in a stable order before they get read so the results don't depend on thread timing
+				std::sort(job->Files.begin(), job->Files.end(), [](const FileInfo& lhs, const FileInfo& rhs)
+				{
+					if (lhs.Root != rhs.Root)
+						return lhs.Root < rhs.Root;
+					return lhs.Path < rhs.Path;
+				});
+				job->Results.resize(job->Files.size());
+				job->Readable.resize(job->Files.size(), 0);
+				job->Listed = true;
+				job->Condition.notify_all();
+			}
+		}
+	}
+
+	// the cache isn't modified until every worker has finished, so it's safe to look things up in it from here
+	auto& cache = job->Indexer->cache;
+	for (auto i = job->NextFile++; i < job->Files.size(); i = job->NextFile++)
+	{
+		auto& file = job->Files[i];
+		auto& result = job->Results[i];
+
+		auto cached = cache.find(file.Path);
+		if (cached != cache.end() && cached->second.WriteTime == file.WriteTime && cached->second.Size == file.Size)
+		{
+			result = cached->second;
+			job->Readable[i] = 1;
+			job->CacheHits++;
+			continue;
+		}
+
+		result.WriteTime = file.WriteTime;
+		result.Size = file.Size;
+		job->Readable[i] = readHeader(*job->Environment, file.Path, file.Size, result) ? 1 : 0;
+	}
+}
+
+/// <summary>
+/// Lists a directory, files are added to the job and subdirectories are queued up to be listed.
+/// </summary>
+void ContentIndexer::listDirectory(ScanJob* job, size_t root, const std::wstring& dir)
+{
+	// the listing gives us the write time and size along with the name, so nothing has to be opened to check the cache
+	std::vector<ContentEnvironment::DirectoryEntry> entries;
+	job->Environment->ListDirectory(dir, entries);
+
+	std::vector<std::wstring> dirs;
+	std::vector<FileInfo> files;
+	for (auto& entry : entries)
+	{
+		auto path = dir + L"\\" + entry.Name;
+		if (entry.IsDirectory)
+		{
+			dirs.push_back(path);
+			continue;
+		}
+
+		FileInfo file;
+		file.Root = root;
+		file.Path = path;
+		file.WriteTime = entry.WriteTime;
+		file.Size = entry.Size;
+		files.push_back(file);
+	}
+
+	std::lock_guard<std::mutex> lock(job->Lock);
+	job->Files.insert(job->Files.end(), files.begin(), files.end());
+	for (auto& subdir : dirs)
+		job->Directories.push_back(std::make_pair(root, subdir));
+	if (!dirs.empty())
+		job->Condition.notify_all();
+}
+
+/// <summary>
+/// Reads the start of a file and checks if it's a BLF, if it is then its header data is copied out.
+/// </summary>
+/// <returns>false if the file couldn't be read.</returns>
+bool ContentIndexer::readHeader(ContentEnvironment& environment, const std::wstring& path, uint64_t size, CacheEntry& entry)
+{
+	entry.IsContent = false;
+	memset(entry.Header, 0, HeaderSize);
+	if (size < HeaderOffset)
+		return true; // too small to be a BLF
+
+	// only the start of the file is needed, that's all we look at
+	std::vector<uint8_t> data;
+	if (!environment.ReadFileStart(path, HeaderOffset + HeaderSize, data))
+		return false;
+
+	if (data.size() >= HeaderOffset && Blam::Blf::IsBlf(data.data(), data.size()))
+	{
+		entry.IsContent = true;
+		memcpy(entry.Header, &data[HeaderOffset], data.size() - HeaderOffset);
+	}
+	return true;
+}
+
+/// <summary>
+/// Loads the cache file, a missing, damaged or outdated cache just means everything gets read again.
+/// </summary>
+/// <returns>true if the cache was loaded.</returns>
+bool ContentIndexer::loadCache()
+{
+	cache.clear();
+
+	std::vector<uint8_t> data;
+	if (!environment.ReadFile(cacheFile, data))
+		return false;
+
+	size_t pos = 0;
+	uint32_t magic, version, count;
+	if (!ReadValue(data, pos, magic) || !ReadValue(data, pos, version) || !ReadValue(data, pos, count))
+		return false;
+	if (magic != CacheMagic || version != CacheVersion)
+		return false;
+
+	std::unordered_map<std::wstring, CacheEntry> entries;
+	for (uint32_t i = 0; i < count; i++)
+	{
+		uint16_t pathLength;
+		if (!ReadValue(data, pos, pathLength) || data.size() - pos < pathLength * sizeof(wchar_t))
+			return false;
+
+		std::wstring path(pathLength, L'\0');
+		if (pathLength > 0)
+			memcpy(&path[0], &data[pos], pathLength * sizeof(wchar_t));
+		pos += pathLength * sizeof(wchar_t);
+
+		CacheEntry entry;
+		uint8_t isContent;
+		if (!ReadValue(data, pos, entry.WriteTime) || !ReadValue(data, pos, entry.Size) || !ReadValue(data, pos, isContent))
+			return false;
+
+		entry.IsContent = isContent != 0;
+		memset(entry.Header, 0, HeaderSize);
+		if (entry.IsContent)
+		{
+			if (data.size() - pos < HeaderSize)
+				return false;
+			memcpy(entry.Header, &data[pos], HeaderSize);
+			pos += HeaderSize;
+		}
+		entries[path] = entry;
+	}
+
+	cache.swap(entries);
+	return true;
+}
+
+/// <summary>
+/// Writes the cache file, the environment makes sure a crash halfway through can't leave a truncated cache behind.
+/// </summary>
+/// <returns>true if the cache was written.</returns>
+bool ContentIndexer::saveCache()
+{
+	std::vector<uint8_t> data;
+	WriteValue<uint32_t>(data, CacheMagic);
+	WriteValue<uint32_t>(data, CacheVersion);
+	WriteValue<uint32_t>(data, 0); // count, filled in below
+	uint32_t count = 0;
+	for (auto& pair : cache)
+	{
+		auto pathLength = pair.first.length();
+		if (pathLength > 0xFFFF)
+			continue;
+
+		WriteValue<uint16_t>(data, (uint16_t)pathLength);
+		auto path = reinterpret_cast<const uint8_t*>(pair.first.c_str());
+		data.insert(data.end(), path, path + pathLength * sizeof(wchar_t));
+
+		WriteValue<uint64_t>(data, pair.second.WriteTime);
+		WriteValue<uint64_t>(data, pair.second.Size);
+		WriteValue<uint8_t>(data, pair.second.IsContent ? 1 : 0);
+		if (pair.second.IsContent)
+			data.insert(data.end(), pair.second.Header, pair.second.Header + HeaderSize);
+		count++;
+	}
+	memcpy(&data[8], &count, sizeof(count));
+
+	return environment.ReplaceFile(cacheFile, data);
+}
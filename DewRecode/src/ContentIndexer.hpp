@@ -0,0 +1,125 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// what ContentIndexer needs from the OS, ContentItems passes in the real one (WinContentEnvironment) and the tests keep files in memory
+class ContentEnvironment
+{
+public:
+	struct DirectoryEntry
+	{
+		std::wstring Name;
+		bool IsDirectory;
+		uint64_t WriteTime;
+		uint64_t Size;
+	};
+
+	virtual ~ContentEnvironment() { }
+
+	virtual uint32_t GetTime() = 0; // milliseconds, can wrap
+	virtual void ListDirectory(const std::wstring& dir, std::vector<DirectoryEntry>& entries) = 0; // leaves out . and .., nothing if it can't be listed
+	virtual bool ReadFileStart(const std::wstring& path, size_t length, std::vector<uint8_t>& data) = 0; // up to length bytes from the start of the file
+	virtual bool ReadFile(const std::wstring& path, std::vector<uint8_t>& data) = 0; // false if the file doesn't exist or can't be read
+	virtual bool ReplaceFile(const std::wstring& path, const std::vector<uint8_t>& data) = 0; // must not leave a partly written file behind
+};
+
+// FindFirstFileEx, file mappings for the headers, and writing to a temporary file that gets moved over the old one
+class WinContentEnvironment : public ContentEnvironment
+{
+public:
+	uint32_t GetTime();
+	void ListDirectory(const std::wstring& dir, std::vector<DirectoryEntry>& entries);
+	bool ReadFileStart(const std::wstring& path, size_t length, std::vector<uint8_t>& data);
+	bool ReadFile(const std::wstring& path, std::vector<uint8_t>& data);
+	bool ReplaceFile(const std::wstring& path, const std::vector<uint8_t>& data);
+};
+
+// finds the BLF content (game variants and forge maps) under a set of directories and reads the header data the content items global needs
+// directories are listed and files are read on a pool of worker threads, and only the start of each file is read (WinContentEnvironment maps it instead of fopen/fseek/fread)
+// what was found gets saved to a cache file keyed on each file's path, last write time and size, so files that haven't changed since the last run aren't opened at all
+class ContentIndexer
+{
+public:
+	static const int CacheVersion = 1;
+	static const size_t HeaderOffset = 0x40;
+	static const size_t HeaderSize = 0xF0;
+	static const size_t MaxWorkers = 8;
+
+	struct Item
+	{
+		std::wstring Path;
+		uint8_t Header[HeaderSize]; // the data at HeaderOffset in the file
+	};
+
+	struct Stats
+	{
+		size_t Files = 0;     // number of files found
+		size_t Items = 0;     // number of files that were BLFs
+		size_t CacheHits = 0; // number of files that didn't need to be read
+		uint32_t Milliseconds = 0;
+	};
+
+	ContentIndexer(const std::wstring& cacheFile, ContentEnvironment& environment);
+
+	/// <summary>
+	/// Scans directories (and their subdirectories) for BLF files.
+	/// </summary>
+	/// <param name="roots">The directories to scan.</param>
+	/// <param name="items">Filled with the BLF files, in the same order as roots and then sorted by path.</param>
+	/// <param name="stats">If not null, filled with info about the scan.</param>
+	void Scan(const std::vector<std::wstring>& roots, std::vector<Item>& items, Stats* stats);
+
+private:
+	struct CacheEntry
+	{
+		uint64_t WriteTime;
+		uint64_t Size;
+		bool IsContent; // false if the file isn't a BLF, those are cached too so they don't get opened every time
+		uint8_t Header[HeaderSize];
+	};
+
+	struct FileInfo
+	{
+		size_t Root;
+		std::wstring Path;
+		uint64_t WriteTime;
+		uint64_t Size;
+	};
+
+	struct ScanJob
+	{
+		ContentIndexer* Indexer;
+		ContentEnvironment* Environment;
+
+		std::mutex Lock; // guards everything up to Files
+		std::condition_variable Condition;
+		std::deque<std::pair<size_t, std::wstring>> Directories; // directories waiting to be listed, with the root they're under
+		size_t Listing; // number of directories being listed right now
+		bool Listed; // set once every directory has been listed
+		std::vector<FileInfo> Files;
+
+		// once every directory has been listed, each worker takes the next file until they run out
+		std::atomic<size_t> NextFile;
+		std::vector<CacheEntry> Results; // one for each file
+		std::vector<char> Readable; // 0 if the file couldn't be opened, it's left out of the cache so it'll be tried again next time
+		std::atomic<size_t> CacheHits;
+	};
+
+	std::wstring cacheFile;
+	ContentEnvironment& environment;
+	std::unordered_map<std::wstring, CacheEntry> cache;
+	bool cacheLoaded = false;
+
+	bool loadCache();
+	bool saveCache();
+
+	static void runWorker(ScanJob* job);
+	static void listDirectory(ScanJob* job, size_t root, const std::wstring& dir);
+	static bool readHeader(ContentEnvironment& environment, const std::wstring& path, uint64_t size, CacheEntry& entry);
+};
@@ -7,6 +7,50 @@
 
 #include "ElDorito.hpp"
 
+namespace
+{
+	// put on the end of messages that were too long to fit
+	const char TruncatedMarker[] = " [truncated]";
+}
+
+DebugLog::DebugLog()
+{
+	minSeverity = static_cast<int>(LogSeverity::Debug);
+	dropped = 0;
+	totalDropped = 0;
+	fileNameChanged = true;
+	running = true;
+
+	// game_tick spams the log every frame, exclude it by default (ModuleGame::FiltersExclude starts with this too)
+	filter = std::make_shared<LogFilter>(std::vector<std::string>(), std::vector<std::string>{ "module:game_tick" });
+
+	InitializeCriticalSection(&writerLock);
+	wakeEvent = CreateEvent(NULL, FALSE, FALSE, NULL);
+
+	// we're created inside DllMain, so this thread won't actually start until the loader lock is released, anything logged before then just sits in the queue
+	writerThread = CreateThread(NULL, 0, writerThreadProc, this, 0, NULL);
+}
+
+DebugLog::~DebugLog()
+{
+	// this runs inside DllMain, where we can't wait for the writer (it can't finish exiting until the loader lock is released)
+	// ElDorito::Shutdown stops it before we get here, if that didn't happen the process is exiting and the thread has already been killed
+	running = false;
+
+	// anything logged since the writer's last drain (or everything, if it was killed) gets written out here
+	// if it died while draining the lock is orphaned, so don't wait on it
+	if (TryEnterCriticalSection(&writerLock))
+	{
+		drain();
+		LeaveCriticalSection(&writerLock);
+	}
+
+	if (writerThread)
+		CloseHandle(writerThread);
+	if (wakeEvent)
+		CloseHandle(wakeEvent);
+}
+
 /// <summary>
 /// Logs a line to the log file.
 /// </summary>
@@ -16,40 +60,169 @@
 /// <param name="">Additional formatting.</param>
 void DebugLog::Log(LogSeverity severity, const std::string& module, std::string format, ...)
 {
-	// TODO1: LogSeverity
+	if (static_cast<int>(severity) < minSeverity)
+		return;
 
-	if (format.length() > 4096)
+	if (format.length() > MaxMessageLength)
 		return;
 
 	va_list ap;
 	va_start(ap, format);
 
-	char buff[4096];
-	vsprintf_s(buff, 4096, format.c_str(), ap);
+	char buff[MaxMessageLength];
+	auto length = _vsnprintf_s(buff, MaxMessageLength, _TRUNCATE, format.c_str(), ap);
 	va_end(ap);
 
-	auto& gameModule = ElDorito::Instance().Modules.Game;
-	for (auto filter : gameModule.FiltersExclude)
-		if (strstr(buff, filter.c_str()) != NULL)
-			return; // string contains an excluded string
+	// mark messages that didn't fit so it's obvious they were cut off
+	if (length < 0)
+		strcpy_s(buff + MaxMessageLength - sizeof(TruncatedMarker), sizeof(TruncatedMarker), TruncatedMarker);
 
-	for (auto filter : gameModule.FiltersInclude)
-		if (strstr(buff, filter.c_str()) == NULL)
-			return; // string doesn't contain an included string
-
-	std::ofstream outfile;
-	outfile.open(gameModule.VarLogName->ValueString, std::ios_base::app);
-	if (outfile.fail())
-		return; // TODO: give output if the log stuff failed
+	auto currentFilter = std::atomic_load(&filter);
+	if (currentFilter && !currentFilter->Matches(severity, module.c_str(), buff))
+		return;
 
-	time_t t = time(NULL);
-	tm ourLocalTime;
-	if (localtime_s(&ourLocalTime, &t) != 0)
+	if (!enqueue(severity, module, buff))
 	{
-		outfile.close(); // TODO: give output that localtime failed (when will it ever fail tho?)
+		dropped++;
+		totalDropped++;
+		SetEvent(wakeEvent); // queue is full, make sure the writer is awake
 		return;
 	}
 
-	outfile << '[' << std::put_time(&ourLocalTime, "%H:%M:%S") << "] " << module << " - " << buff << '\n';
-	outfile.close();
-}
\ No newline at end of file
+	// fatal errors are usually followed by a crash, so write them out right away
+	// once the writer has been stopped nothing else will write them out either
+	if (severity == LogSeverity::Fatal || !running)
+		Flush();
+}
+
+/// <summary>
+/// Changes the file that log messages are written to.
+/// </summary>
+/// <param name="fileName">The name of the log file.</param>
+void DebugLog::SetLogFile(const std::string& fileName)
+{
+	std::lock_guard<std::mutex> lock(fileNameLock);
+	this->fileName = fileName;
+	fileNameChanged = true;
+}
+
+/// <summary>
+/// Compiles the include/exclude filters, messages will be checked against these before they're logged.
+/// </summary>
+/// <param name="include">Filters that a message must match to be logged.</param>
+/// <param name="exclude">Filters that stop a message being logged if it matches any of them.</param>
+void DebugLog::SetFilters(const std::vector<std::string>& include, const std::vector<std::string>& exclude)
+{
+	std::atomic_store(&filter, std::make_shared<LogFilter>(include, exclude));
+}
+
+/// <summary>
+/// Writes every queued message to the log file before returning.
+/// </summary>
+void DebugLog::Flush()
+{
+	EnterCriticalSection(&writerLock);
+	drain();
+	LeaveCriticalSection(&writerLock);
+}
+
+/// <summary>
+/// Stops the writer thread after it's written out everything that's queued, must be called before the process starts exiting (not from DllMain).
+/// Messages logged after this are written out straight away by the thread logging them.
+/// </summary>
+void DebugLog::Shutdown()
+{
+	if (!writerThread)
+		return;
+
+	running = false;
+	SetEvent(wakeEvent);
+	WaitForSingleObject(writerThread, INFINITE);
+	CloseHandle(writerThread);
+	writerThread = NULL;
+}
+
+/// <summary>
+/// Tries to add a message to the queue.
+/// </summary>
+/// <param name="severity">The severity of the message.</param>
+/// <param name="module">The module the message originated from.</param>
+/// <param name="message">The formatted message.</param>
+/// <returns>false if the queue is full.</returns>
+bool DebugLog::enqueue(LogSeverity severity, const std::string& module, const char* message)
+{
+	return queue.TryEnqueue([&](QueueEntry& entry)
+	{
+		entry.Severity = severity;
+		entry.Time = time(NULL);
+		strncpy_s(entry.Module, MaxModuleLength, module.c_str(), _TRUNCATE);
+		strncpy_s(entry.Message, MaxMessageLength, message, _TRUNCATE);
+	});
+}
+
+/// <summary>
+/// Writes out every message in the queue, must be called while holding writerLock.
+/// </summary>
+void DebugLog::drain()
+{
+	if (fileNameChanged.exchange(false))
+	{
+		std::string name;
+		{
+			std::lock_guard<std::mutex> lock(fileNameLock);
+			name = fileName;
+		}
+
+		if (logFile.is_open())
+			logFile.close();
+
+		logFile.open(name, std::ios_base::app);
+	}
+
+	bool wroteAny = false;
+	auto droppedCount = dropped.exchange(0);
+	if (droppedCount && logFile.is_open())
+	{
+		logFile << "[--:--:--] DebugLog - queue full, dropped " << droppedCount << " messages" << '\n';
+		wroteAny = true;
+	}
+
+	queue.Drain([&](const QueueEntry& entry)
+	{
+		if (!logFile.is_open())
+			return;
+
+		tm ourLocalTime;
+		if (localtime_s(&ourLocalTime, &entry.Time) == 0)
+		{
+			logFile << '[' << std::put_time(&ourLocalTime, "%H:%M:%S") << "] " << entry.Module << " - " << entry.Message << '\n';
+			wroteAny = true;
+		}
+	});
+
+	if (wroteAny)
+		logFile.flush();
+}
+
+/// <summary>
+/// Writes queued messages to the log file in batches.
+/// </summary>
+DWORD WINAPI DebugLog::writerThreadProc(LPVOID param)
+{
+	auto log = reinterpret_cast<DebugLog*>(param);
+	while (log->running)
+	{
+		// wake up every so often instead of having every Log call signal us
+		WaitForSingleObject(log->wakeEvent, 100);
+
+		EnterCriticalSection(&log->writerLock);
+		log->drain();
+		LeaveCriticalSection(&log->writerLock);
+	}
+
+	// catch anything that was queued while we were stopping
+	EnterCriticalSection(&log->writerLock);
+	log->drain();
+	LeaveCriticalSection(&log->writerLock);
+	return 0;
+}
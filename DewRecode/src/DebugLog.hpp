@@ -1,9 +1,63 @@
 #pragma once
 #include <ElDorito/IDebugLog.hpp>
+#include <Windows.h>
+#include <atomic>
+#include <mutex>
+#include <fstream>
+#include <ctime>
+#include <memory>
+#include "LogFilter.hpp"
+#include "MpscQueue.hpp"
 
 // if you make any changes to this class make sure to update the exported interface (create a new interface + inherit from it if the interface already shipped)
 class DebugLog : public IDebugLog
 {
 public:
 	void Log(LogSeverity severity, const std::string& module, std::string format, ...);
-};
\ No newline at end of file
+
+	// functions that aren't exposed over IDebugLog interface
+	void SetMinSeverity(LogSeverity severity) { minSeverity = static_cast<int>(severity); }
+	void SetLogFile(const std::string& fileName);
+	void SetFilters(const std::vector<std::string>& include, const std::vector<std::string>& exclude);
+	void Flush();
+	void Shutdown();
+	unsigned int GetDroppedCount() { return totalDropped; }
+
+	DebugLog();
+	~DebugLog();
+
+private:
+	static const size_t QueueSize = 1024; // must be a power of 2
+	static const size_t MaxModuleLength = 32;
+	static const size_t MaxMessageLength = 4096; // same as the old formatter, longer messages get cut off and marked as truncated
+
+	// messages are queued into a fixed ring, the writer thread takes them out and writes them to the log file, so callers never touch the disk
+	struct QueueEntry
+	{
+		LogSeverity Severity;
+		time_t Time;
+		char Module[MaxModuleLength];
+		char Message[MaxMessageLength];
+	};
+
+	MpscQueue<QueueEntry, QueueSize> queue; // only drained while holding writerLock
+
+	std::atomic<int> minSeverity;
+	std::shared_ptr<LogFilter> filter; // swapped out atomically when the filters change, Log can be called from any thread
+	std::atomic<unsigned int> dropped; // messages dropped since the writer last reported it
+	std::atomic<unsigned int> totalDropped;
+
+	CRITICAL_SECTION writerLock; // held while draining the queue, so Flush can drain from another thread
+	HANDLE writerThread = NULL;
+	HANDLE wakeEvent = NULL;
+	std::atomic<bool> running; // false once Shutdown has stopped the writer, Log writes messages out itself after that
+
+	std::ofstream logFile;
+	std::mutex fileNameLock;
+	std::string fileName = "dorito.log";
+	std::atomic<bool> fileNameChanged;
+
+	static DWORD WINAPI writerThreadProc(LPVOID param);
+	bool enqueue(LogSeverity severity, const std::string& module, const char* message);
+	void drain();
+};
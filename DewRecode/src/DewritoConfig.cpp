@@ -0,0 +1,186 @@
+#include "DewritoConfig.hpp"
+#include <rapidjson/document.h>
+#include <rapidjson/error/en.h>
+
+namespace
+{
+	uint32_t HashContents(const std::string& contents)
+	{
+		// FNV-1a
+		uint32_t hash = 2166136261;
+		for (auto c : contents)
+		{
+			hash ^= (uint8_t)c;
+			hash *= 16777619;
+		}
+		return hash;
+	}
+
+	// reads an optional string member, adding an error if it's there but isn't a string
+	void ReadString(const rapidjson::Value& object, const char* name, std::string& dest, std::vector<std::string>& errors)
+	{
+		if (!object.HasMember(name))
+			return;
+
+		auto& value = object[name];
+		if (value.IsString())
+			dest = value.GetString();
+		else
+			errors.push_back(std::string(name) + " isn't a string");
+	}
+}
+
+DewritoConfigLoader::DewritoConfigLoader(const std::string& fileName, ConfigEnvironment& environment)
+	: fileName(fileName), environment(environment)
+{
+	lastCheckTime = 0;
+}
+
+/// <summary>
+/// Gets the current config, reloading it first if the file changed.
+/// </summary>
+/// <returns>The config, never null.</returns>
+std::shared_ptr<const DewritoConfig> DewritoConfigLoader::Get()
+{
+	auto current = std::atomic_load(&config);
+	auto now = environment.GetTime();
+	if (!current || now - lastCheckTime >= CheckIntervalMs)
+	{
+		// if another thread is already checking just use what we've got, unless there's nothing loaded yet
+		std::unique_lock<std::mutex> lock(reloadLock, std::defer_lock);
+		if (current)
+			lock.try_lock();
+		else
+			lock.lock();
+
+		if (lock.owns_lock())
+		{
+			lastCheckTime = now;
+			reloadIfChanged();
+			current = std::atomic_load(&config);
+		}
+	}
+	return current;
+}
+
+/// <summary>
+/// Parses the contents of dewrito.json, problems with the file are added to config.Errors.
+/// </summary>
+/// <param name="contents">The contents of the file.</param>
+/// <param name="config">The config to fill in.</param>
+/// <returns>false if the file couldn't be parsed at all.</returns>
+bool DewritoConfigLoader::Parse(const std::string& contents, DewritoConfig& config)
+{
+	rapidjson::Document json;
+	if (json.Parse<0>(contents.c_str()).HasParseError())
+	{
+		config.Errors.push_back("JSON parse error at offset " + std::to_string(json.GetErrorOffset()) + ": " + rapidjson::GetParseError_En(json.GetParseError()));
+		return false;
+	}
+
+	if (!json.IsObject())
+	{
+		config.Errors.push_back("the root of the file isn't an object");
+		return false;
+	}
+
+	ReadString(json, "updateServiceUrl", config.UpdateServiceUrl, config.Errors);
+	ReadString(json, "updateChannelsUrl", config.UpdateChannelsUrl, config.Errors);
+
+	if (!json.HasMember("masterServers"))
+		return true;
+
+	auto& masters = json["masterServers"];
+	if (!masters.IsArray())
+	{
+		config.Errors.push_back("masterServers isn't an array");
+		return true;
+	}
+
+	for (rapidjson::SizeType i = 0; i < masters.Size(); i++)
+	{
+		auto& master = masters[i];
+		auto prefix = "masterServers[" + std::to_string(i) + "]";
+		if (!master.IsObject())
+		{
+			config.Errors.push_back(prefix + " isn't an object");
+			continue;
+		}
+
+		for (auto it = master.MemberBegin(); it != master.MemberEnd(); ++it)
+		{
+			std::string type = it->name.GetString();
+			if (!it->value.IsString())
+			{
+				config.Errors.push_back(prefix + "." + type + " isn't a string");
+				continue;
+			}
+
+			std::string url = it->value.GetString();
+			if (url.empty())
+			{
+				config.Errors.push_back(prefix + "." + type + " is empty");
+				continue;
+			}
+
+			config.MasterEndpoints[type].push_back(url);
+		}
+	}
+
+	return true;
+}
+
+/// <summary>
+/// Reparses the file if its modification time or size changed, must be called while holding reloadLock.
+/// </summary>
+void DewritoConfigLoader::reloadIfChanged()
+{
+	uint64_t fileSize = 0;
+	uint64_t writeTime = 0;
+	bool exists = environment.GetFileInfo(fileName, fileSize, writeTime);
+
+	if (hasChecked && exists == lastExists)
+	{
+		if (!exists)
+			return; // still missing
+		if (fileSize == lastFileSize && writeTime == lastWriteTime)
+			return; // nothing changed
+	}
+
+	hasChecked = true;
+	lastExists = exists;
+	lastFileSize = fileSize;
+	lastWriteTime = writeTime;
+
+	auto newConfig = std::make_shared<DewritoConfig>();
+	bool parsed = false;
+	std::string contents;
+	if (exists && environment.ReadFile(fileName, contents))
+	{
+		// the file was touched but not actually changed, keep the config we've got
+		auto hash = HashContents(contents);
+		if (std::atomic_load(&config) && hash == lastHash)
+			return;
+
+		lastHash = hash;
+		parsed = Parse(contents, *newConfig);
+	}
+	else
+	{
+		lastHash = 0;
+		newConfig->Errors.push_back("couldn't open " + fileName);
+	}
+
+	for (auto& error : newConfig->Errors)
+		environment.Log(LogSeverity::Warning, fileName + ": " + error);
+
+	// if someone broke the file while the game's running, carry on with what we had
+	if (!parsed && std::atomic_load(&config))
+	{
+		environment.Log(LogSeverity::Warning, "Keeping the previously loaded " + fileName);
+		return;
+	}
+
+	environment.Log(LogSeverity::Debug, "Loaded " + fileName);
+	std::atomic_store(&config, std::shared_ptr<const DewritoConfig>(newConfig));
+}
@@ -0,0 +1,58 @@
+#pragma once
+#include <ElDorito/DewritoConfig.hpp>
+#include <ElDorito/IDebugLog.hpp>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+
+// what DewritoConfigLoader needs from the OS, Engine passes in the real one (WinConfigEnvironment) and the tests use made up files and time
+class ConfigEnvironment
+{
+public:
+	virtual ~ConfigEnvironment() { }
+
+	virtual uint32_t GetTime() = 0; // milliseconds, can wrap
+	virtual bool GetFileInfo(const std::string& fileName, uint64_t& size, uint64_t& writeTime) = 0; // false if the file doesn't exist
+	virtual bool ReadFile(const std::string& fileName, std::string& contents) = 0;
+	virtual void Log(LogSeverity severity, const std::string& message) = 0;
+};
+
+// GetTickCount, GetFileAttributesEx and the debug log
+class WinConfigEnvironment : public ConfigEnvironment
+{
+public:
+	uint32_t GetTime();
+	bool GetFileInfo(const std::string& fileName, uint64_t& size, uint64_t& writeTime);
+	bool ReadFile(const std::string& fileName, std::string& contents);
+	void Log(LogSeverity severity, const std::string& message);
+};
+
+// loads dewrito.json into a DewritoConfig and keeps it cached, the file is only parsed again when its modification time/size changes
+// (and only swapped in if the contents actually changed), each version of the config is immutable so it can be shared between threads
+class DewritoConfigLoader
+{
+public:
+	static const uint32_t CheckIntervalMs = 1000; // how often we look at the file to see if it changed
+
+	DewritoConfigLoader(const std::string& fileName, ConfigEnvironment& environment);
+
+	std::shared_ptr<const DewritoConfig> Get();
+
+	static bool Parse(const std::string& contents, DewritoConfig& config);
+
+private:
+	std::string fileName;
+	ConfigEnvironment& environment;
+	std::shared_ptr<const DewritoConfig> config; // swapped atomically
+	std::atomic<uint32_t> lastCheckTime;
+
+	std::mutex reloadLock; // guards everything below
+	bool hasChecked = false;
+	bool lastExists = false;
+	uint64_t lastWriteTime = 0;
+	uint64_t lastFileSize = 0;
+	uint32_t lastHash = 0;
+
+	void reloadIfChanged();
+};
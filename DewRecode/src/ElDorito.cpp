@@ -34,9 +34,8 @@ void ElDorito::Initialize()
 	Logger.Log(LogSeverity::Debug, "ElDorito", "Execute autoexec.cfg...");
 	Commands.Execute("Execute autoexec.cfg"); // also execute autoexec, which is a user-made cfg guaranteed not to be overwritten by ElDew/launcher
 
-	// HACKY - As we need a draw call in between this message and the actual generation, check it ahead of it actually generating
-	if (Modules.Player.VarPlayerPubKey->ValueString.empty())
-		Modules.Console.PrintToConsole("Generating player keypair\nThis may take a moment...");
+	// now that the cfg has been read, check the players keypair and start generating a new one in the background if it needs one
+	Modules.PlayerUidPatches.PrepareKey();
 
 	// add and toggle(enable) the language patch, can't be done in a module since we have to patch this after cfg files are read
 	Patches.TogglePatch(Patches.AddPatch("GameLanguage", 0x6333FD, { (unsigned char)Modules.Game.VarLanguageID->ValueInt }));
@@ -89,6 +88,16 @@ void ElDorito::Initialize()
 	this->inited = true;
 }
 
+/// <summary>
+/// Stops the background threads before the process exits, call this before anything that ends the process.
+/// DllMain can't wait for threads to finish, so this has to happen before it gets called.
+/// </summary>
+void ElDorito::Shutdown()
+{
+	Utils.Shutdown();
+	Logger.Shutdown();
+}
+
 /// <summary>
 /// Loads and initializes plugins from the mods/plugins folder.
 /// </summary>
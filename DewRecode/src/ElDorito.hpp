@@ -6,6 +6,7 @@
 #include "PatchManager.hpp"
 #include "Engine.hpp"
 #include "DebugLog.hpp"
+#include "Profiler.hpp"
 #include "Modules/ModuleMain.hpp"
 #include "Utils.hpp"
 
@@ -23,6 +24,7 @@ private:
 
 public:
 	DebugLog Logger;
+	Profiler Profiler; // before Engine, the engine registers zones for its events/callbacks
 	PatchManager Patches;
 	Commands Commands;
 	PublicUtils Utils;
@@ -30,6 +32,7 @@ public:
 	Modules::ModuleMain Modules;
 
 	void Initialize();
+	void Shutdown();
 
 	static ElDorito& Instance()
 	{
@@ -19,7 +19,8 @@ namespace
 
 	void TagsLoadedHookImpl()
 	{
-		ElDorito::Instance().Engine.Event("Core", "Engine.TagsLoaded");
+		auto& engine = ElDorito::Instance().Engine;
+		engine.Event(engine.CoreEvents.TagsLoaded);
 	}
 
 	__declspec(naked) void TagsLoadedHook()
@@ -48,7 +49,10 @@ namespace
 		auto retval = Network_managed_session_create_session_internal(a1, a2);
 
 		if (isHost)
-			ElDorito::Instance().Engine.Event("Core", isOnline == 1 ? "Server.Start" : "Server.Stop");
+		{
+			auto& engine = ElDorito::Instance().Engine;
+			engine.Event(isOnline == 1 ? engine.CoreEvents.ServerStart : engine.CoreEvents.ServerStop);
+		}
 
 		return retval;
 	}
@@ -71,14 +75,18 @@ namespace
 		bool retVal = Network_leader_request_boot_machine(thisPtr, playerAddr, reason);
 		PlayerInfo info = { ElDorito::Instance().Utils.ThinString(playerName), uid };
 		if (retVal)
-			ElDorito::Instance().Engine.Event("Core", "Server.PlayerKick", &info);
+		{
+			auto& engine = ElDorito::Instance().Engine;
+			engine.Event(engine.CoreEvents.ServerPlayerKick, &info);
+		}
 
 		return retVal;
 	}
 
 	char __fastcall Network_state_end_game_write_stats_enterHook(void* thisPtr, int unused, int a2, int a3, int a4)
 	{
-		ElDorito::Instance().Engine.Event("Core", "Game.End");
+		auto& engine = ElDorito::Instance().Engine;
+		engine.Event(engine.CoreEvents.GameEnd);
 
 		typedef char(__thiscall *Network_state_end_game_write_stats_enterPtr)(void* thisPtr, int a2, int a3, int a4);
 		auto Network_state_end_game_write_stats_enter = reinterpret_cast<Network_state_end_game_write_stats_enterPtr>(0x492B50);
@@ -87,7 +95,8 @@ namespace
 
 	char __fastcall Network_state_leaving_enterHook(void* thisPtr, int unused, int a2, int a3, int a4)
 	{
-		ElDorito::Instance().Engine.Event("Core", "Game.Leave");
+		auto& engine = ElDorito::Instance().Engine;
+		engine.Event(engine.CoreEvents.GameLeave);
 
 		typedef char(__thiscall *Network_state_leaving_enterPtr)(void* thisPtr, int a2, int a3, int a4);
 		auto Network_state_leaving_enter = reinterpret_cast<Network_state_leaving_enterPtr>(0x4933E0);
@@ -96,7 +105,8 @@ namespace
 
 	HRESULT __stdcall D3D9Device_EndSceneHook(IDirect3DDevice9* device)
 	{
-		ElDorito::Instance().Engine.Event("Core", "Direct3D.EndScene", device);
+		auto& engine = ElDorito::Instance().Engine;
+		engine.Event(engine.CoreEvents.EndScene, device);
 		return device->EndScene();
 	}
 }
@@ -105,7 +115,25 @@ namespace
 /// Initializes a new instance of the <see cref="Engine"/> class.
 /// </summary>
 Engine::Engine()
+	: dewritoConfig("dewrito.json", configEnvironment)
 {
+	tickZone = ElDorito::Instance().Profiler.RegisterZone("Engine.Tick");
+
+	// intern the events we signal ourselves, so the hooks don't need to look them up by name
+	// (logger can't be used yet since the modules haven't been created)
+	CoreEvents.FirstTick = internEvent("Core.Engine.FirstTick");
+	CoreEvents.MainMenuShown = internEvent("Core.Engine.MainMenuShown");
+	CoreEvents.TagsLoaded = internEvent("Core.Engine.TagsLoaded");
+	CoreEvents.KeyboardUpdate = internEvent("Core.Input.KeyboardUpdate", true);
+	CoreEvents.ServerStart = internEvent("Core.Server.Start");
+	CoreEvents.ServerStop = internEvent("Core.Server.Stop");
+	CoreEvents.ServerPlayerKick = internEvent("Core.Server.PlayerKick");
+	CoreEvents.GameJoining = internEvent("Core.Game.Joining");
+	CoreEvents.GameLeave = internEvent("Core.Game.Leave");
+	CoreEvents.GameEnd = internEvent("Core.Game.End");
+	CoreEvents.EndScene = internEvent("Core.Direct3D.EndScene", true);
+	CoreEvents.PlayerChangeName = internEvent("Core.Player.ChangeName");
+
 	auto& patches = ElDorito::Instance().Patches;
 
 	// hook our engine events
@@ -138,7 +166,7 @@ Engine::~Engine()
 /// <returns>True if the callback was added, false if the callback is already registered.</returns>
 bool Engine::OnTick(TickCallback callback)
 {
-	tickCallbacks.push_back(callback);
+	tickCallbacks.Add(callback, ElDorito::Instance().Profiler.RegisterZone("Tick " + Profiler::DescribeAddress(reinterpret_cast<const void*>(callback))));
 	return true; // todo: check if this callback is already registered
 }
 
@@ -150,7 +178,7 @@ bool Engine::OnTick(TickCallback callback)
 /// <returns>True if the callback was added, false if the callback is already registered.</returns>
 bool Engine::OnWndProc(WNDPROC callback)
 {
-	wndProcCallbacks.push_back(callback);
+	wndProcCallbacks.Add(callback);
 	return true;
 }
 
@@ -164,18 +192,40 @@ bool Engine::OnWndProc(WNDPROC callback)
 /// <returns>True if the callback was added, false if the callback is already registered.</returns>
 bool Engine::OnEvent(const std::string& eventNamespace, const std::string& eventName, EventCallback callback)
 {
-	std::string eventId = eventNamespace + "." + eventName;
-	auto it = eventCallbacks.find(eventId);
-	if (it != eventCallbacks.end())
-	{
-		// TODO: check if callback is already registered for this event, bad plugin coders might have put their OnEvent in a loop by accident or something
-		(*it).second.push_back(callback);
-		return true;
-	}
+	return OnEvent(RegisterEvent(eventNamespace, eventName), callback);
+}
+
+/// <summary>
+/// Gets the ID for an event, creating the event if it doesn't exist yet.
+/// </summary>
+/// <param name="eventNamespace">The namespace the event belongs to.</param>
+/// <param name="eventName">The name of the event.</param>
+/// <returns>The ID of the event.</returns>
+EventId Engine::RegisterEvent(const std::string& eventNamespace, const std::string& eventName)
+{
+	std::string name = eventNamespace + "." + eventName;
+	auto it = eventIds.find(name);
+	if (it != eventIds.end())
+		return it->second;
+
+	// event wasn't found, create a new one!
+	ElDorito::Instance().Logger.Log(LogSeverity::Debug, "EngineEvent", "%s event created", name.c_str());
+	return internEvent(name);
+}
+
+/// <summary>
+/// Adds a callback to be called when the specified event occurs.
+/// </summary>
+/// <param name="eventId">The ID of the event, from RegisterEvent.</param>
+/// <param name="callback">The callback.</param>
+/// <returns>True if the callback was added, false if the event ID is invalid.</returns>
+bool Engine::OnEvent(EventId eventId, EventCallback callback)
+{
+	if (eventId < 0 || (size_t)eventId >= events.size())
+		return false;
 
-	// callback wasn't found, create a new one!
-	ElDorito::Instance().Logger.Log(LogSeverity::Debug, "EngineEvent", "%s event created", eventId.c_str());
-	eventCallbacks.insert(std::pair<std::string, std::vector<EventCallback>>(eventId, std::vector<EventCallback>{ callback }));
+	// TODO: check if callback is already registered for this event, bad plugin coders might have put their OnEvent in a loop by accident or something
+	events[eventId].Callbacks.Add(callback, ElDorito::Instance().Profiler.RegisterZone(events[eventId].Name + " " + Profiler::DescribeAddress(reinterpret_cast<const void*>(callback))));
 	return true;
 }
 
@@ -186,7 +236,7 @@ bool Engine::OnEvent(const std::string& eventNamespace, const std::string& event
 /// <returns>True if the callback was removed.</returns>
 bool Engine::RemoveOnTick(TickCallback callback)
 {
-	tickCallbacks.erase(std::remove(tickCallbacks.begin(), tickCallbacks.end(), callback), tickCallbacks.end());
+	tickCallbacks.Remove(callback);
 	return true;
 }
 
@@ -197,7 +247,7 @@ bool Engine::RemoveOnTick(TickCallback callback)
 /// <returns>True if the callback was removed.</returns>
 bool Engine::RemoveOnWndProc(WNDPROC callback)
 {
-	wndProcCallbacks.erase(std::remove(wndProcCallbacks.begin(), wndProcCallbacks.end(), callback), wndProcCallbacks.end());
+	wndProcCallbacks.Remove(callback);
 	return true;
 }
 
@@ -210,11 +260,25 @@ bool Engine::RemoveOnWndProc(WNDPROC callback)
 /// <returns>True if the callback was removed.</returns>
 bool Engine::RemoveOnEvent(const std::string& eventNamespace, const std::string& eventName, EventCallback callback)
 {
-	std::string eventId = eventNamespace + "." + eventName;
-	auto it = eventCallbacks.find(eventId);
-	if (it != eventCallbacks.end())
-		(*it).second.erase(std::remove((*it).second.begin(), (*it).second.end(), callback), (*it).second.end());
+	auto it = eventIds.find(eventNamespace + "." + eventName);
+	if (it != eventIds.end())
+		RemoveOnEvent(it->second, callback);
+
+	return true;
+}
+
+/// <summary>
+/// Unregisters an EventCallback.
+/// </summary>
+/// <param name="eventId">The ID of the event, from RegisterEvent.</param>
+/// <param name="callback">The callback.</param>
+/// <returns>True if the callback was removed.</returns>
+bool Engine::RemoveOnEvent(EventId eventId, EventCallback callback)
+{
+	if (eventId < 0 || (size_t)eventId >= events.size())
+		return false;
 
+	events[eventId].Callbacks.Remove(callback); // safe to call from the event's own callbacks, see CallbackList
 	return true;
 }
 
@@ -227,10 +291,16 @@ void Engine::Tick(const std::chrono::duration<double>& deltaTime)
 	if (!hasFirstTickTocked)
 	{
 		hasFirstTickTocked = true;
-		this->Event("Core", "Engine.FirstTick");
+		this->Event(CoreEvents.FirstTick);
 	}
-	for (auto callback : tickCallbacks)
-		callback(deltaTime);
+
+	auto& profiler = ElDorito::Instance().Profiler;
+	ProfileZone zone(profiler, tickZone);
+	tickCallbacks.Dispatch([&](const CallbackList<TickCallback>::Entry& callback)
+	{
+		ProfileZone callbackZone(profiler, callback.Zone);
+		callback.Callback(deltaTime);
+	});
 }
 
 /// <summary>
@@ -239,11 +309,15 @@ void Engine::Tick(const std::chrono::duration<double>& deltaTime)
 LRESULT Engine::WndProc(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam)
 {
 	bool callGame = true;
-	for (auto callback : wndProcCallbacks)
+	wndProcCallbacks.Dispatch([&](const CallbackList<WNDPROC>::Entry& callback)
 	{
-		if (callback(hWnd, msg, wParam, lParam) != 0)
+		if (callback.Callback(hWnd, msg, wParam, lParam) != 0)
 			callGame = false;
-	}
+	});
+
+	// the game exits once its window is gone, stop our threads while we still can (see ElDorito::Shutdown)
+	if (msg == WM_DESTROY)
+		ElDorito::Instance().Shutdown();
 
 	if (!callGame)
 		return 0;
@@ -261,29 +335,82 @@ LRESULT Engine::WndProc(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam)
 /// <param name="param">The parameter to pass to the callbacks.</param>
 void Engine::Event(const std::string& eventNamespace, const std::string& eventName, void* param)
 {
-	// TODO: find a way to optimize this?
+	std::string name = eventNamespace + "." + eventName;
+	auto it = eventIds.find(name);
+	if (it == eventIds.end())
+	{
+		ElDorito::Instance().Logger.Log(LogSeverity::Debug, "EngineEvent", "%s event triggered", name.c_str());
+		ElDorito::Instance().Logger.Log(LogSeverity::Debug, "EngineEvent", "%s event not created (nobody is listening for this event!)", name.c_str());
+		return;
+	}
 
-	std::string eventId = eventNamespace + "." + eventName;
-	if (eventId.compare("Core.Input.KeyboardUpdate") && eventId.compare("Core.Direct3D.EndScene")) // don't show keyboard update spam
-		ElDorito::Instance().Logger.Log(LogSeverity::Debug, "EngineEvent", "%s event triggered", eventId.c_str());
+	Event(it->second, param);
+}
 
-	if (!eventId.compare("Core.Engine.MainMenuShown"))
+/// <summary>
+/// Calls each of the registered callbacks for the specified event.
+/// </summary>
+/// <param name="eventId">The ID of the event, from RegisterEvent.</param>
+/// <param name="param">The parameter to pass to the callbacks.</param>
+void Engine::Event(EventId eventId, void* param)
+{
+	if (eventId < 0 || (size_t)eventId >= events.size())
+		return;
+
+	if (!events[eventId].Quiet) // don't show keyboard update/endscene spam
+		ElDorito::Instance().Logger.Log(LogSeverity::Debug, "EngineEvent", "%s event triggered", events[eventId].Name.c_str());
+
+	if (eventId == CoreEvents.MainMenuShown)
 	{
 		if (this->mainMenuHasShown)
 			return; // this event should only occur once during the lifecycle of the game
 		this->mainMenuHasShown = true;
 	}
 
-	auto it = eventCallbacks.find(eventId);
-	if (it == eventCallbacks.end())
+	if (events[eventId].Callbacks.IsEmpty())
 	{
-		if (eventId.compare("Core.Input.KeyboardUpdate") && eventId.compare("Core.Direct3D.EndScene"))
-			ElDorito::Instance().Logger.Log(LogSeverity::Debug, "EngineEvent", "%s event not created (nobody is listening for this event!)", eventId.c_str());
+		if (!events[eventId].Quiet)
+			ElDorito::Instance().Logger.Log(LogSeverity::Debug, "EngineEvent", "%s event not created (nobody is listening for this event!)", events[eventId].Name.c_str());
 		return;
 	}
 
-	for (auto callback : (*it).second)
-		callback(param);
+	auto& profiler = ElDorito::Instance().Profiler;
+	ProfileZone zone(profiler, events[eventId].Zone);
+
+	// callbacks can add/remove callbacks for this event (including themselves) or register new events while this runs, see CallbackList
+	events[eventId].Callbacks.Dispatch([&](const CallbackList<EventCallback>::Entry& callback)
+	{
+		ProfileZone callbackZone(profiler, callback.Zone);
+		callback.Callback(param);
+	});
+}
+
+/// <summary>
+/// Gets the contents of dewrito.json, the file is only parsed again when it changes.
+/// </summary>
+/// <returns>The config, never null.</returns>
+std::shared_ptr<const DewritoConfig> Engine::GetDewritoConfig()
+{
+	return dewritoConfig.Get();
+}
+
+/// <summary>
+/// Adds an event to the event list.
+/// </summary>
+/// <param name="fullName">The name of the event, including the namespace.</param>
+/// <param name="quiet">Whether to skip logging when the event is signalled.</param>
+/// <returns>The ID of the new event.</returns>
+EventId Engine::internEvent(const std::string& fullName, bool quiet)
+{
+	EventInfo info;
+	info.Name = fullName;
+	info.Quiet = quiet;
+	info.Zone = ElDorito::Instance().Profiler.RegisterZone(fullName);
+
+	auto eventId = static_cast<EventId>(events.size());
+	events.push_back(info);
+	eventIds.insert(std::pair<std::string, EventId>(fullName, eventId));
+	return eventId;
 }
 
 /// <summary>
@@ -297,10 +424,14 @@ bool Engine::RegisterInterface(const std::string& interfaceName, void* ptrToInte
 	auto& dorito = ElDorito::Instance();
 
 	if (!interfaceName.compare(COMMANDS_INTERFACE_VERSION001) ||
+		!interfaceName.compare(COMMANDS_INTERFACE_VERSION002) ||
 		!interfaceName.compare(ENGINE_INTERFACE_VERSION001) ||
+		!interfaceName.compare(ENGINE_INTERFACE_VERSION002) ||
 		!interfaceName.compare(DEBUGLOG_INTERFACE_VERSION001) ||
 		!interfaceName.compare(PATCHMANAGER_INTERFACE_VERSION001) ||
-		!interfaceName.compare(UTILS_INTERFACE_VERSION001))
+		!interfaceName.compare(PATCHMANAGER_INTERFACE_VERSION002) ||
+		!interfaceName.compare(UTILS_INTERFACE_VERSION001) ||
+		!interfaceName.compare(UTILS_INTERFACE_VERSION002))
 	{
 		dorito.Logger.Log(LogSeverity::Error, "Engine", "Tried registering built-in interface %s!", interfaceName.c_str());
 		return false; // can't register these
@@ -330,15 +461,23 @@ void* Engine::CreateInterface(const std::string& interfaceName, int* returnCode)
 
 	*returnCode = 0;
 	if (!interfaceName.compare(COMMANDS_INTERFACE_VERSION001))
-		return &dorito.Commands;
+		return static_cast<ICommands001*>(&dorito.Commands);
+	if (!interfaceName.compare(COMMANDS_INTERFACE_VERSION002))
+		return static_cast<ICommands002*>(&dorito.Commands);
 	if (!interfaceName.compare(ENGINE_INTERFACE_VERSION001))
-		return &dorito.Engine;
+		return static_cast<IEngine001*>(&dorito.Engine);
+	if (!interfaceName.compare(ENGINE_INTERFACE_VERSION002))
+		return static_cast<IEngine002*>(&dorito.Engine);
 	if (!interfaceName.compare(DEBUGLOG_INTERFACE_VERSION001))
 		return &dorito.Logger;
 	if (!interfaceName.compare(PATCHMANAGER_INTERFACE_VERSION001))
-		return &dorito.Patches;
+		return static_cast<IPatchManager001*>(&dorito.Patches);
+	if (!interfaceName.compare(PATCHMANAGER_INTERFACE_VERSION002))
+		return static_cast<IPatchManager002*>(&dorito.Patches);
 	if (!interfaceName.compare(UTILS_INTERFACE_VERSION001))
-		return &dorito.Utils;
+		return static_cast<IUtils001*>(&dorito.Utils);
+	if (!interfaceName.compare(UTILS_INTERFACE_VERSION002))
+		return static_cast<IUtils002*>(&dorito.Utils);
 
 	auto it = interfaces.find(interfaceName);
 	if (it != interfaces.end())
@@ -475,6 +614,7 @@ Pointer Engine::GetMainTls(size_t offset)
 		if (!success)
 		{
 			OutputDebugStringA(std::string("Error getting thread context: ").append(std::to_string(GetLastError())).c_str());
+			ElDorito::Instance().Shutdown();
 			std::exit(1);
 		}
 		ResumeThread(MainThreadHandle);
@@ -1,7 +1,28 @@
 #pragma once
 #include <ElDorito/ElDorito.hpp>
 #include <map>
+#include <deque>
+#include <unordered_map>
 #include "Utils/Utils.hpp"
+#include "DewritoConfig.hpp"
+#include "CallbackList.hpp"
+
+// IDs of the events signalled by ED itself, interned when the engine is created
+struct CoreEventIds
+{
+	EventId FirstTick;
+	EventId MainMenuShown;
+	EventId TagsLoaded;
+	EventId KeyboardUpdate;
+	EventId ServerStart;
+	EventId ServerStop;
+	EventId ServerPlayerKick;
+	EventId GameJoining;
+	EventId GameLeave;
+	EventId GameEnd;
+	EventId EndScene;
+	EventId PlayerChangeName;
+};
 
 // handles game events and callbacks for different modules/plugins
 // if you make any changes to this class make sure to update the exported interface (create a new interface + inherit from it if the interface already shipped)
@@ -18,6 +39,13 @@ public:
 
 	void Event(const std::string& eventNamespace, const std::string& eventName, void* param = 0);
 
+	EventId RegisterEvent(const std::string& eventNamespace, const std::string& eventName);
+	bool OnEvent(EventId eventId, EventCallback callback);
+	bool RemoveOnEvent(EventId eventId, EventCallback callback);
+	void Event(EventId eventId, void* param = 0);
+
+	std::shared_ptr<const DewritoConfig> GetDewritoConfig();
+
 	bool RegisterInterface(const std::string& interfaceName, void* ptrToInterface);
 	void* CreateInterface(const std::string& interfaceName, int* returnCode);
 
@@ -53,15 +81,34 @@ public:
 	void Tick(const std::chrono::duration<double>& deltaTime);
 	LRESULT WndProc(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam);
 
+	CoreEventIds CoreEvents;
+
 	Engine();
 	~Engine();
 private:
 	bool mainMenuHasShown = false;
 	bool hasFirstTickTocked = false;
-	std::vector<TickCallback> tickCallbacks;
-	std::vector<WNDPROC> wndProcCallbacks;
-	std::map<std::string, std::vector<EventCallback>> eventCallbacks;
+
+	CallbackList<TickCallback> tickCallbacks;
+	CallbackList<WNDPROC> wndProcCallbacks;
+	uint32_t tickZone;
+
+	struct EventInfo
+	{
+		std::string Name; // eventNamespace.eventName
+		CallbackList<EventCallback> Callbacks;
+		bool Quiet; // don't log when this event is signalled (for events that happen every frame)
+		uint32_t Zone; // covers every callback
+	};
+
+	std::deque<EventInfo> events; // indexed by EventId, a deque so registering an event doesn't move the ones that are being dispatched
+	std::unordered_map<std::string, EventId> eventIds;
+
+	EventId internEvent(const std::string& fullName, bool quiet = false);
 	std::map<std::string, void*> interfaces;
 
+	WinConfigEnvironment configEnvironment; // has to be before dewritoConfig
+	DewritoConfigLoader dewritoConfig;
+
 	PatchSet* enginePatchSet;
 };
@@ -0,0 +1,53 @@
+#include "HostHealth.hpp"
+
+HostHealth::HostHealth(uint32_t seed)
+	: random(seed)
+{
+}
+
+/// <summary>
+/// Checks if a host has been failing and we're waiting before trying it again.
+/// </summary>
+/// <param name="host">The scheme://host:port of the host.</param>
+/// <param name="now">The current time.</param>
+/// <returns>true if requests to the host shouldn't be sent yet.</returns>
+bool HostHealth::IsBackedOff(const std::wstring& host, uint32_t now) const
+{
+	auto it = hosts.find(host);
+	return it != hosts.end() && it->second.Failures >= FailuresBeforeBackoff && (int32_t)(it->second.RetryTime - now) > 0;
+}
+
+/// <summary>
+/// Updates a hosts health after a request, backing it off if it keeps failing.
+/// </summary>
+/// <param name="host">The scheme://host:port of the host.</param>
+/// <param name="succeeded">Whether the request succeeded.</param>
+/// <param name="now">The current time.</param>
+/// <returns>What changed, so it can be logged.</returns>
+HostHealth::Change HostHealth::Update(const std::wstring& host, bool succeeded, uint32_t now)
+{
+	auto& info = hosts[host];
+	Change change = { 0, 0, false };
+	if (succeeded)
+	{
+		change.Recovered = info.Failures > 0;
+		info.Failures = 0;
+		return change;
+	}
+
+	change.Failures = ++info.Failures;
+	if (info.Failures < FailuresBeforeBackoff)
+		return change;
+
+	// 5s, 10s, 20s, 40s, 1m20s, 2m40s, 5m...
+	auto backoffStep = info.Failures - FailuresBeforeBackoff;
+	uint32_t backoff = BaseBackoffMs << (backoffStep > 6 ? 6 : backoffStep);
+	if (backoff > MaxBackoffMs)
+		backoff = MaxBackoffMs;
+
+	// add some jitter so everyone that lost the host doesn't come back to it at the same time
+	backoff += std::uniform_int_distribution<uint32_t>(0, backoff / 4)(random);
+	info.RetryTime = now + backoff;
+	change.BackoffMs = backoff;
+	return change;
+}
@@ -0,0 +1,38 @@
+#pragma once
+#include <cstdint>
+#include <map>
+#include <random>
+#include <string>
+
+// keeps track of each hosts health, hosts that keep failing get backed off so they can't hold up requests to the other hosts
+// times are in milliseconds from a clock that can wrap (eg. GetTickCount()), the caller passes the current time in
+class HostHealth
+{
+public:
+	static const unsigned int FailuresBeforeBackoff = 3; // a single dropped request or 5xx shouldn't take a host out
+	static const uint32_t BaseBackoffMs = 5 * 1000;
+	static const uint32_t MaxBackoffMs = 5 * 60 * 1000;
+
+	// what changed after a request
+	struct Change
+	{
+		unsigned int Failures; // failed requests in a row, including this one
+		uint32_t BackoffMs; // how long the host is backed off for, 0 if it isn't
+		bool Recovered; // the request succeeded after the host had been failing
+	};
+
+	explicit HostHealth(uint32_t seed);
+
+	bool IsBackedOff(const std::wstring& host, uint32_t now) const;
+	Change Update(const std::wstring& host, bool succeeded, uint32_t now);
+
+private:
+	struct Host
+	{
+		unsigned int Failures = 0; // failed requests in a row
+		uint32_t RetryTime = 0; // when we'll try this host again, if Failures is at least FailuresBeforeBackoff
+	};
+
+	std::map<std::wstring, Host> hosts; // key is scheme://host:port
+	std::mt19937 random;
+};
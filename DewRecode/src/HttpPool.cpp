@@ -0,0 +1,299 @@
+#include "HttpPool.hpp"
+#include "ElDorito.hpp"
+#include "RequestBatch.hpp"
+
+HttpPool::HttpPool()
+	: health(GetTickCount())
+{
+}
+
+HttpPool::~HttpPool()
+{
+	for (auto& host : hosts)
+		if (host.second.Connection)
+			WinHttpCloseHandle(host.second.Connection);
+
+	if (session)
+		WinHttpCloseHandle(session);
+}
+
+/// <summary>
+/// Sends a HTTP request, reusing an open connection to the host if there is one.
+/// </summary>
+/// <param name="uri">The URI to send the request to.</param>
+/// <param name="method">The HTTP method (GET/POST/etc).</param>
+/// <param name="userAgent">The user agent to send.</param>
+/// <param name="headers">Any extra headers to send, each ending with \r\n.</param>
+/// <param name="body">The request body, or NULL.</param>
+/// <param name="bodySize">The size of the request body.</param>
+/// <returns>The response, Error is HttpRequestError::HostBackedOff if the host has been failing and we're waiting before trying it again.</returns>
+HttpRequest HttpPool::SendRequest(const std::wstring& uri, const std::wstring& method, const std::wstring& userAgent, const std::wstring& headers, void* body, DWORD bodySize)
+{
+	HttpRequest retVal;
+	retVal.Error = HttpRequestError::None;
+	retVal.LastError = 0;
+
+	URL_COMPONENTSW urlComp = {};
+	urlComp.dwStructSize = sizeof(urlComp);
+
+	// Set required component lengths to non-zero so that they are cracked.
+	urlComp.dwSchemeLength = static_cast<DWORD>(-1);
+	urlComp.dwHostNameLength = static_cast<DWORD>(-1);
+	urlComp.dwUrlPathLength = static_cast<DWORD>(-1);
+
+	if (!WinHttpCrackUrl(uri.c_str(), uri.length(), 0, &urlComp))
+	{
+		retVal.Error = HttpRequestError::InvalidUrl;
+		return retVal;
+	}
+
+	std::wstring scheme = urlComp.lpszScheme ? std::wstring(urlComp.lpszScheme, urlComp.dwSchemeLength) : L"http";
+	std::wstring hostname = urlComp.lpszHostName ? std::wstring(urlComp.lpszHostName, urlComp.dwHostNameLength) : L"localhost";
+	std::wstring path = urlComp.lpszUrlPath ? std::wstring(urlComp.lpszUrlPath, urlComp.dwUrlPathLength) : L"/";
+	auto hostKey = scheme + L"://" + hostname + L":" + std::to_wstring(urlComp.nPort);
+
+	HINTERNET connection;
+	bool needsProxy;
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		if (!session && !openSession())
+		{
+			retVal.Error = HttpRequestError::HttpOpenFailed;
+			retVal.LastError = GetLastError();
+			return retVal;
+		}
+
+		if (health.IsBackedOff(hostKey, GetTickCount()))
+		{
+			retVal.Error = HttpRequestError::HostBackedOff;
+			return retVal;
+		}
+
+		auto& host = hosts[hostKey];
+		if (!host.Connection)
+			host.Connection = WinHttpConnect(session, hostname.c_str(), urlComp.nPort, 0);
+
+		if (!host.Connection)
+		{
+			retVal.Error = HttpRequestError::HttpConnectFailed;
+			retVal.LastError = GetLastError();
+			return retVal;
+		}
+
+		connection = host.Connection;
+		needsProxy = autoDetectProxy && !host.ProxyResolved;
+	}
+
+	// proxy auto-detection can take a while, so it's done outside the lock (and only once per host)
+	if (needsProxy)
+		resolveProxy(hostKey);
+
+	auto request = WinHttpOpenRequest(connection, method.c_str(), path.c_str(), NULL, WINHTTP_NO_REFERER, WINHTTP_DEFAULT_ACCEPT_TYPES, urlComp.nScheme == INTERNET_SCHEME_HTTPS ? WINHTTP_FLAG_SECURE : 0);
+	if (!request)
+	{
+		retVal.Error = HttpRequestError::HttpOpenRequestFailed;
+		retVal.LastError = GetLastError();
+		return retVal;
+	}
+
+	WINHTTP_PROXY_INFO proxyInfo = {};
+	std::wstring proxy, proxyBypass;
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		auto& host = hosts[hostKey];
+		proxyInfo.dwAccessType = host.ProxyAccessType;
+		proxy = host.Proxy;
+		proxyBypass = host.ProxyBypass;
+	}
+
+	if (!proxy.empty())
+	{
+		proxyInfo.lpszProxy = &proxy[0];
+		proxyInfo.lpszProxyBypass = proxyBypass.empty() ? WINHTTP_NO_PROXY_BYPASS : &proxyBypass[0];
+		WinHttpSetOption(request, WINHTTP_OPTION_PROXY, &proxyInfo, sizeof(proxyInfo));
+	}
+
+	// the session is shared, so the user agent goes in with the request headers instead
+	auto userAgentHeader = L"User-Agent: " + userAgent;
+	WinHttpAddRequestHeaders(request, userAgentHeader.c_str(), (DWORD)-1, WINHTTP_ADDREQ_FLAG_ADD | WINHTTP_ADDREQ_FLAG_REPLACE);
+
+	LPCWSTR addtHdrs = WINHTTP_NO_ADDITIONAL_HEADERS;
+	DWORD length = 0;
+	if (!headers.empty())
+	{
+		addtHdrs = headers.c_str();
+		length = (DWORD)-1;
+	}
+
+	auto results = WinHttpSendRequest(request, addtHdrs, length, body, bodySize, bodySize, 0);
+	if (results)
+		results = WinHttpReceiveResponse(request, NULL);
+
+	DWORD statusCode = 0;
+	if (results)
+	{
+		DWORD size = sizeof(statusCode);
+		WinHttpQueryHeaders(request, WINHTTP_QUERY_STATUS_CODE | WINHTTP_QUERY_FLAG_NUMBER, WINHTTP_HEADER_NAME_BY_INDEX, &statusCode, &size, WINHTTP_NO_HEADER_INDEX);
+
+		DWORD headerSize = 0;
+		WinHttpQueryHeaders(request, WINHTTP_QUERY_RAW_HEADERS_CRLF, WINHTTP_HEADER_NAME_BY_INDEX, WINHTTP_NO_OUTPUT_BUFFER, &headerSize, WINHTTP_NO_HEADER_INDEX);
+		if (GetLastError() == ERROR_INSUFFICIENT_BUFFER && headerSize > 0)
+		{
+			retVal.ResponseHeader.resize(headerSize / sizeof(wchar_t));
+			if (!WinHttpQueryHeaders(request, WINHTTP_QUERY_RAW_HEADERS_CRLF, WINHTTP_HEADER_NAME_BY_INDEX, &retVal.ResponseHeader[0], &headerSize, WINHTTP_NO_HEADER_INDEX))
+				headerSize = 0;
+
+			retVal.ResponseHeader.resize(headerSize / sizeof(wchar_t));
+		}
+	}
+
+	while (results)
+	{
+		DWORD available = 0;
+		results = WinHttpQueryDataAvailable(request, &available);
+		if (!results || available == 0)
+			break;
+
+		auto offset = retVal.ResponseBody.size();
+		retVal.ResponseBody.resize(offset + available);
+
+		DWORD downloaded = 0;
+		results = WinHttpReadData(request, &retVal.ResponseBody[offset], available, &downloaded);
+		retVal.ResponseBody.resize(offset + downloaded);
+	}
+
+	if (!results)
+	{
+		retVal.LastError = GetLastError();
+		retVal.Error = HttpRequestError::HttpDownloadFailed;
+	}
+
+	WinHttpCloseHandle(request); // the connection stays open for the next request to this host
+
+	updateHealth(hostKey, results && statusCode < 500, retVal.LastError);
+	return retVal;
+}
+
+/// <summary>
+/// Sends the same request to multiple URIs at once, and waits for them to finish (up to BatchDeadlineMs).
+/// </summary>
+/// <param name="uris">The URIs to send the request to.</param>
+/// <param name="method">The HTTP method (GET/POST/etc).</param>
+/// <param name="userAgent">The user agent to send.</param>
+/// <param name="headers">Any extra headers to send, each ending with \r\n.</param>
+/// <param name="body">The request body, or NULL.</param>
+/// <param name="bodySize">The size of the request body.</param>
+/// <returns>The response from each URI, in the same order as uris. Error is HttpRequestError::TimedOut for any that didn't finish in time.</returns>
+std::vector<HttpRequest> HttpPool::SendRequests(const std::vector<std::wstring>& uris, const std::wstring& method, const std::wstring& userAgent, const std::wstring& headers, void* body, DWORD bodySize)
+{
+	// requests that miss the deadline keep running after we return, so they get their own copy of everything
+	auto uriList = std::make_shared<std::vector<std::wstring>>(uris);
+	auto bodyData = std::make_shared<std::vector<BYTE>>();
+	if (body && bodySize)
+		bodyData->assign(static_cast<BYTE*>(body), static_cast<BYTE*>(body) + bodySize);
+
+	std::function<HttpRequest(size_t)> send = [this, uriList, method, userAgent, headers, bodyData](size_t index)
+	{
+		return SendRequest((*uriList)[index], method, userAgent, headers, bodyData->empty() ? NULL : bodyData->data(), (DWORD)bodyData->size());
+	};
+
+	HttpRequest timedOut;
+	timedOut.Error = HttpRequestError::TimedOut;
+	timedOut.LastError = 0;
+	return RunBatch(uris.size(), send, MaxBatchWorkers, std::chrono::milliseconds(BatchDeadlineMs), timedOut);
+}
+
+/// <summary>
+/// Opens the shared WinHttp session, must be called while holding lock.
+/// </summary>
+/// <returns>true if the session was opened.</returns>
+bool HttpPool::openSession()
+{
+	DWORD accessType = WINHTTP_ACCESS_TYPE_DEFAULT_PROXY;
+	std::wstring proxy, proxyBypass;
+
+	WINHTTP_CURRENT_USER_IE_PROXY_CONFIG iecfg = {};
+	if (WinHttpGetIEProxyConfigForCurrentUser(&iecfg))
+	{
+		if (iecfg.fAutoDetect)
+		{
+			// the proxy is looked up for each host when we first connect to it
+			autoDetectProxy = true;
+			accessType = WINHTTP_ACCESS_TYPE_NO_PROXY;
+		}
+		else if (iecfg.lpszProxy && wcslen(iecfg.lpszProxy) > 0)
+		{
+			accessType = WINHTTP_ACCESS_TYPE_NAMED_PROXY;
+			proxy = iecfg.lpszProxy;
+			if (iecfg.lpszProxyBypass)
+				proxyBypass = iecfg.lpszProxyBypass;
+		}
+
+		if (iecfg.lpszAutoConfigUrl)
+			GlobalFree(iecfg.lpszAutoConfigUrl);
+		if (iecfg.lpszProxy)
+			GlobalFree(iecfg.lpszProxy);
+		if (iecfg.lpszProxyBypass)
+			GlobalFree(iecfg.lpszProxyBypass);
+	}
+
+	session = WinHttpOpen(L"ElDewrito", accessType, proxy.empty() ? WINHTTP_NO_PROXY_NAME : proxy.c_str(), proxyBypass.empty() ? WINHTTP_NO_PROXY_BYPASS : proxyBypass.c_str(), 0);
+	if (!session)
+		return false;
+
+	// resolve, connect, send, receive - shorter than the 5s HttpSendRequest uses, a dead host shouldn't hold things up
+	WinHttpSetTimeouts(session, 2 * 1000, 3 * 1000, 3 * 1000, 5 * 1000);
+	return true;
+}
+
+/// <summary>
+/// Looks up the auto-detected proxy for a host.
+/// </summary>
+/// <param name="hostKey">The scheme://host:port of the host.</param>
+void HttpPool::resolveProxy(const std::wstring& hostKey)
+{
+	WINHTTP_AUTOPROXY_OPTIONS options = {};
+	options.dwFlags = WINHTTP_AUTOPROXY_AUTO_DETECT;
+	options.dwAutoDetectFlags = WINHTTP_AUTO_DETECT_TYPE_DHCP | WINHTTP_AUTO_DETECT_TYPE_DNS_A;
+	options.fAutoLogonIfChallenged = true;
+
+	WINHTTP_PROXY_INFO info = {};
+	auto found = WinHttpGetProxyForUrl(session, hostKey.c_str(), &options, &info);
+
+	std::lock_guard<std::mutex> guard(lock);
+	auto& host = hosts[hostKey];
+	host.ProxyResolved = true;
+	if (found)
+	{
+		host.ProxyAccessType = info.dwAccessType;
+		if (info.lpszProxy)
+			host.Proxy = info.lpszProxy;
+		if (info.lpszProxyBypass)
+			host.ProxyBypass = info.lpszProxyBypass;
+	}
+
+	if (info.lpszProxy)
+		GlobalFree(info.lpszProxy);
+	if (info.lpszProxyBypass)
+		GlobalFree(info.lpszProxyBypass);
+}
+
+/// <summary>
+/// Updates a hosts health after a request, backing it off if it keeps failing.
+/// </summary>
+/// <param name="hostKey">The scheme://host:port of the host.</param>
+/// <param name="succeeded">Whether the request succeeded.</param>
+/// <param name="lastError">The error code if the request failed.</param>
+void HttpPool::updateHealth(const std::wstring& hostKey, bool succeeded, DWORD lastError)
+{
+	auto& dorito = ElDorito::Instance();
+
+	std::lock_guard<std::mutex> guard(lock);
+	auto change = health.Update(hostKey, succeeded, GetTickCount());
+	if (change.Recovered)
+		dorito.Logger.Log(LogSeverity::Info, "HttpPool", "%s is responding again", dorito.Utils.ThinString(hostKey).c_str());
+	else if (change.BackoffMs)
+		dorito.Logger.Log(LogSeverity::Warning, "HttpPool", "Request to %s failed (error %d, %d in a row), not trying it again for %d seconds", dorito.Utils.ThinString(hostKey).c_str(), lastError, change.Failures, change.BackoffMs / 1000);
+	else if (!succeeded)
+		dorito.Logger.Log(LogSeverity::Warning, "HttpPool", "Request to %s failed (error %d, %d in a row)", dorito.Utils.ThinString(hostKey).c_str(), lastError, change.Failures);
+}
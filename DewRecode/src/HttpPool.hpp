@@ -0,0 +1,44 @@
+#pragma once
+#include <ElDorito/ElDorito.hpp>
+#include <winhttp.h>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "HostHealth.hpp"
+
+// sends HTTP requests through a single long-lived WinHttp session, so connections to a host are kept alive and reused between requests
+// and the session setup/proxy detection only happens once per host instead of on every request
+// also keeps track of each hosts health (see HostHealth), hosts that keep failing get backed off so they can't hold up requests to the other hosts
+class HttpPool
+{
+public:
+	HttpPool();
+	~HttpPool();
+
+	HttpRequest SendRequest(const std::wstring& uri, const std::wstring& method, const std::wstring& userAgent, const std::wstring& headers, void* body, DWORD bodySize);
+	std::vector<HttpRequest> SendRequests(const std::vector<std::wstring>& uris, const std::wstring& method, const std::wstring& userAgent, const std::wstring& headers, void* body, DWORD bodySize);
+
+private:
+	static const size_t MaxBatchWorkers = 4; // SendRequests never uses more threads than this, however many URIs it's given
+	static const DWORD BatchDeadlineMs = 10 * 1000; // SendRequests gives up waiting after this, requests that haven't finished fail with TimedOut
+
+	struct HostInfo
+	{
+		HINTERNET Connection = NULL;
+		bool ProxyResolved = false;
+		DWORD ProxyAccessType = WINHTTP_ACCESS_TYPE_DEFAULT_PROXY;
+		std::wstring Proxy;
+		std::wstring ProxyBypass;
+	};
+
+	std::mutex lock; // guards everything below
+	HINTERNET session = NULL;
+	bool autoDetectProxy = false;
+	std::map<std::wstring, HostInfo> hosts; // key is scheme://host:port
+	HostHealth health;
+
+	bool openSession();
+	void resolveProxy(const std::wstring& hostKey);
+	void updateHealth(const std::wstring& hostKey, bool succeeded, DWORD lastError);
+};
@@ -0,0 +1,533 @@
+#include "KeyManager.hpp"
+#include <cctype>
+#include <cstring>
+#include <sstream>
+#include <system_error>
+
+#include <openssl/rsa.h>
+#include <openssl/pem.h>
+#include <openssl/sha.h>
+
+namespace
+{
+	const std::string KeyStoreMagic = "ElDewritoKeyStore";
+
+	std::string ChecksumEntry(const std::string& type, const PlayerKeyPair& key)
+	{
+		auto entry = type + " " + key.PrivateKey + " " + key.PublicKey;
+
+		unsigned char hash[SHA256_DIGEST_LENGTH];
+		SHA256_CTX sha256;
+		SHA256_Init(&sha256);
+		SHA256_Update(&sha256, entry.c_str(), entry.length());
+		SHA256_Final(hash, &sha256);
+
+		const char* digits = "0123456789abcdef";
+		std::string hashStr;
+		for (auto b : hash)
+		{
+			hashStr += digits[b >> 4];
+			hashStr += digits[b & 0xF];
+		}
+		return hashStr;
+	}
+
+	void WriteEntry(std::stringstream& ss, const std::string& type, const PlayerKeyPair& key)
+	{
+		ss << type << " " << key.PrivateKey << " " << key.PublicKey << " " << ChecksumEntry(type, key) << "\n";
+	}
+
+	std::string ToLower(std::string str)
+	{
+		for (auto& c : str)
+			c = (char)tolower((unsigned char)c);
+		return str;
+	}
+
+	// puts the PEM header/footer and newlines back on a stripped key, the same as Utils.RSAReformatKey
+	std::string FormatPemKey(const std::string& key, bool isPrivateKey)
+	{
+		std::string type = isPrivateKey ? "RSA PRIVATE KEY" : "PUBLIC KEY";
+		std::string pem = "-----BEGIN " + type + "-----\n";
+		for (size_t pos = 0; pos < key.length(); pos += 64)
+			pem += key.substr(pos, 64) + "\n";
+		return pem + "-----END " + type + "-----\n";
+	}
+
+	// DER encoding of an RSA public key, so two keys can be compared without poking at the RSA struct
+	std::string EncodePublicKey(RSA* rsa)
+	{
+		auto length = i2d_RSAPublicKey(rsa, NULL);
+		if (length <= 0)
+			return "";
+
+		std::string der(length, '\0');
+		auto out = reinterpret_cast<unsigned char*>(&der[0]);
+		i2d_RSAPublicKey(rsa, &out);
+		return der;
+	}
+}
+
+KeyStore::KeyStore(const std::string& fileName, KeyEnvironment& environment)
+	: fileName(fileName), environment(environment)
+{
+}
+
+/// <summary>
+/// Takes the store's lock and loads the latest version of the file, another instance might have changed it.
+/// </summary>
+/// <returns>false if the lock couldn't be taken, in which case EndUpdate mustn't be called.</returns>
+bool KeyStore::BeginUpdate()
+{
+	if (!environment.LockFile(fileName))
+	{
+		environment.Log(LogSeverity::Error, "Timed out waiting for " + fileName + " to be unlocked");
+		return false;
+	}
+
+	Load();
+	return true;
+}
+
+/// <summary>
+/// Saves any changes made since BeginUpdate and releases the store's lock.
+/// </summary>
+/// <param name="save">Whether the store was changed.</param>
+void KeyStore::EndUpdate(bool save)
+{
+	if (save)
+		Save();
+	environment.UnlockFile(fileName);
+}
+
+/// <summary>
+/// Loads the keystore file, entries that fail their checksum are dropped. A missing file counts as an empty store.
+/// </summary>
+/// <returns>false if the file exists but couldn't be used.</returns>
+bool KeyStore::Load()
+{
+	hasActiveKey = false;
+	readOnly = false;
+	pool.clear();
+
+	std::string contents;
+	bool exists = false;
+	if (!environment.ReadFile(fileName, contents, exists))
+		return !exists;
+
+	std::vector<std::string> errors;
+	bool parsed = Parse(contents, &activeKey, hasActiveKey, pool, errors);
+
+	for (auto& error : errors)
+		environment.Log(LogSeverity::Warning, fileName + ": " + error);
+
+	if (!parsed)
+	{
+		// don't write over a store from a newer version, it probably still has keys in it that version can use
+		readOnly = contents.compare(0, KeyStoreMagic.length(), KeyStoreMagic) == 0;
+
+		// otherwise move the damaged file out of the way before it gets replaced, in case someone wants to dig the keys out of it
+		if (!readOnly)
+		{
+			auto badName = fileName + ".bad";
+			if (environment.RenameFile(fileName, badName))
+				environment.Log(LogSeverity::Warning, "Moved the damaged keystore to " + badName);
+		}
+		return false;
+	}
+
+	// rewrite the file without the damaged entries
+	if (!errors.empty())
+		Save();
+
+	return true;
+}
+
+/// <summary>
+/// Writes the keystore, the environment swaps the new file in so a crash halfway through can't leave a truncated store behind.
+/// </summary>
+/// <returns>true if the store was written.</returns>
+bool KeyStore::Save()
+{
+	if (readOnly)
+		return false;
+
+	return environment.ReplaceFile(fileName, Serialize(hasActiveKey ? &activeKey : NULL, pool));
+}
+
+bool KeyStore::GetActiveKey(PlayerKeyPair& key)
+{
+	if (!hasActiveKey)
+		return false;
+
+	key = activeKey;
+	return true;
+}
+
+void KeyStore::SetActiveKey(const PlayerKeyPair& key)
+{
+	activeKey = key;
+	hasActiveKey = true;
+}
+
+void KeyStore::AddPooledKey(const PlayerKeyPair& key)
+{
+	pool.push_back(key);
+}
+
+bool KeyStore::TakePooledKey(PlayerKeyPair& key)
+{
+	if (pool.empty())
+		return false;
+
+	key = pool.back();
+	pool.pop_back();
+	return true;
+}
+
+/// <summary>
+/// Builds the contents of a keystore file.
+/// </summary>
+/// <param name="activeKey">The active key to back up, or NULL.</param>
+/// <param name="pool">The pre-generated keys.</param>
+/// <returns>The file contents.</returns>
+std::string KeyStore::Serialize(const PlayerKeyPair* activeKey, const std::vector<PlayerKeyPair>& pool)
+{
+	std::stringstream ss;
+	ss << KeyStoreMagic << " " << Version << "\n";
+	if (activeKey)
+		WriteEntry(ss, "active", *activeKey);
+	for (auto& key : pool)
+		WriteEntry(ss, "pool", key);
+	return ss.str();
+}
+
+/// <summary>
+/// Parses the contents of a keystore file, entries that are damaged get skipped and added to errors.
+/// </summary>
+/// <param name="contents">The file contents.</param>
+/// <param name="activeKey">Filled with the active key, if the store has one.</param>
+/// <param name="hasActiveKey">Set to whether the store has an active key.</param>
+/// <param name="pool">Filled with the pre-generated keys.</param>
+/// <param name="errors">Problems with the file.</param>
+/// <returns>false if the file isn't a keystore or is from a version we can't read.</returns>
+bool KeyStore::Parse(const std::string& contents, PlayerKeyPair* activeKey, bool& hasActiveKey, std::vector<PlayerKeyPair>& pool, std::vector<std::string>& errors)
+{
+	hasActiveKey = false;
+
+	std::stringstream ss(contents);
+	std::string magic;
+	int version = 0;
+	if (!(ss >> magic >> version) || magic != KeyStoreMagic)
+	{
+		errors.push_back("not a keystore file");
+		return false;
+	}
+
+	if (version > Version)
+	{
+		errors.push_back("keystore version " + std::to_string(version) + " is newer than this version of ElDewrito supports");
+		return false;
+	}
+
+	std::string line;
+	std::getline(ss, line); // rest of the header line
+	for (int lineNum = 2; std::getline(ss, line); lineNum++)
+	{
+		if (line.empty() || line == "\r")
+			continue;
+
+		std::stringstream lineStream(line);
+		std::string type, checksum;
+		PlayerKeyPair key;
+		if (!(lineStream >> type >> key.PrivateKey >> key.PublicKey >> checksum))
+		{
+			errors.push_back("line " + std::to_string(lineNum) + " is incomplete");
+			continue;
+		}
+
+		if (ToLower(checksum) != ChecksumEntry(type, key))
+		{
+			errors.push_back("line " + std::to_string(lineNum) + " failed its checksum");
+			continue;
+		}
+
+		if (type == "active" && activeKey)
+		{
+			*activeKey = key;
+			hasActiveKey = true;
+		}
+		else if (type == "pool")
+			pool.push_back(key);
+		else
+			errors.push_back("line " + std::to_string(lineNum) + " has an unknown entry type \"" + type + "\"");
+	}
+	return true;
+}
+
+KeyManager::KeyManager(const std::string& keyStoreFile, KeyEnvironment& environment)
+	: environment(environment), store(keyStoreFile, environment)
+{
+	keyReady = false;
+}
+
+KeyManager::~KeyManager()
+{
+	// the worker checks this between keys, we can't wait for a running one here since this runs while the DLL is unloading
+	std::lock_guard<std::mutex> lock(this->lock);
+	stopping = true;
+	if (thread.joinable())
+	{
+		if (threadRunning)
+			thread.detach();
+		else
+			thread.join(); // already finished, just needs cleaning up
+	}
+}
+
+/// <summary>
+/// Starts getting a key ready in the background, taking one from the pool if there's one available.
+/// </summary>
+void KeyManager::PrepareKey()
+{
+	std::lock_guard<std::mutex> lock(this->lock);
+	if (keyRequested || keyReady)
+		return;
+
+	keyRequested = true;
+	startWorker();
+}
+
+/// <summary>
+/// Takes the key that PrepareKey got ready.
+/// </summary>
+/// <param name="key">Filled with the key.</param>
+/// <param name="wait">If true, starts preparing a key if that hasn't been done yet and waits for it.</param>
+/// <returns>true if a key was taken.</returns>
+bool KeyManager::TakeKey(PlayerKeyPair& key, bool wait)
+{
+	std::unique_lock<std::mutex> lock(this->lock);
+	if (!keyReady)
+	{
+		if (!wait)
+			return false;
+
+		if (!keyRequested)
+		{
+			keyRequested = true;
+			startWorker();
+		}
+
+		while (!keyReady && threadRunning)
+			keyReadyCondition.wait(lock);
+
+		if (!keyReady)
+			return false; // generation failed
+	}
+
+	key = preparedKey;
+	preparedKey = PlayerKeyPair();
+	keyReady = false;
+	keyRequested = false;
+	return true;
+}
+
+/// <summary>
+/// Gets the backup of the active key from the keystore.
+/// </summary>
+/// <param name="key">Filled with the key.</param>
+/// <returns>true if the keystore has a backup.</returns>
+bool KeyManager::GetBackupKey(PlayerKeyPair& key)
+{
+	std::lock_guard<std::mutex> lock(this->lock);
+	if (!store.BeginUpdate())
+		return false;
+
+	bool hasKey = store.GetActiveKey(key);
+	store.EndUpdate(false);
+	return hasKey;
+}
+
+/// <summary>
+/// Backs the active key up to the keystore, so it can be restored if the cfg loses it.
+/// </summary>
+/// <param name="key">The active key.</param>
+void KeyManager::SetBackupKey(const PlayerKeyPair& key)
+{
+	std::lock_guard<std::mutex> lock(this->lock);
+	if (!store.BeginUpdate())
+		return;
+
+	PlayerKeyPair current;
+	bool changed = !store.GetActiveKey(current) || current.PrivateKey != key.PrivateKey || current.PublicKey != key.PublicKey;
+	if (changed)
+		store.SetActiveKey(key);
+	store.EndUpdate(changed);
+}
+
+/// <summary>
+/// Generates keys into the pool in the background until it holds at least count keys.
+/// </summary>
+/// <param name="count">How many keys the pool should hold.</param>
+void KeyManager::FillPool(size_t count)
+{
+	std::lock_guard<std::mutex> lock(this->lock);
+	poolTarget = count;
+	startWorker();
+}
+
+size_t KeyManager::GetPoolSize()
+{
+	std::lock_guard<std::mutex> lock(this->lock);
+	if (!store.BeginUpdate())
+		return 0;
+
+	auto size = store.GetPoolSize();
+	store.EndUpdate(false);
+	return size;
+}
+
+/// <summary>
+/// Checks that both halves of a keypair can be read and that they belong together.
+/// </summary>
+/// <param name="key">The keypair to check.</param>
+/// <returns>true if the keypair is usable.</returns>
+bool KeyManager::ValidateKeyPair(const PlayerKeyPair& key)
+{
+	if (key.PrivateKey.empty() || key.PublicKey.empty())
+		return false;
+
+	auto privPem = FormatPemKey(key.PrivateKey, true);
+	auto pubPem = FormatPemKey(key.PublicKey, false);
+
+	BIO* privBuff = BIO_new_mem_buf((void*)privPem.c_str(), privPem.length());
+	BIO* pubBuff = BIO_new_mem_buf((void*)pubPem.c_str(), pubPem.length());
+	RSA* privRsa = privBuff ? PEM_read_bio_RSAPrivateKey(privBuff, 0, 0, 0) : NULL;
+	RSA* pubRsa = pubBuff ? PEM_read_bio_RSA_PUBKEY(pubBuff, 0, 0, 0) : NULL;
+
+	bool valid = privRsa && pubRsa && EncodePublicKey(privRsa) == EncodePublicKey(pubRsa);
+
+	if (privRsa)
+		RSA_free(privRsa);
+	if (pubRsa)
+		RSA_free(pubRsa);
+	if (privBuff)
+		BIO_free_all(privBuff);
+	if (pubBuff)
+		BIO_free_all(pubBuff);
+	return valid;
+}
+
+/// <summary>
+/// Works out the UID for a public key.
+/// </summary>
+/// <param name="pubKey">The public key, without PEM headers/footers.</param>
+/// <returns>The first 8 bytes of SHA256(pubKey).</returns>
+uint64_t KeyManager::GetUid(const std::string& pubKey)
+{
+	unsigned char hash[SHA256_DIGEST_LENGTH];
+	SHA256_CTX sha256;
+	SHA256_Init(&sha256);
+	SHA256_Update(&sha256, pubKey.c_str(), pubKey.length());
+	SHA256_Final(hash, &sha256);
+
+	uint64_t uid = 0;
+	memcpy(&uid, hash, sizeof(uint64_t));
+	return uid;
+}
+
+/// <summary>
+/// Starts the worker thread if it isn't already running, must be called while holding lock.
+/// </summary>
+void KeyManager::startWorker()
+{
+	if (threadRunning || stopping)
+		return;
+
+	// the previous worker has already given up the lock for the last time, so this won't block for long
+	if (thread.joinable())
+		thread.join();
+
+	threadRunning = true;
+	try
+	{
+		thread = std::thread(&KeyManager::runWorker, this);
+	}
+	catch (const std::system_error& e)
+	{
+		threadRunning = false;
+		environment.Log(LogSeverity::Error, std::string("Failed to start the key generation thread: ") + e.what());
+	}
+}
+
+/// <summary>
+/// Worker thread, prepares the requested key first and then tops up the pool.
+/// </summary>
+void KeyManager::runWorker()
+{
+	std::unique_lock<std::mutex> lock(this->lock);
+	while (!stopping)
+	{
+		bool forPool = false;
+		if (keyRequested && !keyReady)
+		{
+			if (store.BeginUpdate())
+			{
+				bool took = store.TakePooledKey(preparedKey);
+				auto left = store.GetPoolSize();
+				store.EndUpdate(took);
+
+				if (took)
+				{
+					environment.Log(LogSeverity::Info, "Took a key from the pool (" + std::to_string(left) + " left)");
+					keyReady = true;
+					keyReadyCondition.notify_all();
+					continue;
+				}
+			}
+		}
+		else if (poolTarget > 0 && store.BeginUpdate())
+		{
+			forPool = store.GetPoolSize() < poolTarget;
+			store.EndUpdate(false);
+			if (!forPool)
+				poolTarget = 0; // full, stop checking
+		}
+
+		if (!forPool && !(keyRequested && !keyReady))
+			break;
+
+		lock.unlock();
+		PlayerKeyPair key;
+		bool generated = environment.GenerateKeyPair(KeyBits, key);
+		lock.lock();
+
+		if (!generated)
+		{
+			environment.Log(LogSeverity::Error, "Keypair generation failed");
+			if (!forPool)
+				keyRequested = false; // let the next PrepareKey/TakeKey try again
+			break;
+		}
+
+		if (forPool)
+		{
+			if (store.BeginUpdate())
+			{
+				store.AddPooledKey(key);
+				auto size = store.GetPoolSize();
+				store.EndUpdate(true);
+				environment.Log(LogSeverity::Info, "Generated a pooled key (" + std::to_string(size) + "/" + std::to_string(poolTarget) + ")");
+			}
+		}
+		else
+		{
+			preparedKey = key;
+			keyReady = true;
+			keyReadyCondition.notify_all();
+		}
+	}
+
+	threadRunning = false;
+	keyReadyCondition.notify_all(); // wake anyone waiting on a key that isn't coming
+}
@@ -0,0 +1,129 @@
+#pragma once
+#include <ElDorito/IDebugLog.hpp>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// an RSA keypair with the PEM headers/footers and newlines stripped, which is how they're stored in the cfg
+struct PlayerKeyPair
+{
+	std::string PrivateKey;
+	std::string PublicKey;
+};
+
+// what KeyStore and KeyManager need from the OS, PlayerUid passes in WinKeyEnvironment and the tests use an in-memory one
+class KeyEnvironment
+{
+public:
+	virtual ~KeyEnvironment() { }
+
+	virtual bool LockFile(const std::string& fileName) = 0; // shared with other instances using the same file, false if it couldn't be taken in time
+	virtual void UnlockFile(const std::string& fileName) = 0;
+	virtual bool ReadFile(const std::string& fileName, std::string& contents, bool& exists) = 0;
+	virtual bool ReplaceFile(const std::string& fileName, const std::string& contents) = 0; // mustn't leave a partly written file behind
+	virtual bool RenameFile(const std::string& fileName, const std::string& newName) = 0;
+	virtual bool GenerateKeyPair(int bits, PlayerKeyPair& key) = 0; // slow, only called from KeyManager's worker thread
+	virtual void Log(LogSeverity severity, const std::string& message) = 0;
+};
+
+// named mutexes, the file system, OpenSSL key generation and the debug log
+class WinKeyEnvironment : public KeyEnvironment
+{
+public:
+	~WinKeyEnvironment();
+
+	bool LockFile(const std::string& fileName);
+	void UnlockFile(const std::string& fileName);
+	bool ReadFile(const std::string& fileName, std::string& contents, bool& exists);
+	bool ReplaceFile(const std::string& fileName, const std::string& contents);
+	bool RenameFile(const std::string& fileName, const std::string& newName);
+	bool GenerateKeyPair(int bits, PlayerKeyPair& key);
+	void Log(LogSeverity severity, const std::string& message);
+
+private:
+	std::mutex lock;
+	std::map<std::string, void*> fileMutexes; // mutex HANDLE for each file, created on first use
+};
+
+// on-disk store for player keys, holds a backup of the active key and a pool of pre-generated ones
+// each entry has its own checksum, so a damaged entry only loses that key instead of the whole file
+// several game instances can share the same store (eg. a dedicated server fleet), so changes go through BeginUpdate/EndUpdate
+class KeyStore
+{
+public:
+	static const int Version = 1;
+
+	KeyStore(const std::string& fileName, KeyEnvironment& environment);
+
+	bool BeginUpdate();
+	void EndUpdate(bool save);
+
+	bool Load();
+	bool Save();
+
+	bool GetActiveKey(PlayerKeyPair& key);
+	void SetActiveKey(const PlayerKeyPair& key);
+
+	size_t GetPoolSize() { return pool.size(); }
+	void AddPooledKey(const PlayerKeyPair& key);
+	bool TakePooledKey(PlayerKeyPair& key);
+
+	static std::string Serialize(const PlayerKeyPair* activeKey, const std::vector<PlayerKeyPair>& pool);
+	static bool Parse(const std::string& contents, PlayerKeyPair* activeKey, bool& hasActiveKey, std::vector<PlayerKeyPair>& pool, std::vector<std::string>& errors);
+
+private:
+	std::string fileName;
+	KeyEnvironment& environment;
+	bool readOnly = false; // set if the file was written by a newer version, so we don't clobber it
+
+	bool hasActiveKey = false;
+	PlayerKeyPair activeKey;
+	std::vector<PlayerKeyPair> pool;
+};
+
+// gets player keys ready on a worker thread, either by taking one from the keystore pool or by generating a new one,
+// so the game doesn't freeze for seconds while a 4096-bit key is generated
+// can also fill the pool up ahead of time, eg. for dedicated servers that get started with fresh identities
+class KeyManager
+{
+public:
+	static const int KeyBits = 4096;
+
+	KeyManager(const std::string& keyStoreFile, KeyEnvironment& environment);
+	~KeyManager();
+
+	void PrepareKey();
+	bool IsKeyReady() { return keyReady; }
+	bool TakeKey(PlayerKeyPair& key, bool wait);
+
+	bool GetBackupKey(PlayerKeyPair& key);
+	void SetBackupKey(const PlayerKeyPair& key);
+
+	void FillPool(size_t count);
+	size_t GetPoolSize();
+
+	static bool ValidateKeyPair(const PlayerKeyPair& key);
+	static uint64_t GetUid(const std::string& pubKey);
+
+private:
+	KeyEnvironment& environment;
+	std::mutex lock; // guards everything below
+	std::condition_variable keyReadyCondition;
+	KeyStore store;
+	std::thread thread;
+	bool threadRunning = false;
+	bool stopping = false;
+
+	bool keyRequested = false;
+	std::atomic<bool> keyReady;
+	PlayerKeyPair preparedKey;
+	size_t poolTarget = 0;
+
+	void startWorker();
+	void runWorker();
+};
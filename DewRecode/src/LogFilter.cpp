@@ -0,0 +1,272 @@
+#include "LogFilter.hpp"
+#include <queue>
+#include <cstring>
+#include <cstdlib>
+
+/// <summary>
+/// Compiles the include/exclude filter lists.
+/// </summary>
+/// <param name="include">Filters that a message must match to be logged.</param>
+/// <param name="exclude">Filters that stop a message being logged if it matches any of them.</param>
+LogFilter::LogFilter(const std::vector<std::string>& include, const std::vector<std::string>& exclude)
+{
+	isEmpty = include.empty() && exclude.empty();
+
+	std::vector<std::pair<std::string, int>> patterns;
+	for (auto& filter : include)
+	{
+		Predicate predicate;
+		if (parsePredicate(filter, predicate))
+			includePredicates.push_back(predicate);
+		else if (!filter.empty()) // an empty string is in every message
+			patterns.push_back(std::pair<std::string, int>(filter, (int)numIncludeStrings++));
+	}
+
+	for (auto& filter : exclude)
+	{
+		Predicate predicate;
+		if (parsePredicate(filter, predicate))
+			excludePredicates.push_back(predicate);
+		else if (filter.empty())
+			excludeAll = true;
+		else
+			patterns.push_back(std::pair<std::string, int>(filter, -1));
+	}
+
+	if (!patterns.empty())
+		buildAutomaton(patterns);
+}
+
+/// <summary>
+/// Checks if a message passes the filters.
+/// </summary>
+/// <param name="severity">The severity of the message.</param>
+/// <param name="module">The module the message originated from.</param>
+/// <param name="message">The formatted message.</param>
+/// <returns>true if the message should be logged.</returns>
+bool LogFilter::Matches(LogSeverity severity, const char* module, const char* message) const
+{
+	if (isEmpty)
+		return true;
+	if (excludeAll)
+		return false;
+
+	for (auto& predicate : excludePredicates)
+		if (testPredicate(predicate, severity, module, message, true))
+			return false;
+
+	for (auto& predicate : includePredicates)
+		if (!testPredicate(predicate, severity, module, message, false))
+			return false;
+
+	if (transitions.empty())
+		return true;
+
+	// run the message through the automaton once, noting which include strings we've seen
+	uint64_t seenMask = 0; // used when there's 64 or less include strings, which should be pretty much always
+	std::vector<bool> seenList;
+	if (numIncludeStrings > 64)
+		seenList.resize(numIncludeStrings);
+
+	size_t numSeen = 0;
+	int state = 0;
+	for (auto ptr = reinterpret_cast<const uint8_t*>(message); *ptr; ptr++)
+	{
+		state = transitions[state * numClasses + charClasses[*ptr]];
+		for (auto patternId : outputs[state])
+		{
+			if (patternId < 0)
+				return false; // message contains an excluded string
+
+			if (numIncludeStrings <= 64)
+			{
+				auto bit = 1ULL << patternId;
+				if (!(seenMask & bit))
+				{
+					seenMask |= bit;
+					numSeen++;
+				}
+			}
+			else if (!seenList[patternId])
+			{
+				seenList[patternId] = true;
+				numSeen++;
+			}
+		}
+	}
+
+	return numSeen == numIncludeStrings; // message has to contain every include string
+}
+
+/// <summary>
+/// Builds the automaton used to match the plain string filters.
+/// </summary>
+/// <param name="patterns">The strings to match, along with their pattern IDs.</param>
+void LogFilter::buildAutomaton(const std::vector<std::pair<std::string, int>>& patterns)
+{
+	// only give classes to the bytes the patterns use, keeps the transition table small
+	memset(charClasses, 0, sizeof(charClasses));
+	for (auto& pattern : patterns)
+		for (auto c : pattern.first)
+			if (!charClasses[(uint8_t)c])
+				charClasses[(uint8_t)c] = (uint16_t)numClasses++;
+
+	// build the trie, -1 = no transition yet
+	transitions.assign(numClasses, -1);
+	outputs.resize(1);
+	for (auto& pattern : patterns)
+	{
+		int state = 0;
+		for (auto c : pattern.first)
+		{
+			auto& next = transitions[state * numClasses + charClasses[(uint8_t)c]];
+			if (next < 0)
+			{
+				next = (int)outputs.size();
+				outputs.resize(outputs.size() + 1);
+				transitions.resize(transitions.size() + numClasses, -1);
+			}
+			state = transitions[state * numClasses + charClasses[(uint8_t)c]]; // transitions might have been reallocated
+		}
+		outputs[state].push_back(pattern.second);
+	}
+
+	// turn it into a DFA: breadth-first, fill in missing transitions from each state's fail state
+	std::vector<int> fail(outputs.size(), 0);
+	std::queue<int> pending;
+	for (size_t c = 0; c < numClasses; c++)
+	{
+		auto& next = transitions[c];
+		if (next < 0)
+			next = 0;
+		else
+			pending.push(next);
+	}
+
+	while (!pending.empty())
+	{
+		auto state = pending.front();
+		pending.pop();
+
+		for (size_t c = 0; c < numClasses; c++)
+		{
+			auto next = transitions[state * numClasses + c];
+			auto failNext = transitions[fail[state] * numClasses + c];
+			if (next < 0)
+			{
+				transitions[state * numClasses + c] = failNext;
+				continue;
+			}
+
+			fail[next] = failNext;
+			auto& failOutputs = outputs[failNext];
+			outputs[next].insert(outputs[next].end(), failOutputs.begin(), failOutputs.end());
+			pending.push(next);
+		}
+	}
+}
+
+/// <summary>
+/// Tests a module/severity/wildcard filter against a message.
+/// </summary>
+bool LogFilter::testPredicate(const Predicate& predicate, LogSeverity severity, const char* module, const char* message, bool isExclude) const
+{
+	switch (predicate.Type)
+	{
+	case PredicateType::Module:
+		return wildcardMatch(predicate.Pattern.c_str(), module, true);
+	case PredicateType::Severity:
+		if (isExclude)
+			return severity <= predicate.Severity;
+		return severity >= predicate.Severity;
+	case PredicateType::Message:
+		return wildcardMatch(predicate.Pattern.c_str(), message, false);
+	}
+	return false;
+}
+
+/// <summary>
+/// Parses a filter string into a module/severity/wildcard predicate.
+/// </summary>
+/// <param name="filter">The filter string.</param>
+/// <param name="predicate">Returns the parsed predicate.</param>
+/// <returns>false if the filter is a plain string.</returns>
+bool LogFilter::parsePredicate(const std::string& filter, Predicate& predicate)
+{
+	static const char* severityNames[] = { "debug", "info", "warning", "error", "fatal" };
+
+	if (!_strnicmp(filter.c_str(), "module:", 7))
+	{
+		predicate.Type = PredicateType::Module;
+		predicate.Pattern = filter.substr(7);
+		return true;
+	}
+
+	if (!_strnicmp(filter.c_str(), "severity:", 9))
+	{
+		auto name = filter.substr(9);
+		for (int i = 0; i < _countof(severityNames); i++)
+		{
+			if (_stricmp(name.c_str(), severityNames[i]))
+				continue;
+
+			predicate.Type = PredicateType::Severity;
+			predicate.Severity = static_cast<LogSeverity>(i);
+			return true;
+		}
+		return false; // unknown severity, treat it as a plain string
+	}
+
+	if (filter.find_first_of("*?") != std::string::npos)
+	{
+		// match anywhere in the message, like the plain strings do
+		predicate.Type = PredicateType::Message;
+		predicate.Pattern = "*" + filter + "*";
+		return true;
+	}
+
+	return false;
+}
+
+/// <summary>
+/// Matches a string against a wildcard pattern (* matches any number of characters, ? matches one character)
+/// </summary>
+bool LogFilter::wildcardMatch(const char* pattern, const char* str, bool ignoreCase)
+{
+	const char* starPattern = nullptr;
+	const char* starStr = nullptr;
+	while (*str)
+	{
+		auto p = *pattern;
+		auto s = *str;
+		if (ignoreCase)
+		{
+			p = (char)tolower((unsigned char)p);
+			s = (char)tolower((unsigned char)s);
+		}
+
+		if (p == '*')
+		{
+			// remember where the star was so we can backtrack to it
+			starPattern = ++pattern;
+			starStr = str;
+		}
+		else if (p == '?' || (p && p == s))
+		{
+			pattern++;
+			str++;
+		}
+		else if (starPattern)
+		{
+			pattern = starPattern;
+			str = ++starStr;
+		}
+		else
+			return false;
+	}
+
+	while (*pattern == '*')
+		pattern++;
+
+	return !*pattern;
+}
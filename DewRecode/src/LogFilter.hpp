@@ -0,0 +1,61 @@
+#pragma once
+#include <ElDorito/IDebugLog.hpp>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+// compiled form of the Game.LogFilter include/exclude lists, rebuilt whenever the lists change
+// plain strings are all matched in a single pass over the message (Aho-Corasick automaton) instead of strstr'ing each filter
+// filters can also take these forms:
+//   module:<name> - matches the module the message came from (case-insensitive)
+//   severity:<debug|info|warning|error|fatal> - as an include: this severity or higher, as an exclude: this severity or lower
+//   anything containing * or ? is treated as a wildcard pattern (matched anywhere in the message, or against the whole module name)
+class LogFilter
+{
+public:
+	LogFilter(const std::vector<std::string>& include, const std::vector<std::string>& exclude);
+
+	/// <summary>
+	/// Checks if a message passes the filters.
+	/// </summary>
+	/// <param name="severity">The severity of the message.</param>
+	/// <param name="module">The module the message originated from.</param>
+	/// <param name="message">The formatted message.</param>
+	/// <returns>true if the message should be logged.</returns>
+	bool Matches(LogSeverity severity, const char* module, const char* message) const;
+
+	bool IsEmpty() const { return isEmpty; }
+
+private:
+	enum class PredicateType
+	{
+		Module,
+		Severity,
+		Message // wildcard pattern
+	};
+
+	struct Predicate
+	{
+		PredicateType Type;
+		std::string Pattern;
+		LogSeverity Severity;
+	};
+
+	bool isEmpty;
+	bool excludeAll = false; // an empty exclude string matches everything (same as strstr did)
+
+	std::vector<Predicate> includePredicates;
+	std::vector<Predicate> excludePredicates;
+
+	// automaton for the plain string filters, includes use pattern IDs [0, numIncludeStrings), excludes use -1
+	size_t numIncludeStrings = 0;
+	uint16_t charClasses[256]; // bytes that appear in a pattern get their own class, everything else is class 0
+	size_t numClasses = 1;
+	std::vector<int> transitions; // state * numClasses + class -> next state
+	std::vector<std::vector<int>> outputs; // patterns that end at each state (including ones found through fail links)
+
+	void buildAutomaton(const std::vector<std::pair<std::string, int>>& patterns);
+	bool testPredicate(const Predicate& predicate, LogSeverity severity, const char* module, const char* message, bool isExclude) const;
+	static bool parsePredicate(const std::string& filter, Predicate& predicate);
+	static bool wildcardMatch(const char* pattern, const char* str, bool ignoreCase);
+};
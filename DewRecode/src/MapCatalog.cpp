@@ -0,0 +1,277 @@
+#include "MapCatalog.hpp"
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+
+namespace
+{
+	const size_t MapHeaderSize = 0x3390;
+	const int32_t MapHeaderMagic = 'head';
+	const size_t ScenarioPathOffset = 0x1A4;
+	const size_t ScenarioPathSize = 0x100;
+	const size_t MapIdOffset = 0x2DEC;
+
+	std::string ToLower(const std::string& str)
+	{
+		std::string lower(str);
+		std::transform(lower.begin(), lower.end(), lower.begin(), [](char c) { return static_cast<char>(tolower(static_cast<unsigned char>(c))); });
+		return lower;
+	}
+
+	template<class T>
+	std::vector<std::string> GetNames(const std::map<std::string, T>& entries)
+	{
+		std::vector<std::string> names;
+		for (auto& entry : entries)
+			names.push_back(entry.second.Name);
+		return names;
+	}
+
+	// Lists the subfolders of a folder.
+	std::vector<std::string> GetSubdirectories(MapCatalogEnvironment& environment, const std::string& path)
+	{
+		std::vector<MapCatalogEnvironment::DirectoryEntry> entries;
+		environment.ListDirectory(path, entries);
+
+		std::vector<std::string> dirs;
+		for (auto& entry : entries)
+		{
+			if (entry.IsDirectory)
+				dirs.push_back(entry.Name);
+		}
+		return dirs;
+	}
+}
+
+MapCatalog::MapCatalog(MapCatalogEnvironment& environment)
+	: environment(environment)
+{
+	watches[eWatchMaps].Path = "maps";
+	watches[eWatchMaps].Subtree = false;
+	watches[eWatchGameVariants].Path = "mods\\variants";
+	watches[eWatchGameVariants].Subtree = true;
+	watches[eWatchMapVariants].Path = "mods\\maps";
+	watches[eWatchMapVariants].Subtree = true;
+
+	for (auto& watch : watches)
+	{
+		watch.Notification = NULL;
+		watch.Scanned = false;
+	}
+}
+
+MapCatalog::~MapCatalog()
+{
+	for (auto& watch : watches)
+	{
+		if (watch.Notification)
+			environment.StopWatching(watch.Notification);
+	}
+}
+
+bool MapCatalog::FindMap(const std::string& name, MapInfo& info)
+{
+	refresh(eWatchMaps);
+	auto it = maps.find(ToLower(name));
+	if (it == maps.end())
+		return false;
+
+	info = it->second;
+	return true;
+}
+
+bool MapCatalog::FindGameVariant(const std::string& name, VariantInfo& info)
+{
+	refresh(eWatchGameVariants);
+	auto it = gameVariants.find(ToLower(name));
+	if (it == gameVariants.end())
+		return false;
+
+	info = it->second;
+	return true;
+}
+
+bool MapCatalog::FindMapVariant(const std::string& name, VariantInfo& info)
+{
+	refresh(eWatchMapVariants);
+	auto it = mapVariants.find(ToLower(name));
+	if (it == mapVariants.end())
+		return false;
+
+	info = it->second;
+	return true;
+}
+
+std::vector<std::string> MapCatalog::GetMapNames()
+{
+	refresh(eWatchMaps);
+	return GetNames(maps);
+}
+
+std::vector<std::string> MapCatalog::GetMapVariantNames()
+{
+	refresh(eWatchMapVariants);
+	return GetNames(mapVariants);
+}
+
+std::vector<std::string> MapCatalog::GetGameVariantNames()
+{
+	refresh(eWatchGameVariants);
+	return GetNames(gameVariants);
+}
+
+void MapCatalog::Invalidate()
+{
+	for (auto& watch : watches)
+		watch.Scanned = false;
+}
+
+/// <summary>
+/// Scans a folder again if it's never been scanned or something in it has changed since it last was.
+/// </summary>
+void MapCatalog::refresh(WatchIndex index)
+{
+	auto& watch = watches[index];
+	if (!watch.Notification)
+	{
+		// the watch is set up before scanning, so anything that changes while the scan is running gets picked up next time
+		// if the folder doesn't exist yet it can't be watched, so it just gets checked on every lookup until it does
+		watch.Notification = environment.StartWatching(watch.Path, watch.Subtree);
+		watch.Scanned = false;
+	}
+	else if (environment.HasChanged(watch.Notification))
+	{
+		watch.Scanned = false;
+	}
+
+	if (watch.Scanned)
+		return;
+
+	switch (index)
+	{
+	case eWatchMaps:
+		scanMaps();
+		break;
+	case eWatchGameVariants:
+		scanGameVariants();
+		break;
+	case eWatchMapVariants:
+		scanMapVariants();
+		break;
+	}
+	watch.Scanned = watch.Notification != NULL;
+}
+
+void MapCatalog::scanMaps()
+{
+	std::map<std::string, MapInfo> newMaps;
+
+	std::vector<MapCatalogEnvironment::DirectoryEntry> entries;
+	environment.ListDirectory(watches[eWatchMaps].Path, entries);
+	for (auto& entry : entries)
+	{
+		auto extension = entry.Name.find_last_of('.');
+		if (entry.IsDirectory || extension == std::string::npos || ToLower(entry.Name.substr(extension)) != ".map")
+			continue;
+
+		MapInfo info;
+		info.Name = entry.Name.substr(0, extension);
+		info.Path = watches[eWatchMaps].Path + "\\" + entry.Name;
+		info.WriteTime = entry.WriteTime;
+		info.Size = entry.Size;
+
+		// only read the header again if the file has changed
+		auto key = ToLower(info.Name);
+		auto existing = maps.find(key);
+		if (existing != maps.end() && existing->second.WriteTime == info.WriteTime && existing->second.Size == info.Size)
+			info = existing->second;
+		else
+			readMapHeader(info);
+
+		newMaps[key] = info;
+	}
+
+	maps.swap(newMaps);
+}
+
+void MapCatalog::scanGameVariants()
+{
+	gameVariants.clear();
+
+	for (auto& dir : GetSubdirectories(environment, watches[eWatchGameVariants].Path))
+	{
+		// a folder could have more than one variant file in it, the one for the lowest gametype wins
+		auto path = watches[eWatchGameVariants].Path + "\\" + dir;
+		VariantInfo info;
+		info.Name = dir;
+
+		std::vector<MapCatalogEnvironment::DirectoryEntry> entries;
+		environment.ListDirectory(path, entries);
+		for (auto& entry : entries)
+		{
+			auto name = ToLower(entry.Name);
+			if (entry.IsDirectory || name.compare(0, 8, "variant.") != 0)
+				continue;
+
+			auto extension = name.substr(name.find('.') + 1);
+			for (int i = 1; i < Blam::GameType::GameTypeCount; i++)
+			{
+				if (extension != Blam::GameTypeNames[i])
+					continue;
+
+				if (info.Type == Blam::GameType::None || i < info.Type)
+				{
+					info.Type = static_cast<Blam::GameType>(i);
+					info.Path = path + "\\" + entry.Name;
+				}
+				break;
+			}
+		}
+
+		if (info.Type != Blam::GameType::None)
+			gameVariants[ToLower(info.Name)] = info;
+	}
+}
+
+void MapCatalog::scanMapVariants()
+{
+	mapVariants.clear();
+
+	for (auto& dir : GetSubdirectories(environment, watches[eWatchMapVariants].Path))
+	{
+		VariantInfo info;
+		info.Name = dir;
+		info.Path = watches[eWatchMapVariants].Path + "\\" + dir + "\\sandbox.map";
+
+		if (environment.FileExists(info.Path))
+			mapVariants[ToLower(info.Name)] = info;
+	}
+}
+
+/// <summary>
+/// Reads the map ID and scenario path out of a map's header.
+/// </summary>
+/// <returns>false if the file isn't a valid map.</returns>
+bool MapCatalog::readMapHeader(MapInfo& info)
+{
+	info.MapId = -1;
+	info.ScenarioPath.clear();
+
+	std::vector<char> header;
+	if (info.Size < MapHeaderSize || !environment.ReadFileStart(info.Path, MapHeaderSize, header) || header.size() != MapHeaderSize)
+		return false;
+
+	int32_t magic;
+	memcpy(&magic, header.data(), sizeof(magic));
+	if (magic != MapHeaderMagic)
+		return false;
+
+	memcpy(&info.MapId, header.data() + MapIdOffset, sizeof(info.MapId));
+
+	// make sure the path is terminated before using it, it's only informational so anything odd just leaves it empty
+	auto scenarioPath = header.data() + ScenarioPathOffset;
+	auto length = strnlen(scenarioPath, ScenarioPathSize);
+	if (length < ScenarioPathSize)
+		info.ScenarioPath = std::string(scenarioPath, length);
+	return true;
+}
@@ -0,0 +1,117 @@
+#pragma once
+#include <ElDorito/Blam/BlamTypes.hpp>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+// what MapCatalog needs from the OS, ModuleGame passes in the real one (WinMapCatalogEnvironment) and the tests keep the folders in memory
+class MapCatalogEnvironment
+{
+public:
+	struct DirectoryEntry
+	{
+		std::string Name;
+		bool IsDirectory;
+		uint64_t WriteTime;
+		uint64_t Size;
+	};
+
+	virtual ~MapCatalogEnvironment() { }
+
+	virtual void ListDirectory(const std::string& path, std::vector<DirectoryEntry>& entries) = 0; // leaves out . and .., nothing if it can't be listed
+	virtual bool FileExists(const std::string& path) = 0; // false for directories
+	virtual bool ReadFileStart(const std::string& path, size_t length, std::vector<char>& data) = 0; // up to length bytes from the start of the file
+
+	// a folder gets watched so it only needs scanning again once something in it changes
+	virtual void* StartWatching(const std::string& path, bool subtree) = 0; // NULL if it can't be watched (eg. it doesn't exist yet)
+	virtual bool HasChanged(void* watch) = 0; // true if anything changed since the watch started or HasChanged last returned true
+	virtual void StopWatching(void* watch) = 0;
+};
+
+// FindFirstFile, ifstream, and change notifications for watching
+class WinMapCatalogEnvironment : public MapCatalogEnvironment
+{
+public:
+	void ListDirectory(const std::string& path, std::vector<DirectoryEntry>& entries);
+	bool FileExists(const std::string& path);
+	bool ReadFileStart(const std::string& path, size_t length, std::vector<char>& data);
+	void* StartWatching(const std::string& path, bool subtree);
+	bool HasChanged(void* watch);
+	void StopWatching(void* watch);
+};
+
+// index of the maps in the maps folder and the map/game variants in the mods folder
+// everything gets scanned the first time it's needed and lookups are answered from memory after that,
+// each folder is watched with a change notification so it only gets scanned again when something in it changes
+// map headers are only read again if the file's write time or size changed
+class MapCatalog
+{
+public:
+	struct MapInfo
+	{
+		std::string Name; // file name without the extension
+		std::string Path;
+		int MapId = -1; // -1 if the file isn't a valid map
+		std::string ScenarioPath;
+		uint64_t WriteTime = 0;
+		uint64_t Size = 0;
+	};
+
+	struct VariantInfo
+	{
+		std::string Name; // name of the folder it's in
+		std::string Path;
+		Blam::GameType Type = Blam::GameType::None; // always None for map variants
+	};
+
+	explicit MapCatalog(MapCatalogEnvironment& environment);
+	~MapCatalog();
+
+	// Finds a map by name (case-insensitive).
+	bool FindMap(const std::string& name, MapInfo& info);
+
+	// Finds a game variant in mods/variants by name (case-insensitive).
+	bool FindGameVariant(const std::string& name, VariantInfo& info);
+
+	// Finds a map variant in mods/maps by name (case-insensitive).
+	bool FindMapVariant(const std::string& name, VariantInfo& info);
+
+	std::vector<std::string> GetMapNames();
+	std::vector<std::string> GetMapVariantNames();
+	std::vector<std::string> GetGameVariantNames();
+
+	// Makes everything get scanned again on the next lookup.
+	void Invalidate();
+
+private:
+	enum WatchIndex
+	{
+		eWatchMaps,
+		eWatchGameVariants,
+		eWatchMapVariants,
+
+		eWatch_Count
+	};
+
+	struct Watch
+	{
+		std::string Path;
+		bool Subtree;
+		void* Notification; // NULL if the folder isn't being watched
+		bool Scanned;
+	};
+
+	MapCatalogEnvironment& environment;
+	Watch watches[eWatch_Count];
+	std::map<std::string, MapInfo> maps; // keys are lowercase
+	std::map<std::string, VariantInfo> gameVariants;
+	std::map<std::string, VariantInfo> mapVariants;
+
+	void refresh(WatchIndex index);
+	void scanMaps();
+	void scanGameVariants();
+	void scanMapVariants();
+
+	bool readMapHeader(MapInfo& info);
+};
@@ -126,7 +126,12 @@ namespace
 		if (statusBool)
 			status = "enabled.";
 
-		dorito.Patches.EnablePatch(dorito.Modules.Camera.CenteredCrosshairPatch, statusBool);
+		std::string error;
+		if (!dorito.Patches.TryEnablePatch(dorito.Modules.Camera.CenteredCrosshairPatch, statusBool, error))
+		{
+			returnInfo = "Failed to change the crosshair: " + error;
+			return false;
+		}
 
 		returnInfo = "Centered crosshair " + status;
 		return true;
@@ -153,7 +158,12 @@ namespace
 		if (statusBool)
 			status = "hidden.";
 
-		dorito.Patches.EnablePatch(dorito.Modules.Camera.HideHudPatch, statusBool);
+		std::string error;
+		if (!dorito.Patches.TryEnablePatch(dorito.Modules.Camera.HideHudPatch, statusBool, error))
+		{
+			returnInfo = "Failed to change the HUD: " + error;
+			return false;
+		}
 
 		returnInfo = "HUD " + status;
 		return true;
@@ -226,15 +236,25 @@ namespace
 		Pointer &directorGlobalsPtr = dorito.Engine.GetMainTls(GameGlobals::Director::TLSOffset)[0];
 		Pointer &observerGlobalsPtr = dorito.Engine.GetMainTls(GameGlobals::Observer::TLSOffset)[0];
 
-		// patches allowing us to control the camera when a non-default mode is selected
-		dorito.Patches.EnablePatchSet(camera.CustomModePatches, mode.compare("default") != 0);
+		// if any of these patches can't be changed, the ones that were get put back so they still match the mode we're staying in
+		auto customWasEnabled = camera.CustomModePatches->Enabled;
+		auto staticWasEnabled = camera.StaticModePatches->Enabled;
+		std::string error;
 
-		// prevents the engine from modifying any camera components while in static/spectator mode
-		dorito.Patches.EnablePatchSet(camera.StaticModePatches, mode.compare("static") == 0 || mode.compare("spectator") == 0);
+		// patches allowing us to control the camera when a non-default mode is selected
+		auto patched = dorito.Patches.TryEnablePatchSet(camera.CustomModePatches, mode.compare("default") != 0, error)
+			// prevents the engine from modifying any camera components while in static/spectator mode
+			&& dorito.Patches.TryEnablePatchSet(camera.StaticModePatches, mode.compare("static") == 0 || mode.compare("spectator") == 0, error)
+			// makes sure the hud is hidden when flying/spectator/static camera mode
+			&& (camera.VarCameraHideHud->ValueInt || dorito.Patches.TryEnablePatch(camera.HideHudPatch, mode.compare("flying") == 0 || mode.compare("static") == 0 || mode.compare("spectator") == 0, error));
 
-		// makes sure the hud is hidden when flying/spectator/static camera mode
-		if (!camera.VarCameraHideHud->ValueInt)
-			dorito.Patches.EnablePatch(camera.HideHudPatch, mode.compare("flying") == 0 || mode.compare("static") == 0 || mode.compare("spectator") == 0);
+		if (!patched)
+		{
+			dorito.Patches.EnablePatchSet(camera.CustomModePatches, customWasEnabled);
+			dorito.Patches.EnablePatchSet(camera.StaticModePatches, staticWasEnabled);
+			returnInfo = "Failed to change the camera mode: " + error;
+			return false;
+		}
 
 		// disable player movement while in flycam
 		playerControlGlobalsPtr(GameGlobals::Input::DisablePlayerInputIndex).Write(mode.compare("flying") == 0);
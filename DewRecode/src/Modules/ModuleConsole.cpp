@@ -9,6 +9,12 @@ namespace
 		ElDorito::Instance().Modules.Console.Draw(reinterpret_cast<IDirect3DDevice9*>(param));
 	}
 
+	void ConsoleTickCallback(const std::chrono::duration<double>& deltaTime)
+	{
+		// dedicated servers don't draw anything, so lines have to be collected here too or they'd pile up in the buffers
+		ElDorito::Instance().Modules.Console.CollectLines();
+	}
+
 	void UIConsoleInput(const std::string& input, ConsoleBuffer* buffer)
 	{
 		auto& console = ElDorito::Instance().Modules.Console;
@@ -16,6 +22,14 @@ namespace
 		console.PrintToConsole(ElDorito::Instance().Commands.Execute(input, true));
 	}
 
+	bool VariableConsoleScrollbackUpdate(const std::vector<std::string>& Arguments, std::string& returnInfo)
+	{
+		auto& console = ElDorito::Instance().Modules.Console;
+		console.SetScrollback(console.VarScrollback->ValueInt);
+		returnInfo = "Console scrollback set to " + std::to_string(console.VarScrollback->ValueInt) + " lines.";
+		return true;
+	}
+
 	LRESULT __stdcall ConsoleWndProc(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam)
 	{
 		return ElDorito::Instance().Modules.Console.WndProc(hWnd, msg, wParam, lParam);
@@ -115,6 +129,7 @@ namespace Modules
 	ModuleConsole::ModuleConsole() : ModuleBase("Console")
 	{
 		engine->OnEvent("Core", "Direct3D.EndScene", OnEndScene);
+		engine->OnTick(ConsoleTickCallback);
 		engine->OnWndProc(ConsoleWndProc);
 
 		AddCommand("Show", "show_console", "Shows the console/chat UI", eCommandFlagsNone, CommandConsoleShow);
@@ -128,6 +143,10 @@ namespace Modules
 
 		VarOnAllBoxesClosed = AddVariableString("OnAllBoxesClosed", "allboxesclosed", "Which command to run after all user input boxes have closed", eCommandFlagsNone);
 
+		VarScrollback = AddVariableInt("Scrollback", "console_scrollback", "The number of lines each console tab keeps, older lines are dropped", eCommandFlagsArchived, DefaultScrollback, VariableConsoleScrollbackUpdate);
+		VarScrollback->ValueIntMin = 100;
+		VarScrollback->ValueIntMax = 100000;
+
 		ConsoleBuffer consoleBuff("Console", "Console", UIConsoleInput, true);
 		consoleBuff.Focused = true;
 
@@ -278,10 +297,72 @@ namespace Modules
 				this->consoleBuffer->PushLine(item);
 	}
 
+	void ModuleConsole::SetScrollback(size_t lines)
+	{
+		for (size_t i = 0; i < histories.size(); i++)
+		{
+			histories.at(i).Lines.SetCapacity(lines);
+			clampScroll(i);
+		}
+	}
+
+	/// <summary>
+	/// Moves the lines that have been pushed into each buffer since the last call into its history, dropping the oldest lines once the scrollback is full.
+	/// </summary>
+	void ModuleConsole::CollectLines()
+	{
+		for (size_t i = 0; i < buffers.size(); i++)
+		{
+			auto& buffer = buffers.at(i);
+			if (buffer.Messages.empty())
+				continue;
+
+			auto& history = histories.at(i);
+			for (auto& message : buffer.Messages)
+			{
+				history.Lines.Push().Set(message);
+
+				// keep the view where it is if the user has scrolled up (until the lines they're looking at get dropped)
+				if (buffer.ScrollIndex > 0)
+					buffer.ScrollIndex++;
+			}
+			buffer.Messages.clear(); // keeps its capacity, so it only ever grows to the most lines pushed between two ticks
+			clampScroll(i);
+		}
+	}
+
+	void ModuleConsole::scrollUp(size_t bufferIdx)
+	{
+		buffers.at(bufferIdx).ScrollIndex++;
+		clampScroll(bufferIdx);
+	}
+
+	void ModuleConsole::scrollDown(size_t bufferIdx)
+	{
+		auto& buffer = buffers.at(bufferIdx);
+		if (buffer.ScrollIndex > 0)
+			buffer.ScrollIndex--;
+	}
+
+	void ModuleConsole::clampScroll(size_t bufferIdx)
+	{
+		auto& buffer = buffers.at(bufferIdx);
+		int maxScroll = static_cast<int>(histories.at(bufferIdx).Lines.Size()) - buffer.MaxDisplayLines;
+		if (maxScroll < 0)
+			maxScroll = 0;
+		if (buffer.ScrollIndex > static_cast<unsigned int>(maxScroll))
+			buffer.ScrollIndex = maxScroll;
+	}
+
 	ConsoleBuffer* ModuleConsole::AddBuffer(ConsoleBuffer buffer)
 	{
+		size_t scrollback = DefaultScrollback;
+		if (VarScrollback)
+			scrollback = VarScrollback->ValueInt;
+
 		buffer.Group = utils->ToLower(buffer.Group);
 		buffers.push_back(buffer);
+		histories.push_back(ConsoleBufferHistory(scrollback, DefaultInputHistory));
 		if (activeBufferIdx.find(buffer.Group) == activeBufferIdx.end())
 			activeBufferIdx.insert(std::pair<std::string, int>(buffer.Group, buffers.size() - 1));
 
@@ -325,9 +406,12 @@ namespace Modules
 		int verticalSpacingBetweenEachLine = (int)(0.154 * normalSizeFontHeight);
 		int verticalSpacingBetweenLinesAndInputBox = (int)(1.8 * normalSizeFontHeight);
 		int verticalSpacingBetweenTopOfInputBoxAndFont = (inputTextBoxHeight - normalSizeFontHeight) / 2;
-		size_t maxCharsPerLine = 105;
+		int lineViewportWidth = res.first - 2 * x;
+
+		CollectLines();
 
 		auto& selectedBuffer = buffers.at(getSelectedIdx());
+		auto& selectedHistory = histories.at(getSelectedIdx());
 		bool consoleVisible = !(GetTickCount() - selectedBuffer.TimeLastShown > 10000 && !visible);
 
 		if (consoleVisible)
@@ -389,31 +473,15 @@ namespace Modules
 
 			y -= verticalSpacingBetweenLinesAndInputBox;
 
-			// Draw text from selected buffer
-			for (int i = (int)selectedBuffer.Messages.size() - 1 - selectedBuffer.ScrollIndex; i >= 0; i--)
+			// Draw text from selected buffer, newest line first
+			int newestLine = (int)selectedHistory.Lines.Size() - 1 - (int)selectedBuffer.ScrollIndex;
+			for (int i = newestLine; i >= 0 && i > newestLine - selectedBuffer.MaxDisplayLines; i--)
 			{
-				if (i <= (int)(selectedBuffer.Messages.size() - 1 - selectedBuffer.ScrollIndex) - selectedBuffer.MaxDisplayLines)
-					break;
-
-				std::string& line = selectedBuffer.Messages.at(i);
-				if (line.size() > maxCharsPerLine)
-				{
-					std::vector<std::string> linesWrapped = std::vector<std::string>{};
-
-					for (size_t i = 0; i < line.size(); i += maxCharsPerLine)
-					{
-						linesWrapped.push_back(line.substr(i, maxCharsPerLine));
-					}
-
-					for (int i = linesWrapped.size() - 1; i >= 0; i--)
-					{
-						drawText(linesWrapped.at(i).c_str(), x, y, COLOR_WHITE, normalSizeFont);
-						y -= normalSizeFontHeight + verticalSpacingBetweenEachLine;
-					}
-				}
-				else
+				auto& line = selectedHistory.Lines.At(i);
+				auto numRows = line.Wrap(normalSizeFontCharWidth, lineViewportWidth);
+				for (int row = (int)numRows - 1; row >= 0; row--)
 				{
-					drawText(line.c_str(), x, y, COLOR_WHITE, normalSizeFont);
+					drawText(line.GetRow(row).c_str(), x, y, COLOR_WHITE, normalSizeFont);
 					y -= normalSizeFontHeight + verticalSpacingBetweenEachLine;
 				}
 			}
@@ -537,6 +605,56 @@ namespace Modules
 			}
 		}
 
+		if (ElDorito::Instance().Modules.Debug.VarProfilerOverlay->ValueInt)
+			drawProfilerOverlay(device);
+	}
+
+	/// <summary>
+	/// Draws the zones that took the most time in the top right corner.
+	/// </summary>
+	void ModuleConsole::drawProfilerOverlay(IDirect3DDevice9* device)
+	{
+		// getting the stats means sorting every zone that's been recorded, so they're only updated a couple of times a second
+		auto now = GetTickCount();
+		if (profilerLines.empty() || now - profilerLinesTime >= ProfilerOverlayInterval)
+		{
+			profilerLinesTime = now;
+			profilerLines.clear();
+
+			auto& profiler = ElDorito::Instance().Profiler;
+			if (!profiler.IsEnabled())
+				profilerLines.push_back("Profiler isn't recording (Debug.Profiler 1)");
+			else
+			{
+				profilerLines.push_back("zone: avg / p99 / max ms (calls)");
+				auto stats = profiler.GetStats();
+				for (size_t i = 0; i < stats.size() && i < MaxProfilerOverlayZones; i++)
+				{
+					char line[256];
+					sprintf_s(line, "%.160s: %.3f / %.3f / %.3f (%u)", stats[i].Name.c_str(), stats[i].AvgMs, stats[i].P99Ms, stats[i].MaxMs, static_cast<unsigned int>(stats[i].Count));
+					profilerLines.push_back(line);
+				}
+			}
+
+			profilerOverlayWidth = 0;
+			for (auto& line : profilerLines)
+			{
+				auto width = getTextWidth(line.c_str(), normalSizeFont);
+				if (width > profilerOverlayWidth)
+					profilerOverlayWidth = width;
+			}
+		}
+
+		auto res = engine->GetGameResolution();
+		int padding = (int)(0.5 * normalSizeFontHeight);
+		int lineHeight = normalSizeFontHeight + (int)(0.154 * normalSizeFontHeight);
+		int width = profilerOverlayWidth + 2 * padding;
+		int x = res.first - width - padding;
+		int y = padding;
+
+		drawBox(device, x, y, width, (int)profilerLines.size() * lineHeight + 2 * padding, COLOR_WHITE, COLOR_BLACK);
+		for (size_t i = 0; i < profilerLines.size(); i++)
+			drawText(profilerLines[i].c_str(), x + padding, y + padding + (int)i * lineHeight, i == 0 ? COLOR_YELLOW : COLOR_WHITE, normalSizeFont);
 	}
 
 	void ModuleConsole::initFonts(IDirect3DDevice9* device)
@@ -552,6 +670,10 @@ namespace Modules
 
 			D3DXCreateFont(device, normalSizeFontHeight, 0, FW_NORMAL, 1, 0, DEFAULT_CHARSET, OUT_DEFAULT_PRECIS, ANTIALIASED_QUALITY, DEFAULT_PITCH | FF_DONTCARE, L"Verdana", &normalSizeFont);
 			normalSizeCurrentFontHeight = normalSizeFontHeight;
+
+			// average character width, used to wrap console lines (lines only get re-wrapped when this changes)
+			const char* sample = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789";
+			normalSizeFontCharWidth = getTextWidth(sample, normalSizeFont) / (int)strlen(sample);
 		}
 
 		if (!largeSizeFont || largeSizeFontHeight != largeSizeCurrentFontHeight)
@@ -850,18 +972,15 @@ namespace Modules
 
 	void ModuleConsole::consoleMouseCallBack(RAWMOUSE mouseInfo)
 	{
-		auto& buffer = buffers.at(getSelectedIdx());
 		if (mouseInfo.usButtonFlags == RI_MOUSE_WHEEL)
 		{
 			if ((short)mouseInfo.usButtonData > 0)
 			{
-				if ((int)buffer.ScrollIndex < (int)(buffer.Messages.size() - buffer.MaxDisplayLines))
-					buffer.ScrollIndex++;
+				scrollUp(getSelectedIdx());
 			}
 			else
 			{
-				if (buffer.ScrollIndex > 0)
-					buffer.ScrollIndex--;
+				scrollDown(getSelectedIdx());
 			}
 		}
 	}
@@ -869,6 +988,7 @@ namespace Modules
 	void ModuleConsole::consoleKeyCallBack(USHORT vKey)
 	{
 		auto& buffer = buffers.at(getSelectedIdx());
+		auto& history = histories.at(getSelectedIdx());
 		auto& dorito = ElDorito::Instance();
 
 		switch (vKey)
@@ -877,7 +997,7 @@ namespace Modules
 			if (!this->inputBox.Text.empty())
 			{
 				auto& text = this->inputBox.Text;
-				buffer.InputHistory.push_back(text);
+				history.InputHistory.Push(text);
 				if (buffer.InputCallback != nullptr)
 					buffer.InputCallback(text, &buffer);
 
@@ -905,22 +1025,20 @@ namespace Modules
 			break;
 
 		case VK_PRIOR: // PAGE UP
-			if ((int)buffer.ScrollIndex < (int)(buffer.Messages.size() - buffer.MaxDisplayLines))
-				buffer.ScrollIndex++;
+			scrollUp(getSelectedIdx());
 			break;
 
 		case VK_NEXT: // PAGE DOWN
-			if (buffer.ScrollIndex > 0)
-				buffer.ScrollIndex--;
+			scrollDown(getSelectedIdx());
 			break;
 
 		case VK_UP:
 			buffer.InputHistoryIndex++;
 
-			if (buffer.InputHistoryIndex > (int)buffer.InputHistory.size() - 1)
+			if (buffer.InputHistoryIndex > (int)history.InputHistory.Size() - 1)
 				buffer.InputHistoryIndex--;
 			if (buffer.InputHistoryIndex >= 0)
-				inputBox.Set(buffer.InputHistory.at(buffer.InputHistory.size() - 1 - buffer.InputHistoryIndex));
+				inputBox.Set(history.InputHistory.At(history.InputHistory.Size() - 1 - buffer.InputHistoryIndex));
 
 			break;
 
@@ -933,7 +1051,7 @@ namespace Modules
 				inputBox.Clear();
 			}
 			else
-				inputBox.Set(buffer.InputHistory.at(buffer.InputHistory.size() - 1 - buffer.InputHistoryIndex));
+				inputBox.Set(history.InputHistory.At(history.InputHistory.Size() - 1 - buffer.InputHistoryIndex));
 
 			break;
 
@@ -949,34 +1067,7 @@ namespace Modules
 			if (getNumBuffersInGroup(activeGroup) > 1)
 				switchToNextIdx();
 			else
-			{
-				if (inputBox.Text.find_first_of(" ") != std::string::npos || inputBox.Text.empty())
-					break;
-
-				if (tabHitLast)
-				{
-					if (currentCommandList.size() > 0)
-						inputBox.Set(currentCommandList.at((++tryCount) % currentCommandList.size()));
-				}
-				else
-				{
-					tryCount = 0;
-					currentCommandList.clear();
-					commandPriorComplete = inputBox.Text;
-
-					auto currentLine = utils->ToLower(inputBox.Text);
-
-					for (auto cmd : dorito.Commands.List)
-					{
-						auto commandName = utils->ToLower(cmd.Name);
-
-						if (commandName.compare(0, currentLine.length(), currentLine) == 0)
-							currentCommandList.push_back(cmd.Name);
-					}
-					buffers.at(getSelectedIdx()).PushLine(std::to_string(currentCommandList.size()) + " commands found starting with \"" + currentLine + ".\"");
-					buffers.at(getSelectedIdx()).PushLine("Press tab to go through them.");
-				}
-			}
+				completeInput();
 			break;
 
 		case 'V':
@@ -1012,6 +1103,123 @@ namespace Modules
 		}
 
 		tabHitLast = vKey == VK_TAB;
+		if (!tabHitLast)
+			updateCompletionCursor();
+	}
+
+	void ModuleConsole::updateCompletionCursor()
+	{
+		// narrow the command name matches down as the user types, so pressing tab doesn't have to search from scratch
+		auto& text = inputBox.Text;
+		if (text.find(' ') != std::string::npos)
+			return; // past the command name, arguments are completed from the command's own values
+
+		auto& index = ElDorito::Instance().Commands.GetCompletionIndex();
+
+		if (!index.IsCurrent(completionCursor) || text.compare(0, completionCursorText.length(), completionCursorText) != 0)
+		{
+			completionCursor = index.Begin();
+			completionCursorText.clear();
+		}
+
+		index.Advance(completionCursor, text.substr(completionCursorText.length()));
+		completionCursorText = text;
+	}
+
+	void ModuleConsole::completeInput()
+	{
+		auto& buffer = buffers.at(getSelectedIdx());
+		if (tabHitLast)
+		{
+			// cycle through the matches from the last time tab was pressed
+			if (completionList.size() > 0)
+			{
+				completionPos = (int)((completionPos + 1) % completionList.size());
+				inputBox.Set(completionBase + completionList.at(completionPos));
+			}
+			return;
+		}
+
+		completionList.clear();
+		completionPos = -1;
+
+		auto& text = inputBox.Text;
+		if (text.empty())
+			return;
+
+		auto& commands = ElDorito::Instance().Commands;
+		const CompletionIndex* index = nullptr;
+		std::string word;
+		size_t first = 0, last = 0;
+
+		auto nameEnd = text.find(' ');
+		if (nameEnd == std::string::npos)
+		{
+			// completing a command name
+			index = &commands.GetCompletionIndex();
+			completionBase.clear();
+			word = text;
+
+			updateCompletionCursor();
+			index->GetRange(completionCursor, first, last);
+		}
+		else
+		{
+			// completing the first argument, if the command has a list of values it accepts
+			auto argEnd = text.find(' ', nameEnd + 1);
+			if (argEnd != std::string::npos)
+				return;
+
+			index = commands.GetValueCompletionIndex(text.substr(0, nameEnd));
+			if (!index)
+				return;
+
+			completionBase = text.substr(0, nameEnd + 1);
+			word = text.substr(nameEnd + 1);
+			index->FindPrefix(word, first, last);
+		}
+
+		bool isFuzzy = first == last;
+		if (isFuzzy)
+		{
+			// nothing starts with what was typed, try finding it anywhere in the names instead
+			std::vector<CompletionIndex::FuzzyMatch> matches;
+			index->FuzzyFind(word, MaxFuzzyCompletions, matches);
+			for (auto& match : matches)
+				completionList.push_back(index->Get(match.Index));
+		}
+		else
+		{
+			for (auto i = first; i < last; i++)
+				completionList.push_back(index->Get(i));
+		}
+
+		if (completionList.empty())
+		{
+			buffer.PushLine("Nothing found matching \"" + word + "\".");
+			return;
+		}
+
+		if (completionList.size() == 1)
+		{
+			inputBox.Set(completionBase + completionList.at(0));
+			completionList.clear();
+			return;
+		}
+
+		// fill in as much as all of the matches have in common, the rest can be cycled through by pressing tab again
+		if (!isFuzzy)
+			inputBox.Set(completionBase + index->GetCommonPrefix(first, last));
+
+		std::stringstream ss;
+		ss << completionList.size() << (isFuzzy ? " closest matches" : " matches") << " for \"" << word << "\":";
+		for (size_t i = 0; i < completionList.size() && i < MaxListedCompletions; i++)
+			ss << " " << completionList.at(i);
+		if (completionList.size() > MaxListedCompletions)
+			ss << " ...";
+
+		buffer.PushLine(ss.str());
+		buffer.PushLine("Press tab to go through them.");
 	}
 
 	void ModuleConsole::handleDefaultKeyInput(USHORT vKey, TextInput& inputBox)
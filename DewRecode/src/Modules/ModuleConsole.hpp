@@ -2,6 +2,8 @@
 #include <ElDorito/ModuleBase.hpp>
 #include <d3dx9.h>
 #include <map>
+#include "../CompletionIndex.hpp"
+#include "../ConsoleLine.hpp"
 
 class TextInput
 {
@@ -76,6 +78,7 @@ namespace Modules
 	{
 	public:
 		Command* VarOnAllBoxesClosed;
+		Command* VarScrollback = nullptr;
 
 		ModuleConsole();
 
@@ -88,6 +91,8 @@ namespace Modules
 		void PrintToConsole(const std::string& str);
 
 		ConsoleBuffer* AddBuffer(ConsoleBuffer buffer);
+		void SetScrollback(size_t lines);
+		void CollectLines();
 		bool SetActiveBuffer(ConsoleBuffer* buffer);
 
 		void Draw(IDirect3DDevice9* device);
@@ -107,6 +112,9 @@ namespace Modules
 		static CONST D3DCOLOR COLOR_MAGNETA = D3DCOLOR_ARGB(255, 255, 000, 255);
 		static CONST D3DCOLOR COLOR_WHITE = D3DCOLOR_ARGB(255, 255, 255, 249);
 
+		static const size_t DefaultScrollback = 1000;
+		static const size_t DefaultInputHistory = 100;
+
 	private:
 		const size_t INPUT_MAX_CHARS = 400;
 		bool visible = false;
@@ -129,11 +137,13 @@ namespace Modules
 		int largeSizeFontHeight = 0;
 		int normalSizeCurrentFontHeight = 0;
 		int largeSizeCurrentFontHeight = 0;
+		int normalSizeFontCharWidth = 0;
 		LPD3DXFONT normalSizeFont = 0;
 		LPD3DXFONT largeSizeFont = 0;
 
 		std::string activeGroup = "Console";
 		std::deque<ConsoleBuffer> buffers;
+		std::deque<ConsoleBufferHistory> histories; // same indexes as buffers
 		std::map<std::string, int> activeBufferIdx; // <GroupName, index>
 		ConsoleBuffer* consoleBuffer;
 		
@@ -143,13 +153,25 @@ namespace Modules
 
 		bool capsLockToggled = false;
 
+		static const size_t MaxFuzzyCompletions = 20;
+		static const size_t MaxListedCompletions = 10;
+
 		bool tabHitLast = false;
-		int tryCount = 0;
-		std::string commandPriorComplete = "";
-		std::vector<std::string> currentCommandList = std::vector<std::string>{};
+		int completionPos = -1;
+		std::string completionBase; // the part of the input before the text being completed
+		std::vector<std::string> completionList;
+		CompletionIndex::Cursor completionCursor; // command names matching completionCursorText
+		std::string completionCursorText;
+
+		static const DWORD ProfilerOverlayInterval = 500; // ms between updates of the profiler overlay
+		static const size_t MaxProfilerOverlayZones = 15;
+		std::vector<std::string> profilerLines;
+		DWORD profilerLinesTime = 0;
+		int profilerOverlayWidth = 0;
 
 		void initFonts(IDirect3DDevice9* device);
 
+		void drawProfilerOverlay(IDirect3DDevice9* device);
 		void drawText(const char* text, int x, int y, DWORD color, LPD3DXFONT pFont);
 		void drawRect(IDirect3DDevice9* device, int x, int y, int width, int height, DWORD Color);
 		void drawHorizontalLine(IDirect3DDevice9* device, int x, int y, int width, D3DCOLOR Color);
@@ -167,7 +189,13 @@ namespace Modules
 		//void userInputBoxMouseCallback(RAWMOUSE mouseInfo);
 		void consoleMouseCallBack(RAWMOUSE mouseInfo);
 
+		void scrollUp(size_t bufferIdx);
+		void scrollDown(size_t bufferIdx);
+		void clampScroll(size_t bufferIdx);
+
 		void handleDefaultKeyInput(USHORT vKey, TextInput& inputBox);
+		void updateCompletionCursor();
+		void completeInput();
 
 		int getSelectedIdxForGroup(const std::string& group);
 		int getNumBuffersInGroup(const std::string& group);
@@ -70,6 +70,51 @@ namespace
 		return true;
 	}
 
+	bool VariableProfilerUpdate(const std::vector<std::string>& Arguments, std::string& returnInfo)
+	{
+		auto& dorito = ElDorito::Instance();
+		auto enabled = dorito.Modules.Debug.VarProfiler->ValueInt != 0;
+		dorito.Profiler.SetEnabled(enabled);
+		returnInfo = enabled ? "Profiler started, use Debug.Profile to save a trace." : "Profiler stopped.";
+		return true;
+	}
+
+	bool VariableProfilerOverlayUpdate(const std::vector<std::string>& Arguments, std::string& returnInfo)
+	{
+		auto& debug = ElDorito::Instance().Modules.Debug;
+		if (!debug.VarProfilerOverlay->ValueInt)
+		{
+			returnInfo = "Profiler overlay hidden.";
+			return true;
+		}
+
+		returnInfo = "Profiler overlay shown.";
+		if (!debug.VarProfiler->ValueInt)
+			returnInfo += " Nothing is being recorded, set Debug.Profiler to 1 to start.";
+		return true;
+	}
+
+	bool CommandProfile(const std::vector<std::string>& Arguments, std::string& returnInfo)
+	{
+		auto& profiler = ElDorito::Instance().Profiler;
+		std::string path = Arguments.size() > 0 ? Arguments[0] : "profile.json";
+
+		size_t zones;
+		std::string error;
+		if (!profiler.WriteChromeTrace(path, zones, error))
+		{
+			returnInfo = error;
+			if (!profiler.IsEnabled())
+				returnInfo += ", set Debug.Profiler to 1 to start recording.";
+			return false;
+		}
+
+		returnInfo = "Wrote " + std::to_string(zones) + " zones to " + path + ", open it in chrome://tracing.";
+		if (profiler.GetDroppedCount())
+			returnInfo += " (" + std::to_string(profiler.GetDroppedCount()) + " zones from other threads were dropped)";
+		return true;
+	}
+
 	void ExceptionHook(char* msg)
 	{
 		auto* except = *Pointer(0x238E880).Read<EXCEPTION_RECORD**>();
@@ -79,6 +124,7 @@ namespace
 		ElDorito::Instance().Logger.Log(LogSeverity::Fatal, "GameCrash", "Code: 0x%x, flags: 0x%x, record: 0x%x, addr: 0x%x, numparams: 0x%x",
 			except->ExceptionCode, except->ExceptionFlags, except->ExceptionRecord, except->ExceptionAddress, except->NumberParameters);
 
+		ElDorito::Instance().Shutdown();
 		std::exit(0);
 	}
 }
@@ -91,6 +137,16 @@ namespace Modules
 		VarMemcpyDst = AddVariableInt("MemcpyDst", "memcpy_dst", "Allows breakpointing memcpy based on specified destination address filter.", eCommandFlagsHidden, 0, MemcpyDstFilterUpdate);
 		VarMemsetDst = AddVariableInt("MemsetDst", "memset_dst", "Allows breakpointing memset based on specified destination address filter.", eCommandFlagsHidden, 0, MemsetDstFilterUpdate);
 
+		VarProfiler = AddVariableInt("Profiler", "profiler", "Records how long each tick/event callback takes", eCommandFlagsDontUpdateInitial, 0, VariableProfilerUpdate);
+		VarProfiler->ValueIntMin = 0;
+		VarProfiler->ValueIntMax = 1;
+
+		VarProfilerOverlay = AddVariableInt("ProfilerOverlay", "profiler_overlay", "Shows the slowest profiler zones on screen", eCommandFlagsDontUpdateInitial, 0, VariableProfilerOverlayUpdate);
+		VarProfilerOverlay->ValueIntMin = 0;
+		VarProfilerOverlay->ValueIntMax = 1;
+
+		AddCommand("Profile", "profile", "Saves the zones recorded by the profiler as a Chrome trace", eCommandFlagsNone, CommandProfile, { "file(string) The file to write to, defaults to profile.json" });
+
 		AddModulePatches(
 		{
 			Patch("CrashLog1", 0x51C158, { 0x8D, 0x85, 0x00, 0xFC, 0xFF, 0xFF, 0x50 }),
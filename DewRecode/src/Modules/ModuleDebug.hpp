@@ -9,6 +9,8 @@ namespace Modules
 		Command* VarMemcpySrc;
 		Command* VarMemcpyDst;
 		Command* VarMemsetDst;
+		Command* VarProfiler;
+		Command* VarProfilerOverlay;
 
 		ModuleDebug();
 	};
@@ -3,10 +3,10 @@
 #include <sstream>
 #include <fstream>
 #include <type_traits>
-#include <filesystem>
 #include <ElDorito/Blam/BlamTypes.hpp>
 #include <ElDorito/Blam/Tags/GameEngineSettingsDefinition.hpp>
 #include "../ElDorito.hpp"
+#include "../Blf.hpp"
 
 namespace
 {
@@ -16,8 +16,8 @@ namespace
 		if (!format)
 			format = backupFormat;
 
-		if (module != 0 && strcmp(module, "game_tick") == 0)
-			return; // filter game_tick spam
+		if (!module)
+			module = "";
 
 		va_list ap;
 		va_start(ap, format);
@@ -99,6 +99,7 @@ namespace
 	{
 		auto& dorito = ElDorito::Instance();
 		auto newFlags = dorito.Modules.Game.DebugFlags;
+		std::string error;
 
 		if (Arguments.size() > 0)
 		{
@@ -106,14 +107,17 @@ namespace
 			{
 				if (arg.compare("off") == 0)
 				{
-					// Disable it.
-					newFlags = 0;
-
-					dorito.Patches.EnableHook(dorito.Modules.Game.NetworkLogHook, false);
-					dorito.Patches.EnableHook(dorito.Modules.Game.SSLLogHook, false);
-					dorito.Patches.EnableHook(dorito.Modules.Game.UILogHook, false);
-					dorito.Patches.EnableHook(dorito.Modules.Game.Game1LogHook, false);
-					dorito.Patches.EnablePatchSet(dorito.Modules.Game.Game2LogHook, false);
+					// Disable it, any hook that can't be removed stays in the flags
+					if (dorito.Patches.TryEnableHook(dorito.Modules.Game.NetworkLogHook, false, error))
+						newFlags &= ~DebugLoggingModes::eDebugLoggingModeNetwork;
+					if (dorito.Patches.TryEnableHook(dorito.Modules.Game.SSLLogHook, false, error))
+						newFlags &= ~DebugLoggingModes::eDebugLoggingModeSSL;
+					if (dorito.Patches.TryEnableHook(dorito.Modules.Game.UILogHook, false, error))
+						newFlags &= ~DebugLoggingModes::eDebugLoggingModeUI;
+					if (dorito.Patches.TryEnableHook(dorito.Modules.Game.Game1LogHook, false, error))
+						newFlags &= ~DebugLoggingModes::eDebugLoggingModeGame1;
+					if (dorito.Patches.TryEnablePatchSet(dorito.Modules.Game.Game2LogHook, false, error))
+						newFlags &= ~DebugLoggingModes::eDebugLoggingModeGame2;
 				}
 				else
 				{
@@ -127,32 +131,32 @@ namespace
 
 					if (hookNetwork)
 					{
-						newFlags |= DebugLoggingModes::eDebugLoggingModeNetwork;
-						dorito.Patches.EnableHook(dorito.Modules.Game.NetworkLogHook, true);
+						if (dorito.Patches.TryEnableHook(dorito.Modules.Game.NetworkLogHook, true, error))
+							newFlags |= DebugLoggingModes::eDebugLoggingModeNetwork;
 					}
 
 					if (hookSSL)
 					{
-						newFlags |= DebugLoggingModes::eDebugLoggingModeSSL;
-						dorito.Patches.EnableHook(dorito.Modules.Game.SSLLogHook, true);
+						if (dorito.Patches.TryEnableHook(dorito.Modules.Game.SSLLogHook, true, error))
+							newFlags |= DebugLoggingModes::eDebugLoggingModeSSL;
 					}
 
 					if (hookUI)
 					{
-						newFlags |= DebugLoggingModes::eDebugLoggingModeUI;
-						dorito.Patches.EnableHook(dorito.Modules.Game.UILogHook, true);
+						if (dorito.Patches.TryEnableHook(dorito.Modules.Game.UILogHook, true, error))
+							newFlags |= DebugLoggingModes::eDebugLoggingModeUI;
 					}
 
 					if (hookGame1)
 					{
-						newFlags |= DebugLoggingModes::eDebugLoggingModeGame1;
-						dorito.Patches.EnableHook(dorito.Modules.Game.Game1LogHook, true);
+						if (dorito.Patches.TryEnableHook(dorito.Modules.Game.Game1LogHook, true, error))
+							newFlags |= DebugLoggingModes::eDebugLoggingModeGame1;
 					}
 
 					if (hookGame2)
 					{
-						newFlags |= DebugLoggingModes::eDebugLoggingModeGame2;
-						dorito.Patches.EnablePatchSet(dorito.Modules.Game.Game2LogHook, true);
+						if (dorito.Patches.TryEnablePatchSet(dorito.Modules.Game.Game2LogHook, true, error))
+							newFlags |= DebugLoggingModes::eDebugLoggingModeGame2;
 					}
 				}
 			}
@@ -182,7 +186,23 @@ namespace
 		{
 			ss << std::endl << "Usage: Game.DebugMode <network | ssl | ui | game1 | game2 | all | off>";
 		}
+		if (!error.empty())
+			ss << std::endl << "Failed to change the log hooks: " << error;
 		returnInfo = ss.str();
+		return error.empty();
+	}
+
+	bool VariableGameLogNameUpdate(const std::vector<std::string>& Arguments, std::string& returnInfo)
+	{
+		auto& dorito = ElDorito::Instance();
+		dorito.Logger.SetLogFile(dorito.Modules.Game.VarLogName->ValueString);
+		return true;
+	}
+
+	bool VariableGameLogLevelUpdate(const std::vector<std::string>& Arguments, std::string& returnInfo)
+	{
+		auto& dorito = ElDorito::Instance();
+		dorito.Logger.SetMinSeverity(static_cast<LogSeverity>(dorito.Modules.Game.VarLogLevel->ValueInt));
 		return true;
 	}
 
@@ -193,7 +213,8 @@ namespace
 		std::stringstream ss;
 		if (Arguments.size() != 3)
 		{
-			ss << "Usage: Game.LogFilter <include/exclude> <add/remove> <string>" << std::endl << std::endl;
+			ss << "Usage: Game.LogFilter <include/exclude> <add/remove> <string>" << std::endl;
+			ss << "Filters can also be written as module:<name>, severity:<debug/info/warning/error/fatal>, or use * and ? wildcards" << std::endl << std::endl;
 		}
 		else
 		{
@@ -217,6 +238,8 @@ namespace
 				vect->push_back(str);
 				ss << "Added \"" << str << "\" to " << (exclude ? "exclude" : "include") << " filters list" << std::endl << std::endl;
 			}
+
+			ElDorito::Instance().Logger.SetFilters(gameModule.FiltersInclude, gameModule.FiltersExclude);
 		}
 
 		ss << "Include filters (message must contain these strings):";
@@ -283,6 +306,7 @@ namespace
 
 	bool CommandGameExit(const std::vector<std::string>& Arguments, std::string& returnInfo)
 	{
+		ElDorito::Instance().Shutdown();
 		std::exit(0);
 		return true;
 	}
@@ -298,7 +322,7 @@ namespace
 			ss << "Usage: Game.ForceLoad <mapname> [gametype] [maptype]" << std::endl;
 			ss << "Available maps:";
 
-			for (auto map : gameModule.MapList)
+			for (auto map : gameModule.Maps.GetMapNames())
 				ss << std::endl << "\t" << map;
 
 			ss << std::endl << std::endl << "Valid gametypes:";
@@ -315,13 +339,14 @@ namespace
 		Blam::GameType gameType = Blam::GameType::None;
 		Blam::GameMode gameMode = Blam::GameMode::Multiplayer;
 
-		if (std::find(gameModule.MapList.begin(), gameModule.MapList.end(), mapName) == gameModule.MapList.end())
+		MapCatalog::MapInfo map;
+		if (!gameModule.Maps.FindMap(mapName, map))
 		{
 			returnInfo = "Unable to find map " + mapName;
 			return false;
 		}
 
-		mapName = "maps\\" + mapName;
+		mapName = "maps\\" + map.Name;
 
 		if (Arguments.size() >= 2)
 		{
@@ -435,54 +460,56 @@ namespace
 		return size;
 	}
 
-	bool LoadMapVariant(std::ifstream& file, uint8_t* out)
+	// Reads a BLF file and checks that it's valid and has a chunk with the given tag in it.
+	// The game's parsers expect a fixed-size buffer, so the data gets padded out to that size and the chunk has to fit inside it.
+	bool ReadBlfFile(std::ifstream& file, uint32_t tag, size_t bufferSize, std::vector<uint8_t>& out, std::string& error)
 	{
-		// TODO: Would it be better to figure out how to use the game's file
-		// functions here?
+		const size_t MaxBlfSize = 0x100000;
+		auto fileSize = GetFileSize(file);
+		if (fileSize > MaxBlfSize)
+		{
+			error = "File is too big";
+			return false;
+		}
 
-		// Verify file size
-		const auto MapVariantBlfSize = 0xE1F0;
-		if (GetFileSize(file) < MapVariantBlfSize)
+		std::vector<uint8_t> data(fileSize);
+		file.read(reinterpret_cast<char*>(data.data()), fileSize);
+		if (file.gcount() != static_cast<std::streamsize>(fileSize))
+		{
+			error = "Failed to read the file";
 			return false;
+		}
+
+		auto result = Blam::Blf::ReadIntoBuffer(data.data(), data.size(), tag, bufferSize, out);
+		if (result != Blam::Blf::Error::None)
+		{
+			error = Blam::Blf::GetErrorString(result);
+			return false;
+		}
+		return true;
+	}
+
+	bool LoadMapVariant(std::ifstream& file, uint8_t* out, std::string& error)
+	{
+		// TODO: Would it be better to figure out how to use the game's file
+		// functions here?
 
 		// Load it into a buffer and have the game parse it
-		uint8_t* blfData = (uint8_t*)malloc(MapVariantBlfSize);
-		file.read(reinterpret_cast<char*>(blfData), MapVariantBlfSize);
+		std::vector<uint8_t> blfData;
+		if (!ReadBlfFile(file, Blam::Blf::MapVariantTag, Blam::Blf::MapVariantBufferSize, blfData, error))
+			return false;
 
 		typedef bool(__thiscall *ParseMapVariantBlfPtr)(void* blf, uint8_t* outVariant, bool* result);
 		auto ParseMapVariant = reinterpret_cast<ParseMapVariantBlfPtr>(0x573250);
-
-		bool retVal = ParseMapVariant(blfData, out, nullptr);
-		free(blfData);
-
-		return retVal;
+		return ParseMapVariant(blfData.data(), out, nullptr);
 	}
 
 	int GetMapId(const std::string& mapName)
 	{
-		// Open the .map file
-		auto mapPath = "maps/" + mapName + ".map";
-		std::ifstream mapFile(mapPath, std::ios::binary);
-		if (!mapFile.is_open())
-			return -1;
-
-		// Verify file size
-		const auto MapHeaderSize = 0x3390;
-		if (GetFileSize(mapFile) < MapHeaderSize)
+		MapCatalog::MapInfo map;
+		if (!ElDorito::Instance().Modules.Game.Maps.FindMap(mapName, map))
 			return -1;
-
-		// Verify file header
-		const int32_t FileHeaderMagic = 'head';
-		int32_t actualMagic = 0;
-		mapFile.read(reinterpret_cast<char*>(&actualMagic), sizeof(actualMagic));
-		if (actualMagic != FileHeaderMagic)
-			return -1;
-
-		// Read map ID
-		int32_t mapId = 0;
-		mapFile.seekg(0x2DEC);
-		mapFile.read(reinterpret_cast<char*>(&mapId), sizeof(mapId));
-		return mapId;
+		return map.MapId;
 	}
 
 	bool LoadDefaultMapVariant(const std::string& mapName, uint8_t* out)
@@ -567,14 +594,19 @@ namespace
 		uint8_t* variantData = (uint8_t*)malloc(UnkVariantBlfSize);
 
 		// If the name is the name of a valid map variant, load it
-		auto variantFileName = "mods/maps/" + mapName + "/sandbox.map";
-		std::ifstream mapVariant(variantFileName, std::ios::binary);
+		MapCatalog::VariantInfo variant;
+		std::ifstream mapVariant;
+		if (ElDorito::Instance().Modules.Game.Maps.FindMapVariant(mapName, variant))
+			mapVariant.open(variant.Path, std::ios::binary);
 		if (mapVariant.is_open())
 		{
-			returnInfo = "Loading map variant " + variantFileName + "...";
-			if (!LoadMapVariant(mapVariant, variantData))
+			returnInfo = "Loading map variant " + variant.Path + "...";
+			std::string error;
+			if (!LoadMapVariant(mapVariant, variantData, error))
 			{
 				returnInfo += "\nInvalid map variant file!";
+				if (!error.empty())
+					returnInfo += " (" + error + ")";
 				free(variantData);
 				return false;
 			}
@@ -605,20 +637,16 @@ namespace
 		return true;
 	}
 
-	bool LoadGameVariant(std::ifstream& file, uint8_t* out)
+	bool LoadGameVariant(std::ifstream& file, uint8_t* out, std::string& error)
 	{
-		// Verify file size
-		const auto GameVariantBlfSize = 0x3BC;
-		if (GetFileSize(file) < GameVariantBlfSize)
-			return false;
-
 		// Load it into a buffer and have the game parse it
-		uint8_t blfData[GameVariantBlfSize];
-		file.read(reinterpret_cast<char*>(blfData), GameVariantBlfSize);
+		std::vector<uint8_t> blfData;
+		if (!ReadBlfFile(file, Blam::Blf::GameVariantTag, Blam::Blf::GameVariantBufferSize, blfData, error))
+			return false;
 
 		typedef bool(__thiscall *ParseGameVariantBlfPtr)(void* blf, uint8_t* outVariant, bool* result);
 		auto ParseGameVariant = reinterpret_cast<ParseGameVariantBlfPtr>(0x573150);
-		return ParseGameVariant(blfData, out, nullptr);
+		return ParseGameVariant(blfData.data(), out, nullptr);
 	}
 
 	template<class T>
@@ -707,23 +735,20 @@ namespace
 		auto name = Arguments[0];
 		uint8_t variantData[0x264];
 
-		// Check if this is a custom gametype by searching for a file
-		// corresponding to each supported game mode
+		// Check if this is a custom gametype
+		MapCatalog::VariantInfo variant;
 		std::ifstream gameVariant;
-		std::string variantFileName;
-		for (auto i = 1; i < Blam::GameType::GameTypeCount; i++)
-		{
-			variantFileName = "mods/variants/" + name + "/variant." + Blam::GameTypeNames[i];
-			gameVariant.open(variantFileName, std::ios::binary);
-			if (gameVariant.is_open())
-				break;
-		}
+		if (ElDorito::Instance().Modules.Game.Maps.FindGameVariant(name, variant))
+			gameVariant.open(variant.Path, std::ios::binary);
 		if (gameVariant.is_open())
 		{
-			returnInfo = "Loading game variant " + variantFileName + "...";
-			if (!LoadGameVariant(gameVariant, variantData))
+			returnInfo = "Loading game variant " + variant.Path + "...";
+			std::string error;
+			if (!LoadGameVariant(gameVariant, variantData, error))
 			{
 				returnInfo += "\nInvalid game variant file!";
+				if (!error.empty())
+					returnInfo += " (" + error + ")";
 				return false;
 			}
 		}
@@ -848,11 +873,28 @@ namespace
 		CommandGameSettingsMenu({ result }, std::string());
 	}
 
+	void CompleteMapNames(std::vector<std::string>& values)
+	{
+		values = ElDorito::Instance().Modules.Game.Maps.GetMapNames();
+	}
+
+	void CompleteMapAndVariantNames(std::vector<std::string>& values)
+	{
+		auto& maps = ElDorito::Instance().Modules.Game.Maps;
+		values = maps.GetMapNames();
+		auto variants = maps.GetMapVariantNames();
+		values.insert(values.end(), variants.begin(), variants.end());
+	}
+
+	void CompleteGameVariantNames(std::vector<std::string>& values)
+	{
+		values = ElDorito::Instance().Modules.Game.Maps.GetGameVariantNames();
+	}
 }
 
 namespace Modules
 {
-	ModuleGame::ModuleGame() : ModuleBase("Game")
+	ModuleGame::ModuleGame() : ModuleBase("Game"), Maps(MapsEnvironment)
 	{
 		AddCommand("SettingsMenu", "settings", "Opens the ElDewrito settings menu", eCommandFlagsNone, CommandGameSettingsMenu, { "menuName(string) The menu to open, can be blank" });
 
@@ -865,12 +907,15 @@ namespace Modules
 		AddCommand("Exit", "exit", "Ends the game process", eCommandFlagsNone, CommandGameExit);
 
 		AddCommand("ForceLoad", "forceload", "Forces a map to load", eCommandFlagsNone, CommandGameForceLoad, { "mapname(string) The name of the map to load", "gametype(int) The gametype to load", "gamemode(int) The type of gamemode to play", });
+		ElDorito::Instance().Commands.SetValueCompletion("Game.ForceLoad", CompleteMapNames);
 
 		AddCommand("ShowUI", "show_ui", "Attempts to force a UI widget to open", eCommandFlagsNone, CommandGameShowUI, { "dialogID(int) The dialog ID to open", "arg1(int) Unknown argument", "flags(int) Unknown argument", "parentdialogID(int) The ID of the parent dialog" });
 
 		AddCommand("Map", "map", "Loads a map or map variant", eCommandFlagsNone, CommandGameLoadMap, { "name(string) The internal name of the map or Forge map to load" });
+		ElDorito::Instance().Commands.SetValueCompletion("Game.Map", CompleteMapAndVariantNames);
 
 		AddCommand("GameType", "gametype", "Loads a gametype", eCommandFlagsNone, CommandGameType, { "name(string) The internal name of the built-in gametype or custom gametype to load" });
+		ElDorito::Instance().Commands.SetValueCompletion("Game.GameType", CompleteGameVariantNames);
 
 		AddCommand("Start", "start", "Starts or restarts the game", eCommandFlagsNone, CommandGameStart);
 
@@ -884,7 +929,13 @@ namespace Modules
 		VarSkipLauncher->ValueIntMin = 0;
 		VarSkipLauncher->ValueIntMax = 0;
 
-		VarLogName = AddVariableString("LogName", "debug_logname", "Filename to store debug log messages", eCommandFlagsArchived, "dorito.log");
+		VarLogName = AddVariableString("LogName", "debug_logname", "Filename to store debug log messages", eCommandFlagsArchived, "dorito.log", VariableGameLogNameUpdate);
+
+		VarLogLevel = AddVariableInt("LogLevel", "debug_loglevel", "Minimum severity of messages to store in the log file (0 = debug, 1 = info, 2 = warning, 3 = error, 4 = fatal)", eCommandFlagsArchived, 0, VariableGameLogLevelUpdate);
+		VarLogLevel->ValueIntMin = 0;
+		VarLogLevel->ValueIntMax = 4;
+
+		FiltersExclude.push_back("module:game_tick"); // matches the filter DebugLog starts with
 
 		NetworkLogHook = patches->AddHook("NetworkLog", 0xD858D0, networkLogHook, HookType::Jmp);
 		SSLLogHook = patches->AddHook("SSLLog", 0xE7FE10, sslLogHook, HookType::Jmp);
@@ -895,21 +946,5 @@ namespace Modules
 			Hook("DebugLogIntHook", 0x618A10, debuglog_int, HookType::Jmp),
 			Hook("DebugLogStringHook", 0x618A30, debuglog_string, HookType::Jmp)
 		});
-
-		//populate map list on load
-		WIN32_FIND_DATAA Finder;
-		HANDLE hFind = FindFirstFileA((std::tr2::sys::current_path<std::tr2::sys::path>().string() + "\\maps\\*.map").c_str(), &Finder);
-		if (hFind != INVALID_HANDLE_VALUE)
-		{
-			do
-			{
-				if (!(Finder.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY))
-				{
-					std::string MapName(Finder.cFileName);
-					//remove extension
-					MapList.push_back(MapName.substr(0, MapName.find_last_of('.')));
-				}
-			} while (FindNextFileA(hFind, &Finder) != 0);
-		}
 	}
 }
@@ -1,5 +1,6 @@
 #pragma once
 #include <ElDorito/ModuleBase.hpp>
+#include "../MapCatalog.hpp"
 
 enum DebugLoggingModes
 {
@@ -18,6 +19,7 @@ namespace Modules
 		Command* VarLanguageID;
 		Command* VarSkipLauncher;
 		Command* VarLogName;
+		Command* VarLogLevel;
 
 		Hook* NetworkLogHook;
 		Hook* SSLLogHook;
@@ -26,7 +28,8 @@ namespace Modules
 		PatchSet* Game2LogHook;
 
 		int DebugFlags;
-		std::vector<std::string> MapList;
+		WinMapCatalogEnvironment MapsEnvironment; // has to be before Maps
+		MapCatalog Maps;
 		std::vector<std::string> FiltersExclude;
 		std::vector<std::string> FiltersInclude;
 
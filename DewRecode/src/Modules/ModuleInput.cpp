@@ -125,30 +125,27 @@ namespace
 			auto keyTicks = dorito.Modules.InputPatches.GetKeyTicks(keyCode, Blam::InputType::Special);
 			dorito.Modules.InputPatches.Swallow(keyCode);
 
-			auto command = binding->command;
-			auto isHold = command.at(0) == '+';
-			if (isHold)
-				command = command.substr(1);
+			auto compiled = dorito.Commands.GetCompiledBinding(i);
+			auto isHold = compiled->IsHold;
 
 			// We're only interested in the key if it was just pressed or if
 			// this is a hold binding and it was just released
 			if (keyTicks > 1 || (keyTicks == 0 && !(isHold && binding->active)))
 				continue;
 
+			std::string result;
 			if (isHold)
 			{
-				// The command is a hold binding - append an argument depending
-				// on whether it was pressed or released
-				if (keyTicks == 1)
-					command += " 1";
-				else if (keyTicks == 0)
-					command += " 0";
-
+				// The command is a hold binding - run it with the argument for
+				// whether it was pressed or released (compiled with the binding)
 				binding->active = (keyTicks > 0);
+				result = dorito.Commands.ExecuteHold(*compiled, binding->active, true);
 			}
-			
-			// Execute the command and print its result
-			dorito.Modules.Console.PrintToConsole(dorito.Commands.Execute(command, true));
+			else
+				result = dorito.Commands.Execute(*compiled, true);
+
+			// Print the result of the command
+			dorito.Modules.Console.PrintToConsole(result);
 		}
 	}
 }
@@ -174,6 +171,7 @@ namespace Modules
 		});
 
 		AddCommand("Bind", "bind", "Binds a command to a key", eCommandFlagsNone, CommandBind, { "key", "[+]command", "arguments" });
+		ElDorito::Instance().Commands.SetValueCompletion("Input.Bind", Commands::CompleteKeyNames);
 		AddCommand("UIButtonPress", "ui_btn_press", "Emulates a gamepad button press on UI menus", eCommandFlagsNone, CommandUIButtonPress, { "btnCode The code of the button to press" });
 		engine->OnEvent("Core", "Input.KeyboardUpdate", KeyboardUpdated);
 	}
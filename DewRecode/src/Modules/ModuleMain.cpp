@@ -17,13 +17,7 @@ namespace
 			if (!cmd)
 			{
 				// try searching for it as a module
-				bool isModule = false;
-				for (auto it = commands.List.begin(); it < commands.List.end(); it++)
-					if (!it->ModuleName.empty() && !_stricmp(it->ModuleName.c_str(), cmdName.c_str()))
-					{
-						isModule = true;
-						break;
-					}
+				bool isModule = commands.FindModule(cmdName) != nullptr;
 
 				if (isModule)
 					returnInfo = commands.GenerateHelpText(cmdName);
@@ -39,6 +33,19 @@ namespace
 		return true;
 	}
 
+	void CompleteHelpTopics(std::vector<std::string>& values)
+	{
+		for (auto& cmd : ElDorito::Instance().Commands.List)
+		{
+			if (cmd.Flags & eCommandFlagsHidden || cmd.Flags & eCommandFlagsInternal)
+				continue;
+
+			values.push_back(cmd.Name);
+			if (!cmd.ModuleName.empty())
+				values.push_back(cmd.ModuleName);
+		}
+	}
+
 	bool CommandExecute(const std::vector<std::string>& Arguments, std::string& returnInfo)
 	{
 		if (Arguments.size() <= 0)
@@ -86,6 +93,7 @@ namespace Modules
 	ModuleMain::ModuleMain() : ModuleBase("")
 	{
 		AddCommand("Help", "help", "Displays this help text", eCommandFlagsNone, CommandHelp);
+		ElDorito::Instance().Commands.SetValueCompletion("Help", CompleteHelpTopics);
 		AddCommand("Execute", "exec", "Executes a list of commands", eCommandFlagsNone, CommandExecute, { "filename(string) The list of commands to execute" });
 		AddCommand("WriteConfig", "config_write", "Writes the ElDewrito config file", eCommandFlagsNone, CommandWriteConfig, { "filename(string) Optional, the filename to write the config to" });
 	}
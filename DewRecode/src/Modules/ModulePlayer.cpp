@@ -26,7 +26,7 @@ namespace
 		std::wstring nameStr = dorito.Utils.WidenString(name);
 		wcscpy_s(dorito.Modules.Player.UserName, 16, nameStr.c_str());
 		std::string actualName = dorito.Utils.ThinString(dorito.Modules.Player.UserName);
-		dorito.Engine.Event("Core", "Player.ChangeName", dorito.Modules.Player.VarPlayerName);
+		dorito.Engine.Event(dorito.Engine.CoreEvents.PlayerChangeName, dorito.Modules.Player.VarPlayerName);
 
 		return true;
 	}
@@ -46,6 +46,34 @@ namespace
 		returnInfo = "Player UID: 0x" + uidStr;
 		return true;
 	}
+
+	bool CommandPlayerGenerateKeyPool(const std::vector<std::string>& Arguments, std::string& returnInfo)
+	{
+		auto& keys = ElDorito::Instance().Modules.PlayerUidPatches.Keys;
+		auto poolSize = keys.GetPoolSize();
+		if (Arguments.size() <= 0)
+		{
+			returnInfo = "The key pool has " + std::to_string(poolSize) + " keys in it";
+			return true;
+		}
+
+		int count = atoi(Arguments[0].c_str());
+		if (count <= 0)
+		{
+			returnInfo = "Invalid key count.";
+			return false;
+		}
+
+		if ((size_t)count <= poolSize)
+		{
+			returnInfo = "The key pool already has " + std::to_string(poolSize) + " keys in it";
+			return true;
+		}
+
+		keys.FillPool(count);
+		returnInfo = "Generating " + std::to_string(count - poolSize) + " keys for the pool in the background...";
+		return true;
+	}
 }
 
 namespace Modules
@@ -74,6 +102,7 @@ namespace Modules
 		memset(this->UserName, 0, sizeof(wchar_t)* 17);
 
 		AddCommand("PrintUID", "uid", "Prints the players UID", eCommandFlagsNone, CommandPlayerPrintUID);
+		AddCommand("GenerateKeyPool", "generate_key_pool", "Generates keypairs ahead of time into dewrito_keys.dat, players/servers that need a new key take one from there instead of waiting for it to generate", eCommandFlagsNone, CommandPlayerGenerateKeyPool, { "count(int) How many keys the pool should hold, leave out to print how many it has" });
 
 		// patch Game_GetPlayerName to get the name from our field
 		Pointer(0x442AA1).Write<uint32_t>((uint32_t)&this->UserName);
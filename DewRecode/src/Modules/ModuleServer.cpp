@@ -6,7 +6,12 @@
 #include <sstream>
 #include <iostream>
 #include <fstream>
+#include <map>
+#include <mutex>
+#include <atomic>
+#include <memory>
 #include "../ElDorito.hpp"
+#include "../ServerConnect.hpp"
 
 #include <rapidjson/document.h>
 #include <rapidjson/writer.h>
@@ -48,100 +53,28 @@ namespace
 	// retrieves master server endpoints from dewrito.json
 	void GetEndpoints(std::vector<std::string>& destVect, const std::string& endpointType)
 	{
-		std::ifstream in("dewrito.json", std::ios::in | std::ios::binary);
-		if (in && in.is_open())
-		{
-			std::string contents;
-			in.seekg(0, std::ios::end);
-			contents.resize((unsigned int)in.tellg());
-			in.seekg(0, std::ios::beg);
-			in.read(&contents[0], contents.size());
-			in.close();
-
-			rapidjson::Document json;
-			if (!json.Parse<0>(contents.c_str()).HasParseError() && json.IsObject())
-			{
-				if (json.HasMember("masterServers"))
-				{
-					auto& mastersArray = json["masterServers"];
-					for (auto it = mastersArray.Begin(); it != mastersArray.End(); it++)
-					{
-						destVect.push_back((*it)[endpointType.c_str()].GetString());
-					}
-				}
-			}
-		}
+		auto config = ElDorito::Instance().Engine.GetDewritoConfig();
+		auto it = config->MasterEndpoints.find(endpointType);
+		if (it != config->MasterEndpoints.end())
+			destVect.insert(destVect.end(), it->second.begin(), it->second.end());
 	}
 
+	// a stats announcement on its way to the masters, stats are collected on the game thread, signed on the signing thread
+	// and then sent from a thread of its own
+	struct StatsAnnouncement
+	{
+		std::vector<std::string> Endpoints;
+		std::string Stats;
+		std::string PublicKey;
+		std::string Signature;
+	};
+
 	DWORD WINAPI CommandServerAnnounceStats_Thread(LPVOID lpParam)
 	{
+		std::unique_ptr<StatsAnnouncement> announcement(reinterpret_cast<StatsAnnouncement*>(lpParam));
 		std::stringstream ss;
-		std::vector<std::string> statsEndpoints;
 		auto& dorito = ElDorito::Instance();
-
-		GetEndpoints(statsEndpoints, "stats");
-
-		//typedef int(__cdecl *Game_GetLocalPlayerDatumIdxPtr)(int localPlayerIdx);
-		//auto Game_GetLocalPlayerDatumIdx = reinterpret_cast<Game_GetLocalPlayerDatumIdxPtr>(0x589C30);
-		//uint16_t playerIdx = (uint16_t)(Game_GetLocalPlayerDatumIdx(0) & 0xFFFF);
-		// above wont work since we're on a different thread without the proper TLS data :(
-
-		auto& localPlayers = dorito.Engine.GetMainTls(GameGlobals::LocalPlayers::TLSOffset)[0];
-		uint16_t playerIdx = (uint16_t)(localPlayers(GameGlobals::LocalPlayers::Player0DatumIdx).Read<uint32_t>() & 0xFFFF);
-
-		auto* playersGlobal = dorito.Engine.GetArrayGlobal(GameGlobals::Players::TLSOffset);
-		auto playerPtr = playersGlobal->GetEntry(playerIdx);
-		int32_t team = playerPtr(GameGlobals::Players::TeamOffset).Read<int32_t>();
-
-		auto& playersGlobal2 = dorito.Engine.GetMainTls(GameGlobals::Players::TLSOffset)[0];
-
-		// TODO: find how this fits into the players global
-		int16_t score = playersGlobal2(0x54 + GameGlobals::Players::ScoreBase + (playerIdx * GameGlobals::Players::ScoresEntryLength)).Read<int16_t>();
-		int16_t kills = playersGlobal2(0x54 + GameGlobals::Players::KillsBase + (playerIdx * GameGlobals::Players::ScoresEntryLength)).Read<int16_t>();
-		int16_t deaths = playersGlobal2(0x54 + GameGlobals::Players::DeathsBase + (playerIdx * GameGlobals::Players::ScoresEntryLength)).Read<int16_t>();
-		// unsure about assists
-		int16_t assists = playersGlobal2(0x54 + GameGlobals::Players::AssistsBase + (playerIdx * GameGlobals::Players::ScoresEntryLength)).Read<int16_t>();
-
-		// TODO: get an ID for this match
-		int32_t gameId = 0x1337BEEF;
-		
-		// build our stats announcement
-		rapidjson::StringBuffer statsBuff;
-		rapidjson::Writer<rapidjson::StringBuffer> statsWriter(statsBuff);
-		statsWriter.StartObject();
-		statsWriter.Key("gameId");
-		statsWriter.Int(gameId);
-		statsWriter.Key("score");
-		statsWriter.Int(score);
-		statsWriter.Key("kills");
-		statsWriter.Int(kills);
-		statsWriter.Key("assists");
-		statsWriter.Int(assists);
-		statsWriter.Key("deaths");
-		statsWriter.Int(deaths);
-		statsWriter.Key("team");
-		statsWriter.Int(team);
-		statsWriter.Key("medals");
-		statsWriter.StartArray();
-
-		// TODO: log each medal earned during the game and output them here
-		/*statsWriter.String("doublekill");
-		statsWriter.String("triplekill");
-		statsWriter.String("overkill");
-		statsWriter.String("unfreakingbelieveable");*/
-
-		statsWriter.EndArray();
-		statsWriter.EndObject();
-
-		std::string statsObject = statsBuff.GetString();
-		// todo: look into using JSON Web Tokens (JWT) that use JSON Web Signature (JWS), instead of using our own signature stuff
-		std::string statsSignature;
-		if (!dorito.Utils.RSACreateSignature(dorito.Modules.PlayerUidPatches.GetFormattedPrivKey(), (void*)statsObject.c_str(), statsObject.length(), statsSignature))
-		{
-			ss << "Failed to create stats RSA signature!";
-			dorito.Logger.Log(LogSeverity::Error, "AnnounceStats", ss.str());
-			return 0;
-		}
+		auto& statsEndpoints = announcement->Endpoints;
 
 		rapidjson::StringBuffer s;
 		rapidjson::Writer<rapidjson::StringBuffer> writer(s);
@@ -149,30 +82,41 @@ namespace
 		writer.Key("statsVersion");
 		writer.Int(1);
 		writer.Key("stats");
-		writer.String(statsObject.c_str()); // write stats object as a string instead of object so that the string matches up exactly with what we signed (also because there's no easy way to append a writer..)
+		writer.String(announcement->Stats.c_str()); // write stats object as a string instead of object so that the string matches up exactly with what we signed (also because there's no easy way to append a writer..)
 		writer.Key("publicKey");
-		writer.String(ElDorito::Instance().Modules.Player.VarPlayerPubKey->ValueString.c_str());
+		writer.String(announcement->PublicKey.c_str());
 		writer.Key("signature");
-		writer.String(statsSignature.c_str());
+		writer.String(announcement->Signature.c_str());
 		writer.EndObject();
 
 		std::string sendObject = s.GetString();
 
-		for (auto server : statsEndpoints)
+		std::vector<std::wstring> uris;
+		for (auto& server : statsEndpoints)
+			uris.push_back(dorito.Utils.WidenString(server));
+
+		// send to every master at once, so one that isn't responding doesn't hold up the rest
+		std::vector<HttpRequest> responses;
+		try
 		{
-			HttpRequest req;
-			try
-			{
-				req = ElDorito::Instance().Utils.HttpSendRequest(dorito.Utils.WidenString(server), L"POST", L"ElDewrito/" + dorito.Utils.WidenString(Utils::Version::GetVersionString()), L"", L"", L"Content-Type: application/json\r\n", (void*)sendObject.c_str(), sendObject.length());
-				if (req.Error != HttpRequestError::None)
-				{
-					ss << "Unable to connect to master server " << server << " (error: " << (int)req.Error << "/" << req.LastError << "/" << std::to_string(GetLastError()) << ")" << std::endl << std::endl;
-					continue;
-				}
-			}
-			catch (...)
+			responses = dorito.Utils.HttpSendPooledRequests(uris, L"POST", L"ElDewrito/" + dorito.Utils.WidenString(Utils::Version::GetVersionString()), L"Content-Type: application/json\r\n", (void*)sendObject.c_str(), sendObject.length());
+		}
+		catch (...)
+		{
+			dorito.Logger.Log(LogSeverity::Error, "AnnounceStats", "Exception during master server stats announce requests");
+			return 0;
+		}
+
+		for (size_t i = 0; i < responses.size(); i++)
+		{
+			auto& server = statsEndpoints[i];
+			auto& req = responses[i];
+			if (req.Error == HttpRequestError::HostBackedOff)
+				continue; // this master has been failing, it'll be tried again once its backoff is over
+
+			if (req.Error != HttpRequestError::None)
 			{
-				ss << "Exception during master server stats announce request to " << server << std::endl << std::endl;
+				ss << "Unable to connect to master server " << server << " (error: " << (int)req.Error << "/" << req.LastError << ")" << std::endl << std::endl;
 				continue;
 			}
 
@@ -218,182 +162,221 @@ namespace
 		if (!errors.empty())
 			dorito.Logger.Log(LogSeverity::Error, "AnnounceStats", ss.str());
 
-		return true;
+		return 0;
 	}
 
-	bool CommandServerAnnounceStats(const std::vector<std::string>& Arguments, std::string& returnInfo)
+	void StatsSignedCallback(bool succeeded, const std::string& signature, void* param)
 	{
-		//if (!IsEndGame())
-		//	return false;
+		auto announcement = reinterpret_cast<StatsAnnouncement*>(param);
+		if (!succeeded)
+		{
+			ElDorito::Instance().Logger.Log(LogSeverity::Error, "AnnounceStats", "Failed to create stats RSA signature!");
+			delete announcement;
+			return;
+		}
 
-		auto thread = CreateThread(NULL, 0, CommandServerAnnounceStats_Thread, (LPVOID)&Arguments, 0, NULL);
-		returnInfo = "Announcing stats to master servers...";
-		return true;
+		// sending can take a while if a master isn't responding, so don't hold up the signing thread with it
+		announcement->Signature = signature;
+		auto thread = CreateThread(NULL, 0, CommandServerAnnounceStats_Thread, announcement, 0, NULL);
+		if (!thread)
+		{
+			ElDorito::Instance().Logger.Log(LogSeverity::Error, "AnnounceStats", "Failed to start stats announce thread");
+			delete announcement;
+			return;
+		}
+		CloseHandle(thread);
 	}
 
-	bool CommandServerConnect(const std::vector<std::string>& Arguments, std::string& returnInfo)
+	bool CommandServerAnnounceStats(const std::vector<std::string>& Arguments, std::string& returnInfo)
 	{
-		// TODO: move this into a thread so that non-responding hosts don't lag the game
-		if (Arguments.size() <= 0)
-		{
-			returnInfo = "Invalid arguments.";
-			return false;
-		}
+		//if (!IsEndGame())
+		//	return false;
+
 		auto& dorito = ElDorito::Instance();
+		auto announcement = new StatsAnnouncement();
+		GetEndpoints(announcement->Endpoints, "stats");
 
-		std::string address = Arguments[0];
-		std::string password = "";
-		if (Arguments.size() > 1)
-			password = Arguments[1];
+		// collect the stats here on the game thread, where the game's TLS data is
+		auto& localPlayers = dorito.Engine.GetMainTls(GameGlobals::LocalPlayers::TLSOffset)[0];
+		uint16_t playerIdx = (uint16_t)(localPlayers(GameGlobals::LocalPlayers::Player0DatumIdx).Read<uint32_t>() & 0xFFFF);
 
-		uint32_t rawIpaddr = 0;
-		int httpPort = 11784;
+		auto* playersGlobal = dorito.Engine.GetArrayGlobal(GameGlobals::Players::TLSOffset);
+		auto playerPtr = playersGlobal->GetEntry(playerIdx);
+		int32_t team = playerPtr(GameGlobals::Players::TeamOffset).Read<int32_t>();
 
-		size_t portOffset = address.find(':');
-		auto host = address;
-		if (portOffset != std::string::npos && portOffset + 1 < address.size())
-		{
-			auto port = address.substr(portOffset + 1);
-			httpPort = (uint16_t)std::stoi(port);
-			host = address.substr(0, portOffset);
-		}
+		auto& playersGlobal2 = dorito.Engine.GetMainTls(GameGlobals::Players::TLSOffset)[0];
 
-		struct addrinfo* info = NULL;
-		INT retval = getaddrinfo(host.c_str(), NULL, NULL, &info);
-		if (retval != 0)
-		{
-			int error = WSAGetLastError();
-			std::string ret = "Unable to lookup " + address + " (" + std::to_string(retval) + "): ";
-			if (error != 0)
-			{
-				if (error == WSAHOST_NOT_FOUND)
-					ret += "Host not found.";
-				else if (error == WSANO_DATA)
-					ret += "No data record found.";
-				else
-					ret += "Function failed with error " + std::to_string(error) + ".";
-			}
-			else
-				ret += "Unknown error.";
-			returnInfo = ret;
-			return false;
-		}
+		// TODO: find how this fits into the players global
+		int16_t score = playersGlobal2(0x54 + GameGlobals::Players::ScoreBase + (playerIdx * GameGlobals::Players::ScoresEntryLength)).Read<int16_t>();
+		int16_t kills = playersGlobal2(0x54 + GameGlobals::Players::KillsBase + (playerIdx * GameGlobals::Players::ScoresEntryLength)).Read<int16_t>();
+		int16_t deaths = playersGlobal2(0x54 + GameGlobals::Players::DeathsBase + (playerIdx * GameGlobals::Players::ScoresEntryLength)).Read<int16_t>();
+		// unsure about assists
+		int16_t assists = playersGlobal2(0x54 + GameGlobals::Players::AssistsBase + (playerIdx * GameGlobals::Players::ScoresEntryLength)).Read<int16_t>();
 
-		struct addrinfo* ptr = NULL;
-		for (ptr = info; ptr != NULL; ptr = ptr->ai_next)
-		{
-			if (ptr->ai_family != AF_INET)
-				continue; // not ipv4
+		// TODO: get an ID for this match
+		int32_t gameId = 0x1337BEEF;
+		
+		// build our stats announcement
+		rapidjson::StringBuffer statsBuff;
+		rapidjson::Writer<rapidjson::StringBuffer> statsWriter(statsBuff);
+		statsWriter.StartObject();
+		statsWriter.Key("gameId");
+		statsWriter.Int(gameId);
+		statsWriter.Key("score");
+		statsWriter.Int(score);
+		statsWriter.Key("kills");
+		statsWriter.Int(kills);
+		statsWriter.Key("assists");
+		statsWriter.Int(assists);
+		statsWriter.Key("deaths");
+		statsWriter.Int(deaths);
+		statsWriter.Key("team");
+		statsWriter.Int(team);
+		statsWriter.Key("medals");
+		statsWriter.StartArray();
 
-			rawIpaddr = ntohl(((sockaddr_in*)ptr->ai_addr)->sin_addr.S_un.S_addr);
-			break;
-		}
+		// TODO: log each medal earned during the game and output them here
+		/*statsWriter.String("doublekill");
+		statsWriter.String("triplekill");
+		statsWriter.String("overkill");
+		statsWriter.String("unfreakingbelieveable");*/
 
-		freeaddrinfo(info);
+		statsWriter.EndArray();
+		statsWriter.EndObject();
 
-		if (!rawIpaddr)
+		announcement->Stats = statsBuff.GetString();
+		auto privKey = dorito.Modules.PlayerUidPatches.GetFormattedPrivKey(); // makes sure the keypair is set up, so get it before the public key
+		announcement->PublicKey = dorito.Modules.Player.VarPlayerPubKey->ValueString;
+
+		// todo: look into using JSON Web Tokens (JWT) that use JSON Web Signature (JWS), instead of using our own signature stuff
+		if (!dorito.Utils.RSAQueueSignature(privKey, announcement->Stats, StatsSignedCallback, announcement))
 		{
-			returnInfo = "Unable to lookup " + address + ": No records found.";;
+			delete announcement;
+			returnInfo = "Too many stats announcements are already waiting to be signed.";
 			return false;
 		}
-		
-		// query the server
-		std::wstring usernameStr = L"";
-		std::wstring passwordStr = L"";
-		if (!password.empty())
-		{
-			usernameStr = L"dorito";
-			passwordStr = dorito.Utils.WidenString(password);
-		}
 
-		HttpRequest req = ElDorito::Instance().Utils.HttpSendRequest(dorito.Utils.WidenString("http://" + host + ":" + std::to_string(httpPort) + "/"), L"GET", L"ElDewrito/" + dorito.Utils.WidenString(Utils::Version::GetVersionString()), usernameStr, passwordStr, L"", NULL, 0);
+		returnInfo = "Announcing stats to master servers...";
+		return true;
+	}
 
-		if (req.Error != HttpRequestError::None)
+	// getaddrinfo and WinHttp for ServerConnector
+	class WinConnectEnvironment : public ConnectEnvironment
+	{
+	public:
+		uint32_t GetTime()
 		{
-			returnInfo = "Unable to connect to server. (error: " + std::to_string((int)req.Error) + "/" + std::to_string(req.LastError) + "/" + std::to_string(GetLastError()) + ")";
-			return false;
+			return GetTickCount();
 		}
 
-		// make sure the server replied with 200 OK
-		std::wstring expected = L"HTTP/1.1 200 OK";
-		if (req.ResponseHeader.length() < expected.length())
+		bool ResolveHost(const std::string& host, uint32_t& address, std::string& error)
 		{
-			returnInfo = "Invalid server query response.";
-			return false;
-		}
+			struct addrinfo* info = NULL;
+			INT retval = getaddrinfo(host.c_str(), NULL, NULL, &info);
+			if (retval != 0)
+			{
+				int lastError = WSAGetLastError();
+				error = "Unable to lookup " + host + " (" + std::to_string(retval) + "): ";
+				if (lastError != 0)
+				{
+					if (lastError == WSAHOST_NOT_FOUND)
+						error += "Host not found.";
+					else if (lastError == WSANO_DATA)
+						error += "No data record found.";
+					else
+						error += "Function failed with error " + std::to_string(lastError) + ".";
+				}
+				else
+					error += "Unknown error.";
+				return false;
+			}
 
-		auto respHdr = req.ResponseHeader.substr(0, expected.length());
-		if (respHdr.compare(expected))
-		{
-			returnInfo = "Invalid server query header response.";
-			return false;
-		}
+			address = 0;
+			for (auto ptr = info; ptr != NULL; ptr = ptr->ai_next)
+			{
+				if (ptr->ai_family != AF_INET)
+					continue; // not ipv4
 
-		// parse the json response
-		std::string resp = std::string(req.ResponseBody.begin(), req.ResponseBody.end());
+				address = ntohl(((sockaddr_in*)ptr->ai_addr)->sin_addr.S_un.S_addr);
+				break;
+			}
 
-		rapidjson::Document json;
-		if (json.Parse<0>(resp.c_str()).HasParseError() || !json.IsObject())
-		{
-			returnInfo = "Invalid server query JSON response.";
-			return false;
-		}
+			freeaddrinfo(info);
 
-		// make sure the json has all the members we need
-		if (!json.HasMember("gameVersion") || !json["gameVersion"].IsString() ||
-			!json.HasMember("eldewritoVersion") || !json["eldewritoVersion"].IsString() ||
-			!json.HasMember("port") || !json["port"].IsNumber())
-		{
-			returnInfo = "Server query JSON response is missing data.";
-			return false;
+			if (!address)
+			{
+				error = "Unable to lookup " + host + ": No records found.";
+				return false;
+			}
+			return true;
 		}
 
-		if (!json.HasMember("xnkid") || !json["xnkid"].IsString() ||
-			!json.HasMember("xnaddr") || !json["xnaddr"].IsString())
+		bool QueryInfo(const std::string& host, int port, const std::string& password, std::string& responseHeader, std::string& body, std::string& error)
 		{
-			returnInfo = "Incorrect password specified.";
-			return false;
-		}
+			auto& dorito = ElDorito::Instance();
 
-		std::string gameVer = json["gameVersion"].GetString();
-		std::string edVer = json["eldewritoVersion"].GetString();
+			std::wstring usernameStr = L"";
+			std::wstring passwordStr = L"";
+			if (!password.empty())
+			{
+				usernameStr = L"dorito";
+				passwordStr = dorito.Utils.WidenString(password);
+			}
 
-		std::string ourGameVer((char*)Pointer(0x199C0F0));
-		std::string ourEdVer = Utils::Version::GetVersionString();
-		if (ourGameVer.compare(gameVer))
-		{
-			returnInfo = "Server is running a different game version.";
-			return false;
+			HttpRequest req = dorito.Utils.HttpSendRequest(dorito.Utils.WidenString("http://" + host + ":" + std::to_string(port) + "/"), L"GET", L"ElDewrito/" + dorito.Utils.WidenString(Utils::Version::GetVersionString()), usernameStr, passwordStr, L"", NULL, 0);
+			if (req.Error != HttpRequestError::None)
+			{
+				error = "Unable to connect to server. (error: " + std::to_string((int)req.Error) + "/" + std::to_string(req.LastError) + ")";
+				return false;
+			}
+
+			responseHeader = std::string(req.ResponseHeader.begin(), req.ResponseHeader.end()); // only the ascii status line matters
+			body = std::string(req.ResponseBody.begin(), req.ResponseBody.end());
+			return true;
 		}
+	};
+
+	WinConnectEnvironment connectEnvironment;
+	ServerConnector connector(connectEnvironment); // Server.Connect does the lookup and server query on a worker thread so a slow/dead server can't freeze the game
+
+	DWORD WINAPI ConnectAttempt_Thread(LPVOID lpParam)
+	{
+		std::unique_ptr<std::shared_ptr<ConnectAttempt>> attempt(reinterpret_cast<std::shared_ptr<ConnectAttempt>*>(lpParam));
+		connector.Run(*attempt);
+		return 0;
+	}
 
-		if (ourEdVer.compare(edVer))
+	void ConnectTickCallback(const std::chrono::duration<double>& deltaTime)
+	{
+		auto attempt = connector.Poll();
+		if (!attempt)
+			return;
+
+		auto& dorito = ElDorito::Instance();
+		if (!attempt->Succeeded)
 		{
-			returnInfo = "Server is running a different ElDewrito version.";
-			return false;
+			dorito.Modules.Console.PrintToConsole(attempt->Error);
+			return;
 		}
 
-		std::string xnkid = json["xnkid"].GetString();
-		std::string xnaddr = json["xnaddr"].GetString();
-		if (xnkid.length() != (0x10 * 2) || xnaddr.length() != (0x10 * 2))
+		std::string ourGameVer((char*)Pointer(0x199C0F0));
+		std::string error;
+		if (!CheckServerVersion(attempt->Info, ourGameVer, Utils::Version::GetVersionString(), error))
 		{
-			returnInfo = "Server query XNet info is invalid.";
-			return false;
+			dorito.Modules.Console.PrintToConsole(error);
+			return;
 		}
-		uint16_t gamePort = (uint16_t)json["port"].GetInt();
-
-		BYTE xnetInfo[0x20];
-		dorito.Utils.HexStringToBytes(xnkid, xnetInfo, 0x10);
-		dorito.Utils.HexStringToBytes(xnaddr, xnetInfo + 0x10, 0x10);
 
 		// set up our syslink data struct
-		auto& server = ElDorito::Instance().Modules.Server;
+		auto& server = dorito.Modules.Server;
+		auto xnetInfo = attempt->Info.XnetInfo;
 		memset(server.SyslinkData, 0, 0x176);
 		*(uint32_t*)server.SyslinkData = 1;
 
 		memcpy(server.SyslinkData + 0x9E, xnetInfo, 0x20);
 
-		*(uint32_t*)(server.SyslinkData + 0x170) = rawIpaddr;
-		*(uint16_t*)(server.SyslinkData + 0x174) = gamePort;
+		*(uint32_t*)(server.SyslinkData + 0x170) = attempt->IpAddress;
+		*(uint16_t*)(server.SyslinkData + 0x174) = attempt->Info.GamePort;
 
 		// set syslink stuff to point at our syslink data
 		Pointer(0x228E6D8).Write<uint32_t>(1);
@@ -407,9 +390,45 @@ namespace
 		Pointer(0x2240BE4).Write<uint32_t>(1);
 
 		// send an event
-		dorito.Engine.Event("Core", "Game.Joining");
+		dorito.Engine.Event(dorito.Engine.CoreEvents.GameJoining);
 
-		returnInfo = "Attempting connection to " + address + "...";
+		dorito.Modules.Console.PrintToConsole("Attempting connection to " + attempt->Address + "...");
+	}
+
+	bool CommandServerConnect(const std::vector<std::string>& Arguments, std::string& returnInfo)
+	{
+		if (Arguments.size() <= 0)
+		{
+			returnInfo = "Invalid arguments.";
+			return false;
+		}
+
+		// starting a new attempt cancels any that are still running
+		auto attempt = connector.Start(Arguments[0], Arguments.size() > 1 ? Arguments[1] : "", returnInfo);
+		if (!attempt)
+			return false;
+
+		auto threadAttempt = new std::shared_ptr<ConnectAttempt>(attempt);
+		auto thread = CreateThread(NULL, 0, ConnectAttempt_Thread, threadAttempt, 0, NULL);
+		if (!thread)
+		{
+			connector.Cancel();
+			delete threadAttempt;
+			returnInfo = "Failed to start connection thread.";
+			return false;
+		}
+		CloseHandle(thread);
+
+		returnInfo = "Querying " + attempt->Address + "...";
+		return true;
+	}
+
+	bool CommandServerCancelConnect(const std::vector<std::string>& Arguments, std::string& returnInfo)
+	{
+		// getaddrinfo and the blocking WinHttp request can't be interrupted, so this only stops the attempt from joining
+		// a lookup/query that's already running carries on in the background until it finishes or times out, then gets thrown away
+		connector.Cancel();
+		returnInfo = "Cancelled connection attempt.";
 		return true;
 	}
 
@@ -429,6 +448,7 @@ namespace Modules
 	ModuleServer::ModuleServer() : ModuleBase("Server")
 	{
 		engine->OnEvent("Core", "Game.End", CallbackEndGame);
+		engine->OnTick(ConnectTickCallback);
 		// TODO: move [Port, Announce, Unannounce] to ServerPlugin once HttpRequest is exposed via interface
 
 		VarServerCountdown = AddVariableInt("Countdown", "countdown", "The number of seconds to wait at the start of the game", eCommandFlagsArchived, 5, VariableServerCountdownUpdate);
@@ -444,6 +464,7 @@ namespace Modules
 		VarServerCheats->ValueIntMax = 1;
 
 		AddCommand("Connect", "connect", "Begins establishing a connection to a server", eCommandFlagsRunOnMainMenu, CommandServerConnect, { "host:port The server info to connect to", "password(string) The password for the server" });
+		AddCommand("CancelConnect", "cancelconnect", "Cancels a connection attempt that's still querying the server, the query itself runs until it times out but its result is ignored", eCommandFlagsNone, CommandServerCancelConnect);
 
 		AddCommand("AnnounceStats", "announcestats", "Announces the players stats to the masters at the end of the game", eCommandFlagsNone, CommandServerAnnounceStats);
 	}
@@ -90,6 +90,18 @@ namespace
 
 	class ArmorExtension : public Modules::Patches::PlayerPropertiesExtension<CustomizationData>
 	{
+	public:
+		ArmorExtension() : PlayerPropertiesExtension("Armor")
+		{
+			// Colors
+			for (int i = 0; i < ColorIndexes::Count; i++)
+				Schema.Unsigned<uint32_t>(offsetof(CustomizationData, colors) + i * sizeof(uint32_t), 24);
+
+			// Armor
+			for (int i = 0; i < ArmorIndexes::Count; i++)
+				Schema.Range<uint8_t>(offsetof(CustomizationData, armor) + i, 0, MaxArmorIndexes[i]);
+		}
+
 	protected:
 		void BuildData(int playerIndex, CustomizationData* out)
 		{
@@ -110,30 +122,6 @@ namespace
 			CustomizationData* armorSessionData = reinterpret_cast<CustomizationData*>(reinterpret_cast<uint8_t*>(session)+0x6E8);
 			*armorSessionData = data;
 		}
-
-		void Serialize(Blam::BitStream* stream, const CustomizationData& data)
-		{
-			// Colors
-			for (int i = 0; i < ColorIndexes::Count; i++)
-				stream->WriteUnsigned<uint32_t>(data.colors[i], 24);
-
-			// Armor
-			for (int i = 0; i < ArmorIndexes::Count; i++)
-				stream->WriteUnsigned<uint8_t>(data.armor[i], 0, MaxArmorIndexes[i]);
-		}
-
-		void Deserialize(Blam::BitStream* stream, CustomizationData* out)
-		{
-			memset(out, 0, sizeof(CustomizationData));
-
-			// Colors
-			for (int i = 0; i < ColorIndexes::Count; i++)
-				out->colors[i] = stream->ReadUnsigned<uint32_t>(24);
-
-			// Armor
-			for (int i = 0; i < ArmorIndexes::Count; i++)
-				out->armor[i] = stream->ReadUnsigned<uint8_t>(0, MaxArmorIndexes[i]);
-		}
 	};
 
 	bool updateUiPlayerArmor = false; // Set to true to update the Spartan on the main menu
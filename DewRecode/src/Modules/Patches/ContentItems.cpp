@@ -1,44 +1,18 @@
 #include "ContentItems.hpp"
-#include <filesystem>
 #include <ShlObj.h>
 #include "../../ElDorito.hpp"
+#include "../../ContentIndexer.hpp"
 
 namespace
 {
 	Blam::ArrayGlobal* contentItemsGlobal = 0;
 	bool enumerated = false;
 
-	bool AddContentItem(wchar_t* itemPath)
-	{
-		uint8_t fileData[0xF0];
-
-		FILE* file;
-		if (_wfopen_s(&file, itemPath, L"rb") != 0 || !file)
-			return false;
-
-		fseek(file, 0, SEEK_END);
-		long fileSize = ftell(file);
-		fseek(file, 0, SEEK_SET);
-		if (fileSize < 0x40)
-		{
-			// too small to be a BLF
-			fclose(file);
-			return false;
-		}
-
-		uint32_t magic;
-		fread(&magic, 4, 1, file);
-		if (magic != 0x5F626C66 && magic != 0x666C625F)
-		{
-			// not a BLF
-			fclose(file);
-			return false;
-		}
-
-		fseek(file, 0x40, SEEK_SET);
-		fread(fileData, 1, 0xF0, file);
-		fclose(file);
+	// the path is stored in the unused XCONTENT_DATA space at the end of the entry
+	const size_t MaxContentItemPath = 0xA0;
 
+	bool AddContentItem(const ContentIndexer::Item& item)
+	{
 		auto dataPtr = contentItemsGlobal->AddEntry();
 		if (dataPtr == nullptr)
 			return false;
@@ -47,19 +21,12 @@ namespace
 		dataPtr(0x8).Write<uint32_t>(4); // this is a blf/variant/content item type field, but setting it to 4 (slayer) works for everything
 		dataPtr(0xC).Write<char*>((char*)dataPtr);
 
-		memcpy((char*)dataPtr + 0x10, fileData, 0xF0);
-		wcscpy_s((wchar_t*)((char*)dataPtr + 0x100), 0xA0, itemPath);
+		memcpy((char*)dataPtr + 0x10, item.Header, ContentIndexer::HeaderSize);
+		wcscpy_s((wchar_t*)((char*)dataPtr + 0x100), MaxContentItemPath, item.Path.c_str());
 
 		return true;
 	}
 
-	bool AddContentItem(const std::string& itemPath)
-	{
-		// need to convert path from ASCII to unicode now
-		std::wstring unicode = ElDorito::Instance().Utils.WidenString(itemPath);
-		return AddContentItem((wchar_t*)unicode.c_str());
-	}
-
 	void GetFilePathForItem(wchar_t* dest, size_t MaxCount, wchar_t* variantName, int variantType)
 	{
 		wchar_t currentDir[256];
@@ -85,17 +52,46 @@ namespace
 		}
 	}
 
-	void AddAllBLFContentItems(const std::string& path)
+	void AddAllBLFContentItems()
 	{
-		ElDorito::Instance().Logger.Log(LogSeverity::Debug, "ContentItems", "Loading BLF files (dir: %s)", path.c_str());
+		wchar_t currentDir[256];
+		memset(currentDir, 0, 256 * sizeof(wchar_t));
+		GetCurrentDirectoryW(256, currentDir);
+
+		std::wstring modsPath(currentDir);
+		modsPath += L"\\mods";
+
+		std::vector<std::wstring> roots;
+		roots.push_back(modsPath + L"\\variants");
+		roots.push_back(modsPath + L"\\maps");
 
-		for (std::tr2::sys::directory_iterator itr(path); itr != std::tr2::sys::directory_iterator(); ++itr)
+		WinContentEnvironment environment;
+		ContentIndexer indexer(modsPath + L"\\content.cache", environment);
+		std::vector<ContentIndexer::Item> items;
+		ContentIndexer::Stats stats;
+		indexer.Scan(roots, items, &stats);
+
+		auto& logger = ElDorito::Instance().Logger;
+		logger.Log(LogSeverity::Debug, "ContentItems", "Indexed %u files in %ums, %u content items (%u files unchanged)", (unsigned int)stats.Files, stats.Milliseconds, (unsigned int)stats.Items, (unsigned int)stats.CacheHits);
+
+		// everything's been read already, so all that's left is filling in the entries
+		int added = 0;
+		int space = contentItemsGlobal->GetMaxEntries() - contentItemsGlobal->GetCount();
+		for (auto& item : items)
 		{
-			if (std::tr2::sys::is_directory(itr->status()))
-				AddAllBLFContentItems(itr->path());
-			else
-				AddContentItem(itr->path());
+			if (added >= space)
+				break;
+			if (item.Path.length() >= MaxContentItemPath)
+			{
+				logger.Log(LogSeverity::Warning, "ContentItems", "Path too long, skipping %s", ElDorito::Instance().Utils.ThinString(item.Path).c_str());
+				continue;
+			}
+			if (AddContentItem(item))
+				added++;
 		}
+
+		if (added < (int)items.size())
+			logger.Log(LogSeverity::Warning, "ContentItems", "Only %d of %u content items were loaded", added, (unsigned int)items.size());
 	}
 
 	char CallsXEnumerateHook()
@@ -105,17 +101,7 @@ namespace
 		if (enumerated)
 			return 1;
 
-		// TODO: change this to use unicode instead of ASCII
-
-		auto variantPath = std::tr2::sys::current_path<std::tr2::sys::path>();
-		variantPath /= "mods";
-
-		auto mapsPath = variantPath;
-		variantPath /= "variants";
-		mapsPath /= "maps";
-
-		AddAllBLFContentItems(variantPath);
-		AddAllBLFContentItems(mapsPath);
+		AddAllBLFContentItems();
 
 		enumerated = true;
 		return 1;
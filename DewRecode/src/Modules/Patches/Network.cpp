@@ -150,7 +150,8 @@ namespace
 		// Copy the player properties to a new array and add the extension data
 		size_t packetSize = GetPlayerPropertiesPacketSize();
 		size_t extendedSize = packetSize - PlayerPropertiesPacketHeaderSize - PlayerPropertiesPacketFooterSize;
-		auto extendedProperties = std::make_unique<uint8_t[]>(extendedSize);
+		static std::vector<uint8_t> extendedProperties; // reused for every update, assign only reallocates if the packet has grown
+		extendedProperties.assign(extendedSize, 0);
 		memcpy(&extendedProperties[0], properties, PlayerPropertiesSize);
 		ElDorito::Instance().Modules.NetworkPatches.PlayerPropertiesExtender.BuildData(playerIndex, &extendedProperties[PlayerPropertiesSize]);
 
@@ -167,9 +168,9 @@ namespace
 			if (unk6 == -1)
 				return true;
 
-			// Allocate the packet
-			auto packet = std::make_unique<uint8_t[]>(packetSize);
-			memset(&packet[0], 0, packetSize);
+			// Set up the packet
+			static std::vector<uint8_t> packet;
+			packet.assign(packetSize, 0);
 
 			// Initialize it
 			int id = *reinterpret_cast<int*>(thisPtr + 0x25BBF0);
@@ -218,7 +219,7 @@ namespace
 
 		// Deserialize extended data
 		if (succeeded)
-			ElDorito::Instance().Modules.NetworkPatches.PlayerPropertiesExtender.DeserializeData(stream, buffer + PlayerPropertiesSize);
+			succeeded = ElDorito::Instance().Modules.NetworkPatches.PlayerPropertiesExtender.DeserializeData(stream, buffer + PlayerPropertiesSize);
 		return succeeded;
 	}
 }
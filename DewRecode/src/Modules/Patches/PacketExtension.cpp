@@ -0,0 +1,229 @@
+#include "PacketExtension.hpp"
+
+#include <cstring>
+
+namespace
+{
+	uint32_t HashName(const std::string& name)
+	{
+		// FNV-1a
+		uint32_t hash = 2166136261;
+		for (auto c : name)
+		{
+			hash ^= static_cast<uint8_t>(c);
+			hash *= 16777619;
+		}
+		return hash;
+	}
+
+	// Extension data structs are packed one after another, so fields aren't necessarily aligned
+	uint64_t ReadField(const uint8_t* data, size_t size, bool isSigned)
+	{
+		uint64_t val = 0;
+		memcpy(&val, data, size); // little-endian
+		if (isSigned && size < sizeof(val) && (val >> (size * 8 - 1)) & 1)
+			val |= 0xFFFFFFFFFFFFFFFF << (size * 8);
+		return val;
+	}
+
+	bool FieldLess(uint64_t lhs, uint64_t rhs, bool isSigned)
+	{
+		return isSigned ? static_cast<int64_t>(lhs) < static_cast<int64_t>(rhs) : lhs < rhs;
+	}
+
+	void WriteField(uint8_t* data, size_t size, uint64_t val)
+	{
+		memcpy(data, &val, size);
+	}
+}
+
+namespace Modules
+{
+	namespace Patches
+	{
+		PacketSchema::PacketSchema(const std::string& name, size_t dataSize)
+			: name(name), id(HashName(name)), dataSize(dataSize)
+		{
+		}
+
+		PacketSchema& PacketSchema::Unsigned(size_t offset, size_t size, int bits, int version)
+		{
+			auto maxValue = (bits >= 64) ? 0xFFFFFFFFFFFFFFFF : ((1ULL << bits) - 1);
+			return addField(offset, size, bits, 0, maxValue, false, version);
+		}
+
+		PacketSchema& PacketSchema::Bool(size_t offset, int version)
+		{
+			return addField(offset, sizeof(bool), 1, 0, 1, false, version);
+		}
+
+		PacketSchema& PacketSchema::addField(size_t offset, size_t size, int bits, uint64_t minValue, uint64_t maxValue, bool isSigned, int version)
+		{
+			// Fields have to be in version order, otherwise older peers would read the wrong bits
+			if (version < this->version)
+				version = this->version;
+			if (size > sizeof(uint64_t))
+				size = sizeof(uint64_t);
+
+			PacketField field;
+			field.Offset = offset;
+			field.Size = size;
+			field.Bits = bits;
+			field.MinValue = minValue;
+			field.MaxValue = maxValue;
+			field.Signed = isSigned;
+			field.Version = version;
+			fields.push_back(field);
+
+			this->version = version;
+			this->bits += bits;
+			return *this;
+		}
+
+		void PacketSchema::Serialize(Blam::BitWriter* stream, const void* data) const
+		{
+			auto bytes = static_cast<const uint8_t*>(data);
+			for (auto& field : fields)
+			{
+				auto val = ReadField(bytes + field.Offset, field.Size, field.Signed);
+				if (FieldLess(val, field.MinValue, field.Signed))
+					val = field.MinValue;
+				else if (FieldLess(field.MaxValue, val, field.Signed))
+					val = field.MaxValue;
+				stream->WriteBits(val - field.MinValue, field.Bits);
+			}
+		}
+
+		void PacketSchema::Deserialize(Blam::BitReader* stream, int senderVersion, void* out) const
+		{
+			auto bytes = static_cast<uint8_t*>(out);
+			for (auto& field : fields)
+			{
+				auto val = field.MinValue;
+				if (field.Version <= senderVersion)
+				{
+					val += stream->ReadBits(field.Bits);
+					if (FieldLess(field.MaxValue, val, field.Signed))
+						val = field.MaxValue;
+				}
+				WriteField(bytes + field.Offset, field.Size, val);
+			}
+		}
+
+		PacketExtensionCodec::PacketExtensionCodec()
+		{
+			// big enough for the largest block a peer can send
+			readArena.resize((MaxBits + 7) / 8 + 8);
+			bits = CountBits;
+		}
+
+		bool PacketExtensionCodec::Add(const PacketSchema* schema)
+		{
+			// Peers reject anything bigger than MaxBits, so we can't send more than that either
+			auto newBits = bits + BlockHeaderBits + schema->GetBits();
+			if (newBits > MaxBits || schemas.size() >= (1U << CountBits) - 1)
+				return false;
+			for (auto existing : schemas)
+			{
+				if (existing->GetId() == schema->GetId())
+					return false;
+			}
+
+			schemas.push_back(schema);
+			offsets.push_back(dataSize);
+			dataSize += schema->GetDataSize();
+
+			// Work out the exact size up front so the write arena never has to grow
+			bits = newBits;
+			writeArena.resize((bits + 7) / 8 + 8);
+			return true;
+		}
+
+		void PacketExtensionCodec::Serialize(Blam::BitStream* stream, const void* data)
+		{
+			// Serialize into the arena and then hand the whole thing to the game in one go
+			Blam::BitWriter writer(writeArena.data(), writeArena.size());
+			Serialize(&writer, data);
+			writer.Finish();
+			stream->WriteBlock(writeArena.data(), writer.GetPosition());
+		}
+
+		void PacketExtensionCodec::Serialize(Blam::BitWriter* stream, const void* data) const
+		{
+			auto bytes = static_cast<const uint8_t*>(data);
+			stream->WriteUnsigned<size_t>(schemas.size(), CountBits);
+			for (size_t i = 0; i < schemas.size(); i++)
+			{
+				auto schema = schemas[i];
+				stream->WriteUnsigned<uint32_t>(schema->GetId(), IdBits);
+				stream->WriteUnsigned<int>(schema->GetVersion(), VersionBits);
+				stream->WriteUnsigned<size_t>(schema->GetBits(), LengthBits);
+				schema->Serialize(stream, bytes + offsets[i]);
+			}
+		}
+
+		bool PacketExtensionCodec::Deserialize(Blam::BitStream* stream, void* out)
+		{
+			// The game's bitstream doesn't tell us how much is left, so the reads are only bounded by MaxBits
+			return deserialize(stream, static_cast<size_t>(-1), out);
+		}
+
+		bool PacketExtensionCodec::Deserialize(Blam::BitReader* stream, void* out)
+		{
+			return deserialize(stream, stream->GetRemaining(), out) && !stream->HasOverflowed();
+		}
+
+		template<class TStream>
+		bool PacketExtensionCodec::deserialize(TStream* stream, size_t available, void* out)
+		{
+			auto bytes = static_cast<uint8_t*>(out);
+			memset(bytes, 0, dataSize);
+
+			// Everything the peer claims to have sent has to fit in both MaxBits and what's left in the stream, check each size
+			// before reading what it covers
+			auto budget = available;
+			if (budget > MaxBits)
+				budget = MaxBits;
+			if (budget < CountBits)
+				return false;
+			budget -= CountBits;
+
+			auto count = stream->template ReadUnsigned<size_t>(CountBits);
+			if (count * BlockHeaderBits > budget)
+				return false;
+
+			for (size_t i = 0; i < count; i++)
+			{
+				if (budget < BlockHeaderBits)
+					return false;
+				budget -= BlockHeaderBits;
+
+				auto id = stream->template ReadUnsigned<uint32_t>(IdBits);
+				auto version = stream->template ReadUnsigned<int>(VersionBits);
+				auto length = stream->template ReadUnsigned<size_t>(LengthBits);
+				if (length > budget)
+					return false;
+				budget -= length;
+
+				// Pull the whole block out first, so that whatever we don't understand in it gets skipped
+				stream->ReadBlock(readArena.data(), length);
+
+				for (size_t j = 0; j < schemas.size(); j++)
+				{
+					if (schemas[j]->GetId() != id)
+						continue;
+
+					Blam::BitReader reader(readArena.data(), length);
+					schemas[j]->Deserialize(&reader, version, bytes + offsets[j]);
+					if (reader.HasOverflowed())
+					{
+						memset(bytes + offsets[j], 0, schemas[j]->GetDataSize());
+						return false; // the block was shorter than the fields it claims to have
+					}
+					break;
+				}
+			}
+			return true;
+		}
+	}
+}
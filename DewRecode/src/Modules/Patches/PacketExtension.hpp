@@ -0,0 +1,130 @@
+#pragma once
+
+#include <ElDorito/Blam/BitStream.hpp>
+#include <ElDorito/Blam/BitBuffer.hpp>
+
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <vector>
+
+namespace Modules
+{
+	namespace Patches
+	{
+		// Describes how one field of an extension's data struct gets sent.
+		struct PacketField
+		{
+			size_t Offset;     // Offset of the field in the data struct
+			size_t Size;       // Size of the field in bytes (up to 8)
+			int Bits;          // Number of bits that get sent
+			uint64_t MinValue; // The value gets sent as (value - MinValue)
+			uint64_t MaxValue; // Values above this are clamped
+			bool Signed;       // MinValue/MaxValue and the value itself are two's complement, and the value gets sign-extended from Size bytes
+			int Version;       // The extension version the field was added in
+		};
+
+		// Declares the data an extension adds to a packet.
+		// Fields are sent in the order they're added. New fields have to be added to the end with a higher version than the existing ones,
+		// that way a peer with an older version of the extension can still read the fields it knows about and skip the rest.
+		class PacketSchema
+		{
+		public:
+			PacketSchema(const std::string& name, size_t dataSize);
+
+			// Adds an unsigned integer field.
+			PacketSchema& Unsigned(size_t offset, size_t size, int bits, int version = 1);
+
+			// Adds an unsigned integer field.
+			template<class T>
+			PacketSchema& Unsigned(size_t offset, int bits, int version = 1)
+			{
+				return Unsigned(offset, sizeof(T), bits, version);
+			}
+
+			// Adds an integer field which only holds values in [minValue, maxValue], it only takes as many bits as the range needs.
+			// T can be signed, the value is sent as its distance from minValue so it never needs a sign bit.
+			template<class T>
+			PacketSchema& Range(size_t offset, T minValue, T maxValue, int version = 1)
+			{
+				return addField(offset, sizeof(T), Utils::Bits::CountBits(static_cast<uint64_t>(maxValue) - static_cast<uint64_t>(minValue)), static_cast<uint64_t>(minValue), static_cast<uint64_t>(maxValue), std::numeric_limits<T>::is_signed, version);
+			}
+
+			// Adds a bool field.
+			PacketSchema& Bool(size_t offset, int version = 1);
+
+			const std::string& GetName() const { return name; }
+			uint32_t GetId() const { return id; }
+			int GetVersion() const { return version; }
+			size_t GetDataSize() const { return dataSize; }
+			size_t GetBits() const { return bits; }
+
+			// Writes the fields in a data struct.
+			void Serialize(Blam::BitWriter* stream, const void* data) const;
+
+			// Reads the fields written by a peer with the given version of the schema, fields the peer doesn't know about are set to their minimum.
+			void Deserialize(Blam::BitReader* stream, int senderVersion, void* out) const;
+
+		private:
+			std::string name;
+			uint32_t id;
+			size_t dataSize;
+			int version = 0;
+			size_t bits = 0;
+			std::vector<PacketField> fields;
+
+			PacketSchema& addField(size_t offset, size_t size, int bits, uint64_t minValue, uint64_t maxValue, bool isSigned, int version);
+		};
+
+		// Sends data for a set of packet extensions.
+		// Each extension's data is sent as a block with its ID, version and size in front of it, so peers with a different version of an
+		// extension can read the fields they have in common, and peers that don't have an extension at all can skip over it.
+		// All of the buffers are allocated when extensions are added, serializing doesn't allocate anything.
+		class PacketExtensionCodec
+		{
+		public:
+			static const int IdBits = 32;
+			static const int VersionBits = 8;
+			static const int LengthBits = 16;
+			static const int CountBits = 8;
+			static const int BlockHeaderBits = IdBits + VersionBits + LengthBits;
+
+			// The most bits a peer can send for every extension put together (including the count and block headers), anything
+			// claiming to be bigger is rejected before it's read. Keeps a bad count/length from reading far past the end of the packet.
+			static const size_t MaxBits = 4096;
+
+			PacketExtensionCodec();
+
+			// Adds a schema, the schema has to stay alive as long as the codec does.
+			// Returns false if the schema would make the data bigger than MaxBits or an extension with the same ID was already added.
+			bool Add(const PacketSchema* schema);
+
+			// Gets the total size of the data structs of every extension.
+			size_t GetDataSize() const { return dataSize; }
+
+			// Gets the number of bits the extension data takes up on the wire.
+			size_t GetBits() const { return bits; }
+
+			// Serializes the data for every extension. data holds each extension's data struct, one after another.
+			void Serialize(Blam::BitStream* stream, const void* data);
+			void Serialize(Blam::BitWriter* stream, const void* data) const;
+
+			// Deserializes extension data, extensions which weren't sent have their data zeroed.
+			// Returns false if the data was malformed (a block was shorter than its fields, or the sizes add up to more than MaxBits
+			// or more than the stream has left).
+			bool Deserialize(Blam::BitStream* stream, void* out);
+			bool Deserialize(Blam::BitReader* stream, void* out);
+
+		private:
+			std::vector<const PacketSchema*> schemas;
+			std::vector<size_t> offsets; // offset of each schema's data struct
+			size_t dataSize = 0;
+			size_t bits = 0;
+			std::vector<uint8_t> writeArena;
+			std::vector<uint8_t> readArena;
+
+			template<class TStream>
+			bool deserialize(TStream* stream, size_t available, void* out);
+		};
+	}
+}
@@ -4,6 +4,13 @@ namespace Modules
 {
 	namespace Patches
 	{
+		void PlayerPropertiesExtender::Add(std::shared_ptr<PlayerPropertiesExtensionBase> extension)
+		{
+			if (!codec.Add(&extension->GetSchema()))
+				return; // codec rejected the schema (duplicate name or too big), the extension would never be sent
+			extensions.push_back(extension);
+		}
+
 		size_t PlayerPropertiesExtender::GetTotalSize()
 		{
 			size_t result = 0;
@@ -36,24 +43,12 @@ namespace Modules
 
 		void PlayerPropertiesExtender::SerializeData(Blam::BitStream* stream, const void* data)
 		{
-			// Serialize all of the structures in order
-			const uint8_t* ptr = static_cast<const uint8_t*>(data);
-			for (auto it = extensions.begin(); it != extensions.end(); ++it)
-			{
-				(*it)->Serialize(stream, ptr);
-				ptr += (*it)->GetDataSize();
-			}
+			codec.Serialize(stream, data);
 		}
 
-		void PlayerPropertiesExtender::DeserializeData(Blam::BitStream* stream, void* out)
+		bool PlayerPropertiesExtender::DeserializeData(Blam::BitStream* stream, void* out)
 		{
-			// Deserialize all of the structures in order
-			uint8_t* ptr = static_cast<uint8_t*>(out);
-			for (auto it = extensions.begin(); it != extensions.end(); ++it)
-			{
-				(*it)->Deserialize(stream, ptr);
-				ptr += (*it)->GetDataSize();
-			}
+			return codec.Deserialize(stream, out);
 		}
 	}
 }
\ No newline at end of file
@@ -1,16 +1,18 @@
 #pragma once
 
 
-#include <ElDorito/Blam/BitStream.hpp>
+#include "PacketExtension.hpp"
 
 #include <vector>
 #include <memory>
+#include <string>
 
 namespace Modules
 {
 	namespace Patches
 	{
 		// Base class for a class which adds data to player properties.
+		// Extensions don't serialize their data themselves, they declare the fields in it with a PacketSchema instead.
 		class PlayerPropertiesExtensionBase
 		{
 		public:
@@ -23,11 +25,8 @@ namespace Modules
 			// Applies extension data to a player.
 			virtual void ApplyData(int playerIndex, void* session, const void* data) = 0;
 
-			// Serializes the extension data to be sent across the network.
-			virtual void Serialize(Blam::BitStream* stream, const void* data) = 0;
-
-			// Deserializes extension data that was received from the network.
-			virtual void Deserialize(Blam::BitStream* stream, void* out) = 0;
+			// Gets the schema describing how the extension data is sent across the network.
+			virtual const PacketSchema& GetSchema() const = 0;
 		};
 
 		// Helper class which adds type safety to PlayerPropertiesExtensionBase.
@@ -35,18 +34,21 @@ namespace Modules
 		class PlayerPropertiesExtension : public PlayerPropertiesExtensionBase
 		{
 		protected:
+			// The fields to send, derived classes fill this in from their constructor.
+			PacketSchema Schema;
+
+			// Creates an extension. The name identifies the extension's data on the wire, so it shouldn't be changed once it's been released.
+			explicit PlayerPropertiesExtension(const std::string& name)
+				: Schema(name, sizeof(TData))
+			{
+			}
+
 			// Builds extension data for a player.
 			virtual void BuildData(int playerIndex, TData* out) = 0;
 
 			// Applies extension data to a player.
 			virtual void ApplyData(int playerIndex, void* session, const TData& data) = 0;
 
-			// Serializes the extension data to be sent across the network.
-			virtual void Serialize(Blam::BitStream* stream, const TData& data) = 0;
-
-			// Deserializes extension data that was received from the network.
-			virtual void Deserialize(Blam::BitStream* stream, TData* out) = 0;
-
 		public:
 			void BuildData(int playerIndex, void* out)
 			{
@@ -63,27 +65,18 @@ namespace Modules
 				ApplyData(playerIndex, session, *static_cast<const TData*>(data));
 			}
 
-			void Serialize(Blam::BitStream* stream, const void* data)
-			{
-				Serialize(stream, *static_cast<const TData*>(data));
-			}
-
-			void Deserialize(Blam::BitStream* stream, void* out)
+			const PacketSchema& GetSchema() const
 			{
-				Deserialize(stream, static_cast<TData*>(out));
+				return Schema;
 			}
 		};
 
 		// Singleton object which lets the player-properties packet be extended with custom data
-		// TODO: Make this more generic and not so specific to player-properties
 		class PlayerPropertiesExtender
 		{
 		public:
 			// Adds an extension to the player-properties packet.
-			void Add(std::shared_ptr<PlayerPropertiesExtensionBase> extension)
-			{
-				extensions.push_back(extension);
-			}
+			void Add(std::shared_ptr<PlayerPropertiesExtensionBase> extension);
 
 			// Gets the total size of the player-properties extension data.
 			size_t GetTotalSize();
@@ -97,11 +90,12 @@ namespace Modules
 			// Serializes all extension data in a player-properties structure.
 			void SerializeData(Blam::BitStream* stream, const void* data);
 
-			// Deserializes all extension data in a player-properties structure.
-			void DeserializeData(Blam::BitStream* stream, void* out);
+			// Deserializes all extension data in a player-properties structure, returns false if the data was malformed.
+			bool DeserializeData(Blam::BitStream* stream, void* out);
 
 		private:
 			std::vector<std::shared_ptr<PlayerPropertiesExtensionBase>> extensions;
+			PacketExtensionCodec codec;
 		};
 	}
 }
\ No newline at end of file
@@ -1,5 +1,6 @@
 #pragma once
 #include <ElDorito/ModuleBase.hpp>
+#include "../../KeyManager.hpp"
 
 namespace Modules
 {
@@ -8,8 +9,20 @@ namespace Modules
 	public:
 		PatchModulePlayerUid();
 
+		WinKeyEnvironment KeysEnvironment; // has to be before Keys
+		KeyManager Keys;
+
 		uint64_t GetUid();
 		std::string GetFormattedPrivKey();
 		void EnsureValidUid();
+		void PrepareKey();
+		void Tick();
+
+	private:
+		std::string formattedPrivKeySource; // the Player.PrivKey value formattedPrivKey was made from
+		std::string formattedPrivKey;
+
+		bool adoptPreparedKey(bool wait);
+		void applyKey(const PlayerKeyPair& key, const std::string& message);
 	};
 }
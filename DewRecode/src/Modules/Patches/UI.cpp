@@ -8,7 +8,7 @@ namespace
 	{
 		auto& engine = ElDorito::Instance().Engine;
 		if (!engine.HasMainMenuShown() && menuIdToLoad == 0x10083)
-			engine.Event("Core", "Engine.MainMenuShown");
+			engine.Event(engine.CoreEvents.MainMenuShown);
 
 		bool shouldUpdate = *(DWORD*)((uint8_t*)a1 + 0x10) >= 0x1E;
 		int uiData0x18Value = 1;
@@ -0,0 +1,81 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// bounded multi-producer single-consumer queue over a fixed ring, never allocates
+// each slot has a sequence number that tells producers/the consumer if it's free: a producer claims slot pos when its sequence is pos,
+// publishes it by setting it to pos + 1, and the consumer frees it again by setting it to pos + Size
+template<class T, size_t Size>
+class MpscQueue
+{
+	static_assert(Size > 0 && (Size & (Size - 1)) == 0, "MpscQueue size must be a power of 2");
+
+public:
+	MpscQueue()
+	{
+		for (size_t i = 0; i < Size; i++)
+			slots[i].Sequence = i;
+		enqueuePos = 0;
+	}
+
+	// Claims a slot and calls fill(T&) to fill it in, can be called from any thread.
+	// Returns false (without calling fill) if the queue is full.
+	template<class Func>
+	bool TryEnqueue(Func fill)
+	{
+		Slot* slot;
+		auto pos = enqueuePos.load(std::memory_order_relaxed);
+		for (;;)
+		{
+			slot = &slots[pos & (Size - 1)];
+			auto seq = slot->Sequence.load(std::memory_order_acquire);
+			auto diff = (intptr_t)seq - (intptr_t)pos;
+			if (diff == 0)
+			{
+				// slot is free, try to claim it
+				if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+					break;
+			}
+			else if (diff < 0)
+				return false; // consumer hasn't freed this slot yet, queue is full
+			else
+				pos = enqueuePos.load(std::memory_order_relaxed); // another thread claimed it first
+		}
+
+		fill(slot->Item);
+		slot->Sequence.store(pos + 1, std::memory_order_release); // hand it to the consumer
+		return true;
+	}
+
+	// Calls consume(T&) for every published item in the order they were claimed, and returns how many there were.
+	// Only one thread can drain at a time, stops early at a slot that's been claimed but not filled in yet.
+	template<class Func>
+	size_t Drain(Func consume)
+	{
+		size_t count = 0;
+		for (;;)
+		{
+			auto& slot = slots[dequeuePos & (Size - 1)];
+			if (slot.Sequence.load(std::memory_order_acquire) != dequeuePos + 1)
+				break;
+
+			consume(slot.Item);
+			slot.Sequence.store(dequeuePos + Size, std::memory_order_release); // slot is free again
+			dequeuePos++;
+			count++;
+		}
+		return count;
+	}
+
+private:
+	struct Slot
+	{
+		std::atomic<size_t> Sequence;
+		T Item;
+	};
+
+	Slot slots[Size];
+	std::atomic<size_t> enqueuePos;
+	size_t dequeuePos = 0; // only touched by the thread that's draining
+};
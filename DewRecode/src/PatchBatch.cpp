@@ -0,0 +1,135 @@
+#include "PatchBatch.hpp"
+#include <algorithm>
+#include <sstream>
+
+namespace
+{
+	std::string FormatAddress(size_t address)
+	{
+		std::stringstream ss;
+		ss << "0x" << std::hex << std::uppercase << address;
+		return ss.str();
+	}
+}
+
+PatchBatch::PatchBatch(PatchMemory* memory)
+	: memory(memory)
+{
+}
+
+void PatchBatch::Add(const std::string& name, size_t address, const std::vector<unsigned char>& data, const std::vector<unsigned char>* expected)
+{
+	if (data.empty())
+		return;
+
+	PendingWrite write;
+	write.Name = name;
+	write.Address = address;
+	write.Data = data;
+	write.CheckExpected = expected != nullptr;
+	if (expected)
+		write.Expected = *expected;
+	writes.push_back(write);
+}
+
+bool PatchBatch::Apply(std::string& error)
+{
+	if (writes.empty())
+		return true;
+
+	// check everything before touching anything, so a mismatch doesn't need anything undone
+	for (auto& write : writes)
+	{
+		write.Backup.resize(write.Data.size());
+		if (!memory->Read(write.Address, write.Backup.data(), write.Backup.size()))
+		{
+			error = write.Name + ": failed to read " + FormatAddress(write.Address);
+			return false;
+		}
+		if (write.CheckExpected && (write.Expected.size() != write.Backup.size() || !std::equal(write.Backup.begin(), write.Backup.end(), write.Expected.begin())))
+		{
+			error = write.Name + ": unexpected bytes at " + FormatAddress(write.Address);
+			return false;
+		}
+	}
+
+	std::vector<UnprotectedPage> pages;
+	if (!unprotectPages(pages, error))
+		return false;
+
+	size_t written = 0;
+	for (; written < writes.size(); written++)
+	{
+		auto& write = writes[written];
+		if (!memory->Write(write.Address, write.Data.data(), write.Data.size()))
+		{
+			error = write.Name + ": failed to write " + FormatAddress(write.Address);
+			break;
+		}
+	}
+
+	bool succeeded = written == writes.size();
+	if (!succeeded)
+	{
+		// undo in reverse, in case any of the writes overlapped
+		while (written > 0)
+		{
+			written--;
+			memory->Write(writes[written].Address, writes[written].Backup.data(), writes[written].Backup.size());
+		}
+	}
+
+	auto start = writes[0].Address;
+	auto end = writes[0].Address + writes[0].Data.size();
+	for (auto& write : writes)
+	{
+		if (write.Address < start)
+			start = write.Address;
+		if (write.Address + write.Data.size() > end)
+			end = write.Address + write.Data.size();
+	}
+	memory->FlushInstructions(start, end - start);
+
+	restorePages(pages);
+	return succeeded;
+}
+
+/// <summary>
+/// Makes every page the batch writes to writable, if one can't be then the ones that were are put back.
+/// </summary>
+bool PatchBatch::unprotectPages(std::vector<UnprotectedPage>& pages, std::string& error)
+{
+	auto pageSize = memory->GetPageSize();
+
+	std::vector<size_t> pageAddresses;
+	for (auto& write : writes)
+	{
+		auto first = write.Address / pageSize;
+		auto last = (write.Address + write.Data.size() - 1) / pageSize;
+		for (auto page = first; page <= last; page++)
+			pageAddresses.push_back(page * pageSize);
+	}
+	std::sort(pageAddresses.begin(), pageAddresses.end());
+	pageAddresses.erase(std::unique(pageAddresses.begin(), pageAddresses.end()), pageAddresses.end());
+
+	for (auto page : pageAddresses)
+	{
+		UnprotectedPage unprotected;
+		unprotected.Page = page;
+		if (!memory->UnprotectPage(page, unprotected.OldProtection))
+		{
+			error = "failed to unprotect page " + FormatAddress(page);
+			restorePages(pages);
+			pages.clear();
+			return false;
+		}
+		pages.push_back(unprotected);
+	}
+	return true;
+}
+
+void PatchBatch::restorePages(const std::vector<UnprotectedPage>& pages)
+{
+	for (auto& page : pages)
+		memory->RestorePage(page.Page, page.OldProtection);
+}
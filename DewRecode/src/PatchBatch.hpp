@@ -0,0 +1,73 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// the memory that patches get written to, PatchManager uses the current process's memory but anything can be swapped in (eg. a plain buffer)
+class PatchMemory
+{
+public:
+	virtual ~PatchMemory() {}
+
+	virtual size_t GetPageSize() = 0;
+
+	// Makes a page writable, oldProtection gets whatever needs to be passed to RestorePage to put it back.
+	virtual bool UnprotectPage(size_t page, uint32_t& oldProtection) = 0;
+	virtual bool RestorePage(size_t page, uint32_t oldProtection) = 0;
+
+	virtual bool Read(size_t address, void* out, size_t size) = 0;
+	virtual bool Write(size_t address, const void* data, size_t size) = 0;
+
+	// Called after code has been written, so the CPU doesn't run stale instructions.
+	virtual void FlushInstructions(size_t address, size_t size) = 0;
+};
+
+// a set of writes that get applied together
+// the bytes at each address can be checked before anything is written, each page is only unprotected once no matter how many writes touch it,
+// and if anything fails every write that was already made is undone, so memory never gets left half patched
+class PatchBatch
+{
+public:
+	explicit PatchBatch(PatchMemory* memory);
+
+	/// <summary>
+	/// Queues up a write.
+	/// </summary>
+	/// <param name="name">The name of the patch/hook, used in error messages.</param>
+	/// <param name="address">The address to write to.</param>
+	/// <param name="data">The data to write.</param>
+	/// <param name="expected">If not null, the bytes that have to be at the address for the batch to be applied.</param>
+	void Add(const std::string& name, size_t address, const std::vector<unsigned char>& data, const std::vector<unsigned char>* expected = nullptr);
+
+	/// <summary>
+	/// Applies every write in the batch.
+	/// </summary>
+	/// <param name="error">Set to what went wrong if the batch couldn't be applied.</param>
+	/// <returns>true if everything was written, false if nothing was.</returns>
+	bool Apply(std::string& error);
+
+	size_t Size() const { return writes.size(); }
+
+private:
+	struct PendingWrite
+	{
+		std::string Name;
+		size_t Address;
+		std::vector<unsigned char> Data;
+		std::vector<unsigned char> Expected;
+		bool CheckExpected;
+		std::vector<unsigned char> Backup; // what was there before, so it can be put back
+	};
+
+	struct UnprotectedPage
+	{
+		size_t Page;
+		uint32_t OldProtection;
+	};
+
+	PatchMemory* memory;
+	std::vector<PendingWrite> writes;
+
+	bool unprotectPages(std::vector<UnprotectedPage>& pages, std::string& error);
+	void restorePages(const std::vector<UnprotectedPage>& pages);
+};
@@ -1,5 +1,52 @@
 #include "PatchManager.hpp"
-#include <ElDorito/Pointer.hpp>
+#include "ElDorito.hpp"
+
+namespace
+{
+	class ProcessMemory : public PatchMemory
+	{
+	public:
+		size_t GetPageSize()
+		{
+			SYSTEM_INFO info;
+			GetSystemInfo(&info);
+			return info.dwPageSize;
+		}
+
+		bool UnprotectPage(size_t page, uint32_t& oldProtection)
+		{
+			// keep the page executable, other threads could be running code on it while it's being patched
+			DWORD old;
+			if (!VirtualProtect(reinterpret_cast<void*>(page), 1, PAGE_EXECUTE_READWRITE, &old))
+				return false;
+			oldProtection = old;
+			return true;
+		}
+
+		bool RestorePage(size_t page, uint32_t oldProtection)
+		{
+			DWORD temp;
+			return VirtualProtect(reinterpret_cast<void*>(page), 1, oldProtection, &temp) != 0;
+		}
+
+		bool Read(size_t address, void* out, size_t size)
+		{
+			memcpy(out, reinterpret_cast<void*>(address), size);
+			return true;
+		}
+
+		bool Write(size_t address, const void* data, size_t size)
+		{
+			memcpy(reinterpret_cast<void*>(address), data, size);
+			return true;
+		}
+
+		void FlushInstructions(size_t address, size_t size)
+		{
+			FlushInstructionCache(GetCurrentProcess(), reinterpret_cast<void*>(address), size);
+		}
+	} processMemory;
+}
 
 /// <summary>
 /// Generates a byte array for the specified hook.
@@ -33,6 +80,11 @@ std::vector<unsigned char> GetHookBytes(Hook* hook)
 	return{};
 }
 
+PatchManager::PatchManager(PatchMemory* memory)
+	: memory(memory ? memory : &processMemory)
+{
+}
+
 /// <summary>
 /// Adds a patch to the manager.
 /// </summary>
@@ -43,11 +95,10 @@ std::vector<unsigned char> GetHookBytes(Hook* hook)
 Patch* PatchManager::AddPatch(const std::string& name, size_t address, const PatchInitializerListType& data)
 {
 	Patch patch(name, address, data);
-
-	patch.Orig.resize(data.size());
-	Pointer(address).Read(patch.Orig.data(), patch.Orig.size());
+	readOriginal(address, data.size(), patch.Orig);
 
 	patches.push_back(patch);
+	patchIndex.insert(std::make_pair(name, &patches.back())); // if the name's already taken, lookups keep finding the first one
 	return &patches.back();
 }
 
@@ -62,11 +113,10 @@ Patch* PatchManager::AddPatch(const std::string& name, size_t address, const Pat
 Patch* PatchManager::AddPatch(const std::string& name, size_t address, unsigned char fillByte, size_t numBytes)
 {
 	Patch patch(name, address, fillByte, numBytes);
-
-	patch.Orig.resize(numBytes);
-	Pointer(address).Read(patch.Orig.data(), patch.Orig.size());
+	readOriginal(address, numBytes, patch.Orig);
 
 	patches.push_back(patch);
+	patchIndex.insert(std::make_pair(name, &patches.back()));
 	return &patches.back();
 }
 
@@ -82,11 +132,10 @@ Hook* PatchManager::AddHook(const std::string& name, size_t address, void* destF
 {
 	Hook hook(name, address, destFunc, type);
 
-	auto patchData = GetHookBytes(&hook);
-	hook.Orig.resize(patchData.size());
-	Pointer(address).Read(hook.Orig.data(), hook.Orig.size());
+	readOriginal(address, GetHookBytes(&hook).size(), hook.Orig);
 
 	hooks.push_back(hook);
+	hookIndex.insert(std::make_pair(name, &hooks.back()));
 	return &hooks.back();
 }
 
@@ -102,19 +151,13 @@ PatchSet* PatchManager::AddPatchSet(const std::string& name, const PatchSetIniti
 	PatchSet patchSet(name, patches, hooks);
 
 	for (auto& patch : patchSet.Patches)
-	{
-		patch.Orig.resize(patch.Data.size());
-		Pointer(patch.Address).Read(patch.Orig.data(), patch.Orig.size());
-	}
+		readOriginal(patch.Address, patch.Data.size(), patch.Orig);
 
 	for (auto& hook : patchSet.Hooks)
-	{
-		auto patchData = GetHookBytes(&hook);
-		hook.Orig.resize(patchData.size());
-		Pointer(hook.Address).Read(hook.Orig.data(), hook.Orig.size());
-	}
+		readOriginal(hook.Address, GetHookBytes(&hook).size(), hook.Orig);
 
 	patchSets.push_back(patchSet);
+	patchSetIndex.insert(std::make_pair(name, &patchSets.back()));
 	return &patchSets.back();
 }
 
@@ -125,12 +168,8 @@ PatchSet* PatchManager::AddPatchSet(const std::string& name, const PatchSetIniti
 /// <returns>A pointer to the patch, if found.</returns>
 Patch* PatchManager::FindPatch(const std::string& name)
 {
-	for (auto it = patches.begin(); it != patches.end(); ++it)
-	{
-		if (!(*it).Name.compare(name))
-			return &(*it);
-	}
-	return nullptr;
+	auto it = patchIndex.find(name);
+	return it != patchIndex.end() ? it->second : nullptr;
 }
 
 /// <summary>
@@ -140,12 +179,8 @@ Patch* PatchManager::FindPatch(const std::string& name)
 /// <returns>A pointer to the hook, if found.</returns>
 Hook* PatchManager::FindHook(const std::string& name)
 {
-	for (auto it = hooks.begin(); it != hooks.end(); ++it)
-	{
-		if (!(*it).Name.compare(name))
-			return &(*it);
-	}
-	return nullptr;
+	auto it = hookIndex.find(name);
+	return it != hookIndex.end() ? it->second : nullptr;
 }
 
 /// <summary>
@@ -155,12 +190,8 @@ Hook* PatchManager::FindHook(const std::string& name)
 /// <returns>A pointer to the patch set, if found.</returns>
 PatchSet* PatchManager::FindPatchSet(const std::string& name)
 {
-	for (auto it = patchSets.begin(); it != patchSets.end(); ++it)
-	{
-		if (!(*it).Name.compare(name))
-			return &(*it);
-	}
-	return nullptr;
+	auto it = patchSetIndex.find(name);
+	return it != patchSetIndex.end() ? it->second : nullptr;
 }
 
 /// <summary>
@@ -212,12 +243,9 @@ PatchStatus PatchManager::TogglePatchSet(const std::string& name)
 /// <returns>true if the patch is active, false if not.</returns>
 bool PatchManager::TogglePatch(Patch* patch)
 {
-	if (patch->Enabled)
-		Pointer(patch->Address).Write(patch->Orig.data(), patch->Orig.size());
-	else
-		Pointer(patch->Address).Write(patch->Data.data(), patch->Data.size());
-
-	patch->Enabled = !patch->Enabled;
+	std::string error;
+	if (!togglePatch(patch, error))
+		logFailure(patch->Name, error);
 	return patch->Enabled;
 }
 
@@ -228,32 +256,23 @@ bool PatchManager::TogglePatch(Patch* patch)
 /// <returns>true if the hook is active, false if not.</returns>
 bool PatchManager::ToggleHook(Hook* hook)
 {
-	if (hook->Enabled)
-		Pointer(hook->Address).Write(hook->Orig.data(), hook->Orig.size());
-	else
-	{
-		auto hookData = GetHookBytes(hook);
-		Pointer(hook->Address).Write(hookData.data(), hookData.size());
-	}
-
-	hook->Enabled = !hook->Enabled;
+	std::string error;
+	if (!toggleHook(hook, error))
+		logFailure(hook->Name, error);
 	return hook->Enabled;
 }
 
 /// <summary>
 /// Toggles a patch set (and all children patches/hooks).
+/// Everything in the set is written in one batch, so if any of it can't be written none of it is.
 /// </summary>
 /// <param name="patchSet">The patch set to toggle.</param>
 /// <returns>true if the hook is active, false if not.</returns>
 bool PatchManager::TogglePatchSet(PatchSet* patchSet)
 {
-	for (auto it = patchSet->Patches.begin(); it != patchSet->Patches.end(); ++it)
-		TogglePatch(&(*it));
-
-	for (auto it = patchSet->Hooks.begin(); it != patchSet->Hooks.end(); ++it)
-		ToggleHook(&(*it));
-
-	patchSet->Enabled = !patchSet->Enabled;
+	std::string error;
+	if (!togglePatchSet(patchSet, error))
+		logFailure(patchSet->Name, error);
 	return patchSet->Enabled;
 }
 
@@ -339,4 +358,124 @@ bool PatchManager::EnablePatchSet(PatchSet* patchSet, bool enable)
 	if (patchSet->Enabled == enable)
 		return true; // patchset is already set to this
 	return TogglePatchSet(patchSet);
-}
\ No newline at end of file
+}
+
+/// <summary>
+/// Enables/disables a patch, and says why if it couldn't be.
+/// </summary>
+/// <param name="patch">The patch.</param>
+/// <param name="enable">Whether to enable it or not.</param>
+/// <param name="error">Set to what went wrong if the patch couldn't be changed.</param>
+/// <returns>true if the patch is now enabled/disabled, false if memory didn't hold what was expected or couldn't be written (nothing is changed).</returns>
+bool PatchManager::TryEnablePatch(Patch* patch, bool enable, std::string& error)
+{
+	if (patch->Enabled == enable)
+		return true;
+	return togglePatch(patch, error);
+}
+
+/// <summary>
+/// Enables/disables a hook, and says why if it couldn't be.
+/// </summary>
+/// <param name="hook">The hook.</param>
+/// <param name="enable">Whether to enable it or not.</param>
+/// <param name="error">Set to what went wrong if the hook couldn't be changed.</param>
+/// <returns>true if the hook is now enabled/disabled, false if memory didn't hold what was expected or couldn't be written (nothing is changed).</returns>
+bool PatchManager::TryEnableHook(Hook* hook, bool enable, std::string& error)
+{
+	if (hook->Enabled == enable)
+		return true;
+	return toggleHook(hook, error);
+}
+
+/// <summary>
+/// Enables/disables a patch set (and all children patches/hooks), and says why if it couldn't be.
+/// </summary>
+/// <param name="patchSet">The patch set.</param>
+/// <param name="enable">Whether to enable it or not.</param>
+/// <param name="error">Set to what went wrong if the patch set couldn't be changed.</param>
+/// <returns>true if the patch set is now enabled/disabled, false if any of it couldn't be (none of it is changed).</returns>
+bool PatchManager::TryEnablePatchSet(PatchSet* patchSet, bool enable, std::string& error)
+{
+	if (patchSet->Enabled == enable)
+		return true;
+	return togglePatchSet(patchSet, error);
+}
+
+void PatchManager::readOriginal(size_t address, size_t size, std::vector<unsigned char>& orig)
+{
+	orig.resize(size);
+	memory->Read(address, orig.data(), orig.size());
+}
+
+/// <summary>
+/// Adds the write that toggles a patch to a batch, what's in memory has to match the patch's current state for the batch to go through.
+/// </summary>
+void PatchManager::addToBatch(PatchBatch& batch, Patch* patch)
+{
+	if (patch->Enabled)
+		batch.Add(patch->Name, patch->Address, patch->Orig, &patch->Data);
+	else
+		batch.Add(patch->Name, patch->Address, patch->Data, &patch->Orig);
+}
+
+void PatchManager::addToBatch(PatchBatch& batch, Hook* hook)
+{
+	auto hookData = GetHookBytes(hook);
+	if (hook->Enabled)
+		batch.Add(hook->Name, hook->Address, hook->Orig, &hookData);
+	else
+		batch.Add(hook->Name, hook->Address, hookData, &hook->Orig);
+}
+
+/// <summary>
+/// Writes a patch's data (or its original bytes if it's enabled), and flips its state if that worked.
+/// </summary>
+bool PatchManager::togglePatch(Patch* patch, std::string& error)
+{
+	PatchBatch batch(memory);
+	addToBatch(batch, patch);
+	if (!batch.Apply(error))
+		return false;
+
+	patch->Enabled = !patch->Enabled;
+	return true;
+}
+
+bool PatchManager::toggleHook(Hook* hook, std::string& error)
+{
+	PatchBatch batch(memory);
+	addToBatch(batch, hook);
+	if (!batch.Apply(error))
+		return false;
+
+	hook->Enabled = !hook->Enabled;
+	return true;
+}
+
+bool PatchManager::togglePatchSet(PatchSet* patchSet, std::string& error)
+{
+	PatchBatch batch(memory);
+	for (auto it = patchSet->Patches.begin(); it != patchSet->Patches.end(); ++it)
+		addToBatch(batch, &(*it));
+
+	for (auto it = patchSet->Hooks.begin(); it != patchSet->Hooks.end(); ++it)
+		addToBatch(batch, &(*it));
+
+	if (!batch.Apply(error))
+		return false;
+
+	for (auto it = patchSet->Patches.begin(); it != patchSet->Patches.end(); ++it)
+		it->Enabled = !it->Enabled;
+
+	for (auto it = patchSet->Hooks.begin(); it != patchSet->Hooks.end(); ++it)
+		it->Enabled = !it->Enabled;
+
+	patchSet->Enabled = !patchSet->Enabled;
+	return true;
+}
+
+void PatchManager::logFailure(const std::string& name, const std::string& error)
+{
+	ElDorito::Instance().Logger.Log(LogSeverity::Error, "Patches", "Failed to toggle %s, nothing was changed (%s)", name.c_str(), error.c_str());
+}
@@ -2,11 +2,16 @@
 #include <ElDorito/ElDorito.hpp>
 #include <deque>
 #include <map>
+#include <unordered_map>
+#include "PatchBatch.hpp"
 
 // if you make any changes to this class make sure to update the exported interface (create a new interface + inherit from it if the interface already shipped)
 class PatchManager : public IPatchManager
 {
 public:
+	// memory is where patches get written, if it's null then they're written to this process
+	explicit PatchManager(PatchMemory* memory = nullptr);
+
 	Patch* AddPatch(const std::string& name, size_t address, const PatchInitializerListType& data);
 	Patch* AddPatch(const std::string& name, size_t address, unsigned char fillByte, size_t numBytes);
 	Hook* AddHook(const std::string& name, size_t address, void* destFunc, HookType type);
@@ -32,8 +37,26 @@ public:
 	bool EnableHook(Hook* hook, bool enable = true);
 	bool EnablePatchSet(PatchSet* patchSet, bool enable = true);
 
+	bool TryEnablePatch(Patch* patch, bool enable, std::string& error);
+	bool TryEnableHook(Hook* hook, bool enable, std::string& error);
+	bool TryEnablePatchSet(PatchSet* patchSet, bool enable, std::string& error);
+
 private:
+	PatchMemory* memory;
+
+	// deques so that adding more doesn't move the existing ones, the indexes point into them
 	std::deque<Patch> patches;
 	std::deque<Hook> hooks;
 	std::deque<PatchSet> patchSets;
+	std::unordered_map<std::string, Patch*> patchIndex;
+	std::unordered_map<std::string, Hook*> hookIndex;
+	std::unordered_map<std::string, PatchSet*> patchSetIndex;
+
+	void readOriginal(size_t address, size_t size, std::vector<unsigned char>& orig);
+	void addToBatch(PatchBatch& batch, Patch* patch);
+	void addToBatch(PatchBatch& batch, Hook* hook);
+	bool togglePatch(Patch* patch, std::string& error);
+	bool toggleHook(Hook* hook, std::string& error);
+	bool togglePatchSet(PatchSet* patchSet, std::string& error);
+	void logFailure(const std::string& name, const std::string& error);
 };
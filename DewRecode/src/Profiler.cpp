@@ -0,0 +1,279 @@
+#include "Profiler.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <rapidjson/writer.h>
+#include <rapidjson/stringbuffer.h>
+
+PROFILER_THREAD_LOCAL Profiler::ThreadRing* Profiler::currentRing = nullptr;
+PROFILER_THREAD_LOCAL bool Profiler::currentThreadDropped = false;
+
+Profiler::Profiler()
+{
+	frequency = ProfilerPlatform::Frequency();
+
+	enabled = false;
+	enabledTime = 0;
+	ringCount = 0;
+	dropped = 0;
+	for (size_t i = 0; i < MaxThreads; i++)
+		rings[i] = nullptr;
+}
+
+Profiler::~Profiler()
+{
+	enabled = false;
+	for (size_t i = 0; i < ringCount; i++)
+		delete rings[i];
+}
+
+/// <summary>
+/// Gets the ID of a zone, registering it if it's new.
+/// </summary>
+/// <param name="name">The name of the zone.</param>
+/// <returns>The ID of the zone.</returns>
+uint32_t Profiler::RegisterZone(const std::string& name)
+{
+	std::lock_guard<std::mutex> guard(zoneLock);
+	auto it = zoneIds.find(name);
+	if (it != zoneIds.end())
+		return it->second;
+
+	auto id = static_cast<uint32_t>(zoneNames.size());
+	zoneNames.push_back(name);
+	zoneIds[name] = id;
+	return id;
+}
+
+/// <summary>
+/// Starts or stops recording zones.
+/// </summary>
+/// <param name="enabled">Whether to record zones.</param>
+void Profiler::SetEnabled(bool enabled)
+{
+	if (enabled && !this->enabled)
+		enabledTime = Now(); // forget about anything from the last time it was recording
+	this->enabled = enabled;
+}
+
+/// <summary>
+/// Gets the stats for every zone that ran since recording started.
+/// </summary>
+/// <returns>The stats for each zone, sorted by total time (highest first).</returns>
+std::vector<Profiler::ZoneStats> Profiler::GetStats()
+{
+	auto samples = collect();
+
+	std::vector<std::vector<int64_t>> durations;
+	for (auto& sample : samples)
+	{
+		if (sample.Data.Zone >= durations.size())
+			durations.resize(sample.Data.Zone + 1);
+		durations[sample.Data.Zone].push_back(sample.Data.End - sample.Data.Start);
+	}
+
+	std::vector<ZoneStats> stats;
+	auto msPerTick = 1000.0 / frequency;
+	std::lock_guard<std::mutex> guard(zoneLock);
+	for (size_t zone = 0; zone < durations.size(); zone++)
+	{
+		auto& zoneDurations = durations[zone];
+		if (zoneDurations.empty())
+			continue;
+
+		std::sort(zoneDurations.begin(), zoneDurations.end());
+		int64_t total = 0;
+		for (auto duration : zoneDurations)
+			total += duration;
+
+		ZoneStats zoneStats;
+		zoneStats.Name = zone < zoneNames.size() ? zoneNames[zone] : "Zone " + std::to_string(zone);
+		zoneStats.Count = zoneDurations.size();
+		zoneStats.TotalMs = total * msPerTick;
+		zoneStats.MinMs = zoneDurations.front() * msPerTick;
+		zoneStats.AvgMs = zoneStats.TotalMs / zoneStats.Count;
+		zoneStats.P99Ms = zoneDurations[(zoneStats.Count * 99 + 99) / 100 - 1] * msPerTick; // smallest duration that 99% of them are at or under
+		zoneStats.MaxMs = zoneDurations.back() * msPerTick;
+		stats.push_back(zoneStats);
+	}
+
+	std::sort(stats.begin(), stats.end(), [](const ZoneStats& lhs, const ZoneStats& rhs) { return lhs.TotalMs > rhs.TotalMs; });
+	return stats;
+}
+
+/// <summary>
+/// Writes every zone recorded since recording started to a file in the Chrome trace event format.
+/// </summary>
+/// <param name="path">The file to write to.</param>
+/// <param name="zonesWritten">Returns the number of zones that were written.</param>
+/// <param name="error">Returns the reason the trace couldn't be written.</param>
+/// <returns>true if the trace was written.</returns>
+bool Profiler::WriteChromeTrace(const std::string& path, size_t& zonesWritten, std::string& error)
+{
+	auto samples = collect();
+	zonesWritten = 0;
+	if (samples.empty())
+	{
+		error = "No zones have been recorded";
+		return false;
+	}
+
+	std::sort(samples.begin(), samples.end(), [](const ThreadSample& lhs, const ThreadSample& rhs) { return lhs.Data.Start < rhs.Data.Start; });
+
+	std::vector<std::string> names;
+	{
+		std::lock_guard<std::mutex> guard(zoneLock);
+		names = zoneNames;
+	}
+
+	// timestamps are in microseconds, relative to the first zone
+	auto start = samples.front().Data.Start;
+	auto usPerTick = 1000000.0 / frequency;
+	auto processId = ProfilerPlatform::CurrentProcessId();
+
+	rapidjson::StringBuffer s;
+	rapidjson::Writer<rapidjson::StringBuffer> writer(s);
+	writer.StartObject();
+	writer.Key("traceEvents");
+	writer.StartArray();
+	for (auto& sample : samples)
+	{
+		auto zone = sample.Data.Zone;
+		auto name = zone < names.size() ? names[zone] : "Zone " + std::to_string(zone);
+
+		writer.StartObject();
+		writer.Key("name");
+		writer.String(name.c_str());
+		writer.Key("ph");
+		writer.String("X"); // complete event, has a start and a duration
+		writer.Key("ts");
+		writer.Double((sample.Data.Start - start) * usPerTick);
+		writer.Key("dur");
+		writer.Double((sample.Data.End - sample.Data.Start) * usPerTick);
+		writer.Key("pid");
+		writer.Uint(processId);
+		writer.Key("tid");
+		writer.Uint(sample.ThreadId);
+		writer.EndObject();
+	}
+	writer.EndArray();
+	writer.Key("displayTimeUnit");
+	writer.String("ms");
+	writer.EndObject();
+
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	if (!file.is_open())
+	{
+		error = "Failed to open " + path + " for writing";
+		return false;
+	}
+	file.write(s.GetString(), s.GetSize());
+	if (!file)
+	{
+		error = "Failed to write to " + path;
+		return false;
+	}
+
+	zonesWritten = samples.size();
+	return true;
+}
+
+/// <summary>
+/// Gets a name for a code address like "ChatPlugin.dll+0x1234", so callbacks can be told apart without symbols.
+/// </summary>
+/// <param name="address">The address.</param>
+/// <returns>The module the address is in and its offset in the module, or just the address if it's not in a module.</returns>
+std::string Profiler::DescribeAddress(const void* address)
+{
+#ifndef _WIN32
+	char name[32];
+	snprintf(name, sizeof(name), "%p", address);
+	return name;
+#else
+	char name[MAX_PATH + 16];
+	HMODULE module;
+	char path[MAX_PATH];
+	if (!GetModuleHandleExA(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS | GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT, reinterpret_cast<LPCSTR>(address), &module) ||
+		!GetModuleFileNameA(module, path, MAX_PATH))
+	{
+		sprintf_s(name, "0x%p", address);
+		return name;
+	}
+
+	auto fileName = strrchr(path, '\\');
+	sprintf_s(name, "%s+0x%X", fileName ? fileName + 1 : path, reinterpret_cast<uintptr_t>(address) - reinterpret_cast<uintptr_t>(module));
+	return name;
+#endif
+}
+
+/// <summary>
+/// Gives the current thread a ring to record zones into, called the first time a thread records a zone.
+/// </summary>
+/// <returns>The ring, or nullptr if every ring is taken (the zone gets dropped).</returns>
+Profiler::ThreadRing* Profiler::addThreadRing()
+{
+	if (currentThreadDropped)
+	{
+		dropped++;
+		return nullptr;
+	}
+
+	std::lock_guard<std::mutex> guard(ringLock);
+	auto count = ringCount.load(std::memory_order_relaxed);
+	if (count >= MaxThreads)
+	{
+		currentThreadDropped = true;
+		dropped++;
+		return nullptr;
+	}
+
+	auto ring = new ThreadRing;
+	ring->ThreadId = ProfilerPlatform::CurrentThreadId();
+	ring->WritePos = 0;
+	rings[count] = ring;
+	ringCount.store(count + 1, std::memory_order_release); // publishes the ring to collect
+	currentRing = ring;
+	return ring;
+}
+
+/// <summary>
+/// Copies the zones out of every threads ring, skipping any that were recorded before recording last started.
+/// </summary>
+/// <returns>The zones.</returns>
+std::vector<Profiler::ThreadSample> Profiler::collect()
+{
+	std::vector<ThreadSample> samples;
+	auto since = enabledTime.load();
+	auto count = ringCount.load(std::memory_order_acquire);
+	for (size_t i = 0; i < count; i++)
+	{
+		auto ring = rings[i];
+		auto end = ring->WritePos.load(std::memory_order_acquire);
+		auto begin = end > RingSize ? end - RingSize : 0;
+
+		auto first = samples.size();
+		for (auto pos = begin; pos != end; pos++)
+		{
+			ThreadSample sample;
+			sample.ThreadId = ring->ThreadId;
+			sample.Data = ring->Samples[pos & (RingSize - 1)];
+			samples.push_back(sample);
+		}
+
+		// the thread keeps recording while we copy, anything it wrapped around onto might've been half written so it's thrown away
+		std::atomic_thread_fence(std::memory_order_acquire);
+		auto newEnd = ring->WritePos.load(std::memory_order_relaxed);
+		// while WritePos is newEnd the thread can already be writing sample newEnd, which lands on top of sample newEnd - RingSize
+		if (newEnd - begin >= RingSize)
+		{
+			auto overwritten = newEnd - begin - RingSize + 1;
+			if (overwritten > end - begin)
+				overwritten = end - begin;
+			samples.erase(samples.begin() + first, samples.begin() + first + overwritten);
+		}
+
+		samples.erase(std::remove_if(samples.begin() + first, samples.end(), [since](const ThreadSample& sample) { return sample.Data.Start < since; }), samples.end());
+	}
+	return samples;
+}
@@ -0,0 +1,194 @@
+#pragma once
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <chrono>
+#include <unistd.h>
+#endif
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// the only platform specific bits the profiler needs, so it (and its benchmark) can be built without MSVC
+// VS2013 has no thread_local and its chrono clocks are low resolution, so Windows uses __declspec(thread) and QueryPerformanceCounter
+#ifdef _WIN32
+#define PROFILER_THREAD_LOCAL __declspec(thread)
+#else
+#define PROFILER_THREAD_LOCAL thread_local
+#endif
+
+namespace ProfilerPlatform
+{
+	inline int64_t Now()
+	{
+#ifdef _WIN32
+		LARGE_INTEGER counter;
+		QueryPerformanceCounter(&counter);
+		return counter.QuadPart;
+#else
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+	}
+
+	// Now() ticks per second
+	inline int64_t Frequency()
+	{
+#ifdef _WIN32
+		LARGE_INTEGER freq;
+		QueryPerformanceFrequency(&freq);
+		return freq.QuadPart;
+#else
+		return 1000000000;
+#endif
+	}
+
+	inline uint32_t CurrentThreadId()
+	{
+#ifdef _WIN32
+		return GetCurrentThreadId();
+#else
+		return static_cast<uint32_t>(gettid());
+#endif
+	}
+
+	inline uint32_t CurrentProcessId()
+	{
+#ifdef _WIN32
+		return GetCurrentProcessId();
+#else
+		return static_cast<uint32_t>(getpid());
+#endif
+	}
+}
+
+// times scoped zones (tick/event callbacks etc) with as little overhead as possible
+// each thread writes the zones it finishes into its own ring, so recording never takes a lock, only the newest RingSize zones per thread are kept
+// stats and traces are worked out from whatever's in the rings when they're asked for
+// only one of these should exist (ElDorito::Profiler), the rings are found through a thread-local pointer
+class Profiler
+{
+public:
+	static const size_t RingSize = 1 << 14; // zones kept per thread, must be a power of 2
+	static const size_t MaxThreads = 32; // zones from any threads past this are dropped
+
+	struct ZoneStats
+	{
+		std::string Name;
+		size_t Count;
+		double TotalMs;
+		double MinMs;
+		double AvgMs;
+		double P99Ms;
+		double MaxMs;
+	};
+
+	Profiler();
+	~Profiler();
+
+	// Gets the ID of a zone, registering it if it's new. Meant to be called once per zone (eg. when a callback is registered), not every time it runs.
+	uint32_t RegisterZone(const std::string& name);
+
+	// Starts/stops recording, zones recorded before the last time it was started are ignored.
+	void SetEnabled(bool enabled);
+	bool IsEnabled() const { return enabled.load(std::memory_order_relaxed); }
+
+	// Gets the stats for every zone that ran since recording started, sorted by total time (highest first).
+	std::vector<ZoneStats> GetStats();
+
+	// Writes every recorded zone to a file in the Chrome trace event format (open it in chrome://tracing).
+	bool WriteChromeTrace(const std::string& path, size_t& zonesWritten, std::string& error);
+
+	uint32_t GetDroppedCount() const { return dropped; }
+
+	static int64_t Now() { return ProfilerPlatform::Now(); }
+	int64_t GetFrequency() const { return frequency; }
+
+	// Gets a name for a code address (eg. a callback) like "ChatPlugin.dll+0x1234", since we don't have symbols.
+	static std::string DescribeAddress(const void* address);
+
+	// called by ProfileZone when a zone ends
+	void Record(uint32_t zone, int64_t start, int64_t end)
+	{
+		auto ring = currentRing;
+		if (!ring && !(ring = addThreadRing()))
+			return;
+
+		auto pos = ring->WritePos.load(std::memory_order_relaxed);
+		auto& sample = ring->Samples[pos & (RingSize - 1)];
+		sample.Zone = zone;
+		sample.Start = start;
+		sample.End = end;
+		ring->WritePos.store(pos + 1, std::memory_order_release);
+	}
+
+private:
+	struct Sample
+	{
+		uint32_t Zone;
+		int64_t Start; // Now() ticks
+		int64_t End;
+	};
+
+	// only written by the thread it belongs to
+	struct ThreadRing
+	{
+		uint32_t ThreadId;
+		std::atomic<size_t> WritePos; // total zones written
+		Sample Samples[RingSize];
+	};
+
+	// a sample along with the thread that recorded it, for the trace
+	struct ThreadSample
+	{
+		uint32_t ThreadId;
+		Sample Data;
+	};
+
+	std::atomic<bool> enabled;
+	std::atomic<int64_t> enabledTime; // zones that started before this are ignored
+	int64_t frequency; // Now() ticks per second
+
+	ThreadRing* rings[MaxThreads];
+	std::atomic<size_t> ringCount;
+	std::atomic<uint32_t> dropped; // zones from threads that didn't get a ring
+	std::mutex ringLock; // held while adding a ring
+	static PROFILER_THREAD_LOCAL ThreadRing* currentRing;
+	static PROFILER_THREAD_LOCAL bool currentThreadDropped; // there wasn't a ring left for this thread
+
+	std::mutex zoneLock;
+	std::vector<std::string> zoneNames; // indexed by zone ID
+	std::unordered_map<std::string, uint32_t> zoneIds;
+
+	ThreadRing* addThreadRing();
+	std::vector<ThreadSample> collect();
+};
+
+// times the scope it's in, eg. { ProfileZone zone(dorito.Profiler, someZoneId); ... }
+// costs a single flag check when the profiler isn't recording
+class ProfileZone
+{
+public:
+	ProfileZone(Profiler& profiler, uint32_t zone)
+		: profiler(profiler.IsEnabled() ? &profiler : nullptr), zone(zone), start(0)
+	{
+		if (this->profiler)
+			start = Profiler::Now();
+	}
+
+	~ProfileZone()
+	{
+		if (profiler)
+			profiler->Record(zone, start, Profiler::Now());
+	}
+
+private:
+	Profiler* profiler;
+	uint32_t zone;
+	int64_t start;
+
+	ProfileZone(const ProfileZone&);
+	ProfileZone& operator=(const ProfileZone&);
+};
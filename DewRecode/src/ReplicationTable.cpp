@@ -0,0 +1,54 @@
+#include "ReplicationTable.hpp"
+
+/// <summary>
+/// Adds a replicated variable, it's given a new generation since receivers that are already up to date still need to be sent it.
+/// </summary>
+/// <param name="variable">The variable to add.</param>
+void ReplicationTable::Add(Command* variable)
+{
+	if (Contains(variable))
+		return;
+
+	ReplicatedVariable replicated;
+	replicated.Variable = variable;
+	replicated.Generation = ++generation;
+	index[variable] = variables.size();
+	variables.push_back(replicated);
+}
+
+/// <summary>
+/// Called after a variable has been set, only bumps the generation if its value string isn't oldValue anymore.
+/// </summary>
+/// <param name="variable">The variable that was set.</param>
+/// <param name="oldValue">Its value string before it was set.</param>
+/// <returns>true if the variable is in the table and its value changed.</returns>
+bool ReplicationTable::Update(Command* variable, const std::string& oldValue)
+{
+	auto it = index.find(variable);
+	if (it == index.end() || variable->ValueString == oldValue)
+		return false;
+
+	variables[it->second].Generation = ++generation;
+	return true;
+}
+
+/// <summary>
+/// Gets the variables that changed after a generation, so only the differences have to be sent.
+/// </summary>
+/// <param name="sinceGeneration">The generation the receiver is up to date with, 0 to get every variable.</param>
+/// <param name="changed">Filled with the variables that changed, in the order they were added.</param>
+/// <returns>false if sinceGeneration is newer than the current generation (eg. it came from before a restart), changed is filled with every variable instead.</returns>
+bool ReplicationTable::GetChangedSince(unsigned int sinceGeneration, std::vector<ReplicatedVariable>& changed) const
+{
+	changed.clear();
+
+	auto valid = sinceGeneration <= generation;
+	if (!valid)
+		sinceGeneration = 0;
+
+	for (auto& variable : variables)
+		if (variable.Generation > sinceGeneration)
+			changed.push_back(variable);
+
+	return valid;
+}
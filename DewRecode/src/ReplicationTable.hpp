@@ -0,0 +1,22 @@
+#pragma once
+#include <ElDorito/ICommands.hpp>
+#include <unordered_map>
+
+// the replicated variables in the order they were added, with the generation each one last changed in
+// the generation is bumped whenever a variable is added or its value string changes, so anyone that's seen generation N only needs the variables that changed after it
+class ReplicationTable
+{
+public:
+	void Add(Command* variable);
+	bool Contains(Command* variable) const { return index.find(variable) != index.end(); }
+	bool Update(Command* variable, const std::string& oldValue);
+
+	unsigned int GetGeneration() const { return generation; }
+	size_t Size() const { return variables.size(); }
+	bool GetChangedSince(unsigned int sinceGeneration, std::vector<ReplicatedVariable>& changed) const;
+
+private:
+	std::vector<ReplicatedVariable> variables;
+	std::unordered_map<Command*, size_t> index; // variable -> index in variables
+	unsigned int generation = 0;
+};
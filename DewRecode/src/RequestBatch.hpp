@@ -0,0 +1,83 @@
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+// runs a batch of jobs (eg. the same request to each master server) on a small fixed set of worker threads, and waits for them up to a deadline
+// jobs that are still running at the deadline are left to finish on their own and their results thrown away, jobs that hadn't started by then never start
+// everything the workers touch is owned by them, so returning early is safe as long as the job function doesn't capture anything by reference
+template<class Result>
+std::vector<Result> RunBatch(size_t count, std::function<Result(size_t index)> job, size_t maxWorkers, std::chrono::milliseconds deadline, const Result& timedOut)
+{
+	struct State
+	{
+		std::mutex Lock;
+		std::condition_variable Finished;
+		std::function<Result(size_t)> Job;
+		std::vector<Result> Results;
+		std::vector<bool> Done;
+		size_t NextJob = 0;
+		size_t Remaining = 0;
+		bool Abandoned = false;
+	};
+
+	auto state = std::make_shared<State>();
+	state->Job = job;
+	state->Results.resize(count);
+	state->Done.resize(count, false);
+	state->Remaining = count;
+
+	auto worker = [state, count]()
+	{
+		for (;;)
+		{
+			size_t index;
+			{
+				std::lock_guard<std::mutex> guard(state->Lock);
+				if (state->Abandoned || state->NextJob == count)
+					return;
+				index = state->NextJob++;
+			}
+
+			auto result = state->Job(index);
+
+			std::lock_guard<std::mutex> guard(state->Lock);
+			if (state->Abandoned)
+				return;
+			state->Results[index] = result;
+			state->Done[index] = true;
+			if (--state->Remaining == 0)
+				state->Finished.notify_all();
+		}
+	};
+
+	size_t workers = 0;
+	for (; workers < maxWorkers && workers < count; workers++)
+	{
+		try
+		{
+			std::thread(worker).detach();
+		}
+		catch (const std::system_error&)
+		{
+			break;
+		}
+	}
+	if (workers == 0)
+		worker(); // couldn't start any threads, do it all ourselves
+
+	std::vector<Result> results;
+	std::unique_lock<std::mutex> guard(state->Lock);
+	state->Finished.wait_for(guard, deadline, [&]() { return state->Remaining == 0; });
+	state->Abandoned = true;
+
+	results.reserve(count);
+	for (size_t i = 0; i < count; i++)
+		results.push_back(state->Done[i] ? state->Results[i] : timedOut);
+	return results;
+}
@@ -0,0 +1,288 @@
+#include "ServerConnect.hpp"
+#include <cstdlib>
+#include <cstring>
+#include <rapidjson/document.h>
+
+namespace
+{
+	int HexValue(char c)
+	{
+		if (c >= '0' && c <= '9')
+			return c - '0';
+		if (c >= 'a' && c <= 'f')
+			return c - 'a' + 10;
+		if (c >= 'A' && c <= 'F')
+			return c - 'A' + 10;
+		return -1;
+	}
+
+	// decodes exactly length bytes of hex, false if it's the wrong length or isn't hex
+	bool ParseHex(const std::string& str, uint8_t* data, size_t length)
+	{
+		if (str.length() != length * 2)
+			return false;
+
+		for (size_t i = 0; i < length; i++)
+		{
+			auto high = HexValue(str[i * 2]);
+			auto low = HexValue(str[i * 2 + 1]);
+			if (high < 0 || low < 0)
+				return false;
+			data[i] = (uint8_t)((high << 4) | low);
+		}
+		return true;
+	}
+}
+
+/// <summary>
+/// Splits a Server.Connect address into the host and the info server port.
+/// </summary>
+/// <param name="address">host or host:port.</param>
+/// <param name="host">Returns the host.</param>
+/// <param name="port">Returns the port, ServerConnector::DefaultHttpPort if there isn't one.</param>
+/// <returns>false if the port is invalid.</returns>
+bool ParseConnectAddress(const std::string& address, std::string& host, int& port)
+{
+	host = address;
+	port = ServerConnector::DefaultHttpPort;
+
+	auto portOffset = address.find(':');
+	if (portOffset != std::string::npos && portOffset + 1 < address.size())
+	{
+		port = atoi(address.c_str() + portOffset + 1);
+		host = address.substr(0, portOffset);
+	}
+	return !host.empty() && port > 0 && port <= 0xFFFF;
+}
+
+/// <summary>
+/// Validates a servers info server response.
+/// </summary>
+/// <param name="responseHeader">The response header, starting with the status line.</param>
+/// <param name="body">The response body.</param>
+/// <param name="info">Returns what the server told us.</param>
+/// <param name="error">Returns the reason the response isn't valid.</param>
+/// <returns>true if the response is valid.</returns>
+bool ParseServerInfo(const std::string& responseHeader, const std::string& body, ServerInfo& info, std::string& error)
+{
+	// make sure the server replied with 200 OK
+	const std::string expected = "HTTP/1.1 200 OK";
+	if (responseHeader.length() < expected.length())
+	{
+		error = "Invalid server query response.";
+		return false;
+	}
+	if (responseHeader.compare(0, expected.length(), expected) != 0)
+	{
+		error = "Invalid server query header response.";
+		return false;
+	}
+
+	rapidjson::Document json;
+	if (json.Parse<0>(body.c_str()).HasParseError() || !json.IsObject())
+	{
+		error = "Invalid server query JSON response.";
+		return false;
+	}
+
+	// make sure the json has all the members we need
+	if (!json.HasMember("gameVersion") || !json["gameVersion"].IsString() ||
+		!json.HasMember("eldewritoVersion") || !json["eldewritoVersion"].IsString() ||
+		!json.HasMember("port") || !json["port"].IsInt())
+	{
+		error = "Server query JSON response is missing data.";
+		return false;
+	}
+
+	// only sent to clients that gave the right password (or when there isn't one)
+	if (!json.HasMember("xnkid") || !json["xnkid"].IsString() ||
+		!json.HasMember("xnaddr") || !json["xnaddr"].IsString())
+	{
+		error = "Incorrect password specified.";
+		return false;
+	}
+
+	auto port = json["port"].GetInt();
+	if (port <= 0 || port > 0xFFFF)
+	{
+		error = "Server query port is invalid.";
+		return false;
+	}
+
+	if (!ParseHex(json["xnkid"].GetString(), info.XnetInfo, 0x10) || !ParseHex(json["xnaddr"].GetString(), info.XnetInfo + 0x10, 0x10))
+	{
+		error = "Server query XNet info is invalid.";
+		return false;
+	}
+
+	info.GameVersion = json["gameVersion"].GetString();
+	info.EldewritoVersion = json["eldewritoVersion"].GetString();
+	info.GamePort = (uint16_t)port;
+	return true;
+}
+
+/// <summary>
+/// Checks that a server is running the same versions as us.
+/// </summary>
+/// <param name="info">What the server told us.</param>
+/// <param name="gameVersion">Our game version.</param>
+/// <param name="eldewritoVersion">Our ElDewrito version.</param>
+/// <param name="error">Returns the reason we can't join the server.</param>
+/// <returns>true if we can join the server.</returns>
+bool CheckServerVersion(const ServerInfo& info, const std::string& gameVersion, const std::string& eldewritoVersion, std::string& error)
+{
+	if (info.GameVersion != gameVersion)
+	{
+		error = "Server is running a different game version.";
+		return false;
+	}
+	if (info.EldewritoVersion != eldewritoVersion)
+	{
+		error = "Server is running a different ElDewrito version.";
+		return false;
+	}
+	return true;
+}
+
+/// <summary>
+/// Looks up a host in the cache.
+/// </summary>
+/// <param name="host">The host.</param>
+/// <param name="now">The current time.</param>
+/// <param name="address">Returns the hosts address.</param>
+/// <returns>false if the host isn't cached or its entry expired.</returns>
+bool DnsCache::Lookup(const std::string& host, uint32_t now, uint32_t& address)
+{
+	auto it = entries.find(host);
+	if (it == entries.end())
+		return false;
+
+	if ((int32_t)(it->second.ExpireTime - now) <= 0)
+	{
+		entries.erase(it);
+		return false;
+	}
+
+	address = it->second.Address;
+	return true;
+}
+
+void DnsCache::Add(const std::string& host, uint32_t address, uint32_t now)
+{
+	Entry entry = { address, now + TtlMs };
+	entries[host] = entry;
+}
+
+ServerConnector::ServerConnector(ConnectEnvironment& environment)
+	: environment(environment)
+{
+	currentId = 0;
+}
+
+/// <summary>
+/// Starts a new attempt, cancelling the current one, the caller has to hand it to Run on a worker thread.
+/// </summary>
+/// <param name="address">host or host:port of the servers info server.</param>
+/// <param name="password">The server password, can be empty.</param>
+/// <param name="error">Returns the reason the attempt couldn't be started.</param>
+/// <returns>The attempt, or null if the address is invalid.</returns>
+std::shared_ptr<ConnectAttempt> ServerConnector::Start(const std::string& address, const std::string& password, std::string& error)
+{
+	auto attempt = std::make_shared<ConnectAttempt>();
+	attempt->Address = address;
+	attempt->Password = password;
+	if (!ParseConnectAddress(address, attempt->Host, attempt->HttpPort))
+	{
+		error = "Invalid port.";
+		return nullptr;
+	}
+
+	attempt->StartTime = environment.GetTime();
+
+	std::lock_guard<std::mutex> lock(resultLock);
+	attempt->Id = ++currentId;
+	pending = attempt;
+	result = nullptr;
+	return attempt;
+}
+
+/// <summary>
+/// Looks up the host and queries the server, blocks until both are done so it has to be run on a worker thread.
+/// </summary>
+/// <param name="attempt">The attempt from Start, nothing else can touch it until it's been returned from Poll.</param>
+void ServerConnector::Run(const std::shared_ptr<ConnectAttempt>& attempt)
+{
+	uint32_t address = 0;
+	bool cached;
+	{
+		std::lock_guard<std::mutex> lock(dnsLock);
+		cached = dns.Lookup(attempt->Host, environment.GetTime(), address);
+	}
+
+	attempt->Succeeded = cached || environment.ResolveHost(attempt->Host, address, attempt->Error);
+	if (attempt->Succeeded && !cached)
+	{
+		std::lock_guard<std::mutex> lock(dnsLock);
+		dns.Add(attempt->Host, address, environment.GetTime());
+	}
+	attempt->IpAddress = address;
+
+	if (attempt->Id != currentId)
+		return; // cancelled while we were looking it up, don't bother querying
+
+	if (attempt->Succeeded)
+	{
+		std::string header;
+		std::string body;
+		attempt->Succeeded = environment.QueryInfo(attempt->Host, attempt->HttpPort, attempt->Password, header, body, attempt->Error) &&
+			ParseServerInfo(header, body, attempt->Info, attempt->Error);
+	}
+
+	std::lock_guard<std::mutex> lock(resultLock);
+	if (attempt->Id == currentId)
+	{
+		result = attempt;
+		pending = nullptr;
+	}
+}
+
+/// <summary>
+/// Cancels the current attempt, whatever it's waiting on carries on in the background but its result is thrown away.
+/// </summary>
+void ServerConnector::Cancel()
+{
+	std::lock_guard<std::mutex> lock(resultLock);
+	currentId++;
+	pending = nullptr;
+	result = nullptr;
+}
+
+/// <summary>
+/// Gets the result of the current attempt, if it's finished or timed out.
+/// </summary>
+/// <returns>The finished attempt, or null if there isn't one yet.</returns>
+std::shared_ptr<const ConnectAttempt> ServerConnector::Poll()
+{
+	std::lock_guard<std::mutex> lock(resultLock);
+	if (result)
+	{
+		auto finished = result;
+		result = nullptr;
+		return finished;
+	}
+
+	if (!pending || environment.GetTime() - pending->StartTime < TimeoutMs)
+		return nullptr;
+
+	// the worker still owns the attempt, so hand back a copy of what the game thread set up
+	auto timedOut = std::make_shared<ConnectAttempt>();
+	timedOut->Id = pending->Id;
+	timedOut->Address = pending->Address;
+	timedOut->Host = pending->Host;
+	timedOut->HttpPort = pending->HttpPort;
+	timedOut->StartTime = pending->StartTime;
+	timedOut->Error = "Timed out querying " + pending->Address + ".";
+	currentId++;
+	pending = nullptr;
+	return timedOut;
+}
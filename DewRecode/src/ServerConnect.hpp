@@ -0,0 +1,94 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+// what ServerConnector needs from the OS, ModuleServer passes in one that uses getaddrinfo and WinHttp and the tests use a stand-in server
+class ConnectEnvironment
+{
+public:
+	virtual ~ConnectEnvironment() { }
+
+	virtual uint32_t GetTime() = 0; // milliseconds, can wrap
+	virtual bool ResolveHost(const std::string& host, uint32_t& address, std::string& error) = 0; // ipv4 address in host byte order
+	virtual bool QueryInfo(const std::string& host, int port, const std::string& password, std::string& responseHeader, std::string& body, std::string& error) = 0;
+};
+
+// what a server told us about itself
+struct ServerInfo
+{
+	uint16_t GamePort = 0;
+	std::string GameVersion;
+	std::string EldewritoVersion;
+	uint8_t XnetInfo[0x20]; // xnkid then xnaddr
+};
+
+bool ParseConnectAddress(const std::string& address, std::string& host, int& port);
+bool ParseServerInfo(const std::string& responseHeader, const std::string& body, ServerInfo& info, std::string& error);
+bool CheckServerVersion(const ServerInfo& info, const std::string& gameVersion, const std::string& eldewritoVersion, std::string& error);
+
+// hosts we've looked up recently, times are from a clock that can wrap
+class DnsCache
+{
+public:
+	static const uint32_t TtlMs = 5 * 60 * 1000;
+
+	bool Lookup(const std::string& host, uint32_t now, uint32_t& address);
+	void Add(const std::string& host, uint32_t address, uint32_t now);
+
+private:
+	struct Entry
+	{
+		uint32_t Address;
+		uint32_t ExpireTime;
+	};
+
+	std::map<std::string, Entry> entries;
+};
+
+struct ConnectAttempt
+{
+	unsigned int Id = 0;
+	std::string Address; // as it was passed to Server.Connect
+	std::string Host;
+	int HttpPort = 0;
+	std::string Password;
+	uint32_t StartTime = 0;
+
+	// filled in by the worker thread
+	bool Succeeded = false;
+	std::string Error;
+	uint32_t IpAddress = 0;
+	ServerInfo Info;
+};
+
+// Server.Connect's lookup + server query: the game thread starts an attempt, a worker thread runs it and the game thread polls for the result
+// starting a new attempt or cancelling throws away the result of the one before it, and an attempt that takes longer than TimeoutMs is given up on
+// (the worker can't be interrupted, it finishes in the background and its result is ignored)
+class ServerConnector
+{
+public:
+	static const int DefaultHttpPort = 11784;
+	static const uint32_t TimeoutMs = 15 * 1000; // the WinHttp timeouts are 5s for each step, this covers the lookup and all of them
+
+	explicit ServerConnector(ConnectEnvironment& environment);
+
+	std::shared_ptr<ConnectAttempt> Start(const std::string& address, const std::string& password, std::string& error);
+	void Run(const std::shared_ptr<ConnectAttempt>& attempt);
+	void Cancel();
+	std::shared_ptr<const ConnectAttempt> Poll();
+
+private:
+	ConnectEnvironment& environment;
+	std::atomic<unsigned int> currentId; // bumped for each attempt (and on cancel), results from older attempts get thrown away
+
+	std::mutex resultLock; // guards pending and result
+	std::shared_ptr<const ConnectAttempt> pending; // the attempt that's running, to time it out
+	std::shared_ptr<const ConnectAttempt> result; // finished attempt waiting for the game thread to pick it up
+
+	std::mutex dnsLock;
+	DnsCache dns;
+};
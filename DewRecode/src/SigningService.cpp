@@ -0,0 +1,333 @@
+#include "SigningService.hpp"
+#include <system_error>
+
+#include <openssl/evp.h>
+#include <openssl/rsa.h>
+#include <openssl/pem.h>
+#include <openssl/sha.h>
+
+namespace
+{
+	std::string Base64Encode(const unsigned char* data, size_t length)
+	{
+		std::string encoded(((length + 2) / 3) * 4 + 1, '\0'); // EVP_EncodeBlock adds a null terminator
+		auto encodedLength = EVP_EncodeBlock(reinterpret_cast<unsigned char*>(&encoded[0]), data, (int)length);
+		encoded.resize(encodedLength);
+		return encoded;
+	}
+
+	bool Base64Decode(const std::string& encoded, std::vector<unsigned char>& data)
+	{
+		if (encoded.empty() || encoded.length() % 4 != 0)
+			return false;
+
+		data.resize(encoded.length() / 4 * 3);
+		auto length = EVP_DecodeBlock(data.data(), reinterpret_cast<const unsigned char*>(encoded.c_str()), (int)encoded.length());
+		if (length < 0)
+			return false;
+
+		// EVP_DecodeBlock counts the padding as zero bytes
+		if (encoded[encoded.length() - 1] == '=')
+			length--;
+		if (encoded[encoded.length() - 2] == '=')
+			length--;
+		data.resize(length);
+		return true;
+	}
+}
+
+SigningService::SigningService()
+{
+}
+
+SigningService::~SigningService()
+{
+	{
+		// Shutdown should have stopped the worker already, if it didn't we can't wait for it here since this runs while the DLL is unloading
+		std::lock_guard<std::mutex> lock(queueLock);
+		stopping = true;
+		queue.clear();
+		if (thread.joinable())
+			thread.detach();
+	}
+	queueCondition.notify_all();
+
+	// keys that are being used right now have their own reference, so they stay alive until they're done with
+	std::lock_guard<std::mutex> lock(cacheLock);
+	for (auto& key : cache)
+		RSA_free(key.Rsa);
+	cache.clear();
+}
+
+/// <summary>
+/// Stops the signing thread, throwing away anything that's still queued, must be called before the process starts exiting (not from DllMain).
+/// Waits for the job that's being signed to finish, so its callback doesn't run while everything's being torn down.
+/// </summary>
+void SigningService::Shutdown()
+{
+	{
+		std::lock_guard<std::mutex> lock(queueLock);
+		stopping = true;
+		queue.clear();
+	}
+	queueCondition.notify_all();
+
+	if (thread.joinable())
+		thread.join();
+}
+
+/// <summary>
+/// Signs data with a private key.
+/// </summary>
+/// <param name="privateKey">The private key, with the -----RSA PRIVATE KEY----- header/footer and newlines after every 64 chars (see RSAReformatKey).</param>
+/// <param name="data">The data to sign.</param>
+/// <param name="dataSize">The size of the data.</param>
+/// <param name="signature">Filled with the Base64 signature.</param>
+/// <returns>true if the data was signed.</returns>
+bool SigningService::Sign(const std::string& privateKey, const void* data, size_t dataSize, std::string& signature)
+{
+	auto rsa = getKey(privateKey, true);
+	if (!rsa)
+		return false;
+
+	bool signedData = signWithKey(rsa, data, dataSize, signature);
+	RSA_free(rsa);
+	return signedData;
+}
+
+/// <summary>
+/// Checks a signature made by Sign.
+/// </summary>
+/// <param name="pubKey">The public key, with the -----PUBLIC KEY----- header/footer and newlines after every 64 chars.</param>
+/// <param name="signature">The Base64 signature.</param>
+/// <param name="data">The data that was signed.</param>
+/// <param name="dataSize">The size of the data.</param>
+/// <returns>true if the signature is valid.</returns>
+bool SigningService::Verify(const std::string& pubKey, const std::string& signature, const void* data, size_t dataSize)
+{
+	auto rsa = getKey(pubKey, false);
+	if (!rsa)
+		return false;
+
+	bool valid = verifyWithKey(rsa, signature, data, dataSize);
+	RSA_free(rsa);
+	return valid;
+}
+
+/// <summary>
+/// Signs a batch of data with the same private key.
+/// </summary>
+/// <param name="privateKey">The private key, formatted the same as for Sign.</param>
+/// <param name="data">The data to sign.</param>
+/// <param name="signatures">Filled with the Base64 signature for each item in data, in the same order.</param>
+/// <returns>true if every item was signed.</returns>
+bool SigningService::SignBatch(const std::string& privateKey, const std::vector<std::string>& data, std::vector<std::string>& signatures)
+{
+	signatures.clear();
+	signatures.resize(data.size());
+
+	auto rsa = getKey(privateKey, true);
+	if (!rsa)
+		return false;
+
+	bool allSigned = true;
+	for (size_t i = 0; i < data.size(); i++)
+		allSigned = signWithKey(rsa, data[i].c_str(), data[i].length(), signatures[i]) && allSigned;
+
+	RSA_free(rsa);
+	return allSigned;
+}
+
+/// <summary>
+/// Checks a batch of signatures made with the same key.
+/// </summary>
+/// <param name="pubKey">The public key, formatted the same as for Verify.</param>
+/// <param name="data">The data that was signed.</param>
+/// <param name="signatures">The Base64 signature for each item in data.</param>
+/// <param name="results">Filled with whether each signature is valid, in the same order as data.</param>
+/// <returns>The number of valid signatures.</returns>
+size_t SigningService::VerifyBatch(const std::string& pubKey, const std::vector<std::string>& data, const std::vector<std::string>& signatures, std::vector<bool>& results)
+{
+	results.assign(data.size(), false);
+	if (signatures.size() != data.size())
+		return 0;
+
+	auto rsa = getKey(pubKey, false);
+	if (!rsa)
+		return 0;
+
+	size_t numValid = 0;
+	for (size_t i = 0; i < data.size(); i++)
+	{
+		results[i] = verifyWithKey(rsa, signatures[i], data[i].c_str(), data[i].length());
+		if (results[i])
+			numValid++;
+	}
+
+	RSA_free(rsa);
+	return numValid;
+}
+
+/// <summary>
+/// Queues data to be signed on the signing thread.
+/// </summary>
+/// <param name="privateKey">The private key, formatted the same as for Sign.</param>
+/// <param name="data">The data to sign.</param>
+/// <param name="callback">Called on the signing thread once the data has been signed (or signing failed).</param>
+/// <returns>false if the queue is full or the signing thread couldn't be started, the callback won't be called.</returns>
+bool SigningService::QueueSign(const std::string& privateKey, const std::string& data, SignCallback callback)
+{
+	{
+		std::lock_guard<std::mutex> lock(queueLock);
+		if (stopping || queue.size() >= MaxQueuedJobs)
+			return false;
+
+		if (!thread.joinable())
+		{
+			try
+			{
+				thread = std::thread(&SigningService::runWorker, this);
+			}
+			catch (const std::system_error&)
+			{
+				return false;
+			}
+		}
+
+		SignJob job;
+		job.PrivateKey = privateKey;
+		job.Data = data;
+		job.Callback = callback;
+		queue.push_back(job);
+	}
+	queueCondition.notify_one();
+	return true;
+}
+
+/// <summary>
+/// Gets a key from the cache, parsing it and adding it if it's not there yet.
+/// </summary>
+/// <param name="pem">The key in PEM format.</param>
+/// <param name="isPrivate">Whether the key is a private key.</param>
+/// <returns>The key with a reference held for the caller (release it with RSA_free), or NULL if the key couldn't be parsed.</returns>
+rsa_st* SigningService::getKey(const std::string& pem, bool isPrivate)
+{
+	{
+		std::lock_guard<std::mutex> lock(cacheLock);
+		for (auto& key : cache)
+		{
+			if (key.IsPrivate == isPrivate && key.Pem == pem)
+			{
+				key.LastUsed = ++useCounter;
+				RSA_up_ref(key.Rsa);
+				return key.Rsa;
+			}
+		}
+	}
+
+	// parse it without holding the lock, it's the slow part
+	BIO* keyBuff = BIO_new_mem_buf((void*)pem.c_str(), pem.length());
+	if (!keyBuff)
+		return NULL;
+
+	RSA* rsa = isPrivate ? PEM_read_bio_RSAPrivateKey(keyBuff, 0, 0, 0) : PEM_read_bio_RSA_PUBKEY(keyBuff, 0, 0, 0);
+	BIO_free_all(keyBuff);
+	if (!rsa)
+		return NULL;
+
+	std::lock_guard<std::mutex> lock(cacheLock);
+
+	// another thread might have added it while we were parsing
+	for (auto& key : cache)
+	{
+		if (key.IsPrivate == isPrivate && key.Pem == pem)
+		{
+			RSA_free(rsa);
+			key.LastUsed = ++useCounter;
+			RSA_up_ref(key.Rsa);
+			return key.Rsa;
+		}
+	}
+
+	// make room by dropping the least recently used key, anyone still using it has their own reference
+	if (cache.size() >= MaxCachedKeys)
+	{
+		size_t oldest = 0;
+		for (size_t i = 1; i < cache.size(); i++)
+		{
+			if (cache[i].LastUsed < cache[oldest].LastUsed)
+				oldest = i;
+		}
+		RSA_free(cache[oldest].Rsa);
+		cache.erase(cache.begin() + oldest);
+	}
+
+	CachedKey key;
+	key.Pem = pem;
+	key.IsPrivate = isPrivate;
+	key.Rsa = rsa;
+	key.LastUsed = ++useCounter;
+	cache.push_back(key);
+
+	RSA_up_ref(rsa); // one reference for the cache, one for the caller
+	return rsa;
+}
+
+bool SigningService::signWithKey(rsa_st* rsa, const void* data, size_t dataSize, std::string& signature)
+{
+	unsigned char hash[SHA256_DIGEST_LENGTH];
+	SHA256_CTX sha;
+	SHA256_Init(&sha);
+	SHA256_Update(&sha, data, dataSize);
+	SHA256_Final(hash, &sha);
+
+	std::vector<unsigned char> sig(RSA_size(rsa));
+	unsigned int sigLength = 0;
+	if (RSA_sign(NID_sha256, hash, SHA256_DIGEST_LENGTH, sig.data(), &sigLength, rsa) != 1)
+		return false;
+
+	signature = Base64Encode(sig.data(), sigLength);
+	return true;
+}
+
+bool SigningService::verifyWithKey(rsa_st* rsa, const std::string& signature, const void* data, size_t dataSize)
+{
+	std::vector<unsigned char> sig;
+	if (!Base64Decode(signature, sig) || sig.empty())
+		return false;
+
+	unsigned char hash[SHA256_DIGEST_LENGTH];
+	SHA256_CTX sha;
+	SHA256_Init(&sha);
+	SHA256_Update(&sha, data, dataSize);
+	SHA256_Final(hash, &sha);
+
+	return RSA_verify(NID_sha256, hash, SHA256_DIGEST_LENGTH, sig.data(), sig.size(), rsa) == 1;
+}
+
+/// <summary>
+/// Signing thread, waits for jobs and runs them one at a time.
+/// </summary>
+void SigningService::runWorker()
+{
+	while (true)
+	{
+		SignJob job;
+		{
+			std::unique_lock<std::mutex> lock(queueLock);
+			while (queue.empty() && !stopping)
+				queueCondition.wait(lock);
+
+			if (stopping)
+				return;
+
+			job = queue.front();
+			queue.pop_front();
+		}
+
+		std::string signature;
+		bool signedData = Sign(job.PrivateKey, job.Data.c_str(), job.Data.length(), signature);
+		if (job.Callback)
+			job.Callback(signedData, signature);
+	}
+}
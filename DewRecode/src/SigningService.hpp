@@ -0,0 +1,67 @@
+#pragma once
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct rsa_st;
+
+// signs and verifies data with RSA keys (over a SHA256 digest, same as RSACreateSignature/RSAVerifySignature always did)
+// parsed keys are cached, so the PEM/Base64 decoding only happens the first time a key is used instead of on every signature
+// signing can also be queued to a worker thread, the queue is bounded so a burst of requests can't pile up without limit
+class SigningService
+{
+public:
+	static const size_t MaxCachedKeys = 8;
+	static const size_t MaxQueuedJobs = 32;
+
+	typedef std::function<void(bool succeeded, const std::string& signature)> SignCallback; // called on the signing thread
+
+	SigningService();
+	~SigningService();
+
+	void Shutdown();
+
+	bool Sign(const std::string& privateKey, const void* data, size_t dataSize, std::string& signature);
+	bool Verify(const std::string& pubKey, const std::string& signature, const void* data, size_t dataSize);
+
+	bool SignBatch(const std::string& privateKey, const std::vector<std::string>& data, std::vector<std::string>& signatures);
+	size_t VerifyBatch(const std::string& pubKey, const std::vector<std::string>& data, const std::vector<std::string>& signatures, std::vector<bool>& results);
+
+	bool QueueSign(const std::string& privateKey, const std::string& data, SignCallback callback);
+
+private:
+	struct CachedKey
+	{
+		std::string Pem;
+		bool IsPrivate;
+		rsa_st* Rsa;
+		unsigned int LastUsed;
+	};
+
+	struct SignJob
+	{
+		std::string PrivateKey;
+		std::string Data;
+		SignCallback Callback;
+	};
+
+	std::mutex cacheLock; // guards cache and useCounter
+	std::vector<CachedKey> cache;
+	unsigned int useCounter = 0;
+
+	std::mutex queueLock; // guards everything below
+	std::condition_variable queueCondition;
+	std::deque<SignJob> queue;
+	std::thread thread;
+	bool stopping = false;
+
+	rsa_st* getKey(const std::string& pem, bool isPrivate);
+	bool signWithKey(rsa_st* rsa, const void* data, size_t dataSize, std::string& signature);
+	bool verifyWithKey(rsa_st* rsa, const std::string& signature, const void* data, size_t dataSize);
+
+	void runWorker();
+};
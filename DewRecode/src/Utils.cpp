@@ -7,6 +7,8 @@
 #include <cctype>
 #include <codecvt>
 #include <iomanip>
+#include <memory>
+#include <mutex>
 #include <winhttp.h>
 #include <Natupnp.h>
 
@@ -14,6 +16,7 @@
 #include <miniupnpc/miniupnpc.h>
 #include <miniupnpc/upnpcommands.h>
 
+#include <openssl/crypto.h>
 #include <openssl/rsa.h>
 #include <openssl/bn.h>
 #include <openssl/pem.h>
@@ -27,6 +30,17 @@ static const std::string base64_chars =
 			"0123456789+/";
 
 
+// OpenSSL 1.0 isn't thread safe unless it's given locks to use, and keys get generated/used off the game thread
+static std::unique_ptr<std::mutex[]> openSslLocks;
+
+static void OpenSslLockingCallback(int mode, int n, const char* file, int line)
+{
+	if (mode & CRYPTO_LOCK)
+		openSslLocks[n].lock();
+	else
+		openSslLocks[n].unlock();
+}
+
 static inline bool is_base64(unsigned char c) {
 	return (isalnum(c) || (c == '+') || (c == '/'));
 }
@@ -55,65 +69,30 @@ bool PublicUtils::RSACreateSignature(const std::string& privateKey, void* data,
 {
 	// privateKey has to be reformatted with -----RSA PRIVATE KEY----- header/footer and newlines after every 64 chars
 	// before calling this function
-
-	BIO* privKeyBuff = BIO_new_mem_buf((void*)privateKey.c_str(), privateKey.length());
-	if (!privKeyBuff)
-		return false;
-
-	RSA* rsa = PEM_read_bio_RSAPrivateKey(privKeyBuff, 0, 0, 0);
-	if (!rsa)
-		return false;
-
-	unsigned char hash[SHA256_DIGEST_LENGTH];
-	SHA256_CTX sha;
-	SHA256_Init(&sha);
-	SHA256_Update(&sha, data, dataSize);
-	SHA256_Final(hash, &sha);
-
-	void* sigret = malloc(RSA_size(rsa));
-	unsigned int siglen = 0;
-	int retVal = RSA_sign(NID_sha256, (unsigned char*)hash, SHA256_DIGEST_LENGTH, (unsigned char*)sigret, &siglen, rsa);
-
-	RSA_free(rsa);
-	BIO_free_all(privKeyBuff);
-
-	if (retVal != 1)
-		return false;
-
-	signature = Base64Encode((unsigned char*)sigret, siglen);
-	return true;
+	return signing.Sign(privateKey, data, dataSize, signature);
 }
 
 bool PublicUtils::RSAVerifySignature(const std::string& pubKey, const std::string& signature, void* data, size_t dataSize)
 {
-	BIO* pubKeyBuff = BIO_new_mem_buf((void*)pubKey.c_str(), pubKey.length());
-	if (!pubKeyBuff)
-		return false;
-
-	RSA* rsa = PEM_read_bio_RSA_PUBKEY(pubKeyBuff, 0, 0, 0);
-	if (!rsa)
-		return false;
-
-	unsigned char hash[SHA256_DIGEST_LENGTH];
-	SHA256_CTX sha;
-	SHA256_Init(&sha);
-	SHA256_Update(&sha, data, dataSize);
-	SHA256_Final(hash, &sha);
-
-	size_t length = 0;
-	if (Base64DecodeBinary((char*)signature.c_str(), NULL, &length) != 1 || length == 0)
-		return false;
+	return signing.Verify(pubKey, signature, data, dataSize);
+}
 
-	unsigned char* sigBuf = (unsigned char*)malloc(length);
-	if (Base64DecodeBinary((char*)signature.c_str(), sigBuf, &length) != 0)
-		return false;
+bool PublicUtils::RSACreateSignatures(const std::string& privateKey, const std::vector<std::string>& data, std::vector<std::string>& signatures)
+{
+	return signing.SignBatch(privateKey, data, signatures);
+}
 
-	int retVal = RSA_verify(NID_sha256, (unsigned char*)hash, SHA256_DIGEST_LENGTH, sigBuf, length, rsa);
-	free(sigBuf);
-	RSA_free(rsa);
-	BIO_free_all(pubKeyBuff);
+size_t PublicUtils::RSAVerifySignatures(const std::string& pubKey, const std::vector<std::string>& data, const std::vector<std::string>& signatures, std::vector<bool>& results)
+{
+	return signing.VerifyBatch(pubKey, data, signatures, results);
+}
 
-	return retVal == 1;
+bool PublicUtils::RSAQueueSignature(const std::string& privateKey, const std::string& data, SignatureCallback callback, void* param)
+{
+	return signing.QueueSign(privateKey, data, [callback, param](bool succeeded, const std::string& signature)
+	{
+		callback(succeeded, signature, param);
+	});
 }
 
 static int genrsa_cb(int p, int n, BN_GENCB* cb)
@@ -671,6 +650,22 @@ HttpRequest PublicUtils::HttpSendRequest(const std::wstring& uri, const std::wst
 	return retVal;
 }
 
+/// <summary>
+/// Sends a HTTP request over a shared session that keeps connections to each host alive between requests.
+/// </summary>
+HttpRequest PublicUtils::HttpSendPooledRequest(const std::wstring& uri, const std::wstring& method, const std::wstring& userAgent, const std::wstring& headers, void* body, DWORD bodySize)
+{
+	return httpPool.SendRequest(uri, method, userAgent, headers, body, bodySize);
+}
+
+/// <summary>
+/// Sends the same request to multiple URIs at once, and waits for them to finish (up to a deadline).
+/// </summary>
+std::vector<HttpRequest> PublicUtils::HttpSendPooledRequests(const std::vector<std::wstring>& uris, const std::wstring& method, const std::wstring& userAgent, const std::wstring& headers, void* body, DWORD bodySize)
+{
+	return httpPool.SendRequests(uris, method, userAgent, headers, body, bodySize);
+}
+
 UPnPResult PublicUtils::UPnPForwardPort(bool tcp, int externalport, int internalport, const std::string& ruleName)
 {
 	struct UPNPUrls urls;
@@ -702,6 +697,13 @@ PublicUtils::PublicUtils()
 	WSADATA wsaData;
 
 	WSAStartup(MAKEWORD(2, 0), &wsaData);
+
+	if (!CRYPTO_get_locking_callback())
+	{
+		openSslLocks.reset(new std::mutex[CRYPTO_num_locks()]);
+		CRYPTO_set_locking_callback(OpenSslLockingCallback);
+	}
+
 	// do the discovery in the constructor (ie. when the game starts)
 	upnpDevice = upnpDiscover(2000, NULL, NULL, 0, 0, &upnpDiscoverError);
 }
@@ -710,4 +712,12 @@ PublicUtils::~PublicUtils()
 {
 	if (upnpDevice)
 		freeUPNPDevlist(upnpDevice);
+}
+
+/// <summary>
+/// Stops the signing thread, see ElDorito::Shutdown.
+/// </summary>
+void PublicUtils::Shutdown()
+{
+	signing.Shutdown();
 }
\ No newline at end of file
@@ -1,5 +1,7 @@
 #pragma once
 #include <ElDorito/ElDorito.hpp>
+#include "HttpPool.hpp"
+#include "SigningService.hpp"
 
 // can't be called Utils because we use that for a namespace.. ugh
 class PublicUtils : public IUtils
@@ -34,9 +36,20 @@ public:
 	HttpRequest HttpSendRequest(const std::wstring& uri, const std::wstring& method, const std::wstring& userAgent, const std::wstring& username, const std::wstring& password, const std::wstring& headers, void* body, DWORD bodySize);
 	UPnPResult UPnPForwardPort(bool tcp, int externalport, int internalport, const std::string& ruleName);
 
+	HttpRequest HttpSendPooledRequest(const std::wstring& uri, const std::wstring& method, const std::wstring& userAgent, const std::wstring& headers, void* body, DWORD bodySize);
+	std::vector<HttpRequest> HttpSendPooledRequests(const std::vector<std::wstring>& uris, const std::wstring& method, const std::wstring& userAgent, const std::wstring& headers, void* body, DWORD bodySize);
+
+	bool RSACreateSignatures(const std::string& privateKey, const std::vector<std::string>& data, std::vector<std::string>& signatures);
+	size_t RSAVerifySignatures(const std::string& pubKey, const std::vector<std::string>& data, const std::vector<std::string>& signatures, std::vector<bool>& results);
+	bool RSAQueueSignature(const std::string& privateKey, const std::string& data, SignatureCallback callback, void* param);
+
 	PublicUtils();
 	~PublicUtils();
+
+	void Shutdown();
 private:
 	int upnpDiscoverError;
 	struct UPNPDev* upnpDevice = nullptr;
+	HttpPool httpPool;
+	SigningService signing;
 };
\ No newline at end of file
@@ -0,0 +1,50 @@
+#include "DewritoConfig.hpp"
+#include <fstream>
+#include "ElDorito.hpp"
+
+uint32_t WinConfigEnvironment::GetTime()
+{
+	return GetTickCount();
+}
+
+/// <summary>
+/// Gets a files size and last write time.
+/// </summary>
+/// <param name="fileName">The file.</param>
+/// <param name="size">Returns the size of the file.</param>
+/// <param name="writeTime">Returns the last write time of the file, as a FILETIME.</param>
+/// <returns>false if the file doesn't exist.</returns>
+bool WinConfigEnvironment::GetFileInfo(const std::string& fileName, uint64_t& size, uint64_t& writeTime)
+{
+	WIN32_FILE_ATTRIBUTE_DATA attributes;
+	if (!GetFileAttributesExA(fileName.c_str(), GetFileExInfoStandard, &attributes))
+		return false;
+
+	size = ((uint64_t)attributes.nFileSizeHigh << 32) | attributes.nFileSizeLow;
+	writeTime = ((uint64_t)attributes.ftLastWriteTime.dwHighDateTime << 32) | attributes.ftLastWriteTime.dwLowDateTime;
+	return true;
+}
+
+/// <summary>
+/// Reads a whole file.
+/// </summary>
+/// <param name="fileName">The file.</param>
+/// <param name="contents">Returns the contents of the file.</param>
+/// <returns>false if the file couldn't be opened.</returns>
+bool WinConfigEnvironment::ReadFile(const std::string& fileName, std::string& contents)
+{
+	std::ifstream in(fileName, std::ios::in | std::ios::binary);
+	if (!in || !in.is_open())
+		return false;
+
+	in.seekg(0, std::ios::end);
+	contents.resize((unsigned int)in.tellg());
+	in.seekg(0, std::ios::beg);
+	in.read(&contents[0], contents.size());
+	return true;
+}
+
+void WinConfigEnvironment::Log(LogSeverity severity, const std::string& message)
+{
+	ElDorito::Instance().Logger.Log(severity, "DewritoConfig", "%s", message.c_str());
+}
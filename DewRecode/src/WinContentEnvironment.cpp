@@ -0,0 +1,138 @@
+#include "ContentIndexer.hpp"
+#include <Windows.h>
+#include <fstream>
+
+namespace
+{
+	uint64_t ToUInt64(DWORD high, DWORD low)
+	{
+		return (static_cast<uint64_t>(high) << 32) | low;
+	}
+}
+
+uint32_t WinContentEnvironment::GetTime()
+{
+	return GetTickCount();
+}
+
+/// <summary>
+/// Lists the files and subdirectories in a directory.
+/// </summary>
+/// <param name="dir">The directory.</param>
+/// <param name="entries">Filled with what's in the directory, along with the write time and size of each file.</param>
+void WinContentEnvironment::ListDirectory(const std::wstring& dir, std::vector<DirectoryEntry>& entries)
+{
+	WIN32_FIND_DATAW data;
+	auto find = FindFirstFileExW((dir + L"\\*").c_str(), FindExInfoBasic, &data, FindExSearchNameMatch, NULL, FIND_FIRST_EX_LARGE_FETCH);
+	if (find == INVALID_HANDLE_VALUE)
+		return;
+
+	do
+	{
+		if (!wcscmp(data.cFileName, L".") || !wcscmp(data.cFileName, L".."))
+			continue;
+
+		DirectoryEntry entry;
+		entry.Name = data.cFileName;
+		entry.IsDirectory = (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0;
+		entry.WriteTime = ToUInt64(data.ftLastWriteTime.dwHighDateTime, data.ftLastWriteTime.dwLowDateTime);
+		entry.Size = ToUInt64(data.nFileSizeHigh, data.nFileSizeLow);
+		entries.push_back(entry);
+	} while (FindNextFileW(find, &data));
+	FindClose(find);
+}
+
+/// <summary>
+/// Maps the start of a file and copies it out.
+/// </summary>
+/// <param name="path">The file.</param>
+/// <param name="length">The most to read.</param>
+/// <param name="data">Filled with the start of the file, this is shorter than length if the file is.</param>
+/// <returns>false if the file couldn't be read.</returns>
+bool WinContentEnvironment::ReadFileStart(const std::wstring& path, size_t length, std::vector<uint8_t>& data)
+{
+	auto file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(file, &size))
+	{
+		CloseHandle(file);
+		return false;
+	}
+	if (static_cast<uint64_t>(size.QuadPart) < length)
+		length = static_cast<size_t>(size.QuadPart);
+
+	data.clear();
+	if (length == 0)
+	{
+		CloseHandle(file);
+		return true; // can't map an empty file
+	}
+
+	// only the start of the file gets mapped
+	bool read = false;
+	auto mapping = CreateFileMappingW(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (mapping)
+	{
+		auto view = static_cast<const uint8_t*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, length));
+		if (view)
+		{
+			data.assign(view, view + length);
+			UnmapViewOfFile(view);
+			read = true;
+		}
+		CloseHandle(mapping);
+	}
+	CloseHandle(file);
+	return read;
+}
+
+/// <summary>
+/// Reads a whole file.
+/// </summary>
+/// <param name="path">The file.</param>
+/// <param name="data">Filled with the contents of the file.</param>
+/// <returns>false if the file couldn't be opened.</returns>
+bool WinContentEnvironment::ReadFile(const std::wstring& path, std::vector<uint8_t>& data)
+{
+	std::ifstream in(path, std::ios::in | std::ios::binary);
+	if (!in || !in.is_open())
+		return false;
+
+	in.seekg(0, std::ios::end);
+	data.resize((unsigned int)in.tellg());
+	in.seekg(0, std::ios::beg);
+	if (!data.empty())
+		in.read(reinterpret_cast<char*>(data.data()), data.size());
+	return true;
+}
+
+/// <summary>
+/// Writes to a temporary file and then swaps it in, so a crash halfway through can't leave a truncated file behind.
+/// </summary>
+/// <param name="path">The file.</param>
+/// <param name="data">What to write.</param>
+/// <returns>true if the file was written.</returns>
+bool WinContentEnvironment::ReplaceFile(const std::wstring& path, const std::vector<uint8_t>& data)
+{
+	auto tempName = path + L".tmp";
+	{
+		std::ofstream out(tempName, std::ios::out | std::ios::binary | std::ios::trunc);
+		if (out.fail())
+			return false;
+
+		out.write(reinterpret_cast<const char*>(data.data()), data.size());
+		out.flush();
+		if (out.fail())
+			return false;
+	}
+
+	if (!MoveFileExW(tempName.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH))
+	{
+		DeleteFileW(tempName.c_str());
+		return false;
+	}
+	return true;
+}
@@ -0,0 +1,82 @@
+#include "MapCatalog.hpp"
+#include <Windows.h>
+#include <fstream>
+
+namespace
+{
+	uint64_t ToUInt64(DWORD high, DWORD low)
+	{
+		return (static_cast<uint64_t>(high) << 32) | low;
+	}
+}
+
+void WinMapCatalogEnvironment::ListDirectory(const std::string& path, std::vector<DirectoryEntry>& entries)
+{
+	WIN32_FIND_DATAA data;
+	auto find = FindFirstFileA((path + "\\*").c_str(), &data);
+	if (find == INVALID_HANDLE_VALUE)
+		return;
+
+	do
+	{
+		if (!strcmp(data.cFileName, ".") || !strcmp(data.cFileName, ".."))
+			continue;
+
+		DirectoryEntry entry;
+		entry.Name = data.cFileName;
+		entry.IsDirectory = (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0;
+		entry.WriteTime = ToUInt64(data.ftLastWriteTime.dwHighDateTime, data.ftLastWriteTime.dwLowDateTime);
+		entry.Size = ToUInt64(data.nFileSizeHigh, data.nFileSizeLow);
+		entries.push_back(entry);
+	} while (FindNextFileA(find, &data));
+	FindClose(find);
+}
+
+bool WinMapCatalogEnvironment::FileExists(const std::string& path)
+{
+	auto attributes = GetFileAttributesA(path.c_str());
+	return attributes != INVALID_FILE_ATTRIBUTES && !(attributes & FILE_ATTRIBUTE_DIRECTORY);
+}
+
+bool WinMapCatalogEnvironment::ReadFileStart(const std::string& path, size_t length, std::vector<char>& data)
+{
+	std::ifstream file(path, std::ios::binary);
+	if (!file.is_open())
+		return false;
+
+	data.resize(length);
+	file.read(data.data(), length);
+	data.resize(static_cast<size_t>(file.gcount()));
+	return true;
+}
+
+/// <summary>
+/// Starts watching a folder with a change notification.
+/// </summary>
+/// <param name="path">The folder.</param>
+/// <param name="subtree">Whether changes in its subfolders count too.</param>
+/// <returns>The notification handle, or NULL if the folder can't be watched.</returns>
+void* WinMapCatalogEnvironment::StartWatching(const std::string& path, bool subtree)
+{
+	auto notification = FindFirstChangeNotificationA(path.c_str(), subtree, FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_DIR_NAME | FILE_NOTIFY_CHANGE_SIZE | FILE_NOTIFY_CHANGE_LAST_WRITE);
+	return notification != INVALID_HANDLE_VALUE ? notification : NULL;
+}
+
+/// <summary>
+/// Checks if a change notification has fired, and re-arms it if it has.
+/// </summary>
+/// <param name="watch">The notification handle from StartWatching.</param>
+/// <returns>true if something in the folder changed.</returns>
+bool WinMapCatalogEnvironment::HasChanged(void* watch)
+{
+	if (WaitForSingleObject(watch, 0) != WAIT_OBJECT_0)
+		return false;
+
+	FindNextChangeNotification(watch);
+	return true;
+}
+
+void WinMapCatalogEnvironment::StopWatching(void* watch)
+{
+	FindCloseChangeNotification(watch);
+}
@@ -0,0 +1,108 @@
+#include "InfoRequest.hpp"
+#include <climits>
+
+namespace Server
+{
+	const std::string BadRequestResponse = "HTTP/1.1 400 Bad Request\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+	const std::string UnavailableResponse = "HTTP/1.1 503 Service Unavailable\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+
+	/// <summary>
+	/// Adds data that was read from the client to the request.
+	/// </summary>
+	/// <param name="data">The data.</param>
+	/// <param name="length">The length of the data.</param>
+	/// <returns>Complete once the whole request header has arrived.</returns>
+	InfoRequestStatus InfoRequest::Append(const char* data, size_t length)
+	{
+		// the end of the header might have been split over two reads
+		auto searchStart = text.length() >= 3 ? text.length() - 3 : 0;
+		text.append(data, length);
+
+		// check if text is proper ascii, because sometimes it's not
+		for (size_t i = 0; i < length; i++)
+		{
+			auto c = (unsigned char)data[i];
+			if ((c < 0x20 || c > 0x7F) && c != '\r' && c != '\n' && c != '\t')
+				return InfoRequestStatus::Bad;
+		}
+
+		auto headerEnd = text.find("\r\n\r\n", searchStart);
+		if (headerEnd == std::string::npos)
+			return text.length() > MaxLength ? InfoRequestStatus::Bad : InfoRequestStatus::Incomplete;
+
+		text.resize(headerEnd + 2); // keep the \r\n on the last header line, the auth header check relies on it
+		return InfoRequestStatus::Complete;
+	}
+
+	/// <summary>
+	/// Picks the response for a complete request from a snapshot.
+	/// </summary>
+	/// <param name="snapshot">The latest snapshot, or null if there isn't one yet.</param>
+	/// <returns>The response, it stays valid until the request is destroyed or Respond is called again.</returns>
+	const std::string* InfoRequest::Respond(const std::shared_ptr<const InfoSnapshot>& snapshot)
+	{
+		this->snapshot = snapshot;
+		ownedResponse.reset();
+
+		unsigned int since;
+		if (!snapshot)
+			return &UnavailableResponse;
+		if (!snapshot->AuthHeader.empty() && text.find(snapshot->AuthHeader) == std::string::npos)
+			return &snapshot->PublicResponse;
+		if (GetSinceParameter(text, since) && since != 0 && since <= snapshot->Generation)
+		{
+			// a generation newer than ours must be from before a restart, those get the full list below instead
+			ownedResponse = std::make_shared<std::string>(snapshot->BuildDeltaResponse(since));
+			return ownedResponse.get();
+		}
+		return &snapshot->AuthResponse;
+	}
+
+	/// <summary>
+	/// Gets the "since" parameter from the query string in a requests first line, eg. "GET /?since=42 HTTP/1.1".
+	/// </summary>
+	/// <param name="request">The request.</param>
+	/// <param name="since">Returns the value of the parameter.</param>
+	/// <returns>false if the parameter is missing or isn't a number.</returns>
+	bool GetSinceParameter(const std::string& request, unsigned int& since)
+	{
+		auto lineEnd = request.find("\r\n");
+		auto uriStart = request.find(' ');
+		if (uriStart >= lineEnd)
+			return false;
+		auto uriEnd = request.find(' ', uriStart + 1);
+		if (uriEnd > lineEnd)
+			uriEnd = lineEnd;
+
+		auto queryStart = request.find('?', uriStart);
+		if (queryStart >= uriEnd)
+			return false;
+
+		// go through each name=value pair
+		auto pos = queryStart + 1;
+		while (pos < uriEnd)
+		{
+			auto pairEnd = request.find('&', pos);
+			if (pairEnd > uriEnd)
+				pairEnd = uriEnd;
+
+			if (request.compare(pos, 6, "since=") == 0 && pos + 6 < pairEnd)
+			{
+				unsigned long long value = 0;
+				for (auto i = pos + 6; i < pairEnd; i++)
+				{
+					auto c = request[i];
+					if (c < '0' || c > '9')
+						return false;
+					value = value * 10 + (c - '0');
+					if (value > UINT_MAX)
+						return false;
+				}
+				since = static_cast<unsigned int>(value);
+				return true;
+			}
+			pos = pairEnd + 1;
+		}
+		return false;
+	}
+}
@@ -0,0 +1,38 @@
+#pragma once
+#include <memory>
+#include <string>
+#include "InfoSnapshot.hpp"
+
+namespace Server
+{
+	// how far along reading a request is
+	enum class InfoRequestStatus
+	{
+		Incomplete, // the header hasn't all arrived yet
+		Complete, // the whole header has arrived
+		Bad // not text, or the header is too long, answer with BadRequestResponse
+	};
+
+	extern const std::string BadRequestResponse;
+	extern const std::string UnavailableResponse;
+
+	// the part of the info server that doesn't touch sockets: buffering a request as it arrives and picking the response for it
+	// InfoServer feeds it whatever it reads from a client, the tests and InfoServerBenchmark feed it made up requests
+	class InfoRequest
+	{
+	public:
+		static const size_t MaxLength = 8192;
+
+		InfoRequestStatus Append(const char* data, size_t length);
+		const std::string* Respond(const std::shared_ptr<const InfoSnapshot>& snapshot);
+
+		const std::string& GetText() const { return text; }
+
+	private:
+		std::string text;
+		std::shared_ptr<const InfoSnapshot> snapshot; // keeps the response alive while it's being sent
+		std::shared_ptr<const std::string> ownedResponse; // a response built just for this request (eg. a delta)
+	};
+
+	bool GetSinceParameter(const std::string& request, unsigned int& since);
+}
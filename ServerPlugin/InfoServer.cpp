@@ -0,0 +1,236 @@
+#include <WinSock2.h>
+#include "InfoServer.hpp"
+
+namespace Server
+{
+	InfoServer::InfoServer()
+	{
+		running = false;
+		snapshotRequested = false;
+	}
+
+	InfoServer::~InfoServer()
+	{
+		Stop();
+	}
+
+	/// <summary>
+	/// Starts serving requests on a new thread.
+	/// </summary>
+	/// <param name="listenSocket">A bound socket that's already listening, the info server takes ownership of it.</param>
+	/// <returns>true if the network thread was started.</returns>
+	bool InfoServer::Start(SOCKET listenSocket)
+	{
+		if (thread)
+			return false;
+
+		this->listenSocket = listenSocket;
+		u_long nonBlocking = 1;
+		ioctlsocket(listenSocket, FIONBIO, &nonBlocking);
+
+		running = true;
+		thread = CreateThread(NULL, 0, threadProc, this, 0, NULL);
+		if (!thread)
+		{
+			running = false;
+			return false;
+		}
+		return true;
+	}
+
+	/// <summary>
+	/// Stops the network thread and closes the listener socket and any open connections.
+	/// </summary>
+	void InfoServer::Stop()
+	{
+		if (!thread)
+			return;
+
+		running = false;
+		WaitForSingleObject(thread, 1000); // the thread checks running at least every 100ms
+		CloseHandle(thread);
+		thread = NULL;
+
+		closesocket(listenSocket);
+		listenSocket = INVALID_SOCKET;
+
+		std::atomic_store(&snapshot, std::shared_ptr<const InfoSnapshot>());
+	}
+
+	/// <summary>
+	/// Replaces the snapshot used to answer requests, requests that are already being sent keep using the old one.
+	/// </summary>
+	/// <param name="snapshot">The new snapshot.</param>
+	void InfoServer::Publish(const std::shared_ptr<const InfoSnapshot>& snapshot)
+	{
+		std::atomic_store(&this->snapshot, snapshot);
+	}
+
+	/// <summary>
+	/// Checks if the game thread should build and publish a new snapshot.
+	/// </summary>
+	/// <param name="minAgeMs">How old the current snapshot has to be before a request makes us rebuild it.</param>
+	/// <param name="maxAgeMs">How old the current snapshot can get before we rebuild it anyway.</param>
+	/// <returns>true if a new snapshot should be published.</returns>
+	bool InfoServer::NeedsSnapshot(DWORD minAgeMs, DWORD maxAgeMs)
+	{
+		auto current = std::atomic_load(&snapshot);
+		if (!current)
+			return true;
+
+		auto age = GetTickCount() - current->CreatedTime;
+		if (age >= maxAgeMs)
+			return true;
+
+		return age >= minAgeMs && snapshotRequested.exchange(false);
+	}
+
+	DWORD WINAPI InfoServer::threadProc(LPVOID param)
+	{
+		reinterpret_cast<InfoServer*>(param)->run();
+		return 0;
+	}
+
+	/// <summary>
+	/// Network thread loop, waits on the listener and client sockets with select() and services whichever are ready.
+	/// </summary>
+	void InfoServer::run()
+	{
+		while (running)
+		{
+			fd_set readSet, writeSet;
+			FD_ZERO(&readSet);
+			FD_ZERO(&writeSet);
+
+			// when we're full, leave new connections in the listen backlog until a slot frees up
+			if (clients.size() < FD_SETSIZE)
+				FD_SET(listenSocket, &readSet);
+
+			for (auto& client : clients)
+			{
+				if (client.Response)
+					FD_SET(client.Socket, &writeSet);
+				else
+					FD_SET(client.Socket, &readSet);
+			}
+
+			timeval timeout;
+			timeout.tv_sec = 0;
+			timeout.tv_usec = 100 * 1000;
+			if (select(0, &readSet, &writeSet, NULL, &timeout) == SOCKET_ERROR)
+			{
+				Sleep(100);
+				continue;
+			}
+
+			auto now = GetTickCount();
+
+			// go backwards so closeClient can swap the last client into the closed ones place
+			for (size_t i = clients.size(); i-- > 0;)
+			{
+				auto& client = clients[i];
+				bool keepOpen = true;
+				if (FD_ISSET(client.Socket, &readSet))
+					keepOpen = readRequest(client);
+				else if (FD_ISSET(client.Socket, &writeSet))
+					keepOpen = sendResponse(client);
+				else if (now - client.LastActivity > ClientTimeoutMs)
+					keepOpen = false;
+
+				if (!keepOpen)
+					closeClient(i);
+			}
+
+			if (FD_ISSET(listenSocket, &readSet))
+				acceptClients();
+		}
+
+		while (!clients.empty())
+			closeClient(clients.size() - 1);
+	}
+
+	/// <summary>
+	/// Accepts every pending connection on the listener socket.
+	/// </summary>
+	void InfoServer::acceptClients()
+	{
+		while (clients.size() < FD_SETSIZE)
+		{
+			auto socket = accept(listenSocket, NULL, NULL);
+			if (socket == INVALID_SOCKET)
+				break;
+
+			u_long nonBlocking = 1;
+			ioctlsocket(socket, FIONBIO, &nonBlocking);
+
+			Client client;
+			client.Socket = socket;
+			client.LastActivity = GetTickCount();
+			clients.push_back(client);
+		}
+	}
+
+	/// <summary>
+	/// Reads whatever the client has sent, and starts sending the response once the whole request header has arrived.
+	/// </summary>
+	/// <param name="client">The client to read from.</param>
+	/// <returns>false if the connection should be closed.</returns>
+	bool InfoServer::readRequest(Client& client)
+	{
+		char buffer[2048];
+		auto length = recv(client.Socket, buffer, sizeof(buffer), 0);
+		if (length == 0)
+			return false;
+		if (length == SOCKET_ERROR)
+			return WSAGetLastError() == WSAEWOULDBLOCK;
+
+		client.LastActivity = GetTickCount();
+		switch (client.Request.Append(buffer, length))
+		{
+		case InfoRequestStatus::Incomplete:
+			return true; // wait for the rest of it
+		case InfoRequestStatus::Bad:
+			client.Response = &BadRequestResponse;
+			break;
+		default:
+			client.Response = client.Request.Respond(std::atomic_load(&snapshot));
+			snapshotRequested = true;
+			break;
+		}
+		return sendResponse(client); // usually fits in the socket buffer, so it'll go out right away
+	}
+
+	/// <summary>
+	/// Sends as much of the response as the socket will take.
+	/// </summary>
+	/// <param name="client">The client to send to.</param>
+	/// <returns>false if the connection should be closed (the whole response was sent, or the send failed).</returns>
+	bool InfoServer::sendResponse(Client& client)
+	{
+		auto& response = *client.Response;
+		while (client.Sent < response.length())
+		{
+			auto length = send(client.Socket, response.c_str() + client.Sent, (int)(response.length() - client.Sent), 0);
+			if (length == SOCKET_ERROR)
+				return WSAGetLastError() == WSAEWOULDBLOCK;
+
+			client.Sent += length;
+			client.LastActivity = GetTickCount();
+		}
+		return false; // we always send Connection: close
+	}
+
+	/// <summary>
+	/// Closes a client connection and removes it from the client list.
+	/// </summary>
+	/// <param name="index">The index of the client to close.</param>
+	void InfoServer::closeClient(size_t index)
+	{
+		shutdown(clients[index].Socket, SD_SEND);
+		closesocket(clients[index].Socket);
+
+		if (index != clients.size() - 1)
+			clients[index] = clients.back();
+		clients.pop_back();
+	}
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include <Windows.h>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+#include "InfoRequest.hpp"
+
+namespace Server
+{
+	// serves the info JSON on its own thread, so requests never wait on (or touch) the game thread
+	// the game thread builds an InfoSnapshot and publishes it, the network thread just picks the latest one for each request
+	class InfoServer
+	{
+	public:
+		InfoServer();
+		~InfoServer();
+
+		bool Start(SOCKET listenSocket);
+		void Stop();
+		bool IsRunning() const { return thread != NULL; }
+
+		void Publish(const std::shared_ptr<const InfoSnapshot>& snapshot);
+		bool NeedsSnapshot(DWORD minAgeMs, DWORD maxAgeMs);
+
+	private:
+		static const DWORD ClientTimeoutMs = 5000;
+
+		struct Client
+		{
+			SOCKET Socket = INVALID_SOCKET;
+			InfoRequest Request;
+			const std::string* Response = nullptr; // set once the request has been read, owned by Request (so it stays valid when the client is moved) or one of the static error responses
+			size_t Sent = 0;
+			DWORD LastActivity = 0;
+		};
+
+		SOCKET listenSocket = INVALID_SOCKET;
+		HANDLE thread = NULL;
+		std::atomic<bool> running;
+
+		std::shared_ptr<const InfoSnapshot> snapshot; // swapped atomically by Publish
+		std::atomic<bool> snapshotRequested; // set when a request was answered, so the game thread knows someone is looking
+
+		std::vector<Client> clients; // only touched by the network thread
+
+		static DWORD WINAPI threadProc(LPVOID param);
+		void run();
+		void acceptClients();
+		bool readRequest(Client& client);
+		bool sendResponse(Client& client);
+		void closeClient(size_t index);
+	};
+}
@@ -0,0 +1,193 @@
+#include "InfoSnapshot.hpp"
+#include <rapidjson/writer.h>
+#include <rapidjson/stringbuffer.h>
+
+namespace Server
+{
+	/// <summary>
+	/// Adds the headers to a JSON response.
+	/// </summary>
+	/// <param name="json">The JSON to send.</param>
+	/// <returns>The full HTTP response.</returns>
+	std::string InfoSnapshot::BuildResponse(const std::string& json) const
+	{
+		return ResponseHeaders + "Content-Length: " + std::to_string(json.length()) + "\r\nConnection: close\r\n\r\n" + json;
+	}
+
+	/// <summary>
+	/// Builds an authenticated response that only lists the replicated variables that changed after a generation.
+	/// "variablesSince" is added after the variables so clients can tell it apart from a full list.
+	/// </summary>
+	/// <param name="sinceGeneration">The generation the client is up to date with, shouldn't be newer than Generation.</param>
+	/// <returns>The full HTTP response.</returns>
+	std::string InfoSnapshot::BuildDeltaResponse(unsigned int sinceGeneration) const
+	{
+		std::string json;
+		json.reserve(AuthJsonHead.length() + AuthJsonTail.length() + 64);
+		json += AuthJsonHead;
+		json += '[';
+		auto first = true;
+		for (auto& variable : Variables)
+		{
+			if (variable.Generation <= sinceGeneration)
+				continue;
+			if (!first)
+				json += ',';
+			json += variable.Json;
+			first = false;
+		}
+		json += "],\"variablesSince\":";
+		json += std::to_string(sinceGeneration);
+		json += AuthJsonTail;
+		return BuildResponse(json);
+	}
+
+	/// <summary>
+	/// Builds the responses the info server sends for a game state.
+	/// </summary>
+	/// <param name="state">The game state.</param>
+	/// <param name="responseHeaders">Headers for a 200 response, without Content-Length/Connection.</param>
+	/// <param name="authHeader">The "Authorization: Basic ...\r\n" line a request needs to see the full info, or empty if there's no password.</param>
+	/// <param name="createdTime">GetTickCount() when the state was read.</param>
+	/// <returns>The snapshot, ready to be published.</returns>
+	std::shared_ptr<InfoSnapshot> BuildInfoSnapshot(const InfoState& state, const std::string& responseHeaders, const std::string& authHeader, uint32_t createdTime)
+	{
+		auto snapshot = std::make_shared<InfoSnapshot>();
+		snapshot->CreatedTime = createdTime;
+		snapshot->ResponseHeaders = responseHeaders;
+		snapshot->AuthResponse = snapshot->BuildResponse(BuildInfoJson(state, true, snapshot.get()));
+
+		if (!authHeader.empty())
+		{
+			snapshot->AuthHeader = authHeader;
+			snapshot->PublicResponse = snapshot->BuildResponse(BuildInfoJson(state, false));
+		}
+		return snapshot;
+	}
+
+	/// <summary>
+	/// Builds the server info JSON.
+	/// </summary>
+	/// <param name="state">The game state.</param>
+	/// <param name="authenticated">Whether to include the info that's hidden from people who don't know the server password.</param>
+	/// <param name="snapshot">If authenticated and not null, the replicated variables and the JSON around them are stored in here, for building delta responses.</param>
+	/// <returns>The JSON.</returns>
+	std::string BuildInfoJson(const InfoState& state, bool authenticated, InfoSnapshot* snapshot)
+	{
+		rapidjson::StringBuffer s;
+		rapidjson::Writer<rapidjson::StringBuffer> writer(s);
+		size_t variablesStart = 0;
+		size_t variablesEnd = 0;
+		writer.StartObject();
+		writer.Key("name");
+		writer.String(state.Name.c_str());
+		writer.Key("port");
+		writer.Int(state.Port);
+		writer.Key("hostPlayer");
+		writer.String(state.HostPlayer.c_str());
+		writer.Key("map");
+		writer.String(state.Map.c_str());
+		writer.Key("mapFile");
+		writer.String(state.MapFile.c_str());
+		writer.Key("variant");
+		writer.String(state.Variant.c_str());
+		if (!state.VariantType.empty())
+		{
+			writer.Key("variantType");
+			writer.String(state.VariantType.c_str());
+		}
+		writer.Key("status");
+		writer.String(state.Status.c_str());
+		writer.Key("numPlayers");
+		writer.Int(state.NumPlayers);
+		writer.Key("maxPlayers");
+		writer.Int(state.MaxPlayers);
+
+		if (authenticated)
+		{
+			writer.Key("xnkid");
+			writer.String(state.Xnkid.c_str());
+
+			writer.Key("xnaddr");
+			writer.String(state.Xnaddr.c_str());
+
+			if (snapshot)
+			{
+				snapshot->Generation = state.Generation;
+				snapshot->Variables.clear();
+				snapshot->Variables.reserve(state.Variables.size());
+			}
+
+			writer.Key("variablesGeneration");
+			writer.Uint(state.Generation);
+			writer.Key("variables");
+			writer.StartArray();
+			variablesStart = s.GetSize() - 1; // the writer only adds the colon after the key once the value starts, so the head has to end just before the [
+			for (auto& variable : state.Variables)
+			{
+				auto start = s.GetSize();
+				writer.StartObject();
+				writer.Key("name");
+				writer.String(variable.Name.c_str());
+				writer.Key("value");
+				writer.String(variable.Value.c_str());
+				writer.EndObject();
+
+				// keep a copy of each object (without the comma before it) so deltas can be put together from them
+				if (snapshot)
+				{
+					InfoVariable info;
+					info.Generation = variable.Generation;
+					info.Json.assign(s.GetString() + start, s.GetSize() - start);
+					if (!info.Json.empty() && info.Json[0] == ',')
+						info.Json.erase(0, 1);
+					snapshot->Variables.push_back(info);
+				}
+			}
+			writer.EndArray();
+			variablesEnd = s.GetSize();
+
+			writer.Key("players");
+			writer.StartArray();
+			for (auto& player : state.Players)
+			{
+				writer.StartObject();
+				writer.Key("name");
+				writer.String(player.Name.c_str());
+				writer.Key("score");
+				writer.Int(player.Score);
+				writer.Key("kills");
+				writer.Int(player.Kills);
+				writer.Key("assists");
+				writer.Int(player.Assists);
+				writer.Key("deaths");
+				writer.Int(player.Deaths);
+				writer.Key("team");
+				writer.Int(player.Team);
+				writer.Key("isAlive");
+				writer.Bool(player.IsAlive);
+				writer.EndObject();
+			}
+			writer.EndArray();
+		}
+		else
+		{
+			writer.Key("passworded");
+			writer.Bool(true);
+		}
+
+		writer.Key("gameVersion");
+		writer.String(state.GameVersion.c_str());
+		writer.Key("eldewritoVersion");
+		writer.String(state.EldewritoVersion.c_str());
+		writer.EndObject();
+
+		std::string json(s.GetString(), s.GetSize());
+		if (authenticated && snapshot)
+		{
+			snapshot->AuthJsonHead = json.substr(0, variablesStart);
+			snapshot->AuthJsonTail = json.substr(variablesEnd);
+		}
+		return json;
+	}
+}
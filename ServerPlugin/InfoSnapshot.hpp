@@ -0,0 +1,84 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace Server
+{
+	// a replicated variable in the info JSON
+	struct InfoVariable
+	{
+		unsigned int Generation; // replication generation the variable last changed in
+		std::string Json; // its {"name": ..., "value": ...} object
+	};
+
+	// everything the info server needs to answer a request, built on the game thread and never modified after it's published
+	struct InfoSnapshot
+	{
+		std::string AuthResponse; // full HTTP response for authenticated requests, sent to everyone if there's no password
+		std::string PublicResponse; // full HTTP response for requests that didn't authenticate, empty if there's no password
+		std::string AuthHeader; // "Authorization: Basic ...\r\n" line a request needs to authenticate, empty if there's no password
+		uint32_t CreatedTime = 0; // GetTickCount() when this was built
+
+		// authenticated requests for "?since=N" get a response that only lists the replicated variables that changed after generation N
+		// it's built from these when the request comes in, since N can be anything
+		std::string ResponseHeaders; // headers for a 200 response, without Content-Length/Connection
+		std::string AuthJsonHead; // the authenticated JSON up to the variables array
+		std::string AuthJsonTail; // the authenticated JSON after the variables array
+		std::vector<InfoVariable> Variables;
+		unsigned int Generation = 0; // replication generation when this was built
+
+		std::string BuildResponse(const std::string& json) const;
+		std::string BuildDeltaResponse(unsigned int sinceGeneration) const;
+	};
+
+	// a player in the info JSON
+	struct InfoPlayer
+	{
+		std::string Name;
+		int Score = 0;
+		int Kills = 0;
+		int Assists = 0;
+		int Deaths = 0;
+		int Team = 0;
+		bool IsAlive = false;
+	};
+
+	// a replicated variable's current value
+	struct InfoVariableState
+	{
+		std::string Name;
+		std::string Value;
+		unsigned int Generation = 0;
+	};
+
+	// the game state that goes into the info JSON, PatchModuleServer reads this from the game on the game thread
+	// kept apart from the game so snapshots can be built from made up state (see the tests and InfoServerBenchmark)
+	struct InfoState
+	{
+		std::string Name;
+		uint32_t Port = 0;
+		std::string HostPlayer;
+		std::string Map;
+		std::string MapFile;
+		std::string Variant;
+		std::string VariantType; // left out of the JSON if empty
+		std::string Status;
+		int NumPlayers = 0;
+		int MaxPlayers = 0;
+
+		// only sent to authenticated requests
+		std::string Xnkid;
+		std::string Xnaddr;
+		unsigned int Generation = 0; // replication generation the variables are up to date with
+		std::vector<InfoVariableState> Variables;
+		std::vector<InfoPlayer> Players;
+
+		std::string GameVersion;
+		std::string EldewritoVersion;
+	};
+
+	std::shared_ptr<InfoSnapshot> BuildInfoSnapshot(const InfoState& state, const std::string& responseHeaders, const std::string& authHeader, uint32_t createdTime);
+	std::string BuildInfoJson(const InfoState& state, bool authenticated, InfoSnapshot* snapshot = nullptr);
+}
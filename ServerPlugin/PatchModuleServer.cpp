@@ -141,6 +141,11 @@ namespace
 		ServerPatches.InfoServerStop();
 	}
 
+	void CallbackServerTick(const std::chrono::duration<double>& deltaTime)
+	{
+		ServerPatches.Tick();
+	}
+
 	int GetNumPlayers()
 	{
 		void* v2;
@@ -265,126 +270,64 @@ namespace
 	}
 
 	// retrieves master server endpoints from dewrito.json
-	// TODO1: move this to be part of IEngine?
 	void GetEndpoints(std::vector<std::string>& destVect, std::string endpointType)
 	{
-		std::ifstream in("dewrito.json", std::ios::in | std::ios::binary);
-		if (in && in.is_open())
-		{
-			std::string contents;
-			in.seekg(0, std::ios::end);
-			contents.resize((unsigned int)in.tellg());
-			in.seekg(0, std::ios::beg);
-			in.read(&contents[0], contents.size());
-			in.close();
-
-			rapidjson::Document json;
-			if (!json.Parse<0>(contents.c_str()).HasParseError() && json.IsObject())
-			{
-				if (json.HasMember("masterServers"))
-				{
-					auto& mastersArray = json["masterServers"];
-					for (auto it = mastersArray.Begin(); it != mastersArray.End(); it++)
-					{
-						destVect.push_back((*it)[endpointType.c_str()].GetString());
-					}
-				}
-			}
-		}
+		auto config = Engine->GetDewritoConfig();
+		auto it = config->MasterEndpoints.find(endpointType);
+		if (it != config->MasterEndpoints.end())
+			destVect.insert(destVect.end(), it->second.begin(), it->second.end());
 	}
 
-	DWORD WINAPI CommandServerAnnounce_Thread(LPVOID lpParam)
+	// sends a request to every master server at once, then logs any that failed
+	// masters that are backed off are skipped, unless ignoreBackoff is set (for requests that have to get through, like unannouncing)
+	void SendMasterServerRequests(const std::string& query, const std::string& requestName, const std::string& logModule, bool ignoreBackoff = false)
 	{
 		std::stringstream ss;
 		std::vector<std::string> announceEndpoints;
 
 		GetEndpoints(announceEndpoints, "announce");
 
-		for (auto server : announceEndpoints)
+		std::vector<std::wstring> uris;
+		for (auto& server : announceEndpoints)
+			uris.push_back(PublicUtils->WidenString(server + query));
+
+		std::vector<HttpRequest> responses;
+		try
+		{
+			responses = PublicUtils->HttpSendPooledRequests(uris, L"GET", L"ElDewrito/" + PublicUtils->WidenString(Engine->GetDoritoVersionString()), L"", NULL, 0);
+		}
+		catch (...) // TODO: find out what exception is being caused
+		{
+			Logger->Log(LogSeverity::Error, logModule, "Exception during master server " + requestName + " requests");
+			return;
+		}
+
+		for (size_t i = 0; i < responses.size(); i++)
 		{
-			HttpRequest req;
-			try
+			auto& server = announceEndpoints[i];
+			auto& req = responses[i];
+			if (req.Error == HttpRequestError::HostBackedOff)
 			{
-				req = PublicUtils->HttpSendRequest(PublicUtils->WidenString(server + "?port=" + ServerPatches.VarServerPort->ValueString), L"GET", L"ElDewrito/" + PublicUtils->WidenString(Engine->GetDoritoVersionString()), L"", L"", L"", NULL, 0);
-				if (req.Error != HttpRequestError::None)
+				if (!ignoreBackoff)
 				{
-					ss << "Unable to connect to master server " << server << " (error: " << (int)req.Error << "/" << req.LastError << "/" << std::to_string(GetLastError()) << ")" << std::endl << std::endl;
+					// this master has been failing, it'll be tried again once its backoff is over
+					Logger->Log(LogSeverity::Debug, logModule, "Skipped " + requestName + " to master server " + server + ", it's backed off");
 					continue;
 				}
-			}
-			catch (...) // TODO: find out what exception is being caused
-			{
-				ss << "Exception during master server announce request to " << server << std::endl << std::endl;
-				continue;
-			}
 
-			// make sure the server replied with 200 OK
-			std::wstring expected = L"HTTP/1.1 200 OK";
-			if (req.ResponseHeader.length() < expected.length())
-			{
-				ss << "Invalid master server announce response from " << server << std::endl << std::endl;
-				continue;
+				// send it anyway, outside the pool
+				req = PublicUtils->HttpSendRequest(uris[i], L"GET", L"ElDewrito/" + PublicUtils->WidenString(Engine->GetDoritoVersionString()), L"", L"", L"", NULL, 0);
 			}
 
-			auto respHdr = req.ResponseHeader.substr(0, expected.length());
-			if (respHdr.compare(expected))
+			if (req.Error == HttpRequestError::TimedOut)
 			{
-				ss << "Invalid master server announce response from " << server << std::endl << std::endl;
+				ss << "Master server " << server << " didn't respond to the " << requestName << " in time" << std::endl << std::endl;
 				continue;
 			}
 
-			// parse the json response
-			std::string resp = std::string(req.ResponseBody.begin(), req.ResponseBody.end());
-			rapidjson::Document json;
-			if (json.Parse<0>(resp.c_str()).HasParseError() || !json.IsObject())
+			if (req.Error != HttpRequestError::None)
 			{
-				ss << "Invalid master server JSON response from " << server << std::endl << std::endl;
-				continue;
-			}
-
-			if (!json.HasMember("result"))
-			{
-				ss << "Master server JSON response from " << server << " is missing data." << std::endl << std::endl;
-				continue;
-			}
-
-			auto& result = json["result"];
-			if (result["code"].GetInt() != 0)
-			{
-				ss << "Master server " << server << " returned error code " << result["code"].GetInt() << " (" << result["msg"].GetString() << ")" << std::endl << std::endl;
-				continue;
-			}
-		}
-
-		std::string errors = ss.str();
-		if (!errors.empty())
-			Logger->Log(LogSeverity::Error, "Announce", ss.str());
-
-		return true;
-	}
-
-	DWORD WINAPI CommandServerUnannounce_Thread(LPVOID lpParam)
-	{
-		std::stringstream ss;
-		std::vector<std::string> announceEndpoints;
-
-		GetEndpoints(announceEndpoints, "announce");
-
-		for (auto server : announceEndpoints)
-		{
-			HttpRequest req;
-			try
-			{
-				req = PublicUtils->HttpSendRequest(PublicUtils->WidenString(server + "?port=" + ServerPatches.VarServerPort->ValueString + "&shutdown=true"), L"GET", L"ElDewrito/" + PublicUtils->WidenString(Engine->GetDoritoVersionString()), L"", L"", L"", NULL, 0);
-				if (req.Error != HttpRequestError::None)
-				{
-					ss << "Unable to connect to master server " << server << " (error: " << (int)req.Error << "/" << req.LastError << "/" << std::to_string(GetLastError()) << ")" << std::endl << std::endl;
-					continue;
-				}
-			}
-			catch (...)
-			{
-				ss << "Exception during master server unannounce request to " << server << std::endl << std::endl;
+				ss << "Unable to connect to master server " << server << " (error: " << (int)req.Error << "/" << req.LastError << ")" << std::endl << std::endl;
 				continue;
 			}
 
@@ -392,14 +335,14 @@ namespace
 			std::wstring expected = L"HTTP/1.1 200 OK";
 			if (req.ResponseHeader.length() < expected.length())
 			{
-				ss << "Invalid master server unannounce response from " << server << std::endl << std::endl;
+				ss << "Invalid master server " << requestName << " response from " << server << std::endl << std::endl;
 				continue;
 			}
 
 			auto respHdr = req.ResponseHeader.substr(0, expected.length());
 			if (respHdr.compare(expected))
 			{
-				ss << "Invalid master server unannounce response from " << server << std::endl << std::endl;
+				ss << "Invalid master server " << requestName << " response from " << server << std::endl << std::endl;
 				continue;
 			}
 
@@ -428,8 +371,19 @@ namespace
 
 		std::string errors = ss.str();
 		if (!errors.empty())
-			Logger->Log(LogSeverity::Error, "Unannounce", ss.str());
+			Logger->Log(LogSeverity::Error, logModule, ss.str());
+	}
 
+	DWORD WINAPI CommandServerAnnounce_Thread(LPVOID lpParam)
+	{
+		SendMasterServerRequests("?port=" + ServerPatches.VarServerPort->ValueString, "announce", "Announce");
+		return true;
+	}
+
+	DWORD WINAPI CommandServerUnannounce_Thread(LPVOID lpParam)
+	{
+		// if a master misses this we'd stay listed after shutting down, so it goes to every master even if they've been failing
+		SendMasterServerRequests("?port=" + ServerPatches.VarServerPort->ValueString + "&shutdown=true", "unannounce", "Unannounce", true);
 		return true;
 	}
 
@@ -469,6 +423,7 @@ namespace Modules
 		engine->OnEvent("Core", "Engine.FirstTick", CallbackRemoteConsoleStart);
 		engine->OnEvent("Core", "Server.Start", CallbackInfoServerStart);
 		engine->OnEvent("Core", "Server.Stop", CallbackInfoServerStop);
+		engine->OnTick(CallbackServerTick);
 
 		VarServerName = AddVariableString("Name", "server_name", "The name of the server", eCommandFlagsArchived, "HaloOnline Server");
 		VarServerPassword = AddVariableString("Password", "password", "The server password", eCommandFlagsArchived, "");
@@ -502,10 +457,10 @@ namespace Modules
 		commands->Execute("Server.Unannounce"); // until we move announcement stuff to this plugin
 	}
 
-	LRESULT PatchModuleServer::WndProc(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam)
+	void PatchModuleServer::Tick()
 	{
 		if (!infoSocketOpen)
-			return 0;
+			return;
 
 		if (VarServerShouldAnnounce->ValueInt == 1)
 		{
@@ -518,7 +473,17 @@ namespace Modules
 			}
 		}
 
-		if (msg != WM_RCON && msg != WM_INFOSERVER)
+		// rebuild the info at most every 100ms while people are asking for it, and once a second otherwise
+		if (infoServer.NeedsSnapshot(100, 1000))
+			publishInfoSnapshot();
+	}
+
+	LRESULT PatchModuleServer::WndProc(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam)
+	{
+		if (!infoSocketOpen)
+			return 0;
+
+		if (msg != WM_RCON)
 			return 0;
 
 		if (WSAGETSELECTERROR(lParam))
@@ -531,6 +496,7 @@ namespace Modules
 		int inDataLength;
 		char inDataBuffer[1024];
 		bool isValidAscii = true;
+		std::string motd;
 
 		switch (WSAGETSELECTEVENT(lParam))
 		{
@@ -538,11 +504,8 @@ namespace Modules
 			// accept the connection and send our motd
 			clientSocket = accept((SOCKET)wParam, NULL, NULL);
 			WSAAsyncSelect(clientSocket, hWnd, msg, FD_READ | FD_WRITE | FD_CLOSE);
-			if (msg == WM_RCON)
-			{
-				std::string motd = "ElDewrito " + engine->GetDoritoVersionString() + " Remote Console\r\n";
-				send(clientSocket, motd.c_str(), motd.length(), 0);
-			}
+			motd = "ElDewrito " + engine->GetDoritoVersionString() + " Remote Console\r\n";
+			send(clientSocket, motd.c_str(), motd.length(), 0);
 			break;
 		case FD_READ:
 			ZeroMemory(inDataBuffer, sizeof(inDataBuffer));
@@ -561,176 +524,12 @@ namespace Modules
 
 			if (isValidAscii)
 			{
-				if (msg == WM_RCON)
+				auto ret = commands->Execute(inDataBuffer, true);
+				if (ret.length() > 0)
 				{
-					auto ret = commands->Execute(inDataBuffer, true);
-					if (ret.length() > 0)
-					{
-						utils->ReplaceString(ret, "\n", "\r\n");
-						ret = ret + "\r\n";
-						send((SOCKET)wParam, ret.c_str(), ret.length(), 0);
-					}
-				}
-				else if (msg == WM_INFOSERVER)
-				{
-					std::string mapName((char*)Pointer(0x22AB018)(0x1A4));
-					std::wstring mapVariantName((wchar_t*)Pointer(0x1863ACA));
-					std::wstring variantName((wchar_t*)Pointer(0x23DAF4C));
-					std::string xnkid;
-					std::string xnaddr;
-					std::string gameVersion((char*)Pointer(0x199C0F0));
-					std::string status = "InGame";
-					std::string playerName;
-					unsigned long maxPlayers;
-
-					// TODO: check return values of these? should be fine though
-					commands->GetVariableString("Player.Name", playerName);
-					commands->GetVariableInt("Server.MaxPlayers", maxPlayers);
-
-					utils->BytesToHexString((char*)Pointer(0x2247b80), 0x10, xnkid);
-					utils->BytesToHexString((char*)Pointer(0x2247b90), 0x10, xnaddr);
-
-					Pointer &gameModePtr = engine->GetMainTls(GameGlobals::GameInfo::TLSOffset)[0](GameGlobals::GameInfo::GameMode);
-					uint32_t gameMode = gameModePtr.Read<uint32_t>();
-					int32_t variantType = Pointer(0x023DAF18).Read<int32_t>();
-					if (gameMode == 3)
-					{
-						if (mapName == "mainmenu")
-						{
-							status = "InLobby";
-							// on mainmenu so we'll have to read other data
-							mapName = std::string((char*)Pointer(0x19A5E49));
-							variantName = std::wstring((wchar_t*)Pointer(0x179254));
-							variantType = Pointer(0x179250).Read<uint32_t>();
-						}
-						else // TODO: find how to get the variant name/type while it's on the loading screen
-							status = "Loading";
-					}
-
-					rapidjson::StringBuffer s;
-					rapidjson::Writer<rapidjson::StringBuffer> writer(s);
-					writer.StartObject();
-					writer.Key("name");
-					writer.String(VarServerName->ValueString.c_str());
-					writer.Key("port");
-					writer.Int(Pointer(0x1860454).Read<uint32_t>());
-					writer.Key("hostPlayer");
-					writer.String(playerName.c_str());
-					writer.Key("map");
-					writer.String(utils->ThinString(mapVariantName).c_str());
-					writer.Key("mapFile");
-					writer.String(mapName.c_str());
-					writer.Key("variant");
-					writer.String(utils->ThinString(variantName).c_str());
-					if (variantType >= 0 && variantType < Blam::GameTypeCount)
-					{
-						writer.Key("variantType");
-						writer.String(Blam::GameTypeNames[variantType].c_str());
-					}
-					writer.Key("status");
-					writer.String(status.c_str());
-					writer.Key("numPlayers");
-					writer.Int(GetNumPlayers());
-
-					// TODO: find how to get actual max players from the game, since our variable might be wrong
-					writer.Key("maxPlayers");
-					writer.Int(maxPlayers);
-
-					bool authenticated = true;
-					if (!VarServerPassword->ValueString.empty())
-					{
-						std::string authString = "dorito:" + VarServerPassword->ValueString;
-						authString = "Authorization: Basic " + utils->Base64Encode((const unsigned char*)authString.c_str(), authString.length()) + "\r\n";
-						authenticated = std::string(inDataBuffer).find(authString) != std::string::npos;
-					}
-
-					if (authenticated)
-					{
-						writer.Key("xnkid");
-						writer.String(xnkid.c_str());
-
-						writer.Key("xnaddr");
-						writer.String(xnaddr.c_str());
-
-						writer.Key("variables");
-						writer.StartArray();
-						auto cmds = commands->GetList();
-						for (auto cmd : cmds)
-						{
-							if (!(cmd.Flags & eCommandFlagsReplicated))
-								continue;
-							writer.StartObject();
-							writer.Key("name");
-							writer.String(cmd.Name.c_str());
-							writer.Key("value");
-							writer.String(cmd.ValueString.c_str());
-							writer.EndObject();
-						}
-						writer.EndArray();
-
-						writer.Key("players");
-						writer.StartArray();
-						uint32_t playerScoresBase = 0x23F1724;
-						//uint32_t playerInfoBase = 0x2162DD0;
-						uint32_t playerInfoBase = 0x2162E08;
-						uint32_t menuPlayerInfoBase = 0x1863B58;
-						uint32_t playerStatusBase = 0x2161808;
-						for (int i = 0; i < 16; i++)
-						{
-							uint16_t score = Pointer(playerScoresBase + (1080 * i)).Read<uint16_t>();
-							uint16_t kills = Pointer(playerScoresBase + (1080 * i) + 4).Read<uint16_t>();
-							uint16_t assists = Pointer(playerScoresBase + (1080 * i) + 6).Read<uint16_t>();
-							uint16_t deaths = Pointer(playerScoresBase + (1080 * i) + 8).Read<uint16_t>();
-
-							wchar_t* name = Pointer(playerInfoBase + (5696 * i));
-							std::string nameStr = utils->ThinString(name);
-
-							wchar_t* menuName = Pointer(menuPlayerInfoBase + (0x1628 * i));
-							std::string menuNameStr = utils->ThinString(menuName);
-
-							uint32_t ipAddr = Pointer(playerInfoBase + (5696 * i) - 88).Read<uint32_t>();
-							uint16_t team = Pointer(playerInfoBase + (5696 * i) + 32).Read<uint16_t>();
-							uint16_t num7 = Pointer(playerInfoBase + (5696 * i) + 36).Read<uint16_t>();
-
-							uint8_t alive = Pointer(playerStatusBase + (176 * i)).Read<uint8_t>();
-
-							if (menuNameStr.empty() && nameStr.empty() && ipAddr == 0)
-								continue;
-
-							writer.StartObject();
-							writer.Key("name");
-							writer.String(menuNameStr.c_str());
-							writer.Key("score");
-							writer.Int(score);
-							writer.Key("kills");
-							writer.Int(kills);
-							writer.Key("assists");
-							writer.Int(assists);
-							writer.Key("deaths");
-							writer.Int(deaths);
-							writer.Key("team");
-							writer.Int(team);
-							writer.Key("isAlive");
-							writer.Bool(alive == 1);
-							writer.EndObject();
-						}
-						writer.EndArray();
-					}
-					else
-					{
-						writer.Key("passworded");
-						writer.Bool(true);
-					}
-
-					writer.Key("gameVersion");
-					writer.String(gameVersion.c_str());
-					writer.Key("eldewritoVersion");
-					writer.String(engine->GetDoritoVersionString().c_str());
-					writer.EndObject();
-
-					std::string replyData = s.GetString();
-					std::string reply = "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\nAccess-Control-Allow-Origin: *\r\nServer: ElDewrito/" + engine->GetDoritoVersionString() + "\r\nContent-Length: " + std::to_string(replyData.length()) + "\r\nConnection: close\r\n\r\n" + replyData;
-					send((SOCKET)wParam, reply.c_str(), reply.length(), 0);
+					utils->ReplaceString(ret, "\n", "\r\n");
+					ret = ret + "\r\n";
+					send((SOCKET)wParam, ret.c_str(), ret.length(), 0);
 				}
 			}
 
@@ -742,6 +541,131 @@ namespace Modules
 		return 1;
 	}
 
+	/// <summary>
+	/// Builds the info responses from the current game state and hands them to the info server thread.
+	/// </summary>
+	void PatchModuleServer::publishInfoSnapshot()
+	{
+		Server::InfoState state;
+		readInfoState(state);
+
+		std::string authHeader;
+		if (!VarServerPassword->ValueString.empty())
+		{
+			std::string authString = "dorito:" + VarServerPassword->ValueString;
+			authHeader = "Authorization: Basic " + utils->Base64Encode((const unsigned char*)authString.c_str(), authString.length()) + "\r\n";
+		}
+
+		auto headers = "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\nAccess-Control-Allow-Origin: *\r\nServer: ElDewrito/" + engine->GetDoritoVersionString() + "\r\n";
+		infoServer.Publish(Server::BuildInfoSnapshot(state, headers, authHeader, GetTickCount()));
+	}
+
+	/// <summary>
+	/// Reads the game state that goes into the server info JSON.
+	/// </summary>
+	/// <param name="state">The state to fill in.</param>
+	void PatchModuleServer::readInfoState(Server::InfoState& state)
+	{
+		std::string mapName((char*)Pointer(0x22AB018)(0x1A4));
+		std::wstring mapVariantName((wchar_t*)Pointer(0x1863ACA));
+		std::wstring variantName((wchar_t*)Pointer(0x23DAF4C));
+		std::string status = "InGame";
+		std::string playerName;
+		unsigned long maxPlayers;
+
+		// TODO: check return values of these? should be fine though
+		commands->GetVariableString("Player.Name", playerName);
+		commands->GetVariableInt("Server.MaxPlayers", maxPlayers);
+
+		utils->BytesToHexString((char*)Pointer(0x2247b80), 0x10, state.Xnkid);
+		utils->BytesToHexString((char*)Pointer(0x2247b90), 0x10, state.Xnaddr);
+
+		Pointer &gameModePtr = engine->GetMainTls(GameGlobals::GameInfo::TLSOffset)[0](GameGlobals::GameInfo::GameMode);
+		uint32_t gameMode = gameModePtr.Read<uint32_t>();
+		int32_t variantType = Pointer(0x023DAF18).Read<int32_t>();
+		if (gameMode == 3)
+		{
+			if (mapName == "mainmenu")
+			{
+				status = "InLobby";
+				// on mainmenu so we'll have to read other data
+				mapName = std::string((char*)Pointer(0x19A5E49));
+				variantName = std::wstring((wchar_t*)Pointer(0x179254));
+				variantType = Pointer(0x179250).Read<uint32_t>();
+			}
+			else // TODO: find how to get the variant name/type while it's on the loading screen
+				status = "Loading";
+		}
+
+		state.Name = VarServerName->ValueString;
+		state.Port = Pointer(0x1860454).Read<uint32_t>();
+		state.HostPlayer = playerName;
+		state.Map = utils->ThinString(mapVariantName);
+		state.MapFile = mapName;
+		state.Variant = utils->ThinString(variantName);
+		if (variantType >= 0 && variantType < Blam::GameTypeCount)
+			state.VariantType = Blam::GameTypeNames[variantType];
+		state.Status = status;
+		state.NumPlayers = GetNumPlayers();
+
+		// TODO: find how to get actual max players from the game, since our variable might be wrong
+		state.MaxPlayers = maxPlayers;
+
+		std::vector<ReplicatedVariable> variables;
+		commands->GetReplicatedVariables(0, variables);
+		state.Generation = commands->GetReplicationGeneration();
+		state.Variables.reserve(variables.size());
+		for (auto& variable : variables)
+		{
+			Server::InfoVariableState info;
+			info.Name = variable.Variable->Name;
+			info.Value = variable.Variable->ValueString;
+			info.Generation = variable.Generation;
+			state.Variables.push_back(info);
+		}
+
+		uint32_t playerScoresBase = 0x23F1724;
+		//uint32_t playerInfoBase = 0x2162DD0;
+		uint32_t playerInfoBase = 0x2162E08;
+		uint32_t menuPlayerInfoBase = 0x1863B58;
+		uint32_t playerStatusBase = 0x2161808;
+		for (int i = 0; i < 16; i++)
+		{
+			uint16_t score = Pointer(playerScoresBase + (1080 * i)).Read<uint16_t>();
+			uint16_t kills = Pointer(playerScoresBase + (1080 * i) + 4).Read<uint16_t>();
+			uint16_t assists = Pointer(playerScoresBase + (1080 * i) + 6).Read<uint16_t>();
+			uint16_t deaths = Pointer(playerScoresBase + (1080 * i) + 8).Read<uint16_t>();
+
+			wchar_t* name = Pointer(playerInfoBase + (5696 * i));
+			std::string nameStr = utils->ThinString(name);
+
+			wchar_t* menuName = Pointer(menuPlayerInfoBase + (0x1628 * i));
+			std::string menuNameStr = utils->ThinString(menuName);
+
+			uint32_t ipAddr = Pointer(playerInfoBase + (5696 * i) - 88).Read<uint32_t>();
+			uint16_t team = Pointer(playerInfoBase + (5696 * i) + 32).Read<uint16_t>();
+			uint16_t num7 = Pointer(playerInfoBase + (5696 * i) + 36).Read<uint16_t>();
+
+			uint8_t alive = Pointer(playerStatusBase + (176 * i)).Read<uint8_t>();
+
+			if (menuNameStr.empty() && nameStr.empty() && ipAddr == 0)
+				continue;
+
+			Server::InfoPlayer player;
+			player.Name = menuNameStr;
+			player.Score = score;
+			player.Kills = kills;
+			player.Assists = assists;
+			player.Deaths = deaths;
+			player.Team = team;
+			player.IsAlive = alive == 1;
+			state.Players.push_back(player);
+		}
+
+		state.GameVersion = std::string((char*)Pointer(0x199C0F0));
+		state.EldewritoVersion = engine->GetDoritoVersionString();
+	}
+
 	void PatchModuleServer::RemoteConsoleStart()
 	{
 		if (rconSocketOpen)
@@ -768,9 +692,6 @@ namespace Modules
 		if (infoSocketOpen)
 			return;
 
-		if (engine->GetGameHWND() == 0)
-			return;
-
 		infoSocket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
 		SOCKADDR_IN bindAddr;
 		bindAddr.sin_family = AF_INET;
@@ -816,8 +737,16 @@ namespace Modules
 		if (err2.ErrorType != UPnPErrorType::None)
 			engine->PrintToConsole("Failed to open game server port via UPnP!"); // TODO: print in log instead
 
-		WSAAsyncSelect(infoSocket, engine->GetGameHWND(), WM_INFOSERVER, FD_ACCEPT | FD_CLOSE);
-		listen(infoSocket, 5);
+		listen(infoSocket, SOMAXCONN);
+
+		// publish the first snapshot before starting, so nobody gets turned away while we wait for the next tick
+		publishInfoSnapshot();
+		if (!infoServer.Start(infoSocket))
+		{
+			logger->Log(LogSeverity::Error, "ServerPlugin", "Failed to start info server thread");
+			closesocket(infoSocket);
+			return;
+		}
 		infoSocketOpen = true;
 	}
 
@@ -826,9 +755,7 @@ namespace Modules
 		if (!infoSocketOpen)
 			return;
 
-		closesocket(infoSocket);
-		int istrue = 1;
-		setsockopt(infoSocket, SOL_SOCKET, SO_REUSEADDR, (const char*)&istrue, sizeof(int));
+		infoServer.Stop(); // closes infoSocket too
 		unsigned long shouldAnnounce = 0;
 		if (!commands->GetVariableInt("Server.ShouldAnnounce", shouldAnnounce))
 			logger->Log(LogSeverity::Error, "ServerPlugin", "Failed to get Server.ShouldAnnounce variable?");
@@ -1,8 +1,8 @@
 #pragma once
+#include "InfoServer.hpp"
 #include <ElDorito/ElDorito.hpp>
 
 #define WM_RCON WM_USER + 1337
-#define WM_INFOSERVER WM_RCON + 1
 
 namespace Modules
 {
@@ -25,6 +25,7 @@ namespace Modules
 		void InfoServerStart();
 		void InfoServerStop();
 
+		void Tick();
 		LRESULT WndProc(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam);
 
 	private:
@@ -33,8 +34,12 @@ namespace Modules
 
 		SOCKET infoSocket;
 		bool infoSocketOpen = false;
+		Server::InfoServer infoServer;
 
 		time_t lastAnnounce = 0;
 		const time_t serverContactTimeLimit = 30 + (2 * 60);
+
+		void publishInfoSnapshot();
+		void readInfoState(Server::InfoState& state);
 	};
 }
@@ -0,0 +1,101 @@
+// times reading map/game variant BLF files the way ModuleGame and the content indexer do
+// build + run it in Release, the exit code is non-zero if getting a map variant ready for the game takes longer than TargetUs
+// it doesn't need MSVC either, eg. g++ -O2 -std=c++11 -Wno-multichar main.cpp ../../DewRecode/src/Blf.cpp
+
+#include "../../DewRecode/src/Blf.hpp"
+#include <chrono>
+#include <cstdio>
+
+using namespace Blam::Blf;
+
+namespace
+{
+	const int Iterations = 20000;
+	const double TargetUs = 50.0; // per map variant, for ReadIntoBuffer
+
+	volatile size_t sink; // stops the loops from being optimized away
+
+	/// <summary>
+	/// Builds a variant file the same shape as the ones the game saves, padded out to the game's buffer size.
+	/// </summary>
+	/// <param name="tag">The variant chunk tag.</param>
+	/// <param name="variantSize">The size of the variant chunk's data.</param>
+	/// <param name="fileSize">The size to pad the file out to.</param>
+	/// <returns>The file.</returns>
+	std::vector<uint8_t> MakeVariant(uint32_t tag, size_t variantSize, size_t fileSize)
+	{
+		std::vector<uint8_t> contentHeader(0xFC, 0);
+		std::vector<uint8_t> variant(variantSize);
+		for (size_t i = 0; i < variant.size(); i++)
+			variant[i] = static_cast<uint8_t>(i * 7);
+
+		Writer writer("benchmark");
+		writer.WriteChunk(ContentHeaderTag, 9, 2, contentHeader.data(), contentHeader.size());
+		writer.WriteChunk(tag, 12, 1, variant.data(), variant.size());
+		auto file = writer.Finish(AuthType::Crc);
+		file.resize(fileSize, 0);
+		return file;
+	}
+
+	/// <summary>
+	/// Times a function over a file.
+	/// </summary>
+	/// <param name="file">The file to pass to the function.</param>
+	/// <param name="func">The function to time, its result goes into sink.</param>
+	/// <returns>Microseconds per call.</returns>
+	template<class Func>
+	double Time(const std::vector<uint8_t>& file, Func func)
+	{
+		auto start = std::chrono::steady_clock::now();
+		for (int i = 0; i < Iterations; i++)
+			sink = func(file);
+		auto end = std::chrono::steady_clock::now();
+		return std::chrono::duration<double, std::micro>(end - start).count() / Iterations;
+	}
+
+	/// <summary>
+	/// Prints the timings for one kind of variant.
+	/// </summary>
+	/// <param name="name">The name to print.</param>
+	/// <param name="file">The variant file.</param>
+	/// <param name="tag">The variant chunk tag.</param>
+	/// <param name="bufferSize">The size of the buffer the game parses it from.</param>
+	/// <returns>Microseconds per ReadIntoBuffer call.</returns>
+	double Benchmark(const char* name, const std::vector<uint8_t>& file, uint32_t tag, size_t bufferSize)
+	{
+		std::vector<uint8_t> buffer;
+		if (ReadIntoBuffer(file.data(), file.size(), tag, bufferSize, buffer) != Error::None || Validate(file.data(), file.size(), true) != Error::None)
+		{
+			printf("FAIL: the %s doesn't read back\n", name);
+			return -1;
+		}
+
+		auto isBlfUs = Time(file, [](const std::vector<uint8_t>& f) { return static_cast<size_t>(IsBlf(f.data(), f.size())); });
+		auto validateUs = Time(file, [](const std::vector<uint8_t>& f) { return static_cast<size_t>(Validate(f.data(), f.size())); });
+		auto checkEndUs = Time(file, [](const std::vector<uint8_t>& f) { return static_cast<size_t>(Validate(f.data(), f.size(), true)); });
+		auto readUs = Time(file, [&](const std::vector<uint8_t>& f) { return static_cast<size_t>(ReadIntoBuffer(f.data(), f.size(), tag, bufferSize, buffer)); });
+
+		printf("%s (0x%X bytes)\n", name, static_cast<unsigned int>(file.size()));
+		printf("  IsBlf:                  %8.3f us\n", isBlfUs);
+		printf("  Validate:               %8.3f us\n", validateUs);
+		printf("  Validate (_eof checks): %8.3f us\n", checkEndUs);
+		printf("  ReadIntoBuffer:         %8.3f us\n", readUs);
+		return readUs;
+	}
+}
+
+int main()
+{
+	printf("%d iterations each\n", Iterations);
+	auto mapUs = Benchmark("Map variant", MakeVariant(MapVariantTag, 0xE088, MapVariantBufferSize), MapVariantTag, MapVariantBufferSize);
+	auto gameUs = Benchmark("Game variant", MakeVariant(GameVariantTag, 0x258, GameVariantBufferSize), GameVariantTag, GameVariantBufferSize);
+	if (mapUs < 0 || gameUs < 0)
+		return 1;
+
+	if (mapUs > TargetUs)
+	{
+		printf("FAIL: reading a map variant took longer than the target (%.0f us)\n", TargetUs);
+		return 1;
+	}
+	return 0;
+}
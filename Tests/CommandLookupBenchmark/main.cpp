@@ -0,0 +1,113 @@
+// times Commands::Find's case-insensitive index against the _stricmp scan over the command list that it replaced
+// build + run it in Release, the exit code is non-zero if the index finds a different command, or is slower than the scan
+// it doesn't need MSVC either, eg. g++ -O2 -std=c++11 -D_stricmp=strcasecmp "-D_countof(a)=(sizeof(a)/sizeof(a[0]))" main.cpp
+
+#include "../../DewRecode/src/CommandName.hpp"
+#include <chrono>
+#include <cstdio>
+#include <deque>
+#include <unordered_map>
+#include <vector>
+
+namespace
+{
+	const int NumCommands = 400; // a bit more than the game + plugins register
+	const int Lookups = 1000000;
+
+	const char* Modules[] = { "Game", "Server", "Player", "Input", "Camera", "Graphics", "Time", "Debug", "Forge", "VoIP", "IRC", "Console" };
+
+	// just enough of Command for the lookups
+	struct FakeCommand
+	{
+		std::string Name;
+		std::string ShortName;
+	};
+
+	volatile size_t sink; // stops the loops from being optimized away
+
+	/// <summary>
+	/// Finds a command the way Commands::Find used to, by checking every command in the list.
+	/// </summary>
+	/// <param name="list">The command list.</param>
+	/// <param name="name">The name or short name to look for.</param>
+	/// <returns>The command, or nullptr if it wasn't found.</returns>
+	const FakeCommand* ScanFind(const std::deque<FakeCommand>& list, const std::string& name)
+	{
+		for (auto& command : list)
+		{
+			if (!_stricmp(command.Name.c_str(), name.c_str()) || (!command.ShortName.empty() && !_stricmp(command.ShortName.c_str(), name.c_str())))
+				return &command;
+		}
+		return nullptr;
+	}
+}
+
+int main()
+{
+	std::deque<FakeCommand> list;
+	std::unordered_map<std::string, const FakeCommand*, CommandNameHash, CommandNameEqual> index;
+	for (int i = 0; i < NumCommands; i++)
+	{
+		FakeCommand command;
+		command.Name = std::string(Modules[i % _countof(Modules)]) + ".Variable" + std::to_string(i);
+		if (i % 4 == 0)
+			command.ShortName = "var" + std::to_string(i);
+		list.push_back(command);
+
+		index[list.back().Name] = &list.back();
+		if (!list.back().ShortName.empty())
+			index[list.back().ShortName] = &list.back();
+	}
+
+	// what people type: names in whatever case, short names, and typos
+	std::vector<std::string> queries;
+	for (int i = 0; i < NumCommands; i++)
+	{
+		auto name = list[i].Name;
+		if (i % 3 == 0)
+		{
+			for (auto& c : name)
+				c = static_cast<char>(tolower(static_cast<unsigned char>(c)));
+		}
+		queries.push_back(name);
+		if (!list[i].ShortName.empty())
+			queries.push_back(list[i].ShortName);
+		if (i % 10 == 0)
+			queries.push_back(name + "x");
+	}
+
+	for (auto& query : queries)
+	{
+		auto it = index.find(query);
+		auto indexed = (it == index.end()) ? nullptr : it->second;
+		if (indexed != ScanFind(list, query))
+		{
+			printf("FAIL: the index and the scan found different commands for %s\n", query.c_str());
+			return 1;
+		}
+	}
+
+	auto start = std::chrono::steady_clock::now();
+	for (int i = 0; i < Lookups; i++)
+		sink = reinterpret_cast<size_t>(ScanFind(list, queries[i % queries.size()]));
+	auto scanEnd = std::chrono::steady_clock::now();
+	for (int i = 0; i < Lookups; i++)
+	{
+		auto it = index.find(queries[i % queries.size()]);
+		sink = reinterpret_cast<size_t>(it == index.end() ? nullptr : it->second);
+	}
+	auto indexEnd = std::chrono::steady_clock::now();
+
+	auto scanNs = std::chrono::duration<double, std::nano>(scanEnd - start).count() / Lookups;
+	auto indexNs = std::chrono::duration<double, std::nano>(indexEnd - scanEnd).count() / Lookups;
+	printf("%d commands, %d lookups\n", NumCommands, Lookups);
+	printf("Scan:  %8.1f ns per lookup\n", scanNs);
+	printf("Index: %8.1f ns per lookup\n", indexNs);
+
+	if (indexNs > scanNs)
+	{
+		printf("FAIL: the index was slower than scanning the list\n");
+		return 1;
+	}
+	return 0;
+}
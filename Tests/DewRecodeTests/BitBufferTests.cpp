@@ -0,0 +1,270 @@
+#include "Test.hpp"
+#include <ElDorito/Blam/BitBuffer.hpp>
+
+namespace
+{
+	// xorshift, so the random round trips are the same every run
+	uint64_t NextRandom(uint64_t& state)
+	{
+		state ^= state << 13;
+		state ^= state >> 7;
+		state ^= state << 17;
+		return state;
+	}
+}
+
+TEST(BitBuffer, BitOrder)
+{
+	uint8_t buffer[4] = { 0 };
+	Blam::BitWriter writer(buffer, sizeof(buffer));
+	writer.WriteBits(1, 1);
+	writer.WriteBits(0, 2);
+	writer.WriteBits(0x1F, 5);
+	writer.WriteBits(0xABC, 12);
+	writer.Finish();
+
+	// most significant bit first
+	CHECK_EQUAL(20U, writer.GetPosition());
+	CHECK_EQUAL(0x9F, buffer[0]);
+	CHECK_EQUAL(0xAB, buffer[1]);
+	CHECK_EQUAL(0xC0, buffer[2]);
+	CHECK(!writer.HasOverflowed());
+}
+
+TEST(BitBuffer, RoundTrip64)
+{
+	uint8_t buffer[64] = { 0 };
+	Blam::BitWriter writer(buffer, sizeof(buffer));
+	writer.WriteBits(0x123456789ABCDEF0, 64); // window empty
+	writer.WriteBits(1, 3);
+	writer.WriteBits(0xFEDCBA9876543210, 64); // window partly full
+	writer.WriteBits(0xFFFFFFFFFFFFFFFF, 64);
+	writer.WriteBits(0, 64);
+	writer.WriteBits(0x5, 61); // fills the window back up to a byte boundary
+	writer.WriteBits(0x8000000000000001, 64);
+	writer.Finish();
+	CHECK(!writer.HasOverflowed());
+	CHECK_EQUAL(64U * 5 + 3 + 61, writer.GetPosition());
+
+	Blam::BitReader reader(buffer, writer.GetPosition());
+	CHECK_EQUAL(0x123456789ABCDEF0ULL, reader.ReadBits(64));
+	CHECK_EQUAL(1ULL, reader.ReadBits(3));
+	CHECK_EQUAL(0xFEDCBA9876543210ULL, reader.ReadBits(64)); // spread over 9 bytes
+	CHECK_EQUAL(0xFFFFFFFFFFFFFFFFULL, reader.ReadBits(64));
+	CHECK_EQUAL(0ULL, reader.ReadBits(64));
+	CHECK_EQUAL(5ULL, reader.ReadBits(61));
+	CHECK_EQUAL(0x8000000000000001ULL, reader.ReadBits(64));
+	CHECK_EQUAL(0U, reader.GetRemaining());
+	CHECK(!reader.HasOverflowed());
+}
+
+TEST(BitBuffer, RandomRoundTrip)
+{
+	uint8_t buffer[4096] = { 0 };
+	std::vector<int> sizes;
+	std::vector<uint64_t> values;
+
+	uint64_t state = 0x9E3779B97F4A7C15;
+	Blam::BitWriter writer(buffer, sizeof(buffer));
+	while (writer.GetPosition() < sizeof(buffer) * 8 - 64)
+	{
+		auto bits = static_cast<int>(NextRandom(state) % 64) + 1;
+		auto val = NextRandom(state) & Blam::BitBufferInternal::Mask(bits);
+		writer.WriteBits(val, bits);
+		sizes.push_back(bits);
+		values.push_back(val);
+	}
+	writer.Finish();
+	CHECK(!writer.HasOverflowed());
+
+	Blam::BitReader reader(buffer, writer.GetPosition());
+	for (size_t i = 0; i < values.size(); i++)
+		CHECK_EQUAL(values[i], reader.ReadBits(sizes[i]));
+	CHECK_EQUAL(0U, reader.GetRemaining());
+}
+
+TEST(BitBuffer, Values)
+{
+	uint8_t buffer[64] = { 0 };
+	Blam::BitWriter writer(buffer, sizeof(buffer));
+	writer.WriteBool(true);
+	writer.WriteSigned<int>(-5, 6);
+	writer.WriteSigned<int64_t>(-1, 64);
+	writer.WriteUnsigned<int>(7, 3, 10);
+	writer.WriteFloat(1.5f);
+	writer.WriteQuantizedFloat(0.5f, 0.0f, 1.0f, 8);
+	writer.WriteString("hello", 16);
+	writer.Finish();
+
+	Blam::BitReader reader(buffer, writer.GetPosition());
+	CHECK(reader.ReadBool());
+	CHECK_EQUAL(-5, reader.ReadSigned<int>(6));
+	CHECK_EQUAL(-1LL, reader.ReadSigned<int64_t>(64));
+	CHECK_EQUAL(7, reader.ReadUnsigned<int>(3, 10));
+	CHECK_EQUAL(1.5f, reader.ReadFloat());
+	auto quantized = reader.ReadQuantizedFloat(0.0f, 1.0f, 8);
+	CHECK(quantized > 0.49f && quantized < 0.51f);
+	char str[17];
+	reader.ReadString(str, 16);
+	CHECK_EQUAL(std::string("hello"), std::string(str));
+	CHECK(!reader.HasOverflowed());
+}
+
+TEST(BitBuffer, Blocks)
+{
+	// blocks that aren't a multiple of 64 bits, written at an offset that isn't byte aligned
+	uint8_t block[16];
+	for (size_t i = 0; i < sizeof(block); i++)
+		block[i] = static_cast<uint8_t>(0x11 * (i + 1));
+
+	size_t blockSizes[] = { 1, 63, 64, 65, 100, 128 };
+	for (auto blockBits : blockSizes)
+	{
+		uint8_t buffer[32] = { 0 };
+		Blam::BitWriter writer(buffer, sizeof(buffer));
+		writer.WriteBits(3, 3);
+		writer.WriteBlock(block, blockBits);
+		writer.WriteBits(0x2A, 6);
+		writer.Finish();
+		CHECK_EQUAL(3 + blockBits + 6, writer.GetPosition());
+
+		// the block has to read back the same as reading its bits one at a time
+		Blam::BitReader blockReader(block, blockBits);
+		Blam::BitReader reader(buffer, writer.GetPosition());
+		CHECK_EQUAL(3ULL, reader.ReadBits(3));
+		for (size_t i = 0; i < blockBits; i++)
+			CHECK_EQUAL(blockReader.ReadBits(1), reader.ReadBits(1));
+		CHECK_EQUAL(0x2AULL, reader.ReadBits(6));
+
+		uint8_t out[16] = { 0 };
+		Blam::BitReader outReader(buffer, writer.GetPosition());
+		outReader.ReadBits(3);
+		outReader.ReadBlock(out, blockBits);
+		CHECK_EQUAL(0x2AULL, outReader.ReadBits(6));
+		CHECK(!memcmp(out, block, blockBits / 8));
+		if (blockBits % 8)
+		{
+			auto mask = static_cast<uint8_t>(0xFF << (8 - blockBits % 8));
+			CHECK_EQUAL(block[blockBits / 8] & mask, out[blockBits / 8] & mask);
+		}
+	}
+}
+
+TEST(BitBuffer, WriterOverflow)
+{
+	uint8_t buffer[9] = { 0 };
+	Blam::BitWriter writer(buffer, 8);
+	writer.WriteBits(0xFFFFFFFFFFFFFFFF, 64);
+	CHECK(!writer.HasOverflowed());
+	writer.WriteBits(1, 1);
+	writer.Finish();
+	CHECK(writer.HasOverflowed());
+	CHECK_EQUAL(0, buffer[8]); // nothing got written past the end
+}
+
+TEST(BitBuffer, ReaderOverflow)
+{
+	uint8_t buffer[2] = { 0xFF, 0xFF };
+	Blam::BitReader reader(buffer, 12);
+	CHECK_EQUAL(0xFFULL, reader.ReadBits(8));
+	CHECK_EQUAL(4U, reader.GetRemaining());
+	CHECK_EQUAL(0ULL, reader.ReadBits(5));
+	CHECK(reader.HasOverflowed());
+	CHECK_EQUAL(0U, reader.GetRemaining());
+}
+
+// The vectors below are the bytes the engine's BitStream puts on the wire when each value is written to it separately
+// (values go into a 64-bit window most significant bit first, and the window is stored big-endian once it fills up),
+// worked out by hand from the bit strings, so they pin the layout down independently of BitWriter/BitReader.
+
+TEST(BitBuffer, GoldenValues)
+{
+	// bool, [3, 10] range, 6 raw bits, 6 signed bits
+	const uint8_t expected[] = { 0xCA, 0xBB };
+
+	uint8_t buffer[8] = { 0 };
+	Blam::BitWriter writer(buffer, sizeof(buffer));
+	writer.WriteBool(true);
+	writer.WriteUnsigned<int>(7, 3, 10);
+	writer.WriteBits(0x2A, 6);
+	writer.WriteSigned<int>(-5, 6);
+	writer.Finish();
+	CHECK_EQUAL(16U, writer.GetPosition());
+	CHECK(!memcmp(buffer, expected, sizeof(expected)));
+
+	Blam::BitReader reader(expected, 16);
+	CHECK(reader.ReadBool());
+	CHECK_EQUAL(7, reader.ReadUnsigned<int>(3, 10));
+	CHECK_EQUAL(0x2AULL, reader.ReadBits(6));
+	CHECK_EQUAL(-5, reader.ReadSigned<int>(6));
+}
+
+TEST(BitBuffer, GoldenWindowBoundary)
+{
+	// a 64-bit value starting 3 bits in, so it and the values after it straddle the first window flush
+	const uint8_t expected[] = { 0xA0, 0x24, 0x68, 0xAC, 0xF1, 0x35, 0x79, 0xBD, 0xFF, 0xFD, 0xEA, 0xDB, 0xEE, 0xF6 };
+
+	uint8_t buffer[16] = { 0 };
+	Blam::BitWriter writer(buffer, sizeof(buffer));
+	writer.WriteBits(0x5, 3);
+	writer.WriteBits(0x0123456789ABCDEF, 64);
+	writer.WriteBits(0x1FF, 9);
+	writer.WriteBits(0xDEADBEEF, 32);
+	writer.WriteBool(false);
+	writer.WriteBits(0x3, 2);
+	writer.Finish();
+	CHECK_EQUAL(111U, writer.GetPosition());
+	CHECK(!memcmp(buffer, expected, sizeof(expected)));
+
+	Blam::BitReader reader(expected, 111);
+	CHECK_EQUAL(0x5ULL, reader.ReadBits(3));
+	CHECK_EQUAL(0x0123456789ABCDEFULL, reader.ReadBits(64));
+	CHECK_EQUAL(0x1FFULL, reader.ReadBits(9));
+	CHECK_EQUAL(0xDEADBEEFULL, reader.ReadBits(32));
+	CHECK(!reader.ReadBool());
+	CHECK_EQUAL(0x3ULL, reader.ReadBits(2));
+	CHECK(!reader.HasOverflowed());
+}
+
+TEST(BitBuffer, GoldenRanges)
+{
+	// ranges go on the wire as the offset from the minimum, in just enough bits for (max - min)
+	const uint8_t expected[] = { 0xDD, 0x95, 0x80 };
+
+	uint8_t buffer[8] = { 0 };
+	Blam::BitWriter writer(buffer, sizeof(buffer));
+	writer.WriteUnsigned<int>(113, 100, 115);
+	writer.WriteUnsigned<int>(5, -8, 7);
+	writer.WriteUnsigned<int>(1299, 1000, 1300);
+	writer.Finish();
+	CHECK_EQUAL(17U, writer.GetPosition());
+	CHECK(!memcmp(buffer, expected, sizeof(expected)));
+
+	// reading a range gives back the value, not the offset (ReadUnsigned(min, max) used to leave the minimum off)
+	Blam::BitReader reader(expected, 17);
+	CHECK_EQUAL(113, reader.ReadUnsigned<int>(100, 115));
+	CHECK_EQUAL(5, reader.ReadUnsigned<int>(-8, 7));
+	CHECK_EQUAL(1299, reader.ReadUnsigned<int>(1000, 1300));
+
+	// a minimum of 0 reads the same either way, which is what every existing BitStream caller passes
+	Blam::BitReader zeroReader(expected, 4);
+	CHECK_EQUAL(13, zeroReader.ReadUnsigned<int>(0, 15));
+}
+
+TEST(BitBuffer, GoldenString)
+{
+	// length in CountBits(maxLength) bits, then 8 bits per character
+	const uint8_t expected[] = { 0x1B, 0x23, 0x2B, 0xB8 };
+
+	uint8_t buffer[8] = { 0 };
+	Blam::BitWriter writer(buffer, sizeof(buffer));
+	writer.WriteString("dew", 16);
+	writer.Finish();
+	CHECK_EQUAL(29U, writer.GetPosition());
+	CHECK(!memcmp(buffer, expected, sizeof(expected)));
+
+	char str[17];
+	Blam::BitReader reader(expected, 29);
+	reader.ReadString(str, 16);
+	CHECK_EQUAL(std::string("dew"), std::string(str));
+}
@@ -0,0 +1,335 @@
+#include "Test.hpp"
+#include "../../DewRecode/src/Blf.hpp"
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <ostream>
+
+using namespace Blam::Blf;
+
+namespace Blam
+{
+	namespace Blf
+	{
+		// so CHECK_EQUAL can print errors
+		static std::ostream& operator<<(std::ostream& stream, Error error)
+		{
+			return stream << GetErrorString(error);
+		}
+	}
+}
+
+namespace
+{
+	std::vector<uint8_t> MakeFile(ByteOrder order, AuthType auth)
+	{
+		uint8_t data[0x20];
+		for (size_t i = 0; i < sizeof(data); i++)
+			data[i] = static_cast<uint8_t>(i);
+
+		Writer writer("test", order);
+		writer.WriteChunk(ContentHeaderTag, 9, 2, data, 0x10);
+		writer.WriteChunk(MapVariantTag, 12, 1, data, sizeof(data));
+		return writer.Finish(auth);
+	}
+
+	// Chunk headers laid out the way the game saves variants (sandbox.map and the variant.*.bin files): a 0x30 byte _blf chunk,
+	// a 0x108 byte content header, the variant chunk, an _eof chunk, and then zeroes out to the size of the game's parse buffer.
+	// These are rebuilt from the layout rather than copied out of real files, which can't be shipped with the tests (see RealFiles).
+	const uint8_t LittleHeaderChunk[] = { 'f', 'l', 'b', '_', 0x30, 0x00, 0x00, 0x00, 0x01, 0x00, 0x02, 0x00, 0xFE, 0xFF };
+	const uint8_t BigHeaderChunk[] = { '_', 'b', 'l', 'f', 0x00, 0x00, 0x00, 0x30, 0x00, 0x01, 0x00, 0x02, 0xFF, 0xFE };
+	const uint8_t LittleContentHeader[] = { 'r', 'd', 'h', 'c', 0x08, 0x01, 0x00, 0x00, 0x09, 0x00, 0x02, 0x00 };
+	const uint8_t BigContentHeader[] = { 'c', 'h', 'd', 'r', 0x00, 0x00, 0x01, 0x08, 0x00, 0x09, 0x00, 0x02 };
+	const uint8_t LittleMapVariantHeader[] = { 'v', 'p', 'a', 'm', 0x94, 0xE0, 0x00, 0x00, 0x0C, 0x00, 0x01, 0x00 };
+	const uint8_t LittleGameVariantHeader[] = { 'r', 'v', 'p', 'm', 0x64, 0x02, 0x00, 0x00, 0x0A, 0x00, 0x01, 0x00 };
+	const uint8_t BigGameVariantHeader[] = { 'm', 'p', 'v', 'r', 0x00, 0x00, 0x02, 0x64, 0x00, 0x0A, 0x00, 0x01 };
+
+	// _eof chunks with no auth, one with the length filled in and one left at zero (both turn up in the wild)
+	const uint8_t LittleEndChunk[] = { 'f', 'o', 'e', '_', 0x11, 0x00, 0x00, 0x00, 0x01, 0x00, 0x01, 0x00, 0xCC, 0xE1, 0x00, 0x00, 0x00 };
+	const uint8_t LittleZeroEndChunk[] = { 'f', 'o', 'e', '_', 0x11, 0x00, 0x00, 0x00, 0x01, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 };
+	const uint8_t BigZeroEndChunk[] = { '_', 'e', 'o', 'f', 0x00, 0x00, 0x00, 0x11, 0x00, 0x01, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00 };
+
+	const size_t HeaderChunkSize = 0x30;
+	const size_t ContentHeaderSize = 0x108;
+	const size_t MapVariantChunkSize = 0xE094;
+	const size_t GameVariantChunkSize = 0x264;
+
+	// Puts a header at an offset, the data after it is left as zeroes.
+	void Place(std::vector<uint8_t>& file, size_t offset, const uint8_t* header, size_t size)
+	{
+		memcpy(file.data() + offset, header, size);
+	}
+
+	template<size_t N>
+	void Place(std::vector<uint8_t>& file, size_t offset, const uint8_t(&header)[N])
+	{
+		Place(file, offset, header, N);
+	}
+
+	// Builds a variant file out of the fixture headers.
+	std::vector<uint8_t> MakeVariant(bool big, bool map, size_t fileSize, bool zeroEnd)
+	{
+		std::vector<uint8_t> file(fileSize, 0);
+		Place(file, 0, big ? BigHeaderChunk : LittleHeaderChunk, sizeof(LittleHeaderChunk));
+		Place(file, HeaderChunkSize, big ? BigContentHeader : LittleContentHeader, sizeof(LittleContentHeader));
+
+		auto variantOffset = HeaderChunkSize + ContentHeaderSize;
+		size_t endOffset;
+		if (map)
+		{
+			Place(file, variantOffset, LittleMapVariantHeader);
+			endOffset = variantOffset + MapVariantChunkSize;
+		}
+		else
+		{
+			Place(file, variantOffset, big ? BigGameVariantHeader : LittleGameVariantHeader, sizeof(LittleGameVariantHeader));
+			endOffset = variantOffset + GameVariantChunkSize;
+		}
+
+		if (big)
+			Place(file, endOffset, BigZeroEndChunk);
+		else
+			Place(file, endOffset, zeroEnd ? LittleZeroEndChunk : LittleEndChunk);
+		return file;
+	}
+
+	bool ReadFile(const std::string& path, std::vector<uint8_t>& out)
+	{
+		std::ifstream file(path, std::ios::binary);
+		if (!file.is_open())
+			return false;
+		out.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+		return true;
+	}
+}
+
+TEST(Blf, WriteAndRead)
+{
+	ByteOrder orders[] = { ByteOrder::Little, ByteOrder::Big };
+	for (auto order : orders)
+	{
+		auto file = MakeFile(order, AuthType::Crc);
+		CHECK(IsBlf(file.data(), file.size()));
+		CHECK_EQUAL(Error::None, Validate(file.data(), file.size(), true));
+
+		Reader reader(file.data(), file.size());
+		CHECK(reader.GetByteOrder() == order);
+
+		uint32_t tags[] = { HeaderTag, ContentHeaderTag, MapVariantTag, EndTag };
+		Chunk chunk;
+		for (auto tag : tags)
+		{
+			CHECK(reader.Next(chunk));
+			CHECK_EQUAL(tag, chunk.Header.Tag);
+		}
+		CHECK(!reader.Next(chunk));
+		CHECK_EQUAL(Error::None, reader.GetError());
+
+		CHECK(reader.Find(MapVariantTag, chunk));
+		CHECK_EQUAL(12, chunk.Header.MajorVersion);
+		CHECK_EQUAL(1, chunk.Header.MinorVersion);
+		CHECK_EQUAL(0x20U, chunk.DataSize);
+
+		// values in the data come out in the file's byte order
+		uint32_t val;
+		CHECK(reader.Read(chunk, 4, val));
+		if (order == ByteOrder::Little)
+			CHECK_EQUAL(0x07060504U, val);
+		else
+			CHECK_EQUAL(0x04050607U, val);
+		CHECK(!reader.Read(chunk, 0x1D, val));
+
+		CHECK(!reader.Find('abcd', chunk));
+		CHECK_EQUAL(Error::MissingChunk, reader.GetError());
+	}
+}
+
+TEST(Blf, NoAuth)
+{
+	auto file = MakeFile(ByteOrder::Little, AuthType::None);
+	CHECK_EQUAL(Error::None, Validate(file.data(), file.size(), true));
+}
+
+TEST(Blf, PaddingAfterEnd)
+{
+	// the game pads variants out to a fixed size
+	auto file = MakeFile(ByteOrder::Little, AuthType::Crc);
+	file.resize(0xE1F0, 0);
+	CHECK_EQUAL(Error::None, Validate(file.data(), file.size(), true));
+}
+
+TEST(Blf, NotBlf)
+{
+	uint8_t small[4] = { '_', 'b', 'l', 'f' };
+	CHECK(!IsBlf(small, sizeof(small)));
+	CHECK_EQUAL(Error::TooSmall, Validate(small, sizeof(small)));
+
+	uint8_t garbage[0x40] = { 0 };
+	CHECK(!IsBlf(garbage, sizeof(garbage)));
+	CHECK_EQUAL(Error::NotBlf, Validate(garbage, sizeof(garbage)));
+}
+
+TEST(Blf, BadChunkSize)
+{
+	auto file = MakeFile(ByteOrder::Little, AuthType::Crc);
+	Reader reader(file.data(), file.size());
+	Chunk chunk;
+	CHECK(reader.Find(ContentHeaderTag, chunk));
+
+	// smaller than a chunk header
+	auto tooSmall = file;
+	tooSmall[chunk.Offset + 4] = 4;
+	CHECK_EQUAL(Error::BadChunkSize, Validate(tooSmall.data(), tooSmall.size()));
+
+	// past the end of the file
+	auto tooBig = file;
+	tooBig[chunk.Offset + 6] = 1;
+	CHECK_EQUAL(Error::BadChunkSize, Validate(tooBig.data(), tooBig.size()));
+}
+
+TEST(Blf, MissingEnd)
+{
+	auto file = MakeFile(ByteOrder::Little, AuthType::Crc);
+	Reader reader(file.data(), file.size());
+	Chunk chunk;
+	CHECK(reader.Find(EndTag, chunk));
+	file.resize(chunk.Offset);
+	CHECK_EQUAL(Error::MissingEnd, Validate(file.data(), file.size()));
+}
+
+TEST(Blf, EndChecksOnlyWhenAsked)
+{
+	auto file = MakeFile(ByteOrder::Big, AuthType::Crc);
+	Reader reader(file.data(), file.size());
+	Chunk chunk;
+	CHECK(reader.Find(MapVariantTag, chunk));
+
+	auto corrupt = file;
+	corrupt[chunk.Offset + ChunkHeaderSize] ^= 0xFF;
+	CHECK_EQUAL(Error::ChecksumMismatch, Validate(corrupt.data(), corrupt.size(), true));
+	CHECK_EQUAL(Error::None, Validate(corrupt.data(), corrupt.size()));
+
+	CHECK(reader.Find(EndTag, chunk));
+	auto badLength = file;
+	badLength[chunk.Offset + ChunkHeaderSize + 3] ^= 1; // lowest byte of the big-endian length
+	CHECK_EQUAL(Error::BadEnd, Validate(badLength.data(), badLength.size(), true));
+	CHECK_EQUAL(Error::None, Validate(badLength.data(), badLength.size()));
+}
+
+TEST(Blf, Crc32)
+{
+	// standard check value
+	CHECK_EQUAL(0xCBF43926U, Crc32("123456789", 9));
+	CHECK_EQUAL(0U, Crc32("", 0));
+}
+
+TEST(Blf, MapVariantFixture)
+{
+	auto file = MakeVariant(false, true, MapVariantBufferSize, false);
+	CHECK(IsBlf(file.data(), file.size()));
+	CHECK_EQUAL(Error::None, Validate(file.data(), file.size()));
+	CHECK_EQUAL(Error::None, Validate(file.data(), file.size(), true)); // the length is filled in and there's no checksum
+
+	Reader reader(file.data(), file.size());
+	Chunk chunk;
+	CHECK(reader.Find(MapVariantTag, chunk));
+	CHECK_EQUAL(HeaderChunkSize + ContentHeaderSize, chunk.Offset);
+	CHECK_EQUAL(12, chunk.Header.MajorVersion);
+	CHECK_EQUAL(MapVariantChunkSize - ChunkHeaderSize, chunk.DataSize);
+
+	std::vector<uint8_t> buffer;
+	CHECK_EQUAL(Error::None, ReadIntoBuffer(file.data(), file.size(), MapVariantTag, MapVariantBufferSize, buffer));
+	CHECK_EQUAL(MapVariantBufferSize, buffer.size());
+	CHECK(buffer == file);
+
+	// a game variant isn't a map variant
+	CHECK_EQUAL(Error::MissingChunk, ReadIntoBuffer(file.data(), file.size(), GameVariantTag, GameVariantBufferSize, buffer));
+}
+
+TEST(Blf, GameVariantFixture)
+{
+	// not padded out, and the _eof length is left at zero
+	auto file = MakeVariant(false, false, HeaderChunkSize + ContentHeaderSize + GameVariantChunkSize + sizeof(LittleZeroEndChunk), true);
+	CHECK_EQUAL(Error::None, Validate(file.data(), file.size()));
+	CHECK_EQUAL(Error::BadEnd, Validate(file.data(), file.size(), true));
+
+	// gets padded out to the size of the game's buffer
+	std::vector<uint8_t> buffer;
+	CHECK_EQUAL(Error::None, ReadIntoBuffer(file.data(), file.size(), GameVariantTag, GameVariantBufferSize, buffer));
+	CHECK_EQUAL(GameVariantBufferSize, buffer.size());
+	CHECK(!memcmp(buffer.data(), file.data(), file.size()));
+	for (auto i = file.size(); i < buffer.size(); i++)
+		CHECK_EQUAL(0, buffer[i]);
+
+	CHECK_EQUAL(Error::MissingChunk, ReadIntoBuffer(file.data(), file.size(), MapVariantTag, MapVariantBufferSize, buffer));
+}
+
+TEST(Blf, BigEndianGameVariantFixture)
+{
+	// 360 files are big-endian
+	auto file = MakeVariant(true, false, GameVariantBufferSize, true);
+	Reader reader(file.data(), file.size());
+	CHECK(reader.GetByteOrder() == ByteOrder::Big);
+
+	Chunk chunk;
+	CHECK(reader.Find(GameVariantTag, chunk));
+	CHECK_EQUAL(10, chunk.Header.MajorVersion);
+	CHECK_EQUAL(GameVariantChunkSize, chunk.Header.Size);
+
+	std::vector<uint8_t> buffer;
+	CHECK_EQUAL(Error::None, ReadIntoBuffer(file.data(), file.size(), GameVariantTag, GameVariantBufferSize, buffer));
+}
+
+TEST(Blf, VariantTooBigForBuffer)
+{
+	// a file can be bigger than the buffer as long as the variant itself fits...
+	auto file = MakeVariant(false, false, GameVariantBufferSize + 0x100, true);
+	std::vector<uint8_t> buffer;
+	CHECK_EQUAL(Error::None, ReadIntoBuffer(file.data(), file.size(), GameVariantTag, GameVariantBufferSize, buffer));
+	CHECK_EQUAL(GameVariantBufferSize, buffer.size());
+
+	// ...but a variant chunk that runs past the end of the buffer would get cut off
+	Reader reader(file.data(), file.size());
+	Chunk chunk;
+	CHECK(reader.Find(GameVariantTag, chunk));
+	file[chunk.Offset + 4] += 0x80;
+	auto endOffset = chunk.Offset + GameVariantChunkSize + 0x80;
+	Place(file, endOffset, LittleZeroEndChunk);
+	CHECK_EQUAL(Error::None, Validate(file.data(), file.size()));
+	CHECK_EQUAL(Error::ChunkTooBig, ReadIntoBuffer(file.data(), file.size(), GameVariantTag, GameVariantBufferSize, buffer));
+
+	// and a broken file is rejected before its chunks are looked at
+	file[chunk.Offset + 6] = 1;
+	CHECK_EQUAL(Error::BadChunkSize, ReadIntoBuffer(file.data(), file.size(), GameVariantTag, GameVariantBufferSize, buffer));
+}
+
+TEST(Blf, RealFiles)
+{
+	// real map/game variants have to be passed on the command line, we can't ship any
+	auto& files = Test::GetDataFiles();
+	if (files.empty())
+		printf("  no files given, skipping (pass map/game variant files on the command line)\n");
+
+	for (auto& path : files)
+	{
+		std::vector<uint8_t> data;
+		if (!ReadFile(path, data))
+			Test::Fail(__FILE__, __LINE__, "failed to read " + path);
+
+		CHECK(IsBlf(data.data(), data.size()));
+		auto error = Validate(data.data(), data.size());
+		if (error != Error::None)
+			Test::Fail(__FILE__, __LINE__, path + ": " + GetErrorString(error));
+
+		// same checks ModuleGame does before handing a file to the game
+		std::vector<uint8_t> buffer;
+		auto mapError = ReadIntoBuffer(data.data(), data.size(), MapVariantTag, MapVariantBufferSize, buffer);
+		auto gameError = ReadIntoBuffer(data.data(), data.size(), GameVariantTag, GameVariantBufferSize, buffer);
+		if (mapError != Error::None && gameError != Error::None)
+			Test::Fail(__FILE__, __LINE__, path + ": " + GetErrorString(mapError == Error::MissingChunk ? gameError : mapError));
+
+		// not a failure, the end checks are optional, but worth knowing about
+		auto endError = Validate(data.data(), data.size(), true);
+		printf("  %s: %s with the _eof checks\n", path.c_str(), endError == Error::None ? "valid" : GetErrorString(endError));
+	}
+}
@@ -0,0 +1,167 @@
+#include "Test.hpp"
+#include "../../DewRecode/src/CallbackList.hpp"
+
+namespace
+{
+	// callbacks are plain function pointers (like EventCallback), so they talk to the tests through these
+	typedef void(*TestCallback)(int param);
+
+	CallbackList<TestCallback>* list;
+	std::vector<std::string> calls;
+
+	void Dispatch(int param)
+	{
+		list->Dispatch([&](const CallbackList<TestCallback>::Entry& entry) { entry.Callback(param); });
+	}
+
+	void First(int) { calls.push_back("First"); }
+	void Second(int) { calls.push_back("Second"); }
+	void Third(int) { calls.push_back("Third"); }
+
+	void RemovesItself(int)
+	{
+		calls.push_back("RemovesItself");
+		list->Remove(RemovesItself);
+	}
+
+	void RemovesThird(int)
+	{
+		calls.push_back("RemovesThird");
+		list->Remove(Third);
+	}
+
+	void AddsThird(int)
+	{
+		calls.push_back("AddsThird");
+		list->Add(Third);
+	}
+
+	void Recurses(int param)
+	{
+		calls.push_back("Recurses" + std::to_string(param));
+		if (param > 0)
+		{
+			list->Remove(Recurses);
+			Dispatch(param - 1);
+		}
+	}
+
+	std::vector<std::string> Calls(const char* a, const char* b = nullptr, const char* c = nullptr, const char* d = nullptr)
+	{
+		std::vector<std::string> result(1, a);
+		if (b)
+			result.push_back(b);
+		if (c)
+			result.push_back(c);
+		if (d)
+			result.push_back(d);
+		return result;
+	}
+
+	void Reset(CallbackList<TestCallback>& newList)
+	{
+		list = &newList;
+		calls.clear();
+	}
+}
+
+TEST(CallbackList, CallsInOrder)
+{
+	CallbackList<TestCallback> callbacks;
+	Reset(callbacks);
+	callbacks.Add(First);
+	callbacks.Add(Second, 5);
+	CHECK_EQUAL(2U, callbacks.Count());
+
+	uint32_t zone = 0;
+	callbacks.Dispatch([&](const CallbackList<TestCallback>::Entry& entry) { entry.Callback(0); zone += entry.Zone; });
+	CHECK(calls == Calls("First", "Second"));
+	CHECK_EQUAL(5U, zone);
+}
+
+TEST(CallbackList, RemoveSelfDoesntSkipNext)
+{
+	// removing the running callback used to shift the next one into its slot, so it got skipped
+	CallbackList<TestCallback> callbacks;
+	Reset(callbacks);
+	callbacks.Add(First);
+	callbacks.Add(RemovesItself);
+	callbacks.Add(Second);
+	callbacks.Add(Third);
+
+	Dispatch(0);
+	CHECK(calls == Calls("First", "RemovesItself", "Second", "Third"));
+	CHECK_EQUAL(3U, callbacks.Count());
+
+	calls.clear();
+	Dispatch(0);
+	CHECK(calls == Calls("First", "Second", "Third"));
+}
+
+TEST(CallbackList, RemoveLaterCallback)
+{
+	// a callback that hasn't been called yet and gets removed isn't called
+	CallbackList<TestCallback> callbacks;
+	Reset(callbacks);
+	callbacks.Add(RemovesThird);
+	callbacks.Add(Second);
+	callbacks.Add(Third);
+
+	Dispatch(0);
+	CHECK(calls == Calls("RemovesThird", "Second"));
+	CHECK_EQUAL(2U, callbacks.Count());
+}
+
+TEST(CallbackList, AddDuringDispatch)
+{
+	// callbacks added while dispatching start being called on the next dispatch
+	CallbackList<TestCallback> callbacks;
+	Reset(callbacks);
+	callbacks.Add(AddsThird);
+	for (int i = 0; i < 64; i++)
+		callbacks.Add(First); // makes the vector reallocate when AddsThird adds to it
+
+	Dispatch(0);
+	CHECK_EQUAL(65U, calls.size());
+	CHECK_EQUAL(66U, callbacks.Count());
+
+	calls.clear();
+	callbacks.Remove(First);
+	callbacks.Remove(AddsThird);
+	Dispatch(0);
+	CHECK(calls == Calls("Third"));
+}
+
+TEST(CallbackList, NestedDispatch)
+{
+	// a callback that causes its own event again, and removes itself first
+	CallbackList<TestCallback> callbacks;
+	Reset(callbacks);
+	callbacks.Add(Recurses);
+	callbacks.Add(Second);
+
+	Dispatch(1);
+	CHECK(calls == Calls("Recurses1", "Second", "Second"));
+	CHECK_EQUAL(1U, callbacks.Count());
+}
+
+TEST(CallbackList, Remove)
+{
+	CallbackList<TestCallback> callbacks;
+	Reset(callbacks);
+	CHECK(callbacks.IsEmpty());
+	CHECK(!callbacks.Remove(First));
+
+	callbacks.Add(First);
+	callbacks.Add(Second);
+	callbacks.Add(First);
+	CHECK(callbacks.Remove(First)); // every registration of it
+	CHECK_EQUAL(1U, callbacks.Count());
+	CHECK(!callbacks.Remove(First));
+
+	Dispatch(0);
+	CHECK(calls == Calls("Second"));
+
+	CHECK(callbacks.Remove(Second));
+	CHECK(callbacks.IsEmpty());
+}
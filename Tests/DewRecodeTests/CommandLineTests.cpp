@@ -0,0 +1,297 @@
+#include "Test.hpp"
+#include "../../DewRecode/src/CommandLine.hpp"
+#include <cstdlib>
+#include <cstring>
+
+namespace
+{
+	// the CommandLineToArgvA that Commands used before TokenizeCommandLine, kept as it was so the tokenizer can be checked against it
+	char** CommandLineToArgvA(char* CmdLine, int* _argc)
+	{
+		char** argv;
+		char*  _argv;
+		unsigned long len;
+		unsigned long argc;
+		char   a;
+		unsigned long i, j;
+
+		bool in_QM;
+		bool in_TEXT;
+		bool in_SPACE;
+
+		len = strlen(CmdLine);
+		i = ((len + 2) / 2)*sizeof(void*) + sizeof(void*);
+
+		argv = (char**)malloc(i + (len + 2)*sizeof(char));
+
+		if (!argv)
+			return 0;
+
+		_argv = (char*)(((unsigned char*)argv) + i);
+
+		argc = 0;
+		argv[argc] = _argv;
+		in_QM = false;
+		in_TEXT = false;
+		in_SPACE = true;
+		i = 0;
+		j = 0;
+
+		while ((a = CmdLine[i])) {
+			if (in_QM) {
+				if (a == '\"') {
+					in_QM = false;
+				}
+				else {
+					_argv[j] = a;
+					j++;
+				}
+			}
+			else {
+				switch (a) {
+				case '\"':
+					in_QM = true;
+					in_TEXT = true;
+					if (in_SPACE) {
+						argv[argc] = _argv + j;
+						argc++;
+					}
+					in_SPACE = false;
+					break;
+				case ' ':
+				case '\t':
+				case '\n':
+				case '\r':
+					if (in_TEXT) {
+						_argv[j] = '\0';
+						j++;
+					}
+					in_TEXT = false;
+					in_SPACE = true;
+					break;
+				default:
+					in_TEXT = true;
+					if (in_SPACE) {
+						argv[argc] = _argv + j;
+						argc++;
+					}
+					_argv[j] = a;
+					j++;
+					in_SPACE = false;
+					break;
+				}
+			}
+			i++;
+		}
+		_argv[j] = '\0';
+		argv[argc] = NULL;
+
+		(*_argc) = argc;
+		return argv;
+	}
+
+	// Splits a line with the old function, the way Commands used to call it
+	std::vector<std::string> OldSplit(const std::string& line)
+	{
+		std::vector<char> buffer(line.begin(), line.end());
+		buffer.push_back('\0');
+		int argc = 0;
+		auto argv = CommandLineToArgvA(buffer.data(), &argc);
+		std::vector<std::string> result(argv, argv + argc);
+		free(argv);
+		return result;
+	}
+
+	std::vector<std::string> NewSplit(const std::string& line)
+	{
+		std::string name;
+		std::vector<std::string> args;
+		std::vector<std::string> result;
+		if (!TokenizeCommandLine(line, name, args))
+			return result;
+		result.push_back(name);
+		result.insert(result.end(), args.begin(), args.end());
+		return result;
+	}
+
+	void CheckSameAsOld(const char* file, int line, const std::string& commandLine)
+	{
+		auto expected = OldSplit(commandLine);
+		auto actual = NewSplit(commandLine);
+		if (expected == actual)
+			return;
+
+		std::string message = "tokenizing [" + commandLine + "]: expected";
+		for (auto& arg : expected)
+			message += " [" + arg + "]";
+		message += ", got";
+		for (auto& arg : actual)
+			message += " [" + arg + "]";
+		Test::Fail(file, line, message);
+	}
+}
+
+#define CHECK_SAME_AS_OLD(line) CheckSameAsOld(__FILE__, __LINE__, line)
+
+TEST(CommandLine, Basic)
+{
+	std::vector<std::string> expected;
+	expected.push_back("Game.Map");
+	expected.push_back("guardian");
+	CHECK(NewSplit("Game.Map guardian") == expected);
+	CHECK(NewSplit("  Game.Map\t\tguardian \r\n") == expected);
+
+	CHECK(NewSplit("").empty());
+	CHECK(NewSplit(" \t\r\n").empty());
+}
+
+TEST(CommandLine, Quotes)
+{
+	std::vector<std::string> expected;
+	expected.push_back("Server.Name");
+	expected.push_back("my server");
+	expected.push_back("");
+	expected.push_back("abc def");
+	CHECK(NewSplit("Server.Name \"my server\" \"\" ab\"c d\"ef") == expected);
+
+	// an unterminated quote runs to the end of the line
+	auto unterminated = NewSplit("say \"hello there ");
+	CHECK_EQUAL(2U, unterminated.size());
+	CHECK_EQUAL(std::string("hello there "), unterminated[1]);
+}
+
+TEST(CommandLine, SameAsCommandLineToArgvA)
+{
+	const char* lines[] =
+	{
+		"", " ", "a", "a b", " a  b ", "\"\"", "\"\" \"\"", "a\"\"b", "\"a b\"c", "a\" b \"c d",
+		"\"unterminated", "a \"", "\t\r\na\n", "Input.Bind F +Player.Jump", "Game.Map \"forge world\" 1",
+		"say \"quotes \"\"inside\"\" quotes\"", "x \\\"y\\\" z", "\"\"\"\"", "a\"\"", "\"a\"\"b\"",
+	};
+	for (auto line : lines)
+		CHECK_SAME_AS_OLD(line);
+}
+
+TEST(CommandLine, RandomSameAsCommandLineToArgvA)
+{
+	// random lines made of the characters the tokenizer cares about
+	const char chars[] = { 'a', 'b', ' ', ' ', '\t', '\r', '\n', '\"', '\"', '\\', '+' };
+	uint32_t state = 12345;
+	for (int i = 0; i < 20000; i++)
+	{
+		std::string line;
+		state = state * 1103515245 + 12345;
+		auto length = (state >> 16) % 16;
+		for (uint32_t j = 0; j < length; j++)
+		{
+			state = state * 1103515245 + 12345;
+			line += chars[(state >> 16) % sizeof(chars)];
+		}
+		CHECK_SAME_AS_OLD(line);
+	}
+}
+
+TEST(CommandLine, StopsAtNull)
+{
+	// CommandLineToArgvA worked on C strings
+	std::string line("a b");
+	line += '\0';
+	line += " c";
+	CHECK_EQUAL(2U, NewSplit(line).size());
+}
+
+TEST(CommandLine, Range)
+{
+	std::string lines = "first a b\nsecond \"c d\"\n\nthird";
+	std::string name;
+	std::vector<std::string> args, spare;
+
+	CHECK(TokenizeCommandLine(lines, 0, 9, name, args, spare));
+	CHECK_EQUAL(std::string("first"), name);
+	CHECK_EQUAL(2U, args.size());
+
+	CHECK(TokenizeCommandLine(lines, 10, 22, name, args, spare));
+	CHECK_EQUAL(std::string("second"), name);
+	CHECK_EQUAL(1U, args.size());
+	CHECK_EQUAL(std::string("c d"), args[0]);
+
+	CHECK(!TokenizeCommandLine(lines, 23, 23, name, args, spare));
+	CHECK(TokenizeCommandLine(lines, 24, lines.length(), name, args, spare));
+	CHECK_EQUAL(std::string("third"), name);
+	CHECK(args.empty());
+}
+
+TEST(CommandLine, ReusesStrings)
+{
+	// once the strings have grown, splitting lines like them again shouldn't need to allocate
+	std::string longLine = "Some.Command a_long_argument_that_needs_the_heap another_long_argument_on_the_heap";
+	std::string shortLine = "Other.Command short";
+	std::string name;
+	std::vector<std::string> args, spare;
+	TokenizeCommandLine(longLine, 0, longLine.length(), name, args, spare);
+	CHECK_EQUAL(2U, args.size());
+	auto first = args[0].data();
+	auto second = args[1].data();
+
+	// fewer arguments, the unused one goes to spare instead of being freed
+	TokenizeCommandLine(shortLine, 0, shortLine.length(), name, args, spare);
+	CHECK_EQUAL(1U, args.size());
+	CHECK_EQUAL(1U, spare.size());
+	CHECK(args[0].data() == first);
+
+	TokenizeCommandLine(longLine, 0, longLine.length(), name, args, spare);
+	CHECK_EQUAL(2U, args.size());
+	CHECK(spare.empty());
+	CHECK(args[0].data() == first);
+	CHECK(args[1].data() == second);
+	CHECK_EQUAL(std::string("another_long_argument_on_the_heap"), args[1]);
+}
+
+TEST(CommandLine, Compile)
+{
+	std::string name;
+	CompiledCommand compiled;
+	CHECK(CompileCommandLine("Game.Map \"forge world\" 1", name, compiled));
+	CHECK_EQUAL(std::string("Game.Map"), name);
+	CHECK(!compiled.IsHold);
+	CHECK_EQUAL(2U, compiled.Arguments.size());
+	CHECK(compiled.PressArguments.empty());
+	CHECK(compiled.ReleaseArguments.empty());
+
+	CHECK(!CompileCommandLine("", name, compiled));
+	CHECK(!CompileCommandLine("+", name, compiled));
+}
+
+TEST(CommandLine, CompileHold)
+{
+	// hold bindings get "1" added when the key goes down and "0" when it comes back up, built once here instead of on every key press
+	std::string name;
+	CompiledCommand compiled;
+	CHECK(CompileCommandLine("+Player.Jump", name, compiled));
+	CHECK_EQUAL(std::string("Player.Jump"), name);
+	CHECK(compiled.IsHold);
+	CHECK(compiled.Arguments.empty());
+	CHECK_EQUAL(1U, compiled.PressArguments.size());
+	CHECK_EQUAL(std::string("1"), compiled.PressArguments[0]);
+	CHECK_EQUAL(1U, compiled.ReleaseArguments.size());
+	CHECK_EQUAL(std::string("0"), compiled.ReleaseArguments[0]);
+
+	CHECK(CompileCommandLine("+Camera.Zoom 2 \"a b\"", name, compiled));
+	CHECK_EQUAL(std::string("Camera.Zoom"), name);
+	CHECK_EQUAL(2U, compiled.Arguments.size());
+	CHECK_EQUAL(3U, compiled.PressArguments.size());
+	CHECK_EQUAL(std::string("a b"), compiled.PressArguments[1]);
+	CHECK_EQUAL(std::string("1"), compiled.PressArguments[2]);
+	CHECK_EQUAL(std::string("0"), compiled.ReleaseArguments[2]);
+
+	// compiling something else into it drops the hold arguments
+	CHECK(CompileCommandLine("Game.Start", name, compiled));
+	CHECK(!compiled.IsHold);
+	CHECK(compiled.PressArguments.empty());
+	CHECK(compiled.ReleaseArguments.empty());
+
+	// a + that isn't at the start is just part of the name
+	CHECK(CompileCommandLine(" +Player.Jump", name, compiled));
+	CHECK(!compiled.IsHold);
+	CHECK_EQUAL(std::string("+Player.Jump"), name);
+}
@@ -0,0 +1,61 @@
+#include "Test.hpp"
+#include "../../DewRecode/src/CommandName.hpp"
+#include <unordered_map>
+
+namespace
+{
+	typedef std::unordered_map<std::string, int, CommandNameHash, CommandNameEqual> NameMap;
+}
+
+TEST(CommandName, HashIgnoresCase)
+{
+	CommandNameHash hash;
+	CHECK_EQUAL(hash("Game.Map"), hash("game.map"));
+	CHECK_EQUAL(hash("Game.Map"), hash("GAME.MAP"));
+	CHECK(hash("Game.Map") != hash("Game.Mao"));
+	CHECK(hash("") != hash("a"));
+}
+
+TEST(CommandName, EqualIgnoresCase)
+{
+	CommandNameEqual equal;
+	CHECK(equal("Server.Name", "server.NAME"));
+	CHECK(!equal("Server.Name", "Server.Names"));
+	CHECK(!equal("Server.Name", "Server.Nama"));
+	CHECK(equal("", ""));
+}
+
+TEST(CommandName, IndexFindsAnyCase)
+{
+	NameMap index;
+	index["Game.Map"] = 1;
+	index["map"] = 1; // short name
+	index["Server.Name"] = 2;
+
+	CHECK_EQUAL(3U, index.size());
+	CHECK(index.find("GAME.map") != index.end());
+	CHECK_EQUAL(1, index.find("Map")->second);
+	CHECK_EQUAL(2, index.find("server.name")->second);
+	CHECK(index.find("Server.Nam") == index.end());
+	CHECK(index.find("") == index.end());
+
+	// adding a name again in a different case replaces it instead of adding a second entry
+	index["SERVER.NAME"] = 3;
+	CHECK_EQUAL(3U, index.size());
+	CHECK_EQUAL(3, index.find("Server.Name")->second);
+}
+
+TEST(CommandName, IndexWithManyNames)
+{
+	NameMap index;
+	for (int i = 0; i < 1000; i++)
+		index["Module" + std::to_string(i % 10) + ".Variable" + std::to_string(i)] = i;
+
+	CHECK_EQUAL(1000U, index.size());
+	for (int i = 0; i < 1000; i++)
+	{
+		auto it = index.find("MODULE" + std::to_string(i % 10) + ".variable" + std::to_string(i));
+		CHECK(it != index.end());
+		CHECK_EQUAL(i, it->second);
+	}
+}
@@ -0,0 +1,154 @@
+#include "Test.hpp"
+#include "../../DewRecode/src/CompletionIndex.hpp"
+
+namespace
+{
+	void BuildIndex(CompletionIndex& index)
+	{
+		const char* strings[] = { "Game.Map", "Game.Name", "game.map", "Server.Name", "Server.Port", "Server", "Input.Bind", "ServerBrowser.Show" };
+		for (auto str : strings)
+			index.Add(str);
+		index.Build();
+	}
+
+	std::vector<std::string> GetRange(const CompletionIndex& index, size_t first, size_t last)
+	{
+		std::vector<std::string> result;
+		for (auto i = first; i < last; i++)
+			result.push_back(index.Get(i));
+		return result;
+	}
+}
+
+TEST(CompletionIndex, SortsAndRemovesDuplicates)
+{
+	CompletionIndex index;
+	BuildIndex(index);
+
+	// "game.map" only differs by case, the first one added is kept
+	CHECK_EQUAL(7U, index.Size());
+	CHECK_EQUAL(std::string("Game.Map"), index.Get(0));
+	CHECK_EQUAL(std::string("Game.Name"), index.Get(1));
+	CHECK_EQUAL(std::string("Input.Bind"), index.Get(2));
+	CHECK_EQUAL(std::string("Server"), index.Get(3));
+}
+
+TEST(CompletionIndex, FindPrefix)
+{
+	CompletionIndex index;
+	BuildIndex(index);
+
+	size_t first, last;
+	index.FindPrefix("server", first, last);
+	auto matches = GetRange(index, first, last);
+	CHECK_EQUAL(4U, matches.size());
+	CHECK_EQUAL(std::string("Server"), matches[0]);
+	CHECK_EQUAL(std::string("ServerBrowser.Show"), matches[3]);
+
+	index.FindPrefix("SERVER.", first, last);
+	CHECK_EQUAL(2U, last - first);
+
+	index.FindPrefix("", first, last);
+	CHECK_EQUAL(0U, first);
+	CHECK_EQUAL(index.Size(), last);
+
+	index.FindPrefix("Serverx", first, last);
+	CHECK_EQUAL(first, last);
+
+	index.FindPrefix("Game.Map.Extra", first, last);
+	CHECK_EQUAL(first, last);
+}
+
+TEST(CompletionIndex, CursorNarrowsOneCharacterAtATime)
+{
+	CompletionIndex index;
+	BuildIndex(index);
+
+	auto cursor = index.Begin();
+	size_t first, last;
+	std::string typed = "Server.N";
+	size_t expectedCounts[] = { 4, 4, 4, 4, 4, 4, 2, 1 };
+	for (size_t i = 0; i < typed.length(); i++)
+	{
+		CHECK(index.Advance(cursor, typed[i]));
+		CHECK_EQUAL(i + 1, cursor.Length);
+
+		// has to agree with searching for the whole prefix from scratch
+		size_t prefixFirst, prefixLast;
+		index.FindPrefix(typed.substr(0, i + 1), prefixFirst, prefixLast);
+		index.GetRange(cursor, first, last);
+		CHECK_EQUAL(prefixFirst, first);
+		CHECK_EQUAL(prefixLast, last);
+		CHECK_EQUAL(expectedCounts[i], last - first);
+	}
+	CHECK_EQUAL(std::string("Server.Name"), index.Get(first));
+
+	// once nothing matches the cursor stays invalid
+	CHECK(!index.Advance(cursor, 'x'));
+	CHECK(!cursor.Valid);
+	CHECK(!index.Advance(cursor, 'a'));
+	index.GetRange(cursor, first, last);
+	CHECK_EQUAL(first, last);
+}
+
+TEST(CompletionIndex, CursorInvalidAfterRebuild)
+{
+	CompletionIndex index;
+	BuildIndex(index);
+
+	auto cursor = index.Begin();
+	CHECK(index.Advance(cursor, std::string("Game")));
+	CHECK(index.IsCurrent(cursor));
+
+	index.Add("Game.Type");
+	index.Build();
+	CHECK(!index.IsCurrent(cursor));
+	CHECK(!index.Advance(cursor, '.'));
+
+	size_t first, last;
+	index.FindPrefix("game.", first, last);
+	CHECK_EQUAL(3U, last - first);
+}
+
+TEST(CompletionIndex, CommonPrefix)
+{
+	CompletionIndex index;
+	BuildIndex(index);
+
+	size_t first, last;
+	index.FindPrefix("se", first, last);
+	CHECK_EQUAL(std::string("Server"), index.GetCommonPrefix(first, last));
+	index.FindPrefix("server.", first, last);
+	CHECK_EQUAL(std::string("Server."), index.GetCommonPrefix(first, last));
+	CHECK_EQUAL(std::string(""), index.GetCommonPrefix(first, first));
+}
+
+TEST(CompletionIndex, EmptyIndex)
+{
+	CompletionIndex index;
+	index.Build();
+
+	auto cursor = index.Begin();
+	CHECK(!index.Advance(cursor, 'a'));
+
+	size_t first, last;
+	index.FindPrefix("", first, last);
+	CHECK_EQUAL(first, last);
+}
+
+TEST(CompletionIndex, FuzzyFind)
+{
+	CompletionIndex index;
+	BuildIndex(index);
+
+	std::vector<CompletionIndex::FuzzyMatch> results;
+	index.FuzzyFind("svnm", 10, results);
+	CHECK(!results.empty());
+	CHECK_EQUAL(std::string("Server.Name"), index.Get(results[0].Index));
+
+	index.FuzzyFind("zzz", 10, results);
+	CHECK(results.empty());
+
+	index.FuzzyFind("e", 2, results);
+	CHECK_EQUAL(2U, results.size());
+}
@@ -0,0 +1,203 @@
+#include "Test.hpp"
+#include "../../DewRecode/src/ConsoleLine.hpp"
+
+namespace
+{
+	std::vector<int> Contents(const Utils::RingBuffer<int>& buffer)
+	{
+		std::vector<int> items;
+		for (size_t i = 0; i < buffer.Size(); i++)
+			items.push_back(buffer.At(i));
+		return items;
+	}
+
+	std::vector<int> Range(int first, int last)
+	{
+		std::vector<int> items;
+		for (int i = first; i <= last; i++)
+			items.push_back(i);
+		return items;
+	}
+
+	std::vector<std::string> Rows(ConsoleLine& line, int charWidth, int viewportWidth)
+	{
+		std::vector<std::string> rows;
+		auto count = line.Wrap(charWidth, viewportWidth);
+		for (size_t i = 0; i < count; i++)
+			rows.push_back(line.GetRow(i));
+		return rows;
+	}
+}
+
+TEST(RingBuffer, FillAndWrap)
+{
+	Utils::RingBuffer<int> buffer(4);
+	CHECK(buffer.Empty());
+	CHECK_EQUAL(4U, buffer.Capacity());
+
+	for (int i = 0; i < 3; i++)
+		buffer.Push(i);
+	CHECK(!buffer.Full());
+	CHECK(Contents(buffer) == Range(0, 2));
+	CHECK_EQUAL(2, buffer.Back());
+
+	// once it's full the oldest items get replaced, many times round
+	for (int i = 3; i < 23; i++)
+	{
+		buffer.Push(i);
+		CHECK(buffer.Full());
+		CHECK_EQUAL(4U, buffer.Size());
+		CHECK_EQUAL(i, buffer.Back());
+	}
+	CHECK(Contents(buffer) == Range(19, 22));
+
+	buffer.Clear();
+	CHECK(buffer.Empty());
+	buffer.Push(100);
+	CHECK(Contents(buffer) == Range(100, 100));
+}
+
+TEST(RingBuffer, PushReusesSlots)
+{
+	// Push() hands back the slot that's being replaced, so the oldest item's memory can be reused
+	Utils::RingBuffer<std::string> buffer(2);
+	buffer.Push() = "first";
+	buffer.Push() = "second";
+	auto& slot = buffer.Push();
+	CHECK_EQUAL(std::string("first"), slot);
+	slot = "third";
+	CHECK_EQUAL(std::string("second"), buffer.At(0));
+	CHECK_EQUAL(std::string("third"), buffer.At(1));
+}
+
+TEST(RingBuffer, SetCapacity)
+{
+	Utils::RingBuffer<int> buffer(5);
+	for (int i = 0; i < 8; i++)
+		buffer.Push(i);
+	CHECK(Contents(buffer) == Range(3, 7));
+
+	// shrinking keeps the newest items
+	buffer.SetCapacity(3);
+	CHECK_EQUAL(3U, buffer.Capacity());
+	CHECK(Contents(buffer) == Range(5, 7));
+	buffer.Push(8);
+	CHECK(Contents(buffer) == Range(6, 8));
+
+	// growing keeps everything and has room for more
+	buffer.SetCapacity(6);
+	CHECK(Contents(buffer) == Range(6, 8));
+	for (int i = 9; i < 14; i++)
+		buffer.Push(i);
+	CHECK(Contents(buffer) == Range(8, 13));
+
+	// a capacity of 0 still holds the newest item
+	buffer.SetCapacity(0);
+	CHECK_EQUAL(1U, buffer.Capacity());
+	CHECK(Contents(buffer) == Range(13, 13));
+	Utils::RingBuffer<int> empty(0);
+	empty.Push(1);
+	empty.Push(2);
+	CHECK(Contents(empty) == Range(2, 2));
+}
+
+TEST(ConsoleLine, Fits)
+{
+	ConsoleLine line;
+	line.Set("short line");
+	CHECK_EQUAL(1U, line.Wrap(8, 800));
+	CHECK_EQUAL(std::string("short line"), line.GetRow(0));
+
+	line.Set("");
+	CHECK_EQUAL(1U, line.Wrap(8, 800));
+	CHECK_EQUAL(std::string(""), line.GetRow(0));
+
+	// exactly as wide as the viewport
+	line.Set("0123456789");
+	CHECK_EQUAL(1U, line.Wrap(8, 80));
+}
+
+TEST(ConsoleLine, WrapsAtSpaces)
+{
+	// 10 characters per row
+	ConsoleLine line;
+	line.Set("the quick brown fox jumps over the lazy dog");
+	std::vector<std::string> expected;
+	expected.push_back("the quick");
+	expected.push_back("brown fox");
+	expected.push_back("jumps over");
+	expected.push_back("the lazy");
+	expected.push_back("dog");
+	CHECK(Rows(line, 8, 80) == expected);
+
+	// runs of spaces at a break don't start the next row either
+	line.Set("aaaaaaaaaa   bbb");
+	expected.clear();
+	expected.push_back("aaaaaaaaaa");
+	expected.push_back("bbb");
+	CHECK(Rows(line, 8, 80) == expected);
+}
+
+TEST(ConsoleLine, LongWords)
+{
+	// no space in the second half of the row, so it's cut at the row width
+	ConsoleLine line;
+	line.Set("ab 0123456789abcdefghij");
+	std::vector<std::string> expected;
+	expected.push_back("ab 0123456");
+	expected.push_back("789abcdefg");
+	expected.push_back("hij");
+	CHECK(Rows(line, 8, 80) == expected);
+
+	// a viewport narrower than a character still makes progress
+	line.Set("abc");
+	CHECK_EQUAL(3U, line.Wrap(8, 4));
+	CHECK_EQUAL(std::string("c"), line.GetRow(2));
+	CHECK_EQUAL(3U, line.Wrap(0, 800));
+}
+
+TEST(ConsoleLine, WrapIsCached)
+{
+	ConsoleLine line;
+	line.Set("the quick brown fox jumps over the lazy dog");
+	CHECK_EQUAL(5U, line.Wrap(8, 80));
+	auto row = &line.GetRow(1);
+
+	// same font and viewport, the rows are reused rather than rebuilt
+	CHECK_EQUAL(5U, line.Wrap(8, 80));
+	CHECK(&line.GetRow(1) == row);
+	CHECK_EQUAL(std::string("brown fox"), *row);
+
+	// either one changing re-wraps it
+	CHECK_EQUAL(3U, line.Wrap(8, 160));
+	CHECK_EQUAL(std::string("jumps over the lazy"), line.GetRow(1));
+	CHECK_EQUAL(5U, line.Wrap(16, 160));
+	CHECK_EQUAL(std::string("brown fox"), line.GetRow(1));
+	CHECK_EQUAL(1U, line.Wrap(16, 1600));
+	CHECK_EQUAL(line.Text, line.GetRow(0));
+
+	// so does changing the text, even with the same font and viewport
+	line.Set("replaced");
+	CHECK_EQUAL(1U, line.Wrap(16, 1600));
+	CHECK_EQUAL(std::string("replaced"), line.GetRow(0));
+	line.Set("the quick brown fox jumps over the lazy dog");
+	CHECK_EQUAL(5U, line.Wrap(16, 160));
+}
+
+TEST(ConsoleBufferHistory, ReusesLines)
+{
+	// what ModuleConsole::CollectLines does with each new line, only the newest scrollback lines are kept
+	ConsoleBufferHistory history(3, 2);
+	for (int i = 0; i < 10; i++)
+		history.Lines.Push().Set("line " + std::to_string(i));
+	CHECK_EQUAL(3U, history.Lines.Size());
+	CHECK_EQUAL(std::string("line 7"), history.Lines.At(0).Text);
+	CHECK_EQUAL(std::string("line 9"), history.Lines.Back().Text);
+
+	// a reused slot doesn't keep the old line's wrapping
+	history.Lines.At(0).Wrap(8, 24);
+	history.Lines.Push().Set("a line that's long enough to wrap");
+	CHECK_EQUAL(std::string("line 8"), history.Lines.At(0).Text);
+	CHECK_EQUAL(3U, history.Lines.Back().Wrap(8, 120));
+	CHECK_EQUAL(std::string("a line that's"), history.Lines.Back().GetRow(0));
+}
@@ -0,0 +1,405 @@
+#include "Test.hpp"
+#include "../../DewRecode/src/ContentIndexer.hpp"
+#include "../../DewRecode/src/Blf.hpp"
+#include <map>
+#include <mutex>
+#include <set>
+
+namespace
+{
+	// keeps the mods folder in memory, paths use backslashes like the real ones
+	class MemoryContentEnvironment : public ContentEnvironment
+	{
+	public:
+		struct File
+		{
+			std::vector<uint8_t> Data;
+			uint64_t WriteTime;
+			bool Unreadable;
+		};
+
+		std::map<std::wstring, File> Files;
+		std::map<std::wstring, int> Reads; // ReadFileStart calls for each file
+		int CacheWrites = 0;
+
+		void AddFile(const std::wstring& path, const std::vector<uint8_t>& data, uint64_t writeTime = 1)
+		{
+			File file;
+			file.Data = data;
+			file.WriteTime = writeTime;
+			file.Unreadable = false;
+			Files[path] = file;
+		}
+
+		int GetTotalReads()
+		{
+			int total = 0;
+			for (auto& pair : Reads)
+				total += pair.second;
+			return total;
+		}
+
+		uint32_t GetTime()
+		{
+			return 0;
+		}
+
+		void ListDirectory(const std::wstring& dir, std::vector<DirectoryEntry>& entries)
+		{
+			auto prefix = dir + L"\\";
+			std::set<std::wstring> dirs;
+			for (auto& pair : Files)
+			{
+				if (pair.first.compare(0, prefix.length(), prefix) != 0)
+					continue;
+
+				auto name = pair.first.substr(prefix.length());
+				auto slash = name.find(L'\\');
+				if (slash != std::wstring::npos)
+				{
+					dirs.insert(name.substr(0, slash));
+					continue;
+				}
+
+				DirectoryEntry entry;
+				entry.Name = name;
+				entry.IsDirectory = false;
+				entry.WriteTime = pair.second.WriteTime;
+				entry.Size = pair.second.Data.size();
+				entries.push_back(entry);
+			}
+			for (auto& name : dirs)
+			{
+				DirectoryEntry entry;
+				entry.Name = name;
+				entry.IsDirectory = true;
+				entry.WriteTime = 0;
+				entry.Size = 0;
+				entries.push_back(entry);
+			}
+		}
+
+		bool ReadFileStart(const std::wstring& path, size_t length, std::vector<uint8_t>& data)
+		{
+			{
+				std::lock_guard<std::mutex> guard(readLock);
+				Reads[path]++;
+			}
+			auto it = Files.find(path);
+			if (it == Files.end() || it->second.Unreadable)
+				return false;
+			if (length > it->second.Data.size())
+				length = it->second.Data.size();
+			data.assign(it->second.Data.begin(), it->second.Data.begin() + length);
+			return true;
+		}
+
+		bool ReadFile(const std::wstring& path, std::vector<uint8_t>& data)
+		{
+			auto it = Files.find(path);
+			if (it == Files.end())
+				return false;
+			data = it->second.Data;
+			return true;
+		}
+
+		bool ReplaceFile(const std::wstring& path, const std::vector<uint8_t>& data)
+		{
+			CacheWrites++;
+			AddFile(path, data);
+			return true;
+		}
+
+	private:
+		std::mutex readLock;
+	};
+
+	const std::wstring ModsPath = L"C:\\game\\mods";
+	const std::wstring CachePath = ModsPath + L"\\content.cache";
+
+	std::vector<std::wstring> Roots()
+	{
+		std::vector<std::wstring> roots;
+		roots.push_back(ModsPath + L"\\variants");
+		roots.push_back(ModsPath + L"\\maps");
+		return roots;
+	}
+
+	// a variant with a content header that's different for each seed
+	std::vector<uint8_t> MakeVariant(uint8_t seed, Blam::Blf::ByteOrder order = Blam::Blf::ByteOrder::Little)
+	{
+		uint8_t header[0xFC];
+		for (size_t i = 0; i < sizeof(header); i++)
+			header[i] = static_cast<uint8_t>(seed + i);
+
+		Blam::Blf::Writer writer("test", order);
+		writer.WriteChunk(Blam::Blf::ContentHeaderTag, 9, 2, header, sizeof(header));
+		writer.WriteChunk(Blam::Blf::GameVariantTag, 10, 1, header, 0x40);
+		return writer.Finish();
+	}
+
+	std::vector<uint8_t> MakeText(size_t size)
+	{
+		return std::vector<uint8_t>(size, 'x');
+	}
+
+	// the mods folder from a typical install, two variants, a map, and some files that aren't BLFs
+	void AddDefaultFiles(MemoryContentEnvironment& env)
+	{
+		env.AddFile(ModsPath + L"\\variants\\slayer\\variant.slayer", MakeVariant(1));
+		env.AddFile(ModsPath + L"\\variants\\ctf\\variant.ctf", MakeVariant(2));
+		env.AddFile(ModsPath + L"\\variants\\readme.txt", MakeText(500));
+		env.AddFile(ModsPath + L"\\variants\\empty.txt", MakeText(0));
+		env.AddFile(ModsPath + L"\\maps\\guardian\\sandbox.map", MakeVariant(3, Blam::Blf::ByteOrder::Big));
+	}
+
+	bool HeaderMatches(const ContentIndexer::Item& item, const std::vector<uint8_t>& file)
+	{
+		std::vector<uint8_t> expected(ContentIndexer::HeaderSize, 0);
+		auto length = file.size() - ContentIndexer::HeaderOffset;
+		if (length > ContentIndexer::HeaderSize)
+			length = ContentIndexer::HeaderSize;
+		memcpy(expected.data(), &file[ContentIndexer::HeaderOffset], length);
+		return memcmp(item.Header, expected.data(), ContentIndexer::HeaderSize) == 0;
+	}
+
+	void CheckDefaultItems(MemoryContentEnvironment& env, const std::vector<ContentIndexer::Item>& items)
+	{
+		// variants first then maps, each sorted by path
+		CHECK_EQUAL(3U, items.size());
+		CHECK(items[0].Path == ModsPath + L"\\variants\\ctf\\variant.ctf");
+		CHECK(items[1].Path == ModsPath + L"\\variants\\slayer\\variant.slayer");
+		CHECK(items[2].Path == ModsPath + L"\\maps\\guardian\\sandbox.map");
+		for (auto& item : items)
+			CHECK(HeaderMatches(item, env.Files[item.Path].Data));
+	}
+}
+
+TEST(ContentIndexer, FindsContent)
+{
+	MemoryContentEnvironment env;
+	AddDefaultFiles(env);
+
+	ContentIndexer indexer(CachePath, env);
+	std::vector<ContentIndexer::Item> items;
+	ContentIndexer::Stats stats;
+	indexer.Scan(Roots(), items, &stats);
+
+	CheckDefaultItems(env, items);
+	CHECK_EQUAL(5U, stats.Files);
+	CHECK_EQUAL(3U, stats.Items);
+	CHECK_EQUAL(0U, stats.CacheHits);
+
+	// files too small to be a BLF don't get opened, the rest are opened once
+	CHECK_EQUAL(4, env.GetTotalReads());
+	CHECK_EQUAL(0, env.Reads[ModsPath + L"\\variants\\empty.txt"]);
+	CHECK_EQUAL(1, env.CacheWrites);
+	CHECK(env.Files.count(CachePath) == 1);
+}
+
+TEST(ContentIndexer, CacheRoundTrip)
+{
+	MemoryContentEnvironment env;
+	AddDefaultFiles(env);
+	std::vector<ContentIndexer::Item> items;
+	{
+		ContentIndexer indexer(CachePath, env);
+		indexer.Scan(Roots(), items, nullptr);
+	}
+
+	// the next run gets everything out of content.cache without opening any of the files, and has no reason to write it again
+	env.Reads.clear();
+	ContentIndexer indexer(CachePath, env);
+	ContentIndexer::Stats stats;
+	indexer.Scan(Roots(), items, &stats);
+	CheckDefaultItems(env, items);
+	CHECK_EQUAL(5U, stats.CacheHits);
+	CHECK_EQUAL(0, env.GetTotalReads());
+	CHECK_EQUAL(1, env.CacheWrites);
+
+	// scanning again with the same indexer uses the cache it already has
+	indexer.Scan(Roots(), items, &stats);
+	CheckDefaultItems(env, items);
+	CHECK_EQUAL(5U, stats.CacheHits);
+	CHECK_EQUAL(0, env.GetTotalReads());
+}
+
+TEST(ContentIndexer, ChangedFiles)
+{
+	MemoryContentEnvironment env;
+	AddDefaultFiles(env);
+	std::vector<ContentIndexer::Item> items;
+	ContentIndexer(CachePath, env).Scan(Roots(), items, nullptr);
+
+	// a new write time, a new size, and a text file that's been replaced by a variant
+	auto slayer = ModsPath + L"\\variants\\slayer\\variant.slayer";
+	auto ctf = ModsPath + L"\\variants\\ctf\\variant.ctf";
+	auto readme = ModsPath + L"\\variants\\readme.txt";
+	env.AddFile(slayer, MakeVariant(10), 2);
+	auto bigger = MakeVariant(11);
+	bigger.push_back(0);
+	env.Files[ctf].Data = bigger;
+	env.AddFile(readme, MakeVariant(12));
+	env.Reads.clear();
+
+	ContentIndexer::Stats stats;
+	ContentIndexer(CachePath, env).Scan(Roots(), items, &stats);
+	CHECK_EQUAL(2U, stats.CacheHits);
+	CHECK_EQUAL(3, env.GetTotalReads());
+	CHECK_EQUAL(1, env.Reads[slayer]);
+	CHECK_EQUAL(1, env.Reads[ctf]);
+	CHECK_EQUAL(1, env.Reads[readme]);
+	CHECK_EQUAL(2, env.CacheWrites);
+
+	CHECK_EQUAL(4U, items.size());
+	CHECK(items[0].Path == ctf);
+	CHECK(items[1].Path == readme);
+	CHECK(items[2].Path == slayer);
+	for (auto& item : items)
+		CHECK(HeaderMatches(item, env.Files[item.Path].Data));
+
+	// and the cache it saved has the new headers
+	env.Reads.clear();
+	ContentIndexer(CachePath, env).Scan(Roots(), items, &stats);
+	CHECK_EQUAL(5U, stats.CacheHits);
+	CHECK_EQUAL(0, env.GetTotalReads());
+	CHECK(HeaderMatches(items[2], env.Files[slayer].Data));
+}
+
+TEST(ContentIndexer, DeletedFiles)
+{
+	MemoryContentEnvironment env;
+	AddDefaultFiles(env);
+	std::vector<ContentIndexer::Item> items;
+	ContentIndexer(CachePath, env).Scan(Roots(), items, nullptr);
+
+	env.Files.erase(ModsPath + L"\\variants\\slayer\\variant.slayer");
+	env.Files.erase(ModsPath + L"\\variants\\readme.txt");
+	ContentIndexer::Stats stats;
+	ContentIndexer(CachePath, env).Scan(Roots(), items, &stats);
+	CHECK_EQUAL(2U, items.size());
+	CHECK_EQUAL(3U, stats.CacheHits);
+	CHECK_EQUAL(2, env.CacheWrites); // dropping entries changes the cache too
+
+	// a deleted file that comes back has to be read again, it was dropped from the cache
+	env.AddFile(ModsPath + L"\\variants\\slayer\\variant.slayer", MakeVariant(1));
+	env.Reads.clear();
+	ContentIndexer(CachePath, env).Scan(Roots(), items, &stats);
+	CheckDefaultItems(env, items);
+	CHECK_EQUAL(1, env.GetTotalReads());
+}
+
+TEST(ContentIndexer, UnreadableFiles)
+{
+	// a file that can't be opened (eg. it's locked) is skipped and left out of the cache, so it gets tried again next time
+	MemoryContentEnvironment env;
+	AddDefaultFiles(env);
+	auto slayer = ModsPath + L"\\variants\\slayer\\variant.slayer";
+	env.Files[slayer].Unreadable = true;
+
+	std::vector<ContentIndexer::Item> items;
+	ContentIndexer::Stats stats;
+	ContentIndexer(CachePath, env).Scan(Roots(), items, &stats);
+	CHECK_EQUAL(2U, items.size());
+	CHECK_EQUAL(2U, stats.Items);
+	CHECK_EQUAL(5U, stats.Files);
+
+	env.Files[slayer].Unreadable = false;
+	env.Reads.clear();
+	ContentIndexer(CachePath, env).Scan(Roots(), items, &stats);
+	CheckDefaultItems(env, items);
+	CHECK_EQUAL(1, env.GetTotalReads());
+	CHECK_EQUAL(1, env.Reads[slayer]);
+}
+
+TEST(ContentIndexer, ShortFiles)
+{
+	// just big enough to hold a _blf chunk, the rest of the header is zeroes
+	MemoryContentEnvironment env;
+	Blam::Blf::Writer writer("short");
+	auto file = writer.Finish(Blam::Blf::AuthType::None);
+	file.resize(ContentIndexer::HeaderOffset + 0x10, 0xAB);
+	env.AddFile(ModsPath + L"\\variants\\short.bin", file);
+	env.AddFile(ModsPath + L"\\variants\\notblf.bin", MakeText(ContentIndexer::HeaderOffset));
+
+	std::vector<ContentIndexer::Item> items;
+	ContentIndexer(CachePath, env).Scan(Roots(), items, nullptr);
+	CHECK_EQUAL(1U, items.size());
+	CHECK(items[0].Path == ModsPath + L"\\variants\\short.bin");
+	CHECK(HeaderMatches(items[0], file));
+	CHECK_EQUAL(0xAB, items[0].Header[0xF]);
+	CHECK_EQUAL(0, items[0].Header[0x10]);
+
+	// the partial header survives the cache too
+	ContentIndexer(CachePath, env).Scan(Roots(), items, nullptr);
+	CHECK_EQUAL(1U, items.size());
+	CHECK(HeaderMatches(items[0], file));
+}
+
+TEST(ContentIndexer, DamagedCache)
+{
+	MemoryContentEnvironment env;
+	AddDefaultFiles(env);
+	std::vector<ContentIndexer::Item> items;
+	ContentIndexer(CachePath, env).Scan(Roots(), items, nullptr);
+	auto good = env.Files[CachePath].Data;
+
+	// cut short at every point, a bad magic number, and a newer version, all of them mean everything is read again
+	std::vector<std::vector<uint8_t>> damaged;
+	for (size_t length = 0; length < good.size(); length += 7)
+		damaged.push_back(std::vector<uint8_t>(good.begin(), good.begin() + length));
+	damaged.push_back(good);
+	damaged.back()[0] ^= 0xFF;
+	damaged.push_back(good);
+	damaged.back()[4]++;
+
+	for (auto& data : damaged)
+	{
+		env.AddFile(CachePath, data);
+		env.Reads.clear();
+		auto writes = env.CacheWrites;
+
+		ContentIndexer::Stats stats;
+		ContentIndexer(CachePath, env).Scan(Roots(), items, &stats);
+		CheckDefaultItems(env, items);
+		CHECK_EQUAL(0U, stats.CacheHits);
+		CHECK_EQUAL(4, env.GetTotalReads());
+		CHECK_EQUAL(writes + 1, env.CacheWrites);
+		CHECK_EQUAL(good.size(), env.Files[CachePath].Data.size());
+	}
+}
+
+TEST(ContentIndexer, ManyFiles)
+{
+	// enough directories and files that the workers share the listing and reading between them
+	MemoryContentEnvironment env;
+	for (int i = 0; i < 300; i++)
+	{
+		auto dir = std::to_wstring(i % 7) + L"\\" + std::to_wstring(i % 3);
+		auto name = L"variant" + std::to_wstring(1000 + i);
+		env.AddFile(ModsPath + L"\\variants\\" + dir + L"\\" + name, i % 5 ? MakeVariant(static_cast<uint8_t>(i)) : MakeText(0x200));
+		if (i % 4 == 0)
+			env.AddFile(ModsPath + L"\\maps\\" + name + L"\\sandbox.map", MakeVariant(static_cast<uint8_t>(i), Blam::Blf::ByteOrder::Big));
+	}
+
+	std::vector<ContentIndexer::Item> first, second;
+	ContentIndexer::Stats stats;
+	ContentIndexer(CachePath, env).Scan(Roots(), first, &stats);
+	CHECK_EQUAL(375U, stats.Files);
+	CHECK_EQUAL(240U + 75U, first.size());
+	CHECK_EQUAL(375, env.GetTotalReads());
+	for (auto& pair : env.Reads)
+		CHECK_EQUAL(1, pair.second);
+
+	ContentIndexer(CachePath, env).Scan(Roots(), second, &stats);
+	CHECK_EQUAL(375U, stats.CacheHits);
+	CHECK_EQUAL(first.size(), second.size());
+	for (size_t i = 0; i < first.size(); i++)
+	{
+		CHECK(first[i].Path == second[i].Path);
+		CHECK(HeaderMatches(second[i], env.Files[second[i].Path].Data));
+		if (i > 0 && (first[i].Path.find(L"\\maps\\") == std::wstring::npos) == (first[i - 1].Path.find(L"\\maps\\") == std::wstring::npos))
+			CHECK(first[i - 1].Path < first[i].Path);
+	}
+	CHECK(first.back().Path.find(L"\\maps\\") != std::wstring::npos);
+}
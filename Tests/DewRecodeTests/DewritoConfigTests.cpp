@@ -0,0 +1,268 @@
+#include "Test.hpp"
+#include "../../DewRecode/src/DewritoConfig.hpp"
+#include <atomic>
+#include <map>
+#include <thread>
+
+namespace
+{
+	// made up files and clock, so the tests can say exactly when the file changes
+	class FakeEnvironment : public ConfigEnvironment
+	{
+	public:
+		struct File
+		{
+			std::string Contents;
+			uint64_t WriteTime;
+		};
+
+		std::atomic<uint32_t> Now; // the only thing that can change while Get is being called from other threads
+		int Reads = 0;
+		int Stats = 0;
+		std::map<std::string, File> Files;
+		std::vector<std::string> Warnings;
+
+		FakeEnvironment()
+		{
+			Now = 1000;
+		}
+
+		void Write(const std::string& name, const std::string& contents)
+		{
+			auto& file = Files[name];
+			file.Contents = contents;
+			file.WriteTime++;
+		}
+
+		uint32_t GetTime()
+		{
+			return Now;
+		}
+
+		bool GetFileInfo(const std::string& fileName, uint64_t& size, uint64_t& writeTime)
+		{
+			Stats++;
+			auto it = Files.find(fileName);
+			if (it == Files.end())
+				return false;
+			size = it->second.Contents.size();
+			writeTime = it->second.WriteTime;
+			return true;
+		}
+
+		bool ReadFile(const std::string& fileName, std::string& contents)
+		{
+			Reads++;
+			auto it = Files.find(fileName);
+			if (it == Files.end())
+				return false;
+			contents = it->second.Contents;
+			return true;
+		}
+
+		void Log(LogSeverity severity, const std::string& message)
+		{
+			if (severity == LogSeverity::Warning)
+				Warnings.push_back(message);
+		}
+	};
+
+	const std::string GoodConfig = "{ \"masterServers\": [ { \"list\": \"http://a/list\", \"announce\": \"http://a/announce\" }, { \"list\": \"http://b/list\" } ], \"updateServiceUrl\": \"http://update\" }";
+	const std::string OtherConfig = "{ \"masterServers\": [ { \"list\": \"http://c/list\" } ] }";
+}
+
+TEST(DewritoConfig, Parse)
+{
+	DewritoConfig config;
+	CHECK(DewritoConfigLoader::Parse(GoodConfig, config));
+	CHECK(config.Errors.empty());
+	CHECK_EQUAL(2U, config.MasterEndpoints["list"].size());
+	CHECK_EQUAL("http://b/list", config.MasterEndpoints["list"][1]);
+	CHECK_EQUAL(1U, config.MasterEndpoints["announce"].size());
+	CHECK_EQUAL("http://update", config.UpdateServiceUrl);
+	CHECK(config.UpdateChannelsUrl.empty());
+}
+
+TEST(DewritoConfig, ParseProblems)
+{
+	// bad entries are skipped and reported, the rest of the file is still used
+	DewritoConfig config;
+	CHECK(DewritoConfigLoader::Parse("{ \"masterServers\": [ 5, { \"list\": 5, \"stats\": \"\", \"announce\": \"http://a\" } ], \"updateChannelsUrl\": [] }", config));
+	CHECK_EQUAL(4U, config.Errors.size());
+	CHECK_EQUAL("updateChannelsUrl isn't a string", config.Errors[0]);
+	CHECK_EQUAL("masterServers[0] isn't an object", config.Errors[1]);
+	CHECK_EQUAL("masterServers[1].list isn't a string", config.Errors[2]);
+	CHECK_EQUAL("masterServers[1].stats is empty", config.Errors[3]);
+	CHECK_EQUAL(1U, config.MasterEndpoints.size());
+	CHECK_EQUAL("http://a", config.MasterEndpoints["announce"][0]);
+
+	DewritoConfig notArray;
+	CHECK(DewritoConfigLoader::Parse("{ \"masterServers\": {} }", notArray));
+	CHECK_EQUAL(1U, notArray.Errors.size());
+	CHECK(notArray.MasterEndpoints.empty());
+
+	DewritoConfig broken;
+	CHECK(!DewritoConfigLoader::Parse("{ \"masterServers\": [", broken));
+	CHECK_EQUAL(1U, broken.Errors.size());
+	CHECK(broken.Errors[0].find("JSON parse error") == 0);
+
+	DewritoConfig notObject;
+	CHECK(!DewritoConfigLoader::Parse("[]", notObject));
+	CHECK_EQUAL(1U, notObject.Errors.size());
+}
+
+TEST(DewritoConfig, MissingFile)
+{
+	FakeEnvironment environment;
+	DewritoConfigLoader loader("dewrito.json", environment);
+	auto config = loader.Get();
+	CHECK(config != nullptr);
+	CHECK(config->MasterEndpoints.empty());
+	CHECK_EQUAL(1U, config->Errors.size());
+	CHECK_EQUAL("couldn't open dewrito.json", config->Errors[0]);
+	CHECK_EQUAL(1U, environment.Warnings.size());
+
+	// it turns up later
+	environment.Write("dewrito.json", GoodConfig);
+	environment.Now += DewritoConfigLoader::CheckIntervalMs;
+	config = loader.Get();
+	CHECK(config->Errors.empty());
+	CHECK_EQUAL(2U, config->MasterEndpoints.at("list").size());
+}
+
+TEST(DewritoConfig, Cached)
+{
+	FakeEnvironment environment;
+	environment.Write("dewrito.json", GoodConfig);
+	DewritoConfigLoader loader("dewrito.json", environment);
+	auto first = loader.Get();
+	CHECK_EQUAL(1, environment.Stats);
+	CHECK_EQUAL(1, environment.Reads);
+
+	// within the check interval the file isn't even looked at
+	for (int i = 0; i < 100; i++)
+	{
+		environment.Now += 5;
+		CHECK(loader.Get() == first);
+	}
+	CHECK_EQUAL(1, environment.Stats);
+
+	// after it, the file is looked at but not read if it hasn't changed
+	environment.Now += DewritoConfigLoader::CheckIntervalMs;
+	CHECK(loader.Get() == first);
+	CHECK_EQUAL(2, environment.Stats);
+	CHECK_EQUAL(1, environment.Reads);
+
+	// touched without changing what's in it, it's read but the same config is kept
+	environment.Write("dewrito.json", GoodConfig);
+	environment.Now += DewritoConfigLoader::CheckIntervalMs;
+	CHECK(loader.Get() == first);
+	CHECK_EQUAL(2, environment.Reads);
+	CHECK(environment.Warnings.empty());
+}
+
+TEST(DewritoConfig, Reload)
+{
+	FakeEnvironment environment;
+	environment.Write("dewrito.json", GoodConfig);
+	DewritoConfigLoader loader("dewrito.json", environment);
+	auto first = loader.Get();
+
+	// changes are only picked up once the interval's passed
+	environment.Write("dewrito.json", OtherConfig);
+	environment.Now += DewritoConfigLoader::CheckIntervalMs - 1;
+	CHECK(loader.Get() == first);
+	environment.Now++;
+	auto second = loader.Get();
+	CHECK(second != first);
+	CHECK_EQUAL(1U, second->MasterEndpoints.at("list").size());
+	CHECK_EQUAL("http://c/list", second->MasterEndpoints.at("list")[0]);
+
+	// whoever still has the old one can carry on using it
+	CHECK_EQUAL(2U, first->MasterEndpoints.at("list").size());
+}
+
+TEST(DewritoConfig, KeepsLastGoodConfig)
+{
+	FakeEnvironment environment;
+	environment.Write("dewrito.json", GoodConfig);
+	DewritoConfigLoader loader("dewrito.json", environment);
+	auto first = loader.Get();
+
+	// broken while the game's running
+	environment.Write("dewrito.json", "{ \"masterServers\": [ { \"list\": ");
+	environment.Now += DewritoConfigLoader::CheckIntervalMs;
+	CHECK(loader.Get() == first);
+	CHECK_EQUAL(2U, environment.Warnings.size());
+	CHECK(environment.Warnings[1].find("Keeping the previously loaded") == 0);
+
+	// deleted
+	environment.Files.clear();
+	environment.Now += DewritoConfigLoader::CheckIntervalMs;
+	CHECK(loader.Get() == first);
+
+	// and fixed, even with the same contents it had before it broke
+	environment.Write("dewrito.json", GoodConfig);
+	environment.Now += DewritoConfigLoader::CheckIntervalMs;
+	auto fixed = loader.Get();
+	CHECK(fixed != first);
+	CHECK_EQUAL(2U, fixed->MasterEndpoints.at("list").size());
+}
+
+TEST(DewritoConfig, ClockWraps)
+{
+	FakeEnvironment environment;
+	environment.Now = 0xFFFFFF00;
+	environment.Write("dewrito.json", GoodConfig);
+	DewritoConfigLoader loader("dewrito.json", environment);
+	auto first = loader.Get();
+
+	environment.Write("dewrito.json", OtherConfig);
+	environment.Now += 0x200; // wrapped, but not a full interval later
+	CHECK(loader.Get() == first);
+	environment.Now += DewritoConfigLoader::CheckIntervalMs;
+	CHECK(loader.Get() != first);
+}
+
+TEST(DewritoConfig, ConcurrentGet)
+{
+	// every thread gets a complete config while the others are checking the file
+	FakeEnvironment environment;
+	environment.Write("dewrito.json", GoodConfig);
+	DewritoConfigLoader loader("dewrito.json", environment);
+	loader.Get();
+
+	// the clock keeps moving so the threads keep racing to check the file
+	std::vector<std::thread> threads;
+	std::atomic<int> bad;
+	bad = 0;
+	std::atomic<bool> running;
+	running = true;
+	std::thread clock([&]()
+	{
+		while (running)
+		{
+			environment.Now += DewritoConfigLoader::CheckIntervalMs;
+			std::this_thread::yield();
+		}
+	});
+	for (int i = 0; i < 4; i++)
+	{
+		threads.push_back(std::thread([&]()
+		{
+			for (int j = 0; j < 2000; j++)
+			{
+				auto config = loader.Get();
+				if (!config || config->MasterEndpoints.at("list").size() != 2)
+					bad++;
+			}
+		}));
+	}
+	for (auto& thread : threads)
+		thread.join();
+	running = false;
+	clock.join();
+	CHECK_EQUAL(0, bad.load());
+	CHECK(environment.Stats > 1);
+	CHECK_EQUAL(1, environment.Reads);
+}
@@ -0,0 +1,250 @@
+#include "Test.hpp"
+#include "../../ServerPlugin/InfoRequest.hpp"
+#include <rapidjson/document.h>
+
+using namespace Server;
+
+namespace
+{
+	const std::string Headers = "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\n";
+	const std::string AuthHeader = "Authorization: Basic ZG9yaXRvOnB3\r\n";
+
+	// made up game state, variable i last changed in generation i + 1
+	InfoState MakeState(int variableCount, int playerCount)
+	{
+		InfoState state;
+		state.Name = "Test \"Server\"";
+		state.Port = 11775;
+		state.HostPlayer = "host";
+		state.Map = "Guardian";
+		state.MapFile = "guardian";
+		state.Variant = "Slayer";
+		state.VariantType = "slayer";
+		state.Status = "InGame";
+		state.NumPlayers = playerCount;
+		state.MaxPlayers = 16;
+		state.Xnkid = "00112233445566778899AABBCCDDEEFF";
+		state.Xnaddr = "FFEEDDCCBBAA99887766554433221100";
+		state.Generation = variableCount;
+		for (int i = 0; i < variableCount; i++)
+		{
+			InfoVariableState variable;
+			variable.Name = "Module.Variable" + std::to_string(i);
+			variable.Value = std::to_string(i * 10);
+			variable.Generation = i + 1;
+			state.Variables.push_back(variable);
+		}
+		for (int i = 0; i < playerCount; i++)
+		{
+			InfoPlayer player;
+			player.Name = "player" + std::to_string(i);
+			player.Score = i;
+			player.Team = i % 2;
+			player.IsAlive = true;
+			state.Players.push_back(player);
+		}
+		state.GameVersion = "1.106708 cert_ms23";
+		state.EldewritoVersion = "0.5.0.0";
+		return state;
+	}
+
+	// splits a response into its body, checking that Content-Length matches it
+	bool GetBody(const std::string& response, std::string& body)
+	{
+		auto headerEnd = response.find("\r\n\r\n");
+		auto lengthStart = response.find("Content-Length: ");
+		if (headerEnd == std::string::npos || lengthStart == std::string::npos || lengthStart > headerEnd)
+			return false;
+		body = response.substr(headerEnd + 4);
+		return std::stoul(response.substr(lengthStart + 16)) == body.length();
+	}
+
+	bool ParseBody(const std::string& response, rapidjson::Document& json)
+	{
+		std::string body;
+		if (!GetBody(response, body))
+			return false;
+		json.Parse(body.c_str());
+		return !json.HasParseError() && json.IsObject();
+	}
+
+	// feeds a request to an InfoRequest a few bytes at a time, like it would come off a slow connection
+	InfoRequestStatus Feed(InfoRequest& request, const std::string& text, size_t chunkSize)
+	{
+		auto status = InfoRequestStatus::Incomplete;
+		for (size_t i = 0; i < text.length() && status == InfoRequestStatus::Incomplete; i += chunkSize)
+			status = request.Append(text.c_str() + i, text.length() - i < chunkSize ? text.length() - i : chunkSize);
+		return status;
+	}
+
+	const std::string* Respond(const std::string& text, const std::shared_ptr<const InfoSnapshot>& snapshot, InfoRequest& request)
+	{
+		if (Feed(request, text, text.length()) != InfoRequestStatus::Complete)
+			return nullptr;
+		return request.Respond(snapshot);
+	}
+}
+
+TEST(InfoServer, FullJson)
+{
+	auto snapshot = BuildInfoSnapshot(MakeState(3, 2), Headers, "", 1234);
+	CHECK_EQUAL(1234U, snapshot->CreatedTime);
+	CHECK(snapshot->AuthHeader.empty());
+	CHECK(snapshot->PublicResponse.empty());
+	CHECK_EQUAL(0U, snapshot->AuthResponse.find(Headers));
+
+	rapidjson::Document json;
+	CHECK(ParseBody(snapshot->AuthResponse, json));
+	CHECK_EQUAL(std::string("Test \"Server\""), json["name"].GetString());
+	CHECK_EQUAL(11775, json["port"].GetInt());
+	CHECK_EQUAL(std::string("slayer"), json["variantType"].GetString());
+	CHECK_EQUAL(3U, json["variablesGeneration"].GetUint());
+	CHECK_EQUAL(3U, json["variables"].Size());
+	CHECK_EQUAL(std::string("Module.Variable2"), json["variables"][2]["name"].GetString());
+	CHECK_EQUAL(std::string("20"), json["variables"][2]["value"].GetString());
+	CHECK_EQUAL(2U, json["players"].Size());
+	CHECK_EQUAL(std::string("player1"), json["players"][1]["name"].GetString());
+	CHECK(!json.HasMember("passworded"));
+	CHECK_EQUAL(std::string("0.5.0.0"), json["eldewritoVersion"].GetString());
+}
+
+TEST(InfoServer, NoVariantType)
+{
+	auto state = MakeState(0, 0);
+	state.VariantType.clear();
+	rapidjson::Document json;
+	json.Parse(BuildInfoJson(state, true).c_str());
+	CHECK(!json.HasParseError());
+	CHECK(!json.HasMember("variantType"));
+	CHECK_EQUAL(0U, json["variables"].Size());
+}
+
+TEST(InfoServer, Passworded)
+{
+	auto snapshot = BuildInfoSnapshot(MakeState(3, 2), Headers, AuthHeader, 0);
+	CHECK_EQUAL(AuthHeader, snapshot->AuthHeader);
+
+	// the public response leaves out everything that needs the password
+	rapidjson::Document json;
+	CHECK(ParseBody(snapshot->PublicResponse, json));
+	CHECK(json["passworded"].GetBool());
+	CHECK(!json.HasMember("xnkid"));
+	CHECK(!json.HasMember("variables"));
+	CHECK(!json.HasMember("players"));
+	CHECK_EQUAL(std::string("Guardian"), json["map"].GetString());
+
+	InfoRequest anonymous;
+	CHECK(Respond("GET / HTTP/1.1\r\nHost: x\r\n\r\n", snapshot, anonymous) == &snapshot->PublicResponse);
+
+	InfoRequest wrongPassword;
+	CHECK(Respond("GET / HTTP/1.1\r\nAuthorization: Basic ZG9yaXRvOnd4\r\n\r\n", snapshot, wrongPassword) == &snapshot->PublicResponse);
+
+	// the auth header is checked with its line ending, so it can't be a prefix of a longer one
+	InfoRequest longerPassword;
+	CHECK(Respond("GET / HTTP/1.1\r\nAuthorization: Basic ZG9yaXRvOnB3eA==\r\n\r\n", snapshot, longerPassword) == &snapshot->PublicResponse);
+
+	InfoRequest authenticated;
+	CHECK(Respond("GET / HTTP/1.1\r\n" + AuthHeader + "\r\n", snapshot, authenticated) == &snapshot->AuthResponse);
+}
+
+TEST(InfoServer, Delta)
+{
+	auto snapshot = BuildInfoSnapshot(MakeState(10, 0), Headers, "", 0);
+
+	InfoRequest request;
+	auto response = Respond("GET /?since=7 HTTP/1.1\r\n\r\n", snapshot, request);
+	CHECK(response != nullptr);
+	CHECK(response != &snapshot->AuthResponse);
+
+	// variables 7, 8 and 9 changed in generations 8, 9 and 10
+	rapidjson::Document json;
+	CHECK(ParseBody(*response, json));
+	CHECK_EQUAL(7U, json["variablesSince"].GetUint());
+	CHECK_EQUAL(10U, json["variablesGeneration"].GetUint());
+	CHECK_EQUAL(3U, json["variables"].Size());
+	CHECK_EQUAL(std::string("Module.Variable7"), json["variables"][0]["name"].GetString());
+	CHECK_EQUAL(std::string("Module.Variable9"), json["variables"][2]["name"].GetString());
+	CHECK(json.HasMember("players"));
+
+	// up to date, so no variables at all
+	InfoRequest upToDate;
+	CHECK(ParseBody(*Respond("GET /?x=1&since=10 HTTP/1.1\r\n\r\n", snapshot, upToDate), json));
+	CHECK_EQUAL(0U, json["variables"].Size());
+}
+
+TEST(InfoServer, DeltaFallsBackToFull)
+{
+	auto snapshot = BuildInfoSnapshot(MakeState(10, 0), Headers, "", 0);
+	const char* requests[] =
+	{
+		"GET / HTTP/1.1\r\n\r\n",
+		"GET /?since=0 HTTP/1.1\r\n\r\n", // nothing to compare against
+		"GET /?since=11 HTTP/1.1\r\n\r\n", // newer than us, must be from before a restart
+		"GET /?since=abc HTTP/1.1\r\n\r\n",
+		"GET /?since= HTTP/1.1\r\n\r\n",
+		"GET /?since=99999999999 HTTP/1.1\r\n\r\n",
+		"GET / HTTP/1.1\r\nReferer: /?since=5\r\n\r\n", // only the request line counts
+	};
+	for (auto text : requests)
+	{
+		InfoRequest request;
+		if (Respond(text, snapshot, request) != &snapshot->AuthResponse)
+			Test::Fail(__FILE__, __LINE__, std::string("didn't get the full response for ") + text);
+	}
+}
+
+TEST(InfoServer, SplitRequest)
+{
+	// the end of the header can be split anywhere, including in the middle of the \r\n\r\n
+	std::string text = "GET /?since=3 HTTP/1.1\r\nHost: localhost\r\n\r\n";
+	for (size_t chunkSize = 1; chunkSize <= text.length(); chunkSize++)
+	{
+		InfoRequest request;
+		CHECK(Feed(request, text, chunkSize) == InfoRequestStatus::Complete);
+		CHECK_EQUAL(text.substr(0, text.length() - 2), request.GetText());
+	}
+
+	InfoRequest partial;
+	CHECK(Feed(partial, "GET / HTTP/1.1\r\nHost: x\r\n", 4) == InfoRequestStatus::Incomplete);
+}
+
+TEST(InfoServer, BadRequests)
+{
+	InfoRequest binary;
+	CHECK(Feed(binary, std::string("GET /\x01 HTTP/1.1\r\n\r\n"), 64) == InfoRequestStatus::Bad);
+
+	InfoRequest highBit;
+	CHECK(Feed(highBit, "GET /\xC3\xA9 HTTP/1.1\r\n\r\n", 64) == InfoRequestStatus::Bad);
+
+	// a header that never ends gets cut off once it's over the limit
+	InfoRequest tooLong;
+	std::string line = "X-Padding: " + std::string(100, 'a') + "\r\n";
+	auto status = tooLong.Append("GET / HTTP/1.1\r\n", 16);
+	while (status == InfoRequestStatus::Incomplete && tooLong.GetText().length() <= InfoRequest::MaxLength + line.length())
+		status = tooLong.Append(line.c_str(), line.length());
+	CHECK(status == InfoRequestStatus::Bad);
+}
+
+TEST(InfoServer, NoSnapshot)
+{
+	InfoRequest request;
+	CHECK(Respond("GET / HTTP/1.1\r\n\r\n", nullptr, request) == &UnavailableResponse);
+}
+
+TEST(InfoServer, ResponseOutlivesSnapshot)
+{
+	// the network thread keeps sending from a response after the game thread has published a newer snapshot
+	InfoRequest request;
+	auto snapshot = BuildInfoSnapshot(MakeState(5, 1), Headers, "", 0);
+	auto expected = snapshot->AuthResponse;
+	auto response = Respond("GET / HTTP/1.1\r\n\r\n", snapshot, request);
+	snapshot = BuildInfoSnapshot(MakeState(6, 1), Headers, "", 0);
+	CHECK_EQUAL(expected, *response);
+
+	InfoRequest delta;
+	response = Respond("GET /?since=2 HTTP/1.1\r\n\r\n", snapshot, delta);
+	snapshot.reset();
+	rapidjson::Document json;
+	CHECK(ParseBody(*response, json));
+	CHECK_EQUAL(4U, json["variables"].Size());
+}
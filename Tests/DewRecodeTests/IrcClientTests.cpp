@@ -0,0 +1,371 @@
+#include "Test.hpp"
+#include "../../ChatPlugin/IrcClient.hpp"
+#include <algorithm>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+
+namespace
+{
+	// stand-in for an IRC server, the client talks to it through IrcEnvironment instead of a socket
+	// time only moves when the test calls Advance, so backoff and timeouts happen straight away and always in the same order
+	class TestServer : public IrcEnvironment
+	{
+	public:
+		bool AutoWelcome = true; // send 001 as soon as the client sends USER, like a real server would
+
+		uint64_t GetTime()
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			return now;
+		}
+
+		bool Connect(const std::string& host, const std::string& port, std::string& error)
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			ConnectAttempts++;
+			changed.notify_all();
+			if (refuse)
+			{
+				error = "connection refused";
+				return false;
+			}
+			Connections++;
+			connected = true;
+			closed = false;
+			chunks.clear();
+			partial.clear();
+			return true;
+		}
+
+		void Disconnect()
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			connected = false;
+			changed.notify_all();
+		}
+
+		int Receive(char* buffer, size_t size, std::string& error)
+		{
+			// one chunk at most each time, so data pushed in pieces arrives in pieces
+			std::lock_guard<std::mutex> guard(lock);
+			if (!chunks.empty())
+			{
+				auto& chunk = chunks.front();
+				auto length = chunk.length() < size ? chunk.length() : size;
+				memcpy(buffer, chunk.c_str(), length);
+				chunk.erase(0, length);
+				if (chunk.empty())
+					chunks.pop_front();
+				return static_cast<int>(length);
+			}
+			if (closed)
+			{
+				error = "connection closed by server";
+				return -1;
+			}
+			return 0;
+		}
+
+		int Send(const char* data, size_t size, std::string& error)
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			partial.append(data, size);
+			size_t end;
+			while ((end = partial.find("\r\n")) != std::string::npos)
+			{
+				auto line = partial.substr(0, end);
+				partial.erase(0, end + 2);
+				Lines.push_back(line);
+				if (line.compare(0, 5, "NICK ") == 0)
+					nick = line.substr(5);
+				if (AutoWelcome && line.compare(0, 5, "USER ") == 0)
+					chunks.push_back(":irc.test 001 " + nick + " :Welcome to the test network\r\n");
+			}
+			changed.notify_all();
+			return static_cast<int>(size);
+		}
+
+		void Wait(uint32_t timeout)
+		{
+			std::unique_lock<std::mutex> guard(lock);
+			deadline = now + timeout;
+			waiting = true;
+			changed.wait(guard, [this]() { return shouldWake(); });
+			waiting = false;
+			woken = false;
+		}
+
+		void Wake()
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			woken = true;
+			changed.notify_all();
+		}
+
+		// everything below is called by the test
+
+		void Push(const std::string& data)
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			chunks.push_back(data);
+			changed.notify_all();
+		}
+
+		void Close()
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			closed = true;
+			changed.notify_all();
+		}
+
+		void Refuse(bool refuseConnections)
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			refuse = refuseConnections;
+		}
+
+		// Moves time on once the client's waiting with nothing left to do, so it doesn't start a wait after the time's already moved.
+		bool Advance(uint64_t ms)
+		{
+			std::unique_lock<std::mutex> guard(lock);
+			if (!changed.wait_for(guard, std::chrono::seconds(5), [this]() { return waiting && !shouldWake(); }))
+				return false;
+			now += ms;
+			changed.notify_all();
+			return true;
+		}
+
+		// what the client reported through its callbacks
+		void AddEvent(const std::string& event)
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			Events.push_back(event);
+			changed.notify_all();
+		}
+
+		// Waits (in real time, for a few seconds at most) for the client to do something, the predicate is called with the lock held.
+		template <typename Predicate>
+		bool WaitUntil(Predicate predicate)
+		{
+			std::unique_lock<std::mutex> guard(lock);
+			return changed.wait_for(guard, std::chrono::seconds(5), predicate);
+		}
+
+		bool WaitForLine(const std::string& line)
+		{
+			return WaitUntil([&]() { return std::find(Lines.begin(), Lines.end(), line) != Lines.end(); });
+		}
+
+		bool WaitForEvent(const std::string& event)
+		{
+			return WaitUntil([&]() { return std::find(Events.begin(), Events.end(), event) != Events.end(); });
+		}
+
+		size_t CountLines(const std::string& start)
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			return std::count_if(Lines.begin(), Lines.end(), [&](const std::string& line) { return line.compare(0, start.length(), start) == 0; });
+		}
+
+		// only read these with the lock held (in a WaitUntil predicate) or once the client's stopped
+		std::vector<std::string> Lines; // lines the client sent
+		std::vector<std::string> Events;
+		int ConnectAttempts = 0;
+		int Connections = 0;
+
+	private:
+		std::mutex lock;
+		std::condition_variable changed;
+		uint64_t now = 1000;
+		uint64_t deadline = 0;
+		bool waiting = false;
+		bool woken = false;
+		bool refuse = false;
+		bool connected = false;
+		bool closed = false;
+		std::deque<std::string> chunks; // waiting for the client to receive them
+		std::string partial;
+		std::string nick;
+
+		bool shouldWake()
+		{
+			return woken || (connected && (!chunks.empty() || closed)) || now >= deadline;
+		}
+	};
+
+	void OnRegistered(void* param)
+	{
+		static_cast<TestServer*>(param)->AddEvent("registered");
+	}
+
+	void OnMessage(const IrcMessage& message, void* param)
+	{
+		auto event = message.GetNick() + " " + message.Command;
+		for (auto& p : message.Params)
+			event += " [" + p + "]";
+		static_cast<TestServer*>(param)->AddEvent(event);
+	}
+
+	void OnDisconnected(const std::string& reason, uint32_t reconnectDelay, void* param)
+	{
+		static_cast<TestServer*>(param)->AddEvent("disconnected: " + reason + ", retrying in " + std::to_string(reconnectDelay));
+	}
+
+	IrcClient::Callbacks MakeCallbacks(TestServer& server)
+	{
+		IrcClient::Callbacks callbacks;
+		callbacks.OnRegistered = OnRegistered;
+		callbacks.OnMessage = OnMessage;
+		callbacks.OnDisconnected = OnDisconnected;
+		callbacks.Param = &server;
+		return callbacks;
+	}
+}
+
+TEST(IrcMessage, Parse)
+{
+	IrcMessage message;
+	CHECK(IrcMessage::Parse(":nick!user@host privmsg #chan :hello  there :)", message));
+	CHECK_EQUAL(std::string("nick!user@host"), message.Prefix);
+	CHECK_EQUAL(std::string("nick"), message.GetNick());
+	CHECK_EQUAL(std::string("PRIVMSG"), message.Command);
+	CHECK_EQUAL(2U, message.Params.size());
+	CHECK_EQUAL(std::string("#chan"), message.GetParam(0));
+	CHECK_EQUAL(std::string("hello  there :)"), message.GetParam(1));
+	CHECK_EQUAL(std::string(""), message.GetParam(2));
+
+	CHECK(IrcMessage::Parse("PING irc.test", message));
+	CHECK(message.Prefix.empty());
+	CHECK_EQUAL(std::string("irc.test"), message.GetParam(0));
+
+	CHECK(!IrcMessage::Parse(":prefix-only", message));
+	CHECK(!IrcMessage::Parse("", message));
+}
+
+TEST(IrcLineFramer, SplitAndOverlongLines)
+{
+	IrcLineFramer framer;
+	std::string line;
+	framer.Append("PI", 2);
+	CHECK(!framer.NextLine(line));
+	framer.Append("NG :a\r", 6);
+	CHECK(!framer.NextLine(line));
+	framer.Append("\n\r\nPONG :b\n", 11);
+	CHECK(framer.NextLine(line));
+	CHECK_EQUAL(std::string("PING :a"), line);
+	CHECK(framer.NextLine(line)); // the empty line is skipped
+	CHECK_EQUAL(std::string("PONG :b"), line);
+	CHECK(!framer.NextLine(line));
+
+	// a line that's too long gets dropped, even when its end comes in later, and the next one's fine
+	std::string overlong(IrcLineFramer::MaxLineLength + 10, 'x');
+	framer.Append(overlong.c_str(), overlong.length());
+	CHECK(!framer.NextLine(line));
+	framer.Append("xxx\r\nNOTICE :ok\r\n", 17);
+	CHECK(framer.NextLine(line));
+	CHECK_EQUAL(std::string("NOTICE :ok"), line);
+}
+
+TEST(IrcClient, SplitLines)
+{
+	TestServer server;
+	server.AutoWelcome = false;
+	IrcClient client(server);
+	CHECK(client.Start("irc.test", "6667", "tester", "test user", MakeCallbacks(server)));
+	CHECK(server.WaitForLine("NICK tester"));
+	CHECK(server.WaitForLine("USER tester 0 * :test user"));
+
+	// lines cut up across several receives, including between the CR and LF, get put back together
+	server.Push(":irc.test 00");
+	server.Push("1 tester :Welc");
+	server.Push("ome\r\n:friend!f@host PRIVMSG #chan :hello ");
+	server.Push("there\r");
+	server.Push("\n:friend!f@host PRIVMSG tester :second\r\n");
+	CHECK(server.WaitForEvent("friend PRIVMSG [tester] [second]"));
+	client.Stop();
+
+	std::vector<std::string> expected;
+	expected.push_back("registered");
+	expected.push_back("irc.test 001 [tester] [Welcome]");
+	expected.push_back("friend PRIVMSG [#chan] [hello there]");
+	expected.push_back("friend PRIVMSG [tester] [second]");
+	CHECK(server.Events == expected);
+	CHECK(!client.IsRunning());
+	CHECK_EQUAL(std::string("QUIT"), server.Lines.back());
+}
+
+TEST(IrcClient, PingPong)
+{
+	TestServer server;
+	IrcClient client(server);
+	CHECK(!client.Send("PRIVMSG #chan :too early"));
+	CHECK(client.Start("irc.test", "6667", "tester", "test user", MakeCallbacks(server)));
+	CHECK(server.WaitForEvent("registered"));
+
+	// more than the flood control lets through at once, the rest wait for time to pass
+	for (int i = 0; i < 8; i++)
+		CHECK(client.Send("PRIVMSG #chan :line " + std::to_string(i)));
+	CHECK(server.WaitForLine("PRIVMSG #chan :line 4"));
+	CHECK_EQUAL(5U, server.CountLines("PRIVMSG"));
+
+	// a PING jumps the queue
+	server.Push("PING :token123\r\n");
+	CHECK(server.WaitForLine("PONG :token123"));
+	CHECK_EQUAL(5U, server.CountLines("PRIVMSG"));
+
+	CHECK(server.Advance(IrcClient::FloodRefillTime));
+	CHECK(server.WaitForLine("PRIVMSG #chan :line 5"));
+	CHECK_EQUAL(6U, server.CountLines("PRIVMSG"));
+
+	// a CR/LF can't be used to send extra commands
+	CHECK(server.Advance(3 * IrcClient::FloodRefillTime));
+	CHECK(client.Send("PRIVMSG #chan :hi\r\nQUIT :injected"));
+	CHECK(server.WaitForLine("PRIVMSG #chan :hi"));
+	CHECK_EQUAL(0U, server.CountLines("QUIT"));
+
+	// nothing from the server for a while, the client checks it's still there, then gives up on it
+	CHECK(server.Advance(IrcClient::IdleTimeout / 2));
+	CHECK(server.WaitForLine("PING :irc.test"));
+	CHECK(server.Advance(IrcClient::IdleTimeout / 2));
+	CHECK(server.WaitForEvent("disconnected: connection timed out, retrying in 2000"));
+	client.Stop();
+}
+
+TEST(IrcClient, Reconnect)
+{
+	TestServer server;
+	IrcClient client(server);
+	CHECK(client.Start("irc.test", "6667", "tester", "test user", MakeCallbacks(server)));
+	CHECK(server.WaitForEvent("registered"));
+
+	server.Close();
+	CHECK(server.WaitForEvent("disconnected: connection closed by server, retrying in 2000"));
+	CHECK(!client.IsRegistered());
+	CHECK(!client.Send("PRIVMSG #chan :nobody's listening"));
+
+	// each failed attempt waits twice as long as the last
+	server.Refuse(true);
+	client.SetNick("tester2");
+	CHECK(server.Advance(2000));
+	CHECK(server.WaitForEvent("disconnected: connection refused, retrying in 4000"));
+	CHECK(server.Advance(3999));
+	CHECK(server.Advance(1));
+	CHECK(server.WaitForEvent("disconnected: connection refused, retrying in 8000"));
+	CHECK(server.WaitUntil([&]() { return server.ConnectAttempts == 3; }));
+
+	// once it's back it registers again with the new nick, and the backoff starts over
+	server.Refuse(false);
+	CHECK(server.Advance(8000));
+	CHECK(server.WaitForLine("NICK tester2"));
+	CHECK(server.WaitUntil([&]() { return std::count(server.Events.begin(), server.Events.end(), "registered") == 2; }));
+	CHECK(client.IsRegistered());
+	server.Close();
+	CHECK(server.WaitUntil([&]() { return std::count(server.Events.begin(), server.Events.end(), "disconnected: connection closed by server, retrying in 2000") == 2; }));
+
+	// Stop doesn't have to wait out the backoff
+	client.Stop();
+	CHECK(!client.IsRunning());
+	CHECK_EQUAL(4, server.ConnectAttempts);
+	CHECK_EQUAL(2, server.Connections);
+}
@@ -0,0 +1,453 @@
+#include "Test.hpp"
+#include "../../DewRecode/src/KeyManager.hpp"
+#include <algorithm>
+#include <map>
+
+namespace
+{
+	// keeps files in memory, other instances sharing a keystore are other KeyStores using the same environment
+	class MemoryKeyEnvironment : public KeyEnvironment
+	{
+	public:
+		std::map<std::string, std::string> Files;
+		bool LockTimesOut = false;
+		bool WritesFail = false;
+		bool GenerationFails = false;
+		int Locked = 0;
+		std::atomic<int> Generated;
+		std::vector<std::string> Warnings;
+
+		MemoryKeyEnvironment()
+		{
+			Generated = 0;
+		}
+
+		bool LockFile(const std::string& fileName)
+		{
+			if (LockTimesOut)
+				return false;
+			fileLock.lock();
+			Locked++;
+			return true;
+		}
+
+		void UnlockFile(const std::string& fileName)
+		{
+			Locked--;
+			fileLock.unlock();
+		}
+
+		bool ReadFile(const std::string& fileName, std::string& contents, bool& exists)
+		{
+			auto it = Files.find(fileName);
+			exists = it != Files.end();
+			if (!exists)
+				return false;
+			contents = it->second;
+			return true;
+		}
+
+		bool ReplaceFile(const std::string& fileName, const std::string& contents)
+		{
+			if (WritesFail)
+				return false;
+			Files[fileName] = contents;
+			return true;
+		}
+
+		bool RenameFile(const std::string& fileName, const std::string& newName)
+		{
+			Files[newName] = Files[fileName];
+			Files.erase(fileName);
+			return true;
+		}
+
+		bool GenerateKeyPair(int bits, PlayerKeyPair& key)
+		{
+			if (GenerationFails)
+				return false;
+			auto n = std::to_string(++Generated);
+			key.PrivateKey = "generatedPrivate" + n;
+			key.PublicKey = "generatedPublic" + n;
+			return true;
+		}
+
+		void Log(LogSeverity severity, const std::string& message)
+		{
+			if (severity >= LogSeverity::Warning)
+			{
+				std::lock_guard<std::mutex> guard(logLock);
+				Warnings.push_back(message);
+			}
+		}
+
+	private:
+		std::mutex fileLock;
+		std::mutex logLock;
+	};
+
+	PlayerKeyPair MakeKey(const std::string& name)
+	{
+		PlayerKeyPair key;
+		key.PrivateKey = name + "Private";
+		key.PublicKey = name + "Public";
+		return key;
+	}
+
+	bool SameKey(const PlayerKeyPair& a, const PlayerKeyPair& b)
+	{
+		return a.PrivateKey == b.PrivateKey && a.PublicKey == b.PublicKey;
+	}
+
+	// a store with an active key and three pooled ones
+	std::string MakeStore()
+	{
+		std::vector<PlayerKeyPair> pool;
+		pool.push_back(MakeKey("pool1"));
+		pool.push_back(MakeKey("pool2"));
+		pool.push_back(MakeKey("pool3"));
+		auto active = MakeKey("active");
+		return KeyStore::Serialize(&active, pool);
+	}
+
+	// 1024-bit test keys, stripped like they are in the cfg
+	const std::string PrivateKeyA =
+		"MIICXAIBAAKBgQCabXfy4mJyooyJgeOSggw7eIbMP8xVYMXesyDOQuRLB2eQlCq/GaB/hl9EPtOgcxY59SstIYzSXFnA8p9KFCs5"
+		"m4kQYTtJDXGhFuEXy5yOsFtdbp1a/MCqeKmJv9TGmNFLv/zzxwpEFZ5LfXG1qtXKKVzmC2wjptOb6v+aZZc+owIDAQABAoGAS/fu"
+		"Oh4EMECmwj6TpU80lU0FgxUfgCDLNnMIgG+HvyE1YXqCTOBehF2mH/yIPzZeiMSDKQCINjQYM0Mn+VlSqZCYZvzAsYJi5I9F99Bg"
+		"CTCzUcmdv5NKhsBHMPj6FsAb+v4WnFcUP7tLKhgeQDKSPnvWwmdbkG3idc+akx5G5oECQQDMJEOPu5N08uAVuGfp72q3u4g8nlWe"
+		"9hFQlVa1xpMUyPiPNcfl42Vwp4PRds58NkJ/Gk8U2ikdIN6u0vHC2d9FAkEAwagzr4QreJJDl3/I/IxJUTQ0QDqo/q4PWgZXX5jw"
+		"WpftWIfyN+uclWCxyyrcYGgAgIwJcpWZ6DLF/CO+auLwxwJABy0/Ms5lYLcpKZpSDOdd2Re+smLen7gG485cPge9I/3svxwk6vAT"
+		"oOJCwBptJ/DAZbeHEDSbPWrqaTsBRNhkAQJBAKrA3uHxzkq/3O1mdReJstPxDelcT8pQO6ULVlsqhTO8JkEbjY2VKDnmSp5zqmEv"
+		"EtJFp8bq9gvxSPUrpyij9d0CQD7QBnTXlRbx0eWK6XnCn8IuSl3T88i0hg7f/DICbtFYy9TpAYdOAjgzarSk3Dgm9fd4XcoD973x"
+		"haDSA/RgkzY=";
+	const std::string PublicKeyA =
+		"MIGfMA0GCSqGSIb3DQEBAQUAA4GNADCBiQKBgQCabXfy4mJyooyJgeOSggw7eIbMP8xVYMXesyDOQuRLB2eQlCq/GaB/hl9EPtOg"
+		"cxY59SstIYzSXFnA8p9KFCs5m4kQYTtJDXGhFuEXy5yOsFtdbp1a/MCqeKmJv9TGmNFLv/zzxwpEFZ5LfXG1qtXKKVzmC2wjptOb"
+		"6v+aZZc+owIDAQAB";
+	const std::string PrivateKeyB =
+		"MIICXQIBAAKBgQDb+10j1P+pQ7qrSQUVhd5KNf75F51bYkisLwQgfunnRht9ktaNKeFqdzvkI0uIsNcCBdBnPmCCPaGKTO/usWng"
+		"x2Cx6HJ20PXZOlaJBSe2esTOKGJ1CQCKEY6bUo3AYSt/9n1iJjSOL8GRLUuHrCVaAy1Xf4uzayXDBhodgZ0GiwIDAQABAoGAM4Ye"
+		"fKQI9aZNdIz3yeC+/fbDr6geTScqClpAxzOyqV68VZ8s7YdfqsYemwLBUFTLJ0ghVe1AQYEZ8wCuOeQH/hTAqP1j124rTE5z6+Mw"
+		"QI0dHQjkcQRlGBk/h8flc8vUkNLkw7uil1ZNAUIUQwY/jh37iflv93Bn+rur/dpI1MECQQDzkTts/Fp/yabWpPrkd1U/JPV8uZt0"
+		"3TgGHIIkGz4pRMxNAfI3WAV0SSaZOj0o02JxfEUn5pR5Ra3HnobkpNKbAkEA5zXvD1gCu8vtHXo2pvldcOXjtgIklIlP3vTMtTbo"
+		"h79D5fY069qmZ0bKluklg4K53rbXwS5t0sPHZjJQskWi0QJBAOMnwpVdMQXWykuK6BalGJLgZDajX9F482P3uIP2CF4ytJrpQr3M"
+		"0KFoC6CCCUIHCtuuO00AJd6IVo9CUKny8hsCQCILbQIDYZOpeWanwjhf64ReNWNteVltxpb70NC2HxMt9J9921kHPw1h/R6vgdiV"
+		"fSzwG2DUp1MrhMbljcBSRKECQQCsPIlFgear1SOeuiILzBNv1vN4gwZWaGq35Pj027WPkb58OEHs9TtMjk8+CDGLB+jaNMiwslnK"
+		"TvhU3zzu0p7C";
+	const std::string PublicKeyB =
+		"MIGfMA0GCSqGSIb3DQEBAQUAA4GNADCBiQKBgQDb+10j1P+pQ7qrSQUVhd5KNf75F51bYkisLwQgfunnRht9ktaNKeFqdzvkI0uI"
+		"sNcCBdBnPmCCPaGKTO/usWngx2Cx6HJ20PXZOlaJBSe2esTOKGJ1CQCKEY6bUo3AYSt/9n1iJjSOL8GRLUuHrCVaAy1Xf4uzayXD"
+		"BhodgZ0GiwIDAQAB";
+}
+
+TEST(KeyStore, RoundTrip)
+{
+	auto contents = MakeStore();
+	CHECK(contents.compare(0, 20, "ElDewritoKeyStore 1\n") == 0);
+
+	PlayerKeyPair active;
+	bool hasActive;
+	std::vector<PlayerKeyPair> pool;
+	std::vector<std::string> errors;
+	CHECK(KeyStore::Parse(contents, &active, hasActive, pool, errors));
+	CHECK(errors.empty());
+	CHECK(hasActive);
+	CHECK(SameKey(MakeKey("active"), active));
+	CHECK_EQUAL(3U, pool.size());
+	CHECK(SameKey(MakeKey("pool3"), pool[2]));
+
+	// and back out the same
+	CHECK_EQUAL(contents, KeyStore::Serialize(&active, pool));
+
+	// no active key, empty pool
+	auto empty = KeyStore::Serialize(nullptr, std::vector<PlayerKeyPair>());
+	CHECK(KeyStore::Parse(empty, &active, hasActive, pool, errors));
+	CHECK(!hasActive);
+	CHECK(errors.empty());
+
+	// windows line endings and checksums in upper case are fine too
+	std::string crlf;
+	bool inChecksum = false;
+	for (auto c : contents)
+	{
+		if (c == '\n')
+			crlf += '\r';
+		inChecksum = c == '\n' ? false : inChecksum || std::count(crlf.begin() + crlf.rfind('\n') + 1, crlf.end(), ' ') == 3;
+		crlf += inChecksum ? (char)toupper(c) : c;
+	}
+	CHECK(crlf.find("\r\npool") != std::string::npos);
+	pool.clear();
+	CHECK(KeyStore::Parse(crlf, &active, hasActive, pool, errors));
+	CHECK(errors.empty());
+	CHECK(hasActive);
+	CHECK_EQUAL(3U, pool.size());
+}
+
+TEST(KeyStore, SaveAndLoad)
+{
+	MemoryKeyEnvironment environment;
+	KeyStore store("keys.dat", environment);
+
+	// a missing file is an empty store
+	CHECK(store.BeginUpdate());
+	PlayerKeyPair key;
+	CHECK(!store.GetActiveKey(key));
+	CHECK_EQUAL(0U, store.GetPoolSize());
+	store.SetActiveKey(MakeKey("active"));
+	store.AddPooledKey(MakeKey("pool1"));
+	store.AddPooledKey(MakeKey("pool2"));
+	store.EndUpdate(true);
+	CHECK_EQUAL(0, environment.Locked);
+
+	// another instance sharing the file sees the changes
+	KeyStore other("keys.dat", environment);
+	CHECK(other.BeginUpdate());
+	CHECK(other.GetActiveKey(key));
+	CHECK(SameKey(MakeKey("active"), key));
+	CHECK(other.TakePooledKey(key));
+	CHECK(SameKey(MakeKey("pool2"), key));
+	other.EndUpdate(true);
+
+	CHECK(store.BeginUpdate());
+	CHECK_EQUAL(1U, store.GetPoolSize());
+	store.EndUpdate(false);
+	CHECK(environment.Warnings.empty());
+}
+
+TEST(KeyStore, DamagedEntry)
+{
+	// flip a character in one of the pooled keys, only that key is lost
+	MemoryKeyEnvironment environment;
+	auto contents = MakeStore();
+	contents[contents.find("pool2Private")] = 'P';
+	environment.Files["keys.dat"] = contents;
+
+	KeyStore store("keys.dat", environment);
+	CHECK(store.BeginUpdate());
+	PlayerKeyPair key;
+	CHECK(store.GetActiveKey(key));
+	CHECK_EQUAL(2U, store.GetPoolSize());
+	CHECK(store.TakePooledKey(key));
+	CHECK(SameKey(MakeKey("pool3"), key));
+	CHECK(store.TakePooledKey(key));
+	CHECK(SameKey(MakeKey("pool1"), key));
+	store.EndUpdate(false);
+	CHECK_EQUAL(1U, environment.Warnings.size());
+	CHECK_EQUAL("keys.dat: line 4 failed its checksum", environment.Warnings[0]);
+
+	// the file was rewritten without it, so it isn't reported again
+	CHECK(environment.Files["keys.dat"].find("Pool2Private") == std::string::npos);
+	CHECK(store.BeginUpdate());
+	store.EndUpdate(false);
+	CHECK_EQUAL(1U, environment.Warnings.size());
+}
+
+TEST(KeyStore, Truncated)
+{
+	// cut off halfway through the last entry, eg. by a crash on a file system that doesn't do atomic renames
+	MemoryKeyEnvironment environment;
+	auto contents = MakeStore();
+	environment.Files["keys.dat"] = contents.substr(0, contents.find("pool3Public") + 4);
+
+	KeyStore store("keys.dat", environment);
+	CHECK(store.BeginUpdate());
+	PlayerKeyPair key;
+	CHECK(store.GetActiveKey(key));
+	CHECK_EQUAL(2U, store.GetPoolSize());
+	store.EndUpdate(false);
+	CHECK_EQUAL(1U, environment.Warnings.size());
+	CHECK_EQUAL("keys.dat: line 5 is incomplete", environment.Warnings[0]);
+
+	// and one that's missing its checksum entirely, or has garbage in it
+	environment.Files["keys.dat"] = "ElDewritoKeyStore 1\nactive a b\n\x01\x02\x03\npool a b 00\n";
+	environment.Warnings.clear();
+	CHECK(store.BeginUpdate());
+	CHECK(!store.GetActiveKey(key));
+	CHECK_EQUAL(0U, store.GetPoolSize());
+	store.EndUpdate(false);
+	CHECK_EQUAL(3U, environment.Warnings.size());
+}
+
+TEST(KeyStore, NotAKeyStore)
+{
+	// a file that's been overwritten with something else is moved out of the way and replaced
+	MemoryKeyEnvironment environment;
+	std::string garbage("\0\0\0\0garbage", 11);
+	environment.Files["keys.dat"] = garbage;
+
+	KeyStore store("keys.dat", environment);
+	CHECK(store.BeginUpdate());
+	CHECK_EQUAL(0U, store.GetPoolSize());
+	store.AddPooledKey(MakeKey("pool1"));
+	store.EndUpdate(true);
+
+	CHECK(garbage == environment.Files["keys.dat.bad"]);
+	CHECK(environment.Files["keys.dat"].find("pool1Private") != std::string::npos);
+	CHECK_EQUAL("keys.dat: not a keystore file", environment.Warnings[0]);
+}
+
+TEST(KeyStore, NewerVersion)
+{
+	// a store from a newer version is left alone, even if we're asked to save
+	MemoryKeyEnvironment environment;
+	auto contents = "ElDewritoKeyStore 2\nsomething we don't understand\n";
+	environment.Files["keys.dat"] = contents;
+
+	KeyStore store("keys.dat", environment);
+	CHECK(store.BeginUpdate());
+	store.SetActiveKey(MakeKey("active"));
+	CHECK(!store.Save());
+	store.EndUpdate(true);
+	CHECK_EQUAL(contents, environment.Files["keys.dat"]);
+	CHECK(environment.Files.find("keys.dat.bad") == environment.Files.end());
+}
+
+TEST(KeyStore, WriteFails)
+{
+	// the old file is still there if the new one couldn't be written
+	MemoryKeyEnvironment environment;
+	auto contents = MakeStore();
+	environment.Files["keys.dat"] = contents;
+	environment.WritesFail = true;
+
+	KeyStore store("keys.dat", environment);
+	CHECK(store.BeginUpdate());
+	PlayerKeyPair key;
+	store.TakePooledKey(key);
+	CHECK(!store.Save());
+	store.EndUpdate(true);
+	CHECK_EQUAL(contents, environment.Files["keys.dat"]);
+}
+
+TEST(KeyStore, LockTimesOut)
+{
+	MemoryKeyEnvironment environment;
+	environment.LockTimesOut = true;
+	KeyStore store("keys.dat", environment);
+	CHECK(!store.BeginUpdate());
+	CHECK_EQUAL(1U, environment.Warnings.size());
+
+	KeyManager keys("keys.dat", environment);
+	PlayerKeyPair key;
+	CHECK(!keys.GetBackupKey(key));
+	CHECK_EQUAL(0U, keys.GetPoolSize());
+}
+
+TEST(KeyManager, BackupKey)
+{
+	MemoryKeyEnvironment environment;
+	KeyManager keys("keys.dat", environment);
+	PlayerKeyPair key;
+	CHECK(!keys.GetBackupKey(key));
+
+	keys.SetBackupKey(MakeKey("active"));
+	CHECK(keys.GetBackupKey(key));
+	CHECK(SameKey(MakeKey("active"), key));
+
+	// setting the same key again doesn't rewrite the file
+	environment.WritesFail = true;
+	keys.SetBackupKey(MakeKey("active"));
+	CHECK(environment.Warnings.empty());
+}
+
+TEST(KeyManager, KeyFromPool)
+{
+	MemoryKeyEnvironment environment;
+	environment.Files["keys.dat"] = MakeStore();
+	KeyManager keys("keys.dat", environment);
+
+	PlayerKeyPair key;
+	CHECK(!keys.TakeKey(key, false));
+	keys.PrepareKey();
+	CHECK(keys.TakeKey(key, true));
+	CHECK(SameKey(MakeKey("pool3"), key));
+	CHECK_EQUAL(2U, keys.GetPoolSize());
+	CHECK_EQUAL(0, environment.Generated.load());
+	CHECK(!keys.IsKeyReady());
+
+	// the backup isn't touched
+	CHECK(keys.GetBackupKey(key));
+	CHECK(SameKey(MakeKey("active"), key));
+}
+
+TEST(KeyManager, GeneratedKey)
+{
+	MemoryKeyEnvironment environment;
+	KeyManager keys("keys.dat", environment);
+
+	PlayerKeyPair key;
+	CHECK(keys.TakeKey(key, true)); // starts preparing one itself
+	CHECK_EQUAL("generatedPrivate1", key.PrivateKey);
+	CHECK_EQUAL(1, environment.Generated.load());
+
+	keys.PrepareKey();
+	CHECK(keys.TakeKey(key, true));
+	CHECK_EQUAL("generatedPrivate2", key.PrivateKey);
+}
+
+TEST(KeyManager, GenerationFails)
+{
+	MemoryKeyEnvironment environment;
+	environment.GenerationFails = true;
+	KeyManager keys("keys.dat", environment);
+
+	PlayerKeyPair key;
+	CHECK(!keys.TakeKey(key, true));
+	CHECK_EQUAL("Keypair generation failed", environment.Warnings.back());
+
+	// the next request tries again
+	environment.GenerationFails = false;
+	CHECK(keys.TakeKey(key, true));
+}
+
+TEST(KeyManager, FillPool)
+{
+	MemoryKeyEnvironment environment;
+	KeyManager keys("keys.dat", environment);
+	keys.FillPool(5);
+	for (int i = 0; i < 5000 && keys.GetPoolSize() < 5; i++)
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	CHECK_EQUAL(5U, keys.GetPoolSize());
+
+	// once it's full it stays that size
+	std::this_thread::sleep_for(std::chrono::milliseconds(20));
+	CHECK_EQUAL(5, environment.Generated.load());
+
+	// and keys come out of it before anything gets generated
+	PlayerKeyPair key;
+	CHECK(keys.TakeKey(key, true));
+	CHECK_EQUAL(5, environment.Generated.load());
+	CHECK_EQUAL(4U, keys.GetPoolSize());
+}
+
+TEST(KeyManager, ValidateKeyPair)
+{
+	PlayerKeyPair key;
+	key.PrivateKey = PrivateKeyA;
+	key.PublicKey = PublicKeyA;
+	CHECK(KeyManager::ValidateKeyPair(key));
+	key.PrivateKey = PrivateKeyB;
+	key.PublicKey = PublicKeyB;
+	CHECK(KeyManager::ValidateKeyPair(key));
+
+	// halves from different keys
+	key.PublicKey = PublicKeyA;
+	CHECK(!KeyManager::ValidateKeyPair(key));
+
+	// damaged or missing
+	key.PrivateKey = PrivateKeyA;
+	key.PublicKey[40] = key.PublicKey[40] == 'A' ? 'B' : 'A';
+	CHECK(!KeyManager::ValidateKeyPair(key));
+	key.PublicKey = PublicKeyA.substr(0, 100);
+	CHECK(!KeyManager::ValidateKeyPair(key));
+	key.PublicKey = "";
+	CHECK(!KeyManager::ValidateKeyPair(key));
+}
+
+TEST(KeyManager, GetUid)
+{
+	// first 8 bytes of SHA256 of the stripped public key, little endian
+	CHECK_EQUAL(0x67C4D382C860269ULL, KeyManager::GetUid(PublicKeyA));
+	CHECK(KeyManager::GetUid(PublicKeyA) != KeyManager::GetUid(PublicKeyB));
+}
@@ -0,0 +1,135 @@
+#include "Test.hpp"
+#include "../../DewRecode/src/LogFilter.hpp"
+
+namespace
+{
+	std::vector<std::string> List()
+	{
+		return std::vector<std::string>();
+	}
+
+	std::vector<std::string> List(const char* a)
+	{
+		return std::vector<std::string>(1, a);
+	}
+
+	std::vector<std::string> List(const char* a, const char* b)
+	{
+		std::vector<std::string> list;
+		list.push_back(a);
+		list.push_back(b);
+		return list;
+	}
+}
+
+TEST(LogFilter, EmptyMatchesEverything)
+{
+	LogFilter filter(List(), List());
+	CHECK(filter.IsEmpty());
+	CHECK(filter.Matches(LogSeverity::Debug, "Game", "anything"));
+	CHECK(filter.Matches(LogSeverity::Fatal, "", ""));
+}
+
+TEST(LogFilter, IncludeNeedsEveryString)
+{
+	LogFilter filter(List("map", "load"), List());
+	CHECK(!filter.IsEmpty());
+	CHECK(filter.Matches(LogSeverity::Info, "Game", "loading map guardian"));
+	CHECK(!filter.Matches(LogSeverity::Info, "Game", "map changed"));
+	CHECK(!filter.Matches(LogSeverity::Info, "Game", "loading"));
+}
+
+TEST(LogFilter, ExcludeAnyString)
+{
+	LogFilter filter(List(), List("spam", "noise"));
+	CHECK(filter.Matches(LogSeverity::Info, "Game", "useful message"));
+	CHECK(!filter.Matches(LogSeverity::Info, "Game", "some spam here"));
+	CHECK(!filter.Matches(LogSeverity::Info, "Game", "noise"));
+}
+
+TEST(LogFilter, OverlappingStrings)
+{
+	// "she" and "he" end at the same place, the automaton has to report both through the fail link
+	LogFilter filter(List("he", "she"), List());
+	CHECK(filter.Matches(LogSeverity::Info, "", "ushers"));
+	CHECK(!filter.Matches(LogSeverity::Info, "", "hers"));
+
+	LogFilter excludes(List(), List("abcd", "bc"));
+	CHECK(!excludes.Matches(LogSeverity::Info, "", "xabcy"));
+	CHECK(excludes.Matches(LogSeverity::Info, "", "xacby"));
+}
+
+TEST(LogFilter, EmptyExcludeMatchesEverything)
+{
+	LogFilter filter(List(), List(""));
+	CHECK(!filter.Matches(LogSeverity::Info, "Game", "message"));
+
+	LogFilter include(List(""), List());
+	CHECK(include.Matches(LogSeverity::Info, "Game", "message"));
+}
+
+TEST(LogFilter, Module)
+{
+	LogFilter filter(List("module:game"), List());
+	CHECK(filter.Matches(LogSeverity::Info, "Game", "message"));
+	CHECK(!filter.Matches(LogSeverity::Info, "GameRules", "message"));
+	CHECK(!filter.Matches(LogSeverity::Info, "Server", "message"));
+
+	LogFilter wildcard(List(), List("module:Server*"));
+	CHECK(!wildcard.Matches(LogSeverity::Info, "ServerBrowser", "message"));
+	CHECK(wildcard.Matches(LogSeverity::Info, "Game", "message"));
+}
+
+TEST(LogFilter, Severity)
+{
+	LogFilter include(List("severity:warning"), List());
+	CHECK(!include.Matches(LogSeverity::Info, "Game", "message"));
+	CHECK(include.Matches(LogSeverity::Warning, "Game", "message"));
+	CHECK(include.Matches(LogSeverity::Fatal, "Game", "message"));
+
+	LogFilter exclude(List(), List("severity:info"));
+	CHECK(!exclude.Matches(LogSeverity::Debug, "Game", "message"));
+	CHECK(!exclude.Matches(LogSeverity::Info, "Game", "message"));
+	CHECK(exclude.Matches(LogSeverity::Warning, "Game", "message"));
+}
+
+TEST(LogFilter, UnknownSeverityIsPlainString)
+{
+	LogFilter filter(List("severity:loud"), List());
+	CHECK(filter.Matches(LogSeverity::Info, "Game", "severity:loud"));
+	CHECK(!filter.Matches(LogSeverity::Fatal, "Game", "message"));
+}
+
+TEST(LogFilter, Wildcard)
+{
+	LogFilter filter(List("player ? joined*team"), List());
+	CHECK(filter.Matches(LogSeverity::Info, "Game", "[net] player 3 joined red team"));
+	CHECK(!filter.Matches(LogSeverity::Info, "Game", "player 12 joined red team"));
+	CHECK(!filter.Matches(LogSeverity::Info, "Game", "player 3 joined"));
+}
+
+TEST(LogFilter, ManyIncludeStrings)
+{
+	// more than 64 include strings falls back from the bitmask to a list
+	std::vector<std::string> include;
+	std::string message;
+	for (int i = 0; i < 70; i++)
+	{
+		include.push_back("<" + std::to_string(i) + ">");
+		message += include.back();
+	}
+
+	LogFilter filter(include, List());
+	CHECK(filter.Matches(LogSeverity::Info, "Game", message.c_str()));
+	message.erase(message.find("<69>"));
+	CHECK(!filter.Matches(LogSeverity::Info, "Game", message.c_str()));
+}
+
+TEST(LogFilter, PredicatesAndStrings)
+{
+	LogFilter filter(List("module:Game", "map"), List("spam"));
+	CHECK(filter.Matches(LogSeverity::Info, "Game", "map loaded"));
+	CHECK(!filter.Matches(LogSeverity::Info, "Server", "map loaded"));
+	CHECK(!filter.Matches(LogSeverity::Info, "Game", "player joined"));
+	CHECK(!filter.Matches(LogSeverity::Info, "Game", "map spam"));
+}
@@ -0,0 +1,405 @@
+#include "Test.hpp"
+#include "../../DewRecode/src/MapCatalog.hpp"
+#include <cstring>
+#include <memory>
+#include <set>
+
+namespace
+{
+	// keeps the game folder in memory, folders exist if they've been added or have something in them
+	class MemoryMapEnvironment : public MapCatalogEnvironment
+	{
+	public:
+		struct File
+		{
+			std::vector<char> Data;
+			uint64_t WriteTime;
+		};
+
+		struct Watch
+		{
+			std::string Path;
+			bool Subtree;
+			bool Changed;
+		};
+
+		std::map<std::string, File> Files;
+		std::set<std::string> Dirs;
+		std::vector<std::unique_ptr<Watch>> Watches;
+		int Listings = 0;
+		int Reads = 0;
+		int Stopped = 0;
+
+		void AddFile(const std::string& path, const std::vector<char>& data, uint64_t writeTime = 1)
+		{
+			File file;
+			file.Data = data;
+			file.WriteTime = writeTime;
+			Files[path] = file;
+			Changed(path);
+		}
+
+		void RemoveFile(const std::string& path)
+		{
+			Files.erase(path);
+			Changed(path);
+		}
+
+		void AddDir(const std::string& path)
+		{
+			Dirs.insert(path);
+			Changed(path);
+		}
+
+		// fires the watches that would see a change to a path, like the change notifications do
+		void Changed(const std::string& path)
+		{
+			for (auto& watch : Watches)
+			{
+				auto prefix = watch->Path + "\\";
+				if (path.compare(0, prefix.length(), prefix) == 0 && (watch->Subtree || path.find('\\', prefix.length()) == std::string::npos))
+					watch->Changed = true;
+			}
+		}
+
+		bool Exists(const std::string& dir)
+		{
+			if (Dirs.count(dir))
+				return true;
+			for (auto& pair : Files)
+			{
+				if (pair.first.compare(0, dir.length() + 1, dir + "\\") == 0)
+					return true;
+			}
+			return false;
+		}
+
+		void ListDirectory(const std::string& path, std::vector<DirectoryEntry>& entries)
+		{
+			Listings++;
+			auto prefix = path + "\\";
+			std::set<std::string> dirs;
+			for (auto& dir : Dirs)
+			{
+				if (dir.compare(0, prefix.length(), prefix) == 0)
+					dirs.insert(dir.substr(prefix.length(), dir.find('\\', prefix.length()) - prefix.length()));
+			}
+			for (auto& pair : Files)
+			{
+				if (pair.first.compare(0, prefix.length(), prefix) != 0)
+					continue;
+
+				auto name = pair.first.substr(prefix.length());
+				auto slash = name.find('\\');
+				if (slash != std::string::npos)
+				{
+					dirs.insert(name.substr(0, slash));
+					continue;
+				}
+
+				DirectoryEntry entry;
+				entry.Name = name;
+				entry.IsDirectory = false;
+				entry.WriteTime = pair.second.WriteTime;
+				entry.Size = pair.second.Data.size();
+				entries.push_back(entry);
+			}
+			for (auto& name : dirs)
+			{
+				DirectoryEntry entry;
+				entry.Name = name;
+				entry.IsDirectory = true;
+				entry.WriteTime = 0;
+				entry.Size = 0;
+				entries.push_back(entry);
+			}
+		}
+
+		bool FileExists(const std::string& path)
+		{
+			return Files.count(path) != 0;
+		}
+
+		bool ReadFileStart(const std::string& path, size_t length, std::vector<char>& data)
+		{
+			Reads++;
+			auto it = Files.find(path);
+			if (it == Files.end())
+				return false;
+			if (length > it->second.Data.size())
+				length = it->second.Data.size();
+			data.assign(it->second.Data.begin(), it->second.Data.begin() + length);
+			return true;
+		}
+
+		void* StartWatching(const std::string& path, bool subtree)
+		{
+			if (!Exists(path))
+				return NULL;
+
+			std::unique_ptr<Watch> watch(new Watch());
+			watch->Path = path;
+			watch->Subtree = subtree;
+			watch->Changed = false;
+			Watches.push_back(std::move(watch));
+			return Watches.back().get();
+		}
+
+		bool HasChanged(void* watch)
+		{
+			auto changed = static_cast<Watch*>(watch)->Changed;
+			static_cast<Watch*>(watch)->Changed = false;
+			return changed;
+		}
+
+		void StopWatching(void* watch)
+		{
+			Stopped++;
+		}
+	};
+
+	// the parts of a map header MapCatalog reads
+	std::vector<char> MakeMap(int mapId, const std::string& scenarioPath, int32_t magic = 'head')
+	{
+		std::vector<char> data(0x3390 + 0x100, 0);
+		memcpy(data.data(), &magic, sizeof(magic));
+		memcpy(data.data() + 0x1A4, scenarioPath.c_str(), scenarioPath.length());
+		memcpy(data.data() + 0x2DEC, &mapId, sizeof(mapId));
+		return data;
+	}
+
+	std::vector<char> MakeVariant()
+	{
+		return std::vector<char>(0x100, 1);
+	}
+
+	void AddDefaultFiles(MemoryMapEnvironment& env)
+	{
+		env.AddFile("maps\\guardian.map", MakeMap(320, "levels\\multi\\guardian\\guardian"));
+		env.AddFile("maps\\Riverworld.MAP", MakeMap(700, "levels\\multi\\riverworld\\riverworld"));
+		env.AddFile("maps\\tags.dat", std::vector<char>(0x4000, 0));
+		env.AddFile("maps\\fonts\\font_package.bin", std::vector<char>(0x4000, 0));
+		env.AddFile("mods\\variants\\Slayer Pro\\variant.slayer", MakeVariant());
+		env.AddFile("mods\\maps\\Mine\\sandbox.map", MakeVariant());
+	}
+}
+
+TEST(MapCatalog, Maps)
+{
+	MemoryMapEnvironment env;
+	AddDefaultFiles(env);
+	env.AddFile("maps\\broken.map", MakeMap(1, "levels\\broken", 'tail'));
+	env.AddFile("maps\\short.map", std::vector<char>(0x100, 0));
+	auto unterminated = MakeMap(2, "");
+	memset(unterminated.data() + 0x1A4, 'a', 0x100);
+	env.AddFile("maps\\unterminated.map", unterminated);
+	MapCatalog catalog(env);
+
+	// names come back sorted case-insensitively, with the case they have on disk
+	auto names = catalog.GetMapNames();
+	CHECK_EQUAL(5U, names.size());
+	CHECK_EQUAL(std::string("broken"), names[0]);
+	CHECK_EQUAL(std::string("guardian"), names[1]);
+	CHECK_EQUAL(std::string("Riverworld"), names[2]);
+	CHECK_EQUAL(std::string("short"), names[3]);
+	CHECK_EQUAL(std::string("unterminated"), names[4]);
+
+	MapCatalog::MapInfo info;
+	CHECK(catalog.FindMap("GUARDIAN", info));
+	CHECK_EQUAL(std::string("guardian"), info.Name);
+	CHECK_EQUAL(std::string("maps\\guardian.map"), info.Path);
+	CHECK_EQUAL(320, info.MapId);
+	CHECK_EQUAL(std::string("levels\\multi\\guardian\\guardian"), info.ScenarioPath);
+
+	CHECK(catalog.FindMap("riverworld", info));
+	CHECK_EQUAL(700, info.MapId);
+	CHECK_EQUAL(std::string("maps\\Riverworld.MAP"), info.Path);
+
+	// files that aren't maps are still listed, but without a map ID
+	CHECK(catalog.FindMap("broken", info));
+	CHECK_EQUAL(-1, info.MapId);
+	CHECK(info.ScenarioPath.empty());
+	CHECK(catalog.FindMap("short", info));
+	CHECK_EQUAL(-1, info.MapId);
+	CHECK(catalog.FindMap("unterminated", info));
+	CHECK_EQUAL(2, info.MapId);
+	CHECK(info.ScenarioPath.empty());
+
+	CHECK(!catalog.FindMap("tags", info));
+	CHECK(!catalog.FindMap("font_package", info));
+	CHECK(!catalog.FindMap("", info));
+}
+
+TEST(MapCatalog, GameVariants)
+{
+	MemoryMapEnvironment env;
+	AddDefaultFiles(env);
+	env.AddFile("mods\\variants\\both\\variant.slayer", MakeVariant());
+	env.AddFile("mods\\variants\\both\\variant.ctf", MakeVariant());
+	env.AddFile("mods\\variants\\Hill\\Variant.KOTH", MakeVariant());
+	env.AddFile("mods\\variants\\unknown\\variant.unknown", MakeVariant());
+	env.AddFile("mods\\variants\\notvariant\\slayer.bin", MakeVariant());
+	env.AddDir("mods\\variants\\empty");
+	env.AddFile("mods\\variants\\loose.slayer", MakeVariant());
+	MapCatalog catalog(env);
+
+	auto names = catalog.GetGameVariantNames();
+	CHECK_EQUAL(3U, names.size());
+	CHECK_EQUAL(std::string("both"), names[0]);
+	CHECK_EQUAL(std::string("Hill"), names[1]);
+	CHECK_EQUAL(std::string("Slayer Pro"), names[2]);
+
+	MapCatalog::VariantInfo info;
+	CHECK(catalog.FindGameVariant("slayer pro", info));
+	CHECK(info.Type == Blam::GameType::Slayer);
+	CHECK_EQUAL(std::string("mods\\variants\\Slayer Pro\\variant.slayer"), info.Path);
+
+	// the lowest gametype wins if there's more than one variant in a folder
+	CHECK(catalog.FindGameVariant("both", info));
+	CHECK(info.Type == Blam::GameType::CTF);
+	CHECK_EQUAL(std::string("mods\\variants\\both\\variant.ctf"), info.Path);
+
+	CHECK(catalog.FindGameVariant("HILL", info));
+	CHECK(info.Type == Blam::GameType::KOTH);
+	CHECK_EQUAL(std::string("mods\\variants\\Hill\\Variant.KOTH"), info.Path);
+
+	CHECK(!catalog.FindGameVariant("unknown", info));
+	CHECK(!catalog.FindGameVariant("empty", info));
+	CHECK(!catalog.FindGameVariant("Mine", info)); // map variants are separate
+}
+
+TEST(MapCatalog, MapVariants)
+{
+	MemoryMapEnvironment env;
+	AddDefaultFiles(env);
+	env.AddDir("mods\\maps\\nothing");
+	env.AddFile("mods\\maps\\wrongname\\variant.map", MakeVariant());
+	MapCatalog catalog(env);
+
+	auto names = catalog.GetMapVariantNames();
+	CHECK_EQUAL(1U, names.size());
+	CHECK_EQUAL(std::string("Mine"), names[0]);
+
+	MapCatalog::VariantInfo info;
+	CHECK(catalog.FindMapVariant("mine", info));
+	CHECK_EQUAL(std::string("mods\\maps\\Mine\\sandbox.map"), info.Path);
+	CHECK(info.Type == Blam::GameType::None);
+	CHECK(!catalog.FindMapVariant("nothing", info));
+	CHECK(!catalog.FindMapVariant("Slayer Pro", info));
+}
+
+TEST(MapCatalog, AnsweredFromMemory)
+{
+	MemoryMapEnvironment env;
+	AddDefaultFiles(env);
+	MapCatalog catalog(env);
+
+	// each folder is scanned the first time it's needed, and then not again while nothing changes
+	MapCatalog::MapInfo map;
+	MapCatalog::VariantInfo variant;
+	CHECK(catalog.FindMap("guardian", map));
+	CHECK_EQUAL(1, env.Listings);
+	CHECK_EQUAL(2, env.Reads);
+	CHECK(catalog.FindGameVariant("slayer pro", variant));
+	CHECK(catalog.FindMapVariant("mine", variant));
+	auto listings = env.Listings;
+
+	for (int i = 0; i < 100; i++)
+	{
+		CHECK(catalog.FindMap("guardian", map));
+		CHECK(!catalog.FindMap("missing", map));
+		CHECK(catalog.FindGameVariant("slayer pro", variant));
+		CHECK(catalog.FindMapVariant("mine", variant));
+		catalog.GetMapNames();
+	}
+	CHECK_EQUAL(listings, env.Listings);
+	CHECK_EQUAL(2, env.Reads);
+	CHECK_EQUAL(3U, env.Watches.size());
+}
+
+TEST(MapCatalog, RescansOnChange)
+{
+	MemoryMapEnvironment env;
+	AddDefaultFiles(env);
+	MapCatalog catalog(env);
+	MapCatalog::MapInfo map;
+	MapCatalog::VariantInfo variant;
+	CHECK(catalog.FindMap("guardian", map));
+	CHECK(!catalog.FindGameVariant("oddball", variant));
+
+	// a new map gets its header read, the ones that haven't changed don't
+	env.AddFile("maps\\zanzibar.map", MakeMap(31, "levels\\multi\\zanzibar\\zanzibar"));
+	CHECK(catalog.FindMap("zanzibar", map));
+	CHECK_EQUAL(31, map.MapId);
+	CHECK_EQUAL(3, env.Reads);
+
+	// a map that's been replaced gets read again
+	env.AddFile("maps\\guardian.map", MakeMap(321, "levels\\multi\\guardian\\guardian"), 2);
+	CHECK(catalog.FindMap("guardian", map));
+	CHECK_EQUAL(321, map.MapId);
+	CHECK_EQUAL(4, env.Reads);
+
+	env.RemoveFile("maps\\zanzibar.map");
+	CHECK(!catalog.FindMap("zanzibar", map));
+	CHECK_EQUAL(4, env.Reads);
+
+	// changes in subfolders count for the variant folders
+	env.AddFile("mods\\variants\\Balls\\variant.oddball", MakeVariant());
+	CHECK(catalog.FindGameVariant("balls", variant));
+	CHECK(variant.Type == Blam::GameType::Oddball);
+	env.RemoveFile("mods\\variants\\Slayer Pro\\variant.slayer");
+	CHECK(!catalog.FindGameVariant("slayer pro", variant));
+
+	// but a change in one folder doesn't rescan the others
+	auto listings = env.Listings;
+	CHECK(catalog.FindMap("guardian", map));
+	CHECK(catalog.FindMapVariant("mine", variant));
+	CHECK_EQUAL(listings + 1, env.Listings); // mods\maps is scanned for the first time
+	CHECK(catalog.FindMap("guardian", map));
+	CHECK(catalog.FindMapVariant("mine", variant));
+	CHECK_EQUAL(listings + 1, env.Listings);
+}
+
+TEST(MapCatalog, MissingFolders)
+{
+	// a folder that doesn't exist can't be watched, so it's looked at again on every lookup until it shows up
+	MemoryMapEnvironment env;
+	MapCatalog catalog(env);
+	MapCatalog::VariantInfo variant;
+	CHECK(!catalog.FindMapVariant("mine", variant));
+	CHECK(!catalog.FindMapVariant("mine", variant));
+	CHECK_EQUAL(2, env.Listings);
+	CHECK(env.Watches.empty());
+
+	env.AddFile("mods\\maps\\Mine\\sandbox.map", MakeVariant());
+	CHECK(catalog.FindMapVariant("mine", variant));
+	CHECK(catalog.FindMapVariant("mine", variant));
+	CHECK_EQUAL(3, env.Listings);
+	CHECK_EQUAL(1U, env.Watches.size());
+}
+
+TEST(MapCatalog, Invalidate)
+{
+	MemoryMapEnvironment env;
+	AddDefaultFiles(env);
+	{
+		MapCatalog catalog(env);
+		MapCatalog::MapInfo map;
+		CHECK(catalog.FindMap("guardian", map));
+		auto listings = env.Listings;
+
+		// everything's listed again, but map headers are still only read if the file changed
+		catalog.Invalidate();
+		CHECK(catalog.FindMap("guardian", map));
+		CHECK_EQUAL(listings + 1, env.Listings);
+		CHECK_EQUAL(2, env.Reads);
+		CHECK_EQUAL(320, map.MapId);
+
+		MapCatalog::VariantInfo variant;
+		catalog.FindGameVariant("slayer pro", variant);
+		catalog.FindMapVariant("mine", variant);
+	}
+
+	// the watches are stopped with the catalog
+	CHECK_EQUAL(3, env.Stopped);
+}
@@ -0,0 +1,301 @@
+#include "Test.hpp"
+#include "../../DewRecode/src/HostHealth.hpp"
+#include "../../DewRecode/src/RequestBatch.hpp"
+#include <atomic>
+#include <map>
+
+namespace
+{
+	enum class Outcome
+	{
+		None,
+		Ok,
+		Failed,
+		BackedOff,
+		TimedOut
+	};
+
+	// stand-in for the master servers, with latency and failure injection per host
+	class MockMaster
+	{
+	public:
+		struct Host
+		{
+			int LatencyMs = 0;
+			int Failures = 0; // fail this many requests before succeeding, -1 fails them all
+			bool Hang = false; // don't respond until Release is called
+		};
+
+		std::atomic<int> Active;
+		std::atomic<int> MaxActive;
+
+		MockMaster()
+		{
+			Active = 0;
+			MaxActive = 0;
+		}
+
+		void SetHost(const std::wstring& host, const Host& behavior)
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			hosts[host] = behavior;
+		}
+
+		int GetRequestCount(const std::wstring& host)
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			return requests[host];
+		}
+
+		void Release()
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			released = true;
+			releasedChanged.notify_all();
+		}
+
+		Outcome Send(const std::wstring& host)
+		{
+			auto active = ++Active;
+			auto max = MaxActive.load();
+			while (active > max && !MaxActive.compare_exchange_weak(max, active))
+			{
+			}
+
+			Host behavior;
+			{
+				std::unique_lock<std::mutex> guard(lock);
+				requests[host]++;
+				behavior = hosts[host];
+				if (behavior.Failures > 0)
+					hosts[host].Failures--;
+				if (behavior.Hang)
+					releasedChanged.wait(guard, [this]() { return released; });
+			}
+
+			std::this_thread::sleep_for(std::chrono::milliseconds(behavior.LatencyMs));
+			Active--;
+			return behavior.Failures != 0 ? Outcome::Failed : Outcome::Ok;
+		}
+
+	private:
+		std::mutex lock;
+		std::condition_variable releasedChanged;
+		bool released = false;
+		std::map<std::wstring, Host> hosts;
+		std::map<std::wstring, int> requests;
+	};
+
+	// what HttpPool does around each request, with a clock the test controls
+	struct MockPool
+	{
+		std::shared_ptr<MockMaster> Master = std::make_shared<MockMaster>();
+		std::mutex Lock;
+		HostHealth Health = HostHealth(1234);
+		uint32_t Now = 0;
+
+		Outcome Send(const std::wstring& host)
+		{
+			{
+				std::lock_guard<std::mutex> guard(Lock);
+				if (Health.IsBackedOff(host, Now))
+					return Outcome::BackedOff;
+			}
+
+			auto outcome = Master->Send(host);
+
+			std::lock_guard<std::mutex> guard(Lock);
+			Health.Update(host, outcome == Outcome::Ok, Now);
+			return outcome;
+		}
+	};
+
+	// sends to every host, jobs can outlive the call so they only hold on to shared pointers
+	std::vector<Outcome> SendAll(const std::shared_ptr<MockPool>& pool, const std::vector<std::wstring>& hosts, size_t workers, int deadlineMs)
+	{
+		auto list = std::make_shared<std::vector<std::wstring>>(hosts);
+		std::function<Outcome(size_t)> send = [pool, list](size_t index) { return pool->Send((*list)[index]); };
+		return RunBatch(hosts.size(), send, workers, std::chrono::milliseconds(deadlineMs), Outcome::TimedOut);
+	}
+
+	std::vector<std::wstring> Hosts(int count)
+	{
+		std::vector<std::wstring> hosts;
+		for (int i = 0; i < count; i++)
+			hosts.push_back(L"http://master" + std::to_wstring(i) + L":80");
+		return hosts;
+	}
+
+	MockMaster::Host Behavior(int latencyMs, int failures = 0, bool hang = false)
+	{
+		MockMaster::Host host;
+		host.LatencyMs = latencyMs;
+		host.Failures = failures;
+		host.Hang = hang;
+		return host;
+	}
+
+	double MsSince(std::chrono::steady_clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+}
+
+TEST(MasterServer, ResultsInOrder)
+{
+	auto pool = std::make_shared<MockPool>();
+	auto hosts = Hosts(8);
+	for (int i = 0; i < 8; i++)
+		pool->Master->SetHost(hosts[i], Behavior((8 - i) * 3, i % 2 ? -1 : 0)); // later hosts answer first
+
+	auto results = SendAll(pool, hosts, 4, 5000);
+	CHECK_EQUAL(8U, results.size());
+	for (int i = 0; i < 8; i++)
+		CHECK(results[i] == (i % 2 ? Outcome::Failed : Outcome::Ok));
+}
+
+TEST(MasterServer, FixedWorkerCount)
+{
+	// 12 masters and 4 workers, never more than 4 requests at once, but still more than one at a time
+	auto pool = std::make_shared<MockPool>();
+	auto hosts = Hosts(12);
+	for (auto& host : hosts)
+		pool->Master->SetHost(host, Behavior(20));
+
+	auto start = std::chrono::steady_clock::now();
+	auto results = SendAll(pool, hosts, 4, 5000);
+	auto elapsed = MsSince(start);
+
+	for (auto result : results)
+		CHECK(result == Outcome::Ok);
+	CHECK(pool->Master->MaxActive <= 4);
+	CHECK(pool->Master->MaxActive >= 2);
+	CHECK(elapsed >= 55); // at least 3 rounds of 20ms
+	CHECK(elapsed < 12 * 20);
+}
+
+TEST(MasterServer, Deadline)
+{
+	// a master that never answers can't hold up the others or the caller
+	auto pool = std::make_shared<MockPool>();
+	auto hosts = Hosts(3);
+	pool->Master->SetHost(hosts[0], Behavior(5));
+	pool->Master->SetHost(hosts[1], Behavior(0, 0, true));
+	pool->Master->SetHost(hosts[2], Behavior(10, -1));
+
+	auto start = std::chrono::steady_clock::now();
+	auto results = SendAll(pool, hosts, 4, 200);
+	auto elapsed = MsSince(start);
+
+	CHECK(results[0] == Outcome::Ok);
+	CHECK(results[1] == Outcome::TimedOut);
+	CHECK(results[2] == Outcome::Failed);
+	CHECK(elapsed >= 190);
+	CHECK(elapsed < 2000);
+
+	// the request that timed out finishes in the background without touching the results we already returned
+	pool->Master->Release();
+	while (pool->Master->Active > 0)
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	CHECK(results[1] == Outcome::TimedOut);
+}
+
+TEST(MasterServer, NothingStartsAfterDeadline)
+{
+	// one worker, stuck on the first master, the rest never get sent
+	auto pool = std::make_shared<MockPool>();
+	auto hosts = Hosts(3);
+	pool->Master->SetHost(hosts[0], Behavior(0, 0, true));
+
+	auto results = SendAll(pool, hosts, 1, 50);
+	for (auto result : results)
+		CHECK(result == Outcome::TimedOut);
+
+	pool->Master->Release();
+	while (pool->Master->Active > 0)
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	std::this_thread::sleep_for(std::chrono::milliseconds(20));
+	CHECK_EQUAL(1, pool->Master->GetRequestCount(hosts[0]));
+	CHECK_EQUAL(0, pool->Master->GetRequestCount(hosts[1]));
+	CHECK_EQUAL(0, pool->Master->GetRequestCount(hosts[2]));
+}
+
+TEST(MasterServer, EmptyBatch)
+{
+	auto pool = std::make_shared<MockPool>();
+	CHECK(SendAll(pool, std::vector<std::wstring>(), 4, 1000).empty());
+}
+
+TEST(MasterServer, FailingMasterIsBackedOff)
+{
+	// master1 is down, master2 drops two requests and recovers, master0 is fine but slow
+	auto pool = std::make_shared<MockPool>();
+	auto hosts = Hosts(3);
+	pool->Master->SetHost(hosts[0], Behavior(10));
+	pool->Master->SetHost(hosts[1], Behavior(0, -1));
+	pool->Master->SetHost(hosts[2], Behavior(0, 2));
+
+	// a couple of failures in a row don't back a host off
+	for (int round = 0; round < 3; round++)
+	{
+		auto results = SendAll(pool, hosts, 4, 5000);
+		CHECK(results[0] == Outcome::Ok);
+		CHECK(results[1] == Outcome::Failed);
+		CHECK(results[2] == (round < 2 ? Outcome::Failed : Outcome::Ok));
+		pool->Now += 1000;
+	}
+
+	// the third failure in a row did
+	auto results = SendAll(pool, hosts, 4, 5000);
+	CHECK(results[0] == Outcome::Ok);
+	CHECK(results[1] == Outcome::BackedOff);
+	CHECK(results[2] == Outcome::Ok);
+	CHECK_EQUAL(3, pool->Master->GetRequestCount(hosts[1]));
+
+	// it gets tried again once the backoff (5s plus up to a quarter of that) is over
+	pool->Now += 6250;
+	results = SendAll(pool, hosts, 4, 5000);
+	CHECK(results[1] == Outcome::Failed);
+	CHECK_EQUAL(4, pool->Master->GetRequestCount(hosts[1]));
+
+	// and it comes back once it starts answering
+	pool->Master->SetHost(hosts[1], Behavior(0));
+	pool->Now += 12500;
+	results = SendAll(pool, hosts, 4, 5000);
+	CHECK(results[1] == Outcome::Ok);
+	results = SendAll(pool, hosts, 4, 5000);
+	CHECK(results[1] == Outcome::Ok);
+}
+
+TEST(HostHealth, Backoff)
+{
+	HostHealth health(42);
+	std::wstring host = L"http://master:80";
+	uint32_t now = 0xFFFFF000; // the clock wraps while it's backed off
+
+	CHECK(!health.IsBackedOff(host, now));
+	auto change = health.Update(host, false, now);
+	CHECK_EQUAL(1U, change.Failures);
+	CHECK_EQUAL(0U, change.BackoffMs);
+	health.Update(host, false, now);
+	CHECK(!health.IsBackedOff(host, now));
+
+	// 5s plus up to 25% jitter, then doubling
+	uint32_t expected[] = { 5000, 10000, 20000, 40000, 80000, 160000, 300000, 300000 };
+	for (auto base : expected)
+	{
+		change = health.Update(host, false, now);
+		CHECK(change.BackoffMs >= base);
+		CHECK(change.BackoffMs <= base + base / 4);
+		CHECK(health.IsBackedOff(host, now));
+		CHECK(health.IsBackedOff(host, now + change.BackoffMs - 1));
+		CHECK(!health.IsBackedOff(host, now + change.BackoffMs));
+		CHECK(!health.IsBackedOff(L"http://other:80", now));
+	}
+
+	change = health.Update(host, true, now);
+	CHECK(change.Recovered);
+	CHECK(!health.IsBackedOff(host, now));
+	change = health.Update(host, true, now);
+	CHECK(!change.Recovered);
+}
@@ -0,0 +1,107 @@
+#include "Test.hpp"
+#include "../../DewRecode/src/MpscQueue.hpp"
+#include <thread>
+
+namespace
+{
+	struct Item
+	{
+		int Producer;
+		int Index;
+	};
+
+	bool Push(MpscQueue<Item, 8>& queue, int producer, int index)
+	{
+		return queue.TryEnqueue([&](Item& item)
+		{
+			item.Producer = producer;
+			item.Index = index;
+		});
+	}
+}
+
+TEST(MpscQueue, InOrder)
+{
+	MpscQueue<Item, 8> queue;
+	CHECK_EQUAL(0U, queue.Drain([](Item&) {}));
+
+	for (int i = 0; i < 5; i++)
+		CHECK(Push(queue, 0, i));
+
+	std::vector<int> indexes;
+	CHECK_EQUAL(5U, queue.Drain([&](Item& item) { indexes.push_back(item.Index); }));
+	CHECK_EQUAL(5U, indexes.size());
+	for (int i = 0; i < 5; i++)
+		CHECK_EQUAL(i, indexes[i]);
+}
+
+TEST(MpscQueue, Full)
+{
+	MpscQueue<Item, 8> queue;
+	for (int i = 0; i < 8; i++)
+		CHECK(Push(queue, 0, i));
+
+	bool filled = false;
+	CHECK(!queue.TryEnqueue([&](Item&) { filled = true; }));
+	CHECK(!filled);
+
+	// draining frees the slots again, and the positions keep going round the ring
+	CHECK_EQUAL(8U, queue.Drain([](Item&) {}));
+	for (int round = 0; round < 10; round++)
+	{
+		for (int i = 0; i < 6; i++)
+			CHECK(Push(queue, 0, round * 6 + i));
+
+		int expected = round * 6;
+		queue.Drain([&](Item& item) { CHECK_EQUAL(expected++, item.Index); });
+		CHECK_EQUAL(round * 6 + 6, expected);
+	}
+}
+
+TEST(MpscQueue, Stress)
+{
+	// a few producers push as fast as they can into a small queue while the consumer drains it, every item has to come out exactly
+	// once, and each producer's items have to come out in the order it pushed them
+	const int ProducerCount = 4;
+	const int ItemsPerProducer = 200000;
+
+	MpscQueue<Item, 64> queue;
+	std::vector<int> next(ProducerCount, 0);
+	bool outOfOrder = false;
+
+	std::vector<std::thread> producers;
+	for (int p = 0; p < ProducerCount; p++)
+	{
+		producers.push_back(std::thread([&, p]()
+		{
+			for (int i = 0; i < ItemsPerProducer; i++)
+			{
+				while (!queue.TryEnqueue([&](Item& item) { item.Producer = p; item.Index = i; }))
+					std::this_thread::yield(); // full, wait for the consumer
+			}
+		}));
+	}
+
+	size_t received = 0;
+	while (received < static_cast<size_t>(ProducerCount) * ItemsPerProducer)
+	{
+		auto count = queue.Drain([&](Item& item)
+		{
+			if (item.Producer < 0 || item.Producer >= ProducerCount || item.Index != next[item.Producer])
+				outOfOrder = true;
+			else
+				next[item.Producer]++;
+		});
+		received += count;
+		if (!count)
+			std::this_thread::yield();
+	}
+
+	for (auto& producer : producers)
+		producer.join();
+
+	CHECK(!outOfOrder);
+	for (int p = 0; p < ProducerCount; p++)
+		CHECK_EQUAL(ItemsPerProducer, next[p]);
+	CHECK_EQUAL(0U, queue.Drain([](Item&) {}));
+}
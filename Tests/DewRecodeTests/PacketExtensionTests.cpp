@@ -0,0 +1,277 @@
+#include "Test.hpp"
+#include "../../DewRecode/src/Modules/Patches/PacketExtension.hpp"
+#include <cstddef>
+
+using Modules::Patches::PacketSchema;
+using Modules::Patches::PacketExtensionCodec;
+
+namespace
+{
+	struct PlayerData
+	{
+		uint8_t Team;
+		int16_t Offset;
+		bool Ready;
+		uint32_t Flags;
+	};
+
+	struct PlayerDataV2
+	{
+		uint8_t Team;
+		int16_t Offset;
+		bool Ready;
+		uint32_t Flags;
+		int8_t Emblem;
+	};
+
+	struct ScoreData
+	{
+		uint64_t Big;
+		int32_t Score;
+	};
+
+	PacketSchema MakePlayerSchema()
+	{
+		PacketSchema schema("Player", sizeof(PlayerData));
+		schema.Unsigned<uint8_t>(offsetof(PlayerData, Team), 4)
+			.Range<int16_t>(offsetof(PlayerData, Offset), -1000, 1000)
+			.Bool(offsetof(PlayerData, Ready))
+			.Unsigned<uint32_t>(offsetof(PlayerData, Flags), 32);
+		return schema;
+	}
+
+	PacketSchema MakePlayerSchemaV2()
+	{
+		PacketSchema schema("Player", sizeof(PlayerDataV2));
+		schema.Unsigned<uint8_t>(offsetof(PlayerDataV2, Team), 4)
+			.Range<int16_t>(offsetof(PlayerDataV2, Offset), -1000, 1000)
+			.Bool(offsetof(PlayerDataV2, Ready))
+			.Unsigned<uint32_t>(offsetof(PlayerDataV2, Flags), 32)
+			.Range<int8_t>(offsetof(PlayerDataV2, Emblem), -8, 7, 2);
+		return schema;
+	}
+
+	PacketSchema MakeScoreSchema()
+	{
+		PacketSchema schema("Score", sizeof(ScoreData));
+		schema.Unsigned<uint64_t>(offsetof(ScoreData, Big), 64)
+			.Range<int32_t>(offsetof(ScoreData, Score), -50, 250);
+		return schema;
+	}
+
+	// writes a block header by hand, for sending things a real codec never would
+	void WriteBlockHeader(Blam::BitWriter& writer, uint32_t id, int version, size_t length)
+	{
+		writer.WriteUnsigned<uint32_t>(id, PacketExtensionCodec::IdBits);
+		writer.WriteUnsigned<int>(version, PacketExtensionCodec::VersionBits);
+		writer.WriteUnsigned<size_t>(length, PacketExtensionCodec::LengthBits);
+	}
+}
+
+TEST(PacketExtension, RoundTrip)
+{
+	auto player = MakePlayerSchema();
+	auto score = MakeScoreSchema();
+	PacketExtensionCodec codec;
+	CHECK(codec.Add(&player));
+	CHECK(codec.Add(&score));
+	CHECK(!codec.Add(&player)); // same ID
+	CHECK_EQUAL(sizeof(PlayerData) + sizeof(ScoreData), codec.GetDataSize());
+
+	uint8_t data[sizeof(PlayerData) + sizeof(ScoreData)];
+	PlayerData playerIn = { 9, -999, true, 0xDEADBEEF };
+	ScoreData scoreIn = { 0xFEDCBA9876543210, -42 };
+	memcpy(data, &playerIn, sizeof(playerIn));
+	memcpy(data + sizeof(playerIn), &scoreIn, sizeof(scoreIn));
+
+	uint8_t buffer[256] = { 0 };
+	Blam::BitWriter writer(buffer, sizeof(buffer));
+	codec.Serialize(&writer, data);
+	writer.Finish();
+	CHECK_EQUAL(codec.GetBits(), writer.GetPosition());
+
+	uint8_t out[sizeof(data)];
+	memset(out, 0xCC, sizeof(out));
+	Blam::BitReader reader(buffer, writer.GetPosition());
+	CHECK(codec.Deserialize(&reader, out));
+	CHECK_EQUAL(0U, reader.GetRemaining());
+
+	PlayerData playerOut;
+	ScoreData scoreOut;
+	memcpy(&playerOut, out, sizeof(playerOut));
+	memcpy(&scoreOut, out + sizeof(playerOut), sizeof(scoreOut));
+	CHECK_EQUAL(9, playerOut.Team);
+	CHECK_EQUAL(-999, playerOut.Offset);
+	CHECK(playerOut.Ready);
+	CHECK_EQUAL(0xDEADBEEFU, playerOut.Flags);
+	CHECK_EQUAL(0xFEDCBA9876543210ULL, scoreOut.Big);
+	CHECK_EQUAL(-42, scoreOut.Score);
+}
+
+TEST(PacketExtension, ClampsSignedRange)
+{
+	auto player = MakePlayerSchema();
+	PacketExtensionCodec codec;
+	CHECK(codec.Add(&player));
+
+	int16_t values[] = { -32768, -1001, -1000, -1, 0, 1000, 1001, 32767 };
+	int16_t expected[] = { -1000, -1000, -1000, -1, 0, 1000, 1000, 1000 };
+	for (size_t i = 0; i < sizeof(values) / sizeof(values[0]); i++)
+	{
+		PlayerData in = { 0, values[i], false, 0 };
+		uint8_t buffer[64] = { 0 };
+		Blam::BitWriter writer(buffer, sizeof(buffer));
+		codec.Serialize(&writer, &in);
+		writer.Finish();
+
+		PlayerData out;
+		Blam::BitReader reader(buffer, writer.GetPosition());
+		CHECK(codec.Deserialize(&reader, &out));
+		CHECK_EQUAL(expected[i], out.Offset);
+	}
+}
+
+TEST(PacketExtension, OlderAndNewerVersions)
+{
+	auto oldSchema = MakePlayerSchema();
+	auto newSchema = MakePlayerSchemaV2();
+	PacketExtensionCodec oldCodec, newCodec;
+	CHECK(oldCodec.Add(&oldSchema));
+	CHECK(newCodec.Add(&newSchema));
+
+	// new -> old: the field the old peer doesn't know about gets skipped
+	PlayerDataV2 newIn = { 3, 500, true, 7, -3 };
+	uint8_t buffer[64] = { 0 };
+	Blam::BitWriter writer(buffer, sizeof(buffer));
+	newCodec.Serialize(&writer, &newIn);
+	writer.Finish();
+
+	PlayerData oldOut;
+	Blam::BitReader reader(buffer, writer.GetPosition());
+	CHECK(oldCodec.Deserialize(&reader, &oldOut));
+	CHECK_EQUAL(0U, reader.GetRemaining());
+	CHECK_EQUAL(3, oldOut.Team);
+	CHECK_EQUAL(500, oldOut.Offset);
+	CHECK_EQUAL(7U, oldOut.Flags);
+
+	// old -> new: the field the old peer didn't send is set to its minimum
+	PlayerData oldIn = { 1, -1, false, 2 };
+	Blam::BitWriter oldWriter(buffer, sizeof(buffer));
+	oldCodec.Serialize(&oldWriter, &oldIn);
+	oldWriter.Finish();
+
+	PlayerDataV2 newOut;
+	Blam::BitReader oldReader(buffer, oldWriter.GetPosition());
+	CHECK(newCodec.Deserialize(&oldReader, &newOut));
+	CHECK_EQUAL(-1, newOut.Offset);
+	CHECK_EQUAL(-8, newOut.Emblem);
+}
+
+TEST(PacketExtension, SkipsUnknownExtensions)
+{
+	auto player = MakePlayerSchema();
+	auto score = MakeScoreSchema();
+	PacketExtensionCodec sender, receiver;
+	CHECK(sender.Add(&score));
+	CHECK(sender.Add(&player));
+	CHECK(receiver.Add(&player));
+
+	uint8_t data[sizeof(ScoreData) + sizeof(PlayerData)] = { 0 };
+	PlayerData playerIn = { 5, 10, true, 20 };
+	memcpy(data + sizeof(ScoreData), &playerIn, sizeof(playerIn));
+
+	uint8_t buffer[256] = { 0 };
+	Blam::BitWriter writer(buffer, sizeof(buffer));
+	sender.Serialize(&writer, data);
+	writer.Finish();
+
+	PlayerData out;
+	Blam::BitReader reader(buffer, writer.GetPosition());
+	CHECK(receiver.Deserialize(&reader, &out));
+	CHECK_EQUAL(5, out.Team);
+	CHECK_EQUAL(20U, out.Flags);
+}
+
+TEST(PacketExtension, RejectsLengthPastEnd)
+{
+	auto player = MakePlayerSchema();
+	PacketExtensionCodec codec;
+	CHECK(codec.Add(&player));
+
+	// a block claiming to be longer than what's left in the packet
+	uint8_t buffer[64] = { 0 };
+	Blam::BitWriter writer(buffer, sizeof(buffer));
+	writer.WriteUnsigned<int>(1, PacketExtensionCodec::CountBits);
+	WriteBlockHeader(writer, player.GetId(), player.GetVersion(), 200);
+	writer.WriteBits(0, 64);
+	writer.Finish();
+
+	PlayerData out;
+	Blam::BitReader reader(buffer, writer.GetPosition());
+	CHECK(!codec.Deserialize(&reader, &out));
+}
+
+TEST(PacketExtension, RejectsLengthPastMaxBits)
+{
+	PacketExtensionCodec codec;
+
+	// fits in the packet but is bigger than anything a peer is allowed to send
+	std::vector<uint8_t> buffer(PacketExtensionCodec::MaxBits / 8 * 2, 0);
+	Blam::BitWriter writer(buffer.data(), buffer.size());
+	writer.WriteUnsigned<int>(1, PacketExtensionCodec::CountBits);
+	WriteBlockHeader(writer, 0x12345678, 1, PacketExtensionCodec::MaxBits);
+	writer.Finish();
+
+	uint8_t out;
+	Blam::BitReader reader(buffer.data(), buffer.size() * 8);
+	CHECK(!codec.Deserialize(&reader, &out));
+}
+
+TEST(PacketExtension, RejectsCountPastEnd)
+{
+	auto player = MakePlayerSchema();
+	PacketExtensionCodec codec;
+	CHECK(codec.Add(&player));
+
+	// 255 blocks can't fit in what's left, this has to fail before reading any of them
+	uint8_t buffer[64] = { 0 };
+	Blam::BitWriter writer(buffer, sizeof(buffer));
+	writer.WriteUnsigned<int>(255, PacketExtensionCodec::CountBits);
+	WriteBlockHeader(writer, player.GetId(), player.GetVersion(), 0);
+	writer.Finish();
+
+	PlayerData out;
+	Blam::BitReader reader(buffer, writer.GetPosition());
+	CHECK(!codec.Deserialize(&reader, &out));
+	CHECK_EQUAL(static_cast<size_t>(PacketExtensionCodec::CountBits), reader.GetPosition());
+}
+
+TEST(PacketExtension, RejectsShortBlock)
+{
+	auto player = MakePlayerSchema();
+	PacketExtensionCodec codec;
+	CHECK(codec.Add(&player));
+
+	// a block that's shorter than the fields its version says it has
+	uint8_t buffer[64] = { 0 };
+	Blam::BitWriter writer(buffer, sizeof(buffer));
+	writer.WriteUnsigned<int>(1, PacketExtensionCodec::CountBits);
+	WriteBlockHeader(writer, player.GetId(), player.GetVersion(), 8);
+	writer.WriteBits(0xFF, 8);
+	writer.Finish();
+
+	PlayerData out;
+	Blam::BitReader reader(buffer, writer.GetPosition());
+	CHECK(!codec.Deserialize(&reader, &out));
+}
+
+TEST(PacketExtension, RejectsSchemasPastMaxBits)
+{
+	PacketSchema big("Big", 8);
+	for (size_t bits = 0; bits < PacketExtensionCodec::MaxBits; bits += 64)
+		big.Unsigned<uint64_t>(0, 64);
+
+	PacketExtensionCodec codec;
+	CHECK(!codec.Add(&big));
+	CHECK_EQUAL(static_cast<size_t>(PacketExtensionCodec::CountBits), codec.GetBits());
+}
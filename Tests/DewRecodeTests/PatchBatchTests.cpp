@@ -0,0 +1,228 @@
+#include "Test.hpp"
+#include "../../DewRecode/src/PatchBatch.hpp"
+#include <cstring>
+#include <map>
+
+namespace
+{
+	// patch memory backed by a plain buffer, counts what's done to each page and can fail a write partway through a batch
+	class BufferMemory : public PatchMemory
+	{
+	public:
+		std::vector<unsigned char> Bytes;
+		std::map<size_t, int> Unprotects;
+		std::map<size_t, int> Restores;
+		std::map<size_t, int> Unrestored; // pages that are currently unprotected
+		int FailWrite = -1; // the index of the write that fails, -1 for none
+		int Writes = 0;
+		size_t FailUnprotectPage = SIZE_MAX;
+		int Flushes = 0;
+
+		BufferMemory(size_t size)
+			: Bytes(size)
+		{
+			for (size_t i = 0; i < size; i++)
+				Bytes[i] = static_cast<unsigned char>(i);
+		}
+
+		size_t GetPageSize()
+		{
+			return 0x100;
+		}
+
+		bool UnprotectPage(size_t page, uint32_t& oldProtection)
+		{
+			if (page == FailUnprotectPage)
+				return false;
+			Unprotects[page]++;
+			Unrestored[page]++;
+			oldProtection = static_cast<uint32_t>(page) + 1;
+			return true;
+		}
+
+		bool RestorePage(size_t page, uint32_t oldProtection)
+		{
+			CHECK_EQUAL(static_cast<uint32_t>(page) + 1, oldProtection);
+			Restores[page]++;
+			Unrestored[page]--;
+			return true;
+		}
+
+		bool Read(size_t address, void* out, size_t size)
+		{
+			if (address + size > Bytes.size())
+				return false;
+			memcpy(out, &Bytes[address], size);
+			return true;
+		}
+
+		bool Write(size_t address, const void* data, size_t size)
+		{
+			// every write has to be to a page that's been unprotected
+			for (auto page = address / 0x100; page <= (address + size - 1) / 0x100; page++)
+				CHECK(Unrestored[page * 0x100] > 0);
+
+			if (Writes++ == FailWrite)
+				return false;
+			memcpy(&Bytes[address], data, size);
+			return true;
+		}
+
+		void FlushInstructions(size_t address, size_t size)
+		{
+			Flushes++;
+		}
+
+		bool AllRestored()
+		{
+			for (auto& page : Unrestored)
+				if (page.second != 0)
+					return false;
+			return true;
+		}
+	};
+
+	std::vector<unsigned char> Fill(unsigned char value, size_t count)
+	{
+		return std::vector<unsigned char>(count, value);
+	}
+
+	std::vector<unsigned char> At(BufferMemory& memory, size_t address, size_t count)
+	{
+		return std::vector<unsigned char>(memory.Bytes.begin() + address, memory.Bytes.begin() + address + count);
+	}
+}
+
+TEST(PatchBatch, Applies)
+{
+	BufferMemory memory(0x400);
+	auto original = At(memory, 0x10, 4);
+	PatchBatch batch(&memory);
+	batch.Add("first", 0x10, Fill(0x90, 4), &original);
+	batch.Add("second", 0x210, Fill(0xCC, 2));
+
+	std::string error;
+	CHECK(batch.Apply(error));
+	CHECK(error.empty());
+	CHECK(At(memory, 0x10, 4) == Fill(0x90, 4));
+	CHECK(At(memory, 0x210, 2) == Fill(0xCC, 2));
+	CHECK_EQUAL(0x14, memory.Bytes[0x14]); // nothing past the patch
+	CHECK_EQUAL(1, memory.Flushes);
+	CHECK(memory.AllRestored());
+}
+
+TEST(PatchBatch, VerificationMismatch)
+{
+	// the second patch expects bytes that aren't there, so neither is written and no page is touched
+	BufferMemory memory(0x400);
+	auto before = memory.Bytes;
+	auto expected = At(memory, 0x10, 4);
+	auto wrong = Fill(0x90, 4);
+	PatchBatch batch(&memory);
+	batch.Add("first", 0x10, Fill(0xCC, 4), &expected);
+	batch.Add("second", 0x120, Fill(0xCC, 4), &wrong);
+
+	std::string error;
+	CHECK(!batch.Apply(error));
+	CHECK_EQUAL(std::string("second: unexpected bytes at 0x120"), error);
+	CHECK(memory.Bytes == before);
+	CHECK(memory.Unprotects.empty());
+	CHECK_EQUAL(0, memory.Flushes);
+
+	// expected bytes of the wrong length don't match either
+	auto shorter = At(memory, 0x10, 2);
+	PatchBatch lengths(&memory);
+	lengths.Add("short", 0x10, Fill(0xCC, 4), &shorter);
+	CHECK(!lengths.Apply(error));
+	CHECK(memory.Bytes == before);
+
+	// and neither does a read past the end
+	PatchBatch outside(&memory);
+	outside.Add("outside", 0x3FE, Fill(0xCC, 4));
+	CHECK(!outside.Apply(error));
+	CHECK_EQUAL(std::string("outside: failed to read 0x3FE"), error);
+}
+
+TEST(PatchBatch, RollbackAfterPartialFailure)
+{
+	// the third write fails, the two before it get put back, including where they overlap
+	BufferMemory memory(0x400);
+	auto before = memory.Bytes;
+	memory.FailWrite = 2;
+	PatchBatch batch(&memory);
+	batch.Add("first", 0x10, Fill(0x90, 8));
+	batch.Add("overlapping", 0x14, Fill(0xCC, 8));
+	batch.Add("third", 0x310, Fill(0xEB, 2));
+
+	std::string error;
+	CHECK(!batch.Apply(error));
+	CHECK_EQUAL(std::string("third: failed to write 0x310"), error);
+	CHECK(memory.Bytes == before);
+	CHECK_EQUAL(5, memory.Writes); // two writes, the failed one, then two to undo them
+	CHECK(memory.AllRestored());
+
+	// a page that can't be unprotected stops it before anything is written, and the pages that were get restored
+	memory.FailWrite = -1;
+	memory.Writes = 0;
+	memory.FailUnprotectPage = 0x300;
+	CHECK(!batch.Apply(error));
+	CHECK_EQUAL(0, memory.Writes);
+	CHECK_EQUAL(std::string("failed to unprotect page 0x300"), error);
+	CHECK(memory.Bytes == before);
+	CHECK(memory.AllRestored());
+}
+
+TEST(PatchBatch, EachPageUnprotectedOnce)
+{
+	// lots of writes to the same few pages, plus one that straddles a page boundary
+	BufferMemory memory(0x400);
+	PatchBatch batch(&memory);
+	for (size_t address = 0; address < 0x100; address += 4)
+		batch.Add("page0", address, Fill(0x90, 2));
+	for (size_t address = 0x200; address < 0x280; address += 8)
+		batch.Add("page2", address, Fill(0x90, 2));
+	batch.Add("straddle", 0xFE, Fill(0xCC, 4));
+
+	std::string error;
+	CHECK(batch.Apply(error));
+	CHECK_EQUAL(3U, memory.Unprotects.size());
+	CHECK_EQUAL(1, memory.Unprotects[0]);
+	CHECK_EQUAL(1, memory.Unprotects[0x100]);
+	CHECK_EQUAL(1, memory.Unprotects[0x200]);
+	CHECK(memory.Unprotects.find(0x300) == memory.Unprotects.end());
+	CHECK_EQUAL(1, memory.Restores[0]);
+	CHECK_EQUAL(1, memory.Restores[0x100]);
+	CHECK_EQUAL(1, memory.Restores[0x200]);
+	CHECK(memory.AllRestored());
+	CHECK(At(memory, 0xFE, 4) == Fill(0xCC, 4));
+}
+
+TEST(PatchBatch, ToggleBackAndForth)
+{
+	// what PatchManager does, enabling expects the original bytes and disabling expects the patch
+	BufferMemory memory(0x400);
+	auto orig = At(memory, 0x40, 5);
+	auto data = Fill(0x90, 5);
+
+	std::string error;
+	PatchBatch enable(&memory);
+	enable.Add("patch", 0x40, data, &orig);
+	CHECK(enable.Apply(error));
+	CHECK(At(memory, 0x40, 5) == data);
+
+	// enabling again fails, the patch is already there rather than the original bytes
+	CHECK(!enable.Apply(error));
+	CHECK(At(memory, 0x40, 5) == data);
+
+	PatchBatch disable(&memory);
+	disable.Add("patch", 0x40, orig, &data);
+	CHECK(disable.Apply(error));
+	CHECK(At(memory, 0x40, 5) == orig);
+
+	// an empty batch does nothing
+	PatchBatch empty(&memory);
+	empty.Add("empty", 0x40, std::vector<unsigned char>());
+	CHECK_EQUAL(0U, empty.Size());
+	CHECK(empty.Apply(error));
+	CHECK(memory.AllRestored());
+}
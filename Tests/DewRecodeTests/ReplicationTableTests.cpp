@@ -0,0 +1,119 @@
+#include "Test.hpp"
+#include "../../DewRecode/src/ReplicationTable.hpp"
+
+namespace
+{
+	// variables that don't move around once they're made, like Commands::List
+	std::deque<Command> MakeVariables(int count)
+	{
+		std::deque<Command> variables(count);
+		for (int i = 0; i < count; i++)
+		{
+			variables[i].Name = "Module.Variable" + std::to_string(i);
+			variables[i].ValueString = "0";
+		}
+		return variables;
+	}
+
+	// sets a variable the way Commands::SetVariable does, keeping the old value string to compare against
+	bool Set(ReplicationTable& table, Command& variable, const std::string& value)
+	{
+		auto oldValue = variable.ValueString;
+		variable.ValueString = value;
+		return table.Update(&variable, oldValue);
+	}
+
+	std::vector<std::string> ChangedSince(const ReplicationTable& table, unsigned int since)
+	{
+		std::vector<ReplicatedVariable> changed;
+		table.GetChangedSince(since, changed);
+		std::vector<std::string> names;
+		for (auto& variable : changed)
+			names.push_back(variable.Variable->Name);
+		return names;
+	}
+}
+
+TEST(ReplicationTable, AddBumpsGeneration)
+{
+	auto variables = MakeVariables(3);
+	ReplicationTable table;
+	CHECK_EQUAL(0U, table.GetGeneration());
+	CHECK(ChangedSince(table, 0).empty());
+
+	for (auto& variable : variables)
+		table.Add(&variable);
+	CHECK_EQUAL(3U, table.GetGeneration());
+	CHECK_EQUAL(3U, table.Size());
+	CHECK(table.Contains(&variables[1]));
+
+	// each one is in the generation it was added in, in the order they were added
+	std::vector<ReplicatedVariable> changed;
+	CHECK(table.GetChangedSince(0, changed));
+	CHECK_EQUAL(3U, changed.size());
+	for (size_t i = 0; i < changed.size(); i++)
+	{
+		CHECK(changed[i].Variable == &variables[i]);
+		CHECK_EQUAL(i + 1, changed[i].Generation);
+	}
+
+	// adding one twice doesn't give it a second entry
+	table.Add(&variables[0]);
+	CHECK_EQUAL(3U, table.Size());
+	CHECK_EQUAL(3U, table.GetGeneration());
+
+	// someone that's seen generation 1 doesn't need the first one again
+	CHECK(ChangedSince(table, 1) == std::vector<std::string>({ "Module.Variable1", "Module.Variable2" }));
+	CHECK(ChangedSince(table, 3).empty());
+}
+
+TEST(ReplicationTable, OnlyChangedValuesBump)
+{
+	auto variables = MakeVariables(4);
+	ReplicationTable table;
+	for (auto& variable : variables)
+		table.Add(&variable);
+
+	// setting a variable to the value it already has isn't a change
+	CHECK(!Set(table, variables[1], "0"));
+	CHECK_EQUAL(4U, table.GetGeneration());
+	CHECK(ChangedSince(table, 4).empty());
+
+	CHECK(Set(table, variables[2], "5"));
+	CHECK_EQUAL(5U, table.GetGeneration());
+	CHECK(Set(table, variables[0], "7"));
+	CHECK_EQUAL(6U, table.GetGeneration());
+	CHECK(ChangedSince(table, 4) == std::vector<std::string>({ "Module.Variable0", "Module.Variable2" }));
+	CHECK(ChangedSince(table, 5) == std::vector<std::string>({ "Module.Variable0" }));
+
+	// changing one again moves it to the newest generation, it's only listed once
+	CHECK(Set(table, variables[2], "6"));
+	CHECK(ChangedSince(table, 4) == std::vector<std::string>({ "Module.Variable0", "Module.Variable2" }));
+	CHECK(ChangedSince(table, 6) == std::vector<std::string>({ "Module.Variable2" }));
+
+	// variables that aren't replicated don't count
+	Command other;
+	other.ValueString = "1";
+	CHECK(!table.Contains(&other));
+	CHECK(!Set(table, other, "2"));
+	CHECK_EQUAL(7U, table.GetGeneration());
+}
+
+TEST(ReplicationTable, NewerGenerationGetsEverything)
+{
+	// a generation newer than ours must be from before a restart, so it's no use to compare against
+	auto variables = MakeVariables(3);
+	ReplicationTable table;
+	for (auto& variable : variables)
+		table.Add(&variable);
+	Set(table, variables[0], "1");
+
+	std::vector<ReplicatedVariable> changed;
+	CHECK(!table.GetChangedSince(5, changed));
+	CHECK_EQUAL(3U, changed.size());
+	CHECK(!table.GetChangedSince(0xFFFFFFFF, changed));
+	CHECK_EQUAL(3U, changed.size());
+
+	CHECK(table.GetChangedSince(4, changed));
+	CHECK(changed.empty());
+}
@@ -0,0 +1,423 @@
+#include "Test.hpp"
+#include "../../DewRecode/src/ServerConnect.hpp"
+#include "../../ServerPlugin/InfoRequest.hpp"
+#include <condition_variable>
+#include <cstring>
+#include <thread>
+
+namespace
+{
+	const std::string GameVersion = "1.106708 cert_ms23";
+	const std::string EldewritoVersion = "0.5.0.0";
+
+	std::string Base64(const std::string& str)
+	{
+		const char* chars = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+		std::string result;
+		for (size_t i = 0; i < str.length(); i += 3)
+		{
+			uint32_t block = (uint8_t)str[i] << 16;
+			if (i + 1 < str.length())
+				block |= (uint8_t)str[i + 1] << 8;
+			if (i + 2 < str.length())
+				block |= (uint8_t)str[i + 2];
+			result += chars[(block >> 18) & 63];
+			result += chars[(block >> 12) & 63];
+			result += i + 1 < str.length() ? chars[(block >> 6) & 63] : '=';
+			result += i + 2 < str.length() ? chars[block & 63] : '=';
+		}
+		return result;
+	}
+
+	// a stand-in for the servers a client connects to: looking them up, and their info servers, which answer through the real InfoRequest code
+	// with latency, hangs, failures and made up responses per host, the clock is controlled by the test
+	class StandInServers : public ConnectEnvironment
+	{
+	public:
+		struct Host
+		{
+			uint32_t Address = 0; // 0 fails the lookup
+			int LatencyMs = 0;
+			bool Hang = false; // don't answer until Release is called
+			bool Refuse = false; // fail the request
+			std::string Password;
+			std::string RawResponse; // answer with this instead
+			Server::InfoState State;
+		};
+
+		std::atomic<uint32_t> Now;
+		std::atomic<int> Lookups;
+		std::atomic<int> Queries;
+		std::atomic<int> Answered;
+
+		StandInServers()
+		{
+			Now = 1000;
+			Lookups = 0;
+			Queries = 0;
+			Answered = 0;
+		}
+
+		void SetHost(const std::string& name, const Host& host)
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			hosts[name] = host;
+		}
+
+		void Release()
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			released = true;
+			releasedChanged.notify_all();
+		}
+
+		uint32_t GetTime()
+		{
+			return Now;
+		}
+
+		bool ResolveHost(const std::string& name, uint32_t& address, std::string& error)
+		{
+			Lookups++;
+			std::lock_guard<std::mutex> guard(lock);
+			address = hosts[name].Address;
+			if (!address)
+				error = "Unable to lookup " + name + ": Host not found.";
+			return address != 0;
+		}
+
+		bool QueryInfo(const std::string& name, int port, const std::string& password, std::string& responseHeader, std::string& body, std::string& error)
+		{
+			Queries++;
+			Host host;
+			{
+				std::unique_lock<std::mutex> guard(lock);
+				host = hosts[name];
+				if (host.Hang)
+					releasedChanged.wait(guard, [this]() { return released; });
+			}
+			std::this_thread::sleep_for(std::chrono::milliseconds(host.LatencyMs));
+
+			if (host.Refuse || port != 11784)
+			{
+				error = "Unable to connect to server. (error: 4/12029)";
+				return false;
+			}
+
+			std::string response = host.RawResponse;
+			if (response.empty())
+			{
+				// what WinHttp would send for Server.Connect
+				auto text = "GET / HTTP/1.1\r\nUser-Agent: ElDewrito/" + EldewritoVersion + "\r\nHost: " + name + ":" + std::to_string(port) + "\r\n";
+				if (!password.empty())
+					text += "Authorization: Basic " + Base64("dorito:" + password) + "\r\n";
+				text += "\r\n";
+
+				auto authHeader = host.Password.empty() ? "" : "Authorization: Basic " + Base64("dorito:" + host.Password) + "\r\n";
+				std::shared_ptr<const Server::InfoSnapshot> snapshot = Server::BuildInfoSnapshot(host.State, "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\n", authHeader, 0);
+				Server::InfoRequest request;
+				if (request.Append(text.c_str(), text.length()) != Server::InfoRequestStatus::Complete)
+					return false;
+				response = *request.Respond(snapshot);
+			}
+
+			auto headerEnd = response.find("\r\n\r\n");
+			responseHeader = response.substr(0, headerEnd);
+			body = headerEnd == std::string::npos ? "" : response.substr(headerEnd + 4);
+			Answered++;
+			return true;
+		}
+
+	private:
+		std::mutex lock;
+		std::condition_variable releasedChanged;
+		bool released = false;
+		std::map<std::string, Host> hosts;
+	};
+
+	StandInServers::Host MakeHost(uint32_t address, const std::string& password = "")
+	{
+		StandInServers::Host host;
+		host.Address = address;
+		host.Password = password;
+		host.State.Name = "Test Server";
+		host.State.Port = 11774;
+		host.State.HostPlayer = "host";
+		host.State.Map = "Guardian";
+		host.State.Status = "InLobby";
+		host.State.MaxPlayers = 16;
+		host.State.Xnkid = "00112233445566778899AABBCCDDEEFF";
+		host.State.Xnaddr = "ffeeddccbbaa99887766554433221100";
+		host.State.GameVersion = GameVersion;
+		host.State.EldewritoVersion = EldewritoVersion;
+		return host;
+	}
+
+	// starts an attempt and runs it on this thread
+	std::shared_ptr<const ConnectAttempt> Connect(ServerConnector& connector, const std::string& address, const std::string& password = "")
+	{
+		std::string error;
+		auto attempt = connector.Start(address, password, error);
+		if (!attempt)
+			Test::Fail(__FILE__, __LINE__, "couldn't start: " + error);
+		connector.Run(attempt);
+		return connector.Poll();
+	}
+
+	// waits (for real) until the condition is true, or fails after a few seconds
+	template<class Condition>
+	void WaitFor(Condition condition)
+	{
+		for (int i = 0; i < 5000 && !condition(); i++)
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		if (!condition())
+			Test::Fail(__FILE__, __LINE__, "timed out waiting");
+	}
+}
+
+TEST(ServerConnect, Address)
+{
+	std::string host;
+	int port;
+	CHECK(ParseConnectAddress("example.com", host, port));
+	CHECK_EQUAL("example.com", host);
+	CHECK_EQUAL(11784, port);
+	CHECK(ParseConnectAddress("1.2.3.4:1234", host, port));
+	CHECK_EQUAL("1.2.3.4", host);
+	CHECK_EQUAL(1234, port);
+	CHECK(ParseConnectAddress("example.com:", host, port)); // trailing colon is ignored, like it always was
+	CHECK_EQUAL(11784, port);
+	CHECK(!ParseConnectAddress("example.com:0", host, port));
+	CHECK(!ParseConnectAddress("example.com:65536", host, port));
+	CHECK(!ParseConnectAddress("example.com:abc", host, port));
+	CHECK(!ParseConnectAddress(":1234", host, port));
+}
+
+TEST(ServerConnect, Connects)
+{
+	StandInServers servers;
+	servers.SetHost("server", MakeHost(0x7F000001));
+	ServerConnector connector(servers);
+
+	auto attempt = Connect(connector, "server");
+	CHECK(attempt != nullptr);
+	CHECK(attempt->Succeeded);
+	CHECK_EQUAL("server", attempt->Address);
+	CHECK_EQUAL(0x7F000001U, attempt->IpAddress);
+	CHECK_EQUAL(11774, attempt->Info.GamePort);
+	CHECK_EQUAL(GameVersion, attempt->Info.GameVersion);
+	CHECK_EQUAL(EldewritoVersion, attempt->Info.EldewritoVersion);
+	uint8_t expected[0x20] =
+	{
+		0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x88, 0x99, 0xAA, 0xBB, 0xCC, 0xDD, 0xEE, 0xFF,
+		0xFF, 0xEE, 0xDD, 0xCC, 0xBB, 0xAA, 0x99, 0x88, 0x77, 0x66, 0x55, 0x44, 0x33, 0x22, 0x11, 0x00,
+	};
+	CHECK(memcmp(expected, attempt->Info.XnetInfo, 0x20) == 0);
+
+	std::string error;
+	CHECK(CheckServerVersion(attempt->Info, GameVersion, EldewritoVersion, error));
+	CHECK(!CheckServerVersion(attempt->Info, "1.106708 cert_ms24", EldewritoVersion, error));
+	CHECK_EQUAL("Server is running a different game version.", error);
+	CHECK(!CheckServerVersion(attempt->Info, GameVersion, "0.5.0.1", error));
+	CHECK_EQUAL("Server is running a different ElDewrito version.", error);
+
+	// only handed out once
+	CHECK(connector.Poll() == nullptr);
+}
+
+TEST(ServerConnect, Password)
+{
+	StandInServers servers;
+	servers.SetHost("server", MakeHost(0x7F000001, "hunter2"));
+	ServerConnector connector(servers);
+
+	auto attempt = Connect(connector, "server", "hunter3");
+	CHECK(!attempt->Succeeded);
+	CHECK_EQUAL("Incorrect password specified.", attempt->Error);
+
+	attempt = Connect(connector, "server");
+	CHECK(!attempt->Succeeded);
+	CHECK_EQUAL("Incorrect password specified.", attempt->Error);
+
+	attempt = Connect(connector, "server", "hunter2");
+	CHECK(attempt->Succeeded);
+}
+
+TEST(ServerConnect, Failing)
+{
+	StandInServers servers;
+	servers.SetHost("down", MakeHost(0x7F000002));
+	auto refused = MakeHost(0x7F000003);
+	refused.Refuse = true;
+	servers.SetHost("refused", refused);
+	ServerConnector connector(servers);
+
+	auto attempt = Connect(connector, "nowhere");
+	CHECK(!attempt->Succeeded);
+	CHECK_EQUAL("Unable to lookup nowhere: Host not found.", attempt->Error);
+	CHECK_EQUAL(0, servers.Queries.load());
+
+	attempt = Connect(connector, "refused");
+	CHECK(!attempt->Succeeded);
+	CHECK(attempt->Error.find("Unable to connect to server.") == 0);
+
+	attempt = Connect(connector, "down:11785"); // nothing listening on that port
+	CHECK(!attempt->Succeeded);
+	CHECK(attempt->Error.find("Unable to connect to server.") == 0);
+
+	std::string error;
+	CHECK(connector.Start("down:99999", "", error) == nullptr);
+	CHECK_EQUAL("Invalid port.", error);
+}
+
+TEST(ServerConnect, Malformed)
+{
+	struct
+	{
+		const char* Response;
+		const char* Error;
+	} cases[] =
+	{
+		{ "HTTP/1.1 401 Unauthorized\r\n\r\n", "Invalid server query header response." },
+		{ "HTTP/1.1\r\n\r\n", "Invalid server query response." },
+		{ "HTTP/1.1 200 OK\r\n\r\n{\"gameVersion\": ", "Invalid server query JSON response." },
+		{ "HTTP/1.1 200 OK\r\n\r\n[1, 2, 3]", "Invalid server query JSON response." },
+		{ "HTTP/1.1 200 OK\r\n\r\n", "Invalid server query JSON response." },
+		{ "HTTP/1.1 200 OK\r\n\r\n{\"gameVersion\": \"1\", \"eldewritoVersion\": \"2\"}", "Server query JSON response is missing data." },
+		{ "HTTP/1.1 200 OK\r\n\r\n{\"gameVersion\": 1, \"eldewritoVersion\": \"2\", \"port\": 11774}", "Server query JSON response is missing data." },
+		{ "HTTP/1.1 200 OK\r\n\r\n{\"gameVersion\": \"1\", \"eldewritoVersion\": \"2\", \"port\": \"11774\"}", "Server query JSON response is missing data." },
+		{ "HTTP/1.1 200 OK\r\n\r\n{\"gameVersion\": \"1\", \"eldewritoVersion\": \"2\", \"port\": 11774}", "Incorrect password specified." },
+		{ "HTTP/1.1 200 OK\r\n\r\n{\"gameVersion\": \"1\", \"eldewritoVersion\": \"2\", \"port\": 70000, \"xnkid\": \"00112233445566778899AABBCCDDEEFF\", \"xnaddr\": \"00112233445566778899AABBCCDDEEFF\"}", "Server query port is invalid." },
+		{ "HTTP/1.1 200 OK\r\n\r\n{\"gameVersion\": \"1\", \"eldewritoVersion\": \"2\", \"port\": 0, \"xnkid\": \"00112233445566778899AABBCCDDEEFF\", \"xnaddr\": \"00112233445566778899AABBCCDDEEFF\"}", "Server query port is invalid." },
+		{ "HTTP/1.1 200 OK\r\n\r\n{\"gameVersion\": \"1\", \"eldewritoVersion\": \"2\", \"port\": 11774, \"xnkid\": \"00112233445566778899AABBCCDDEE\", \"xnaddr\": \"00112233445566778899AABBCCDDEEFF\"}", "Server query XNet info is invalid." },
+		{ "HTTP/1.1 200 OK\r\n\r\n{\"gameVersion\": \"1\", \"eldewritoVersion\": \"2\", \"port\": 11774, \"xnkid\": \"00112233445566778899AABBCCDDEEFF\", \"xnaddr\": \"0011223344556677889zAABBCCDDEEFF\"}", "Server query XNet info is invalid." },
+	};
+
+	StandInServers servers;
+	ServerConnector connector(servers);
+	for (auto& test : cases)
+	{
+		auto host = MakeHost(0x7F000001);
+		host.RawResponse = test.Response;
+		servers.SetHost("server", host);
+
+		auto attempt = Connect(connector, "server");
+		if (attempt->Succeeded || attempt->Error != test.Error)
+			Test::Fail(__FILE__, __LINE__, std::string(test.Response) + " gave \"" + attempt->Error + "\", expected \"" + test.Error + "\"");
+	}
+}
+
+TEST(ServerConnect, DnsCache)
+{
+	StandInServers servers;
+	servers.SetHost("server", MakeHost(0x7F000001));
+	servers.Now = 0xFFFFFFFF - DnsCache::TtlMs / 2; // wraps while it's cached
+	ServerConnector connector(servers);
+
+	Connect(connector, "server");
+	Connect(connector, "server");
+	CHECK_EQUAL(1, servers.Lookups.load());
+
+	// the server moved, but we keep using the old address until the entry expires
+	servers.SetHost("server", MakeHost(0x7F000009));
+	servers.Now += DnsCache::TtlMs - 1;
+	CHECK_EQUAL(0x7F000001U, Connect(connector, "server")->IpAddress);
+	CHECK_EQUAL(1, servers.Lookups.load());
+	servers.Now += 1;
+	CHECK_EQUAL(0x7F000009U, Connect(connector, "server")->IpAddress);
+	CHECK_EQUAL(2, servers.Lookups.load());
+
+	// failed lookups aren't cached
+	Connect(connector, "nowhere");
+	Connect(connector, "nowhere");
+	CHECK_EQUAL(4, servers.Lookups.load());
+}
+
+TEST(ServerConnect, Slow)
+{
+	// the game thread keeps polling while the query's in flight, and gives up on it after TimeoutMs
+	StandInServers servers;
+	auto host = MakeHost(0x7F000001);
+	host.Hang = true;
+	servers.SetHost("slow", host);
+	ServerConnector connector(servers);
+
+	std::string error;
+	auto attempt = connector.Start("slow", "", error);
+	std::thread worker([&connector, attempt]() { connector.Run(attempt); });
+	WaitFor([&]() { return servers.Queries == 1; });
+
+	CHECK(connector.Poll() == nullptr);
+	servers.Now += ServerConnector::TimeoutMs - 1;
+	CHECK(connector.Poll() == nullptr);
+	servers.Now += 1;
+	auto timedOut = connector.Poll();
+	CHECK(timedOut != nullptr);
+	CHECK(!timedOut->Succeeded);
+	CHECK_EQUAL("Timed out querying slow.", timedOut->Error);
+	CHECK(connector.Poll() == nullptr);
+
+	// it answers eventually, but nobody's waiting for it any more
+	servers.Release();
+	worker.join();
+	CHECK_EQUAL(1, servers.Answered.load());
+	CHECK(connector.Poll() == nullptr);
+}
+
+TEST(ServerConnect, Superseded)
+{
+	// connecting somewhere else while a query's still running throws the first one's result away
+	StandInServers servers;
+	auto slow = MakeHost(0x7F000001);
+	slow.LatencyMs = 50;
+	servers.SetHost("slow", slow);
+	servers.SetHost("fast", MakeHost(0x7F000002));
+	ServerConnector connector(servers);
+
+	std::string error;
+	auto first = connector.Start("slow", "", error);
+	std::thread worker([&connector, first]() { connector.Run(first); });
+	WaitFor([&]() { return servers.Queries == 1; });
+
+	auto second = Connect(connector, "fast");
+	CHECK(second->Succeeded);
+	CHECK_EQUAL("fast", second->Address);
+
+	worker.join();
+	CHECK_EQUAL(2, servers.Answered.load());
+	CHECK(connector.Poll() == nullptr);
+
+	// the new attempt's timeout starts from scratch
+	servers.Now += ServerConnector::TimeoutMs;
+	CHECK(connector.Poll() == nullptr);
+}
+
+TEST(ServerConnect, Cancel)
+{
+	StandInServers servers;
+	auto host = MakeHost(0x7F000001);
+	host.Hang = true;
+	servers.SetHost("slow", host);
+	ServerConnector connector(servers);
+
+	std::string error;
+	auto attempt = connector.Start("slow", "", error);
+	std::thread worker([&connector, attempt]() { connector.Run(attempt); });
+	WaitFor([&]() { return servers.Queries == 1; });
+
+	connector.Cancel();
+	servers.Now += ServerConnector::TimeoutMs;
+	CHECK(connector.Poll() == nullptr); // cancelled attempts don't time out either
+
+	servers.Release();
+	worker.join();
+	CHECK(connector.Poll() == nullptr);
+
+	// cancelled while it was being looked up, it doesn't get queried
+	servers.SetHost("server", MakeHost(0x7F000002));
+	attempt = connector.Start("server", "", error);
+	connector.Cancel();
+	connector.Run(attempt);
+	CHECK_EQUAL(1, servers.Queries.load());
+	CHECK(connector.Poll() == nullptr);
+}
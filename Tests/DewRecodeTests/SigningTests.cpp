@@ -0,0 +1,316 @@
+#include "Test.hpp"
+#include "../../DewRecode/src/SigningService.hpp"
+#include <atomic>
+#include <condition_variable>
+#include <thread>
+
+namespace
+{
+	// the same 1024-bit test keys as KeyStoreTests, stripped like they are in the cfg (FormatPem puts the PEM header/footer back)
+	const std::string PrivateKeyA =
+		"MIICXAIBAAKBgQCabXfy4mJyooyJgeOSggw7eIbMP8xVYMXesyDOQuRLB2eQlCq/GaB/hl9EPtOgcxY59SstIYzSXFnA8p9KFCs5"
+		"m4kQYTtJDXGhFuEXy5yOsFtdbp1a/MCqeKmJv9TGmNFLv/zzxwpEFZ5LfXG1qtXKKVzmC2wjptOb6v+aZZc+owIDAQABAoGAS/fu"
+		"Oh4EMECmwj6TpU80lU0FgxUfgCDLNnMIgG+HvyE1YXqCTOBehF2mH/yIPzZeiMSDKQCINjQYM0Mn+VlSqZCYZvzAsYJi5I9F99Bg"
+		"CTCzUcmdv5NKhsBHMPj6FsAb+v4WnFcUP7tLKhgeQDKSPnvWwmdbkG3idc+akx5G5oECQQDMJEOPu5N08uAVuGfp72q3u4g8nlWe"
+		"9hFQlVa1xpMUyPiPNcfl42Vwp4PRds58NkJ/Gk8U2ikdIN6u0vHC2d9FAkEAwagzr4QreJJDl3/I/IxJUTQ0QDqo/q4PWgZXX5jw"
+		"WpftWIfyN+uclWCxyyrcYGgAgIwJcpWZ6DLF/CO+auLwxwJABy0/Ms5lYLcpKZpSDOdd2Re+smLen7gG485cPge9I/3svxwk6vAT"
+		"oOJCwBptJ/DAZbeHEDSbPWrqaTsBRNhkAQJBAKrA3uHxzkq/3O1mdReJstPxDelcT8pQO6ULVlsqhTO8JkEbjY2VKDnmSp5zqmEv"
+		"EtJFp8bq9gvxSPUrpyij9d0CQD7QBnTXlRbx0eWK6XnCn8IuSl3T88i0hg7f/DICbtFYy9TpAYdOAjgzarSk3Dgm9fd4XcoD973x"
+		"haDSA/RgkzY=";
+	const std::string PublicKeyA =
+		"MIGfMA0GCSqGSIb3DQEBAQUAA4GNADCBiQKBgQCabXfy4mJyooyJgeOSggw7eIbMP8xVYMXesyDOQuRLB2eQlCq/GaB/hl9EPtOg"
+		"cxY59SstIYzSXFnA8p9KFCs5m4kQYTtJDXGhFuEXy5yOsFtdbp1a/MCqeKmJv9TGmNFLv/zzxwpEFZ5LfXG1qtXKKVzmC2wjptOb"
+		"6v+aZZc+owIDAQAB";
+	const std::string PrivateKeyB =
+		"MIICXQIBAAKBgQDb+10j1P+pQ7qrSQUVhd5KNf75F51bYkisLwQgfunnRht9ktaNKeFqdzvkI0uIsNcCBdBnPmCCPaGKTO/usWng"
+		"x2Cx6HJ20PXZOlaJBSe2esTOKGJ1CQCKEY6bUo3AYSt/9n1iJjSOL8GRLUuHrCVaAy1Xf4uzayXDBhodgZ0GiwIDAQABAoGAM4Ye"
+		"fKQI9aZNdIz3yeC+/fbDr6geTScqClpAxzOyqV68VZ8s7YdfqsYemwLBUFTLJ0ghVe1AQYEZ8wCuOeQH/hTAqP1j124rTE5z6+Mw"
+		"QI0dHQjkcQRlGBk/h8flc8vUkNLkw7uil1ZNAUIUQwY/jh37iflv93Bn+rur/dpI1MECQQDzkTts/Fp/yabWpPrkd1U/JPV8uZt0"
+		"3TgGHIIkGz4pRMxNAfI3WAV0SSaZOj0o02JxfEUn5pR5Ra3HnobkpNKbAkEA5zXvD1gCu8vtHXo2pvldcOXjtgIklIlP3vTMtTbo"
+		"h79D5fY069qmZ0bKluklg4K53rbXwS5t0sPHZjJQskWi0QJBAOMnwpVdMQXWykuK6BalGJLgZDajX9F482P3uIP2CF4ytJrpQr3M"
+		"0KFoC6CCCUIHCtuuO00AJd6IVo9CUKny8hsCQCILbQIDYZOpeWanwjhf64ReNWNteVltxpb70NC2HxMt9J9921kHPw1h/R6vgdiV"
+		"fSzwG2DUp1MrhMbljcBSRKECQQCsPIlFgear1SOeuiILzBNv1vN4gwZWaGq35Pj027WPkb58OEHs9TtMjk8+CDGLB+jaNMiwslnK"
+		"TvhU3zzu0p7C";
+	const std::string PublicKeyB =
+		"MIGfMA0GCSqGSIb3DQEBAQUAA4GNADCBiQKBgQDb+10j1P+pQ7qrSQUVhd5KNf75F51bYkisLwQgfunnRht9ktaNKeFqdzvkI0uI"
+		"sNcCBdBnPmCCPaGKTO/usWngx2Cx6HJ20PXZOlaJBSe2esTOKGJ1CQCKEY6bUo3AYSt/9n1iJjSOL8GRLUuHrCVaAy1Xf4uzayXD"
+		"BhodgZ0GiwIDAQAB";
+
+	// made with the openssl command line tool (openssl dgst -sha256 -sign, then Base64), PKCS#1 v1.5 signatures don't change between runs
+	const std::string Stats = "{\"players\":[{\"name\":\"player0\",\"kills\":7,\"deaths\":3}],\"map\":\"guardian\"}";
+	const std::string StatsSignatureA =
+		"gACBTLzodt2/hCc8NmxRE59xh/ZvJOAOnxM/yzuX11Iw7NXyX0aHJHrGCxyof6sz4NLy8N65pRnhYym9ZewxBmQCR+qCRqoAqo1QjYkF1TyoRtK69T2vHfHwVWflDhru"
+		"sYVXI+ZKPTvS10vCvLPOkkEq3eOAlE5HX2DCBLuDpWM=";
+	const std::string EmptySignatureA =
+		"jbc7zHOzPjTzza31UKYL6YOfri45t3R5qSplJO+DXOJmF5GQY0RrXgSMzUaDNGcMwIP85Aoq3DIaGaxgbe/ZrcP32QAyehQxyweah2R8bT/UZctHfSYzHMKwfJGnVuUd"
+		"WnMwfjQGxPQW+pSGIfyvgx/UJ16RYkCaOJYFx4LUEaY=";
+	const std::string StatsSignatureB =
+		"UikrHnJpTquekpzLJJHMKAyl0cXeUni8rvN2tUZ2406ChK1bdo9G3NrLPolulV0DikjQVEz5xdJmBnKbtnzrJX6A6492ZS5uu3vlZS/AGaYBJciOztkW41LG0rpAiYL9"
+		"RZnMVpUyeOhd+0x6n/Px4Vkh81hYiOWAAQmv80a8dcI=";
+
+	// what RSAReformatKey does to a key from the cfg
+	std::string FormatPem(const std::string& key, bool isPrivate)
+	{
+		std::string type = isPrivate ? "RSA PRIVATE KEY" : "PUBLIC KEY";
+		std::string pem = "-----BEGIN " + type + "-----\n";
+		for (size_t i = 0; i < key.length(); i += 64)
+			pem += key.substr(i, 64) + "\n";
+		return pem + "-----END " + type + "-----\n";
+	}
+
+	// lets a test hold up the signing thread inside a callback
+	struct Gate
+	{
+		std::mutex Lock;
+		std::condition_variable Changed;
+		bool Entered = false;
+		bool Released = false;
+
+		void Enter()
+		{
+			std::unique_lock<std::mutex> guard(Lock);
+			Entered = true;
+			Changed.notify_all();
+			Changed.wait(guard, [this]() { return Released; });
+		}
+
+		void WaitForEnter()
+		{
+			std::unique_lock<std::mutex> guard(Lock);
+			Changed.wait(guard, [this]() { return Entered; });
+		}
+
+		void Release()
+		{
+			std::lock_guard<std::mutex> guard(Lock);
+			Released = true;
+			Changed.notify_all();
+		}
+	};
+}
+
+TEST(Signing, KnownAnswer)
+{
+	SigningService signing;
+	std::string signature;
+	CHECK(signing.Sign(FormatPem(PrivateKeyA, true), Stats.c_str(), Stats.length(), signature));
+	CHECK_EQUAL(StatsSignatureA, signature);
+	CHECK(signing.Sign(FormatPem(PrivateKeyA, true), "", 0, signature));
+	CHECK_EQUAL(EmptySignatureA, signature);
+	CHECK(signing.Sign(FormatPem(PrivateKeyB, true), Stats.c_str(), Stats.length(), signature));
+	CHECK_EQUAL(StatsSignatureB, signature);
+
+	// again now the keys are cached
+	CHECK(signing.Sign(FormatPem(PrivateKeyA, true), Stats.c_str(), Stats.length(), signature));
+	CHECK_EQUAL(StatsSignatureA, signature);
+}
+
+TEST(Signing, VerifyKnownAnswer)
+{
+	SigningService signing;
+	auto publicA = FormatPem(PublicKeyA, false);
+	CHECK(signing.Verify(publicA, StatsSignatureA, Stats.c_str(), Stats.length()));
+	CHECK(signing.Verify(publicA, EmptySignatureA, "", 0));
+	CHECK(signing.Verify(FormatPem(PublicKeyB, false), StatsSignatureB, Stats.c_str(), Stats.length()));
+
+	// wrong key, wrong data, the signature for something else
+	CHECK(!signing.Verify(FormatPem(PublicKeyB, false), StatsSignatureA, Stats.c_str(), Stats.length()));
+	CHECK(!signing.Verify(publicA, StatsSignatureA, Stats.c_str(), Stats.length() - 1));
+	CHECK(!signing.Verify(publicA, EmptySignatureA, Stats.c_str(), Stats.length()));
+
+	// tampered with
+	auto tampered = StatsSignatureA;
+	tampered[10] = tampered[10] == 'A' ? 'B' : 'A';
+	CHECK(!signing.Verify(publicA, tampered, Stats.c_str(), Stats.length()));
+	CHECK(!signing.Verify(publicA, StatsSignatureA.substr(0, StatsSignatureA.length() - 4), Stats.c_str(), Stats.length()));
+
+	// not Base64 or not a signature at all
+	CHECK(!signing.Verify(publicA, "", Stats.c_str(), Stats.length()));
+	CHECK(!signing.Verify(publicA, "not a signature!", Stats.c_str(), Stats.length()));
+	CHECK(!signing.Verify(publicA, "AAAA", Stats.c_str(), Stats.length()));
+}
+
+TEST(Signing, BadKeys)
+{
+	SigningService signing;
+	std::string signature;
+	CHECK(!signing.Sign("", Stats.c_str(), Stats.length(), signature));
+	CHECK(!signing.Sign(PrivateKeyA, Stats.c_str(), Stats.length(), signature)); // missing the header/footer
+	CHECK(!signing.Sign(FormatPem(PublicKeyA, false), Stats.c_str(), Stats.length(), signature));
+	CHECK(!signing.Verify(FormatPem(PrivateKeyA, false), StatsSignatureA, Stats.c_str(), Stats.length()));
+	CHECK(!signing.Verify("", StatsSignatureA, Stats.c_str(), Stats.length()));
+
+	// a key that failed to parse doesn't stop the good one working
+	CHECK(signing.Sign(FormatPem(PrivateKeyA, true), Stats.c_str(), Stats.length(), signature));
+	CHECK_EQUAL(StatsSignatureA, signature);
+}
+
+TEST(Signing, Batch)
+{
+	SigningService signing;
+	std::vector<std::string> data;
+	data.push_back(Stats);
+	data.push_back("");
+	std::vector<std::string> signatures;
+	CHECK(signing.SignBatch(FormatPem(PrivateKeyA, true), data, signatures));
+	CHECK_EQUAL(2U, signatures.size());
+	CHECK_EQUAL(StatsSignatureA, signatures[0]);
+	CHECK_EQUAL(EmptySignatureA, signatures[1]);
+
+	std::vector<bool> results;
+	CHECK_EQUAL(2U, signing.VerifyBatch(FormatPem(PublicKeyA, false), data, signatures, results));
+	CHECK(results[0] && results[1]);
+
+	signatures[1] = StatsSignatureB;
+	CHECK_EQUAL(1U, signing.VerifyBatch(FormatPem(PublicKeyA, false), data, signatures, results));
+	CHECK(results[0] && !results[1]);
+
+	// mismatched lengths and bad keys fail the whole batch
+	signatures.pop_back();
+	CHECK_EQUAL(0U, signing.VerifyBatch(FormatPem(PublicKeyA, false), data, signatures, results));
+	CHECK_EQUAL(2U, results.size());
+	CHECK(!results[0] && !results[1]);
+	CHECK(!signing.SignBatch("", data, signatures));
+	CHECK_EQUAL(2U, signatures.size());
+}
+
+TEST(Signing, CacheEviction)
+{
+	// the cache goes by the PEM text, so the same key with extra newlines on the end counts as a different key
+	SigningService signing;
+	std::vector<std::string> keys;
+	for (size_t i = 0; i < SigningService::MaxCachedKeys * 2; i++)
+		keys.push_back(FormatPem(i % 2 ? PrivateKeyB : PrivateKeyA, true) + std::string(i, '\n'));
+
+	for (int round = 0; round < 2; round++)
+	{
+		for (size_t i = 0; i < keys.size(); i++)
+		{
+			std::string signature;
+			CHECK(signing.Sign(keys[i], Stats.c_str(), Stats.length(), signature));
+			CHECK_EQUAL(i % 2 ? StatsSignatureB : StatsSignatureA, signature);
+		}
+	}
+}
+
+TEST(Signing, SharedBetweenThreads)
+{
+	// threads signing and verifying with more keys than the cache holds, so keys get evicted while other threads are using them
+	SigningService signing;
+	std::atomic<int> failures;
+	failures = 0;
+	std::vector<std::thread> threads;
+	for (int t = 0; t < 4; t++)
+	{
+		threads.push_back(std::thread([&signing, &failures, t]()
+		{
+			for (int i = 0; i < 20; i++)
+			{
+				auto useB = (i + t) % 2 != 0;
+				auto extra = std::string((i * 3 + t) % (SigningService::MaxCachedKeys + 3), '\n');
+				std::string signature;
+				if (!signing.Sign(FormatPem(useB ? PrivateKeyB : PrivateKeyA, true) + extra, Stats.c_str(), Stats.length(), signature) ||
+					signature != (useB ? StatsSignatureB : StatsSignatureA) ||
+					!signing.Verify(FormatPem(useB ? PublicKeyB : PublicKeyA, false) + extra, signature, Stats.c_str(), Stats.length()))
+				{
+					failures++;
+				}
+			}
+		}));
+	}
+	for (auto& thread : threads)
+		thread.join();
+	CHECK_EQUAL(0, failures.load());
+}
+
+TEST(Signing, QueueSign)
+{
+	SigningService signing;
+	std::mutex lock;
+	std::condition_variable done;
+	std::vector<std::string> signatures;
+	int failures = 0;
+
+	auto callback = [&](bool succeeded, const std::string& signature)
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		if (succeeded)
+			signatures.push_back(signature);
+		else
+			failures++;
+		done.notify_all();
+	};
+	CHECK(signing.QueueSign(FormatPem(PrivateKeyA, true), Stats, callback));
+	CHECK(signing.QueueSign(FormatPem(PrivateKeyB, true), Stats, callback));
+	CHECK(signing.QueueSign("not a key", Stats, callback));
+
+	{
+		std::unique_lock<std::mutex> guard(lock);
+		done.wait(guard, [&]() { return signatures.size() + failures == 3; });
+	}
+	signing.Shutdown();
+
+	// one thread, so they come back in order
+	CHECK_EQUAL(2U, signatures.size());
+	CHECK_EQUAL(StatsSignatureA, signatures[0]);
+	CHECK_EQUAL(StatsSignatureB, signatures[1]);
+	CHECK_EQUAL(1, failures);
+}
+
+TEST(Signing, QueueIsBounded)
+{
+	SigningService signing;
+	Gate gate;
+	std::atomic<int> callbacks;
+	callbacks = 0;
+
+	// hold up the signing thread in the first callback, then fill the queue behind it
+	CHECK(signing.QueueSign(FormatPem(PrivateKeyA, true), Stats, [&](bool succeeded, const std::string& signature)
+	{
+		gate.Enter();
+		callbacks++;
+	}));
+	gate.WaitForEnter();
+
+	auto count = [&](bool succeeded, const std::string& signature) { callbacks++; };
+	for (size_t i = 0; i < SigningService::MaxQueuedJobs; i++)
+		CHECK(signing.QueueSign(FormatPem(PrivateKeyA, true), Stats, count));
+	CHECK(!signing.QueueSign(FormatPem(PrivateKeyA, true), Stats, count));
+
+	gate.Release();
+	while (callbacks < static_cast<int>(SigningService::MaxQueuedJobs) + 1)
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+	// there's room again once the queue drains
+	CHECK(signing.QueueSign(FormatPem(PrivateKeyA, true), Stats, count));
+	signing.Shutdown();
+}
+
+TEST(Signing, ShutdownDropsQueue)
+{
+	SigningService signing;
+	Gate gate;
+	std::atomic<int> callbacks;
+	callbacks = 0;
+
+	CHECK(signing.QueueSign(FormatPem(PrivateKeyA, true), Stats, [&](bool succeeded, const std::string& signature)
+	{
+		gate.Enter();
+		callbacks++;
+	}));
+	gate.WaitForEnter();
+	auto count = [&](bool succeeded, const std::string& signature) { callbacks++; };
+	for (int i = 0; i < 5; i++)
+		CHECK(signing.QueueSign(FormatPem(PrivateKeyA, true), Stats, count));
+
+	// Shutdown waits for the callback that's running, but drops everything queued behind it
+	std::thread shutdown([&signing]() { signing.Shutdown(); });
+	while (signing.QueueSign(FormatPem(PrivateKeyA, true), Stats, count))
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	gate.Release();
+	shutdown.join();
+
+	CHECK_EQUAL(1, callbacks.load());
+	CHECK(!signing.QueueSign(FormatPem(PrivateKeyA, true), Stats, count));
+	signing.Shutdown(); // twice is fine
+}
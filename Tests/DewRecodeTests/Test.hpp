@@ -0,0 +1,62 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <sstream>
+
+// tiny test harness so the tests don't need anything from ThirdParty
+// tests register themselves with TEST(Group, Name) { ... } and get run by main.cpp, a failed CHECK reports itself and stops that test
+namespace Test
+{
+	typedef void(*TestFunc)();
+
+	struct TestInfo
+	{
+		const char* Group;
+		const char* Name;
+		TestFunc Func;
+	};
+
+	// thrown by a failed check, caught by the runner
+	struct Failure
+	{
+		std::string Message;
+	};
+
+	std::vector<TestInfo>& GetTests();
+
+	// files passed on the command line, for tests that need real game files (eg. map variants)
+	const std::vector<std::string>& GetDataFiles();
+
+	struct Registrar
+	{
+		Registrar(const char* group, const char* name, TestFunc func)
+		{
+			TestInfo info = { group, name, func };
+			GetTests().push_back(info);
+		}
+	};
+
+	void Fail(const char* file, int line, const std::string& message);
+
+	template<class T, class U>
+	void CheckEqual(const T& expected, const U& actual, const char* expectedText, const char* actualText, const char* file, int line)
+	{
+		if (expected == actual)
+			return;
+
+		std::ostringstream message;
+		message << actualText << " was " << actual << ", expected " << expectedText << " (" << expected << ")";
+		Fail(file, line, message.str());
+	}
+}
+
+#define TEST(group, name) \
+	static void Test_##group##_##name(); \
+	static Test::Registrar Registrar_##group##_##name(#group, #name, Test_##group##_##name); \
+	static void Test_##group##_##name()
+
+#define CHECK(expr) \
+	do { if (!(expr)) Test::Fail(__FILE__, __LINE__, "CHECK(" #expr ") failed"); } while (0)
+
+#define CHECK_EQUAL(expected, actual) \
+	Test::CheckEqual((expected), (actual), #expected, #actual, __FILE__, __LINE__)
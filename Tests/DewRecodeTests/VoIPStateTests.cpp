@@ -0,0 +1,250 @@
+#include "Test.hpp"
+#include "../../ChatPlugin/VoIPState.hpp"
+
+namespace
+{
+	// records the calls VoIPState makes instead of talking to TeamSpeak
+	class FakeBackend : public VoIPBackend
+	{
+	public:
+		std::vector<std::string> Calls;
+		unsigned int FailWith = 0; // error code for the next call to return, cleared once it's been returned
+		std::string FailCall; // name of the call to fail, empty for any
+
+		bool InputActive = false;
+		bool InputMuted = false;
+		int VolumeModifier = 0;
+		bool VoiceActivation = false;
+		float VoiceActivationLevel = 0;
+		bool AGC = false;
+		bool EchoCancellation = false;
+
+		unsigned int SetInputActive(bool active)
+		{
+			InputActive = active;
+			return record("SetInputActive");
+		}
+
+		unsigned int SetInputMuted(bool muted)
+		{
+			InputMuted = muted;
+			return record("SetInputMuted");
+		}
+
+		unsigned int FlushSelfUpdates()
+		{
+			return record("FlushSelfUpdates");
+		}
+
+		unsigned int SetVolumeModifier(int volume)
+		{
+			VolumeModifier = volume;
+			return record("SetVolumeModifier");
+		}
+
+		unsigned int SetVoiceActivation(bool enabled, float level)
+		{
+			VoiceActivation = enabled;
+			VoiceActivationLevel = level;
+			return record("SetVoiceActivation");
+		}
+
+		unsigned int SetAGC(bool enabled)
+		{
+			AGC = enabled;
+			return record("SetAGC");
+		}
+
+		unsigned int SetEchoCancellation(bool enabled)
+		{
+			EchoCancellation = enabled;
+			return record("SetEchoCancellation");
+		}
+
+	private:
+		unsigned int record(const std::string& call)
+		{
+			Calls.push_back(call);
+			if (!FailWith || (!FailCall.empty() && FailCall != call))
+				return 0;
+
+			auto result = FailWith;
+			FailWith = 0;
+			return result;
+		}
+	};
+
+	bool Called(const FakeBackend& backend, const std::string& call)
+	{
+		for (auto& made : backend.Calls)
+		{
+			if (made == call)
+				return true;
+		}
+		return false;
+	}
+
+	// applies and returns the calls that were made
+	std::vector<std::string> Apply(VoIPState& state, FakeBackend& backend)
+	{
+		backend.Calls.clear();
+		std::string error;
+		CHECK(state.Apply(error));
+		CHECK(error.empty());
+		return backend.Calls;
+	}
+}
+
+TEST(VoIPState, FirstApplySendsEverything)
+{
+	FakeBackend backend;
+	VoIPState state(&backend);
+
+	auto calls = Apply(state, backend);
+	CHECK_EQUAL(7U, calls.size());
+	CHECK_EQUAL(1U, state.GetFlushCount());
+
+	// push-to-talk is on by default, so the mic is off until the key is held
+	CHECK(!backend.InputActive);
+	CHECK(!backend.VoiceActivation);
+	CHECK_EQUAL(6, backend.VolumeModifier);
+	CHECK(backend.AGC);
+}
+
+TEST(VoIPState, NothingChanged)
+{
+	FakeBackend backend;
+	VoIPState state(&backend);
+	Apply(state, backend);
+
+	state.Set(state.Get());
+	CHECK(Apply(state, backend).empty());
+	CHECK_EQUAL(1U, state.GetFlushCount());
+}
+
+TEST(VoIPState, OnlyChangesAreApplied)
+{
+	FakeBackend backend;
+	VoIPState state(&backend);
+	Apply(state, backend);
+
+	auto settings = state.Get();
+	settings.VolumeModifier = 10;
+	state.Set(settings);
+	auto calls = Apply(state, backend);
+	CHECK_EQUAL(1U, calls.size());
+	CHECK_EQUAL(std::string("SetVolumeModifier"), calls[0]);
+	CHECK_EQUAL(10, backend.VolumeModifier);
+
+	// local settings don't need a flush, self updates do
+	CHECK_EQUAL(1U, state.GetFlushCount());
+	settings.Talking = true;
+	state.Set(settings);
+	calls = Apply(state, backend);
+	CHECK_EQUAL(2U, calls.size());
+	CHECK_EQUAL(std::string("SetInputActive"), calls[0]);
+	CHECK_EQUAL(std::string("FlushSelfUpdates"), calls[1]);
+	CHECK(backend.InputActive);
+	CHECK_EQUAL(2U, state.GetFlushCount());
+}
+
+TEST(VoIPState, TalkingOnlyMattersWithPushToTalk)
+{
+	FakeBackend backend;
+	VoIPState state(&backend);
+
+	auto settings = state.Get();
+	settings.PushToTalk = false;
+	settings.VoiceActivationLevel = -30.0f;
+	state.Set(settings);
+	Apply(state, backend);
+	CHECK(backend.InputActive);
+	CHECK(backend.VoiceActivation);
+	CHECK_EQUAL(-30.0f, backend.VoiceActivationLevel);
+
+	// with voice activation the input is always active, so the push-to-talk key doesn't change anything
+	settings.Talking = true;
+	state.Set(settings);
+	CHECK(Apply(state, backend).empty());
+}
+
+TEST(VoIPState, FailedCallsAreRetried)
+{
+	FakeBackend backend;
+	VoIPState state(&backend);
+	Apply(state, backend);
+
+	auto settings = state.Get();
+	settings.AGC = false;
+	settings.EchoCancellation = false;
+	state.Set(settings);
+
+	backend.FailWith = 1;
+	backend.FailCall = "SetAGC";
+	std::string error;
+	CHECK(!state.Apply(error));
+	CHECK(!error.empty());
+	CHECK(!backend.EchoCancellation);
+
+	// only the call that failed gets made again
+	auto calls = Apply(state, backend);
+	CHECK_EQUAL(1U, calls.size());
+	CHECK_EQUAL(std::string("SetAGC"), calls[0]);
+	CHECK(!backend.AGC);
+}
+
+TEST(VoIPState, FailedFlushIsRetried)
+{
+	FakeBackend backend;
+	VoIPState state(&backend);
+	Apply(state, backend);
+
+	auto settings = state.Get();
+	settings.Muted = true;
+	state.Set(settings);
+
+	backend.FailWith = 1;
+	backend.FailCall = "FlushSelfUpdates";
+	std::string error;
+	CHECK(!state.Apply(error));
+
+	// the server never got the mute, so it has to be set and flushed again even though it looks applied
+	auto calls = Apply(state, backend);
+	CHECK_EQUAL(2U, calls.size());
+	CHECK_EQUAL(std::string("SetInputMuted"), calls[0]);
+	CHECK_EQUAL(std::string("FlushSelfUpdates"), calls[1]);
+}
+
+TEST(VoIPState, ResetSendsEverythingAgain)
+{
+	FakeBackend backend;
+	VoIPState state(&backend);
+	Apply(state, backend);
+
+	state.Reset();
+	CHECK(state.Wait(1)); // Reset marks it as changed
+	CHECK_EQUAL(7U, Apply(state, backend).size());
+	CHECK(Called(backend, "FlushSelfUpdates"));
+}
+
+TEST(VoIPState, WaitAndInterrupt)
+{
+	FakeBackend backend;
+	VoIPState state(&backend);
+	Apply(state, backend);
+
+	// nothing changed, so this times out (still returns true since it wasn't interrupted)
+	CHECK(state.Wait(1));
+
+	auto settings = state.Get();
+	settings.Muted = true;
+	state.Set(settings);
+	CHECK(state.Wait(1));
+
+	state.Interrupt();
+	CHECK(!state.Wait(1));
+	CHECK(!state.Wait());
+
+	state.Reset();
+	CHECK(state.Wait(1));
+}
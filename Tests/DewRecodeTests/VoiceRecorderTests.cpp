@@ -0,0 +1,254 @@
+#include "Test.hpp"
+#include "../../ChatPlugin/VoiceRecorder.hpp"
+#include <cmath>
+#include <cstring>
+#include <deque>
+#include <vector>
+
+namespace
+{
+	// files kept in memory, writes can be held up to make the recorder fall behind
+	class MemoryFiles : public VoiceRecorderEnvironment
+	{
+	public:
+		struct File
+		{
+			std::string Path;
+			std::vector<uint8_t> Data;
+			bool Closed = false;
+		};
+
+		// the test only touches these while the recorder's stopped
+		std::deque<File> Files;
+		bool FailOpen = false;
+		bool FailWrites = false;
+
+		std::string GetTimeString()
+		{
+			return "20150801-120000";
+		}
+
+		void* OpenForWriting(const std::string& path)
+		{
+			if (FailOpen)
+				return nullptr;
+			std::lock_guard<std::mutex> guard(lock);
+			Files.push_back(File());
+			Files.back().Path = path;
+			return &Files.back();
+		}
+
+		bool Write(void* file, const void* data, size_t size)
+		{
+			std::unique_lock<std::mutex> guard(lock);
+			unstalled.wait(guard, [this]() { return !stalled; });
+			if (FailWrites)
+				return false;
+			auto& contents = static_cast<File*>(file)->Data;
+			contents.insert(contents.end(), static_cast<const uint8_t*>(data), static_cast<const uint8_t*>(data) + size);
+			return true;
+		}
+
+		bool WriteStart(void* file, const void* data, size_t size)
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			auto& contents = static_cast<File*>(file)->Data;
+			if (contents.size() < size)
+				return false;
+			memcpy(contents.data(), data, size);
+			return true;
+		}
+
+		bool Close(void* file)
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			static_cast<File*>(file)->Closed = true;
+			return true;
+		}
+
+		void Stall(bool stall)
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			stalled = stall;
+			unstalled.notify_all();
+		}
+
+	private:
+		std::mutex lock;
+		std::condition_variable unstalled;
+		bool stalled = false;
+	};
+
+	// 440Hz on the left and 660Hz on the right, worked out from the frame number so any part of it can be checked on its own
+	int16_t SineSample(uint64_t frame, int channel)
+	{
+		auto frequency = channel ? 660.0 : 440.0;
+		return static_cast<int16_t>(lround(sin(2 * 3.14159265358979 * frequency * frame / VoiceRecorder::SampleRate) * 12000));
+	}
+
+	std::vector<int16_t> Sine(uint64_t firstFrame, size_t frames)
+	{
+		std::vector<int16_t> samples;
+		for (size_t i = 0; i < frames; i++)
+			for (int channel = 0; channel < VoiceRecorder::Channels; channel++)
+				samples.push_back(SineSample(firstFrame + i, channel));
+		return samples;
+	}
+
+	uint32_t GetUInt32(const std::vector<uint8_t>& data, size_t offset)
+	{
+		return data[offset] | (data[offset + 1] << 8) | (data[offset + 2] << 16) | (static_cast<uint32_t>(data[offset + 3]) << 24);
+	}
+
+	uint16_t GetUInt16(const std::vector<uint8_t>& data, size_t offset)
+	{
+		return static_cast<uint16_t>(data[offset] | (data[offset + 1] << 8));
+	}
+
+	/// <summary>
+	/// Checks a file is a closed 48kHz 16-bit stereo WAV with the right sizes in its header, and gets the samples out of it.
+	/// </summary>
+	bool ReadWave(const MemoryFiles::File& file, std::vector<int16_t>& samples)
+	{
+		auto& data = file.Data;
+		if (!file.Closed || data.size() < 44 || memcmp(&data[0], "RIFF", 4) || memcmp(&data[8], "WAVE", 4) || memcmp(&data[12], "fmt ", 4) || memcmp(&data[36], "data", 4))
+			return false;
+
+		auto dataSize = GetUInt32(data, 40);
+		if (dataSize != data.size() - 44 || GetUInt32(data, 4) != 36 + dataSize || GetUInt32(data, 16) != 16)
+			return false;
+		if (GetUInt16(data, 20) != 1 || GetUInt16(data, 22) != 2 || GetUInt32(data, 24) != 48000 || GetUInt32(data, 28) != 48000 * 4 || GetUInt16(data, 32) != 4 || GetUInt16(data, 34) != 16)
+			return false;
+
+		samples.resize(dataSize / sizeof(int16_t));
+		memcpy(samples.data(), &data[44], dataSize);
+		return true;
+	}
+}
+
+TEST(VoiceRecorder, RealTimeSine)
+{
+	// 1.5 seconds of sine waves in 10ms callbacks, as fast as the mixer would hand them over, split into one second files
+	MemoryFiles files;
+	VoiceRecorder recorder(files);
+	std::string error;
+	CHECK(recorder.Start("voices", 0, 1, error));
+	CHECK_EQUAL(std::string("voices-20150801-120000-1.wav"), recorder.GetCurrentFile());
+
+	const size_t BlockFrames = VoiceRecorder::SampleRate / 100;
+	const int Blocks = 150;
+	auto next = std::chrono::steady_clock::now();
+	for (int i = 0; i < Blocks; i++)
+	{
+		auto samples = Sine(i * BlockFrames, BlockFrames);
+		recorder.Write(samples.data(), BlockFrames);
+		next += std::chrono::milliseconds(10);
+		std::this_thread::sleep_until(next);
+	}
+	recorder.Stop();
+	CHECK(!recorder.IsRecording());
+
+	auto stats = recorder.GetStats();
+	CHECK_EQUAL(72000U, stats.FramesWritten);
+	CHECK_EQUAL(0U, stats.FramesDropped);
+	CHECK_EQUAL(0U, stats.Overruns);
+	CHECK_EQUAL(2U, stats.FilesWritten);
+	CHECK_EQUAL(0U, stats.WriteErrors);
+
+	CHECK_EQUAL(2U, files.Files.size());
+	CHECK_EQUAL(std::string("voices-20150801-120000-1.wav"), files.Files[0].Path);
+	CHECK_EQUAL(std::string("voices-20150801-120000-2.wav"), files.Files[1].Path);
+
+	// every sample where it should be, with nothing lost or repeated where the file was rotated
+	std::vector<int16_t> first, second;
+	CHECK(ReadWave(files.Files[0], first));
+	CHECK(ReadWave(files.Files[1], second));
+	CHECK(first == Sine(0, 48000));
+	CHECK(second == Sine(48000, 24000));
+}
+
+TEST(VoiceRecorder, OverrunDropsWholeBlocks)
+{
+	// the writer's stuck, so once the ring's full the rest of the blocks are dropped instead of waited on
+	MemoryFiles files;
+	VoiceRecorder recorder(files);
+	std::string error;
+	CHECK(recorder.Start("voices", 0, 0, error));
+	files.Stall(true);
+
+	const size_t BlockFrames = 4096;
+	const size_t RingBlocks = VoiceRecorder::RingFrames / BlockFrames;
+	for (size_t i = 0; i < RingBlocks + 8; i++)
+	{
+		auto samples = Sine(i * BlockFrames, BlockFrames);
+		recorder.Write(samples.data(), BlockFrames);
+	}
+	auto stats = recorder.GetStats();
+	CHECK_EQUAL(8U * BlockFrames, stats.FramesDropped);
+	CHECK_EQUAL(8U, stats.Overruns);
+
+	// once it catches up there's room again
+	files.Stall(false);
+	for (int i = 0; i < 500 && recorder.GetStats().FramesWritten < RingBlocks * BlockFrames; i++)
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	CHECK_EQUAL(RingBlocks * BlockFrames, recorder.GetStats().FramesWritten);
+	for (size_t i = RingBlocks + 8; i < RingBlocks + 12; i++)
+	{
+		auto samples = Sine(i * BlockFrames, BlockFrames);
+		recorder.Write(samples.data(), BlockFrames);
+	}
+	recorder.Stop();
+
+	stats = recorder.GetStats();
+	CHECK_EQUAL((RingBlocks + 4) * BlockFrames, stats.FramesWritten);
+	CHECK_EQUAL(8U, stats.Overruns);
+
+	// the dropped blocks are missing whole, everything around them is intact
+	std::vector<int16_t> samples, expected = Sine(0, RingBlocks * BlockFrames);
+	auto after = Sine((RingBlocks + 8) * BlockFrames, 4 * BlockFrames);
+	expected.insert(expected.end(), after.begin(), after.end());
+	CHECK_EQUAL(1U, files.Files.size());
+	CHECK(ReadWave(files.Files[0], samples));
+	CHECK(samples == expected);
+}
+
+TEST(VoiceRecorder, SizeLimitAndErrors)
+{
+	MemoryFiles files;
+	VoiceRecorder recorder(files);
+	std::string error;
+
+	files.FailOpen = true;
+	CHECK(!recorder.Start("voices", 0, 0, error));
+	CHECK_EQUAL(std::string("Failed to open voices-20150801-120000-1.wav for writing"), error);
+	CHECK(!recorder.IsRecording());
+
+	// 1002 bytes only fits 250 whole frames
+	files.FailOpen = false;
+	CHECK(recorder.Start("voices", 1002, 0, error));
+	auto samples = Sine(0, 1000);
+	recorder.Write(samples.data(), 1000);
+	recorder.Stop();
+
+	CHECK_EQUAL(4U, recorder.GetStats().FilesWritten);
+	CHECK_EQUAL(4U, files.Files.size());
+	std::vector<int16_t> all;
+	for (auto& file : files.Files)
+	{
+		std::vector<int16_t> fileSamples;
+		CHECK(ReadWave(file, fileSamples));
+		CHECK_EQUAL(500U, fileSamples.size());
+		all.insert(all.end(), fileSamples.begin(), fileSamples.end());
+	}
+	CHECK(all == samples);
+	CHECK_EQUAL(std::string("voices-20150801-120000-4.wav"), files.Files[3].Path);
+
+	// writes that fail are counted
+	files.Files.clear();
+	files.FailWrites = true;
+	CHECK(recorder.Start("voices", 0, 0, error));
+	recorder.Write(samples.data(), 1000);
+	recorder.Stop();
+	CHECK(recorder.GetStats().WriteErrors >= 1);
+	CHECK(files.Files[0].Closed);
+}
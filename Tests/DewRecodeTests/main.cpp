@@ -0,0 +1,57 @@
+// runs every registered test, usage: DewRecodeTests [real game files to test against...]
+// the exit code is the number of tests that failed
+
+#include "Test.hpp"
+#include <cstdio>
+
+namespace
+{
+	std::vector<std::string> dataFiles;
+}
+
+namespace Test
+{
+	std::vector<TestInfo>& GetTests()
+	{
+		static std::vector<TestInfo> tests;
+		return tests;
+	}
+
+	const std::vector<std::string>& GetDataFiles()
+	{
+		return dataFiles;
+	}
+
+	void Fail(const char* file, int line, const std::string& message)
+	{
+		Failure failure;
+		failure.Message = std::string(file) + "(" + std::to_string(line) + "): " + message;
+		throw failure;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	for (auto i = 1; i < argc; i++)
+		dataFiles.push_back(argv[i]);
+
+	auto failed = 0;
+	auto& tests = Test::GetTests();
+	for (auto& test : tests)
+	{
+		try
+		{
+			test.Func();
+		}
+		catch (const Test::Failure& failure)
+		{
+			printf("FAIL %s.%s\n  %s\n", test.Group, test.Name, failure.Message.c_str());
+			failed++;
+			continue;
+		}
+		printf("PASS %s.%s\n", test.Group, test.Name);
+	}
+
+	printf("\n%d of %d tests passed\n", static_cast<int>(tests.size()) - failed, static_cast<int>(tests.size()));
+	return failed;
+}
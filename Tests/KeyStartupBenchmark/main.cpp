@@ -0,0 +1,221 @@
+// times how long it takes to get a usable player key (and its UID) at startup, with and without a key already saved somewhere:
+// the cfg key still being valid, restoring it from the keystore backup, taking one from the pool, and generating a new 4096-bit one
+// also times how long PrepareKey holds up the caller, since that's all the game thread waits for while a new key is generated
+// build + run it in Release, the exit code is non-zero if any of the cached paths take longer than TargetCachedMs or PrepareKey takes longer than TargetPrepareMs
+// it doesn't need MSVC either, eg. g++ -O2 -std=c++11 -I../../DewRecode/include main.cpp ../../DewRecode/src/KeyManager.cpp -lcrypto -lpthread
+
+#include "../../DewRecode/src/KeyManager.hpp"
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <openssl/bn.h>
+#include <openssl/pem.h>
+#include <openssl/rsa.h>
+
+namespace
+{
+	const char* KeyStoreFile = "KeyStartupBenchmark.dat";
+	const int Runs = 20; // for the cached paths, generating a key only happens once
+	const double TargetCachedMs = 50.0;
+	const double TargetPrepareMs = 16.0; // less than a frame, it includes starting the worker thread for the first time
+
+	// plain files and OpenSSL, no other instances share the store so locking isn't needed
+	class BenchmarkEnvironment : public KeyEnvironment
+	{
+	public:
+		bool LockFile(const std::string& fileName)
+		{
+			return true;
+		}
+
+		void UnlockFile(const std::string& fileName)
+		{
+		}
+
+		bool ReadFile(const std::string& fileName, std::string& contents, bool& exists)
+		{
+			std::ifstream in(fileName, std::ios::in | std::ios::binary);
+			exists = in.is_open();
+			if (!exists)
+				return false;
+
+			contents.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+			return true;
+		}
+
+		bool ReplaceFile(const std::string& fileName, const std::string& contents)
+		{
+			auto tempName = fileName + ".tmp";
+			{
+				std::ofstream out(tempName, std::ios::out | std::ios::binary | std::ios::trunc);
+				out << contents;
+				if (out.fail())
+					return false;
+			}
+			std::remove(fileName.c_str());
+			return std::rename(tempName.c_str(), fileName.c_str()) == 0;
+		}
+
+		bool RenameFile(const std::string& fileName, const std::string& newName)
+		{
+			std::remove(newName.c_str());
+			return std::rename(fileName.c_str(), newName.c_str()) == 0;
+		}
+
+		bool GenerateKeyPair(int bits, PlayerKeyPair& key)
+		{
+			RSA* rsa = RSA_new();
+			BIGNUM* exponent = BN_new();
+			BN_set_word(exponent, RSA_F4);
+			bool generated = RSA_generate_key_ex(rsa, bits, exponent, NULL) == 1;
+			if (generated)
+			{
+				key.PrivateKey = WritePem(rsa, true);
+				key.PublicKey = WritePem(rsa, false);
+			}
+			BN_free(exponent);
+			RSA_free(rsa);
+			return generated && KeyManager::ValidateKeyPair(key);
+		}
+
+		void Log(LogSeverity severity, const std::string& message)
+		{
+		}
+
+	private:
+		// writes a key out as PEM and strips it like it is in the cfg
+		static std::string WritePem(RSA* rsa, bool isPrivateKey)
+		{
+			BIO* buffer = BIO_new(BIO_s_mem());
+			if (isPrivateKey)
+				PEM_write_bio_RSAPrivateKey(buffer, rsa, NULL, NULL, 0, NULL, NULL);
+			else
+				PEM_write_bio_RSA_PUBKEY(buffer, rsa);
+
+			char* data;
+			auto size = BIO_get_mem_data(buffer, &data);
+			std::string pem(data, size);
+			BIO_free_all(buffer);
+
+			std::string stripped;
+			size_t lineStart = 0;
+			while (lineStart < pem.length())
+			{
+				auto lineEnd = pem.find('\n', lineStart);
+				auto line = pem.substr(lineStart, lineEnd - lineStart);
+				if (line.compare(0, 5, "-----") != 0)
+					stripped += line;
+				lineStart = lineEnd == std::string::npos ? pem.length() : lineEnd + 1;
+			}
+			return stripped;
+		}
+	};
+
+	double MsSince(std::chrono::high_resolution_clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+	}
+
+	void Report(const char* name, double ms, double target)
+	{
+		printf("  %-28s %10.3f ms%s\n", name, ms, ms > target ? "  FAIL" : "");
+	}
+}
+
+int main()
+{
+	BenchmarkEnvironment environment;
+	std::remove(KeyStoreFile);
+
+	// the key everything else starts from, this is also the "nothing cached" time
+	printf("generating a %d-bit key, this takes a few seconds...\n", KeyManager::KeyBits);
+	PlayerKeyPair key;
+	double prepareMs;
+	double generateMs;
+	{
+		KeyManager keys(KeyStoreFile, environment);
+		auto start = std::chrono::high_resolution_clock::now();
+		keys.PrepareKey();
+		prepareMs = MsSince(start);
+		if (!keys.TakeKey(key, true))
+		{
+			printf("FAIL: couldn't generate a key\n");
+			return 1;
+		}
+		KeyManager::GetUid(key.PublicKey);
+		generateMs = MsSince(start);
+	}
+
+	// the key in the cfg is still good, it only needs checking
+	double cfgMs = 0;
+	for (int i = 0; i < Runs; i++)
+	{
+		auto start = std::chrono::high_resolution_clock::now();
+		if (!KeyManager::ValidateKeyPair(key))
+		{
+			printf("FAIL: the generated key isn't valid\n");
+			return 1;
+		}
+		KeyManager::GetUid(key.PublicKey);
+		cfgMs += MsSince(start) / Runs;
+	}
+
+	// the cfg lost it, so it comes back from the keystore backup
+	{
+		KeyManager keys(KeyStoreFile, environment);
+		keys.SetBackupKey(key);
+	}
+	double backupMs = 0;
+	for (int i = 0; i < Runs; i++)
+	{
+		auto start = std::chrono::high_resolution_clock::now();
+		KeyManager keys(KeyStoreFile, environment);
+		PlayerKeyPair backup;
+		if (!keys.GetBackupKey(backup) || !KeyManager::ValidateKeyPair(backup))
+		{
+			printf("FAIL: couldn't restore the backup\n");
+			return 1;
+		}
+		KeyManager::GetUid(backup.PublicKey);
+		backupMs += MsSince(start) / Runs;
+	}
+
+	// a fresh identity out of the pool (a dedicated server fleet fills it ahead of time)
+	double poolMs = 0;
+	for (int i = 0; i < Runs; i++)
+	{
+		{
+			KeyStore store(KeyStoreFile, environment);
+			store.BeginUpdate();
+			store.AddPooledKey(key);
+			store.EndUpdate(true);
+		}
+
+		auto start = std::chrono::high_resolution_clock::now();
+		KeyManager keys(KeyStoreFile, environment);
+		keys.PrepareKey();
+		PlayerKeyPair pooled;
+		if (!keys.TakeKey(pooled, true) || keys.GetPoolSize() != 0)
+		{
+			printf("FAIL: couldn't take a key from the pool\n");
+			return 1;
+		}
+		KeyManager::GetUid(pooled.PublicKey);
+		poolMs += MsSince(start) / Runs;
+	}
+	std::remove(KeyStoreFile);
+
+	printf("time until a key and UID are ready:\n");
+	Report("key in the cfg", cfgMs, TargetCachedMs);
+	Report("restored from the keystore", backupMs, TargetCachedMs);
+	Report("taken from the pool", poolMs, TargetCachedMs);
+	printf("  %-28s %10.3f ms\n", "generated", generateMs);
+	Report("PrepareKey (game thread)", prepareMs, TargetPrepareMs);
+
+	if (cfgMs > TargetCachedMs || backupMs > TargetCachedMs || poolMs > TargetCachedMs || prepareMs > TargetPrepareMs)
+	{
+		printf("FAIL: slower than the targets (%.0f ms with a cached key, %.0f ms for PrepareKey)\n", TargetCachedMs, TargetPrepareMs);
+		return 1;
+	}
+	return 0;
+}
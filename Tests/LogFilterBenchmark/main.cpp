@@ -0,0 +1,119 @@
+// times Game.LogFilter matching against the strstr loop it replaced, over a fixed set of log lines with more and more filters
+// build + run it in Release, the exit code is non-zero if the two disagree on a line, or if the compiled filter is slower with the most filters
+// it doesn't need MSVC either, eg. g++ -O2 -std=c++11 -I../../DewRecode/include -D_stricmp=strcasecmp -D_strnicmp=strncasecmp "-D_countof(a)=(sizeof(a)/sizeof(a[0]))" main.cpp ../../DewRecode/src/LogFilter.cpp
+
+#include "../../DewRecode/src/LogFilter.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+namespace
+{
+	const int NumLines = 20000;
+	const int Passes = 5;
+	const int FilterCounts[] = { 1, 4, 16, 64, 256 };
+
+	const char* Modules[] = { "Game", "Server", "Network", "Console", "Patches", "VoIP" };
+	const char* Words[] = { "player", "joined", "left", "map", "loaded", "packet", "sent", "received", "timeout", "bind", "ping", "score", "team", "red", "blue", "variant" };
+
+	/// <summary>
+	/// Makes a log line out of random words, using a fixed seed so every run matches the same lines.
+	/// </summary>
+	/// <param name="seed">The generator state.</param>
+	/// <returns>The line.</returns>
+	std::string MakeLine(uint32_t& seed)
+	{
+		std::string line;
+		auto numWords = 6 + (seed >> 16) % 10;
+		for (uint32_t i = 0; i < numWords; i++)
+		{
+			seed = seed * 1103515245 + 12345;
+			if (i > 0)
+				line += ' ';
+			line += Words[(seed >> 16) % _countof(Words)];
+			if ((seed >> 8) % 4 == 0)
+				line += std::to_string((seed >> 4) % 100);
+		}
+		return line;
+	}
+
+	/// <summary>
+	/// Matches a line the way DebugLog did before LogFilter, by strstr'ing each filter.
+	/// </summary>
+	/// <param name="include">The include filters.</param>
+	/// <param name="exclude">The exclude filters.</param>
+	/// <param name="message">The line.</param>
+	/// <returns>true if the line should be logged.</returns>
+	bool NaiveMatches(const std::vector<std::string>& include, const std::vector<std::string>& exclude, const char* message)
+	{
+		for (auto& filter : include)
+			if (!strstr(message, filter.c_str()))
+				return false;
+		for (auto& filter : exclude)
+			if (strstr(message, filter.c_str()))
+				return false;
+		return true;
+	}
+
+	/// <summary>
+	/// Works out how many nanoseconds a single line took.
+	/// </summary>
+	/// <param name="start">The time from before the loop.</param>
+	/// <param name="end">The time from after the loop.</param>
+	/// <returns>Nanoseconds per line.</returns>
+	double NsPerLine(std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end)
+	{
+		return std::chrono::duration<double, std::nano>(end - start).count() / (static_cast<double>(NumLines) * Passes);
+	}
+}
+
+int main()
+{
+	uint32_t seed = 1;
+	std::vector<std::string> lines;
+	for (int i = 0; i < NumLines; i++)
+		lines.push_back(MakeLine(seed));
+
+	printf("%d lines x %d passes\n", NumLines, Passes);
+	printf("filters  strstr (ns/line)  LogFilter (ns/line)  logged\n");
+
+	double naiveNs = 0, filterNs = 0;
+	for (auto count : FilterCounts)
+	{
+		// one include that most lines have, everything else is an exclude that only a few lines have
+		std::vector<std::string> include(1, "e");
+		std::vector<std::string> exclude;
+		for (int i = 1; i < count; i++)
+			exclude.push_back(std::string(Words[i % _countof(Words)]) + std::to_string(i));
+
+		LogFilter filter(include, exclude);
+
+		size_t naiveLogged = 0, filterLogged = 0;
+		auto start = std::chrono::steady_clock::now();
+		for (int pass = 0; pass < Passes; pass++)
+			for (auto& line : lines)
+				naiveLogged += NaiveMatches(include, exclude, line.c_str());
+		auto naiveEnd = std::chrono::steady_clock::now();
+		for (int pass = 0; pass < Passes; pass++)
+			for (size_t i = 0; i < lines.size(); i++)
+				filterLogged += filter.Matches(LogSeverity::Info, Modules[i % _countof(Modules)], lines[i].c_str());
+		auto filterEnd = std::chrono::steady_clock::now();
+
+		naiveNs = NsPerLine(start, naiveEnd);
+		filterNs = NsPerLine(naiveEnd, filterEnd);
+		printf("%7d  %16.1f  %19.1f  %u\n", count, naiveNs, filterNs, static_cast<unsigned int>(filterLogged / Passes));
+
+		if (naiveLogged != filterLogged)
+		{
+			printf("FAIL: strstr logged %u lines but LogFilter logged %u\n", static_cast<unsigned int>(naiveLogged / Passes), static_cast<unsigned int>(filterLogged / Passes));
+			return 1;
+		}
+	}
+
+	if (filterNs > naiveNs)
+	{
+		printf("FAIL: LogFilter was slower than strstr with %d filters\n", FilterCounts[_countof(FilterCounts) - 1]);
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,227 @@
+// times applying a large patch set (4096 patches spread over 64 pages of real, protected memory) the way PatchManager used to,
+// unprotecting + restoring + flushing around every patch, against one PatchBatch that unprotects each page once
+// build + run it in Release, the exit code is non-zero if the two leave memory different or the batch isn't at least TargetSpeedup times faster
+// it doesn't need MSVC either, eg. g++ -O2 -std=c++11 main.cpp ../../DewRecode/src/PatchBatch.cpp
+
+#include "../../DewRecode/src/PatchBatch.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+	const size_t PageCount = 64;
+	const size_t PatchCount = 4096;
+	const size_t PatchSize = 6; // the size of a conditional jump hook
+	const int Runs = 20;
+	const double TargetSpeedup = 3.0;
+
+	// memory that's really protected, like the game's code pages
+	class ProtectedMemory : public PatchMemory
+	{
+	public:
+		unsigned char* Base;
+
+		ProtectedMemory()
+		{
+#ifdef _WIN32
+			Base = static_cast<unsigned char*>(VirtualAlloc(NULL, PageCount * GetPageSize(), MEM_COMMIT | MEM_RESERVE, PAGE_EXECUTE_READ));
+#else
+			auto mapped = mmap(NULL, PageCount * GetPageSize(), PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+			Base = mapped != MAP_FAILED ? static_cast<unsigned char*>(mapped) : NULL;
+#endif
+		}
+
+		~ProtectedMemory()
+		{
+#ifdef _WIN32
+			VirtualFree(Base, 0, MEM_RELEASE);
+#else
+			munmap(Base, PageCount * GetPageSize());
+#endif
+		}
+
+		size_t GetPageSize()
+		{
+#ifdef _WIN32
+			SYSTEM_INFO info;
+			GetSystemInfo(&info);
+			return info.dwPageSize;
+#else
+			return static_cast<size_t>(sysconf(_SC_PAGESIZE));
+#endif
+		}
+
+		bool UnprotectPage(size_t page, uint32_t& oldProtection)
+		{
+#ifdef _WIN32
+			DWORD old;
+			if (!VirtualProtect(reinterpret_cast<void*>(page), 1, PAGE_EXECUTE_READWRITE, &old))
+				return false;
+			oldProtection = old;
+			return true;
+#else
+			oldProtection = PROT_READ;
+			return mprotect(reinterpret_cast<void*>(page), GetPageSize(), PROT_READ | PROT_WRITE) == 0;
+#endif
+		}
+
+		bool RestorePage(size_t page, uint32_t oldProtection)
+		{
+#ifdef _WIN32
+			DWORD temp;
+			return VirtualProtect(reinterpret_cast<void*>(page), 1, oldProtection, &temp) != 0;
+#else
+			return mprotect(reinterpret_cast<void*>(page), GetPageSize(), oldProtection) == 0;
+#endif
+		}
+
+		bool Read(size_t address, void* out, size_t size)
+		{
+			memcpy(out, reinterpret_cast<void*>(address), size);
+			return true;
+		}
+
+		bool Write(size_t address, const void* data, size_t size)
+		{
+			memcpy(reinterpret_cast<void*>(address), data, size);
+			return true;
+		}
+
+		void FlushInstructions(size_t address, size_t size)
+		{
+#ifdef _WIN32
+			FlushInstructionCache(GetCurrentProcess(), reinterpret_cast<void*>(address), size);
+#endif
+		}
+	};
+
+	struct TestPatch
+	{
+		size_t Address;
+		std::vector<unsigned char> Data, Orig;
+	};
+
+	/// <summary>
+	/// Spreads the patches evenly over every page, some of them straddling a page boundary.
+	/// </summary>
+	std::vector<TestPatch> MakePatches(ProtectedMemory& memory)
+	{
+		auto start = reinterpret_cast<size_t>(memory.Base);
+		auto stride = PageCount * memory.GetPageSize() / PatchCount;
+		std::vector<TestPatch> patches(PatchCount);
+		for (size_t i = 0; i < PatchCount; i++)
+		{
+			patches[i].Address = start + i * stride + (i % 7);
+			patches[i].Data.assign(PatchSize, static_cast<unsigned char>(0x90 + i % 16));
+			patches[i].Orig.assign(PatchSize, 0);
+		}
+		return patches;
+	}
+
+	/// <summary>
+	/// Toggles each patch on its own the way PatchManager used to, checking the bytes first and unprotecting/restoring the page around the write.
+	/// </summary>
+	bool ApplyPerPatch(PatchMemory& memory, const std::vector<TestPatch>& patches, bool enable)
+	{
+		auto pageSize = memory.GetPageSize();
+		std::vector<unsigned char> current(PatchSize);
+		for (auto& patch : patches)
+		{
+			auto& expected = enable ? patch.Orig : patch.Data;
+			auto& data = enable ? patch.Data : patch.Orig;
+			memory.Read(patch.Address, current.data(), current.size());
+			if (current != expected)
+				return false;
+
+			auto first = patch.Address / pageSize * pageSize;
+			auto last = (patch.Address + data.size() - 1) / pageSize * pageSize;
+			uint32_t oldFirst = 0, oldLast = 0;
+			if (!memory.UnprotectPage(first, oldFirst) || (last != first && !memory.UnprotectPage(last, oldLast)))
+				return false;
+			memory.Write(patch.Address, data.data(), data.size());
+			memory.FlushInstructions(patch.Address, data.size());
+			memory.RestorePage(first, oldFirst);
+			if (last != first)
+				memory.RestorePage(last, oldLast);
+		}
+		return true;
+	}
+
+	bool ApplyBatch(PatchMemory& memory, const std::vector<TestPatch>& patches, bool enable)
+	{
+		PatchBatch batch(&memory);
+		for (auto& patch : patches)
+			batch.Add("patch", patch.Address, enable ? patch.Data : patch.Orig, enable ? &patch.Orig : &patch.Data);
+
+		std::string error;
+		return batch.Apply(error);
+	}
+
+	double MsSince(std::chrono::steady_clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+}
+
+int main()
+{
+	ProtectedMemory perPatchMemory, batchMemory;
+	if (!perPatchMemory.Base || !batchMemory.Base)
+	{
+		printf("FAIL: couldn't allocate the memory to patch\n");
+		return 1;
+	}
+	auto perPatchPatches = MakePatches(perPatchMemory);
+	auto batchPatches = MakePatches(batchMemory);
+	auto size = PageCount * perPatchMemory.GetPageSize();
+
+	// best of Runs for each, enabling then disabling the whole set
+	double perPatchMs = 1e9, batchMs = 1e9;
+	for (int run = 0; run < Runs; run++)
+	{
+		auto start = std::chrono::steady_clock::now();
+		auto perPatchApplied = ApplyPerPatch(perPatchMemory, perPatchPatches, true);
+		auto elapsed = MsSince(start);
+		perPatchMs = elapsed < perPatchMs ? elapsed : perPatchMs;
+
+		start = std::chrono::steady_clock::now();
+		auto batchApplied = ApplyBatch(batchMemory, batchPatches, true);
+		elapsed = MsSince(start);
+		batchMs = elapsed < batchMs ? elapsed : batchMs;
+
+		if (!perPatchApplied || !batchApplied)
+		{
+			printf("FAIL: the patches couldn't be applied\n");
+			return 1;
+		}
+		if (memcmp(perPatchMemory.Base, batchMemory.Base, size) != 0)
+		{
+			printf("FAIL: the batch left memory different to patching one at a time\n");
+			return 1;
+		}
+
+		if (!ApplyPerPatch(perPatchMemory, perPatchPatches, false) || !ApplyBatch(batchMemory, batchPatches, false))
+		{
+			printf("FAIL: the patches couldn't be removed\n");
+			return 1;
+		}
+	}
+
+	printf("%d patches over %d pages, best of %d runs\n", (int)PatchCount, (int)PageCount, Runs);
+	printf("  one patch at a time:  %8.3f ms\n", perPatchMs);
+	printf("  one batch:            %8.3f ms (%.2fx)\n", batchMs, perPatchMs / batchMs);
+
+	if (perPatchMs / batchMs < TargetSpeedup)
+	{
+		printf("FAIL: the batch wasn't at least %.2fx faster\n", TargetSpeedup);
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,108 @@
+// times how much a ProfileZone costs, since they wrap every tick/event callback the game runs
+// build + run it in Release, the exit code is non-zero if a recorded zone costs more than TargetNs
+// it doesn't need MSVC either, eg. g++ -O2 -std=c++11 -I../../ThirdParty/rapidjson main.cpp ../../DewRecode/src/Profiler.cpp -lpthread
+
+#include "../../DewRecode/src/Profiler.hpp"
+#include <cstdio>
+
+namespace
+{
+	const int Iterations = 10000000;
+	const double TargetNs = 50.0; // per zone, with the profiler recording
+
+	volatile int sink; // stops the loops from being optimized away
+
+	/// <summary>
+	/// Works out how many nanoseconds a single iteration took.
+	/// </summary>
+	/// <param name="start">The Profiler::Now() value from before the loop.</param>
+	/// <param name="end">The Profiler::Now() value from after the loop.</param>
+	/// <returns>Nanoseconds per iteration.</returns>
+	double NsPerIteration(int64_t start, int64_t end)
+	{
+		return (end - start) * 1000000000.0 / ProfilerPlatform::Frequency() / Iterations;
+	}
+
+	/// <summary>
+	/// Times an empty ProfileZone.
+	/// </summary>
+	/// <param name="profiler">The profiler to record to.</param>
+	/// <param name="zone">The zone ID.</param>
+	/// <returns>Nanoseconds per zone.</returns>
+	double TimeProfileZone(Profiler& profiler, uint32_t zone)
+	{
+		auto start = Profiler::Now();
+		for (int i = 0; i < Iterations; i++)
+		{
+			ProfileZone profileZone(profiler, zone);
+			sink = i;
+		}
+		return NsPerIteration(start, Profiler::Now());
+	}
+
+	/// <summary>
+	/// Times Profiler::Record on its own, without the Now() calls a ProfileZone makes.
+	/// </summary>
+	/// <param name="profiler">The profiler to record to.</param>
+	/// <param name="zone">The zone ID.</param>
+	/// <returns>Nanoseconds per zone.</returns>
+	double TimeRecord(Profiler& profiler, uint32_t zone)
+	{
+		auto start = Profiler::Now();
+		for (int i = 0; i < Iterations; i++)
+			profiler.Record(zone, start + i, start + i + 1);
+		return NsPerIteration(start, Profiler::Now());
+	}
+
+	/// <summary>
+	/// Times Profiler::Now, which a recorded zone calls twice.
+	/// </summary>
+	/// <returns>Nanoseconds per call.</returns>
+	double TimeNow()
+	{
+		auto start = Profiler::Now();
+		for (int i = 0; i < Iterations; i++)
+			sink = static_cast<int>(Profiler::Now());
+		return NsPerIteration(start, Profiler::Now());
+	}
+}
+
+int main()
+{
+	Profiler profiler;
+	auto zone = profiler.RegisterZone("Benchmark");
+
+	// warm up (gives this thread its ring + pages it in)
+	profiler.SetEnabled(true);
+	TimeProfileZone(profiler, zone);
+	profiler.SetEnabled(false);
+
+	auto disabledNs = TimeProfileZone(profiler, zone);
+	profiler.SetEnabled(true);
+	auto enabledNs = TimeProfileZone(profiler, zone);
+	auto recordNs = TimeRecord(profiler, zone);
+	auto nowNs = TimeNow();
+
+	printf("%d iterations each\n", Iterations);
+	printf("ProfileZone (not recording): %6.2f ns\n", disabledNs);
+	printf("ProfileZone (recording):     %6.2f ns (target %.0f ns)\n", enabledNs, TargetNs);
+	printf("Profiler::Record:            %6.2f ns\n", recordNs);
+	printf("Profiler::Now:               %6.2f ns\n", nowNs);
+
+	// the ring only keeps the newest RingSize zones, minus the one the thread could've been writing over
+	auto stats = profiler.GetStats();
+	size_t kept = stats.empty() ? 0 : stats[0].Count;
+	printf("Zones kept in the ring:      %u of %u\n", static_cast<unsigned int>(kept), static_cast<unsigned int>(Profiler::RingSize));
+	if (kept != Profiler::RingSize - 1)
+	{
+		printf("FAIL: expected %u zones to be kept\n", static_cast<unsigned int>(Profiler::RingSize - 1));
+		return 1;
+	}
+
+	if (enabledNs > TargetNs)
+	{
+		printf("FAIL: a recorded zone took longer than the target\n");
+		return 1;
+	}
+	return 0;
+}
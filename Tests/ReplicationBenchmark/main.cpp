@@ -0,0 +1,193 @@
+// compares what a client polling the info server gets sent with 200 replicated variables (5 of them changing between polls): the full
+// snapshot response every time, against a "?since=N" delta built from the generations ReplicationTable tracks
+// build + run it in Release, the exit code is non-zero if applying the deltas doesn't give the same variables as the full responses,
+// the deltas aren't at least TargetResponseRatio times smaller than the full responses (TargetVariablesRatio for just the variables, the players
+// are in both) or building one takes longer than TargetDeltaUs
+// it doesn't need MSVC either, eg. g++ -O2 -std=c++11 -I../../DewRecode/include -I../../ThirdParty/rapidjson main.cpp ../../DewRecode/src/ReplicationTable.cpp ../../ServerPlugin/InfoSnapshot.cpp
+
+#include "../../DewRecode/src/ReplicationTable.hpp"
+#include "../../ServerPlugin/InfoSnapshot.hpp"
+#include <rapidjson/document.h>
+#include <chrono>
+#include <cstdio>
+#include <map>
+
+using namespace Server;
+
+namespace
+{
+	const int VariableCount = 200;
+	const int ChangesPerPoll = 5;
+	const int PlayerCount = 16;
+	const int Polls = 200;
+	const int Runs = 20;
+	const double TargetResponseRatio = 3.0;
+	const double TargetVariablesRatio = 20.0;
+	const double TargetDeltaUs = 50.0; // it's built on the network thread for every delta request
+
+	const std::string Headers = "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\nAccess-Control-Allow-Origin: *\r\nServer: ElDewrito/0.5.0.0\r\n";
+
+	typedef std::map<std::string, std::string> VariableValues;
+
+	/// <summary>
+	/// Reads the game state the way PatchModuleServer does, with the variables coming out of the replication table.
+	/// </summary>
+	InfoState ReadState(const ReplicationTable& table, int poll)
+	{
+		InfoState state;
+		state.Name = "Benchmark Server";
+		state.Port = 11774;
+		state.HostPlayer = "host";
+		state.Map = "Guardian";
+		state.MapFile = "guardian";
+		state.Variant = "Team Slayer";
+		state.VariantType = "slayer";
+		state.Status = "InGame";
+		state.NumPlayers = PlayerCount;
+		state.MaxPlayers = 16;
+		state.Xnkid = "00112233445566778899AABBCCDDEEFF";
+		state.Xnaddr = "FFEEDDCCBBAA99887766554433221100";
+
+		std::vector<ReplicatedVariable> variables;
+		table.GetChangedSince(0, variables);
+		state.Generation = table.GetGeneration();
+		for (auto& variable : variables)
+		{
+			InfoVariableState info;
+			info.Name = variable.Variable->Name;
+			info.Value = variable.Variable->ValueString;
+			info.Generation = variable.Generation;
+			state.Variables.push_back(info);
+		}
+		for (int i = 0; i < PlayerCount; i++)
+		{
+			InfoPlayer player;
+			player.Name = "player" + std::to_string(i);
+			player.Score = poll + i;
+			player.Kills = i;
+			player.Team = i % 2;
+			player.IsAlive = true;
+			state.Players.push_back(player);
+		}
+		state.GameVersion = "1.106708 cert_ms23";
+		state.EldewritoVersion = "0.5.0.0";
+		return state;
+	}
+
+	/// <summary>
+	/// Parses a response and copies its variables over the ones the client already has, like a client applying a delta.
+	/// </summary>
+	/// <param name="response">The response.</param>
+	/// <param name="values">The variables the client has.</param>
+	/// <param name="generation">Returns the generation the client is up to date with.</param>
+	/// <param name="count">Returns the number of variables in the response.</param>
+	/// <returns>false if the response isn't valid JSON with a variables array and the generation it's up to.</returns>
+	bool ApplyResponse(const std::string& response, VariableValues& values, unsigned int& generation, size_t& count)
+	{
+		auto headerEnd = response.find("\r\n\r\n");
+		if (headerEnd == std::string::npos)
+			return false;
+		rapidjson::Document json;
+		json.Parse(response.c_str() + headerEnd + 4);
+		if (json.HasParseError() || !json.IsObject() || !json.HasMember("variables") || !json.HasMember("variablesGeneration"))
+			return false;
+
+		auto& variables = json["variables"];
+		for (auto it = variables.Begin(); it != variables.End(); ++it)
+			values[(*it)["name"].GetString()] = (*it)["value"].GetString();
+		generation = json["variablesGeneration"].GetUint();
+		count = variables.Size();
+		return true;
+	}
+
+	// the size of the variables array in a response, plus "variablesSince" for a delta
+	size_t VariablesLength(const std::string& response, const InfoSnapshot& snapshot)
+	{
+		return response.length() - response.find("\r\n\r\n") - 4 - snapshot.AuthJsonHead.length() - snapshot.AuthJsonTail.length();
+	}
+
+	double UsSince(std::chrono::steady_clock::time_point start)
+	{
+		return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+	}
+}
+
+int main()
+{
+	std::deque<Command> variables(VariableCount);
+	ReplicationTable table;
+	for (int i = 0; i < VariableCount; i++)
+	{
+		variables[i].Name = "Module.Variable" + std::to_string(i);
+		variables[i].ValueString = "0";
+		table.Add(&variables[i]);
+	}
+
+	// one client that always gets the full response, one that asks for what's changed since its last poll
+	VariableValues fullValues, deltaValues;
+	unsigned int fullGeneration = 0, deltaGeneration = 0;
+	size_t fullBytes = 0, deltaBytes = 0, fullVariablesBytes = 0, deltaVariablesBytes = 0;
+	double deltaUs = 1e9;
+	for (int poll = 0; poll < Polls; poll++)
+	{
+		// spread the changes out over every variable, plus one set to the value it already has which shouldn't get it sent
+		for (int i = 0; i <= ChangesPerPoll; i++)
+		{
+			auto& variable = variables[(poll * ChangesPerPoll + i) * 7 % VariableCount];
+			auto oldValue = variable.ValueString;
+			if (i < ChangesPerPoll)
+				variable.ValueString = std::to_string(poll);
+			table.Update(&variable, oldValue);
+		}
+		auto snapshot = BuildInfoSnapshot(ReadState(table, poll), Headers, "", 0);
+
+		// best of Runs, the first poll's delta has every variable so it's left out of the timing and the sizes
+		std::string delta;
+		for (int run = 0; run < Runs; run++)
+		{
+			auto start = std::chrono::steady_clock::now();
+			delta = deltaGeneration ? snapshot->BuildDeltaResponse(deltaGeneration) : snapshot->AuthResponse;
+			auto elapsed = UsSince(start);
+			if (deltaGeneration && elapsed < deltaUs)
+				deltaUs = elapsed;
+		}
+		if (poll > 0)
+		{
+			fullBytes += snapshot->AuthResponse.length();
+			deltaBytes += delta.length();
+			fullVariablesBytes += VariablesLength(snapshot->AuthResponse, *snapshot);
+			deltaVariablesBytes += VariablesLength(delta, *snapshot);
+		}
+
+		size_t fullCount, deltaCount;
+		if (!ApplyResponse(snapshot->AuthResponse, fullValues, fullGeneration, fullCount) || !ApplyResponse(delta, deltaValues, deltaGeneration, deltaCount))
+		{
+			printf("FAIL: a response couldn't be parsed\n");
+			return 1;
+		}
+		if (fullValues != deltaValues || fullGeneration != deltaGeneration || fullValues.size() != VariableCount || (poll > 0 && deltaCount != ChangesPerPoll))
+		{
+			printf("FAIL: the deltas didn't give the same variables as the full response after poll %d\n", poll);
+			return 1;
+		}
+	}
+
+	auto responseRatio = static_cast<double>(fullBytes) / deltaBytes;
+	auto variablesRatio = static_cast<double>(fullVariablesBytes) / deltaVariablesBytes;
+	printf("%d variables, %d changes and %d players between each of %d polls\n", VariableCount, ChangesPerPoll, PlayerCount, Polls);
+	printf("  full snapshot:        %8u bytes per poll, %6u of them variables\n", static_cast<unsigned int>(fullBytes / (Polls - 1)), static_cast<unsigned int>(fullVariablesBytes / (Polls - 1)));
+	printf("  delta:                %8u bytes per poll, %6u of them variables (%.2fx/%.2fx smaller)\n", static_cast<unsigned int>(deltaBytes / (Polls - 1)), static_cast<unsigned int>(deltaVariablesBytes / (Polls - 1)), responseRatio, variablesRatio);
+	printf("  building a delta:     %8.2f us (best of %d runs)\n", deltaUs, Runs);
+
+	if (responseRatio < TargetResponseRatio || variablesRatio < TargetVariablesRatio)
+	{
+		printf("FAIL: the deltas weren't at least %.2fx smaller (%.2fx for just the variables)\n", TargetResponseRatio, TargetVariablesRatio);
+		return 1;
+	}
+	if (deltaUs > TargetDeltaUs)
+	{
+		printf("FAIL: building a delta took longer than the target (%.0f us)\n", TargetDeltaUs);
+		return 1;
+	}
+	return 0;
+}
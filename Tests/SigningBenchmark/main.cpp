@@ -0,0 +1,209 @@
+// times signing and verifying the stats for a match (16 blobs with one 4096-bit key, the size player keys are), parsing the key
+// for every call like RSACreateSignature/RSAVerifySignature used to against SigningService, which only parses each key the first time
+// build + run it in Release, the exit code is non-zero if the two give different signatures or the cached path isn't at least
+// TargetSignSpeedup/TargetVerifySpeedup times faster than parsing the key every time
+// it doesn't need MSVC either, eg. g++ -O2 -std=c++11 main.cpp ../../DewRecode/src/SigningService.cpp -lcrypto -lpthread
+
+#include "../../DewRecode/src/SigningService.hpp"
+#include <chrono>
+#include <cstdio>
+#include <openssl/bn.h>
+#include <openssl/evp.h>
+#include <openssl/pem.h>
+#include <openssl/rsa.h>
+#include <openssl/sha.h>
+
+namespace
+{
+	const int BlobCount = 16;
+	const int Runs = 20;
+	const double TargetSignSpeedup = 1.15; // around 1.3x here, the signing itself is most of the cost with a 4096-bit key
+	const double TargetVerifySpeedup = 1.15; // also around 1.3x, verifying is cheap but so is parsing a public key
+
+	/// <summary>
+	/// Generates the key to sign with, in the same PEM formats RSAReformatKey gives.
+	/// </summary>
+	/// <param name="privateKey">Returns the private key.</param>
+	/// <param name="publicKey">Returns the public key.</param>
+	/// <returns>true if the key was generated.</returns>
+	bool GenerateKey(std::string& privateKey, std::string& publicKey)
+	{
+		auto rsa = RSA_new();
+		auto exponent = BN_new();
+		BN_set_word(exponent, RSA_F4);
+		auto generated = RSA_generate_key_ex(rsa, 4096, exponent, NULL) == 1;
+		BN_free(exponent);
+		if (generated)
+		{
+			auto bio = BIO_new(BIO_s_mem());
+			PEM_write_bio_RSAPrivateKey(bio, rsa, NULL, NULL, 0, NULL, NULL);
+			char* pem;
+			auto length = BIO_get_mem_data(bio, &pem);
+			privateKey.assign(pem, length);
+			BIO_free_all(bio);
+
+			bio = BIO_new(BIO_s_mem());
+			PEM_write_bio_RSA_PUBKEY(bio, rsa);
+			length = BIO_get_mem_data(bio, &pem);
+			publicKey.assign(pem, length);
+			BIO_free_all(bio);
+		}
+		RSA_free(rsa);
+		return generated;
+	}
+
+	void Hash(const std::string& data, unsigned char* hash)
+	{
+		SHA256_CTX sha;
+		SHA256_Init(&sha);
+		SHA256_Update(&sha, data.c_str(), data.length());
+		SHA256_Final(hash, &sha);
+	}
+
+	/// <summary>
+	/// Signs data the way RSACreateSignature used to, parsing the key every time.
+	/// </summary>
+	bool SignPerCall(const std::string& privateKey, const std::string& data, std::string& signature)
+	{
+		auto bio = BIO_new_mem_buf((void*)privateKey.c_str(), privateKey.length());
+		auto rsa = PEM_read_bio_RSAPrivateKey(bio, 0, 0, 0);
+		BIO_free_all(bio);
+		if (!rsa)
+			return false;
+
+		unsigned char hash[SHA256_DIGEST_LENGTH];
+		Hash(data, hash);
+		std::vector<unsigned char> sig(RSA_size(rsa));
+		unsigned int sigLength = 0;
+		auto signedData = RSA_sign(NID_sha256, hash, SHA256_DIGEST_LENGTH, sig.data(), &sigLength, rsa) == 1;
+		RSA_free(rsa);
+		if (!signedData)
+			return false;
+
+		signature.assign(((sigLength + 2) / 3) * 4 + 1, '\0');
+		signature.resize(EVP_EncodeBlock(reinterpret_cast<unsigned char*>(&signature[0]), sig.data(), sigLength));
+		return true;
+	}
+
+	/// <summary>
+	/// Verifies a signature the way RSAVerifySignature used to, parsing the key every time.
+	/// </summary>
+	bool VerifyPerCall(const std::string& publicKey, const std::string& signature, const std::string& data)
+	{
+		auto bio = BIO_new_mem_buf((void*)publicKey.c_str(), publicKey.length());
+		auto rsa = PEM_read_bio_RSA_PUBKEY(bio, 0, 0, 0);
+		BIO_free_all(bio);
+		if (!rsa)
+			return false;
+
+		std::vector<unsigned char> sig(signature.length() / 4 * 3);
+		auto length = EVP_DecodeBlock(sig.data(), reinterpret_cast<const unsigned char*>(signature.c_str()), signature.length());
+		for (size_t i = signature.length(); i > 0 && signature[i - 1] == '='; i--)
+			length--;
+
+		unsigned char hash[SHA256_DIGEST_LENGTH];
+		Hash(data, hash);
+		auto valid = length > 0 && RSA_verify(NID_sha256, hash, SHA256_DIGEST_LENGTH, sig.data(), length, rsa) == 1;
+		RSA_free(rsa);
+		return valid;
+	}
+
+	double MsSince(std::chrono::steady_clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+}
+
+int main()
+{
+	std::string privateKey, publicKey;
+	if (!GenerateKey(privateKey, publicKey))
+	{
+		printf("FAIL: couldn't generate a key\n");
+		return 1;
+	}
+
+	std::vector<std::string> blobs;
+	for (int i = 0; i < BlobCount; i++)
+		blobs.push_back("{\"player\":" + std::to_string(i) + ",\"kills\":" + std::to_string(i * 3) + ",\"deaths\":" + std::to_string(i * 2) + ",\"medals\":[\"doublekill\",\"killingspree\"]}");
+
+	// best of Runs for each, so a context switch during one run doesn't count
+	double signPerCallMs = 1e9, signCachedMs = 1e9, verifyPerCallMs = 1e9, verifyCachedMs = 1e9;
+	SigningService signing;
+	for (int run = 0; run < Runs; run++)
+	{
+		std::vector<std::string> perCall(BlobCount);
+		auto start = std::chrono::steady_clock::now();
+		for (int i = 0; i < BlobCount; i++)
+		{
+			if (!SignPerCall(privateKey, blobs[i], perCall[i]))
+			{
+				printf("FAIL: signing failed\n");
+				return 1;
+			}
+		}
+		auto elapsed = MsSince(start);
+		signPerCallMs = elapsed < signPerCallMs ? elapsed : signPerCallMs;
+
+		std::vector<std::string> cached(BlobCount);
+		start = std::chrono::steady_clock::now();
+		for (int i = 0; i < BlobCount; i++)
+		{
+			if (!signing.Sign(privateKey, blobs[i].c_str(), blobs[i].length(), cached[i]))
+			{
+				printf("FAIL: signing failed\n");
+				return 1;
+			}
+		}
+		elapsed = MsSince(start);
+		signCachedMs = elapsed < signCachedMs ? elapsed : signCachedMs;
+
+		if (perCall != cached)
+		{
+			printf("FAIL: SigningService gave different signatures\n");
+			return 1;
+		}
+
+		start = std::chrono::steady_clock::now();
+		for (int i = 0; i < BlobCount; i++)
+		{
+			if (!VerifyPerCall(publicKey, perCall[i], blobs[i]))
+			{
+				printf("FAIL: a signature didn't verify\n");
+				return 1;
+			}
+		}
+		elapsed = MsSince(start);
+		verifyPerCallMs = elapsed < verifyPerCallMs ? elapsed : verifyPerCallMs;
+
+		start = std::chrono::steady_clock::now();
+		for (int i = 0; i < BlobCount; i++)
+		{
+			if (!signing.Verify(publicKey, cached[i], blobs[i].c_str(), blobs[i].length()))
+			{
+				printf("FAIL: a signature didn't verify\n");
+				return 1;
+			}
+		}
+		elapsed = MsSince(start);
+		verifyCachedMs = elapsed < verifyCachedMs ? elapsed : verifyCachedMs;
+	}
+
+	printf("%d blobs, 4096-bit key, best of %d runs\n", BlobCount, Runs);
+	printf("  sign, parsing the key each time:    %8.3f ms\n", signPerCallMs);
+	printf("  sign, cached key:                   %8.3f ms (%.2fx)\n", signCachedMs, signPerCallMs / signCachedMs);
+	printf("  verify, parsing the key each time:  %8.3f ms\n", verifyPerCallMs);
+	printf("  verify, cached key:                 %8.3f ms (%.2fx)\n", verifyCachedMs, verifyPerCallMs / verifyCachedMs);
+
+	if (signPerCallMs / signCachedMs < TargetSignSpeedup)
+	{
+		printf("FAIL: signing with a cached key wasn't at least %.2fx faster\n", TargetSignSpeedup);
+		return 1;
+	}
+	if (verifyPerCallMs / verifyCachedMs < TargetVerifySpeedup)
+	{
+		printf("FAIL: verifying with a cached key wasn't at least %.2fx faster\n", TargetVerifySpeedup);
+		return 1;
+	}
+	return 0;
+}